@@ -79,6 +79,34 @@
 /* UART number (0..n) for devices with more than          */
 /* one hardware uart (644P, 1284P, etc)                   */
 /*                                                        */
+/* CLOCK_DIV:                                             */
+/* Main clock prescaler while the bootloader runs: 6 (as  */
+/* the chip starts), 4, 2 or 1. 1 needs a 5V supply.      */
+/*                                                        */
+/* AUTOBAUD:                                              */
+/* Set the baud rate by timing the first sync character,  */
+/* instead of using BAUD_RATE.                            */
+/*                                                        */
+/* BATCH_PAGES:                                           */
+/* Accept writes of up to this many flash pages in one    */
+/* STK_PROG_PAGE command, buffered in RAM.                */
+/*                                                        */
+/* FAST_BOOT:                                             */
+/* Start the app straight away after every reset, unless  */
+/* ENTRY_PIN is held low, the last USERROW byte is        */
+/* ENTRY_MAGIC, or there is no app.                       */
+/*                                                        */
+/* MULTIDROP:                                             */
+/* Replace STK500 with a protocol for many nodes on one   */
+/* RS-485 bus: pages are broadcast to all of them at      */
+/* once, and each node is polled for the ones it missed.  */
+/* RS485_DE is the pin that enables the bus driver.       */
+/*                                                        */
+/* TWI:                                                   */
+/* Replace the UART and STK500 with TWI (I2C) client mode */
+/* at TWI_ADDRESS, whole pages per transaction. TWISDA=A1 */
+/* for the alternate pins.                                */
+/*                                                        */
 /**********************************************************/
 
 /**********************************************************/
@@ -233,10 +261,29 @@ typedef union {
   # warning UART is ignored for this chip (use UARTTX=PortPin instead)
 #endif
 
-#define BAUD_SETTING_16 (((16000000/6)*64) / (16L*BAUD_RATE))
-#define BAUD_ACTUAL_16 ((64L*(16000000/6)) / (16L*BAUD_SETTING))
-#define BAUD_SETTING_20 (((20000000/6)*64) / (16L*BAUD_RATE))
-#define BAUD_ACTUAL_20 ((64L*(20000000/6)) / (16L*BAUD_SETTING))
+/*
+   The clock defaults to the prescaler the chip comes out of reset with, which
+    is safe at any voltage. Dividing by less allows faster bit rates, but the
+    result has to be within the speed grade for the supply voltage (10 MHz
+    needs 2.7V, 20 MHz needs 4.5V).
+*/
+#ifndef CLOCK_DIV
+  #define CLOCK_DIV 6
+#endif
+#if CLOCK_DIV == 1
+  #define CLOCK_MCLKCTRLB 0
+#elif CLOCK_DIV == 2
+  #define CLOCK_MCLKCTRLB (CLKCTRL_PDIV_2X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_DIV == 4
+  #define CLOCK_MCLKCTRLB (CLKCTRL_PDIV_4X_gc | CLKCTRL_PEN_bm)
+#elif CLOCK_DIV != 6
+  # error CLOCK_DIV must be 1, 2, 4 or 6
+#endif
+
+#define BAUD_SETTING_16 (((16000000/CLOCK_DIV)*64) / (16L*BAUD_RATE))
+#define BAUD_ACTUAL_16 ((64L*(16000000/CLOCK_DIV)) / (16L*BAUD_SETTING))
+#define BAUD_SETTING_20 (((20000000/CLOCK_DIV)*64) / (16L*BAUD_RATE))
+#define BAUD_ACTUAL_20 ((64L*(20000000/CLOCK_DIV)) / (16L*BAUD_SETTING))
 
 #if BAUD_SETTING_16 < 64   // divisor must be > 1.  Low bits are fraction.
   # error Unachievable baud rate (too fast) BAUD_RATE
@@ -265,8 +312,9 @@ typedef union {
 /*
    We can never load flash with more than 1 page at a time, so we can save
    some code space on parts with smaller pagesize by using a smaller int.
+   (Unless BATCH_PAGES is set, when it's in RAM first.)
 */
-#if MAPPED_PROGMEM_PAGE_SIZE > 255
+#if MAPPED_PROGMEM_PAGE_SIZE > 255 || defined(BATCH_PAGES)
   typedef uint16_t pagelen_t;
   #define GETLENGTH(len) len = getch()<<8; len |= getch()
 #else
@@ -285,12 +333,24 @@ typedef union {
 void pre_main(void) __attribute__((naked)) __attribute__((section(".init8")));
 int main(void) __attribute__((OS_main)) __attribute__((section(".init9"))) __attribute__((used));
 
-void __attribute__((noinline)) __attribute__((leaf)) putch(char);
-uint8_t __attribute__((noinline)) __attribute__((leaf)) getch(void) ;
-void __attribute__((noinline)) verifySpace();
+#ifndef TWI
+  void __attribute__((noinline)) __attribute__((leaf)) putch(char);
+  uint8_t __attribute__((noinline)) __attribute__((leaf)) getch(void) ;
+#endif
 void __attribute__((noinline)) watchdogConfig(uint8_t x);
 
-static void getNch(uint8_t);
+#if !defined(MULTIDROP) && !defined(TWI)
+  void __attribute__((noinline)) verifySpace();
+  static void getNch(uint8_t);
+#endif
+
+#ifdef STAGED_UPDATE
+  #ifdef APP_NOSPM
+    #error "STAGED_UPDATE uses do_nvmctrl, which NO_APP_SPM leaves out"
+  #endif
+  #define STAGED_MAGIC 0x5354                     // "ST", must match StagedUpdate.h
+  static void do_nvmctrl(uint16_t address, uint8_t command, uint8_t data);
+#endif
 
 #if LED_START_FLASHES > 0
   static inline void flash_led(uint8_t);
@@ -307,6 +367,73 @@ static void getNch(uint8_t);
   #error RAMSTART not defined.
 #endif
 
+/*
+   With BATCH_PAGES, a write of several pages is received into RAM from
+   RAMSTART, leaving a little at the top for the stack.
+*/
+#ifdef BATCH_PAGES
+  #define BATCH_BYTES (BATCH_PAGES * MAPPED_PROGMEM_PAGE_SIZE)
+  #if BATCH_BYTES > (RAMEND - RAMSTART + 1) - 32
+    #error "BATCH_PAGES: not enough RAM for that many pages"
+  #endif
+#endif
+
+#ifdef FAST_BOOT
+  #ifndef ENTRY_MAGIC
+    #define ENTRY_MAGIC 0xB0                      // in the last byte of the USERROW: "run the bootloader"
+  #endif
+  #ifdef FANCY_RESET_LOGIC
+    #error "FAST_BOOT replaces FANCY_RESET_LOGIC"
+  #endif
+#endif
+
+#ifdef MULTIDROP
+  #if defined(BATCH_PAGES) || defined(AUTOBAUD)
+    #error "MULTIDROP has its own framing - BATCH_PAGES and AUTOBAUD are for STK500"
+  #endif
+  #include <util/crc16.h>
+  /*
+     RAM from RAMSTART holds one bit per page of flash, set while the page
+      is still wanted, then the frame being received: destination, command,
+      page number, a page of data and the CRC.
+     The end of a frame is a gap in the data of MULTIDROP_GAP_MS (about -
+      it's counted in loops of about 8 clocks); a byte takes 1ms at 9600 baud,
+      so the baud rate has to be higher than that. The host waits longer than
+      the gap plus a page write between frames.
+  */
+  #ifndef MULTIDROP_GAP_MS
+    #define MULTIDROP_GAP_MS 1
+  #endif
+  #define MULTIDROP_GAP     ((20000000L / CLOCK_DIV / 1000) * MULTIDROP_GAP_MS / 8)
+  #define MULTIDROP_PAGES   (PROGMEM_SIZE / MAPPED_PROGMEM_PAGE_SIZE)
+  #define MULTIDROP_MAP     (MULTIDROP_PAGES / 8)
+  #define MULTIDROP_FRAME   (4 + MAPPED_PROGMEM_PAGE_SIZE + 2)
+  #define MULTIDROP_ALL     0xFF                  // destination of a broadcast
+  #define NODE_ID (*(volatile uint8_t *)(USER_SIGNATURES_END - 1))  // the last byte is FAST_BOOT's
+  #if MULTIDROP_MAP + MULTIDROP_FRAME + 1 > (RAMEND - RAMSTART + 1) - 32
+    #error "MULTIDROP: not enough RAM for the page map and a frame"
+  #endif
+  static uint8_t getFrame(uint8_t *frame);
+  static void putFrame(uint8_t *frame, uint8_t len);
+#endif
+
+#ifdef TWI
+  #if defined(MULTIDROP) || defined(BATCH_PAGES) || defined(AUTOBAUD)
+    #error "TWI replaces the UART - MULTIDROP, BATCH_PAGES and AUTOBAUD can't be used with it"
+  #endif
+  #ifndef TWI_ADDRESS
+    #define TWI_ADDRESS 0x2A
+  #endif
+  #define TWI_FRAME (3 + MAPPED_PROGMEM_PAGE_SIZE)  // command, offset, a page
+  #if TWI_FRAME > (RAMEND - RAMSTART + 1) - 32
+    #error "TWI: not enough RAM for a page"
+  #endif
+#endif
+
+#if defined(AUTOBAUD) && (LED_START_FLASHES > 0)
+  #error "AUTOBAUD needs LED_START_FLASHES=0 - the sync character it times would arrive during the flashes"
+#endif
+
 /* everything that needs to run VERY early */
 void pre_main(void) {
   // Allow convenient way of calling do_spm function - jump table,
@@ -334,7 +461,9 @@ int main(void) {
       necessary, and uses 4 bytes of flash.)
   */
   register addr16_t address;
+  #if !defined(MULTIDROP) && !defined(TWI)
   register pagelen_t  length;
+  #endif
 
   // This is the first code to run.
   //
@@ -343,8 +472,76 @@ int main(void) {
   //  SP points to RAMEND
 
   __asm__ __volatile__("clr __zero_reg__");  // known-zero required by avr-libc
+  #ifdef STAGED_UPDATE
+  /*
+     A new image staged by the application (see the StagedUpdate class in the Optiboot_flasher library), in the pages
+     just below the last page of flash. The last page is the control block: a magic number, the number of pages, and a
+     word that it clears once every page has been received and checked. Copy the pages down over the application, and
+     erase the control block. If the power fails partway, the control block is still there, and it all starts again -
+     the staged pages are never written over, as the library won't stage an image that overlaps them.
+  */
+  {
+    uint16_t *control = (uint16_t *)(MAPPED_PROGMEM_END - (MAPPED_PROGMEM_PAGE_SIZE - 1));
+    if (control[0] == STAGED_MAGIC && control[3] == 0) {
+      uint8_t *src = (uint8_t *)control - control[1] * MAPPED_PROGMEM_PAGE_SIZE;
+      uint8_t *dst = (uint8_t *)(MAPPED_PROGMEM_START + 512);
+      do {
+        *dst++ = *src++;                          // into the page buffer
+        if (!((uint8_t)(uint16_t)src & (MAPPED_PROGMEM_PAGE_SIZE - 1))) {
+          do_nvmctrl(0, NVMCTRL_CMD_PAGEERASEWRITE_gc, 0);
+        }
+      } while (src != (uint8_t *)control);
+      *(uint8_t *)control = 0xFF;                 // selects the page to erase
+      do_nvmctrl(0, NVMCTRL_CMD_PAGEERASE_gc, 0);
+    }
+  }
+  #endif
 #define RESET_EXTERNAL (RSTCTRL_EXTRF_bm|RSTCTRL_UPDIRF_bm|RSTCTRL_SWRF_bm)
-  #ifndef FANCY_RESET_LOGIC
+  #if defined(FAST_BOOT)
+  /*
+     The reset cause doesn't matter: the app runs at once, with no timeout,
+      unless the bootloader was asked for. That can be a strap (ENTRY_PIN,
+      read with its pullup on, held low), or the app - which writes
+      ENTRY_MAGIC to the last byte of the USERROW and resets; we put it back
+      to 0xFF, so that it's only once. (GPIOR would be simpler, but every
+      reset clears it.) No app at all is the third: a chip that has only just
+      been bootloaded.
+  */
+  ch = RSTCTRL.RSTFR;
+  {
+    uint8_t enter = 0;
+    #ifdef ENTRY_PIN
+    ENTRY_PINCTRL = PORT_PULLUPEN_bm;
+    __builtin_avr_delay_cycles(32);             // let it rise
+    if (!(ENTRY_VPORT.IN & ENTRY_PIN_bm)) {
+      enter = 1;
+    }
+    ENTRY_PINCTRL = 0;
+    #endif
+    if (*(volatile uint8_t *)USER_SIGNATURES_END == ENTRY_MAGIC) {
+      *(volatile uint8_t *)USER_SIGNATURES_END = 0xFF;
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+      while (NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm)
+        ;
+      enter = 1;
+    }
+    if (*(volatile uint16_t *)(MAPPED_PROGMEM_START + 512) == 0xFFFF) {
+      enter = 1;
+    }
+    if (!enter) {
+      if (!ch) {
+        // Got here without a reset - the app crashed into address 0. Reset properly, so it starts clean.
+        _PROTECTED_WRITE(RSTCTRL.SWRR, RSTCTRL_SWRE_bm);
+      }
+      RSTCTRL.RSTFR = ch; // clear the reset causes before jumping to app...
+      GPIOR0 = ch;        // but, stash the reset cause in GPIOR0 for use by app...
+      watchdogConfig(WDT_PERIOD_OFF_gc);
+      __asm__ __volatile__(
+        "jmp app\n"
+      );
+    }
+  }
+  #elif !defined(FANCY_RESET_LOGIC)
   ch = RSTCTRL.RSTFR;   // get reset cause
   #ifdef START_APP_ON_POR
   // If WDRF is set  OR nothing except BORF and PORF are set, that's not bootloader entry condition
@@ -415,8 +612,11 @@ int main(void) {
   #endif // Fancy reset cause stuff
 
   watchdogReset();
-  //    _PROTECTED_WRITE(CLKCTRL.MCLKCTRLB, 0);  // full speed clock
+  #if CLOCK_DIV != 6
+  _PROTECTED_WRITE(CLKCTRL.MCLKCTRLB, CLOCK_MCLKCTRLB);
+  #endif
 
+  #ifndef TWI
   MYUART_TXPORT.DIR |= MYUART_TXPIN; // set TX pin to output
   MYUART_TXPORT.OUT |= MYUART_TXPIN;  // and "1" as per datasheet
   #if defined (MYUART_PMUX_VAL)
@@ -430,7 +630,12 @@ int main(void) {
   MYUART.DBGCTRL = 1;  // run during debug
   MYUART.CTRLC = (USART_CHSIZE_gm & USART_CHSIZE_8BIT_gc);  // Async, Parity Disabled, 1 StopBit
   MYUART.CTRLA = 0;  // Interrupts: all off
+  #ifdef AUTOBAUD
+  MYUART.CTRLB = USART_RXEN_bm | USART_TXEN_bm | USART_RXMODE_CLK2X_gc;
+  #else
   MYUART.CTRLB = USART_RXEN_bm | USART_TXEN_bm;
+  #endif
+  #endif // !TWI
 
   // Set up watchdog to trigger after a bit
   //  (nominally:, 1s for autoreset, longer for manual)
@@ -457,6 +662,204 @@ int main(void) {
   #endif
   #endif
 
+  #ifdef AUTOBAUD
+  /*
+     Time the first sync character, STK_GET_SYNC ('0', 0x30): low for the
+      start bit and bits 0-3, high for bits 4 and 5, and low again at bit 6 -
+      so it's 7 bit times from the first falling edge to the second. TCB0
+      counts CPU clocks meanwhile; it's left running, as the app is always
+      started by a WDT reset. With CLK2X, BAUD is 8 x (clocks per bit).
+     If nothing arrives, the watchdog starts the app as usual.
+  */
+  {
+    uint16_t start;
+    TCB0.CCMP = 0xFFFF;
+    TCB0.CTRLA = TCB_ENABLE_bm;
+    while (MYUART_RXPORT.IN & MYUART_RXPIN);     // start bit
+    start = TCB0.CNT;
+    while (!(MYUART_RXPORT.IN & MYUART_RXPIN));  // bits 0-3
+    while (MYUART_RXPORT.IN & MYUART_RXPIN);     // bits 4 and 5
+    MYUART.BAUD = ((uint16_t)(TCB0.CNT - start) * 8) / 7;
+  }
+  /*
+     The rest of that sync went by while the USART had the wrong rate; skip
+      whatever it made of it until the next one - the host sends it again
+      when it doesn't get an answer - and answer that one.
+  */
+  while (getch() != STK_GET_SYNC);
+  verifySpace();
+  putch(STK_OK);
+  #endif
+
+  #ifdef MULTIDROP
+  /*
+     Every frame is [destination][command][page, 2 bytes][data][CRC-16, as
+      MODBUS], with the page number 0 for commands that don't use it. A node acts on a frame sent to MULTIDROP_ALL or to its own ID -
+      the byte before the last of the USERROW - and answers only the second kind, so it only ever talks
+      when polled. The commands:
+      'B' page, count - pages page to page + count - 1 are the new image.
+          The first of them is erased at once, so there's no runnable app
+          until the host has sent it again - it sends it last.
+      'P' page, data  - write the page, if it's one still wanted.
+      'M'             - nothing, just the answer.
+      'Q'             - start the app.
+     The answer to 'B', 'P' and 'M' is [ID]['m'][SIGROW_DEVICEID1][the page
+      map][CRC]. Before a 'B' every bit in the map is set, so a node that
+      missed the 'B' shows as wanting pages outside the image.
+  */
+  {
+    uint8_t *map = (uint8_t *)RAMSTART;
+    uint8_t *frame = map + MULTIDROP_MAP;
+    uint8_t i;
+    #ifdef RS485_DE
+    RS485_DE_VPORT.DIR |= RS485_DE_bm;          // low - receiving
+    #endif
+    for (i = 0; i < MULTIDROP_MAP; i++) {
+      map[i] = 0xFF;
+    }
+    for (;;) {
+      uint8_t len = getFrame(frame);
+      uint8_t dest = frame[0];
+      uint8_t id = NODE_ID;
+      addr16_t page;
+      uint16_t count;
+      if (!len || (dest != MULTIDROP_ALL && dest != id)) {
+        continue;
+      }
+      page.bytes[0] = frame[2];
+      page.bytes[1] = frame[3];
+      ch = frame[1];
+      if (ch == 'B') {
+        count = frame[4] | (frame[5] << 8);
+        for (i = 0; i < MULTIDROP_MAP; i++) {
+          map[i] = 0;
+        }
+        for (address.word = page.word; count; count--, address.word++) {
+          if (address.word >= 512 / MAPPED_PROGMEM_PAGE_SIZE && address.word < MULTIDROP_PAGES) {
+            map[address.word >> 3] |= 1 << (address.word & 7);
+          }
+        }
+        if (map[page.word >> 3] & (1 << (page.word & 7))) {
+          *(uint8_t *)(MAPPED_PROGMEM_START + page.word * MAPPED_PROGMEM_PAGE_SIZE) = 0xFF;
+          _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASE_gc);
+          while (NVMCTRL.STATUS & NVMCTRL_FBUSY_bm)
+            ;
+        }
+      } else if (ch == 'P') {
+        if (len != MULTIDROP_FRAME - 2 || page.word >= MULTIDROP_PAGES || !(map[page.word >> 3] & (1 << (page.word & 7)))) {
+          goto answer;
+        }
+        address.word = MAPPED_PROGMEM_START + page.word * MAPPED_PROGMEM_PAGE_SIZE;
+        for (i = 0; i < MAPPED_PROGMEM_PAGE_SIZE; i++) {
+          address.bptr[i] = frame[4 + i];
+        }
+        _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+        while (NVMCTRL.STATUS & NVMCTRL_FBUSY_bm)
+          ;
+        for (i = 0; i < MAPPED_PROGMEM_PAGE_SIZE; i++) {
+          if (address.bptr[i] != frame[4 + i]) {
+            goto answer;                          // still wanted
+          }
+        }
+        map[page.word >> 3] &= ~(1 << (page.word & 7));
+      } else if (ch == 'Q') {
+        watchdogConfig(WDT_PERIOD_8CLK_gc);
+        while (1)
+          ;
+      } else if (ch != 'M') {
+        continue;                                 // including our own answers, if the transceiver echoes them
+      }
+    answer:
+      if (dest != MULTIDROP_ALL) {
+        frame[0] = id;
+        frame[1] = 'm';
+        frame[2] = SIGROW_DEVICEID1;
+        for (i = 0; i < MULTIDROP_MAP; i++) {
+          frame[3 + i] = map[i];
+        }
+        putFrame(frame, 3 + MULTIDROP_MAP);
+      }
+    }
+  }
+  #elif defined(TWI)
+  /*
+     A client on the TWI bus, at TWI_ADDRESS. Each write transaction is a
+      command and a 16-bit offset into the flash, low byte first:
+      'W' offset, a page - write the page. The last byte isn't acknowledged
+          until the page is written, so the host's write only finishes once
+          the page has; that's the only time we hold the clock for more than
+          it takes to answer each byte.
+      'R' offset         - following reads start from there.
+      'S'                - following reads return the signature row.
+      'Q'                - start the app, at the stop.
+     A read transaction returns bytes from where the last 'R' or 'S' left
+      off, for as long as the host goes on reading - a page at a time, or
+      the whole flash. The host can go as fast as 1 MHz (FM+), as long as
+      we answer each byte in well under a bit time: at CLOCK_DIV=6 that's
+      too slow for FM+, so use CLOCK_DIV=2 or 1. Every address match resets
+      the watchdog, so the timeout only runs when the host has gone away.
+  */
+  {
+    uint8_t *buf = (uint8_t *)RAMSTART;
+    uint8_t n = 0;
+    #ifdef MYTWI_PMUX_VAL
+    PORTMUX.CTRLB = MYTWI_PMUX_VAL;
+    #endif
+    TWI0.CTRLA = TWI_FMPEN_bm;
+    TWI0.SADDR = TWI_ADDRESS << 1;
+    TWI0.SCTRLA = TWI_ENABLE_bm;
+    for (;;) {
+      ch = TWI0.SSTATUS;
+      if (ch & TWI_APIF_bm) {
+        if (ch & TWI_AP_bm) {                     // our address: ACK it
+          watchdogReset();
+          n = 0;
+          TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;
+        } else {                                  // a stop
+          TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
+          if (n >= 3 && buf[0] == 'R') {
+            address.bytes[0] = buf[1];
+            address.bytes[1] = buf[2];
+            address.word += MAPPED_PROGMEM_START;
+          } else if (n && buf[0] == 'S') {
+            address.bptr = (uint8_t *)&SIGROW;
+          } else if (n && buf[0] == 'Q') {
+            watchdogConfig(WDT_PERIOD_8CLK_gc);
+            while (1)
+              ;
+          }
+          n = 0;
+        }
+      } else if (ch & TWI_DIF_bm) {
+        if (ch & TWI_DIR_bm) {                    // the host is reading
+          if (n && (ch & TWI_RXACK_bm)) {         // and NACKed the last byte - that's all
+            TWI0.SCTRLB = TWI_SCMD_COMPTRANS_gc;
+          } else {
+            TWI0.SDATA = *(address.bptr++);
+            TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;
+            buf[0] = 0;                           // so the stop doesn't act on the last write again
+            n = 1;
+          }
+        } else {
+          ch = TWI0.SDATA;
+          if (n < TWI_FRAME) {
+            buf[n++] = ch;
+            if (n == TWI_FRAME && buf[0] == 'W') {
+              uint8_t *dst = (uint8_t *)(MAPPED_PROGMEM_START + (buf[1] | (buf[2] << 8)));
+              for (ch = 0; ch < MAPPED_PROGMEM_PAGE_SIZE; ch++) {
+                dst[ch] = buf[3 + ch];
+              }
+              _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+              while (NVMCTRL.STATUS & NVMCTRL_FBUSY_bm)
+                ;
+            }
+          }
+          TWI0.SCTRLB = TWI_SCMD_RESPONSE_gc;     // ACK
+        }
+      }
+    }
+  }
+  #else
   /* Forever loop: exits by causing WDT reset */
   for (;;) {
     /* get character from UART */
@@ -517,18 +920,50 @@ int main(void) {
       }
       // TODO: user row?
 
-      do {
-        *(address.bptr++) = getch();
-      } while (--length);
+      #ifdef BATCH_PAGES
+      if (desttype == 'F') {
+        /*
+           Several pages at once: the CPU stops while a page is written, and
+            the USART only holds 2 characters, so the whole batch has to be in
+            RAM before the first one is. Then one reply for all of them.
+        */
+        uint8_t *buf = (uint8_t *)RAMSTART;
+        pagelen_t count = length;
+        if (length > BATCH_BYTES) {
+          watchdogConfig(WDT_PERIOD_8CLK_gc);   // would run into the stack
+          while (1)
+            ;
+        }
+        do {
+          *buf++ = getch();
+        } while (--count);
+        verifySpace();
+        buf = (uint8_t *)RAMSTART;
+        do {
+          *(address.bptr++) = *buf++;
+          if (!(address.bytes[0] & (MAPPED_PROGMEM_PAGE_SIZE - 1)) || length == 1) {
+            // end of a page, or of the data
+            _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+            while (NVMCTRL.STATUS & NVMCTRL_FBUSY_bm)
+              ;
+          }
+        } while (--length);
+      } else
+      #endif
+      {
+        do {
+          *(address.bptr++) = getch();
+        } while (--length);
 
-      // Read command terminator, start reply
-      verifySpace();
-      /*
-         Actually Write the buffer to flash (and wait for it to finish.)
-      */
-      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
-      while (NVMCTRL.STATUS & (NVMCTRL_FBUSY_bm | NVMCTRL_EEBUSY_bm))
-        ; // wait for flash and EEPROM not busy, just in case.
+        // Read command terminator, start reply
+        verifySpace();
+        /*
+           Actually Write the buffer to flash (and wait for it to finish.)
+        */
+        _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+        while (NVMCTRL.STATUS & (NVMCTRL_FBUSY_bm | NVMCTRL_EEBUSY_bm))
+          ; // wait for flash and EEPROM not busy, just in case.
+      }
     }
     /* Read memory block mode, length is big endian.  */
     else if (ch == STK_READ_PAGE) {
@@ -567,8 +1002,61 @@ int main(void) {
     }
     putch(STK_OK);
   }
+  #endif
 }
 
+#ifdef MULTIDROP
+/*
+   Returns the length of the frame without the CRC, or 0 if the CRC is wrong
+    or it's too short or too long. The first byte is waited for as long as
+    the watchdog lets us; after that, a gap ends the frame.
+*/
+uint8_t getFrame(uint8_t *frame) {
+  uint8_t len = 0;
+  uint16_t crc = 0xFFFF;
+  do {
+    uint16_t idle = MULTIDROP_GAP;
+    uint8_t c = getch();
+    crc = _crc16_update(crc, c);
+    if (len <= MULTIDROP_FRAME) {
+      frame[len++] = c;
+    }
+    while (!(MYUART.STATUS & USART_RXCIF_bm)) {
+      if (!--idle) {
+        goto gap;
+      }
+    }
+  } while (1);
+gap:
+  // the CRC of a frame with its own CRC on the end is 0
+  if (crc || len < 6 || len > MULTIDROP_FRAME) {
+    return 0;
+  }
+  return len - 2;
+}
+
+void putFrame(uint8_t *frame, uint8_t len) {
+  uint16_t crc = 0xFFFF;
+  uint8_t i;
+  #ifdef RS485_DE
+  RS485_DE_VPORT.OUT |= RS485_DE_bm;
+  #endif
+  for (i = 0; i < len; i++) {
+    crc = _crc16_update(crc, frame[i]);
+    putch(frame[i]);
+  }
+  putch(crc & 0xFF);
+  putch(crc >> 8);
+  MYUART.STATUS = USART_TXCIF_bm;                 // left over from earlier bytes; the last one is still going
+  while (!(MYUART.STATUS & USART_TXCIF_bm))
+    ;                                             // until the last stop bit is out
+  #ifdef RS485_DE
+  RS485_DE_VPORT.OUT &= ~RS485_DE_bm;
+  #endif
+}
+#endif
+
+#ifndef TWI
 void putch(char ch) {
   while (0 == (MYUART.STATUS & USART_DREIF_bm))
     ;
@@ -591,6 +1079,9 @@ uint8_t getch(void) {
   return ch;
 }
 
+#endif // !TWI
+
+#if !defined(MULTIDROP) && !defined(TWI)
 void getNch(uint8_t count) {
   do {
     getch();
@@ -606,6 +1097,7 @@ void verifySpace() {
   }
   putch(STK_INSYNC);
 }
+#endif
 
 #if LED_START_FLASHES > 0
 void flash_led(uint8_t count) {
@@ -613,11 +1105,14 @@ void flash_led(uint8_t count) {
   while (count--) {
     LED_PORT.IN |= LED;
     // delay assuming 20Mhz OSC.  It's only to "look about right", anyway.
+    // (quicker with CLOCK_DIV below 6)
     for (delay = ((20E6 / 6) / 150); delay; delay--) {
       watchdogReset();
+      #ifndef TWI
       if (MYUART.STATUS & USART_RXCIF_bm) {
         return;
       }
+      #endif
     }
   }
   watchdogReset(); // for breakpointing
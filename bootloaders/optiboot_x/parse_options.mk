@@ -40,6 +40,62 @@ dummy = FORCE
 endif
 endif
 
+HELPTEXT += "Option STAGED_UPDATE=1       - copy an image staged by the app at the end of flash over the app\n"
+ifdef STAGED_UPDATE
+ifneq ($(STAGED_UPDATE), 0)
+STAGED_UPDATE_CMD = -DSTAGED_UPDATE=1
+dummy = FORCE
+endif
+endif
+
+HELPTEXT += "Option FAST_BOOT=1           - start the app at once unless asked for the bootloader\n"
+ifdef FAST_BOOT
+ifneq ($(FAST_BOOT), 0)
+FAST_BOOT_CMD = -DFAST_BOOT=1
+dummy = FORCE
+endif
+endif
+
+HELPTEXT += "Option ENTRY_PIN=A3          - with FAST_BOOT, run the bootloader if this pin is held low\n"
+ifdef ENTRY_PIN
+ENTRY_PIN_CMD = -DENTRY_PIN=$(ENTRY_PIN)
+dummy = FORCE
+endif
+
+HELPTEXT += "Option MULTIDROP=1           - broadcast uploads to many nodes on an RS-485 bus, instead of STK500\n"
+ifdef MULTIDROP
+ifneq ($(MULTIDROP), 0)
+MULTIDROP_CMD = -DMULTIDROP=1
+dummy = FORCE
+endif
+endif
+
+HELPTEXT += "Option RS485_DE=A4           - with MULTIDROP, drive this pin high while sending\n"
+ifdef RS485_DE
+RS485_DE_CMD = -DRS485_DE=$(RS485_DE)
+dummy = FORCE
+endif
+
+HELPTEXT += "Option TWI=1                 - be a TWI (I2C) client instead of using a UART and STK500\n"
+ifdef TWI
+ifneq ($(TWI), 0)
+TWI_CMD = -DTWI=1
+dummy = FORCE
+endif
+endif
+
+HELPTEXT += "Option TWI_ADDRESS=0x2A      - with TWI, the 7-bit address to answer to\n"
+ifdef TWI_ADDRESS
+TWI_ADDRESS_CMD = -DTWI_ADDRESS=$(TWI_ADDRESS)
+dummy = FORCE
+endif
+
+HELPTEXT += "Option TWISDA=A1             - with TWI, use the alternate pins (SDA A1, SCL A2)\n"
+ifdef TWISDA
+TWISDA_CMD = -DTWISDA=$(TWISDA)
+dummy = FORCE
+endif
+
 HELPTEXT += "Option NO_APP_SPM=1          - disallow application call of do_spm\n"
 ifdef NO_APP_SPM
 ifneq ($(NO_APP_SPM),0)
@@ -104,6 +160,22 @@ else
 BAUD_RATE_CMD = -DBAUD_RATE=115200
 endif
 
+HELPTEXT += "Option AUTOBAUD=1            - take the bit rate from the first sync character\n"
+ifdef AUTOBAUD
+ifneq ($(AUTOBAUD), 0)
+AUTOBAUD_CMD = -DAUTOBAUD=1
+dummy = FORCE
+endif
+endif
+
+HELPTEXT += "Option BATCH_PAGES=n         - accept up to n flash pages per write command\n"
+ifdef BATCH_PAGES
+ifneq ($(BATCH_PAGES), 0)
+BATCH_PAGES_CMD = -DBATCH_PAGES=$(BATCH_PAGES)
+dummy = FORCE
+endif
+endif
+
 HELPTEXT += "Option SOFT_UART=1           - use a software (bit-banged) UART\n"
 ifdef SOFT_UART
 ifneq ($(SOFT_UART), 0)
@@ -134,6 +206,12 @@ RESETPIN_CMD = -DRSTPIN=$(RESETPIN)
 dummy = FORCE
 endif
 
+HELPTEXT += "Option CLOCK_DIV=n           - run at the oscillator frequency / 1, 2, 4 or 6 (default)\n"
+ifdef CLOCK_DIV
+CLOCK_DIV_CMD = -DCLOCK_DIV=$(CLOCK_DIV)
+dummy = FORCE
+endif
+
 ifdef AVR_FREQ
 FCPU_CMD = -DF_CPU=$(AVR_FREQ)
 dummy = FORCE
@@ -143,9 +221,14 @@ HELPTEXT += "Option AVR_FREQ=<n>          - Clock rate of AVR CPU\n"
 
 
 LED_OPTIONS = $(LED_START_FLASHES_CMD) $(LED_DATA_FLASH_CMD) $(LED_CMD) $(LED_START_ON_CMD) $(LEDINV_CMD)
-CPU_OPTIONS = $(RESETPIN_CMD) $(TIMEOUT_CMD) $(FCPU_CMD)
+CPU_OPTIONS = $(RESETPIN_CMD) $(TIMEOUT_CMD) $(FCPU_CMD) $(CLOCK_DIV_CMD)
 COMMON_OPTIONS =  $(BIGBOOT_CMD) $(APPSPM_CMD) $(VERSION_CMD)
 COMMON_OPTIONS += $(SUPPORT_EEPROM_CMD)
+COMMON_OPTIONS += $(STAGED_UPDATE_CMD)
+COMMON_OPTIONS += $(BATCH_PAGES_CMD)
+COMMON_OPTIONS += $(FAST_BOOT_CMD) $(ENTRY_PIN_CMD)
+COMMON_OPTIONS += $(MULTIDROP_CMD) $(RS485_DE_CMD)
+COMMON_OPTIONS += $(TWI_CMD) $(TWI_ADDRESS_CMD) $(TWISDA_CMD)
 
 #UART is handled separately and only passed for devices with more than one.
 HELPTEXT += "Option UART=n                - use UARTn for communications\n"
@@ -157,4 +240,4 @@ ifdef UARTTX
 UART_CMD = -DUARTTX=$(UARTTX)
 endif
 
-UART_OPTIONS = $(UART_CMD) $(BAUD_RATE_CMD) $(SOFT_UART_CMD) $(SS_CMD)
+UART_OPTIONS = $(UART_CMD) $(BAUD_RATE_CMD) $(SOFT_UART_CMD) $(SS_CMD) $(AUTOBAUD_CMD)
@@ -855,10 +855,57 @@
 #  define MYUART USART1
 #  define MYUART_TXPORT VPORTC
 #  define MYUART_TXPIN (1 << PORT2)
+#  define MYUART_RXPIN (1 << PORT1)
 #  define MYUART_PMUX_VAL (USART_ALTPMUX << 2)
 # endif
 #endif
 
-#ifndef MYUART
+/*
+ * RX is the pin after TX on every one of these, except USART1 on the
+ * alternate pins of the 2-series, above. Only AUTOBAUD reads it directly.
+ */
+#if defined(MYUART_TXPIN) && !defined(MYUART_RXPIN)
+# define MYUART_RXPIN (MYUART_TXPIN << 1)
+#endif
+#define MYUART_RXPORT MYUART_TXPORT
+
+/*
+ * ENTRY_PIN=A3 etc. for FAST_BOOT, decoded the short way: VPORTs are 4 bytes
+ * each from address 0, and PORTs 0x20 bytes each from PORTA.
+ */
+#ifdef ENTRY_PIN
+# define ENTRY_VPORT (*(VPORT_t *)(((ENTRY_PIN >> 8) - 1) * 4))
+# define ENTRY_PIN_bm (1 << (ENTRY_PIN & 7))
+# define ENTRY_PINCTRL ((&PORTA.PIN0CTRL)[((ENTRY_PIN >> 8) - 1) * 0x20 + (ENTRY_PIN & 7)])
+#endif
+
+/*
+ * RS485_DE=A4 etc. for MULTIDROP: high while we're sending, to enable the
+ * transceiver's driver. Decoded the same way.
+ */
+#ifdef RS485_DE
+# define RS485_DE_VPORT (*(VPORT_t *)(((RS485_DE >> 8) - 1) * 4))
+# define RS485_DE_bm (1 << (RS485_DE & 7))
+#endif
+
+/*
+ * TWI (client mode bootloader) pins: TWISDA=B1 (the default; SCL on B0), or
+ * A1 (SCL on A2) on the parts that have the alternate pins.
+ */
+#ifdef TWI
+# if !defined(TWISDA) || (TWISDA == B1)
+#  define TWI_NAME "B1"
+# elif (TWISDA == A1)
+#  define TWI_NAME "A1"
+#  ifndef PORTMUX_TWI0_bm
+#   error No alternate TWI pins on this part
+#  endif
+#  define MYTWI_PMUX_VAL PORTMUX_TWI0_bm
+# else
+#  error TWISDA must be B1 or A1
+# endif
+#endif
+
+#if !defined(MYUART) && !defined(TWI)
 # warning No UARTTX pin specified.
 #endif
@@ -20,7 +20,13 @@
 #ifndef Arduino_h
 #define Arduino_h
 #include "core_devices.h"
+#include "isr_trace.h"
+#include "event_trace.h"
+#include "reset_info.h"
+#include "uptime.h"
 #include "api/ArduinoAPI.h"
+#include "mem_pool.h"
+#include "fixed_math.h"
 
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
@@ -78,6 +84,7 @@ extern "C" {
   #define ADC_ACC64       0x86
 
   #define getAnalogSampleDuration()   (ADC0.SAMPCTRL)
+  #define getAnalogReadResolution()   ((ADC0.CTRLA & ADC_RESSEL_bm) ? 8 : 10)
 
 #else
   /* ADC constants for 2-series */
@@ -122,8 +129,12 @@ extern "C" {
   #define ADC_ACC256      0x88
   #define ADC_ACC512      0x89
   #define ADC_ACC1024     0x8A
+  /* As the gain for analogReadEnh()/analogReadDiff(): the highest PGA gain that doesn't clip, remembered per channel.
+   * The result is scaled to 16x gain - 1/16 of an LSB at unity gain - whatever gain was used. See Ref_Analog.md. */
+  #define ADC_GAIN_AUTO   0xFF
 
   #define getAnalogSampleDuration()   (ADC0.CTRLE)
+  uint8_t getAnalogReadResolution();
 
   #define LOW_LAT_ON      0x03
   #define LOW_LAT_OFF     0x02
@@ -181,6 +192,7 @@ extern "C" {
   // To align with the future, we use the Dx-series names for these.
   #define TCB_CLKSEL_DIV2_gc TCB_CLKSEL_CLKDIV2_gc
   #define TCB_CLKSEL_DIV1_gc TCB_CLKSEL_CLKDIV1_gc
+  #define TCB_CLKSEL_TCA0_gc TCB_CLKSEL_CLKTCA_gc
 #endif
 
 #define VCC_5V0 2
@@ -201,6 +213,31 @@ void init_millis();   /* called by init() last   */
 void init_timers();   /* called by init()        */
 void init_TCA0();     /* called by init_timers() */
 void init_TCD0();     /* called by init_timers() */
+#if defined(CORE_MEASURE_INIT)
+  // Cycles each step of init() took, indexed by these - see Ref_Clocks.md
+  extern uint16_t init_cycles[5];
+  #define INIT_CYCLES_CLOCK   (0)
+  #define INIT_CYCLES_ADC     (1)
+  #define INIT_CYCLES_TIMERS  (2)
+  #define INIT_CYCLES_MILLIS  (3)
+  #define INIT_CYCLES_TOTAL   (4)
+#endif
+
+// Runtime clock change - F_CPU, or F_CPU divided by a power of two. The millis timer, USART BAUD and ADC prescaler
+// are re-timed to match. See Ref_Clocks.md.
+uint32_t setCPUFrequency(uint32_t hz); // returns hz, or 0 if it can't
+uint32_t getCPUFrequency();
+
+// Measuring and tuning the internal oscillator against a 32.768 kHz crystal on TOSC1/TOSC2 - see Ref_Tuning.md
+// The error is in ppm (parts per million, positive if the clock is fast), or one of these.
+#define OSC_ERROR_MAX           (32000)
+#define OSC_ERROR_NO_REFERENCE  (-32768)  // no crystal, or it isn't oscillating
+#define OSC_ERROR_STARTING      (-32767)  // the crystal has been started, but isn't ready yet - try again later
+#define OSC_ERROR_BUSY          (-32766)  // the RTC or the timer is in use, or setCPUFrequency() has the clock below F_CPU
+int16_t oscMeasure();                  // takes 9 periods of the PIT event: ~18 ms at 16 MHz and up
+int16_t oscTune();                     // measures, then steps the calibration while that improves it; returns the error
+int16_t oscError();                    // the last error measured
+int16_t oscErrorFromBaud(uint16_t baudreg, uint32_t baud);  // from the BAUD register after an auto-baud sync
 
 // Peripheral takeover
 // These will remove things controlled by
@@ -208,11 +245,121 @@ void init_TCD0();     /* called by init_timers() */
 // 0x40 - TCD0, 0x10 - TCA0
 void takeOverTCA0();
 void takeOverTCD0();
+uint8_t digitalPinToTimerNow(uint8_t pin); // the timer that analogWrite() would use for this pin right now
+
+// Starting the PWM timers in step - stop them, set their counts (the phase offsets), and start them all at once.
+// False if one of them doesn't exist or is used for millis. See Ref_Timers.md.
+#define SYNC_TCA0 (0x01)
+#define SYNC_TCB0 (0x02)
+#define SYNC_TCB1 (0x04)
+#define SYNC_TCD0 (0x08)   // 1-series only. Its count can't be set; it always starts from the start of its cycle
+bool syncTimersStop(uint8_t timers);
+bool syncTimersStart(uint8_t timers);
+
+// TCA0 PWM resolution and frequency - either one makes TCA0 a single 16-bit timer with PWM on WO0-2 only, with
+// analogWrite() taking values of that many bits. 8 bits at frequency 0 (the default) is split mode again.
+bool     analogWriteResolution(uint8_t bits);  // 8 to 16
+uint32_t analogWriteFrequency(uint32_t hz);    // returns the frequency it got, or 0 if it can't
+
+// Complementary PWM with dead-time on TCD0 WOA/WOB (1-series only) - takes over TCD0. The fault input is TCD0 input A,
+// fed by whatever event generator is connected to the tcd0_in_a event user.
+#define MOTOR_FAULT_NONE  (0x00)  // no fault input
+#define MOTOR_FAULT_CYCLE (0x01)  // outputs off while the fault input is active
+#define MOTOR_FAULT_LATCH (0x02)  // outputs off until motorPWMClearFault()
+#define MOTOR_FAULT_LOW   (0x10)  // the fault input is active low (default is active high, like an AC output)
+uint16_t motorPWMBegin(uint32_t frequency, uint16_t deadtime_ns, uint8_t fault); // returns TOP, the full scale duty, or 0
+bool     motorPWMWrite(uint16_t duty);        // 0 to TOP - both compare values change together at the end of a cycle
+bool     motorPWMFaulted();                   // a fault has happened since it was last cleared
+void     motorPWMClearFault();                // clear that, and with MOTOR_FAULT_LATCH, turn the outputs back on
+void     motorPWMStop();
+
+// tone() generated by a TCB in 8-bit PWM mode on its own WO pin, with no ISR. One voice per TCB not used for millis.
+bool     toneHW(uint8_t pin, unsigned int frequency, unsigned long duration); // false if the pin or frequency can't be done
+void     noToneHW(uint8_t pin);
+
+// Sleep - as deep as the peripherals that are running allow. Modes are SLPCTRL_SMODE_IDLE_gc, _STDBY_gc and _PDOWN_gc
+// (the same values as SLEEP_MODE_IDLE, _STANDBY and _PWR_DOWN from avr/sleep.h). See PowerSave.md.
+uint8_t  sleepModeAllowed();                  // the deepest mode nothing running rules out, no deeper than sleepLimit()
+void     sleepLimit(uint8_t mode);            // never sleep deeper than this - default power down
+uint32_t sleepFor(uint32_t ms);               // wakes on the RTC, millis is kept; returns ms slept (less after sleepWake())
+void     sleepWake();                         // call from an ISR to end sleepFor() early
+void     sleepUntilInterrupt();               // sleep once, until any interrupt
+
+// Every pin in a mask to one low-power state before sleep, in one pass per port, and back afterwards. Bit
+// port * 8 + n is pin Pxn (PA0 is bit 0, PB0 bit 8, PC0 bit 16); PINS_ALL is every pin this part has. The
+// park config is the PINnCTRL value for those pins, which are made inputs, unless PARK_OUTPUT_LOW is in it.
+#define PARK_INPUT_DISABLE  (PORT_ISC_INPUT_DISABLE_gc)                     // floating - only for pins something drives
+#define PARK_PULLUP         (PORT_ISC_INPUT_DISABLE_gc | PORT_PULLUPEN_bm)  // the usual choice
+#define PARK_OUTPUT_LOW     (0x0100 | PORT_ISC_INPUT_DISABLE_gc)            // driven low
+void     pinsSaveAndPark(uint32_t pins, uint16_t parkConfig);  // saves their DIR, OUT and PINnCTRL first
+void     pinsRestore();                       // puts back what pinsSaveAndPark() saved
 
 // millis() timer control
 void stop_millis();                   // Disable the interrupt and stop counting millis.
 void restart_millis();                // Reinitialize the timer and start counting millis again
 void set_millis(uint32_t newmillis);  // set current millis time.
+uint16_t micros16();                  // low 16 bits of micros(), for short intervals - cheaper to calculate.
+typedef struct {
+  uint32_t millis;                    // what millis() would have returned
+  uint16_t ticks;                     // raw millis timer count at that same moment
+} time_snapshot_t;
+time_snapshot_t timeSnapshot();       // both from a single critical section.
+
+// Timer service - up to 8 software timers run from the millis timer interrupt. Not available with the RTC as millis timer.
+#define TIMER_ONESHOT     (0x00)
+#define TIMER_PERIODIC    (0x01)      // rearm after each run - otherwise it runs once, then the slot is freed.
+#define TIMER_DEFERRED    (0x02)      // run it from timerDispatch(), not from the ISR.
+int8_t timerAdd(voidFuncPtr callback, uint16_t ms, uint8_t mode); // returns the timer id, or -1 if none are free.
+void   timerCancel(int8_t id);
+void   timerDispatch();               // call from loop() to run deferred timers that are due.
+
+// Cooperative tasks - stackless (protothread style) tasks, run from yield(): while delay() or Serial is waiting, or
+// whenever loop() calls it. Only locals that are static survive a TASK_ macro, and none may be declared with an
+// initializer between two of them.
+typedef struct task_s {
+  uint8_t      (*func)(struct task_s *);
+  struct task_s *next;
+  uint32_t       start;               // for TASK_DELAY()
+  uint16_t       line;                // where to carry on from, 0 for the beginning
+} task_t;
+#define TASK_WAITING      (0x00)      // returned by a task that couldn't get any further
+#define TASK_RAN          (0x01)      // ... that did something before stopping,
+#define TASK_ENDED        (0x02)      // ... and that's finished, and can be removed.
+void   taskAdd(task_t *task, uint8_t (*func)(task_t *));
+void   taskRemove(task_t *task);
+#define TASK_BEGIN(t)             uint8_t _task_ran = TASK_WAITING; switch ((t)->line) { case 0:
+#define TASK_END(t)               } (void) _task_ran; (t)->line = 0; return TASK_ENDED
+#define TASK_WAIT_UNTIL(t, cond)  do { (t)->line = __LINE__; _task_ran = TASK_RAN; __attribute__((fallthrough)); \
+                                    case __LINE__: if (!(cond)) return _task_ran; } while (0)
+#define TASK_YIELD(t)             do { (t)->line = __LINE__; return TASK_RAN; case __LINE__:; } while (0)
+#define TASK_DELAY(t, ms)         do { (t)->start = millis(); TASK_WAIT_UNTIL(t, millis() - (t)->start >= (ms)); } while (0)
+#define TASK_EXIT(t)              do { (t)->line = 0; return TASK_ENDED; } while (0)
+
+// Deferred work - an ISR posts a function, with an argument, to run later with interrupts on, so it can return at once.
+// deferDispatch() runs what's been posted, everything at DEFER_HIGH before anything at DEFER_LOW; call it from loop().
+// yield() runs it too (so delay(), Serial while it waits, and tasks do) once the sketch calls it anywhere.
+#define DEFER_HIGH        (0x00)
+#define DEFER_LOW         (0x01)
+typedef void (*deferFunc_t)(uint8_t arg);
+bool    defer(deferFunc_t func, uint8_t arg, uint8_t priority);  // false if that priority's queue is full
+bool    deferCall(voidFuncPtr func, uint8_t priority);          // the same, for a function with no argument
+uint8_t deferDispatch();                                         // returns the number that ran
+// OR'ed into the mode of attachInterrupt() for Comparator and Logic, or passed to Serial.onFrame() and Wire.asyncDefer(),
+// to have the library post the callback instead of calling it from the ISR. Only if the sketch calls deferDispatch();
+// otherwise the callbacks are called from the ISR as usual.
+#define DEFERRED          (0x80)
+#define DEFERRED_LOW      (0xC0)
+bool    _defer_post(uint16_t func, uint8_t arg, uint8_t flags) __attribute__((weak));
+static inline void _deferOrCall(deferFunc_t func, uint8_t arg, uint8_t deferred) {
+  if (!(deferred & DEFERRED) || !_defer_post || !_defer_post((uint16_t)func, arg, deferred)) {
+    func(arg);        // if it's full, late is better than never
+  }
+}
+static inline void _deferOrCallVoid(voidFuncPtr func, uint8_t deferred) {
+  if (!(deferred & DEFERRED) || !_defer_post || !_defer_post((uint16_t)func, 0, deferred | 0x01)) {
+    func();
+  }
+}
 /* Expected usage:
  * uint32_t oldmillis=millis();
  * stop_millis();
@@ -226,6 +373,13 @@ void set_millis(uint32_t newmillis);  // set current millis time.
  * see also
  */
 
+// Non-blocking pulseIn() - the width is timed with micros() from the pin interrupt, so it needs millis, and not the RTC.
+#define PULSE_PENDING     (-1L)
+typedef void (*pulseCallback_t)(unsigned long width);
+int8_t pulseInAsync(uint8_t pin, uint8_t state, pulseCallback_t callback, unsigned long timeout); // returns handle, or -1.
+long   pulseInAsyncResult(int8_t handle); // PULSE_PENDING, or the width in us (0 if it timed out), once.
+void   pulseInAsyncCancel(int8_t handle);
+
 // DIGITAL I/O EXTENDED FUNCTIONS
 // Covered in documentation.
 int32_t     analogReadEnh(        uint8_t pin, /* no neg */ uint8_t res, uint8_t gain);
@@ -235,12 +389,114 @@ bool        analogSampleDuration(uint8_t dur);
 void        DACReference(         uint8_t mode);
 void        ADCPowerOptions(      uint8_t options); /* 2-series only */
 
+// Non-blocking analogRead() - same pins and resolution. Start returns false if the pin is invalid or the ADC is busy
+// or disabled; the result is ADC_ERROR_BUSY until the conversion is done.
+bool        analogReadStart(uint8_t pin);
+// Look the pin up and select it ahead of time; false if it isn't valid or the ADC is busy. See Ref_Analog.md.
+bool        analogPrepare(uint8_t pin);
+#define     analogReadReady()       ((bool)(ADC0.INTFLAGS & ADC_RESRDY_bm))
+int16_t     analogReadResult();
+
+// The internal temperature sensor in whole degrees C, and the supply voltage in mV - 16 samples, with the reference
+// changed for the reading and put back. ADC_ERROR_BUSY or ADC_ERROR_DISABLED on error. See Ref_Analog.md.
+int16_t     readTemperature();
+int16_t     readSupplyVoltage();
+
+// Window comparator watch - the ADC checks each reading with no help from the CPU, and the callback gets the first one
+// that matches, from the interrupt. Thresholds are in analogRead() units. See Ref_Analog.md.
+#define     WATCH_BELOW       (0x01)  // reading < low
+#define     WATCH_ABOVE       (0x02)  // reading > high
+#define     WATCH_INSIDE      (0x03)  // low < reading < high
+#define     WATCH_OUTSIDE     (0x04)  // reading < low or reading > high
+#define     WATCH_EVENT       (0x10)  // convert when an event on the ADC's start input says to, instead of free-running.
+#define     WATCH_WAKE        (0x80)  // keep the ADC running in standby sleep.
+typedef void (*analogWatchCallback_t)(int16_t reading);
+bool        analogWatch(uint8_t pin, int16_t low, int16_t high, uint8_t mode, analogWatchCallback_t callback);
+void        analogWatchStop();
+
+// DAC playback, on parts with a DAC - a table of 8-bit samples written to the DAC, rate samples/second, from the
+// interrupt of a TCB. The range is set with DACReference(). See Ref_Analog.md.
+#define     DAC_LOOP          (0x00)  // play the table over and over; the callback is called each time it wraps.
+#define     DAC_ONESHOT       (0x01)  // play it once - the callback is called at the end, and the DAC holds the last sample.
+#define     DAC_DOUBLEBUF     (0x02)  // loop through a buffer in RAM, calling back with each half once it's played, to refill it.
+#define     DAC_PROGMEM       (0x10)  // the table is in flash (not with DAC_DOUBLEBUF).
+typedef void (*dacCallback_t)(uint8_t *played);
+bool        dacPlay(const uint8_t *samples, uint16_t len, uint32_t rate, uint8_t mode, dacCallback_t callback);
+void        dacStop();
+bool        dacBusy();
+
+// PWM handles - pwmAttach() does the looking up analogWrite() does on each call once, and turns the output on at 0%.
+// pwmWrite() then sets the duty cycle (0-255, as analogWrite()) with a single store on TCA0 and DAC pins. See Ref_Timers.md.
+typedef struct {
+  volatile uint8_t *reg;              // compare register, DAC0.DATA, or a dummy byte if the pin has no PWM
+  uint8_t           timer;            // TIMERA0, TIMERD0, DACOUT, or NOT_ON_TIMER
+  uint8_t           bit_mask;         // TCD0 only - which channel
+} pwm_handle_t;
+pwm_handle_t pwmAttach(uint8_t pin);
+void        _pwmWriteTCD0(pwm_handle_t handle, uint8_t duty);
+static inline __attribute__((always_inline)) void pwmWrite(pwm_handle_t handle, uint8_t duty) {
+  #if defined(TCD0)
+    if (handle.timer == TIMERD0) {
+      _pwmWriteTCD0(handle, duty);
+      return;
+    }
+  #endif
+  *handle.reg = duty;
+}
+
+// Filters for the stream and scan results, run in the ADC interrupt - for analogStreamFilter(), and the filter of an
+// analogScanChannel_t. See Ref_Analog.md.
+#define     ADC_FILTER_NONE           (0x00)
+#define     ADC_FILTER_AVG2           (0x11)  // moving average of the last 2, 4, 8 or 16 results
+#define     ADC_FILTER_AVG4           (0x12)
+#define     ADC_FILTER_AVG8           (0x13)
+#define     ADC_FILTER_AVG16          (0x14)
+#define     ADC_FILTER_MEDIAN3        (0x23)  // median of the last 3 or 5 - removes spikes without smoothing edges
+#define     ADC_FILTER_MEDIAN5        (0x25)
+#define     ADC_FILTER_IIR(k)         (0x30 | (k)) // y += (x - y) / 2^k, k = 1 to 8: time constant of about 2^k results
+
+// ADC streaming - one pin converted continuously, at rate samples/second (0 = free-running), into a double buffer.
+// The callback gets each half as it fills, from the ADC interrupt. See Ref_Analog.md.
+typedef void (*analogStreamCallback_t)(int16_t *samples, uint16_t count);
+bool        analogStreamFilter(uint8_t filter); // before or while streaming; false if it's not one of the above.
+bool        analogStreamBegin(uint8_t pin, uint32_t rate, int16_t *buffer, uint16_t len, analogStreamCallback_t callback);
+void        analogStreamStop();
+int16_t    *analogStreamRead();     // with no callback: the half that just filled, once, or NULL.
+uint16_t    analogStreamOverruns(); // halves that filled before the one before them was read.
+
+// ADC scan - a list of channels converted back to back from the ADC interrupt, rate sweeps/second, or with rate 0,
+// one sweep each time analogScanStart() is called. The callback gets the results of each sweep. See Ref_Analog.md.
+typedef struct {
+  uint8_t   pin;                      // pin or ADC_CH() channel
+  uint8_t   res;                      // as analogReadEnh() - bits or ADC_ACCn; 0 = the analogReadResolution() setting
+  uint8_t   gain;                     // PGA gain 1, 2, 4, 8 or 16, or 0 for none. 2-series only.
+  uint8_t   filter;                   // ADC_FILTER_ constant; can be left out of the initializer for none
+} analogScanChannel_t;
+typedef void (*analogScanCallback_t)(int32_t *results, uint8_t count);
+bool        analogScanBegin(const analogScanChannel_t *channels, uint8_t count, int32_t *results, uint32_t rate, analogScanCallback_t callback);
+bool        analogScanStart();      // rate 0 only - false if a sweep is still going.
+// Or (with rate 0) start each sweep on a PWM timer event, at the same point in every PWM cycle - false if millis has it.
+#define     ADC_TRIGGER_TCA0_OVF      (0x80)  // overflow, or in split mode (as the core sets it up) low byte underflow
+#define     ADC_TRIGGER_TCA0_HUNF     (0x81)  // split mode high byte underflow
+#define     ADC_TRIGGER_TCA0_CMP0     (0x84)  // compare match, or the low byte's in split mode
+#define     ADC_TRIGGER_TCA0_CMP1     (0x85)
+#define     ADC_TRIGGER_TCA0_CMP2     (0x86)
+#define     ADC_TRIGGER_TCD0_CMPBCLR  (0xC4)  // 1-series only - end of the TCD0 cycle (start of it, in dual slope mode)
+#define     ADC_TRIGGER_TCD0_CMPASET  (0xC5)
+#define     ADC_TRIGGER_TCD0_CMPBSET  (0xC6)
+#define     ADC_TRIGGER_TCD0_PROGEV   (0xC7)  // the programmable event, set up with TCD0.EVCTRLx/CTRLD
+bool        analogScanTrigger(uint8_t source);
+bool        analogScanBusy();
+void        analogScanStop();
+
 // DIGITAL I/O EXTENDED FUNCTIONS
 // Covered in documentation.
 void           openDrain(uint8_t pinNumber,   uint8_t val);
 int8_t   digitalReadFast(uint8_t pinNumber               );
 void    digitalWriteFast(uint8_t pinNumber,   uint8_t val);
 void       openDrainFast(uint8_t pinNumber,   uint8_t val);
+void        shiftOutFast(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val); /* Constant pins and bitOrder; about 3 MHz at 20 MHz */
+uint8_t      shiftInFast(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
 void         pinModeFast(uint8_t pinNumber,  uint8_t mode); /* Does NOT implement the old-style setting/clearing of output value for input/input_pullup - and does support OUTPUT_PULLUP (for "open drain" applications) */
 void        pinConfigure(uint8_t pinNumber, uint16_t mode);
 void          turnOffPWM(uint8_t pinNumber               ); /* Turns off pins that analogWrite() can turn on PWM for. Does nothing if the pin is outputting PWM, but user has "taken over" that timer,
@@ -293,6 +549,7 @@ unsigned long microsecondsToMillisClockCycles(unsigned long microseconds);
 
 
 __attribute__ ((noinline)) void _delayMicroseconds(unsigned int us);
+void delayPrecise(unsigned int us);         // delayMicroseconds() timed by a TCB, so ISRs meanwhile don't lengthen it
 
 
 // Get the bit location within the hardware port of the given virtual pin.
@@ -415,6 +672,132 @@ extern const uint8_t digital_pin_to_timer[];
 // Used for openDrain()
 #define FLOATING      HIGH
 
+/* Dedicated pin interrupts - these define the port vector themselves, with the code right in the ISR, instead of going
+ * through attachInterrupt()'s scan of the flags and call through a function pointer. So the compiler saves only the
+ * registers the code actually uses. Each defines that port's vector, so it can't be combined with attachInterrupt()
+ * on that port - see Ref_Interrupts.md. Enable the pin with attachInterruptFast<pin>(mode).
+ *
+ * FAST_PIN_ISR(A, 3) { ... }         - PA3 is the only interrupt on PORTA. Its flag is cleared before the code runs.
+ * FAST_PORT_ISR(A, flags) { ... }    - flags is the INTFLAGS of PORTA, which are all cleared before the code runs.
+ */
+#define FAST_PIN_ISR(port, bit)                                                             \
+  static inline __attribute__((always_inline)) void _fast_pin_isr_##port##bit();            \
+  ISR(PORT##port##_PORT_vect) {                                                             \
+    VPORT##port.INTFLAGS = (1 << (bit));                                                    \
+    _fast_pin_isr_##port##bit();                                                            \
+  }                                                                                         \
+  static inline __attribute__((always_inline)) void _fast_pin_isr_##port##bit()
+
+#define FAST_PORT_ISR(port, flags)                                                          \
+  static inline __attribute__((always_inline)) void _fast_port_isr_##port(uint8_t flags);   \
+  ISR(PORT##port##_PORT_vect) {                                                             \
+    uint8_t _fast_flags  = VPORT##port.INTFLAGS;                                            \
+    VPORT##port.INTFLAGS = _fast_flags;                                                     \
+    _fast_port_isr_##port(_fast_flags);                                                     \
+  }                                                                                         \
+  static inline __attribute__((always_inline)) void _fast_port_isr_##port(uint8_t flags)
+
+/* Queued and counted pin interrupts (WInterrupts_queue.c) - for inputs that change too often to run a callback every
+ * time. These also define the port's vector, so the same rules apply; enable the pins with attachInterruptFast().
+ *
+ * QUEUED_PORT_ISR(A);                - each interrupt puts {port, flags, time} in a queue, read with pinEventRead();
+ *                                      edges on several pins that land in the same interrupt are one entry.
+ * COUNTED_PORT_ISR(A);               - each edge just adds one to that pin's count, read with pinEventCount().
+ *
+ * time is PIN_EVENT_TCB's count, started counting at F_CPU/2 by pinEventBegin(). */
+#if !defined(PIN_EVENT_TCB) // TCB1 if we have one and millis isn't on it, since tone() uses TCB0.
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define PIN_EVENT_TCB TCB1
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define PIN_EVENT_TCB TCB0
+  #endif
+#endif
+#if !defined(CORE_PIN_EVENT_QUEUE_SIZE)
+  #if (INTERNAL_SRAM_SIZE < 512)
+    #define CORE_PIN_EVENT_QUEUE_SIZE 8
+  #else
+    #define CORE_PIN_EVENT_QUEUE_SIZE 16
+  #endif
+#endif
+#if (CORE_PIN_EVENT_QUEUE_SIZE & (CORE_PIN_EVENT_QUEUE_SIZE - 1)) || CORE_PIN_EVENT_QUEUE_SIZE > 128
+  #error "CORE_PIN_EVENT_QUEUE_SIZE must be a power of 2, no larger than 128"
+#endif
+
+typedef struct {
+  uint8_t  port;        // PA, PB or PC
+  uint8_t  flags;       // the pins on that port that had an edge, as a bit mask
+  uint16_t time;        // PIN_EVENT_TCB.CNT when the interrupt ran (0 if there's no TCB for it)
+} pin_event_t;
+
+void      pinEventBegin();
+uint8_t   pinEventAvailable();
+bool      pinEventRead(pin_event_t *event);  // false if the queue is empty
+bool      pinEventOverflow();                // true if an event was lost because the queue was full since the last call
+uint16_t  pinEventCount(uint8_t pin);
+uint16_t  pinEventCountReset(uint8_t pin);   // returns the count, and sets it back to 0
+
+extern volatile pin_event_t _pin_event_queue[CORE_PIN_EVENT_QUEUE_SIZE];
+extern volatile uint8_t     _pin_event_head;
+extern volatile uint8_t     _pin_event_tail;
+extern volatile uint8_t     _pin_event_overflow;
+extern volatile uint16_t    _pin_event_counts[];
+
+#if defined(PIN_EVENT_TCB)
+  #define _PIN_EVENT_TIME() (PIN_EVENT_TCB.CNT)
+#else
+  #define _PIN_EVENT_TIME() (0)
+#endif
+
+#define QUEUED_PORT_ISR(port)                                                               \
+  ISR(PORT##port##_PORT_vect) {                                                             \
+    uint16_t _ev_time    = _PIN_EVENT_TIME();                                               \
+    uint8_t _ev_flags    = VPORT##port.INTFLAGS;                                            \
+    VPORT##port.INTFLAGS = _ev_flags;                                                       \
+    uint8_t _ev_head     = _pin_event_head;                                                 \
+    uint8_t _ev_next     = (_ev_head + 1) & (CORE_PIN_EVENT_QUEUE_SIZE - 1);                \
+    if (_ev_next == _pin_event_tail) {                                                      \
+      _pin_event_overflow = 1;                                                              \
+    } else {                                                                                \
+      _pin_event_queue[_ev_head].port  = P##port;                                           \
+      _pin_event_queue[_ev_head].flags = _ev_flags;                                         \
+      _pin_event_queue[_ev_head].time  = _ev_time;                                          \
+      _pin_event_head = _ev_next;                                                           \
+    }                                                                                       \
+  }
+
+#define COUNTED_PORT_ISR(port)                                                              \
+  ISR(PORT##port##_PORT_vect) {                                                             \
+    uint8_t _ev_flags    = VPORT##port.INTFLAGS;                                            \
+    VPORT##port.INTFLAGS = _ev_flags;                                                       \
+    volatile uint16_t *_ev_count = &_pin_event_counts[P##port * 8];                         \
+    do {                                                                                    \
+      if (_ev_flags & 1) {                                                                  \
+        (*_ev_count)++;                                                                     \
+      }                                                                                     \
+      _ev_count++;                                                                          \
+      _ev_flags >>= 1;                                                                      \
+    } while (_ev_flags);                                                                    \
+  }
+
+/* attachInterrupt() with the pins and functions fixed when the sketch is compiled - a vector only for the ports it's
+ * used on, no table of pointers in RAM, and each flag tested and its function called directly, in the order given:
+ *
+ * ATTACHED_PORT_ISR(A, ATTACH_PIN(1, onPA1) ATTACH_PIN(6, onPA6))
+ *
+ * Then enable the pins with attachInterruptFast(). Functions the compiler can inline (static, and defined before the
+ * ISR) are, so only the registers they use are saved. */
+#define ATTACH_PIN(bit, func)                                                               \
+    if (_attach_flags & (1 << (bit))) {                                                     \
+      func();                                                                               \
+    }
+
+#define ATTACHED_PORT_ISR(port, pins)                                                       \
+  ISR(PORT##port##_PORT_vect) {                                                             \
+    uint8_t _attach_flags = VPORT##port.INTFLAGS;                                           \
+    VPORT##port.INTFLAGS  = _attach_flags;                                                  \
+    pins                                                                                    \
+  }
+
 
 #ifdef __cplusplus
 } // extern "C"
@@ -425,11 +808,229 @@ extern const uint8_t digital_pin_to_timer[];
   int32_t analogReadEnh(uint8_t pin,              uint8_t res = ADC_NATIVE_RESOLUTION, uint8_t gain = 0);
   int32_t analogReadDiff(uint8_t pos, uint8_t neg, uint8_t res = ADC_NATIVE_RESOLUTION, uint8_t gain = 0);
   int16_t analogClockSpeed(int16_t frequency = 0, uint8_t options = 0);
+  bool    toneHW(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+  // Fast 16-bit xorshift random numbers - see WMath.cpp. Ranges are howsmall to howbig - 1, like random()'s.
+  uint8_t  random8();
+  uint8_t  random8(uint8_t howbig);
+  uint8_t  random8(uint8_t howsmall, uint8_t howbig);
+  uint16_t random16();
+  uint16_t random16(uint16_t howbig);
+  uint16_t random16(uint16_t howsmall, uint16_t howbig);
+  uint32_t randomSeedHardware();      // seeds random() and random8/16() from ADC noise and clock jitter
 #endif
 
 // Include the variants
 #include "pins_arduino.h"
 
+#if defined(PORTC_PINS)
+  #define PINS_ALL          ((uint32_t)PORTA_PINS | ((uint32_t)PORTB_PINS << 8) | ((uint32_t)PORTC_PINS << 16))
+#elif defined(PORTB_PINS)
+  #define PINS_ALL          ((uint32_t)PORTA_PINS | ((uint32_t)PORTB_PINS << 8))
+#else
+  #define PINS_ALL          ((uint32_t)PORTA_PINS)
+#endif
+
+#ifdef __cplusplus
+  /* Set the pin's interrupt sense for use with FAST_PIN_ISR()/FAST_PORT_ISR(). The pin is a template parameter so
+   * that it's always a compile time constant, and this is just a couple of instructions. */
+  template <uint8_t pin> inline __attribute__((always_inline)) void attachInterruptFast(uint8_t mode) {
+    static_assert(pin < NUM_TOTAL_PINS, "attachInterruptFast() requires a valid pin");
+    uint8_t isc;
+    switch (mode) {
+      case CHANGE:
+        isc = PORT_ISC_BOTHEDGES_gc;
+        break;
+      case FALLING:
+        isc = PORT_ISC_FALLING_gc;
+        break;
+      case RISING:
+        isc = PORT_ISC_RISING_gc;
+        break;
+      case LOW:
+        isc = PORT_ISC_LEVEL_gc;
+        break;
+      default:
+        return;
+    }
+    volatile uint8_t *pinctrl = &(digitalPinToPortStruct(pin)->PIN0CTRL) + digitalPinToBitPosition(pin);
+    *pinctrl = (*pinctrl & ~PORT_ISC_gm) | isc;
+  }
+  template <uint8_t pin> inline __attribute__((always_inline)) void detachInterruptFast() {
+    static_assert(pin < NUM_TOTAL_PINS, "detachInterruptFast() requires a valid pin");
+    volatile uint8_t *pinctrl = &(digitalPinToPortStruct(pin)->PIN0CTRL) + digitalPinToBitPosition(pin);
+    *pinctrl &= ~PORT_ISC_gm;
+  }
+
+  /* Exactly cycles clocks, from instructions the compiler picks for that count - for bit timing that has to be right
+   * to the clock. Any interrupt meanwhile makes it longer by however long the ISR took, so it's for code that runs
+   * with interrupts off; with them on, delayPrecise() is the one that keeps time. */
+  template <uint32_t cycles> inline __attribute__((always_inline)) void delayCycles() {
+    __builtin_avr_delay_cycles(cycles);
+  }
+
+  /* Pins as types, for when the pin is known when the sketch is written - this is digitalWriteFast() and
+   * pinModeFast() without having to be careful to only ever pass them constants:
+   *   typedef Pin<PIN_PA3> Led;
+   *   Led::output(); Led::high(); Led::toggle(); if (Led::read()) {...}
+   * high(), low() and toggle() are one SBI or CBI on the VPORT. PortGroup<pins...> is a set of pins on the same port,
+   * changed together with a single write to OUTSET, OUTCLR or OUTTGL (or DIRSET/DIRCLR):
+   *   typedef PortGroup<PIN_PA4, PIN_PA5, PIN_PA6, PIN_PA7> LcdData;
+   *   LcdData::output(); LcdData::write(nibble << 4);
+   * write() takes the bits in their positions on the port (only the group's are changed), and is one store to
+   * VPORT.OUT if the group is the whole port, otherwise an OUTCLR then an OUTSET - two single cycle stores that can't
+   * clobber another pin an interrupt changes in between. Invalid pins, or a group spread across more than one port,
+   * are compile errors. */
+  template <uint8_t pin> class Pin {
+      static_assert(pin < NUM_TOTAL_PINS, "Pin<> requires a valid pin");
+    public:
+      static inline __attribute__((always_inline)) uint8_t mask() {
+        return digital_pin_to_bit_mask[pin];
+      }
+      static inline __attribute__((always_inline)) VPORT_t *vport() {
+        return (VPORT_t *)(digital_pin_to_port[pin] * 4);
+      }
+      static inline __attribute__((always_inline)) volatile uint8_t &pinctrl() {
+        return *(&(digitalPinToPortStruct(pin)->PIN0CTRL) + digital_pin_to_bit_position[pin]);
+      }
+      static inline __attribute__((always_inline)) void high() {
+        vport()->OUT |= mask();
+      }
+      static inline __attribute__((always_inline)) void low() {
+        vport()->OUT &= ~mask();
+      }
+      static inline __attribute__((always_inline)) void toggle() {
+        vport()->IN |= mask();
+      }
+      static inline __attribute__((always_inline)) void write(bool value) {
+        if (value) {
+          high();
+        } else {
+          low();
+        }
+      }
+      static inline __attribute__((always_inline)) bool read() {
+        return vport()->IN & mask();
+      }
+      static inline __attribute__((always_inline)) void output() {
+        vport()->DIR |= mask();
+      }
+      static inline __attribute__((always_inline)) void input() {
+        vport()->DIR &= ~mask();
+        pinctrl() &= ~PORT_PULLUPEN_bm;
+      }
+      static inline __attribute__((always_inline)) void inputPullup() {
+        vport()->DIR &= ~mask();
+        pinctrl() |= PORT_PULLUPEN_bm;
+      }
+  };
+  template <uint8_t first, uint8_t... rest> class PortGroup {
+      static_assert(first < NUM_TOTAL_PINS && ((rest < NUM_TOTAL_PINS) && ... && true), "PortGroup<> requires valid pins");
+    public:
+      static inline __attribute__((always_inline)) uint8_t mask() {
+        if (!((digital_pin_to_port[rest] == digital_pin_to_port[first]) && ... && true)) {
+          badArg("All the pins in a PortGroup must be on the same port");
+        }
+        return (digital_pin_to_bit_mask[first] | ... | digital_pin_to_bit_mask[rest]);
+      }
+      static inline __attribute__((always_inline)) PORT_t *port() {
+        return (PORT_t *)&PORTA + digital_pin_to_port[first];
+      }
+      static inline __attribute__((always_inline)) VPORT_t *vport() {
+        return (VPORT_t *)(digital_pin_to_port[first] * 4);
+      }
+      static inline __attribute__((always_inline)) void high() {
+        port()->OUTSET = mask();
+      }
+      static inline __attribute__((always_inline)) void low() {
+        port()->OUTCLR = mask();
+      }
+      static inline __attribute__((always_inline)) void toggle() {
+        port()->OUTTGL = mask();
+      }
+      static inline __attribute__((always_inline)) void write(uint8_t value) {
+        if (mask() == 0xFF) {
+          vport()->OUT = value;
+        } else {
+          port()->OUTCLR = mask() & ~value;
+          port()->OUTSET = mask() & value;
+        }
+      }
+      static inline __attribute__((always_inline)) uint8_t read() {
+        return vport()->IN & mask();
+      }
+      static inline __attribute__((always_inline)) void output() {
+        port()->DIRSET = mask();
+      }
+      static inline __attribute__((always_inline)) void input() {
+        port()->DIRCLR = mask();
+      }
+  };
+
+  /* analogReadEnh(pin, bits) with everything worked out at compile time: bits must be more than the native resolution,
+   * and up to ADC_MAX_OVERSAMPLED_RESOLUTION. 4^(bits - native) samples are accumulated, and the sum is rightshifted
+   * (bits - native) places. The pin and settings are checked when it's compiled, and nothing is checked at runtime -
+   * so the ADC must be enabled, and not busy. The 2-series can also put it through the PGA, and read differentially
+   * with analogReadDiffOversampled<pos, neg, bits, gain>(); same negative inputs as analogReadDiff(). */
+  template <uint8_t pin> constexpr uint8_t _analogMuxOf() {
+    return (pin & 0x80) ? (pin & 0x3F) : digitalPinToAnalogInput(pin);
+  }
+  template <uint8_t muxpos, uint8_t muxneg, uint8_t bits, uint8_t gain>
+  inline __attribute__((always_inline)) int32_t _analogReadOversampled() {
+    static_assert(bits > ADC_NATIVE_RESOLUTION && bits <= ADC_MAX_OVERSAMPLED_RESOLUTION,
+                  "Oversampled resolution must be more than the native resolution, and at most ADC_MAX_OVERSAMPLED_RESOLUTION");
+    constexpr uint8_t extra   = bits - ADC_NATIVE_RESOLUTION;
+    constexpr uint8_t sampnum = extra << 1;
+    #if MEGATINYCORE_SERIES == 2
+      static_assert(muxpos <= NUM_ANALOG_INPUTS || (muxpos >= 0x30 && muxpos <= 0x33), "Invalid analog pin or channel");
+      static_assert(gain == 0 || gain == 1 || gain == 2 || gain == 4 || gain == 8 || gain == 16,
+                    "The requested gain is not available on this part, accepted values are 0, 1, 2, 4, 8 and 16.");
+      constexpr uint8_t via     = gain ? ADC_VIA_PGA_gc : 0;
+      constexpr uint8_t gainbits = (gain >= 16 ? 4 : gain >= 8 ? 3 : gain >= 4 ? 2 : gain >= 2 ? 1 : 0) << ADC_GAIN_gp;
+      if (gain) {
+        ADC0.PGACTRL = (ADC0.PGACTRL & ~ADC_GAIN_gm) | gainbits | ADC_PGAEN_bm;
+      }
+      ADC0.MUXPOS  = muxpos | via;
+      if (muxneg != 0xFF) {
+        static_assert(muxneg == 0xFF || muxneg <= 0x07 || muxneg == 0x30 || muxneg == 0x31 || muxneg == 0x33,
+                      "Invalid negative pin - valid options are ADC_GROUND, ADC_VDDDIV10, ADC_DACREF0, or any pin on PORTA.");
+        ADC0.MUXNEG = muxneg | via;
+      }
+      ADC0.CTRLF   = sampnum;
+      ADC0.COMMAND = (muxneg != 0xFF ? ADC_DIFF_bm : 0) | ADC_MODE_BURST_gc | ADC_START_IMMEDIATE_gc;
+      while (!(ADC0.INTFLAGS & ADC_RESRDY_bm));
+      int32_t result = (int32_t) ADC0.RESULT;
+      if (gain) {
+        ADC0.PGACTRL &= ~ADC_PGAEN_bm;
+      }
+      return result >> extra;
+    #else
+      static_assert(gain == 0, "This part does not have an amplifier, gain argument must be omitted or given as 0");
+      static_assert(muxpos <= 0x1F, "Invalid analog pin or channel");
+      uint8_t _ctrla = ADC0.CTRLA;
+      ADC0.CTRLA   = _ctrla & ~ADC_RESSEL_bm;
+      ADC0.MUXPOS  = muxpos;
+      ADC0.CTRLB   = sampnum;
+      ADC0.COMMAND = ADC_STCONV_bm;
+      while (!(ADC0.INTFLAGS & ADC_RESRDY_bm));
+      int32_t result = ADC0.RES;
+      ADC0.CTRLB   = 0;
+      ADC0.CTRLA   = _ctrla;
+      result >>= extra - 1;                          // rounded, as analogReadEnh() does.
+      return (result >> 1) + (result & 0x01);
+    #endif
+  }
+  template <uint8_t pin, uint8_t bits, uint8_t gain = 0>
+  inline __attribute__((always_inline)) int32_t analogReadOversampled() {
+    return _analogReadOversampled<_analogMuxOf<pin>(), 0xFF, bits, gain>();
+  }
+  #if MEGATINYCORE_SERIES == 2
+    template <uint8_t pos, uint8_t neg, uint8_t bits, uint8_t gain = 0>
+    inline __attribute__((always_inline)) int32_t analogReadDiffOversampled() {
+      return _analogReadOversampled<_analogMuxOf<pos>(), _analogMuxOf<neg>(), bits, gain>();
+    }
+  #endif
+#endif
+
 // Based on those, some ugly formulae for "smart-pin" defines that follow the mux regs around:
 
 
@@ -483,6 +1084,17 @@ static const uint8_t SCK  = PIN_SPI_SCK;
 #endif
 
 
+/* All the flash is mapped into the data space on these parts (__AVR_ARCH__ 103), and the toolchain's linker script
+ * leaves .rodata in it, so a plain const is read from flash with ld and never copied to RAM, no PROGMEM needed.
+ * MAPPED_PROGMEM is DxCore's way of getting that on parts where only part of the flash is mapped; here it's empty,
+ * so code written for it (or for both cores) works unchanged. */
+#if !defined(MAPPED_PROGMEM)
+  #define MAPPED_PROGMEM
+#endif
+#if defined(__AVR_RODATA_IN_RAM__) && __AVR_RODATA_IN_RAM__
+  #warning "-mrodata-in-ram is copying all const data to RAM, which these parts have no need for - remove it."
+#endif
+
 #ifndef SUPPORT_LONG_TONES
   #if (PROGMEM_SIZE > 8192)
     #define SUPPORT_LONG_TONES 1
@@ -0,0 +1,82 @@
+/* Tasks.c - a cooperative scheduler for stackless tasks, run from yield()
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The tasks are protothreads: each is a function that carries on from where it last stopped (task->line, see the
+ * TASK_ macros in Arduino.h), and returns as soon as it has to wait, so they all share the one stack. This file
+ * replaces the weak, empty yield() in hooks.c with one that gives each task a turn; delay() and Serial call it while
+ * they wait, so the time they'd spend spinning goes to the tasks instead, and a loop() that never waits calls it
+ * itself. Like the timer service, it's only linked in if the sketch calls taskAdd(), so without tasks, yield() stays
+ * empty.
+ *
+ * When a round of the tasks gets nowhere - every one of them still waiting on the same thing as last time - nothing
+ * will be any different until an interrupt changes something, so we sleep in idle until one comes. The millis
+ * interrupt comes every millisecond, so that's as late as a TASK_DELAY(), or a delay(), can end up. With the RTC
+ * there's no such tick to wake us, so we don't sleep; delay() sleeps on its own there.
+ */
+
+#include "wiring_private.h"
+
+uint8_t deferDispatch() __attribute__((weak));  // see hooks.c
+
+static task_t  *_tasks;
+static uint8_t  _tasks_running;   // yield() from within a task (from a delay() in it, say) mustn't run them again.
+
+void taskAdd(task_t *task, uint8_t (*func)(task_t *)) {
+  taskRemove(task);
+  task->func = func;
+  task->line = 0;
+  task->next = NULL;
+  uint8_t oldSREG = SREG;
+  cli();
+  task_t **link = &_tasks;
+  while (*link) {             // at the end, so they run in the order they were added
+    link = &(*link)->next;
+  }
+  *link = task;
+  SREG = oldSREG;
+}
+
+/* task->next is left alone, so a task can remove itself and the round carries on from the one after it. */
+void taskRemove(task_t *task) {
+  uint8_t oldSREG = SREG;
+  cli();
+  for (task_t **link = &_tasks; *link; link = &(*link)->next) {
+    if (*link == task) {
+      *link = task->next;
+      break;
+    }
+  }
+  SREG = oldSREG;
+}
+
+void yield(void) {
+  // Never from an ISR, or anything else with interrupts off: it's the interrupts that make the tasks ready.
+  if (_tasks_running || !(SREG & CPU_I_bm)) {
+    return;
+  }
+  _tasks_running = 1;
+  uint8_t ran  = TASK_WAITING;
+  task_t *task = _tasks;
+  while (task) {
+    uint8_t result = task->func(task);
+    task_t *next   = task->next;  // after the call, in case it removed the task after it
+    if (result == TASK_ENDED) {
+      taskRemove(task);
+    }
+    ran  |= result;
+    task  = next;
+  }
+  _tasks_running = 0;
+  if (deferDispatch && deferDispatch()) {
+    ran = TASK_RAN;           // something else may be ready now
+  }
+  #if !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERNONE)
+    if (ran == TASK_WAITING && _tasks) {
+      uint8_t slpctrl = SLPCTRL.CTRLA;
+      SLPCTRL.CTRLA   = SLPCTRL_SMODE_IDLE_gc | SLPCTRL_SEN_bm;
+      __asm__ __volatile__ ("sleep");
+      SLPCTRL.CTRLA   = slpctrl;
+    }
+  #endif
+}
@@ -0,0 +1,171 @@
+/* TimerService.c - software timers run from the millis timer interrupt
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * This file replaces the (weak) millis ISR in wiring.c with one that, after doing the timekeeping, checks whether a
+ * timer is due. That check is a single 32-bit compare against the earliest due time; the table is only scanned when
+ * something actually comes due. Since this file is only linked in if the sketch calls one of these functions, sketches
+ * that don't use it pay nothing, not even the extra registers the ISR would have to save to be able to call out.
+ *
+ * Callbacks run from the ISR unless TIMER_DEFERRED is given, in which case the ISR just marks them due, and they run
+ * the next time the sketch calls timerDispatch() - so the time spent in the millis ISR stays short, no matter what the
+ * callbacks do.
+ */
+
+#include "wiring_private.h"
+
+#if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+
+#if !defined(TIMER_SERVICE_SLOTS)
+  #define TIMER_SERVICE_SLOTS 8
+#endif
+#if TIMER_SERVICE_SLOTS > 8
+  #error "TIMER_SERVICE_SLOTS can't be more than 8 - the deferred timers that are due are kept in a single byte."
+#endif
+
+#define TIMER_ARMED 0x80
+
+typedef struct {
+  voidFuncPtr callback;   // NULL when the slot is free.
+  uint32_t    due;        // millis() value it is due at
+  uint16_t    period;
+  uint8_t     flags;      // TIMER_PERIODIC, TIMER_DEFERRED, TIMER_ARMED
+} _timer_slot_t;
+
+static _timer_slot_t     _timer_slots[TIMER_SERVICE_SLOTS];
+static volatile uint32_t _timer_next_due;
+static volatile uint8_t  _timer_active;  // any slot armed?
+static volatile uint8_t  _timer_pending; // one bit per slot - deferred timers that are due.
+
+/* Find the earliest due time among the armed slots. Call with interrupts off. */
+static void _timer_find_next(uint32_t now) {
+  uint32_t soonest = 0xFFFFFFFF;
+  uint8_t  active  = 0;
+  for (uint8_t i = 0; i < TIMER_SERVICE_SLOTS; i++) {
+    if (_timer_slots[i].flags & TIMER_ARMED) {
+      uint32_t left = _timer_slots[i].due - now;
+      if ((int32_t) left < 0) {
+        left = 0;
+      }
+      if (left < soonest) {
+        soonest = left;
+      }
+      active = 1;
+    }
+  }
+  _timer_next_due = now + soonest;
+  _timer_active   = active;
+}
+
+static void _timer_run(uint32_t now) {
+  for (uint8_t i = 0; i < TIMER_SERVICE_SLOTS; i++) {
+    _timer_slot_t *slot = &_timer_slots[i];
+    if ((slot->flags & TIMER_ARMED) && (int32_t)(now - slot->due) >= 0) {
+      if (slot->flags & TIMER_PERIODIC) {
+        slot->due += slot->period;
+        if ((int32_t)(now - slot->due) >= 0) { // we fell more than a period behind - don't try to catch up.
+          slot->due = now + slot->period;
+        }
+      } else {
+        slot->flags &= ~TIMER_ARMED;
+      }
+      if (slot->flags & TIMER_DEFERRED) {
+        _timer_pending |= (1 << i);
+      } else {
+        voidFuncPtr callback = slot->callback;
+        if (!(slot->flags & TIMER_ARMED)) {
+          slot->callback = NULL;  // one-shot is done with the slot.
+        }
+        callback();
+      }
+    }
+  }
+  _timer_find_next(now); // after the callbacks, which may have added timers.
+}
+
+ISR(MILLIS_TIMER_VECT) {
+  ISR_TRACE_ENTER(MILLIS);
+  TRACE_ISR(MILLIS, 0);
+  _millisTick();
+  if (_timer_active) {
+    uint32_t now = timer_millis;
+    if ((int32_t)(now - _timer_next_due) >= 0) {
+      _timer_run(now);
+    }
+  }
+  ISR_TRACE_EXIT(MILLIS);
+}
+
+int8_t timerAdd(voidFuncPtr callback, uint16_t ms, uint8_t mode) {
+  if (!callback) {
+    return -1;
+  }
+  if (!ms) {
+    ms = 1;
+  }
+  int8_t id = -1;
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < TIMER_SERVICE_SLOTS; i++) {
+    _timer_slot_t *slot = &_timer_slots[i];
+    if (!slot->callback) {
+      uint32_t now   = timer_millis;
+      slot->callback = callback;
+      slot->period   = ms;
+      slot->due      = now + ms;
+      slot->flags    = (mode & (TIMER_PERIODIC | TIMER_DEFERRED)) | TIMER_ARMED;
+      _timer_find_next(now);
+      id = i;
+      break;
+    }
+  }
+  SREG = oldSREG;
+  return id;
+}
+
+void timerCancel(int8_t id) {
+  if ((uint8_t) id >= TIMER_SERVICE_SLOTS) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _timer_slots[id].flags    = 0;
+  _timer_slots[id].callback = NULL;
+  _timer_pending           &= ~(1 << id);
+  // _timer_next_due is left alone - if it was this timer's, the ISR will find nothing due then and look again.
+  SREG = oldSREG;
+}
+
+void timerDispatch() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t pending = _timer_pending;
+  _timer_pending  = 0;
+  SREG = oldSREG;
+  for (uint8_t i = 0; pending; i++, pending >>= 1) {
+    if (pending & 1) {
+      cli();
+      voidFuncPtr callback = _timer_slots[i].callback;  // might have been cancelled since.
+      if (!(_timer_slots[i].flags & TIMER_ARMED)) {
+        _timer_slots[i].callback = NULL;                // one-shot is done with the slot.
+      }
+      SREG = oldSREG;
+      if (callback) {
+        callback();
+      }
+    }
+  }
+}
+
+#else
+  int8_t timerAdd(__attribute__((unused)) voidFuncPtr callback, __attribute__((unused)) uint16_t ms, __attribute__((unused)) uint8_t mode) {
+    badCall("timerAdd() requires millis, and can't use the RTC (it only interrupts every 64 seconds)");
+    return -1;
+  }
+  void timerCancel(__attribute__((unused)) int8_t id) {
+    badCall("timerCancel() requires millis, and can't use the RTC (it only interrupts every 64 seconds)");
+  }
+  void timerDispatch() {
+    badCall("timerDispatch() requires millis, and can't use the RTC (it only interrupts every 64 seconds)");
+  }
+#endif
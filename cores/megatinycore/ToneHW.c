@@ -0,0 +1,213 @@
+/* ToneHW.c - square waves from a TCB's own output pin, with no interrupts
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * tone() (Tone.cpp) toggles the pin from the TCB interrupt, twice per period, so at high frequencies it takes a lot of
+ * CPU time, and the edges move whenever another interrupt delays it. toneHW() instead runs the TCB in 8-bit PWM mode
+ * at 50% duty cycle, so the timer drives its WO pin itself - nothing runs per half period, and there's no jitter. The
+ * price is that it only works on a TCB's WO pin, and the period is at most 256 ticks of one of the clocks a TCB can
+ * use (CLK_PER, CLK_PER/2, or TCA0's prescaled clock), so lower frequencies need TCA0's prescaler, and the frequency is
+ * only as exact as a whole number of ticks allows. Each TCB that isn't used for millis can play one voice at once.
+ *
+ * If a duration is given, the tone is stopped by the timer service (TimerService.c), not by counting periods.
+ *
+ * No ISRs are defined here. The TCBs that tone() and Servo use are in use while they are, though, so don't play a
+ * toneHW() voice on one of them at the same time.
+ */
+
+#include "wiring_private.h"
+
+#if defined(TCB1)
+  #define _TONE_HW_VOICES 2
+#else
+  #define _TONE_HW_VOICES 1
+#endif
+
+#if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+  #define _TONE_HW_DURATION     // the timer service is available.
+#endif
+
+static uint8_t _tone_hw_pin[_TONE_HW_VOICES];     // pin + 1, so 0 is no pin.
+#if defined(_TONE_HW_DURATION)
+  static int8_t _tone_hw_timer[_TONE_HW_VOICES];  // timer service id + 1, so 0 is none.
+#endif
+
+/* Which TCB has its WO on this pin, with 0x80 set if it's the alternate pin - or NOT_A_PIN. */
+static uint8_t _tone_hw_voice(uint8_t pin) {
+  #if !defined(MILLIS_USE_TIMERB0)
+    #if _AVR_PINCOUNT == 8
+      if (pin == PIN_PA6) {
+        return 0x00;
+      }
+      if (pin == PIN_PA7) {
+        return 0x80;
+      }
+    #else
+      if (pin == PIN_PA5) {
+        return 0x00;
+      }
+      #if defined(PIN_PC0) && MEGATINYCORE_SERIES != 2
+        if (pin == PIN_PC0) {
+          return 0x80;
+        }
+      #endif
+    #endif
+  #endif
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    if (pin == PIN_PA3) {
+      return 0x01;
+    }
+    #if defined(PIN_PC4) && MEGATINYCORE_SERIES != 2
+      if (pin == PIN_PC4) {
+        return 0x81;
+      }
+    #endif
+  #endif
+  (void) pin;
+  return NOT_A_PIN;
+}
+
+static inline TCB_t *_tone_hw_tcb(uint8_t voice) {
+  #if defined(TCB1)
+    if (voice) {
+      return &TCB1;
+    }
+  #endif
+  (void) voice;
+  return &TCB0;
+}
+
+static void _tone_hw_stop(uint8_t voice) {
+  TCB_t *tcb = _tone_hw_tcb(voice);
+  tcb->CTRLA = 0;
+  tcb->CTRLB = 0;                               // WO goes back to the PORT, which drives it low.
+  tcb->CNT   = 0;
+  _tone_hw_pin[voice] = 0;
+}
+
+#if defined(_TONE_HW_DURATION)
+  static void _tone_hw_end0() {
+    _tone_hw_timer[0] = 0;
+    _tone_hw_stop(0);
+  }
+  #if _TONE_HW_VOICES > 1
+    static void _tone_hw_end1() {
+      _tone_hw_timer[1] = 0;
+      _tone_hw_stop(1);
+    }
+  #endif
+#endif
+
+bool toneHW(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  uint8_t voice = _tone_hw_voice(pin);
+  if (voice == NOT_A_PIN) {
+    return false;
+  }
+  uint8_t alt = voice & 0x80;
+  voice &= 0x01;
+  if (!frequency) {
+    noToneHW(pin);
+    return true;
+  }
+  #if defined(_TONE_HW_DURATION)
+    if (duration > 0xFFFF) {
+      return false;                             // the timer service counts in 16 bits of ms.
+    }
+  #else
+    if (duration) {
+      return false;                             // no timer service without millis.
+    }
+  #endif
+  /* Try the clocks fastest first - the faster it is, the closer the period can get to the requested one. */
+  uint8_t  clksel = TCB_CLKSEL_DIV1_gc;
+  uint32_t period = (F_CPU + (frequency >> 1)) / frequency;
+  if (period > 256) {
+    clksel = TCB_CLKSEL_DIV2_gc;
+    period = ((F_CPU >> 1) + (frequency >> 1)) / frequency;
+  }
+  if (period > 256) {
+    if (!(TCA0.SPLIT.CTRLA & TCA_SPLIT_ENABLE_bm)) {
+      return false;                             // someone took over TCA0 and turned it off.
+    }
+    static const uint8_t tca_shift[8] = {0, 1, 2, 3, 4, 6, 8, 10};
+    uint32_t clk_tca = F_CPU >> tca_shift[(TCA0.SPLIT.CTRLA & TCA_SPLIT_CLKSEL_gm) >> TCA_SPLIT_CLKSEL_gp];
+    clksel = TCB_CLKSEL_TCA0_gc;
+    period = (clk_tca + (frequency >> 1)) / frequency;
+  }
+  if (period > 256 || period < 2) {
+    return false;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_tone_hw_pin[voice] && _tone_hw_pin[voice] != pin + 1) {
+    _tone_hw_stop(voice);                       // this TCB was playing on its other pin.
+  }
+  #if defined(_TONE_HW_DURATION)
+    if (_tone_hw_timer[voice]) {
+      timerCancel(_tone_hw_timer[voice] - 1);
+      _tone_hw_timer[voice] = 0;
+    }
+  #endif
+  #if MEGATINYCORE_SERIES != 2
+    uint8_t muxbit = voice ? PORTMUX_TCB1_bm : PORTMUX_TCB0_bm;
+    if (alt) {
+      PORTMUX.CTRLD |= muxbit;
+    } else {
+      PORTMUX.CTRLD &= ~muxbit;
+    }
+  #else
+    (void) alt;
+  #endif
+  TCB_t *tcb  = _tone_hw_tcb(voice);
+  if (_tone_hw_pin[voice]) {
+    tcb->CTRLA = 0;                             // stop it while the period changes, or the compare could be missed
+  } else {
+    digitalWrite(pin, LOW);                     // never leave a speaker driven high.
+    pinMode(pin, OUTPUT);
+  }
+  tcb->CCMPL  = period - 1;
+  tcb->CCMPH  = period >> 1;                    // the low byte has to be written first.
+  tcb->CNT    = 0;
+  tcb->CTRLB  = TCB_CCMPEN_bm | TCB_CNTMODE_PWM8_gc;
+  tcb->CTRLA  = clksel | TCB_ENABLE_bm;
+  _tone_hw_pin[voice] = pin + 1;
+  #if defined(_TONE_HW_DURATION)
+    if (duration) {
+      #if _TONE_HW_VOICES > 1
+        int8_t id = timerAdd(voice ? _tone_hw_end1 : _tone_hw_end0, duration, TIMER_ONESHOT);
+      #else
+        int8_t id = timerAdd(_tone_hw_end0, duration, TIMER_ONESHOT);
+      #endif
+      if (id < 0) {
+        _tone_hw_stop(voice);
+        SREG = oldSREG;
+        return false;                           // no free timer slot.
+      }
+      _tone_hw_timer[voice] = id + 1;
+    }
+  #else
+    (void) duration;
+  #endif
+  SREG = oldSREG;
+  return true;
+}
+
+void noToneHW(uint8_t pin) {
+  uint8_t voice = _tone_hw_voice(pin);
+  if (voice == NOT_A_PIN) {
+    return;
+  }
+  voice &= 0x01;
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_tone_hw_pin[voice] == pin + 1) {
+    #if defined(_TONE_HW_DURATION)
+      if (_tone_hw_timer[voice]) {
+        timerCancel(_tone_hw_timer[voice] - 1);
+        _tone_hw_timer[voice] = 0;
+      }
+    #endif
+    _tone_hw_stop(voice);
+  }
+  SREG = oldSREG;
+}
@@ -25,12 +25,19 @@
 
 #if defined(HAVE_HWSERIAL0) || defined(HAVE_HWSERIAL1) || defined(HAVE_HWSERIAL2) || defined(HAVE_HWSERIAL3)
   // macro to guard critical sections when needed for large TX buffer sizes
-  #if (SERIAL_TX_BUFFER_SIZE > 256)
+  #if defined(SERIAL_BIG_TX_BUFFER)
     #define TX_BUFFER_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
   #else
     #define TX_BUFFER_ATOMIC
   #endif
 
+  // RS-485 driver enable pins, read by the TXC ISR - see setRS485Pin().
+  #if defined(USART1)
+    uart_de_t _usart_de[2];
+  #else
+    uart_de_t _usart_de[1];
+  #endif
+
 /*##  ###  ####
   #  #     #   #
   #   ###  ####
@@ -96,6 +103,35 @@ ISR(USART1_TXC_vect, ISR_NAKED) {
         "andi     r24,     0xBF"  "\n\t"  // clear TXCIE
         "ori      r24,     0x80"  "\n\t"  // set RXCIE
         "std   Z +  5,      r24"  "\n\t"  // store CTRLA
+        "mov      r24,      r30"  "\n\t"  // 0x00 or 0x20 - which USART this is.
+        "ldi      r30, lo8(_usart_de)" "\n\t" // Z = &_usart_de[0]
+        "ldi      r31, hi8(_usart_de)" "\n\t" //
+#if defined(USART1)
+        "sbrc     r24,        5"  "\n\t"  // if this is USART1
+        "adiw     r30,        5"  "\n\t"  // move to _usart_de[1] - sizeof(uart_de_t) is 5.
+#endif
+        "ld       r24,        Z"  "\n\t"  // mask of the driver enable pin, if any
+        "tst      r24"            "\n\t"  //
+        "breq     _txc_done"      "\n\t"  // none - we're done.
+        "push     r25"            "\n\t"  // otherwise we need 3 more registers.
+        "push     r26"            "\n\t"  //
+        "push     r27"            "\n\t"  //
+        "ldd      r26,   Z +  1"  "\n\t"  // X = &PORTx.OUTCLR
+        "ldd      r27,   Z +  2"  "\n\t"  //
+        "ldd      r25,   Z +  3"  "\n\t"  // guard time, low byte, then
+        "ldd      r31,   Z +  4"  "\n\t"  // high byte straight into Z, since we're done with the table
+        "mov      r30,      r25"  "\n\t"  //
+        "sbiw     r30,        0"  "\n\t"  // test for zero
+        "breq     _txc_release"   "\n\t"  //
+      "_txc_guard:"               "\n\t"  // 4 clocks per iteration, same as _delay_loop_2().
+        "sbiw     r30,        1"  "\n\t"  //
+        "brne     _txc_guard"     "\n\t"  //
+      "_txc_release:"             "\n\t"  //
+        "st         X,      r24"  "\n\t"  // OUTCLR = mask; releases the bus.
+        "pop      r27"            "\n\t"  //
+        "pop      r26"            "\n\t"  //
+        "pop      r25"            "\n\t"  //
+      "_txc_done:"                "\n\t"  //
         "pop      r24"            "\n\t"  // pop r24, xcontaining old sreg.
         "out     0x3f,      r24"  "\n\t"  // restore it
         "pop      r24"            "\n\t"  // pop r24 to get it's old value back
@@ -120,7 +156,7 @@ ISR(USART1_TXC_vect, ISR_NAKED) {
   }
 
 */
-#if (USE_ASM_RXC == 1 && (SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) )
+#if USE_ASM_RXC == 1
   void __attribute__((naked)) __attribute__((used)) __attribute__((noreturn)) _do_rxc(void) {
     __asm__ __volatile__(
       "_do_rxc:"                      "\n\t" //
@@ -136,32 +172,43 @@ ISR(USART1_TXC_vect, ISR_NAKED) {
         "ldi        r29,      0x08"   "\n\t" // High byte always 0x08 for USART peripheral: Save-a-clock.
         "ldd        r24,    Y +  1"   "\n\t" // Y + 1 = USARTn.RXDATAH - load high byte first
         "ld         r25,         Y"   "\n\t" // Y + 0 = USARTn.RXDATAH - then low byte of RXdata
-        "sbrc       r24,         1"   "\n\t" // if there's a parity error, then do nothing more. Copies the behavior of
-        "rjmp  _end_rxc"              "\n\t" // stock implementation - framing errors are ok, apparently...
+        "sbrc       r24,         0"   "\n\t" // DATA8 - an address, which is only possible with SERIAL_MPCM.
+        "rjmp  _rxc_special"          "\n\t" // Once per message at most, so it's out of line, in C.
+        "ldd        r18,    Z + 16"   "\n\t" // _state
+        "sbrc       r18,         5"   "\n\t" // DMX receive - every character goes to the universe buffer, in C.
+        "rjmp  _rxc_special"          "\n\t" //
+        "mov        r18,       r24"   "\n\t" //
+        "andi       r18,      0x46"   "\n\t" // BUFOVF, FERR or PERR set?
+        "brne  _rxc_error"            "\n\t" // Count it - that's rare, so it's out of line below.
+      "_rxc_store:"                   "\n\t" //
         "ldd        r28,    Z + 17"   "\n\t" // load current head index
         "ldi        r24,         1"   "\n\t" // Clear r24 and initialize it with 1
         "add        r24,       r28"   "\n\t" // add current head index to it
-#if   SERIAL_RX_BUFFER_SIZE == 256
-        // No additional action needed, head wraps naturally.
-#elif SERIAL_RX_BUFFER_SIZE == 128
-        "andi       r24,      0x7F"   "\n\t" // Wrap the head around
-#elif SERIAL_RX_BUFFER_SIZE == 64
-        "andi       r24,      0x3F"   "\n\t" // Wrap the head around
-#elif SERIAL_RX_BUFFER_SIZE == 32
-        "andi       r24,      0x1F"   "\n\t" // Wrap the head around
-#elif SERIAL_RX_BUFFER_SIZE == 16
-        "andi       r24,      0x0F"   "\n\t" // Wrap the head around
-#endif
+        "ldd        r18,    Z + 25"   "\n\t" // load _rx_buffer_mask
+        "and        r24,       r18"   "\n\t" // Wrap the head around
         "ldd        r18,    Z + 18"   "\n\t" // load tail index
         "cp         r18,       r24"   "\n\t" // See if head is at tail. If so, buffer full. The incoming data is discarded,
-        "breq  _end_rxc"              "\n\t" // because there is noplace to put it, and we just restore state and leave.
-        "add        r28,       r30"   "\n\t" // r28 has what would be the next index in it.
-        "mov        r29,       r31"   "\n\t" // and this is the high byte of serial instance
+        "breq  _rxc_full"             "\n\t" // because there is noplace to put it, and we just count it, restore state and leave.
+        "ldd        r18,    Z + 21"   "\n\t" // low byte of _rx_buffer
+        "add        r28,       r18"   "\n\t" // plus the old head index
+        "ldd        r29,    Z + 22"   "\n\t" // high byte of _rx_buffer
         "ldi        r18,         0"   "\n\t" // need a known zero to carry.
-        "adc        r29,       r18"   "\n\t" // carry - Y is now pointing 21 bytes before head
-        "std     Y + 21,       r25"   "\n\t" // store the new char in buffer
+        "adc        r29,       r18"   "\n\t" // carry - Y is now pointing at _rx_buffer[head]
+        "st           Y,       r25"   "\n\t" // store the new char in buffer
         "std     Z + 17,       r24"   "\n\t" // write that new head index.
       "_end_rxc:"                     "\n\t" //
+        "ldd        r18,    Z + 16"   "\n\t" // _state
+        "sbrs       r18,         3"   "\n\t" // if idle line detection is armed...
+        "rjmp  _rxc_restore"          "\n\t" //
+        "ldd        r28,    Z + 33"   "\n\t" //
+        "ldd        r29,    Z + 34"   "\n\t" // Y = _idle_timer
+        "ldi        r18,         0"   "\n\t" //
+        "std     Y + 10,       r18"   "\n\t" // Y + 10 = TCBn.CNTL - low byte first
+        "std     Y + 11,       r18"   "\n\t" // Y + 11 = TCBn.CNTH - count restarted.
+        "ld         r18,         Y"   "\n\t" // Y + 0  = TCBn.CTRLA
+        "ori        r18,         1"   "\n\t" // ENABLE, in case it was stopped after the last frame.
+        "st           Y,       r18"   "\n\t" //
+      "_rxc_restore:"                 "\n\t" //
         "pop        r29"              "\n\t" // Y Pointer was used for head and usart
         "pop        r28"              "\n\t" //
         "pop        r25"              "\n\t" // r25 held the received character
@@ -171,28 +218,110 @@ ISR(USART1_TXC_vect, ISR_NAKED) {
         "pop        r18"              "\n\t" // used as tail pointer and z known zero.
         "pop        r31"              "\n\t" // end with Z which the isr pushed to make room for
         "pop        r30"              "\n\t" // pointer to serial instance
-        "reti"                        "\n"   // return
+        ISR_TRACE_EXIT_ASM(RXC)
+        "reti"                        "\n\t" // return
+      "_rxc_error:"                   "\n\t" // r24 = RXDATAH, r25 = the character. Y is free now.
+        "sbrs       r24,         6"   "\n\t" // BUFOVF?
+        "rjmp  _rxc_chk_ferr"         "\n\t" //
+        "ldd        r28,    Z + 37"   "\n\t" // _rx_stats.hw_overflow
+        "ldd        r29,    Z + 38"   "\n\t" //
+        "adiw       r28,         1"   "\n\t" //
+        "std     Z + 37,       r28"   "\n\t" //
+        "std     Z + 38,       r29"   "\n\t" //
+      "_rxc_chk_ferr:"                "\n\t" //
+        "sbrs       r24,         2"   "\n\t" // FERR?
+        "rjmp  _rxc_chk_perr"         "\n\t" //
+        "tst        r25"              "\n\t" // a 0 with no stop bit is a break
+        "breq  _rxc_special"          "\n\t" //
+        "ldd        r28,    Z + 39"   "\n\t" // _rx_stats.framing
+        "ldd        r29,    Z + 40"   "\n\t" //
+        "adiw       r28,         1"   "\n\t" //
+        "std     Z + 39,       r28"   "\n\t" //
+        "std     Z + 40,       r29"   "\n\t" //
+      "_rxc_chk_perr:"                "\n\t" //
+        "sbrs       r24,         1"   "\n\t" // if there's no parity error, the character is kept. Copies the behavior of
+        "rjmp  _rxc_store"            "\n\t" // stock implementation - framing errors are ok, apparently...
+        "ldd        r28,    Z + 41"   "\n\t" // _rx_stats.parity
+        "ldd        r29,    Z + 42"   "\n\t" //
+        "adiw       r28,         1"   "\n\t" //
+        "std     Z + 41,       r28"   "\n\t" //
+        "std     Z + 42,       r29"   "\n\t" //
+        "rjmp  _end_rxc"              "\n\t" // and the character is discarded.
+      "_rxc_full:"                    "\n\t" //
+        "ldd        r28,    Z + 35"   "\n\t" // _rx_stats.ring_overflow
+        "ldd        r29,    Z + 36"   "\n\t" //
+        "adiw       r28,         1"   "\n\t" //
+        "std     Z + 35,       r28"   "\n\t" //
+        "std     Z + 36,       r29"   "\n\t" //
+        "rjmp  _end_rxc"              "\n\t" //
+      "_rxc_special:"                 "\n\t" // Address, break or DMX. Calling C means saving every call-used register.
+        "push        r0"              "\n\t" //
+        "push        r1"              "\n\t" //
+        "eor         r1,        r1"   "\n\t" //
+        "push       r19"              "\n\t" //
+        "push       r20"              "\n\t" //
+        "push       r21"              "\n\t" //
+        "push       r22"              "\n\t" //
+        "push       r23"              "\n\t" //
+        "push       r26"              "\n\t" //
+        "push       r27"              "\n\t" //
+        "push       r30"              "\n\t" // Z is needed afterwards, for the idle timer check
+        "push       r31"              "\n\t" //
+        "mov        r22,       r24"   "\n\t" // second argument, RXDATAH
+        "mov        r20,       r25"   "\n\t" // third, the character
+        "movw       r24,       r30"   "\n\t" // first, the UartClass
+#if PROGMEM_SIZE > 8192
+        "call  _uart_rx_special"      "\n\t" //
+#else
+        "rcall _uart_rx_special"      "\n\t" //
+#endif
+        "pop        r31"              "\n\t" //
+        "pop        r30"              "\n\t" //
+        "pop        r27"              "\n\t" //
+        "pop        r26"              "\n\t" //
+        "pop        r23"              "\n\t" //
+        "pop        r22"              "\n\t" //
+        "pop        r21"              "\n\t" //
+        "pop        r20"              "\n\t" //
+        "pop        r19"              "\n\t" //
+        "pop         r1"              "\n\t" //
+        "pop         r0"              "\n\t" //
+        "rjmp  _end_rxc"              "\n"   //
         ::);
     __builtin_unreachable();
 
   }
-#elif USE_ASM_RXC == 1
-  #warning "USE_ASM_RXC is set, but the buffer size is not supported, falling back to the classical RXC."
 #else
-  void UartClass::_rx_complete_irq(UartClass& uartClass) {
+  HOT_PATH void UartClass::_rx_complete_irq(UartClass& uartClass) {
     // if (bit_is_clear(*_rxdatah, USART_PERR_bp)) {
     uint8_t rxDataH = uartClass._hwserial_module->RXDATAH;
     uint8_t       c = uartClass._hwserial_module->RXDATAL;  // no need to read the data twice. read it, then decide what to do
+    TRACE_ISR(RXC, c);
     rx_buffer_index_t rxHead = uartClass._rx_buffer_head;
 
+    if ((rxDataH & USART_DATA8_bm) || (uartClass._state & 0x20)) { // an address (SERIAL_MPCM only), or DMX receive
+      _rx_special_irq(uartClass, rxDataH, c);
+      rxDataH = USART_PERR_bm;                // so it isn't stored
+    } else if (rxDataH & (USART_BUFOVF_bm | USART_FERR_bm | USART_PERR_bm)) {
+      if (rxDataH & USART_BUFOVF_bm) {
+        uartClass._rx_stats.hw_overflow++;
+      }
+      if ((rxDataH & USART_FERR_bm) && !c) {  // a break
+        _rx_special_irq(uartClass, rxDataH, c);
+        rxDataH = USART_PERR_bm;
+      } else {
+        if (rxDataH & USART_FERR_bm) {
+          uartClass._rx_stats.framing++;
+        }
+        if (rxDataH & USART_PERR_bm) {
+          uartClass._rx_stats.parity++;
+        }
+      }
+    }
     if (!(rxDataH & USART_PERR_bm)) {
       // No Parity error, read byte and store it in the buffer if there is room
       // unsigned char c = uartClass._hwserial_module->RXDATAL;
-      #if SERIAL_RX_BUFFER_SIZE > 256
-        rx_buffer_index_t i = (uint16_t)(rxHead + 1) % SERIAL_RX_BUFFER_SIZE;
-      #else
-        rx_buffer_index_t i = (uint8_t)(rxHead + 1) % SERIAL_RX_BUFFER_SIZE;
-      #endif
+      rx_buffer_index_t i = (rx_buffer_index_t)(rxHead + 1) & uartClass._rx_buffer_mask;
 
       // if we should be storing the received character into the location
       // just before the tail (meaning that the head would advance to the
@@ -201,8 +330,15 @@ ISR(USART1_TXC_vect, ISR_NAKED) {
       if (i != uartClass._rx_buffer_tail) {
         uartClass._rx_buffer[rxHead] = c;
         uartClass._rx_buffer_head = i;
+      } else {
+        uartClass._rx_stats.ring_overflow++;
       }
     }
+    if (uartClass._state & 8) { // idle line detection armed - restart the timer.
+      volatile TCB_t* timer = uartClass._idle_timer;
+      timer->CNT    = 0;
+      timer->CTRLA |= TCB_ENABLE_bm;
+    }
   }
 #endif
 /*
@@ -219,8 +355,7 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
 
 */
 
-#if USE_ASM_DRE == 1 && (SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) && \
-                        (SERIAL_TX_BUFFER_SIZE == 256 || SERIAL_TX_BUFFER_SIZE == 128 || SERIAL_TX_BUFFER_SIZE == 64 || SERIAL_TX_BUFFER_SIZE == 32 || SERIAL_TX_BUFFER_SIZE == 16)
+#if USE_ASM_DRE == 1
   void __attribute__((naked)) __attribute__((used)) __attribute__((noreturn)) _do_dre(void) {
     __asm__ __volatile__(
     "_do_dre:"                        "\n\t"
@@ -232,6 +367,9 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
       "push        r26"               "\n\t"
       "push        r27"               "\n\t"
       "set"                           "\n\t"  // SEt the T flag - we use this to determine how we got here and hence whether to rjmp to end of poll or reti
+      "ldd         r18,   Z + 16"     "\n\t"  // _state
+      "sbrc        r18,        2"     "\n\t"  // if we are sending from an external buffer
+      "rjmp      _ext_dre"            "\n\t"  // that's handled separately below. Polling handles it in C, so never gets here.
     "_poll_dre:"                      "\n\t"
       "push        r28"               "\n\t"
       "push        r29"               "\n\t"
@@ -240,43 +378,17 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
 //    "ldd         r29,   Z + 13"     "\n\t"  // usart in Y
       "ldi         r29,     0x08"     "\n\t"  // High byte always 0x08 for USART peripheral: Save-a-clock.
       "ldd         r25,   Z + 20"     "\n\t"  // tx tail in r25
-      "movw        r26,      r30"     "\n\t"  // copy of serial in X
-      "add         r26,      r25"     "\n\t"  // SerialN + txtail
-      "adc         r27,      r18"     "\n\t"  // X = &Serial + txtail
-#if   SERIAL_RX_BUFFER_SIZE == 256            // RX buffer determines offset start of class.
-      "subi        r26,     0xEB"     "\n\t"  // There's no addi/adci, so we instead subtract (65536-(offset we want to add))
-      "sbci        r27,     0xFE"     "\n\t"  // +277
-      "ld          r24,        X"     "\n\t"  // grab the character
-#elif SERIAL_RX_BUFFER_SIZE == 128
-      "subi        r26,     0x6B"     "\n\t"  //
-      "sbci        r27,     0xFF"     "\n\t"  // +149
+      "ldd         r26,   Z + 23"     "\n\t"  // _tx_buffer in X
+      "ldd         r27,   Z + 24"     "\n\t"  //
+      "add         r26,      r25"     "\n\t"  // _tx_buffer + txtail
+      "adc         r27,      r18"     "\n\t"  // X = &_tx_buffer[txtail]
       "ld          r24,        X"     "\n\t"  // grab the character
-#elif SERIAL_RX_BUFFER_SIZE == 64
-      "subi        r26,     0xAB"     "\n\t"  //
-      "sbci        r27,     0xFF"     "\n\t"  // +85
-      "ld          r24,        X"     "\n\t"  // grab the character
-#elif SERIAL_RX_BUFFER_SIZE == 32
-      "adiw        r26,     0x35"     "\n\t"  // +53
-      "ld          r24,        X"     "\n\t"  // grab the character
-#elif SERIAL_RX_BUFFER_SIZE == 16
-      "adiw        r26,     0x25"     "\n\t"  // +37
-      "ld          r24,        X"     "\n\t"  // grab the character
-#endif
       "ldi         r18,     0x40"     "\n\t"
       "std       Y + 4,      r18"     "\n\t" // Y + 4 = USART.STATUS - clear TXC
       "std       Y + 2,      r24"     "\n\t" // Y + 2 = USART.TXDATAL - write char
       "subi        r25,     0xFF"     "\n\t" // txtail +1
-#if   SERIAL_TX_BUFFER_SIZE == 256
-//    // No action needed to wrap the tail around -
-#elif SERIAL_TX_BUFFER_SIZE == 128
-      "andi        r25,     0x7F"     "\n\t" // Wrap the tail around
-#elif SERIAL_TX_BUFFER_SIZE == 64
-      "andi        r25,     0x3F"     "\n\t" // Wrap the tail around
-#elif SERIAL_TX_BUFFER_SIZE == 32
-      "andi        r25,     0x1F"     "\n\t" // Wrap the tail around
-#elif SERIAL_TX_BUFFER_SIZE == 16
-      "andi        r25,     0x0F"     "\n\t" // Wrap the tail around
-#endif
+      "ldd         r18,   Z + 26"     "\n\t" // _tx_buffer_mask
+      "and         r25,      r18"     "\n\t" // Wrap the tail around
       "ldd         r24,   Y +  5"     "\n\t"  // Y + 5 = USART.CTRLA - get CTRLA into r24
       "ldd         r18,   Z + 19"     "\n\t"  // txhead into r18
       "cpse        r18,      r25"     "\n\t"  // if they're the same
@@ -294,6 +406,7 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
       "brts        .+2"               "\n\t"  // hop over the next insn if T bit set, means entered through do_dre, rather than poll_dre
       "rjmp _poll_dre_done"           "\n\t"  // 8k parts can use RJMP
 #endif
+    "_ext_dre_exit:"                  "\n\t"
       "pop         r27"               "\n\t"  // and continue with popping registers.
       "pop         r26"               "\n\t"
       "pop         r25"               "\n\t"
@@ -303,14 +416,68 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
       "pop         r18"               "\n\t"  // pop old r18
       "pop         r31"               "\n\t"  // pop the Z that the isr pushed.
       "pop         r30"               "\n\t"
-      "reti"                        "\n"   // and RETI!
+      ISR_TRACE_EXIT_ASM(DRE)
+      "reti"                          "\n\t"  // and RETI!
+    "_ext_dre:"                       "\n\t"  // r18, r24-r27 and SREG saved; Z = &SerialN. X isn't used here.
+      "push        r19"               "\n\t"
+      "push        r28"               "\n\t"
+      "push        r29"               "\n\t"
+      "ldd         r28,   Z + 27"     "\n\t"
+      "ldd         r29,   Z + 28"     "\n\t"  // Y = _tx_ext_ptr
+      "ld          r19,       Y+"     "\n\t"  // grab the character
+      "std     Z + 27,       r28"     "\n\t"
+      "std     Z + 28,       r29"     "\n\t"  // and store the incremented pointer
+      "ldd         r28,   Z + 12"     "\n\t"  // usart in Y
+      "ldi         r29,     0x08"     "\n\t"  // High byte always 0x08 for USART peripheral
+      "ldi         r18,     0x40"     "\n\t"
+      "std       Y + 4,      r18"     "\n\t"  // Y + 4 = USART.STATUS - clear TXC
+      "std       Y + 2,      r19"     "\n\t"  // Y + 2 = USART.TXDATAL - write char
+      "ldd         r24,   Z + 29"     "\n\t"
+      "ldd         r25,   Z + 30"     "\n\t"  // _tx_ext_len
+      "sbiw        r24,        1"     "\n\t"  // one less to go
+      "std     Z + 29,       r24"     "\n\t"
+      "std     Z + 30,       r25"     "\n\t"  // std leaves the flags from sbiw alone
+      "brne   _ext_dre_done"          "\n\t"  // if that wasn't the last one, we're done.
+      "ldd         r18,   Y +  5"     "\n\t"  // Y + 5 = USART.CTRLA
+      "andi        r18,     0xDF"     "\n\t"  // DREIE off
+      "std      Y +  5,      r18"     "\n\t"
+      "ldd         r18,   Z + 16"     "\n\t"
+      "andi        r18,     0xFB"     "\n\t"  // back to ring buffer mode
+      "std     Z + 16,       r18"     "\n\t"
+      "ldd         r24,   Z + 31"     "\n\t"
+      "ldd         r25,   Z + 32"     "\n\t"  // _tx_ext_callback
+      "mov         r18,      r24"     "\n\t"
+      "or          r18,      r25"     "\n\t"
+      "breq   _ext_dre_done"          "\n\t"  // no callback
+      "push          r0"              "\n\t"  // Calling C, so save the rest of the call-used registers.
+      "push          r1"              "\n\t"
+      "push         r20"              "\n\t"
+      "push         r21"              "\n\t"
+      "push         r22"              "\n\t"
+      "push         r23"              "\n\t"
+      "clr           r1"              "\n\t"
+      "movw        r30,      r24"     "\n\t"
+      "icall"                         "\n\t"
+      "pop          r23"              "\n\t"
+      "pop          r22"              "\n\t"
+      "pop          r21"              "\n\t"
+      "pop          r20"              "\n\t"
+      "pop           r1"              "\n\t"
+      "pop           r0"              "\n\t"
+    "_ext_dre_done:"                  "\n\t"
+      "pop         r29"               "\n\t"
+      "pop         r28"               "\n\t"
+      "pop         r19"               "\n\t"
+      "rjmp  _ext_dre_exit"           "\n"
       ::);
     __builtin_unreachable();
   }
-#elif USE_ASM_DRE == 1
-  #warning "USE_ASM_DRE == 1, but the buffer sizes are not supported, falling back to the classical DRE."
 #else
-  void UartClass::_tx_data_empty_irq(UartClass& uartClass) {
+  HOT_PATH void UartClass::_tx_data_empty_irq(UartClass& uartClass) {
+    if (uartClass._state & 4) {
+      uartClass._tx_ext_data_empty();
+      return;
+    }
     USART_t* usartModule      = (USART_t*)uartClass._hwserial_module;  // reduces size a little bit
     tx_buffer_index_t txTail  = uartClass._tx_buffer_tail;
 
@@ -331,7 +498,7 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
     usartModule->STATUS = USART_TXCIF_bm;
     usartModule->TXDATAL = c;
 
-    txTail = (txTail + 1) & (SERIAL_TX_BUFFER_SIZE - 1);  //% SERIAL_TX_BUFFER_SIZE;
+    txTail = (txTail + 1) & uartClass._tx_buffer_mask;
     uint8_t ctrla = usartModule->CTRLA;
     if (uartClass._tx_buffer_head == txTail) {
       // Buffer empty, so disable "data register empty" interrupt
@@ -349,7 +516,7 @@ ISR(USART0_DRE_vect, ISR_NAKED) {
 #endif
 
 // To invoke data empty "interrupt" via a call, use this method
-void UartClass::_poll_tx_data_empty(void) {
+HOT_PATH void UartClass::_poll_tx_data_empty(void) {
   if ((!(SREG & CPU_I_bm)) ||  CPUINT.STATUS) {
     // We're here because we're waiting for space in the buffer *or* we're in flush
     // and waiting for the last byte to leave, yet we're either in an ISR, or
@@ -368,14 +535,17 @@ void UartClass::_poll_tx_data_empty(void) {
     // -Spence 10/23/20
     // Invoke interrupt handler only if conditions data register is empty
     if ((*_hwserial_module).STATUS & USART_DREIF_bm) {
-      if (_tx_buffer_head != _tx_buffer_tail) {
+      if (_state & 4) {
+        _tx_ext_data_empty();
+        return;
+      }
+      if (_tx_buffer_head == _tx_buffer_tail) {
         // Buffer empty, so disable "data register empty" interrupt
         (*_hwserial_module).CTRLA &= (~USART_DREIE_bm);
 
         return;
       }
-      #if !(USE_ASM_DRE == 1 && (SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128  || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) && \
-                                (SERIAL_TX_BUFFER_SIZE == 256 || SERIAL_TX_BUFFER_SIZE == 128  || SERIAL_TX_BUFFER_SIZE == 64 || SERIAL_TX_BUFFER_SIZE == 32 || SERIAL_TX_BUFFER_SIZE == 16))
+      #if USE_ASM_DRE != 1
         _tx_data_empty_irq(*this);
       #else
         #ifdef USART1
@@ -403,6 +573,20 @@ void UartClass::_poll_tx_data_empty(void) {
   // disabled, yet you are actually attempting to send. I don't think it can happen.
 }
 
+// Sends the next byte of a writeFrom() buffer. Used by the C DRE ISR always, and when polling in either case.
+void UartClass::_tx_ext_data_empty(void) {
+  volatile USART_t* usartModule = _hwserial_module;
+  usartModule->STATUS  = USART_TXCIF_bm;
+  usartModule->TXDATAL = *_tx_ext_ptr++;
+  if (!--_tx_ext_len) {
+    usartModule->CTRLA &= ~USART_DREIE_bm;
+    _state &= ~4;
+    if (_tx_ext_callback) {
+      _tx_ext_callback();
+    }
+  }
+}
+
 /*###  #   # ####  #    ###  ###     #   # #### ##### #   #  ###  ####   ###
  #   # #   # #   # #     #  #        ## ## #      #   #   # #   # #   # #
  ####  #   # ####  #     #  #        # # # ###    #   ##### #   # #   #  ###
@@ -467,7 +651,24 @@ bool UartClass::swap(uint8_t newmux) {
   return false;
 }
 
-void UartClass::begin(unsigned long baud, uint16_t options) {
+void UartClass::_beginBaud(uint32_t baud, uint16_t options) {
+  bool u2x = false;
+  if (options & SERIAL_AUTOBAUD) {          // SERIAL_AUTOBAUD: the hardware measures the sync field, and only
+    if (baud > F_CPU / 16) {                // does that in its own mode, which runs at normal (not U2X) speed -
+      baud   = F_CPU / 16;                  // so the starting baud can't be faster than that.
+    }
+  } else if (baud > F_CPU / 16) {           // if this baud is too fast for non-U2X
+    u2x      = true;                        // use U2X
+    baud   >>= 1;                           // And lower the baud rate by half
+  }
+  uint32_t baud_setting = (4 * F_CPU + (baud >> 1)) / baud;
+  if (baud_setting < 64) {                  // so set to the maximum baud rate setting.
+    baud_setting = 64;
+  }
+  _begin(baud_setting, options, u2x);       // a baud too low for the 16-bit register isn't checked for, as it never was
+}
+
+void UartClass::_begin(uint16_t baud_setting, uint16_t options, bool u2x) {
   // Make sure no transmissions are ongoing and USART is disabled in case begin() is called by accident
   // without first calling end()
   if (_state & 1) {
@@ -478,23 +679,23 @@ void UartClass::begin(unsigned long baud, uint16_t options) {
   if (ctrlc == 0) {                         // see if they passed anything in low byte or SERIAL_CONFIG_VALID.
     ctrlc = (uint8_t)SERIAL_8N1;            // low byte of 0 could mean they want SERIAL_5N1. Or that they thought they'd
   }
-  ctrlc &= ~0x04; // Now unset that 0x04 bit if it's set, because none of the values with it set are supported. We use that to smuggle in a "this constant was specified" for 5N1
+  if ((ctrlc & USART_CHSIZE_gm) != USART_CHSIZE_9BITH_gc) { // SERIAL_MPCM is the only one with that bit that's supported
+    ctrlc &= ~0x04; // Now unset that 0x04 bit if it's set, because none of the values with it set are supported. We use that to smuggle in a "this constant was specified" for 5N1
+  }
   uint8_t ctrla = (uint8_t) (options >> 8);// CTRLA will get the remains of the options high byte.
-  uint16_t baud_setting = 0;                // at this point it should be able to reuse those 2 registers that it received options in!
   uint8_t   ctrlb = (~ctrla & 0xC0);        // Top two bits (TXEN RXEN), inverted so they match he sense in the registers.
-  if (baud   > F_CPU / 16) {            // if this baud is too fast for non-U2X
-        ctrlb   |= USART_RXMODE0_bm;        // set the U2X bit in what will become CTRLB
-        baud   >>= 1;                       // And lower the baud rate by haldf
-  }
-  baud_setting = (((4 * F_CPU) / baud));  // And now the registers that baud was passed in are done.
-  if (baud_setting < 64)                      // so set to the maximum baud rate setting.
-    baud_setting= 64;       // set the U2X bit in what will become CTRLB
-  //} else if (baud < (F_CPU / 16800)) {      // Baud rate is too low
-  //  baud_setting = 65535;                   // minimum baud rate.'
+  if (ctrla & 0x10) {                       // SERIAL_AUTOBAUD
+    ctrlb   |= USART_RXMODE_GENAUTO_gc;
+  } else if (u2x) {
+    ctrlb   |= USART_RXMODE0_bm;            // set the U2X bit in what will become CTRLB
+  }
                                             // Baud setting done now we do the other options not in CTRLC;
   if (ctrla & 0x04) {                       // is ODME option set?
     ctrlb |= USART_ODME_bm;                 // set the bit in what will become CTRLB
   }
+  if (_address_filter && (ctrlc & USART_CHSIZE_gm) == USART_CHSIZE_9BITH_gc) {
+    ctrlb |= USART_MPCM_bm;                 // setAddress() came first: start out listening only for addresses.
+  }
   ctrla &= 0x2B;                            // Only LBME and RS485 (both of them); will get written to CTRLA, but we leave the event bit.
   if (ctrlb & USART_RXEN_bm) {              // if RX is to be enabled
     ctrla  |= USART_RXCIE_bm;               // we will want to enable the ISR.
@@ -522,10 +723,26 @@ void UartClass::begin(unsigned long baud, uint16_t options) {
   }                                         // finally strip out the SERIAL_EVENT_RX bit which is in the DREIE
   (*MyUSART).CTRLA          = ctrla & 0xDF; // position, which we never set in begin.
   (*MyUSART).CTRLB          = ctrlb;        // Set the all important CTRLB...
+  if (ctrlb & USART_RXMODE_GENAUTO_gc) {    // Auto-baud - we don't know how far off the starting baud is, so
+    (*MyUSART).STATUS       = USART_WFB_bm; // take the next low pulse as a break no matter how long it is.
+  }
   _set_pins(_module_number, _pin_set, setpinmask); // set up the pin(s)
   SREG = oldSREG;                             // re-enable interrupts, and we're done.
 }
 
+uint32_t UartClass::getBaud() {
+  // Works out what begin() did - or, with SERIAL_AUTOBAUD, what the hardware locked onto.
+  uint16_t baud_setting = (*_hwserial_module).BAUD;
+  if (!baud_setting) {
+    return 0;
+  }
+  uint32_t baud = (4 * F_CPU) / baud_setting;
+  if (((*_hwserial_module).CTRLB & USART_RXMODE_gm) == USART_RXMODE_CLK2X_gc) {
+    baud <<= 1;
+  }
+  return baud;
+}
+
 void UartClass::_set_pins(uint8_t mod_nbr, uint8_t mux_set, uint8_t enmask) {
   // Set the mux register
   #if defined(PORTMUX_USARTROUTEA)
@@ -595,6 +812,170 @@ void UartClass::_set_pins(uint8_t mod_nbr, uint8_t mux_set, uint8_t enmask) {
   */
 }
 
+void UartClass::getRxStats(uart_rx_stats_t *stats, bool clear) {
+  uint8_t oldSREG = SREG;
+  cli();
+  *stats = _rx_stats;
+  if (clear) {
+    memset(&_rx_stats, 0, sizeof(_rx_stats));
+  }
+  SREG = oldSREG;
+}
+
+/* An address arrived, in MPCM mode. Whether the data after it is for us decides whether the receiver goes on
+ * ignoring data (MPCM set) or not. Without setAddress(), there's nothing to filter, but the callback still sees it. */
+void UartClass::_rx_address_irq(UartClass& uartClass, uint8_t address) {
+  bool selected = uartClass._address_callback ? uartClass._address_callback(address) : (address == uartClass._address);
+  if (uartClass._address_filter) {
+    volatile USART_t* usart = uartClass._hwserial_module;
+    if (selected) {
+      usart->CTRLB &= ~USART_MPCM_bm;
+    } else {
+      usart->CTRLB |=  USART_MPCM_bm;
+    }
+  }
+}
+
+/* Everything the RXC ISR doesn't simply store: in DMX receive mode, every character; otherwise an address (DATA8 set)
+ * or a break (a 0 with FERR set). */
+void UartClass::_rx_special_irq(UartClass& uartClass, uint8_t status, uint8_t c) {
+  if (uartClass._state & 0x20) {
+    uint16_t i = uartClass._dmx_index;
+    if (status & USART_FERR_bm) {
+      if (c) {
+        uartClass._dmx_index = 0xFFFF;        // not a break, just garbled - wait for the next one.
+        return;
+      }
+      if (i != 0xFFFF && i > 1 && i <= uartClass._dmx_size) {
+        uartClass._dmx_length = i - 1;         // a short frame ended - a full one was flagged at its last channel
+        uartClass._dmx_ready  = 1;
+      }
+      uartClass._dmx_index = 0;
+      return;
+    }
+    if (i == 0xFFFF) {
+      return;
+    }
+    if (!i) {
+      uartClass._dmx_index = c ? 0xFFFF : 1;   // only start code 0 is dimmer data; skip the others (like RDM)
+      return;
+    }
+    if (i <= uartClass._dmx_size) {
+      uartClass._dmx_buffer[i - 1] = c;
+      if (i == uartClass._dmx_size) {
+        uartClass._dmx_length = i;
+        uartClass._dmx_ready  = 1;
+      }
+    }
+    if (i <= 512) {
+      uartClass._dmx_index = i + 1;
+    }
+  } else if (status & USART_DATA8_bm) {
+    _rx_address_irq(uartClass, c);
+  } else {
+    uartClass._rx_stats.breaks++;
+    if (uartClass._break_callback) {
+      uartClass._break_callback();
+    }
+  }
+}
+
+#if USE_ASM_RXC == 1
+  // Called by the asm RXC ISR, which can't easily name a C++ member.
+  extern "C" void __attribute__((used)) _uart_rx_special(UartClass *uart, uint8_t status, uint8_t c) {
+    UartClass::_rx_special_irq(*uart, status, c);
+  }
+#endif
+
+void UartClass::sendBreak(uint8_t bit_times) {
+  // A 0 is 9 bits low - the start bit and 8 data bits - so with BAUD (the bit time) scaled up by bit_times / 9, it's
+  // a break bit_times bits long at the real baud rate. Everything before it has to go out first, at the real one.
+  flush();
+  volatile USART_t* usart = _hwserial_module;
+  uint16_t baud = usart->BAUD;
+  uint32_t slow = ((uint32_t) baud * bit_times + 4) / 9;
+  usart->BAUD   = (slow > 0xFFFF) ? 0xFFFF : slow;
+  write((uint8_t) 0);
+  flush();
+  usart->BAUD   = baud;
+}
+
+void UartClass::onBreak(void (*callback)()) {
+  uint8_t oldSREG = SREG;
+  cli();
+  _break_callback = callback;
+  SREG = oldSREG;
+}
+
+void UartClass::dmxReceive(uint8_t *universe, uint16_t size) {
+  if (size > 512) {
+    size = 512;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _dmx_buffer = universe;
+  _dmx_size   = size;
+  _dmx_index  = 0xFFFF;                     // whatever is arriving now, the first frame starts at the next break.
+  _dmx_length = 0;
+  _dmx_ready  = 0;
+  if (universe && size) {
+    _state   |= 0x20;
+  } else {
+    _state   &= ~0x20;
+  }
+  SREG = oldSREG;
+}
+
+void UartClass::setAddress(uint8_t address) {
+  uint8_t oldSREG = SREG;
+  cli();
+  _address        = address;
+  _address_filter = true;
+  volatile USART_t* usart = _hwserial_module;
+  if ((usart->CTRLC & USART_CHSIZE_gm) == USART_CHSIZE_9BITH_gc) {
+    usart->CTRLB |= USART_MPCM_bm;          // not addressed until we hear our address
+  }
+  SREG = oldSREG;
+}
+
+void UartClass::noAddress() {
+  uint8_t oldSREG = SREG;
+  cli();
+  _address_filter = false;
+  _hwserial_module->CTRLB &= ~USART_MPCM_bm;
+  SREG = oldSREG;
+}
+
+void UartClass::onAddress(bool (*callback)(uint8_t address)) {
+  uint8_t oldSREG = SREG;
+  cli();                                    // the ISR mustn't see half of the pointer
+  _address_callback = callback;
+  SREG = oldSREG;
+}
+
+void UartClass::writeAddress(uint8_t address) {
+  // The 9th bit is written to TXDATAH before the rest go in TXDATAL. Let everything already written go out first,
+  // so it's only ever set for this character, then clear it again as soon as this one has moved on to the shifter.
+  flush();
+  volatile USART_t* usart = _hwserial_module;
+  usart->TXDATAH = 1;
+  write(address);
+  while (!(usart->STATUS & USART_DREIF_bm));
+  usart->TXDATAH = 0;
+}
+
+void UartClass::noOnFrame() {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_state & 8) {
+    _idle_timer->CTRLA   = 0;
+    _idle_timer->INTCTRL = 0;
+    _state              &= ~8;
+  }
+  _frame_ready = 0;
+  SREG = oldSREG;
+}
+
 void UartClass::end() {
   // wait for transmission of outgoing data
   flush();
@@ -609,10 +990,13 @@ void UartClass::end() {
 
   // Note: Does not change output pins
   // though the datasheetsays turning the TX module sets it to input.
-  _state = 0;
+  if (_state & 8) {
+    noOnFrame();
+  }
+  _state &= 0x30; // driver enable pin and DMX receive stay configured - see setRS485Pin() and dmxReceive().
 }
   int UartClass::available(void) {
-    return ((unsigned int)(SERIAL_RX_BUFFER_SIZE + _rx_buffer_head - _rx_buffer_tail)) & (SERIAL_RX_BUFFER_SIZE - 1); //% SERIAL_RX_BUFFER_SIZE;
+    return ((unsigned int)(_rx_buffer_head - _rx_buffer_tail)) & _rx_buffer_mask;
   }
 
   int UartClass::peek(void) {
@@ -623,17 +1007,66 @@ void UartClass::end() {
     }
   }
 
-  int UartClass::read(void) {
+  HOT_PATH int UartClass::read(void) {
     // if the head isn't ahead of the tail, we don't have any characters
     if (_rx_buffer_head == _rx_buffer_tail) {
       return -1;
     } else {
       unsigned char c = _rx_buffer[_rx_buffer_tail];
-      _rx_buffer_tail = (rx_buffer_index_t)(_rx_buffer_tail + 1) & (SERIAL_RX_BUFFER_SIZE - 1); // % SERIAL_RX_BUFFER_SIZE;
+      _rx_buffer_tail = (rx_buffer_index_t)(_rx_buffer_tail + 1) & _rx_buffer_mask;
       return c;
     }
   }
 
+  size_t UartClass::peekBuffer(uint8_t *dst, size_t n, size_t offset) {
+    // The ISR only ever moves the head forward, so a snapshot of it is good enough - anything that comes
+    // in after we take it just isn't included.
+    rx_buffer_index_t tail  = _rx_buffer_tail;
+    size_t            avail = ((unsigned int)(_rx_buffer_head - tail)) & _rx_buffer_mask;
+    if (offset >= avail) {
+      return 0;
+    }
+    avail -= offset;
+    if (n > avail) {
+      n = avail;
+    }
+    tail = (rx_buffer_index_t)(tail + offset) & _rx_buffer_mask;
+    for (size_t i = 0; i < n; i++) {
+      *dst++ = _rx_buffer[tail];
+      tail   = (rx_buffer_index_t)(tail + 1) & _rx_buffer_mask;
+    }
+    return n;
+  }
+
+  size_t UartClass::consume(size_t n) {
+    rx_buffer_index_t tail  = _rx_buffer_tail;
+    size_t            avail = ((unsigned int)(_rx_buffer_head - tail)) & _rx_buffer_mask;
+    if (n > avail) {
+      n = avail;
+    }
+    _rx_buffer_tail = (rx_buffer_index_t)(tail + n) & _rx_buffer_mask;
+    return n;
+  }
+
+  size_t UartClass::peekSpan(const uint8_t **span) {
+    return peekSpan(span, 0);
+  }
+
+  size_t UartClass::peekSpan(const uint8_t **span, size_t offset) {
+    rx_buffer_index_t tail  = _rx_buffer_tail;
+    rx_buffer_index_t head  = _rx_buffer_head;
+    size_t            avail = ((unsigned int)(head - tail)) & _rx_buffer_mask;
+    if (offset > avail) {
+      offset = avail;
+    }
+    tail  = (rx_buffer_index_t)(tail + offset) & _rx_buffer_mask;
+    *span = (const uint8_t *) &_rx_buffer[tail];
+    if (head >= tail) {
+      return head - tail;
+    }
+    return _rx_buffer_mask + 1 - tail; // up to the end of the buffer; the rest is at the start of it.
+  }
+
   int UartClass::availableForWrite(void) {
     tx_buffer_index_t head;
     tx_buffer_index_t tail;
@@ -643,7 +1076,7 @@ void UartClass::end() {
       tail = _tx_buffer_tail;
     }
     if (head >= tail) {
-      return SERIAL_TX_BUFFER_SIZE - 1 - head + tail;
+      return _tx_buffer_mask - head + tail;
     }
     return tail - head - 1;
   }
@@ -673,30 +1106,34 @@ void UartClass::end() {
       // poll the "data register empty" interrupt flag to prevent deadlock
 
       _poll_tx_data_empty();
+      yield();
     }
     // When we get here, nothing is queued anymore (DREIE is disabled) and
     // the hardware finished transmission (TXCIF is set).
   }
 
 
-  size_t UartClass::write(uint8_t c) {
+  HOT_PATH size_t UartClass::write(uint8_t c) {
+    while (_state & 4) { // an external buffer is still going out - it has to finish first.
+      _poll_tx_data_empty();
+    }
     _state |= 1; // Record that we have written to serial since it was begun.
     // If the buffer and the data register is empty, just write the byte
     // to the data register and be done. This shortcut helps
     // significantly improve the effective data rate at high (>
     // 500kbit/s) bit rates, where interrupt overhead becomes a slowdown.
     if ((_tx_buffer_head == _tx_buffer_tail) && ((*_hwserial_module).STATUS & USART_DREIF_bm)) {
-      if (_state & 2) { // in half duplex mode, we turn off RXC interrupt
-        uint8_t ctrla = (*_hwserial_module).CTRLA;
-        ctrla &= ~USART_RXCIE_bm;
-        ctrla |=  USART_TXCIE_bm;
-        (*_hwserial_module).STATUS = USART_TXCIF_bm;
-        (*_hwserial_module).CTRLA = ctrla;
+      if (_state & 0x12) { // half duplex or driver enable - the TXC ISR turns the line around afterwards.
+        uint8_t oldSREG = SREG;
+        cli();   // otherwise a TXC from the previous character could release the bus under us.
+        (*_hwserial_module).CTRLA   = _tx_turnaround((*_hwserial_module).CTRLA);
+        (*_hwserial_module).TXDATAL = c;
+        SREG = oldSREG;
       } else {
         (*_hwserial_module).STATUS = USART_TXCIF_bm;
+        // MUST clear TXCIF **before** writing new char, otherwise ill-timed interrupt can cause it to erase the flag after the new charchter has been sent!
+        (*_hwserial_module).TXDATAL = c;
       }
-      // MUST clear TXCIF **before** writing new char, otherwise ill-timed interrupt can cause it to erase the flag after the new charchter has been sent!
-      (*_hwserial_module).TXDATAL = c;
 
       /* I cannot figure out *HOW* the DRE could be enabled at this point (buffer empty and DRE flag up)
        * When the buffer was emptied, it would have turned off the DREI after it loaded the last byte.
@@ -711,21 +1148,21 @@ void UartClass::end() {
        */
       return 1;
     }
-    tx_buffer_index_t i = (_tx_buffer_head + 1) & (SERIAL_TX_BUFFER_SIZE - 1);  // % SERIAL_TX_BUFFER_SIZE;
+    tx_buffer_index_t i = (_tx_buffer_head + 1) & _tx_buffer_mask;
 
     // If the output buffer is full, there's nothing we can do other than to
     // wait for the interrupt handler to empty it a bit (or emulate interrupts)
     while (i == _tx_buffer_tail) {
       _poll_tx_data_empty();
+      yield();
     }
     _tx_buffer[_tx_buffer_head] = c;
     _tx_buffer_head = i;
-    if (_state & 2) { // in half duplex mode, we turn off RXC interrupt
-      uint8_t ctrla = (*_hwserial_module).CTRLA;
-      ctrla &= ~USART_RXCIE_bm;
-      ctrla |= USART_TXCIE_bm | USART_DREIE_bm;
-      (*_hwserial_module).STATUS = USART_TXCIF_bm;
-      (*_hwserial_module).CTRLA = ctrla;
+    if (_state & 0x12) { // half duplex or driver enable
+      uint8_t oldSREG = SREG;
+      cli();
+      (*_hwserial_module).CTRLA = _tx_turnaround((*_hwserial_module).CTRLA) | USART_DREIE_bm;
+      SREG = oldSREG;
     } else {
       // Enable "data register empty interrupt"
       (*_hwserial_module).CTRLA |= USART_DREIE_bm;
@@ -733,15 +1170,127 @@ void UartClass::end() {
     return 1;
   }
 
+  HOT_PATH size_t UartClass::write(const uint8_t *buffer, size_t size) {
+    // Block version of write(). Rather than going through write(uint8_t) once per byte, we copy as
+    // much as will fit into the TX buffer with interrupts off, publish the new head once, and turn on
+    // DRE once. The DRE ISR (either version) only ever looks at the head and tail, so it doesn't know
+    // or care how the bytes got there. If the buffer is full, we fall back to polling just like write().
+    size_t remaining = size;
+    if (!remaining) {
+      return 0;
+    }
+    while (_state & 4) { // an external buffer is still going out - it has to finish first.
+      _poll_tx_data_empty();
+    }
+    _state |= 1; // Record that we have written to serial since it was begun.
+    while (remaining) {
+      uint8_t oldSREG = SREG;
+      cli();
+      tx_buffer_index_t head  = _tx_buffer_head;
+      tx_buffer_index_t space = (tx_buffer_index_t)(_tx_buffer_tail - head - 1) & _tx_buffer_mask;
+      if (space) {
+        if (space > remaining) {
+          space = (tx_buffer_index_t) remaining;
+        }
+        remaining -= space;
+        do {
+          _tx_buffer[head] = *buffer++;
+          head = (tx_buffer_index_t)(head + 1) & _tx_buffer_mask;
+        } while (--space);
+        _tx_buffer_head = head;
+        uint8_t ctrla = (*_hwserial_module).CTRLA;
+        if (_state & 0x12) { // half duplex or driver enable
+          ctrla = _tx_turnaround(ctrla);
+        }
+        (*_hwserial_module).CTRLA = ctrla | USART_DREIE_bm;
+        SREG = oldSREG;
+      } else {
+        SREG = oldSREG;
+        // Buffer is full - wait for the ISR to make room, or do its job for it if it can't run.
+        _poll_tx_data_empty();
+        yield();
+      }
+    }
+    return size;
+  }
+
+  void UartClass::writeFrom(const uint8_t *buffer, uint16_t length, voidFuncPtr callback) {
+    // Everything already queued, including any previous external buffer, goes out first, so that the
+    // DRE ISR never has to decide between the two sources; it just checks _state bit 2.
+    while ((_state & 4) || (_tx_buffer_head != _tx_buffer_tail)) {
+      _poll_tx_data_empty();
+    }
+    if (!length) {
+      if (callback) {
+        callback();
+      }
+      return;
+    }
+    _state |= 1;
+    uint8_t oldSREG = SREG;
+    cli();
+    _tx_ext_ptr      = buffer;
+    _tx_ext_len      = length;
+    _tx_ext_callback = callback;
+    _state          |= 4;
+    uint8_t ctrla    = (*_hwserial_module).CTRLA;
+    if (_state & 0x12) { // half duplex or driver enable
+      ctrla = _tx_turnaround(ctrla);
+    }
+    (*_hwserial_module).CTRLA = ctrla | USART_DREIE_bm;
+    SREG = oldSREG;
+  }
+
+  uint8_t UartClass::_tx_turnaround(uint8_t ctrla) {
+    // Half duplex and RS-485 driver enable both need the TXC interrupt to turn the line around once the last
+    // stop bit is out. Called with interrupts off, before anything new goes into TXDATA. Returns new CTRLA.
+    if (_state & 2) { // in half duplex mode, we turn off RXC interrupt
+      ctrla &= ~USART_RXCIE_bm;
+    }
+    if (_state & 0x10) { // grab the bus; the TXC ISR lets go of it.
+      uart_de_t *de = &_usart_de[_module_number];
+      *(de->outclr - 1) = de->mask; // OUTSET
+    }
+    (*_hwserial_module).STATUS = USART_TXCIF_bm;
+    return ctrla | USART_TXCIE_bm;
+  }
+
+  void UartClass::setRS485Pin(uint8_t pin, uint16_t guard_us) {
+    flush(); // don't pull the rug out from under a transmission in progress.
+    uart_de_t *de = &_usart_de[_module_number];
+    uint8_t bit   = digitalPinToBitMask(pin);
+    uint8_t oldSREG = SREG;
+    cli();
+    if (de->mask) {
+      *(de->outclr) = de->mask;   // release the old pin, but leave it an output.
+    }
+    de->mask  = 0;
+    _state   &= ~0x10;
+    if (bit != NOT_A_PIN) {
+      PORT_t *port  = digitalPinToPortStruct(pin);
+      port->OUTCLR  = bit;
+      port->DIRSET  = bit;
+      uint32_t loops = ((uint32_t) guard_us * (F_CPU / 1000UL)) / 4000;
+      de->guard     = (loops > 0xFFFF) ? 0xFFFF : (uint16_t) loops;
+      de->outclr    = &(port->OUTCLR);
+      de->mask      = bit;
+      _state       |= 0x10;
+    }
+    SREG = oldSREG;
+  }
+
+  static const char _hex_digits[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+  static char * _hex_byte(char *c, uint8_t b) {
+    *c++ = _hex_digits[b >> 4];
+    *c++ = _hex_digits[b & 0x0F];
+    return c;
+  }
+
   void UartClass::printHex(const uint8_t b) {
-    char x = (b >> 4) | '0';
-    if (x > '9')
-      x += 7;
-    write(x);
-    x = (b & 0x0F) | '0';
-    if (x > '9')
-      x += 7;
-    write(x);
+    char x[2];
+    _hex_byte(x, b);
+    write((const uint8_t *) x, 2);
   }
 
   void UartClass::printHex(const uint16_t w, bool swaporder) {
@@ -771,13 +1320,72 @@ void UartClass::end() {
     }
   }
 
-  uint8_t * UartClass::printHex(uint8_t* p, uint8_t len, char sep) {
-    for (byte i = 0; i < len; i++) {
-      if (sep && i) write(sep);
-      printHex(*p++);
+  uint8_t * UartClass::printHex(uint8_t* p, size_t len, char sep) {
+    printHex((const uint8_t *) p, len, sep);
+    return p + len;
+  }
+
+  /* Built up a few bytes at a time in a buffer on the stack, and sent with the block write(), instead of a write()
+   * per character. The buffer is kept small, since the smallest parts only have 128 bytes of RAM. */
+  const uint8_t * UartClass::printHex(const uint8_t* p, size_t len, char sep, bool swapWords) {
+    char line[24];
+    uint8_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (sep && i && !(swapWords && (i & 1))) {
+        line[n++] = sep;
+      }
+      size_t j = (swapWords && (i ^ 1) < len) ? (i ^ 1) : i;  // a byte left over at the end stays where it is.
+      _hex_byte(&line[n], p[j]);
+      n += 2;
+      if (n > sizeof(line) - 3) {
+        write((const uint8_t *) line, n);
+        n = 0;
+      }
+    }
+    line[n++] = '\r';
+    line[n++] = '\n';
+    write((const uint8_t *) line, n);
+    return p + len;
+  }
+
+  void UartClass::hexDump(const void *buf, size_t len, uint16_t address) {
+    const uint8_t *p = (const uint8_t *) buf;
+    char line[32];   // a line goes out in three writes: the address and the first 8 bytes, the next 8, then the text
+    while (len) {
+      uint8_t count = (len < 16) ? len : 16;
+      char *c = _hex_byte(_hex_byte(line, address >> 8), address);
+      *c++ = ' ';
+      for (uint8_t i = 0; i < 16; i++) {
+        if (i == 8) {
+          write((const uint8_t *) line, c - line);
+          c = line;
+          *c++ = ' ';
+        }
+        *c++ = ' ';
+        if (i < count) {
+          c = _hex_byte(c, p[i]);
+        } else {
+          *c++ = ' ';
+          *c++ = ' ';
+        }
+      }
+      write((const uint8_t *) line, c - line);
+      c = line;
+      *c++ = ' ';
+      *c++ = ' ';
+      *c++ = '|';
+      for (uint8_t i = 0; i < count; i++) {
+        uint8_t ch = p[i];
+        *c++ = (ch >= 0x20 && ch < 0x7F) ? ch : '.';
+      }
+      *c++ = '|';
+      *c++ = '\r';
+      *c++ = '\n';
+      write((const uint8_t *) line, c - line);
+      p       += count;
+      len     -= count;
+      address += count;
     }
-    println();
-    return p;
   }
 
   uint16_t * UartClass::printHex(uint16_t* p, uint8_t len, char sep, bool swaporder) {
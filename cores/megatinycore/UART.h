@@ -72,6 +72,13 @@
   #define USE_ASM_TXC 1    // This *appears* to work? It's the easy one. saves 6b for 1 USART, 50 for 2.
 #endif
 
+#include "event_trace.h"
+#if !defined(USE_ASM_RXC) && (CORE_TRACE_ISRS & TRACE_ISR_RXC)
+  #define USE_ASM_RXC 0    // the C version records the byte with TRACE_ISR()
+#endif
+#if !defined(USE_ASM_DRE) && (CORE_TRACE_ISRS & TRACE_ISR_DRE)
+  #define USE_ASM_DRE 0
+#endif
 #if !defined(USE_ASM_RXC)
   #define USE_ASM_RXC 1    // This now works. Saves only 4b for 1 usart but 102 for 2.
 #endif
@@ -97,52 +104,68 @@
 #if !defined(SERIAL_RX_BUFFER_SIZE)
   #if   (INTERNAL_SRAM_SIZE <  512)  // 128/256b RAM
     #define SERIAL_RX_BUFFER_SIZE 16
-    // current tx buffer position = SerialClass + txtail + 37
   #elif (INTERNAL_SRAM_SIZE < 1024)  // 512b RAM
     #define SERIAL_RX_BUFFER_SIZE 32
-    // current tx buffer position = SerialClass + txtail + 53
   #else
     #define SERIAL_RX_BUFFER_SIZE 64  // 1k+ RAM
-    // current tx buffer position = SerialClass + txtail + 85
-    // rx buffer position always = SerialClass + rxhead + 21
   #endif
 #endif
 /* Use INTERNAL_SRAM_SIZE instead of RAMEND - RAMSTART, which is vulnerable to
  * a fencepost error. */
-#if (SERIAL_TX_BUFFER_SIZE > 256)
+// Each port can have its own buffer sizes, for example a big RX buffer on the high data rate port and a tiny
+// one on a debug port - define SERIALn_RX_BUFFER_SIZE and/or SERIALn_TX_BUFFER_SIZE the same way as above.
+// Those that aren't given default to SERIAL_RX/TX_BUFFER_SIZE. The buffers are no longer part of UartClass;
+// each UARTn.cpp declares its own, and the class gets a pointer to them and a mask to wrap the index with.
+#if !defined(SERIAL0_TX_BUFFER_SIZE)
+  #define SERIAL0_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL0_RX_BUFFER_SIZE)
+  #define SERIAL0_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL1_TX_BUFFER_SIZE)
+  #define SERIAL1_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#if !defined(SERIAL1_RX_BUFFER_SIZE)
+  #define SERIAL1_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+#if (SERIAL0_TX_BUFFER_SIZE > 256 || SERIAL1_TX_BUFFER_SIZE > 256)
   typedef uint16_t tx_buffer_index_t;
+  #define SERIAL_BIG_TX_BUFFER
 #else
   typedef uint8_t  tx_buffer_index_t;
 #endif
-#if (SERIAL_RX_BUFFER_SIZE > 256)
+#if (SERIAL0_RX_BUFFER_SIZE > 256 || SERIAL1_RX_BUFFER_SIZE > 256)
   typedef uint16_t rx_buffer_index_t;
+  #define SERIAL_BIG_RX_BUFFER
 #else
   typedef uint8_t  rx_buffer_index_t;
 #endif
 // As noted above, forcing the sizes to be a power of two saves a small
 // amount of flash, and there's no compelling reason to NOT have them be
-// a power of two. If this is a problem, since you're already modifying
-// core, change the lines in UART.cpp where it does & (SERIAL_xX_BUFFERLSIZE-1)
-// and replace them with % SERIAL_xX_BUFFER_SIZE; where xX is TX or RX.
-// There are two of each, and the old ending of the line is even commented
-// out at the end of the line.
-#if (SERIAL_TX_BUFFER_SIZE & (SERIAL_TX_BUFFER_SIZE - 1))
+// a power of two. The index is wrapped with & _xx_buffer_mask everywhere.
+#if ((SERIAL0_TX_BUFFER_SIZE & (SERIAL0_TX_BUFFER_SIZE - 1)) || (SERIAL1_TX_BUFFER_SIZE & (SERIAL1_TX_BUFFER_SIZE - 1)))
   #error "ERROR: TX buffer size must be a power of two."
 #endif
-#if (SERIAL_RX_BUFFER_SIZE & (SERIAL_RX_BUFFER_SIZE - 1))
+#if ((SERIAL0_RX_BUFFER_SIZE & (SERIAL0_RX_BUFFER_SIZE - 1)) || (SERIAL1_RX_BUFFER_SIZE & (SERIAL1_RX_BUFFER_SIZE - 1)))
   #error "ERROR: RX buffer size must be a power of two."
 #endif
 
-#if USE_ASM_RXC == 1 && !(SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16)
-  #error "Assembly RX Complete (RXC) ISR is only supported when RX buffer size are 256, 128, 64, 32 or 16 bytes"
+// The asm ISRs wrap the index with the mask, so any power of two works, but they assume 1-byte indices.
+#if USE_ASM_RXC == 1 && defined(SERIAL_BIG_RX_BUFFER)
+  #error "Assembly RX Complete (RXC) ISR is only supported when RX buffer sizes are 256 bytes or less"
 #endif
 
-#if USE_ASM_DRE == 1 && !((SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) && \
-                          (SERIAL_TX_BUFFER_SIZE == 256 || SERIAL_TX_BUFFER_SIZE == 128 || SERIAL_TX_BUFFER_SIZE == 64 || SERIAL_TX_BUFFER_SIZE == 32 || SERIAL_TX_BUFFER_SIZE == 16))
-  #error "Assembly Data Register Empty (DRE) ISR is only supported when both TX and RX buffer sizes are 256, 128, 64, 32 or 16 bytes"
+#if USE_ASM_DRE == 1 && (defined(SERIAL_BIG_RX_BUFFER) || defined(SERIAL_BIG_TX_BUFFER))
+  #error "Assembly Data Register Empty (DRE) ISR is only supported when both TX and RX buffer sizes are 256 bytes or less"
 #endif
 
 
+// How far from the requested rate (in parts per thousand) a constant baud passed to begin() may be before it's an
+// error. Each end of an asynchronous link can be a couple of percent out before characters are lost.
+#if !defined(SERIAL_BAUD_TOLERANCE)
+  #define SERIAL_BAUD_TOLERANCE 20
+#endif
+
 #define syncBegin(port, baud, config, syncopts) ({\
   if ((config & 0xC0) == 0x40)                    \
     {pinConfigure(port.getPin(2), syncopts);      \
@@ -225,6 +248,26 @@ const uint8_t _usart_pins[][4] = {
 /* DANGER DANGER DANGER */
 /* CHANGING THE MEMBER VARIABLES BETWEEN HERE AND THE OTHER SCARY COMMENT WILL COMPLETELY BREAK SERIAL
  * WHEN USE_ASM_DRE and/or USE_ASM_RXC is used! */
+// Receive error counters - see UartClass::getRxStats(). All of them wrap around after 65535.
+typedef struct {
+  uint16_t ring_overflow;  // Characters discarded because the RX buffer was full.
+  uint16_t hw_overflow;    // Times the hardware buffer overflowed (BUFOVF) - characters lost before the ISR could run.
+  uint16_t framing;        // Characters received with a framing error (no stop bit). These are still stored.
+  uint16_t parity;         // Characters received with a parity error. These are discarded.
+  uint16_t breaks;         // Breaks - a 0 with a framing error. Not stored, and not counted as framing errors.
+} uart_rx_stats_t;
+
+// RS-485 driver enable on an ordinary GPIO - see UartClass::setRS485Pin(). One per USART, indexed by module
+// number, and kept outside the class because the TXC ISR only knows which USART it is, not which UartClass.
+typedef struct {
+  uint8_t           mask;    // bit mask of the pin, 0 if none.
+  volatile uint8_t *outclr;  // &PORTx.OUTCLR - OUTSET is the byte before it.
+  uint16_t          guard;   // 4-clock loop iterations to keep driving after the stop bit.
+} uart_de_t;
+
+extern "C" uart_de_t _usart_de[];
+extern "C" uint8_t _usart_wake;           // wiring_sleep.c
+
 /* DANGER DANGER DANGER */
 class UartClass : public HardwareSerial {
   protected:
@@ -232,7 +275,11 @@ class UartClass : public HardwareSerial {
     const uint8_t _module_number;
     uint8_t _pin_set;
 
-    uint8_t _state; /* 0b000000hw */
+    uint8_t _state; /* 0b00rdixhw */
+    // r = DMX receive (see dmxReceive()) - RXC puts the channels in the universe buffer, not the RX buffer.
+    // d = driving an RS-485 driver enable pin (see setRS485Pin()) - TXC releases it after the stop bit.
+    // i = idle line detection armed (see onFrame()) - RXC restarts _idle_timer on every character.
+    // x = transmitting from an external buffer (see writeFrom()) - DRE reads _tx_ext_ptr, not _tx_buffer.
     // h = half duplex with open drain - disable RX while TX.
     // w = written (like old _written)
 
@@ -241,22 +288,70 @@ class UartClass : public HardwareSerial {
     volatile tx_buffer_index_t _tx_buffer_head;
     volatile tx_buffer_index_t _tx_buffer_tail;
 
-    // Don't put any members after these buffers, since only the first
-    // 32 bytes of this struct can be accessed quickly using the ldd
-    // instruction.
-    volatile unsigned char _rx_buffer[SERIAL_RX_BUFFER_SIZE];
-    volatile unsigned char _tx_buffer[SERIAL_TX_BUFFER_SIZE];
+    // The buffers themselves are declared in UARTn.cpp so that each port can have its own size.
+    // Everything the ISRs use is within the first 64 bytes so the asm can reach it with ldd.
+    volatile uint8_t * const   _rx_buffer;       // Z + 21
+    volatile uint8_t * const   _tx_buffer;       // Z + 23
+    const rx_buffer_index_t    _rx_buffer_mask;  // Z + 25 - size - 1
+    const tx_buffer_index_t    _tx_buffer_mask;  // Z + 26
+
+    const uint8_t * volatile   _tx_ext_ptr;      // Z + 27 - see writeFrom()
+    volatile uint16_t          _tx_ext_len;      // Z + 29
+    voidFuncPtr                _tx_ext_callback; // Z + 31
+    volatile TCB_t *           _idle_timer;      // Z + 33 - see onFrame()
+    uart_rx_stats_t            _rx_stats;        // Z + 35 - see getRxStats()
 /* DANGER DANGER DANGER */
 /* ANY CHANGES BETWEEN OTHER SCARY COMMENT AND THIS ONE WILL BREAK SERIAL when USE_ASM_DRE or USE_ASM_RXC is used! */
 /* DANGER DANGER DANGER */
+    void                     (*_frame_callback)(uint8_t length);
+    volatile uint8_t           _frame_ready;
+    bool                     (*_address_callback)(uint8_t address);
+    uint8_t                    _address;
+    bool                       _address_filter;
+    voidFuncPtr                _break_callback;
+    uint8_t *                  _dmx_buffer;
+    uint16_t                   _dmx_size;
+    uint16_t                   _dmx_index;      // next channel; 0 = start code next, 0xFFFF = wait for a break
+    volatile uint16_t          _dmx_length;
+    volatile uint8_t           _dmx_ready;
 
   public:
-    inline             UartClass(volatile USART_t *hwserial_module, uint8_t module_number, uint8_t default_pinset);
+    inline             UartClass(volatile USART_t *hwserial_module, uint8_t module_number, uint8_t default_pinset,
+                                 volatile uint8_t *rx_buffer, rx_buffer_index_t rx_mask, volatile uint8_t *tx_buffer, tx_buffer_index_t tx_mask);
     bool                    pins(uint8_t tx, uint8_t rx);
     bool                    swap(uint8_t mux_level = 1);
     void                   begin(uint32_t baud) {begin(baud, SERIAL_8N1);}
-    void                   begin(uint32_t baud, uint16_t options);
+    /* With a constant baud and options, BAUD and the choice of U2X are worked out by the compiler, and a baud rate
+     * that can't be done to within SERIAL_BAUD_TOLERANCE at this F_CPU is an error, instead of a port that sends
+     * garbage. Otherwise the division is done at runtime, as it always was. Either way _begin() does the rest. */
+    inline __attribute__((always_inline)) void begin(uint32_t baud, uint16_t options) {
+      if (__builtin_constant_p(baud) && __builtin_constant_p(options)) {
+        if (options & SERIAL_AUTOBAUD) {    // autobaud runs at normal speed, and the hardware corrects the baud
+          const uint32_t rate = (baud > F_CPU / 16) ? F_CPU / 16 : baud;
+          _begin((4 * F_CPU + rate / 2) / rate, options, false);
+          return;
+        }
+        const bool     u2x     = baud > F_CPU / 16;
+        const uint32_t rate    = u2x ? baud >> 1 : baud;
+        const uint32_t setting = (4 * F_CPU + rate / 2) / rate;
+        if (setting > 0xFFFF) {
+          badArg("Baud rate is too low for this F_CPU");
+        }
+        const uint16_t baudreg = setting < 64 ? 64 : setting;
+        const uint32_t actual  = ((4 * F_CPU) / baudreg) << (u2x ? 1 : 0);
+        const uint32_t diff    = actual > baud ? actual - baud : baud - actual;
+        if (!(options & 0xC0) && (uint64_t)diff * 1000 > (uint64_t)baud * SERIAL_BAUD_TOLERANCE) {
+          badArg("Baud rate can't be generated to within SERIAL_BAUD_TOLERANCE at this F_CPU");
+        }
+        _begin(baudreg, options, u2x);
+      } else {
+        _beginBaud(baud, options);
+      }
+    }
     void                     end();
+    // The baud rate the USART is actually running at: what begin() got closest to, or with SERIAL_AUTOBAUD,
+    // what the hardware measured from the last sync field.
+    uint32_t             getBaud();
     // Basic printHex() forms for 8, 16, and 32-bit values
     void                printHex(const     uint8_t              b);
     void                printHex(const    uint16_t  w, bool s = 0);
@@ -272,40 +367,129 @@ class UartClass : public HardwareSerial {
     void              printHexln(const     int16_t  w, bool s = 0)  {printHex((uint16_t)w, s); println();}
     void              printHexln(const     int32_t  l, bool s = 0)  {printHex((uint16_t)l, s); println();}
     // The pointer-versions for mass printing uint8_t and uint16_t arrays.
-    uint8_t *           printHex(          uint8_t* p, uint8_t len, char sep = 0            );
+    uint8_t *           printHex(          uint8_t* p, size_t  len, char sep = 0            );
     uint16_t *          printHex(         uint16_t* p, uint8_t len, char sep = 0, bool s = 0);
     volatile uint8_t *  printHex(volatile  uint8_t* p, uint8_t len, char sep = 0            );
     volatile uint16_t * printHex(volatile uint16_t* p, uint8_t len, char sep = 0, bool s = 0);
+    // Any length of bytes, sent a few at a time with the block write(). swapWords prints them as little-endian
+    // 16-bit words - each pair high byte first, with sep between pairs.
+    const uint8_t *     printHex(const     uint8_t* p, size_t  len, char sep = 0, bool swapWords = 0);
+    // The canonical dump, 16 bytes a line: "0120  48 65 6C 6C 6F 00 ...  |Hello.|", address counting from address.
+    void                 hexDump(const void *buf, size_t len, uint16_t address = 0);
 
     virtual int availableForWrite(void);
     virtual int available(void);
     virtual      int peek(void);
     virtual      int read(void);
     virtual    void flush(void);
+    // Frame parsing without a read() per byte. peekBuffer() copies up to n bytes starting offset bytes into
+    // the RX buffer without removing them, consume() discards up to n bytes, and peekSpan() points span at the
+    // oldest byte and returns how many follow it contiguously (call again after consume() to get the part that
+    // wrapped around). All return the number of bytes actually copied/discarded/available. peekSpan(span, offset)
+    // does the same from offset bytes in, so both parts of a frame that wraps can be read in place.
+    size_t       peekBuffer(uint8_t *dst, size_t n, size_t offset = 0);
+    virtual  size_t consume(size_t n);
+    virtual  size_t peekSpan(const uint8_t **span);
+    size_t         peekSpan(const uint8_t **span, size_t offset);
     virtual  size_t write(uint8_t ch);
+    virtual  size_t write(const uint8_t *buffer, size_t size);
     inline   size_t write(unsigned long n)  {return write((uint8_t)n);}
     inline   size_t write(long n)           {return write((uint8_t)n);}
     inline   size_t write(unsigned int n)   {return write((uint8_t)n);}
     inline   size_t write(int n)            {return write((uint8_t)n);}
     using Print::write; // pull in write(str) and write(buf, size) from Print
+    // Zero-copy transmit straight out of a caller-owned buffer, which must not be modified until callback is
+    // called (from the DRE ISR) or txFromBusy() returns false. F() strings are read from the memory mapped flash.
+    void                writeFrom(const uint8_t *buffer, uint16_t length, voidFuncPtr callback = NULL);
+    void                writeFrom(const __FlashStringHelper *buffer, uint16_t length, voidFuncPtr callback = NULL) {
+      writeFrom((const uint8_t *)((uint16_t) buffer + MAPPED_PROGMEM_START), length, callback);
+    }
+    bool               txFromBusy() {return (*(volatile uint8_t *) &_state) & 4;} // the ISR clears that bit.
+    // Copy the receive error counters to stats (atomically), and optionally zero them.
+    void              getRxStats(uart_rx_stats_t *stats, bool clear = false);
+    // Idle line detection: the TCB is restarted by every received character, and when bit_times pass without
+    // one, callback is called from the TCB ISR with the number of bytes waiting, and frameReady() returns true
+    // once. Call after begin(); end() turns it off. Only TCB0 and TCB1 are supported. With deferred = DEFERRED (or
+    // DEFERRED_LOW), the callback is posted to run from deferDispatch() instead.
+    bool                  onFrame(volatile TCB_t *timer, uint8_t bit_times, void (*callback)(uint8_t length) = NULL, uint8_t deferred = 0);
+    void                noOnFrame();
+    bool               frameReady() {
+      if (_frame_ready) {
+        _frame_ready = 0;
+        return true;
+      }
+      return false;
+    }
+    // Multi-processor communication mode, with SERIAL_MPCM (9-bit characters; the 9th bit marks an address). After
+    // setAddress(), the receiver ignores everything but address characters in hardware until one is this address
+    // (or onAddress()'s callback, called from the RXC ISR for each address received, returns true); then it gets
+    // the data that follows - until the next address that isn't. Address characters don't go in the RX buffer.
+    void              setAddress(uint8_t address);
+    void               noAddress();             // receive everything again
+    void               onAddress(bool (*callback)(uint8_t address));
+    void            writeAddress(uint8_t address);  // waits for what's been written to go out, then sends an address
+    // Receive in standby: the core's sleep functions turn on start-of-frame detection while they have the chip in
+    // standby (never power down while this is on), and the character that woke it is received. See PowerSave.md.
+    // Send a break of bit_times bits at the current baud rate (a 0 at a lower one - no begin() needed), after what's
+    // already been written has gone out. The stop bit, bit_times / 9 bits long, is the mark after it.
+    void               sendBreak(uint8_t bit_times = SERIAL_BREAK_LIN);
+    // Called from the RXC ISR when a break (a 0 with a framing error) is received; breaks don't go in the buffer.
+    void                 onBreak(void (*callback)());
+    // DMX512 receive: after each break, if the start code is 0, channels 1 to size go straight into universe[0]
+    // to universe[size - 1] from the ISR, and nothing goes in the RX buffer. NULL turns it off. It can come before
+    // or after begin(250000, SERIAL_8N2), and survives end(). dmxFrameReady() returns true once per frame, when the
+    // last channel wanted arrives (or at the next break, for a shorter frame), and dmxFrameLength() is how many
+    // channels that frame had, up to size.
+    void              dmxReceive(uint8_t *universe, uint16_t size);
+    bool           dmxFrameReady() {
+      if (_dmx_ready) {
+        _dmx_ready = 0;
+        return true;
+      }
+      return false;
+    }
+    uint16_t      dmxFrameLength() {
+      uint8_t oldSREG = SREG;
+      cli();
+      uint16_t length = _dmx_length;
+      SREG = oldSREG;
+      return length;
+    }
+    void          enableWakeOnRx() {
+      _usart_wake |= (1 << _module_number);
+    }
+    void         disableWakeOnRx() {
+      _usart_wake &= ~(1 << _module_number);
+    }
+    // RS-485 transceiver driver enable on any pin, for when XDIR (SERIAL_RS485) isn't usable. The pin is driven
+    // HIGH before the first start bit and released by the TXC interrupt guard_us after the last stop bit.
+    // NOT_A_PIN turns it off. Survives end() and begin().
+    void             setRS485Pin(uint8_t pin, uint16_t guard_us = 0);
     explicit operator bool() {
       return true;
     }
     uint8_t getPin(uint8_t pin);
 
     // Interrupt handlers - Not intended to be called externally
-    #if !(USE_ASM_RXC == 1 && (SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16))
+    #if USE_ASM_RXC != 1
       static void _rx_complete_irq(UartClass& uartClass);
     #endif
-    #if !(USE_ASM_DRE == 1 && (SERIAL_RX_BUFFER_SIZE == 256 || SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) && \
-                              (SERIAL_TX_BUFFER_SIZE == 256 || SERIAL_TX_BUFFER_SIZE == 128 || SERIAL_TX_BUFFER_SIZE == 64 || SERIAL_TX_BUFFER_SIZE == 32 || SERIAL_TX_BUFFER_SIZE == 16))
+    #if USE_ASM_DRE != 1
       static void _tx_data_empty_irq(UartClass& uartClass);
     #endif
+    static void _rx_address_irq(UartClass& uartClass, uint8_t address);
+    static void _rx_special_irq(UartClass& uartClass, uint8_t status, uint8_t c);
+    static void _idle_timer_irq(UartClass& uartClass);
 
   private:
     void _poll_tx_data_empty(void);
+    void _tx_ext_data_empty(void);
+    uint8_t _tx_turnaround(uint8_t ctrla);
+    void _beginBaud(uint32_t baud, uint16_t options);
+    void _begin(uint16_t baud_setting, uint16_t options, bool u2x);
     static void        _set_pins(uint8_t port_num, uint8_t mux_setting, uint8_t enmask);
     static uint8_t _pins_to_swap(uint8_t port_num, uint8_t tx_pin, uint8_t rx_pin);
+    friend class USARTSPIClass;             // USARTSPI.h in the SPI library sets up the pins for MSPI mode with these.
 };
 
 #if defined(USART0)
@@ -20,6 +20,7 @@
 #include "Arduino.h"
 #include "UART.h"
 #include "UART_private.h"
+#include <util/delay_basic.h>
 
 #if defined(USART0)
   #if defined(USE_ASM_TXC) && USE_ASM_TXC == 1 //&& defined(USART1) // No benefit to this if it's just one USART
@@ -40,16 +41,25 @@
       ctrla       |= USART_RXCIE_bm; // turn on receive complete
       ctrla       &= ~USART_TXCIE_bm; // turn off transmit complete
       USART0.CTRLA = ctrla;
+      if (_usart_de[0].mask) {           // RS-485 driver enable - hold it for the guard time, then let go.
+        if (_usart_de[0].guard) {
+          _delay_loop_2(_usart_de[0].guard);
+        }
+        *(_usart_de[0].outclr) = _usart_de[0].mask;
+      }
     }
   #endif
 
-  #if !(defined(USE_ASM_RXC) && USE_ASM_RXC == 1 && (SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) /* && defined(USART1)*/)
+  #if !(defined(USE_ASM_RXC) && USE_ASM_RXC == 1)
     ISR(USART0_RXC_vect) {
+      ISR_TRACE_ENTER(RXC);
       UartClass::_rx_complete_irq(Serial);
+      ISR_TRACE_EXIT(RXC);
     }
   #else
     ISR(USART0_RXC_vect, ISR_NAKED) {
       __asm__ __volatile__(
+            ISR_TRACE_ENTER_ASM(RXC)
             "push      r30"     "\n\t"
             "push      r31"     "\n\t"
             :::);
@@ -59,15 +69,17 @@
       __builtin_unreachable();
   }
   #endif
-  #if !(defined(USE_ASM_DRE) && USE_ASM_DRE == 1 && \
-       (SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) && \
-       (SERIAL_TX_BUFFER_SIZE == 128 || SERIAL_TX_BUFFER_SIZE == 64 || SERIAL_TX_BUFFER_SIZE == 32 || SERIAL_TX_BUFFER_SIZE == 16))
+  #if !(defined(USE_ASM_DRE) && USE_ASM_DRE == 1)
     ISR(USART0_DRE_vect) {
+      ISR_TRACE_ENTER(DRE);
+      TRACE_ISR(DRE, 0);
       UartClass::_tx_data_empty_irq(Serial);
+      ISR_TRACE_EXIT(DRE);
     }
   #else
     ISR(USART0_DRE_vect, ISR_NAKED) {
       __asm__ __volatile__(
+                ISR_TRACE_ENTER_ASM(DRE)
                 "push  r30"    "\n\t"
                 "push  r31"    "\n\t"
                 :::);
@@ -78,5 +90,7 @@
     }
   #endif
 
-  UartClass Serial(&USART0, 0, HWSERIAL0_MUX_DEFAULT);
+  static volatile uint8_t _rx_buffer0[SERIAL0_RX_BUFFER_SIZE];
+  static volatile uint8_t _tx_buffer0[SERIAL0_TX_BUFFER_SIZE];
+  UartClass Serial(&USART0, 0, HWSERIAL0_MUX_DEFAULT, _rx_buffer0, SERIAL0_RX_BUFFER_SIZE - 1, _tx_buffer0, SERIAL0_TX_BUFFER_SIZE - 1);
 #endif
@@ -12,6 +12,7 @@
 #include "Arduino.h"
 #include "UART.h"
 #include "UART_private.h"
+#include <util/delay_basic.h>
 
 #if defined(USART1)
 // see comments in USART.cpp for explanation.
@@ -33,16 +34,25 @@
       ctrla       |= USART_RXCIE_bm; // turn on receive complete
       ctrla       &= ~USART_TXCIE_bm; // turn off transmit complete
       USART1.CTRLA = ctrla;
+      if (_usart_de[1].mask) {           // RS-485 driver enable - hold it for the guard time, then let go.
+        if (_usart_de[1].guard) {
+          _delay_loop_2(_usart_de[1].guard);
+        }
+        *(_usart_de[1].outclr) = _usart_de[1].mask;
+      }
     }
   #endif
 
-  #if !(defined(USE_ASM_RXC) && USE_ASM_RXC == 1 && (SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16))
+  #if !(defined(USE_ASM_RXC) && USE_ASM_RXC == 1)
     ISR(USART1_RXC_vect) {
+      ISR_TRACE_ENTER(RXC);
       UartClass::_rx_complete_irq(Serial1);
+      ISR_TRACE_EXIT(RXC);
     }
   #else
     ISR(USART1_RXC_vect, ISR_NAKED) {
       __asm__ __volatile__(
+            ISR_TRACE_ENTER_ASM(RXC)
             "push      r30"     "\n\t"
             "push      r31"     "\n\t"
             :::);
@@ -52,15 +62,17 @@
       __builtin_unreachable();
   }
   #endif
-  #if !(defined(USE_ASM_DRE) && USE_ASM_DRE == 1 && \
-             (SERIAL_RX_BUFFER_SIZE == 128 || SERIAL_RX_BUFFER_SIZE == 64 || SERIAL_RX_BUFFER_SIZE == 32 || SERIAL_RX_BUFFER_SIZE == 16) && \
-             (SERIAL_TX_BUFFER_SIZE == 128 || SERIAL_TX_BUFFER_SIZE == 64 || SERIAL_TX_BUFFER_SIZE == 32 || SERIAL_TX_BUFFER_SIZE == 16))
+  #if !(defined(USE_ASM_DRE) && USE_ASM_DRE == 1)
     ISR(USART1_DRE_vect) {
+      ISR_TRACE_ENTER(DRE);
+      TRACE_ISR(DRE, 1);
       UartClass::_tx_data_empty_irq(Serial1);
+      ISR_TRACE_EXIT(DRE);
     }
   #else
     ISR(USART1_DRE_vect, ISR_NAKED) {
       __asm__ __volatile__(
+                ISR_TRACE_ENTER_ASM(DRE)
                 "push  r30"    "\n\t"
                 "push  r31"    "\n\t"
                 :::);
@@ -71,5 +83,7 @@
     }
   #endif
 
-  UartClass Serial1(&USART1, 1, HWSERIAL1_MUX_DEFAULT);
+  static volatile uint8_t _rx_buffer1[SERIAL1_RX_BUFFER_SIZE];
+  static volatile uint8_t _tx_buffer1[SERIAL1_TX_BUFFER_SIZE];
+  UartClass Serial1(&USART1, 1, HWSERIAL1_MUX_DEFAULT, _rx_buffer1, SERIAL1_RX_BUFFER_SIZE - 1, _tx_buffer1, SERIAL1_TX_BUFFER_SIZE - 1);
 #endif // HAVE_HWSERIAL1
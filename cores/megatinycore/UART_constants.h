@@ -31,13 +31,16 @@
   #define SERIAL_DATA_9L       (badArg("9-bit serial not supported"),0x06)
   #define SERIAL_DATA_9H       (badArg("9-bit serial not supported"),0x07)
   #define SERIAL_DATA_MASK     (USART_CHSIZE_gm)
+  // The only 9-bit mode there is: the 9th bit is the address flag for multi-processor communication (setAddress()).
+  #define SERIAL_MPCM          (SERIAL_MODE_ASYNC | SERIAL_STOP_BIT_1 | SERIAL_PARITY_NONE | USART_CHSIZE_9BITH_gc)
 /* 9-bit is a can of worms. Aggressive ones with sharp teeth,
  * hungry for soft fle-- oh, hm, it seems to be a typo, it says "flash"...
  *
  * It would be a nightmare to support overhead of everything is
  * greatly increased because you have to switch from 8-bit to
  * 16-bit types.
- * Nothing uses 9-bit serial! Including our implementation.
+ * Nothing uses 9-bit serial! Including our implementation - except for
+ * SERIAL_MPCM, where the 9th bit only marks addresses, and data is 8 bits.
  *
  * A future update may mask off 0x04 from this bitfield before writing it
  * so that SERIAL_DATA_5 could be #defined as 0x04. That way, before masking it, we
@@ -115,11 +118,16 @@
 #endif
   #define SERIAL_OPENDRAIN      ((uint16_t)                0x0400)// 0x0400
   #define SERIAL_LOOPBACK      (((uint16_t) USART_LBME_bm)   << 8)// 0x0800
+  #define SERIAL_AUTOBAUD      ((uint16_t)                0x1000)// 0x1000 Generic auto-baud - BAUD is set by the hardware from the sync after each break.
   #define SERIAL_TX_ONLY       (((uint16_t) USART_RXEN_bm)   << 8)// 0x8000 The TXEN/RXEN bits are swapped - we invert the meaning of this bit.
   #define SERIAL_RX_ONLY       (((uint16_t) USART_TXEN_bm)   << 8)// 0x4000 so if not specified, you get a serial port with both pins. Do not specify both. That will not enable anything.
 //#define SERIAL_MODE_SYNC      Defined Above                     // 0x0040 - works much like a modifier to enable synchronous mode.
 // See the Serial reference for more information as additional steps are required
   #define SERIAL_HALF_DUPLEX     (SERIAL_LOOPBACK | SERIAL_OPENDRAIN)
+
+/* Break lengths for sendBreak(), in bits at the baud rate in use */
+  #define SERIAL_BREAK_LIN     (13)   // LIN: at least 13 bits, then a delimiter of at least 1
+  #define SERIAL_BREAK_DMX     (27)   // DMX512 at 250 kbaud: 108 us, then a 12 us mark after break
   //
 
 
@@ -0,0 +1,88 @@
+/* UART_idle.cpp - Idle line (frame gap) detection for UartClass
+ * This library is free software released under LGPL 2.1.
+ * See License.md for more information.
+ * This file is part of megaTinyCore.
+ *
+ * This is in its own file so that the TCB ISRs only get linked in
+ * when onFrame() is actually used. They are weak, so if something
+ * else (millis, tone, Servo) has claimed that TCB, theirs wins - you
+ * can't use the same TCB for two things anyway.
+ */
+
+#include "Arduino.h"
+#include "UART.h"
+
+#if defined(USART0) || defined(USART1)
+
+static UartClass * _idle_owner[2]; // which UartClass each TCB is timing, indexed by TCB number.
+static uint8_t     _idle_defer[2]; // and whether its callback is deferred
+
+bool UartClass::onFrame(volatile TCB_t *timer, uint8_t bit_times, void (*callback)(uint8_t length), uint8_t deferred) {
+  uint8_t tcbnum = 0;
+  if (timer != &TCB0) {
+    #if defined(TCB1)
+      if (timer != &TCB1) {
+        return false;
+      }
+      tcbnum = 1;
+    #else
+      return false;
+    #endif
+  }
+  // BAUD is 4x the bit time in clocks, or 8x with CLK2X. Work it out from the registers, so this is right
+  // whatever begin() decided to do.
+  volatile USART_t* usart = _hwserial_module;
+  uint32_t ticks          = (uint32_t)(usart->BAUD) * bit_times;
+  ticks                 >>= ((usart->CTRLB & USART_RXMODE0_bm) ? 3 : 2);
+  uint8_t clksel          = TCB_CLKSEL_DIV1_gc;
+  if (ticks > 0xFFFF) {
+    ticks               >>= 1;
+    clksel                = TCB_CLKSEL_DIV2_gc;
+    if (ticks > 0xFFFF) {
+      ticks               = 0xFFFF; // Longest gap we can time; only matters for very long gaps at low baud rates.
+    }
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  noOnFrame();
+  _idle_owner[tcbnum] = this;
+  _idle_defer[tcbnum] = deferred;
+  _idle_timer         = timer;
+  _frame_callback     = callback;
+  timer->CTRLA        = 0;
+  timer->CTRLB        = TCB_CNTMODE_INT_gc;
+  timer->CCMP         = (uint16_t) ticks;
+  timer->CNT          = 0;
+  timer->INTFLAGS     = TCB_CAPT_bm;
+  timer->INTCTRL      = TCB_CAPT_bm;
+  timer->CTRLA        = clksel;   // Not enabled - the RXC ISR does that when a character arrives.
+  _state             |= 8;
+  SREG = oldSREG;
+  return true;
+}
+
+void UartClass::_idle_timer_irq(UartClass& uartClass) {
+  volatile TCB_t* timer = uartClass._idle_timer;
+  timer->CTRLA   &= ~TCB_ENABLE_bm; // one shot - stays off until the next character.
+  timer->INTFLAGS = TCB_CAPT_bm;
+  uartClass._frame_ready = 1;
+  if (uartClass._frame_callback) {
+    _deferOrCall(uartClass._frame_callback, (uint8_t) uartClass.available(), _idle_defer[timer == &TCB0 ? 0 : 1]);
+  }
+}
+
+ISR(TCB0_INT_vect, __attribute__((weak))) {
+  if (_idle_owner[0]) {
+    UartClass::_idle_timer_irq(*_idle_owner[0]);
+  }
+}
+
+#if defined(TCB1)
+  ISR(TCB1_INT_vect, __attribute__((weak))) {
+    if (_idle_owner[1]) {
+      UartClass::_idle_timer_irq(*_idle_owner[1]);
+    }
+  }
+#endif
+
+#endif
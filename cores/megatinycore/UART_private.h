@@ -15,8 +15,10 @@
 #if defined(USART0) || defined(USART1)
 /* Significant changes in UART.cpp, UART.h, and UART_swap.h required to support more UARTs */
 
-UartClass::UartClass(volatile USART_t *hwserial_module, uint8_t module_number, uint8_t mux_default) :
-    _hwserial_module(hwserial_module), _module_number(module_number), _pin_set(mux_default) {
+UartClass::UartClass(volatile USART_t *hwserial_module, uint8_t module_number, uint8_t mux_default,
+                     volatile uint8_t *rx_buffer, rx_buffer_index_t rx_mask, volatile uint8_t *tx_buffer, tx_buffer_index_t tx_mask) :
+    _hwserial_module(hwserial_module), _module_number(module_number), _pin_set(mux_default),
+    _rx_buffer(rx_buffer), _tx_buffer(tx_buffer), _rx_buffer_mask(rx_mask), _tx_buffer_mask(tx_mask) {
 }
 
 #endif
@@ -136,6 +136,7 @@
       "mov   r26,   r16"  "\n\t" // r16 to x reg low byte
       "ldi   r27,     0"  "\n\t" // clear x high byte
       "ld    r15,     X"  "\n\t" // Load flags to r15"
+      _TRACE_PINS_ASM
       "sbiw  r26,     0"  "\n\t" // this will set flag if it's zero.
       "breq  AIntEnd"     "\n\t" // port not enabled, null pointer, just clear flags end hit the exit ramp.
       "mov   r17,   r15"  "\n\t" // copy that flags to r17
@@ -178,6 +179,7 @@
       "out   0x3f,  r0"   "\n\t" // between these is where there had been stuff added to the stack that we flushed.
       "pop   r0"          "\n\t"
       "pop   r16"         "\n\t" // this was the reg we pushed back in the port-specific file.
+      ISR_TRACE_EXIT_ASM(PINS)
       "reti"              "\n"  // now we should have the pointer to the return address fopr the ISR on top of the stack, so reti're
       :: "x" ((uint16_t)(&intFunc))
       );
@@ -228,6 +230,7 @@
     #ifdef PORTA_PINS
       ISR(PORTA_PORT_vect, ISR_NAKED) {
       asm volatile(
+        ISR_TRACE_ENTER_ASM(PINS)
         "push r16"      "\n\t"
         "ldi r16, 0"    "\n\t"
     #if PROGMEM_SIZE > 8192
@@ -242,6 +245,7 @@
     #ifdef PORTB_PINS
       ISR(PORTB_PORT_vect, ISR_NAKED) {
       asm volatile(
+        ISR_TRACE_ENTER_ASM(PINS)
         "push r16"      "\n\t"
         "ldi r16, 2"    "\n\t"
     #if PROGMEM_SIZE > 8192
@@ -256,6 +260,7 @@
     #ifdef PORTC_PINS
       ISR(PORTC_PORT_vect, ISR_NAKED) {
       asm volatile(
+        ISR_TRACE_ENTER_ASM(PINS)
         "push r16"      "\n\t"
         "ldi r16, 4"    "\n\t"
     #if PROGMEM_SIZE > 8192
@@ -413,7 +418,12 @@
 
   #define IMPLEMENT_ISR(vect, port) \
   ISR(vect) { \
+    ISR_TRACE_ENTER(PINS);\
+    if (CORE_TRACE_ISRS & TRACE_ISR_PINS) {\
+      TRACE(TRACE_ID_PINS + port, *(volatile uint8_t *)(port * 4 + 3));\
+    }\
     port_interrupt_handler(port);\
+    ISR_TRACE_EXIT(PINS);\
   } \
 
 
@@ -21,6 +21,7 @@
      */
     ISR(PORTA_PORT_vect, ISR_NAKED) {
       asm volatile(
+        ISR_TRACE_ENTER_ASM(PINS)
         "push r16"        "\n\t"
         "ldi r16, 0"      "\n\t"
 #if PROGMEM_SIZE > 8192
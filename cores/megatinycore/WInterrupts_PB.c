@@ -13,6 +13,7 @@
     }
     ISR(PORTB_PORT_vect, ISR_NAKED) {
       asm volatile(
+        ISR_TRACE_ENTER_ASM(PINS)
         "push r16"        "\n\t"
         "ldi r16, 2"      "\n\t"
 #if PROGMEM_SIZE > 8192
@@ -0,0 +1,86 @@
+/* WInterrupts_queue.c - the queue and counters behind QUEUED_PORT_ISR() and COUNTED_PORT_ISR()
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The ISRs are macros in Arduino.h, which the sketch invokes for the ports it wants, for the same reason as
+ * FAST_PIN_ISR(): the vector can't be defined here without taking it from attachInterrupt() for every sketch. They
+ * are written so the compiler only needs a handful of registers, and don't call anything, so the overhead is the
+ * ordinary ISR prologue and epilogue instead of attachInterrupt()'s full register save and icall per pin.
+ *
+ * The queue only has one writer (the port ISRs, which can't interrupt each other) and one reader, and the head and
+ * tail are single bytes, so neither side needs to disable interrupts: the ISR fills in an entry before moving the
+ * head past it, and pinEventRead() copies it out before moving the tail. The counts are 16 bits, so reading one
+ * does.
+ */
+
+#include "wiring_private.h"
+
+volatile pin_event_t _pin_event_queue[CORE_PIN_EVENT_QUEUE_SIZE];
+volatile uint8_t     _pin_event_head;
+volatile uint8_t     _pin_event_tail;
+volatile uint8_t     _pin_event_overflow;
+#if defined(PORTC_PINS)
+  volatile uint16_t  _pin_event_counts[24];
+#elif defined(PORTB_PINS)
+  volatile uint16_t  _pin_event_counts[16];
+#else
+  volatile uint16_t  _pin_event_counts[8];
+#endif
+
+/* Start the timer the timestamps come from counting at F_CPU/2, unless something else already started it - then it
+ * is only read, same as SoftwareSerialTCB does, and the times are in whatever units that uses. */
+void pinEventBegin() {
+  #if defined(PIN_EVENT_TCB)
+    if (!(PIN_EVENT_TCB.CTRLA & TCB_ENABLE_bm)) {
+      PIN_EVENT_TCB.CTRLB = TCB_CNTMODE_INT_gc;   // periodic interrupt mode, with the interrupt off: just counting
+      PIN_EVENT_TCB.CCMP  = 0xFFFF;
+      PIN_EVENT_TCB.CTRLA = TCB_CLKSEL_DIV2_gc | TCB_ENABLE_bm;
+    }
+  #endif
+}
+
+uint8_t pinEventAvailable() {
+  return (_pin_event_head - _pin_event_tail) & (CORE_PIN_EVENT_QUEUE_SIZE - 1);
+}
+
+bool pinEventRead(pin_event_t *event) {
+  uint8_t tail = _pin_event_tail;
+  if (tail == _pin_event_head) {
+    return false;
+  }
+  event->port  = _pin_event_queue[tail].port;
+  event->flags = _pin_event_queue[tail].flags;
+  event->time  = _pin_event_queue[tail].time;
+  _pin_event_tail = (tail + 1) & (CORE_PIN_EVENT_QUEUE_SIZE - 1);
+  return true;
+}
+
+bool pinEventOverflow() {
+  bool ret = _pin_event_overflow;
+  _pin_event_overflow = 0;
+  return ret;
+}
+
+static uint16_t _pin_event_count(uint8_t pin, bool reset) {
+  uint8_t bitpos = digitalPinToBitPosition(pin);
+  if (bitpos == NOT_A_PIN) {
+    return 0;
+  }
+  volatile uint16_t *count = &_pin_event_counts[digitalPinToPort(pin) * 8 + bitpos];
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t ret = *count;
+  if (reset) {
+    *count = 0;
+  }
+  SREG = oldSREG;
+  return ret;
+}
+
+uint16_t pinEventCount(uint8_t pin) {
+  return _pin_event_count(pin, false);
+}
+
+uint16_t pinEventCountReset(uint8_t pin) {
+  return _pin_event_count(pin, true);
+}
@@ -24,11 +24,115 @@
 extern "C" {
 #include "stdlib.h"
 }
+#include "Arduino.h"
+
+/* random8() and random16() are a 16-bit xorshift (shifts 7, 9, 8, so every shift is a byte move and at most one
+ * single bit shift), period 65535 - a few dozen clocks, against random()'s 32-bit multiply and divide. That's plenty
+ * for LED effects, dithering and backoff times, nowhere near enough for anything that's meant to be secure.
+ * randomSeed() seeds both. */
+static uint16_t _xorshift_state = 0xACE1;
+
+uint16_t random16() {
+  uint16_t x = _xorshift_state;
+  x ^= x << 7;
+  x ^= x >> 9;
+  x ^= x << 8;
+  _xorshift_state = x;
+  return x;
+}
+
+uint8_t random8() {
+  return random16() >> 8;
+}
+
+/* 0 to howbig - 1, by multiplying: the high half of random * howbig. Taken alone that's slightly biased whenever
+ * howbig isn't a power of 2, so the few values of the low half that would make it so are drawn again (Lemire's
+ * method); the modulo that finds them only happens when the low half is small enough that it might be needed. */
+uint8_t random8(uint8_t howbig) {
+  uint16_t m = (uint16_t)random8() * howbig;
+  if ((uint8_t)m < howbig) {
+    uint8_t threshold = (uint8_t)(-howbig) % howbig;
+    while ((uint8_t)m < threshold) {
+      m = (uint16_t)random8() * howbig;
+    }
+  }
+  return m >> 8;
+}
+
+uint8_t random8(uint8_t howsmall, uint8_t howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return howsmall + random8(howbig - howsmall);
+}
+
+uint16_t random16(uint16_t howbig) {
+  uint32_t m = (uint32_t)random16() * howbig;
+  if ((uint16_t)m < howbig) {
+    uint16_t threshold = (uint16_t)(-howbig) % howbig;
+    while ((uint16_t)m < threshold) {
+      m = (uint32_t)random16() * howbig;
+    }
+  }
+  return m >> 16;
+}
+
+uint16_t random16(uint16_t howsmall, uint16_t howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return howsmall + random16(howbig - howsmall);
+}
 
 void randomSeed(unsigned long seed) {
   if (seed != 0) {
     srandom(seed);
+    uint16_t x = (uint16_t)seed ^ (uint16_t)(seed >> 16);
+    _xorshift_state = x ? x : 0xACE1;
+  }
+}
+
+/* Entropy from the hardware: the low bits of the temperature sensor reading (the ADC's noise, mostly), and how many
+ * times a loop runs during a tick of the RTC, which is clocked by the 32 kHz internal oscillator - that and the
+ * main clock drift and jitter independently, so the count varies by a few either way. The RTC part is skipped if
+ * something else already has the RTC running. Takes a few ms. The result is mixed, passed to randomSeed() and
+ * returned, in case you want to keep it. */
+uint32_t randomSeedHardware() {
+  uint32_t seed = 0;
+  for (uint8_t i = 0; i < 32; i++) {
+    seed = ((seed << 3) | (seed >> 29)) ^ (uint16_t)analogRead(ADC_TEMPERATURE);
+  }
+  #if !defined(MILLIS_USE_TIMERRTC)
+  if (!(RTC.CTRLA & RTC_RTCEN_bm)) {
+    while (RTC.STATUS);
+    uint8_t clksel = RTC.CLKSEL;
+    RTC.CLKSEL = RTC_CLKSEL_INT32K_gc;
+    RTC.CTRLA = RTC_RTCEN_bm;
+    for (uint8_t i = 0; i < 32; i++) {
+      uint8_t cnt = RTC.CNTL;
+      uint8_t loops = 0;
+      while (RTC.CNTL == cnt) {
+        loops++;
+      }
+      seed = ((seed << 3) | (seed >> 29)) ^ loops;
+    }
+    while (RTC.STATUS);
+    RTC.CTRLA = 0;
+    while (RTC.STATUS);
+    RTC.CLKSEL = clksel;
+  }
+  #endif
+  // murmur3's finalizer, so every bit of what was collected affects every bit of the seed
+  seed ^= seed >> 16;
+  seed *= 0x85EBCA6BUL;
+  seed ^= seed >> 13;
+  seed *= 0xC2B2AE35UL;
+  seed ^= seed >> 16;
+  if (!seed) {
+    seed = 1;
   }
+  randomSeed(seed);
+  return seed;
 }
 
 long random(long howbig) {
@@ -31,6 +31,7 @@
   #include "HardwareSerial.h"
   #include "IPAddress.h"
   #include "Print.h"
+  #include "BufferedPrint.h"
   #include "Printable.h"
   #include "PluggableUSB.h"
   #include "Server.h"
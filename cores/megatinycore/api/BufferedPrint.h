@@ -0,0 +1,93 @@
+/*
+  BufferedPrint.h - collects what's printed into a buffer and hands it to another Print in blocks
+  Part of megaTinyCore.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include <string.h>
+#include "Print.h"
+
+/* print() and printf() write a character at a time, and each one is a virtual call into the device, which then
+ * does its per-write work (disabling interrupts, moving the buffer head, starting an I2C or SD transfer...) for that
+ * one byte. BufferedPrint<N> collects up to N bytes and passes them on with a single write(buffer, size), which
+ * Serial, Wire and SD's File all implement as a block transfer:
+ *
+ *   BufferedPrint<32> out(Serial);
+ *   out.print(F("T="));
+ *   out.print(temperature);
+ *   out.println();
+ *   out.flush();  // or let it go out of scope
+ *
+ * Anything still buffered is written when it is flushed or destroyed; flush() doesn't flush the device underneath,
+ * since for Serial that means waiting for the transmission to finish. Use out.device().flush() for that. A write
+ * that's larger than the buffer bypasses it (after sending what was already buffered). N can be up to 255, and the
+ * buffer lives wherever the BufferedPrint does - on the stack for a local one. */
+template <uint8_t N = 32>
+class BufferedPrint : public Print {
+  public:
+    BufferedPrint(Print &out) : _out(out), _len(0) {}
+    ~BufferedPrint() {
+      flush();
+    }
+
+    virtual size_t write(uint8_t c) {
+      _buf[_len++] = c;
+      if (_len == N) {
+        flush();
+      }
+      return 1;
+    }
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      if (size >= (size_t)(N - _len)) {
+        flush();
+        if (size >= N) {
+          return _check(_out.write(buffer, size), size);
+        }
+      }
+      memcpy(_buf + _len, buffer, size);
+      _len += size;
+      return size;
+    }
+    using Print::write;
+
+    virtual int availableForWrite() {
+      return N - _len;
+    }
+    // Passes on whatever is buffered
+    virtual void flush() {
+      if (_len) {
+        uint8_t len = _len;
+        _len = 0;
+        _check(_out.write(_buf, len), len);
+      }
+    }
+    Print &device() {
+      return _out;
+    }
+
+  private:
+    size_t _check(size_t written, size_t size) {
+      if (written != size) {
+        setWriteError();
+      }
+      return written;
+    }
+    Print &_out;
+    uint8_t _len;
+    uint8_t _buf[N];
+};
@@ -72,14 +72,27 @@ size_t Print::print(char c) {
 }
 
 size_t Print::print(unsigned char b, int base) {
+  if (base == 10) {
+    return printDec((uint16_t) b);
+  }
   return print((unsigned long) b, base);
 }
 
 size_t Print::print(int n, int base) {
+  if (base == 10) {
+    if (n < 0) {
+      int t = print('-');
+      return printDec((uint16_t) - (uint16_t) n) + t;
+    }
+    return printDec((uint16_t) n);
+  }
   return print((long) n, base);
 }
 
 size_t Print::print(unsigned int n, int base) {
+  if (base == 10) {
+    return printDec((uint16_t) n);
+  }
   return print((unsigned long) n, base);
 }
 
@@ -120,6 +133,25 @@ size_t Print::print(const Printable &x) {
   return x.printTo(*this);
 }
 
+size_t Print::printFixed(int32_t value, uint8_t fracBits, uint8_t decimals) {
+  size_t n = 0;
+  uint32_t mag = value;
+  if (value < 0) {
+    n += print('-');
+    mag = -mag;
+  }
+  if (fracBits > 31) {
+    fracBits = 31;
+  }
+  uint32_t frac = mag & ((1UL << fracBits) - 1);
+  if (fracBits > 28) {
+    // so that frac * 10 still fits in 32 bits; what's lost is below the 8th decimal place.
+    frac >>= fracBits - 28;
+    return printFixedParts(mag >> fracBits, frac, 28, decimals) + n;
+  }
+  return printFixedParts(mag >> fracBits, frac, fracBits, decimals) + n;
+}
+
 size_t Print::println(void) {
   return write("\r\n");
 }
@@ -184,6 +216,26 @@ size_t Print::println(const Printable &x) {
   return n;
 }
 
+#if defined(CORE_PRINTF_TINY)
+/* Tools -> printf() -> Tiny: the core's own formatter instead of avr-libc's vfprintf(). It handles the flags '-' and
+ * '0', a field width, the 'l' (and ignored 'h') length modifiers, and %d %i %u %x %X %c %s %S (string in PROGMEM) %%
+ * - no precision, no floats, no %o %p or %n. Output is collected in a small buffer and passed on in blocks. */
+int16_t Print::printf(const char *format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  int16_t n = vprintfTiny(format, false, ap);
+  va_end(ap);
+  return n;
+}
+
+int16_t Print::printf(const __FlashStringHelper *format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  int16_t n = vprintfTiny((const char *)format, true, ap);
+  va_end(ap);
+  return n;
+}
+#else
 // Custom implementation of printf borrowed from the teensy core files
 static int16_t printf_putchar(char c, FILE *fp) {
   ((class Print *)(fdev_get_udata(fp)))->write((uint8_t)c);
@@ -209,9 +261,91 @@ int16_t Print::printf(const __FlashStringHelper *format, ...) {
   va_start(ap, format);
   return vfprintf_P(&f, (const char *)format, ap);
 }
+#endif
 
 // Private Methods /////////////////////////////////////////////////////////////
 
+/* Decimal and power-of-two bases don't need a division per digit, which on an AVR is a 32-bit software division
+ * every time - hundreds of clocks. Decimal digits are found by subtracting powers of ten instead (at most 9 times
+ * each), with 16-bit arithmetic as soon as what's left fits; power-of-two bases are just shifts and masks. */
+static const uint32_t pow10_32[] PROGMEM = {1000000000, 100000000, 10000000, 1000000, 100000, 10000};
+static const uint16_t pow10_16[] PROGMEM = {1000, 100, 10};
+
+static char *decDigits16(char *str, uint16_t n, bool started) {
+  for (uint8_t i = 0; i < sizeof(pow10_16) / sizeof(pow10_16[0]); i++) {
+    uint16_t p = pgm_read_word(&pow10_16[i]);
+    char c = '0';
+    while (n >= p) {
+      n -= p;
+      c++;
+    }
+    if (started || c != '0') {
+      *str++ = c;
+      started = true;
+    }
+  }
+  *str++ = '0' + n;
+  *str = '\0';
+  return str;
+}
+
+size_t Print::printDec(unsigned long n) {
+  if (!(n >> 16)) {
+    return printDec((uint16_t) n);
+  }
+  char buf[11];
+  char *str = buf;
+  bool started = false;
+  for (uint8_t i = 0; i < sizeof(pow10_32) / sizeof(pow10_32[0]); i++) {
+    uint32_t p = pgm_read_dword(&pow10_32[i]);
+    char c = '0';
+    while (n >= p) {
+      n -= p;
+      c++;
+    }
+    if (started || c != '0') {
+      *str++ = c;
+      started = true;
+    }
+  }
+  // n < 10000 now, and at least one digit has been written, so the rest are all printed, zeros included.
+  decDigits16(str, (uint16_t) n, true);
+  return write(buf);
+}
+
+size_t Print::printDec(uint16_t n) {
+  char buf[6];
+  char *str = buf;
+  if (n >= 10000) {
+    char c = '0';
+    while (n >= 10000) {
+      n -= 10000;
+      c++;
+    }
+    *str++ = c;
+  }
+  decDigits16(str, n, str != buf);
+  return write(buf);
+}
+
+// base is 2, 4, 8, 16 or 32
+size_t Print::printPow2(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  uint8_t mask = base - 1;
+  uint8_t shift = 0;
+  while (base >>= 1) {
+    shift++;
+  }
+  *str = '\0';
+  do {
+    char c = (uint8_t) n & mask;
+    n >>= shift;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
 size_t Print::printNumber(unsigned long n, uint8_t base) {
   char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
   char *str = &buf[sizeof(buf) - 1];
@@ -222,6 +356,12 @@ size_t Print::printNumber(unsigned long n, uint8_t base) {
   if (base < 2) {
     base = 10;
   }
+  if (base == 10) {
+    return printDec(n);
+  }
+  if (!(base & (base - 1))) {
+    return printPow2(n, base);
+  }
 
   do {
     char c = n % base;
@@ -255,31 +395,174 @@ size_t Print::printFloat(double number, uint8_t digits) {
     number = -number;
   }
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i = 0; i < digits; ++i) {
-    rounding /= 10.0;
-  }
-
-  number += rounding;
-
-  // Extract the integer part of the number and print it
+  // Split off the integer part, and turn the rest into a fraction with 28 bits after the point - multiplying by a power of two is
+  // exact, and the rounding and digits are then done in integer math by printFixedParts().
   unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  n += print(int_part);
+  uint32_t frac = (uint32_t)((number - (double)int_part) * 268435456.0);
+  return printFixedParts(int_part, frac, 28, digits) + n;
+}
 
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0) {
-    n += print(".");
+/* Prints ipart, then (if decimals isn't 0) a decimal point and the fraction frac / 2^fracBits rounded to decimals
+ * places. fracBits must be at most 28, so frac * 10 can't overflow. A float doesn't have more than 9 meaningful
+ * decimal places, nor does 28 bits of fraction, so past that the digits are just zeros. */
+size_t Print::printFixedParts(unsigned long ipart, uint32_t frac, uint8_t fracBits, uint8_t decimals) {
+  char buf[9];
+  uint8_t nd = decimals > 9 ? 9 : decimals;
+  uint32_t mask = (1UL << fracBits) - 1;
+  for (uint8_t i = 0; i < nd; i++) {
+    frac *= 10;
+    buf[i] = '0' + (uint8_t)(frac >> fracBits);
+    frac &= mask;
   }
-
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0) {
-    remainder *= 10.0;
-    unsigned int toPrint = (unsigned int)remainder;
-    n += print(toPrint);
-    remainder -= toPrint;
+  // Round half up, carrying through the digits and into the integer part if they were all 9's
+  if (fracBits && (frac >> (fracBits - 1))) {
+    uint8_t i = nd;
+    while (true) {
+      if (i == 0) {
+        ipart++;
+        break;
+      }
+      i--;
+      if (buf[i] != '9') {
+        buf[i]++;
+        break;
+      }
+      buf[i] = '0';
+    }
+  }
+  size_t n = printDec(ipart);
+  if (decimals) {
+    n += print('.');
+    n += write(buf, nd);
+    while (decimals-- > nd) {
+      n += print('0');
+    }
   }
-
   return n;
 }
+
+#if defined(CORE_PRINTF_TINY)
+struct PrintfTinyOut {
+  Print *out;
+  int16_t count;
+  uint8_t len;
+  char buf[16];
+  void put(char c) {
+    buf[len++] = c;
+    if (len == sizeof(buf)) {
+      drain();
+    }
+  }
+  void pad(char c, int16_t n) {
+    while (n-- > 0) {
+      put(c);
+    }
+  }
+  void drain() {
+    count += out->write(buf, len);
+    len = 0;
+  }
+};
+
+int16_t Print::vprintfTiny(const char *format, bool pgm, va_list ap) {
+  PrintfTinyOut o;
+  o.out = this;
+  o.count = 0;
+  o.len = 0;
+  while (true) {
+    char c = pgm ? pgm_read_byte(format) : *format;
+    format++;
+    if (!c) {
+      break;
+    }
+    if (c != '%') {
+      o.put(c);
+      continue;
+    }
+    bool left = false, zero = false, islong = false;
+    uint8_t width = 0;
+    while (true) {
+      c = pgm ? pgm_read_byte(format) : *format;
+      format++;
+      if (c == '-') {
+        left = true;
+      } else if (c == '0' && !width) {
+        zero = true;
+      } else if (c >= '0' && c <= '9') {
+        width = width * 10 + c - '0';
+      } else if (c == 'l') {
+        islong = true;
+      } else if (c != 'h') {
+        break;
+      }
+    }
+    char num[12];
+    const char *str = num;
+    bool strpgm = false;
+    size_t len = 1;
+    bool neg = false;
+    switch (c) {
+      case 'c':
+        num[0] = (char)va_arg(ap, int);
+        break;
+      case 'S':
+        strpgm = true;
+        // fall through
+      case 's':
+        str = va_arg(ap, const char *);
+        if (!str) {
+          str = "(null)";
+          strpgm = false;
+        }
+        len = strpgm ? strlen_P(str) : strlen(str);
+        break;
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'x':
+      case 'X': {
+          unsigned long v;
+          if (c == 'd' || c == 'i') {
+            long sv = islong ? va_arg(ap, long) : va_arg(ap, int);
+            neg = sv < 0;
+            v = neg ? -(unsigned long)sv : sv;
+          } else {
+            v = islong ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+          }
+          ultoa(v, num, (c == 'x' || c == 'X') ? 16 : 10);
+          if (c == 'X') {
+            strupr(num);
+          }
+          len = strlen(num);
+          break;
+        }
+      case '\0':
+        format--; // a lone % at the end; don't run off the end of the string
+        len = 0;
+        break;
+      default:
+        num[0] = c;
+        break;
+    }
+    int16_t fill = width - (int16_t)len - neg;
+    if (!left && !zero) {
+      o.pad(' ', fill);
+    }
+    if (neg) {
+      o.put('-');
+    }
+    if (!left && zero) {
+      o.pad('0', fill);
+    }
+    while (len--) {
+      o.put(strpgm ? pgm_read_byte(str) : *str);
+      str++;
+    }
+    if (left) {
+      o.pad(' ', fill);
+    }
+  }
+  o.drain();
+  return o.count;
+}
+#endif
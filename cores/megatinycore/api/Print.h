@@ -20,6 +20,7 @@
 
 #include <inttypes.h>
 #include <stdio.h> // for size_t
+#include <stdarg.h>
 
 #include "String.h"
 #include "Printable.h"
@@ -33,6 +34,11 @@ class Print {
   private:
     int write_error;
     size_t printNumber(unsigned long, uint8_t);
+    size_t printDec(unsigned long);
+    size_t printDec(uint16_t);
+    size_t printPow2(unsigned long, uint8_t);
+    size_t printFixedParts(unsigned long, uint32_t, uint8_t, uint8_t);
+    int16_t vprintfTiny(const char *, bool, va_list);
     size_t printFloat(double, uint8_t);
   protected:
     void setWriteError(int err = 1) {
@@ -75,6 +81,8 @@ class Print {
     size_t print(unsigned long, int = DEC);
     size_t print(double, int = 2);
     size_t print(const Printable &);
+    // value is a fixed point number with fracBits fractional bits (so printFixed(x, 8) prints x / 256.0), printed rounded to decimals places
+    size_t printFixed(int32_t value, uint8_t fracBits, uint8_t decimals = 2);
 
     size_t println(const __FlashStringHelper *);
     size_t println(const String &s);
@@ -89,7 +97,8 @@ class Print {
     size_t println(const Printable &);
     size_t println(void);
 
-    int16_t printf(const char *format, ...);
+    // The format string is checked against the arguments at compile time, like for the standard printf()
+    int16_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
     int16_t printf(const __FlashStringHelper *format, ...);
 
     virtual void flush() { /* Empty implementation for backward compatibility */ }
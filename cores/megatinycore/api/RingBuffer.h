@@ -20,6 +20,7 @@
 #define _RING_BUFFER_
 
 #include <stdint.h>
+#include <stddef.h>
 
 // Define constants and variables for buffering incoming serial data.  We're
 // using a ring buffer (I think), in which head is the index of the location
@@ -59,4 +60,138 @@ class RingBuffer {
     volatile rb_index_type _iTail ;
 };
 
+#ifdef __cplusplus
+/* RingBufferN<N, T> - a fixed size ring buffer of N elements of type T (uint8_t by default), with no allocation,
+ * for one producer and one consumer, typically an ISR and the main code. Neither side needs to disable interrupts:
+ * only the producer writes the head, and only after the element is stored; only the consumer writes the tail.
+ * With N <= 256 the indices are 8-bit, so reading one is atomic; with larger N, the side reading the other's index
+ * reads it until it gets the same value twice. If N is a power of two the indices wrap with a mask, otherwise with a
+ * compare, which costs a couple of instructions more. Like the buffers in the core, it holds N - 1 elements. Calling
+ * push() from both the ISR and the main code, or pop() from both, is not safe, and clear() is a consumer call.
+ */
+template <bool SMALL> struct _RingBufferIndex {
+  typedef uint8_t type;
+};
+template <> struct _RingBufferIndex<false> {
+  typedef uint16_t type;
+};
+
+template <unsigned int N, typename T = uint8_t>
+class RingBufferN {
+    static_assert(N >= 2 && N <= 32768, "RingBufferN size must be between 2 and 32768");
+  public:
+    typedef typename _RingBufferIndex<(N <= 256)>::type index_t;
+
+    // constexpr, so a global one is just zeroed memory, with no constructor to run at startup
+    constexpr RingBufferN() : _buffer(), _head(0), _tail(0) {}
+
+    // producer side
+    bool push(const T &value) {
+      index_t head = _head;
+      index_t next = advance(head);
+      if (next == load(_tail)) {
+        return false;  // full
+      }
+      _buffer[head] = value;
+      __asm__ __volatile__("" ::: "memory");  // the element has to be there before the head says it is
+      _head = next;
+      return true;
+    }
+    // stores as many of the n elements as fit, and returns how many that was
+    size_t push(const T *src, size_t n) {
+      index_t head = _head;
+      index_t tail = load(_tail);
+      size_t count = 0;
+      while (count < n) {
+        index_t next = advance(head);
+        if (next == tail) {
+          break;
+        }
+        _buffer[head] = *src++;
+        head = next;
+        count++;
+      }
+      __asm__ __volatile__("" ::: "memory");
+      _head = head;
+      return count;
+    }
+    index_t availableForStore() const {
+      return N - 1 - used(_head, load(_tail));
+    }
+    bool isFull() const {
+      return advance(_head) == load(_tail);
+    }
+
+    // consumer side
+    bool pop(T &value) {
+      index_t tail = _tail;
+      if (tail == load(_head)) {
+        return false;  // empty
+      }
+      value = _buffer[tail];
+      __asm__ __volatile__("" ::: "memory");  // and it has to be read before the producer is told it can be reused
+      _tail = advance(tail);
+      return true;
+    }
+    // takes up to n elements, and returns how many it got
+    size_t pop(T *dst, size_t n) {
+      index_t tail = _tail;
+      index_t head = load(_head);
+      size_t count = 0;
+      while (count < n && tail != head) {
+        *dst++ = _buffer[tail];
+        tail = advance(tail);
+        count++;
+      }
+      __asm__ __volatile__("" ::: "memory");
+      _tail = tail;
+      return count;
+    }
+    bool peek(T &value) const {
+      index_t tail = _tail;
+      if (tail == load(_head)) {
+        return false;
+      }
+      value = _buffer[tail];
+      return true;
+    }
+    index_t available() const {
+      return used(load(_head), _tail);
+    }
+    bool isEmpty() const {
+      return load(_head) == _tail;
+    }
+    void clear() {
+      _tail = load(_head);
+    }
+
+  private:
+    static index_t advance(index_t i) {
+      if ((N & (N - 1)) == 0) {
+        return (index_t)(i + 1) & (N - 1);
+      }
+      return (index_t)(i + 1) == N ? 0 : i + 1;
+    }
+    static index_t used(index_t head, index_t tail) {
+      if ((N & (N - 1)) == 0) {
+        return (index_t)(head - tail) & (N - 1);
+      }
+      return head >= tail ? head - tail : N - tail + head;
+    }
+    static index_t load(const volatile index_t &i) {
+      index_t v = i;
+      if (sizeof(index_t) > 1) {
+        // the other side might be halfway through changing it
+        while (v != i) {
+          v = i;
+        }
+      }
+      return v;
+    }
+    T _buffer[N];
+    volatile index_t _head;
+    volatile index_t _tail;
+};
+#endif
+
 #endif /* _RING_BUFFER_ */
@@ -29,7 +29,10 @@
 
 int Stream::timedRead() {
   #if !defined(DISABLEMILLIS)
-  int c;
+  int c = read();
+  if (c >= 0) {
+    return c;     // no need to look at the time if it's already here
+  }
   _startMillis = millis();
   do {
     c = read();
@@ -60,7 +63,10 @@ int Stream::timedRead() {
 // private method to peek stream with timeout
 int Stream::timedPeek() {
   #if !defined(DISABLEMILLIS)
-  int c;
+  int c = peek();
+  if (c >= 0) {
+    return c;     // no need to look at the time if it's already here
+  }
   _startMillis = millis();
   do {
     c = peek();
@@ -119,6 +125,19 @@ int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal) {
   }
 }
 
+// consumes the character peek() returned, and returns the next one with timedPeek(). If the next one is already in
+// the buffer, that's one peekSpan() and one consume() instead.
+int Stream::advancePeek() {
+  const uint8_t *span;
+  if (peekSpan(&span) > 1) {
+    int c = span[1];
+    consume(1);
+    return c;
+  }
+  read();
+  return timedPeek();
+}
+
 // Public Methods
 //////////////////////////////////////////////////////////////
 
@@ -179,8 +198,7 @@ long Stream::parseInt(LookaheadMode lookahead, char ignore) {
     } else if (c >= '0' && c <= '9') {   // is c a digit?
       value = value * 10 + c - '0';
     }
-    read();  // consume the character we got with peek
-    c = timedPeek();
+    c = advancePeek();  // consume the character we got with peek
   } while ((c >= '0' && c <= '9') || c == ignore);
 
   if (isNegative) {
@@ -216,8 +234,7 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore) {
         fraction *= 0.1;
       }
     }
-    read();  // consume the character we got with peek
-    c = timedPeek();
+    c = advancePeek();  // consume the character we got with peek
   } while ((c >= '0' && c <= '9')  || (c == '.' && !isFraction) || c == ignore);
 
   if (isNegative) {
@@ -238,6 +255,19 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore) {
 size_t Stream::readBytes(char *buffer, size_t length) {
   size_t count = 0;
   while (count < length) {
+    const uint8_t *span;
+    size_t n = peekSpan(&span);
+    if (n) {
+      // copy what's already in the buffer in one go
+      if (n > length - count) {
+        n = length - count;
+      }
+      memcpy(buffer, span, n);
+      consume(n);
+      buffer += n;
+      count += n;
+      continue;
+    }
     int c = timedRead();
     if (c < 0) {
       break;
@@ -259,6 +289,24 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
   }
   size_t index = 0;
   while (index < length) {
+    const uint8_t *span;
+    size_t n = peekSpan(&span);
+    if (n) {
+      if (n > length - index) {
+        n = length - index;
+      }
+      const uint8_t *end = (const uint8_t *)memchr(span, terminator, n);
+      size_t copy = end ? (size_t)(end - span) : n;
+      memcpy(buffer, span, copy);
+      buffer += copy;
+      index += copy;
+      if (end) {
+        consume(copy + 1); // and the terminator
+        break;
+      }
+      consume(copy);
+      continue;
+    }
     int c = timedRead();
     if (c < 0 || c == terminator) {
       break;
@@ -299,63 +347,84 @@ int Stream::findMulti(struct Stream::MultiTarget *targets, int tCount) {
   }
 
   while (1) {
+    const uint8_t *span;
+    size_t n = peekSpan(&span);
+    if (n) {
+      // run what's already in the buffer through the search, and take only as much as the search used
+      for (size_t i = 0; i < n; i++) {
+        int found = findMultiStep(targets, tCount, span[i]);
+        if (found >= 0) {
+          consume(i + 1);
+          return found;
+        }
+      }
+      consume(n);
+      continue;
+    }
     int c = timedRead();
     if (c < 0) {
       return -1;
     }
+    int found = findMultiStep(targets, tCount, c);
+    if (found >= 0) {
+      return found;
+    }
+  }
+  // unreachable
+  return -1;
+}
 
-    for (struct MultiTarget *t = targets; t < targets + tCount; ++t) {
-      // the simple case is if we match, deal with that first.
-      if (c == t->str[t->index]) {
-        if (++t->index == t->len) {
-          return t - targets;
-        } else {
-          continue;
-        }
+int Stream::findMultiStep(struct Stream::MultiTarget *targets, int tCount, int c) {
+  for (struct MultiTarget *t = targets; t < targets + tCount; ++t) {
+    // the simple case is if we match, deal with that first.
+    if (c == t->str[t->index]) {
+      if (++t->index == t->len) {
+        return t - targets;
+      } else {
+        continue;
       }
+    }
 
-      // if not we need to walk back and see if we could have matched further
-      // down the stream (ie '1112' doesn't match the first position in '11112'
-      // but it will match the second position so we can't just reset the current
-      // index to 0 when we find a mismatch.
-      if (t->index == 0) {
+    // if not we need to walk back and see if we could have matched further
+    // down the stream (ie '1112' doesn't match the first position in '11112'
+    // but it will match the second position so we can't just reset the current
+    // index to 0 when we find a mismatch.
+    if (t->index == 0) {
+      continue;
+    }
+
+    int origIndex = t->index;
+    do {
+      --t->index;
+      // first check if current char works against the new current index
+      if (c != t->str[t->index]) {
         continue;
       }
 
-      int origIndex = t->index;
-      do {
-        --t->index;
-        // first check if current char works against the new current index
-        if (c != t->str[t->index]) {
-          continue;
-        }
+      // if it's the only char then we're good, nothing more to check
+      if (t->index == 0) {
+        t->index++;
+        break;
+      }
 
-        // if it's the only char then we're good, nothing more to check
-        if (t->index == 0) {
-          t->index++;
+      // otherwise we need to check the rest of the found string
+      int diff = origIndex - t->index;
+      size_t i;
+      for (i = 0; i < t->index; ++i) {
+        if (t->str[i] != t->str[i + diff]) {
           break;
         }
+      }
 
-        // otherwise we need to check the rest of the found string
-        int diff = origIndex - t->index;
-        size_t i;
-        for (i = 0; i < t->index; ++i) {
-          if (t->str[i] != t->str[i + diff]) {
-            break;
-          }
-        }
-
-        // if we successfully got through the previous loop then our current
-        // index is good.
-        if (i == t->index) {
-          t->index++;
-          break;
-        }
+      // if we successfully got through the previous loop then our current
+      // index is good.
+      if (i == t->index) {
+        t->index++;
+        break;
+      }
 
-        // otherwise we just try the next index
-      } while (t->index);
-    }
+      // otherwise we just try the next index
+    } while (t->index);
   }
-  // unreachable
   return -1;
 }
@@ -52,6 +52,7 @@ class Stream : public Print {
     int timedRead();    // private method to read stream with timeout
     int timedPeek();    // private method to peek stream with timeout
     int peekNextDigit(LookaheadMode lookahead, bool detectDecimal); // returns the next numeric digit in the stream or -1 if timeout
+    int advancePeek();  // consumes the character peek() returned, and returns the next (timed) peek()
 
   public:
     virtual int available() = 0;
@@ -59,6 +60,18 @@ class Stream : public Print {
     virtual int peek() = 0;
     virtual void flush() = 0;
 
+    // Streams with a receive buffer can let the parsing functions below scan it directly instead of doing a timed
+    // read() for each character: peekSpan() points span at the oldest character and returns how many are there,
+    // one after the other, and consume() discards n of them. If they aren't overridden, there's no buffer to scan.
+    virtual size_t peekSpan(const uint8_t **span) {
+      (void)span;
+      return 0;
+    }
+    virtual size_t consume(size_t n) {
+      (void)n;
+      return 0;
+    }
+
     Stream() {
       _timeout = 1000;
     }
@@ -144,6 +157,8 @@ class Stream : public Print {
     // This allows you to search for an arbitrary number of strings.
     // Returns index of the target that is found first or -1 if timeout occurs.
     int findMulti(struct MultiTarget * targets, int tCount);
+    // Feeds one character to the search; returns the index of the target it completes, or -1.
+    static int findMultiStep(struct MultiTarget * targets, int tCount, int c);
 };
 
 #undef NO_IGNORE_CHAR
@@ -111,7 +111,9 @@ String::String(double value, unsigned char decimalPlaces) {
 }
 
 String::~String() {
-  free(buffer);
+  if (onHeap()) {
+    free(buffer);
+  }
 }
 
 /*********************************************/
@@ -122,10 +124,17 @@ inline void String::init(void) {
   buffer = NULL;
   capacity = 0;
   len = 0;
+  fixed = 0;
 }
 
 void String::invalidate(void) {
-  if (buffer) {
+  if (fixed) {
+    // a StaticString keeps its buffer, and is just emptied
+    buffer[0] = 0;
+    len = 0;
+    return;
+  }
+  if (buffer && onHeap()) {
     free(buffer);
   }
   buffer = NULL;
@@ -146,6 +155,27 @@ unsigned char String::reserve(unsigned int size) {
 }
 
 unsigned char String::changeBuffer(unsigned int maxStrLen) {
+  if (fixed) {
+    return 0;
+  }
+  #if STRING_SSO_SIZE > 0
+  if (!buffer && maxStrLen <= STRING_SSO_SIZE) {
+    buffer = sso;
+    capacity = STRING_SSO_SIZE;
+    return 1;
+  }
+  if (buffer == sso) {
+    // outgrown the inline buffer: move to the heap
+    char *newbuffer = (char *)malloc(maxStrLen + 1);
+    if (!newbuffer) {
+      return 0;
+    }
+    memcpy(newbuffer, sso, len + 1);
+    buffer = newbuffer;
+    capacity = maxStrLen;
+    return 1;
+  }
+  #endif
   char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
   if (newbuffer) {
     buffer = newbuffer;
@@ -187,9 +217,19 @@ void String::move(String &rhs) {
       len = rhs.len;
       rhs.len = 0;
       return;
-    } else {
+    } else if (fixed) {
+      invalidate();
+      return;
+    } else if (onHeap()) {
       free(buffer);
     }
+    buffer = NULL;
+  }
+  if (rhs.buffer && !rhs.onHeap()) {
+    // its buffer is part of the object, so it can only be copied, not taken
+    copy(rhs.buffer, rhs.len);
+    rhs.len = 0;
+    return;
   }
   buffer = rhs.buffer;
   capacity = rhs.capacity;
@@ -43,6 +43,13 @@ class __FlashStringHelper;
 
 
 
+/* With STRING_SSO_SIZE defined (in build flags, for the core and sketch alike), every String carries that many bytes
+ * of storage inside itself, and only goes to the heap when its contents grow longer than that. It makes each String
+ * object STRING_SSO_SIZE + 1 bytes larger, so it is off by default. */
+#if !defined(STRING_SSO_SIZE)
+  #define STRING_SSO_SIZE 0
+#endif
+
 // An inherited class for holding the result of a concatenation.  These
 // result objects are assumed to be writable by subsequent concatenations.
 class StringSumHelper;
@@ -259,7 +266,22 @@ class String {
     char *buffer;         // the actual char array
     unsigned int capacity;  // the array length minus one (for the '\0')
     unsigned int len;       // the String length (not counting the '\0')
+    unsigned char fixed;    // buffer belongs to a StaticString - it never changes, and is never freed
+    #if STRING_SSO_SIZE > 0
+    char sso[STRING_SSO_SIZE + 1];
+    #endif
   protected:
+    // for StaticString: a String that lives in buf, which has room for a string of cap characters
+    String(char *buf, unsigned int cap) : buffer(buf), capacity(cap), len(0), fixed(1) {
+      buf[0] = 0;
+    }
+    inline bool onHeap(void) const {
+      #if STRING_SSO_SIZE > 0
+      return !fixed && buffer != sso;
+      #else
+      return !fixed;
+      #endif
+    }
     void init(void);
     void invalidate(void);
     unsigned char changeBuffer(unsigned int maxStrLen);
@@ -287,4 +309,38 @@ class StringSumHelper : public String {
     StringSumHelper(double num) : String(num) {}
 };
 
+/* A String that holds up to N characters in a buffer of its own and never uses the heap. It has the whole String
+ * API, and can be passed to anything that takes a String &. Anything that would make it longer than N fails the way
+ * running out of memory does for a String: concat() and += return false and leave it unchanged, reserve() returns
+ * false, and an assignment leaves it empty. Unlike a String it is never invalid. Results that come back as a new
+ * String - substring(), and operator + - are ordinary Strings, on the heap; use += to build up a StaticString. */
+template <unsigned int N>
+class StaticString : public String {
+  public:
+    StaticString() : String(storage, N) {}
+    StaticString(const char *cstr) : String(storage, N) {
+      *this = cstr;
+    }
+    StaticString(const __FlashStringHelper *pstr) : String(storage, N) {
+      *this = pstr;
+    }
+    StaticString(const String &str) : String(storage, N) {
+      *this = str;
+    }
+    StaticString(const StaticString &str) : String(storage, N) {
+      *this = str;
+    }
+    // numbers and single characters, as concat() would append them
+    template <typename T> explicit StaticString(T value) : String(storage, N) {
+      concat(value);
+    }
+    StaticString &operator = (const StaticString &rhs) {
+      String::operator = (rhs);
+      return *this;
+    }
+    using String::operator =;
+  private:
+    char storage[N + 1];
+};
+
 #endif  // __cplusplus
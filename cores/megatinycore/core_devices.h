@@ -420,3 +420,14 @@
 #endif
 // tinyAVR thus far doesn't have the TTL input level option. Probably MVIO only.
 #define PORT_HAS_INLVL 0
+
+/* Tools -> Optimize for -> Speed of hot paths passes CORE_OPTIMIZE_SPEED, and the functions marked HOT_PATH - the
+ * UART ISRs (the C versions; the asm ones are as fast as they get already), write() and read(), the TWI master
+ * transfers and slave ISR, and analogRead() - are built with -O2, while everything else stays -Os. It has to be per
+ * function, not per file, because the recipes in platform.txt are the same for every file; with LTO the attribute
+ * carries through to the link. Libraries can use it for their own inner loops. */
+#if defined(CORE_OPTIMIZE_SPEED)
+  #define HOT_PATH __attribute__((optimize("O2")))
+#else
+  #define HOT_PATH
+#endif
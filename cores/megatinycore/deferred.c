@@ -0,0 +1,96 @@
+/* deferred.c - the queue behind defer(), deferCall() and deferDispatch()
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * One ring per priority, of CORE_DEFER_QUEUE_SIZE entries. Only the ISRs write the heads, and only deferDispatch()
+ * the tails, so taking an entry off needs no critical section: the entry is read before the tail is moved past it.
+ * Putting one on does disable interrupts, for the dozen or so clocks it takes, as a level 1 ISR could post in the
+ * middle of a level 0 one doing the same.
+ *
+ * Like the timer service and the tasks, this is only linked in if the sketch calls one of these; the libraries and
+ * yield() only have a weak reference to it, and call the callbacks directly (or do nothing) when it isn't.
+ */
+
+#include "wiring_private.h"
+
+#if !defined(CORE_DEFER_QUEUE_SIZE)
+  #if (INTERNAL_SRAM_SIZE < 512)
+    #define CORE_DEFER_QUEUE_SIZE 4
+  #else
+    #define CORE_DEFER_QUEUE_SIZE 8
+  #endif
+#endif
+#if (CORE_DEFER_QUEUE_SIZE & (CORE_DEFER_QUEUE_SIZE - 1)) || CORE_DEFER_QUEUE_SIZE > 128
+  #error "CORE_DEFER_QUEUE_SIZE must be a power of 2, no larger than 128"
+#endif
+
+#define DEFER_NOARG    (0x01)   // in flags: func is a voidFuncPtr
+#define DEFER_LOWBIT   (0x40)   // in flags: DEFERRED_LOW
+
+typedef struct {
+  uint16_t func;
+  uint8_t  arg;
+  uint8_t  flags;
+} _defer_entry_t;
+
+static volatile _defer_entry_t _defer_queue[2][CORE_DEFER_QUEUE_SIZE];
+static volatile uint8_t        _defer_head[2];
+static volatile uint8_t        _defer_tail[2];
+static uint8_t                 _defer_running;  // a delay() in a deferred function calls yield(), which mustn't recurse
+
+bool _defer_post(uint16_t func, uint8_t arg, uint8_t flags) {
+  uint8_t level = (flags & DEFER_LOWBIT) ? 1 : 0;
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t head = _defer_head[level];
+  uint8_t next = (head + 1) & (CORE_DEFER_QUEUE_SIZE - 1);
+  bool ok = (next != _defer_tail[level]);
+  if (ok) {
+    _defer_queue[level][head].func  = func;
+    _defer_queue[level][head].arg   = arg;
+    _defer_queue[level][head].flags = flags;
+    _defer_head[level] = next;
+  }
+  SREG = oldSREG;
+  return ok;
+}
+
+bool defer(deferFunc_t func, uint8_t arg, uint8_t priority) {
+  return _defer_post((uint16_t)func, arg, priority == DEFER_LOW ? DEFER_LOWBIT : 0);
+}
+
+bool deferCall(voidFuncPtr func, uint8_t priority) {
+  return _defer_post((uint16_t)func, 0, (priority == DEFER_LOW ? DEFER_LOWBIT : 0) | DEFER_NOARG);
+}
+
+/* Runs one from that level if there is one. */
+static bool _defer_run(uint8_t level) {
+  uint8_t tail = _defer_tail[level];
+  if (tail == _defer_head[level]) {
+    return false;
+  }
+  uint16_t func  = _defer_queue[level][tail].func;
+  uint8_t  arg   = _defer_queue[level][tail].arg;
+  uint8_t  flags = _defer_queue[level][tail].flags;
+  _defer_tail[level] = (tail + 1) & (CORE_DEFER_QUEUE_SIZE - 1);
+  if (flags & DEFER_NOARG) {
+    ((voidFuncPtr)func)();
+  } else {
+    ((deferFunc_t)func)(arg);
+  }
+  return true;
+}
+
+uint8_t deferDispatch() {
+  if (_defer_running) {
+    return 0;
+  }
+  _defer_running = 1;
+  uint8_t ran = 0;
+  // every high one, then a low one, then any high ones posted meanwhile, and so on
+  while (_defer_run(0) || _defer_run(1)) {
+    ran++;
+  }
+  _defer_running = 0;
+  return ran;
+}
@@ -0,0 +1,100 @@
+/* event_trace.cpp - the ring behind TRACE(), and traceDump()
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Everything is in .noinit, so that what was recorded before a WDT or software reset is still there afterwards.
+ * _trace_magic says whether it holds a ring at all, rather than whatever the RAM powered up with.
+ */
+
+#include "Arduino.h"
+
+#if defined(CORE_TRACE)
+
+#define TRACE_MAGIC 0x5254                // "TR"
+
+trace_event_t    _trace_ring[CORE_TRACE_SIZE]  __attribute__((section(".noinit")));
+volatile uint8_t _trace_head                   __attribute__((section(".noinit")));
+volatile uint8_t _trace_wrapped                __attribute__((section(".noinit")));
+volatile uint8_t _trace_paused;
+static uint16_t  _trace_magic                  __attribute__((section(".noinit")));
+
+/* Called first thing in init(). The reset flags are in GPIOR0 by then, whether Optiboot or init_reset_flags() put
+ * them there. */
+void _trace_init() {
+  uint8_t flags = GPIOR0;
+  if (_trace_magic != TRACE_MAGIC || (flags & RSTCTRL_PORF_bm) || _trace_head >= CORE_TRACE_SIZE) {
+    _trace_head    = 0;
+    _trace_wrapped = 0;
+    _trace_magic   = TRACE_MAGIC;
+  }
+  #if defined(TRACE_TCB)
+    if (!(TRACE_TCB.CTRLA & TCB_ENABLE_bm)) {
+      TRACE_TCB.CTRLB = TCB_CNTMODE_INT_gc;   // periodic interrupt mode, with the interrupt off: just counting
+      TRACE_TCB.CCMP  = 0xFFFF;
+      TRACE_TCB.CTRLA = TCB_CLKSEL_DIV2_gc | TCB_ENABLE_bm;
+    }
+  #endif
+  TRACE(TRACE_ID_RESET, flags);
+}
+
+/* The asm ISR for attachInterrupt() has everything saved already, so it can call this; flags_address is that of
+ * VPORTx.INTFLAGS, 4 * port + 3. */
+void __attribute__((used)) _trace_pins(uint8_t flags_address, uint8_t flags) {
+  TRACE(TRACE_ID_PINS + (flags_address >> 2), flags);
+}
+
+void traceStop() {
+  _trace_paused = 1;
+}
+
+void traceStart() {
+  _trace_paused = 0;
+}
+
+void traceClear() {
+  uint8_t oldSREG = SREG;
+  cli();
+  _trace_head    = 0;
+  _trace_wrapped = 0;
+  SREG = oldSREG;
+}
+
+uint8_t traceCount() {
+  return _trace_wrapped ? CORE_TRACE_SIZE : _trace_head;
+}
+
+bool traceRead(uint8_t index, trace_event_t *event) {
+  uint8_t oldSREG = SREG;
+  cli();
+  bool ok = index < traceCount();
+  if (ok) {
+    uint8_t first = _trace_wrapped ? _trace_head : 0;
+    *event = _trace_ring[(first + index) & (CORE_TRACE_SIZE - 1)];
+  }
+  SREG = oldSREG;
+  return ok;
+}
+
+/* "TR", format 1, entries, clock of the time field in Hz (little endian, 4 bytes), then the entries, oldest first,
+ * each as time (little endian), id, arg. */
+uint8_t traceDump(Print &out) {
+  uint8_t paused = _trace_paused;
+  _trace_paused  = 1;
+  uint8_t count  = traceCount();
+  #if defined(TRACE_TCB)
+    uint32_t clock = F_CPU / 2;
+  #else
+    uint32_t clock = 1000;
+  #endif
+  uint8_t header[8] = {'T', 'R', 1, count, (uint8_t)clock, (uint8_t)(clock >> 8), (uint8_t)(clock >> 16), (uint8_t)(clock >> 24)};
+  out.write(header, sizeof(header));
+  for (uint8_t i = 0; i < count; i++) {
+    trace_event_t event;
+    traceRead(i, &event);
+    out.write((const uint8_t *)&event, sizeof(event));   // the AVR is little endian already
+  }
+  _trace_paused = paused;
+  return count;
+}
+
+#endif
@@ -0,0 +1,171 @@
+/* event_trace.h - a ring of small binary event records in RAM, for finding out what the firmware was doing.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * With CORE_TRACE defined when the core is built (platform.local.txt or build_flags, like ISR_TRACE_*), each
+ *   TRACE(id, arg);         - id 0-239, arg 8 bits
+ *   TRACE16(id, arg);       - the same with a 16-bit arg, which takes two entries
+ * puts {time, id, arg} in a ring of CORE_TRACE_SIZE entries, overwriting the oldest, in about 30 clocks with
+ * interrupts off for all of it. Without CORE_TRACE they compile to nothing, so they can stay in the code.
+ *
+ * time is TRACE_TCB's count - the same timer as the queued pin interrupts use, and started the same way, counting at
+ * F_CPU/2 - or the low 16 bits of millis() if there's no TCB for it. The core's own ISRs record themselves too, the
+ * ones selected by CORE_TRACE_ISRS (default everything but millis, which would fill the ring in a few ms):
+ *   TRACE_ISR_MILLIS - TRACE_ID_MILLIS, arg 0
+ *   TRACE_ISR_RXC    - TRACE_ID_RXC, arg the byte received (the asm Serial ISRs are replaced by the C ones for this)
+ *   TRACE_ISR_DRE    - TRACE_ID_DRE, arg the USART number (likewise)
+ *   TRACE_ISR_TWI    - TRACE_ID_TWI, arg SSTATUS for the slave, MSTATUS for the async master
+ *   TRACE_ISR_PINS   - TRACE_ID_PINS + port, arg the INTFLAGS, for attachInterrupt()
+ *
+ * The ring is in .noinit, so it outlasts any reset but power-on: init() keeps whatever was in it (if it's still
+ * valid), adds TRACE_ID_RESET with the reset flags as the arg, and carries on. A sketch that finds the last reset
+ * was a WDT or software one can send it somewhere with traceDump() before it gets overwritten - to Serial, or to a
+ * File on an SD card, both being Print - and tools/trace_decode.py turns that back into text.
+ */
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+
+#define TRACE_ISR_MILLIS  (0x01)
+#define TRACE_ISR_RXC     (0x02)
+#define TRACE_ISR_DRE     (0x04)
+#define TRACE_ISR_TWI     (0x08)
+#define TRACE_ISR_PINS    (0x10)
+
+#define TRACE_ID_RESET    (0xF0)
+#define TRACE_ID_MILLIS   (0xF1)
+#define TRACE_ID_RXC      (0xF2)
+#define TRACE_ID_DRE      (0xF3)
+#define TRACE_ID_TWI      (0xF4)
+#define TRACE_ID_PINS     (0xF8)    // + port: 0xF8 to 0xFA
+#define TRACE_ID_HIGH     (0xFF)    // the high byte of the arg of the entry before, from TRACE16()
+
+#if defined(CORE_TRACE)
+  #if !defined(CORE_TRACE_SIZE)
+    #if (INTERNAL_SRAM_SIZE < 512)
+      #define CORE_TRACE_SIZE 16
+    #else
+      #define CORE_TRACE_SIZE 32
+    #endif
+  #endif
+  #if (CORE_TRACE_SIZE & (CORE_TRACE_SIZE - 1)) || CORE_TRACE_SIZE > 128
+    #error "CORE_TRACE_SIZE must be a power of 2, no larger than 128"
+  #endif
+  #if !defined(CORE_TRACE_ISRS)
+    #define CORE_TRACE_ISRS (TRACE_ISR_RXC | TRACE_ISR_DRE | TRACE_ISR_TWI | TRACE_ISR_PINS)
+  #endif
+  #if !defined(TRACE_TCB) // TCB1 if we have one and millis isn't on it, like PIN_EVENT_TCB
+    #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+      #define TRACE_TCB TCB1
+    #elif !defined(MILLIS_USE_TIMERB0)
+      #define TRACE_TCB TCB0
+    #endif
+  #endif
+#else
+  #define CORE_TRACE_ISRS (0)
+#endif
+
+typedef struct {
+  uint16_t time;
+  uint8_t  id;
+  uint8_t  arg;
+} trace_event_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CORE_TRACE)
+  extern trace_event_t    _trace_ring[CORE_TRACE_SIZE];
+  extern volatile uint8_t _trace_head;      // the entry written next
+  extern volatile uint8_t _trace_wrapped;   // the ring is full, so _trace_head is also the oldest
+  extern volatile uint8_t _trace_paused;
+
+  void _trace_init();
+  void _trace_pins(uint8_t flags_address, uint8_t flags);  // called from the asm attachInterrupt() ISR
+
+  #if defined(TRACE_TCB)
+    #define _TRACE_TIME() (TRACE_TCB.CNT)
+  #elif !defined(MILLIS_USE_TIMERNONE)
+    unsigned long millis();
+    #define _TRACE_TIME() ((uint16_t)millis())
+  #else
+    #define _TRACE_TIME() (0)
+  #endif
+
+  static inline __attribute__((always_inline)) void _trace_put(uint8_t id, uint8_t arg, uint8_t id2, uint8_t arg2, uint8_t two) {
+    uint8_t oldSREG = SREG;
+    cli();
+    if (!_trace_paused) {
+      uint16_t time = _TRACE_TIME();
+      uint8_t head = _trace_head;
+      _trace_ring[head].time = time;
+      _trace_ring[head].id   = id;
+      _trace_ring[head].arg  = arg;
+      head = (head + 1) & (CORE_TRACE_SIZE - 1);
+      if (two) {
+        if (!head) {
+          _trace_wrapped = 1;
+        }
+        _trace_ring[head].time = time;
+        _trace_ring[head].id   = id2;
+        _trace_ring[head].arg  = arg2;
+        head = (head + 1) & (CORE_TRACE_SIZE - 1);
+      }
+      if (!head) {
+        _trace_wrapped = 1;
+      }
+      _trace_head = head;
+    }
+    SREG = oldSREG;
+  }
+  #define TRACE(id, arg)      _trace_put((id), (uint8_t)(arg), 0, 0, 0)
+  #define TRACE16(id, arg)    _trace_put((id), (uint8_t)(arg), TRACE_ID_HIGH, (uint8_t)((uint16_t)(arg) >> 8), 1)
+
+  void    traceStop();        // stop recording, so what's there stays there - on finding something wrong, say
+  void    traceStart();       // and carry on again
+  void    traceClear();       // empty the ring
+  uint8_t traceCount();       // entries in the ring
+  bool    traceRead(uint8_t index, trace_event_t *event);  // 0 is the oldest; false past the end
+#else
+  #define TRACE(id, arg)      ((void)0)
+  #define TRACE16(id, arg)    ((void)0)
+#endif
+
+/* For the core's ISRs: nothing unless CORE_TRACE_ISRS has that one. */
+#define TRACE_ISR(name, arg)  do { if (CORE_TRACE_ISRS & TRACE_ISR_##name) { TRACE(TRACE_ID_##name, (arg)); } } while (0)
+
+/* For the asm attachInterrupt() ISR, right after it reads the flags: r16 is the address of VPORTx.INTFLAGS, r15 the
+ * flags, and everything that _trace_pins() could change has been saved except X. */
+#if (CORE_TRACE_ISRS & TRACE_ISR_PINS)
+  #if PROGMEM_SIZE > 8192
+    #define _TRACE_PINS_CALL "call  _trace_pins"
+  #else
+    #define _TRACE_PINS_CALL "rcall _trace_pins"
+  #endif
+  #define _TRACE_PINS_ASM     \
+    "push  r26"        "\n\t" \
+    "push  r27"        "\n\t" \
+    "mov   r24,   r16" "\n\t" \
+    "mov   r22,   r15" "\n\t" \
+    _TRACE_PINS_CALL   "\n\t" \
+    "pop   r27"        "\n\t" \
+    "pop   r26"        "\n\t"
+#else
+  #define _TRACE_PINS_ASM ""
+#endif
+
+#ifdef __cplusplus
+}
+#if defined(CORE_TRACE)
+  class Print;
+  /* Write the ring to out, oldest first, in the format tools/trace_decode.py reads; recording is paused meanwhile.
+   * Returns the number of entries. */
+  uint8_t traceDump(Print &out);
+#endif
+#endif
+
+#endif
@@ -0,0 +1,137 @@
+/* fixed_math.c - fastMap, isin16() and the integer square roots, see fixed_math.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "wiring_private.h"
+
+/* A quarter wave, sin(i * pi / 256) * 32767 for i = 0 to 128. */
+static const int16_t _isin_table[129] = {
+      0,   402,   804,  1206,  1608,  2009,  2410,  2811,  3212,  3612,  4011,  4410,
+   4808,  5205,  5602,  5998,  6393,  6786,  7179,  7571,  7962,  8351,  8739,  9126,
+   9512,  9896, 10278, 10659, 11039, 11417, 11793, 12167, 12539, 12910, 13279, 13645,
+  14010, 14372, 14732, 15090, 15446, 15800, 16151, 16499, 16846, 17189, 17530, 17869,
+  18204, 18537, 18868, 19195, 19519, 19841, 20159, 20475, 20787, 21096, 21403, 21705,
+  22005, 22301, 22594, 22884, 23170, 23452, 23731, 24007, 24279, 24547, 24811, 25072,
+  25329, 25582, 25832, 26077, 26319, 26556, 26790, 27019, 27245, 27466, 27683, 27896,
+  28105, 28310, 28510, 28706, 28898, 29085, 29268, 29447, 29621, 29791, 29956, 30117,
+  30273, 30424, 30571, 30714, 30852, 30985, 31113, 31237, 31356, 31470, 31580, 31685,
+  31785, 31880, 31971, 32057, 32137, 32213, 32285, 32351, 32412, 32469, 32521, 32567,
+  32609, 32646, 32678, 32705, 32728, 32745, 32757, 32765, 32767
+};
+
+int16_t isin16(uint16_t angle) {
+  uint16_t pos = angle & 0x3FFF;
+  if (angle & 0x4000) {
+    pos = 0x4000 - pos;               // the second and fourth quarters are the first backwards
+  }
+  uint8_t index = pos >> 7;
+  int16_t y     = _isin_table[index];
+  if (index < 128) {                  // the table only rises, so the step and the product are unsigned
+    y += ((uint16_t)(_isin_table[index + 1] - y) * (uint8_t)(pos & 0x7F)) >> 7;
+  }
+  return (angle & 0x8000) ? -y : y;
+}
+
+uint8_t isqrt16(uint16_t x) {
+  uint16_t root = 0;
+  uint16_t bit  = 1U << 14;
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit) {
+    if (x >= root + bit) {
+      x    -= root + bit;
+      root  = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+uint16_t isqrt32(uint32_t x) {
+  uint32_t root = 0;
+  uint32_t bit  = 1UL << 30;
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit) {
+    if (x >= root + bit) {
+      x    -= root + bit;
+      root  = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+static uint16_t _fastmap_gcd(uint16_t a, uint16_t b) {
+  while (b) {
+    uint16_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+/* What map() does, for x outside the input range. */
+static int16_t _fastmap_slow(const fastmap_t *m, int16_t x) {
+  return ((int32_t) x - m->in_min) * ((int32_t) m->out_max - m->out_min) / ((int32_t) m->in_max - m->in_min) + m->out_min;
+}
+
+/* The same M and S as map<>() in fixed_math.h, without the check - see there. With both spans under 256, S is 16,
+ * which is always enough to be exact (2^16 > in_span * den), and is what fastMap8() needs. */
+void fastMapBegin(fastmap_t *m, int16_t in_min, int16_t in_max, int16_t out_min, int16_t out_max) {
+  uint16_t in_span  = (in_max > in_min)   ? (uint16_t) in_max - (uint16_t) in_min   : (uint16_t) in_min - (uint16_t) in_max;
+  uint16_t out_span = (out_max > out_min) ? (uint16_t) out_max - (uint16_t) out_min : (uint16_t) out_min - (uint16_t) out_max;
+  m->in_min  = in_min;
+  m->in_max  = in_max;
+  m->out_min = out_min;
+  m->out_max = out_max;
+  m->in_span = in_span;
+  m->flags   = ((in_max < in_min) ? _FASTMAP_IN_DOWN : 0) | ((out_max < out_min) ? _FASTMAP_OUT_DOWN : 0);
+  if (!in_span) {
+    m->mult  = 0;                     // map() would divide by 0; this gives out_min
+    m->shift = 0;
+    return;
+  }
+  uint16_t g   = _fastmap_gcd(in_span, out_span);
+  uint16_t num = out_span / g;
+  uint16_t den = in_span / g;
+  uint8_t  s   = 16;
+  if (in_span > 255 || out_span > 255) {
+    s = 31;
+    while (s && out_span > ((0xFFFFFFFFUL - in_span) >> s)) {
+      s--;                            // until out_span << s, plus in_span, fits in 32 bits
+    }
+  }
+  uint32_t scaled = (uint32_t) num << s;
+  m->mult  = scaled / den + (scaled % den ? 1 : 0);
+  m->shift = s;
+}
+
+int16_t fastMap16(const fastmap_t *m, int16_t x) {
+  uint16_t a = (m->flags & _FASTMAP_IN_DOWN) ? (uint16_t) m->in_min - (uint16_t) x : (uint16_t) x - (uint16_t) m->in_min;
+  if (a > m->in_span) {
+    return _fastmap_slow(m, x);
+  }
+  uint16_t q = ((uint32_t) a * m->mult) >> m->shift;
+  return (m->flags & _FASTMAP_OUT_DOWN) ? m->out_min - q : m->out_min + q;
+}
+
+/* M is at most 24 bits here, and S is 16: (a * M) >> 16 is a * M[23:16], plus the high byte of a * M[15:0] - which is
+ * itself the high byte of a * M[15:8] plus the high byte of a * M[7:0]. Three 8 x 8 multiplies. */
+uint8_t fastMap8(const fastmap_t *m, uint8_t x) {
+  uint8_t a = (m->flags & _FASTMAP_IN_DOWN) ? (uint8_t) m->in_min - x : x - (uint8_t) m->in_min;
+  if (a > m->in_span) {
+    return _fastmap_slow(m, x);
+  }
+  uint32_t mult = m->mult;
+  uint16_t low  = (uint16_t) a * (uint8_t)(mult >> 8) + ufracMul8(a, (uint8_t) mult);
+  uint8_t  q    = a * (uint8_t)(mult >> 16) + (low >> 8);
+  return (m->flags & _FASTMAP_OUT_DOWN) ? m->out_min - q : m->out_min + q;
+}
@@ -0,0 +1,147 @@
+/* fixed_math.h - map() without the division, and a few fixed point helpers
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * map() does a 32-bit multiply and a 32-bit signed division every time; the division alone (__divmodsi4) is around
+ * 600 clocks. But (x - in_min) * out_span / in_span is the same as (x - in_min) * M >> S for a suitable M and S, as
+ * long as x is in range, so when the ranges don't change, the division can be done once:
+ *
+ *   map<in_min, in_max, out_min, out_max>(x) - the ranges are template arguments, so M and S are worked out when it's
+ *     compiled, and it's checked then that the result is always exactly what map() would give; if it can't be (very
+ *     wide ranges), it just calls map(). An x outside the input range calls map() too, so it's always the same.
+ *   fastMapBegin(&m, in_min, in_max, out_min, out_max), then fastMap16(&m, x) - the same, with M and S worked out at
+ *     runtime, for int16_t ranges. It's map()'s answer whenever in_span^2 * out_span (without common factors) is under
+ *     2^32 - 0-4095 to 0-255, 0-1023 to 0-4095, 0-100 to 0-30000 - and in all the common cases beyond that; otherwise
+ *     it may be 1 more. fastMap8() is for ranges within 0-255, and is always exact.
+ *
+ * isin16()/icos16() take an angle where 65536 is the whole circle and return Q15 (-32767 to 32767), interpolating in
+ * a quarter wave table of 129 int16_t, to within 2; it's const, so it stays in the mapped flash. isin8()/icos8() are the same for
+ * 256 to the circle, -128 to 127. isqrt16() and isqrt32() are integer square roots, rounded down. fracMul8() and
+ * fracMul16() multiply Q7 and Q15 fractions, and ufracMul8()/ufracMul16() are (a * b) >> 8 and >> 16 - fracMul8()
+ * and ufracMul8() are a single fmuls/mul. -128 * -128 in Q7 (1.0) can't be represented, and comes out as -128.
+ */
+#ifndef FIXED_MATH_H
+#define FIXED_MATH_H
+
+#include <stdint.h>
+
+typedef struct {
+  int16_t  in_min;
+  uint16_t in_span;
+  int16_t  out_min;
+  uint8_t  shift;
+  uint8_t  flags;       // _FASTMAP_IN_DOWN, _FASTMAP_OUT_DOWN
+  uint32_t mult;
+  int16_t  in_max;      // for calling map() when x is out of range
+  int16_t  out_max;
+} fastmap_t;
+
+#define _FASTMAP_IN_DOWN  (0x01)
+#define _FASTMAP_OUT_DOWN (0x02)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void     fastMapBegin(fastmap_t *m, int16_t in_min, int16_t in_max, int16_t out_min, int16_t out_max);
+int16_t  fastMap16(const fastmap_t *m, int16_t x);
+uint8_t  fastMap8(const fastmap_t *m, uint8_t x);
+int16_t  isin16(uint16_t angle);
+uint8_t  isqrt16(uint16_t x);
+uint16_t isqrt32(uint32_t x);
+
+static inline int16_t icos16(uint16_t angle) {
+  return isin16(angle + 16384);
+}
+static inline int8_t isin8(uint8_t angle) {
+  return isin16((uint16_t) angle << 8) >> 8;
+}
+static inline int8_t icos8(uint8_t angle) {
+  return isin16((uint16_t)(angle + 64) << 8) >> 8;
+}
+
+static inline __attribute__((always_inline)) int8_t fracMul8(int8_t a, int8_t b) {
+  int8_t r;
+  __asm__ ("fmuls %1, %2"   "\n\t"    // (a * b) << 1 into r1:r0 - the high byte is the Q7 product
+           "mov   %0, r1"   "\n\t"
+           "clr   r1"
+           : "=r" (r) : "a" (a), "a" (b) : "r0");
+  return r;
+}
+static inline __attribute__((always_inline)) uint8_t ufracMul8(uint8_t a, uint8_t b) {
+  uint8_t r;
+  __asm__ ("mul   %1, %2"   "\n\t"
+           "mov   %0, r1"   "\n\t"
+           "clr   r1"
+           : "=r" (r) : "r" (a), "r" (b) : "r0");
+  return r;
+}
+static inline int16_t fracMul16(int16_t a, int16_t b) {
+  return ((int32_t) a * b) >> 15;       // a 16 x 16 -> 32 multiply, with the hardware multiplier
+}
+static inline uint16_t ufracMul16(uint16_t a, uint16_t b) {
+  return ((uint32_t) a * b) >> 16;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+
+  /* For map<>(): the largest shift that leaves room for out_span << shift, plus in_span, in 32 bits. */
+  constexpr uint8_t _mapShift(uint32_t in_span, uint32_t out_span) {
+    uint8_t s = 31;
+    while (s && ((uint64_t) out_span << s) + in_span > 0xFFFFFFFFULL) {
+      s--;
+    }
+    return s;
+  }
+  constexpr uint32_t _mapGcd(uint32_t a, uint32_t b) {
+    return b ? _mapGcd(b, a % b) : a;
+  }
+  /* Whether (a * mult) >> shift == a * out_span / in_span for every a from 0 to in_span: certainly so if
+   * 2^shift > in_span * den, and otherwise, if the range isn't too big to try them all, we do. */
+  constexpr bool _mapExact(uint32_t in_span, uint32_t out_span, uint32_t den, uint32_t mult, uint8_t shift) {
+    if (((uint64_t) 1 << shift) > (uint64_t) in_span * den) {
+      return true;
+    }
+    if (in_span > 0xFFFF) {
+      return false;
+    }
+    for (uint32_t a = 0; a <= in_span; a++) {
+      if ((((uint64_t) a * mult) >> shift) != (uint64_t) a * out_span / in_span) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <long inMin, long inMax, long outMin, long outMax>
+  inline __attribute__((always_inline)) long map(long x) {
+    static_assert(inMin != inMax, "map<>() needs an input range that isn't empty");
+    constexpr uint32_t in_span  = inMax > inMin   ? (uint32_t) inMax - (uint32_t) inMin   : (uint32_t) inMin - (uint32_t) inMax;
+    constexpr uint32_t out_span = outMax > outMin ? (uint32_t) outMax - (uint32_t) outMin : (uint32_t) outMin - (uint32_t) outMax;
+    constexpr uint32_t g        = _mapGcd(in_span, out_span);
+    constexpr uint32_t num      = out_span / g;
+    constexpr uint32_t den      = in_span / g;
+    constexpr uint8_t  shift    = _mapShift(in_span, out_span);
+    constexpr uint32_t mult     = (((uint64_t) num << shift) + den - 1) / den;
+    constexpr bool     exact    = _mapExact(in_span, out_span, den, mult, shift);
+    if (!exact) {
+      return map(x, inMin, inMax, outMin, outMax);
+    }
+    uint32_t a = (inMax > inMin) ? (uint32_t) x - (uint32_t) inMin : (uint32_t) inMin - (uint32_t) x;
+    if (a > in_span) {                  // out of range (or on the other side of in_min)
+      return map(x, inMin, inMax, outMin, outMax);
+    }
+    uint32_t q;
+    if (den == 1) {
+      q = a * num;
+    } else if (num == 1 && !(den & (den - 1))) {
+      q = a >> __builtin_ctzl(den);
+    } else {
+      q = (a * mult) >> shift;
+    }
+    return (outMax > outMin) ? outMin + (long) q : outMin - (long) q;
+  }
+#endif // __cplusplus
+
+#endif
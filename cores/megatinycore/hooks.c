@@ -16,16 +16,25 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <avr/io.h>
+#include <stdint.h>
+
 /**
-   Empty yield() hook.
+   Default yield() hook.
 
    This function is intended to be used by library writers to build
    libraries or sketches that supports cooperative threads.
 
    Its defined as a weak symbol and it can be redefined to implement a
-   real cooperative scheduler.
+   real cooperative scheduler. All this one does is run any deferred
+   work, if the sketch uses deferDispatch() at all (otherwise the weak
+   reference is NULL, and it's empty but for the test), and isn't in
+   an ISR or with interrupts off.
 */
-static void __empty() {
-  // Empty
+uint8_t deferDispatch() __attribute__((weak));
+void yield(void) __attribute__((weak));
+void yield(void) {
+  if (deferDispatch && (SREG & CPU_I_bm)) {
+    deferDispatch();
+  }
 }
-void yield(void) __attribute__((weak, alias("__empty")));
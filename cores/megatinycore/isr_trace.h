@@ -0,0 +1,88 @@
+/* isr_trace.h - ISR entry/exit markers on a debug pin, for measuring interrupt latency and duration.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Define any of these to a bit number (0-7) of the trace port, and that core ISR sets that bit of VPORTx.OUT when it
+ * starts, and clears it when it finishes:
+ *   ISR_TRACE_MILLIS   - the millis timer ISR (including the timer service, if used)
+ *   ISR_TRACE_RXC      - USART receive complete, all ports
+ *   ISR_TRACE_DRE      - USART data register empty, all ports
+ *   ISR_TRACE_TWI      - TWI slave (Wire, when used as a slave)
+ *   ISR_TRACE_PINS     - pin interrupts from attachInterrupt(), all ports
+ * ISR_TRACE_VPORT is the port they're on, PA by default. These have to be passed to the compiler when the core is
+ * built (platform.local.txt, see Ref_Interrupts.md) - defining them in the sketch does nothing. Undefined, every
+ * marker is empty.
+ *
+ * SBI and CBI don't change SREG or need a register, so they can go anywhere, including the naked asm ISRs, where they
+ * are the first and last thing before the reti. In an ISR written in C, they come after the compiler's prologue and
+ * before its epilogue.
+ */
+#ifndef ISR_TRACE_H
+#define ISR_TRACE_H
+
+#if !defined(ISR_TRACE_VPORT)
+  #define ISR_TRACE_VPORT PA
+#endif
+
+#define _ISR_TRACE_STR(x)   #x
+#define _ISR_TRACE_XSTR(x)  _ISR_TRACE_STR(x)
+/* VPORTn.OUT is at I/O address n * 4 + 1 */
+#define _ISR_TRACE_ASM(insn, bit) insn " (" _ISR_TRACE_XSTR(ISR_TRACE_VPORT) ") * 4 + 1, " _ISR_TRACE_XSTR(bit) "\n\t"
+
+#if defined(ISR_TRACE_MILLIS)
+  #define _ISR_TRACE_ON_MILLIS  _ISR_TRACE_ASM("sbi", ISR_TRACE_MILLIS)
+  #define _ISR_TRACE_OFF_MILLIS _ISR_TRACE_ASM("cbi", ISR_TRACE_MILLIS)
+  #define _ISR_TRACE_BM_MILLIS  (1 << (ISR_TRACE_MILLIS))
+#else
+  #define _ISR_TRACE_ON_MILLIS  ""
+  #define _ISR_TRACE_OFF_MILLIS ""
+  #define _ISR_TRACE_BM_MILLIS  (0)
+#endif
+#if defined(ISR_TRACE_RXC)
+  #define _ISR_TRACE_ON_RXC     _ISR_TRACE_ASM("sbi", ISR_TRACE_RXC)
+  #define _ISR_TRACE_OFF_RXC    _ISR_TRACE_ASM("cbi", ISR_TRACE_RXC)
+  #define _ISR_TRACE_BM_RXC     (1 << (ISR_TRACE_RXC))
+#else
+  #define _ISR_TRACE_ON_RXC     ""
+  #define _ISR_TRACE_OFF_RXC    ""
+  #define _ISR_TRACE_BM_RXC     (0)
+#endif
+#if defined(ISR_TRACE_DRE)
+  #define _ISR_TRACE_ON_DRE     _ISR_TRACE_ASM("sbi", ISR_TRACE_DRE)
+  #define _ISR_TRACE_OFF_DRE    _ISR_TRACE_ASM("cbi", ISR_TRACE_DRE)
+  #define _ISR_TRACE_BM_DRE     (1 << (ISR_TRACE_DRE))
+#else
+  #define _ISR_TRACE_ON_DRE     ""
+  #define _ISR_TRACE_OFF_DRE    ""
+  #define _ISR_TRACE_BM_DRE     (0)
+#endif
+#if defined(ISR_TRACE_TWI)
+  #define _ISR_TRACE_ON_TWI     _ISR_TRACE_ASM("sbi", ISR_TRACE_TWI)
+  #define _ISR_TRACE_OFF_TWI    _ISR_TRACE_ASM("cbi", ISR_TRACE_TWI)
+  #define _ISR_TRACE_BM_TWI     (1 << (ISR_TRACE_TWI))
+#else
+  #define _ISR_TRACE_ON_TWI     ""
+  #define _ISR_TRACE_OFF_TWI    ""
+  #define _ISR_TRACE_BM_TWI     (0)
+#endif
+#if defined(ISR_TRACE_PINS)
+  #define _ISR_TRACE_ON_PINS    _ISR_TRACE_ASM("sbi", ISR_TRACE_PINS)
+  #define _ISR_TRACE_OFF_PINS   _ISR_TRACE_ASM("cbi", ISR_TRACE_PINS)
+  #define _ISR_TRACE_BM_PINS    (1 << (ISR_TRACE_PINS))
+#else
+  #define _ISR_TRACE_ON_PINS    ""
+  #define _ISR_TRACE_OFF_PINS   ""
+  #define _ISR_TRACE_BM_PINS    (0)
+#endif
+
+/* For C ISRs: ISR_TRACE_ENTER(MILLIS); ... ISR_TRACE_EXIT(MILLIS);
+ * For asm: ISR_TRACE_ENTER_ASM(RXC) is a string to put in the asm, before the first push. */
+#define ISR_TRACE_ENTER_ASM(name) _ISR_TRACE_ON_##name
+#define ISR_TRACE_EXIT_ASM(name)  _ISR_TRACE_OFF_##name
+#define ISR_TRACE_ENTER(name)     __asm__ __volatile__(_ISR_TRACE_ON_##name  ::)
+#define ISR_TRACE_EXIT(name)      __asm__ __volatile__(_ISR_TRACE_OFF_##name ::)
+
+/* Every trace bit in use - init() makes these outputs. */
+#define ISR_TRACE_MASK (_ISR_TRACE_BM_MILLIS | _ISR_TRACE_BM_RXC | _ISR_TRACE_BM_DRE | _ISR_TRACE_BM_TWI | _ISR_TRACE_BM_PINS)
+
+#endif
@@ -0,0 +1,50 @@
+/* mem_pool.cpp - heapStats(), see mem_pool.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+#include <stdlib.h>
+#include <avr/io.h>
+#include "mem_pool.h"
+
+/* avr-libc's malloc() state (see its stdlib_private.h). Every block has a size_t header holding its usable size; the
+ * free list links the freed blocks below __brkval, and whatever is above __brkval (up to __malloc_heap_end, or if
+ * that's 0, up to __malloc_margin below the stack pointer) hasn't been handed out yet. */
+struct __freelist {
+  size_t sz;
+  struct __freelist *nx;
+};
+extern "C" {
+  extern struct __freelist *__flp;
+  extern char *__brkval;
+  extern char *__malloc_heap_start;
+  extern char *__malloc_heap_end;
+  extern size_t __malloc_margin;
+}
+
+void heapStats(heap_stats_t *stats) {
+  uint16_t listFree = 0, largest = 0;
+  uint8_t blocks = 0;
+  uint8_t oldSREG = SREG;
+  cli();
+  for (struct __freelist *fp = __flp; fp; fp = fp->nx) {
+    // a block on the free list can be handed out whole, so its size is what's usable
+    listFree += fp->sz;
+    if (fp->sz > largest) {
+      largest = fp->sz;
+    }
+    blocks++;
+  }
+  char *top = __brkval ? __brkval : __malloc_heap_start;
+  char *end = __malloc_heap_end ? __malloc_heap_end : (char *)SP - __malloc_margin;
+  SREG = oldSREG;
+  // a block from the top needs its header out of the same space
+  uint16_t topFree = end > top + sizeof(size_t) ? end - top - sizeof(size_t) : 0;
+  if (topFree > largest) {
+    largest = topFree;
+  }
+  stats->total_free = listFree + topFree;
+  stats->largest_free = largest;
+  stats->used = (top - __malloc_heap_start) - listFree - blocks * sizeof(size_t);
+  stats->free_blocks = blocks;
+  stats->fragmentation = stats->total_free ? 100 - (uint8_t)(((uint32_t)largest * 100) / stats->total_free) : 0;
+}
@@ -0,0 +1,143 @@
+/* mem_pool.h - fixed block pools, bump arenas, and heap statistics.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * malloc() on a part with 1-2k of RAM fragments quickly when blocks of different sizes are allocated and freed in
+ * a long running sketch. These give allocations their own memory instead:
+ *
+ *   BlockPool<SIZE, COUNT> - COUNT blocks of SIZE bytes. Allocating and freeing are a few instructions, and freeing
+ *     a block makes exactly that block available again, so it can never fragment.
+ *       static BlockPool<sizeof(Message), 8> messages;
+ *       Message *m = new (messages) Message(42);   // NULL if all 8 are in use
+ *       messages.destroy(m);                       // runs the destructor and returns the block
+ *   Arena<SIZE> - SIZE bytes handed out in order. Nothing is freed individually; reset() frees everything at once.
+ *     For things allocated once at startup, or for scratch space that's thrown away all at the same time.
+ *       static Arena<256> arena;
+ *       uint8_t *buf = (uint8_t *)arena.alloc(64);
+ *       Widget *w = new (arena) Widget();          // its destructor isn't run by reset()
+ *       char *line = new (arena) char[32];
+ *
+ * Both are plain arrays with no constructor, so a global or static one is ready before any constructor runs.
+ *
+ * CORE_NEW_POOL_BLOCK and CORE_NEW_POOL_COUNT, if defined when the core is compiled, make the core's operator new
+ * take anything up to CORE_NEW_POOL_BLOCK bytes from a pool of CORE_NEW_POOL_COUNT blocks, and only use malloc() for
+ * bigger objects or when the pool is used up; delete returns pool blocks to the pool.
+ *
+ * heapStats() reports how much of the heap is free, the largest single block that malloc() could return, and how
+ * fragmented what's free is.
+ *
+ * freeMemoryLow() and stackHighWater() report the closest the stack has ever come to the heap, and the most stack
+ * ever used, from the free RAM having been filled with STACK_CANARY at startup (which is only done if one of them is
+ * used). stackGuardBegin() checks every ms milliseconds, from the millis ISR, that the STACK_GUARD_BYTES above the
+ * heap haven't been touched, and calls the handler if they have - or with no handler, does a software reset.
+ */
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  uint16_t total_free;     // Bytes free: in the free list, plus between the top of the heap and the stack margin.
+  uint16_t largest_free;   // Largest block that malloc() could return right now.
+  uint16_t used;           // Bytes in allocated blocks, including malloc()'s 2 byte header on each.
+  uint8_t  free_blocks;    // Number of blocks on the free list (gaps left by free() below the top of the heap).
+  uint8_t  fragmentation;  // 0-100: the percentage of total_free that can't be had in one malloc().
+} heap_stats_t;
+
+#if !defined(STACK_CANARY)
+  #define STACK_CANARY      (0xC5)
+#endif
+#if !defined(STACK_GUARD_BYTES)
+  #define STACK_GUARD_BYTES (16)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void heapStats(heap_stats_t *stats);
+uint16_t freeMemoryLow();   // bytes between the heap and the deepest the stack has been
+uint16_t stackHighWater();  // bytes of stack ever used, from RAMEND down
+int8_t stackGuardBegin(void (*handler)(void), uint16_t ms);  // the timer id, or -1; not with RTC millis or none
+#ifdef __cplusplus
+} // extern "C"
+
+template <size_t SIZE, uint8_t COUNT>
+class BlockPool {
+    static_assert(SIZE >= sizeof(void *), "BlockPool blocks must be big enough to hold a pointer");
+  public:
+    // A free block, or NULL if all COUNT are in use
+    void *alloc() {
+      void *p = _free;
+      if (p) {
+        _free = *(void **)p;
+      } else if (_fresh < COUNT) {
+        p = _mem + (size_t)_fresh++ * SIZE;
+      }
+      return p;
+    }
+    void release(void *p) {
+      if (p) {
+        *(void **)p = _free;
+        _free = p;
+      }
+    }
+    bool owns(const void *p) const {
+      return (const uint8_t *)p >= _mem && (const uint8_t *)p < _mem + sizeof(_mem);
+    }
+    template <typename T> void destroy(T *p) {
+      if (p) {
+        p->~T();
+        release(p);
+      }
+    }
+    // Blocks never handed out yet; freed ones are on the free list, and are not counted.
+    uint8_t neverUsed() const {
+      return COUNT - _fresh;
+    }
+    // Public only so that a pool is an aggregate, and is set up by being zeroed like any other global.
+    void *_free;
+    uint8_t _fresh;
+    uint8_t _mem[SIZE * COUNT];
+};
+
+template <size_t SIZE>
+class Arena {
+  public:
+    // size bytes, or NULL if there aren't that many left
+    void *alloc(size_t size) {
+      if (size > SIZE - _used) {
+        return NULL;
+      }
+      void *p = _mem + _used;
+      _used += size;
+      return p;
+    }
+    // Everything allocated from it is gone - destructors are not run.
+    void reset() {
+      _used = 0;
+    }
+    size_t available() const {
+      return SIZE - _used;
+    }
+    size_t _used;
+    uint8_t _mem[SIZE];
+};
+
+/* new (pool) T(...) and new (arena) T(...). These are noexcept, so when they return NULL the constructor is skipped
+ * and the new expression is NULL too. */
+template <size_t SIZE, uint8_t COUNT>
+inline void *operator new (size_t size, BlockPool<SIZE, COUNT> &pool) noexcept {
+  return size <= SIZE ? pool.alloc() : NULL;
+}
+template <size_t SIZE>
+inline void *operator new (size_t size, Arena<SIZE> &arena) noexcept {
+  return arena.alloc(size);
+}
+template <size_t SIZE>
+inline void *operator new[](size_t size, Arena<SIZE> &arena) noexcept {
+  return arena.alloc(size);
+}
+#endif // __cplusplus
+
+#endif
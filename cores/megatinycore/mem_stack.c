@@ -0,0 +1,104 @@
+/* mem_stack.c - freeMemoryLow(), stackHighWater() and stackGuardBegin(), see mem_pool.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Before anything else runs, the RAM between the end of .bss (__heap_start) and the stack pointer is filled with
+ * STACK_CANARY. Nothing writes there except the stack on its way down and malloc() on its way up, so the first
+ * byte above the top of the heap that isn't the canary any more is as deep as the stack has ever gone. The fill is
+ * in this file, so it's only done if the sketch uses one of these; with 2k of RAM it takes about 4k clocks.
+ *
+ * When the top of the heap comes back down (free() of the last block), what it held is still there, and would look
+ * like stack - so whenever we see __brkval lower than it has been, the bytes from there up to where it was are
+ * painted again. They're free, neither heap nor stack, or else it's already too late.
+ */
+
+#include "wiring_private.h"
+
+extern char  __heap_start;
+extern char *__brkval;
+
+static uint8_t *_stack_brk_max; // where the top of the heap was when we last looked
+
+void _stackPaint() __attribute__((naked, used, section(".init3")));
+void _stackPaint() {
+  // No stack frame in an init section, and nothing's on the stack yet, so SP is the top of what's free.
+  __asm__ __volatile__ (
+    "ldi  r30, lo8(__heap_start)"   "\n\t"
+    "ldi  r31, hi8(__heap_start)"   "\n\t"
+    "in   r26, __SP_L__"            "\n\t"
+    "in   r27, __SP_H__"            "\n\t"
+    "ldi  r24, %[canary]"           "\n\t"
+  "1:"                              "\n\t"
+    "st   Z+,  r24"                 "\n\t"
+    "cp   r30, r26"                 "\n\t"
+    "cpc  r31, r27"                 "\n\t"
+    "brlo 1b"                       "\n\t"
+    :: [canary] "M" (STACK_CANARY) : "r24", "r26", "r27", "r30", "r31", "memory");
+}
+
+/* The top of the heap, with anything freed from under it painted again. Call with interrupts off. */
+static uint8_t *_stackFloor() {
+  uint8_t *top = (uint8_t *)(__brkval ? __brkval : &__heap_start);
+  for (uint8_t *p = top; p < _stack_brk_max; p++) {
+    *p = STACK_CANARY;
+  }
+  _stack_brk_max = top;
+  return top;
+}
+
+/* The untouched bytes from the top of the heap up, under the stack - the closest they've ever come. */
+uint16_t freeMemoryLow() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t *p = _stackFloor();
+  SREG = oldSREG;
+  uint8_t *sp = (uint8_t *) SP;
+  uint8_t *start = p;
+  while (p < sp && *p == STACK_CANARY) {
+    p++;
+  }
+  return p - start;
+}
+
+uint16_t stackHighWater() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t *p = _stackFloor();
+  SREG = oldSREG;
+  uint8_t *sp = (uint8_t *) SP;
+  while (p < sp && *p == STACK_CANARY) {
+    p++;
+  }
+  return (uint8_t *) RAMEND - p + 1;
+}
+
+#if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+  static voidFuncPtr _stack_guard_handler;
+  static int8_t      _stack_guard_timer = -1;
+
+  /* From the millis ISR: the STACK_GUARD_BYTES above the top of the heap should never have been touched. They can't
+   * be painted again here, as the stack may be in them right now, so the handler is only called once. */
+  static void _stackGuard() {
+    uint8_t *p = _stackFloor();
+    for (uint8_t i = 0; i < STACK_GUARD_BYTES; i++) {
+      if (p[i] != STACK_CANARY) {
+        if (!_stack_guard_handler) {
+          _PROTECTED_WRITE(RSTCTRL.SWRR, 1);  // a clean reset, rather than wherever the collision would lead
+        }
+        timerCancel(_stack_guard_timer);
+        _stack_guard_timer = -1;
+        _stack_guard_handler();
+        return;
+      }
+    }
+  }
+
+  int8_t stackGuardBegin(voidFuncPtr handler, uint16_t ms) {
+    if (_stack_guard_timer >= 0) {
+      timerCancel(_stack_guard_timer);
+    }
+    _stack_guard_handler = handler;
+    _stack_guard_timer   = timerAdd(_stackGuard, ms, TIMER_PERIODIC);
+    return _stack_guard_timer;
+  }
+#endif
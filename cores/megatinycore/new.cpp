@@ -28,21 +28,51 @@
 
 #include <stdlib.h>
 
+#if defined(CORE_NEW_POOL_BLOCK)
+  /* Objects up to CORE_NEW_POOL_BLOCK bytes come out of a pool of fixed size blocks (see mem_pool.h), so creating
+   * and deleting them can't fragment the heap. */
+  #include "mem_pool.h"
+  #if !defined(CORE_NEW_POOL_COUNT)
+    #define CORE_NEW_POOL_COUNT 8
+  #endif
+  static BlockPool<CORE_NEW_POOL_BLOCK, CORE_NEW_POOL_COUNT> _new_pool;
+
+  static void *_new_alloc(size_t size) {
+    if (size <= CORE_NEW_POOL_BLOCK) {
+      void *p = _new_pool.alloc();
+      if (p) {
+        return p;
+      }
+    }
+    return malloc(size);
+  }
+  static void _new_free(void *ptr) {
+    if (_new_pool.owns(ptr)) {
+      _new_pool.release(ptr);
+    } else {
+      free(ptr);
+    }
+  }
+#else
+  #define _new_alloc malloc
+  #define _new_free free
+#endif
+
 // For C++11, only need the following:
 void *operator new  (size_t size) {
-  return malloc(size);
+  return _new_alloc(size);
 }
 
 void *operator new[](size_t size) {
-  return malloc(size);
+  return _new_alloc(size);
 }
 
 void  operator delete  (void * ptr) {
-  free(ptr);
+  _new_free(ptr);
 }
 
 void  operator delete[](void * ptr) {
-  free(ptr);
+  _new_free(ptr);
 }
 
 void * operator new  (size_t size, void * ptr) noexcept {
@@ -60,11 +90,11 @@ void * operator new[](size_t size, void * ptr) noexcept {
 #if (__cpp_sized_deallocation >= 201309L)
   void  operator delete  (void* ptr, size_t size) noexcept {
     (void) size;
-    free(ptr);
+    _new_free(ptr);
   }
   void  operator delete[](void* ptr, size_t size) noexcept {
     (void) size;
-    free(ptr);
+    _new_free(ptr);
   }
 #endif
 
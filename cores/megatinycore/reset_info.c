@@ -0,0 +1,108 @@
+/* reset_info.c - the record behind getResetInfo(), see reset_info.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The record is in .noinit, which isn't cleared at startup, so it survives any reset but power-on (and a brownout,
+ * maybe). The check byte, the complement of the sum of the rest, keeps whatever the RAM powered up with, or a record
+ * that's already been reported, from being believed; init() spoils it once it has read the record.
+ */
+
+#include "Arduino.h"
+
+#if defined(CORE_RESET_INFO)
+
+#if defined(CORE_RESET_INFO_USERROW) && (CORE_RESET_INFO_USERROW + RESET_INFO_STACK_SIZE + 8 > USER_SIGNATURES_SIZE)
+  #error "CORE_RESET_INFO_USERROW: the record (RESET_INFO_STACK_SIZE + 8 bytes) must fit in the USERROW"
+#endif
+
+volatile uint16_t   _reset_info_sp;
+static reset_info_t _reset_info        __attribute__((section(".noinit")));
+static uint8_t      _reset_info_check  __attribute__((section(".noinit")));
+static bool         _reset_info_valid;
+
+static uint8_t _reset_info_sum(const reset_info_t *info) {
+  const uint8_t *p = (const uint8_t *)info;
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < sizeof(reset_info_t); i++) {
+    sum += p[i];
+  }
+  return ~sum;
+}
+
+void saveResetInfo(uint8_t cause) {
+  // _reset_info_sp + 1 is the SP the ISR was entered with, and above it, the return address, high byte first
+  const uint8_t *sp = (const uint8_t *)(_reset_info_sp + 2);
+  _reset_info.cause  = cause;
+  _reset_info.flags  = 0;
+  _reset_info.status = CPUINT.STATUS;
+  _reset_info.pc     = ((sp[0] << 8) | sp[1]) << 1;
+  sp += 2;
+  _reset_info.sp     = (uint16_t)sp - 1;
+  for (uint8_t i = 0; i < RESET_INFO_STACK_SIZE; i++) {
+    _reset_info.stack[i] = (sp + i <= (const uint8_t *)RAMEND) ? sp[i] : 0;
+  }
+  _reset_info_check = _reset_info_sum(&_reset_info);
+}
+
+/* Nothing is saved, since it's never going back; a software reset leaves the record where it is, and gets the
+ * CPUINT back out of the interrupt level it thinks it's in, which jumping to 0 wouldn't. */
+void _reset_info_badisr() __attribute__((noreturn, used));
+void _reset_info_badisr() {
+  saveResetInfo(RESET_INFO_BADISR);
+  _PROTECTED_WRITE(RSTCTRL.SWRR, 1);
+  while (1);
+}
+
+ISR(BADISR_vect, ISR_NAKED) {
+  __asm__ __volatile__ (
+    _RESET_INFO_SP_ASM
+    "clr   r1"                "\n\t"
+    _RESET_INFO_JMP "_reset_info_badisr" "\n\t"
+  );
+}
+
+/* Called first thing in init(). The reset flags are in GPIOR0 by then, whether Optiboot or init_reset_flags() put
+ * them there. */
+void _reset_info_init() {
+  uint8_t flags = GPIOR0;
+  _reset_info_valid = !(flags & RSTCTRL_PORF_bm) && _reset_info_check == _reset_info_sum(&_reset_info);
+  if (!_reset_info_valid) {
+    memset(&_reset_info, 0, sizeof(reset_info_t));
+  }
+  _reset_info.flags = flags;
+  #if defined(CORE_RESET_INFO_USERROW)
+    if (_reset_info_valid) {
+      // Only the bytes loaded into the page buffer are erased and written, so the rest of the USERROW stays as it is.
+      const uint8_t *p = (const uint8_t *)&_reset_info;
+      volatile uint8_t *cell = (volatile uint8_t *)(USER_SIGNATURES_START + CORE_RESET_INFO_USERROW);
+      while (NVMCTRL.STATUS & (NVMCTRL_EEBUSY_bm | NVMCTRL_FBUSY_bm));
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+      for (uint8_t i = 0; i < sizeof(reset_info_t); i++) {
+        cell[i] = p[i];
+      }
+      cell[sizeof(reset_info_t)] = _reset_info_sum(&_reset_info);
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+      while (NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+    }
+  #endif
+  _reset_info_check = ~_reset_info_sum(&_reset_info);   // reported now; the next reset needs a new one
+}
+
+bool getResetInfo(reset_info_t *info) {
+  *info = _reset_info;
+  return _reset_info_valid;
+}
+
+#if defined(CORE_RESET_INFO_USERROW)
+  bool getSavedResetInfo(reset_info_t *info) {
+    const uint8_t *cell = (const uint8_t *)(USER_SIGNATURES_START + CORE_RESET_INFO_USERROW);
+    memcpy(info, cell, sizeof(reset_info_t));
+    if (cell[sizeof(reset_info_t)] == _reset_info_sum(info) && info->cause != RESET_INFO_NONE) {
+      return true;
+    }
+    memset(info, 0, sizeof(reset_info_t));
+    return false;
+  }
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/* reset_info.h - what the chip was doing when it was reset by the watchdog or an interrupt with no ISR
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * RSTCTRL.RSTFR only says what kind of reset it was. With CORE_RESET_INFO defined when the core is built
+ * (platform.local.txt or build_flags), a record of where the code was at the time is kept in .noinit, and
+ * getResetInfo() gives it to the sketch after the reset:
+ *   - cause  - RESET_INFO_BADISR, RESET_INFO_WATCHDOG, or whatever the sketch passed to saveResetInfo()
+ *   - flags  - the reset flags, from GPIOR0, as always
+ *   - status - CPUINT.STATUS in the handler; in a level 1 one, LVL0EX means it interrupted a level 0 ISR
+ *   - pc     - the byte address the handler would have returned to; avr-addr2line -e sketch.elf 0x<pc> says where
+ *   - sp     - the stack pointer there, and stack[] what was just above it: the return addresses of its callers
+ *
+ * The core catches an interrupt with no ISR (BADISR_vect, which otherwise jumps to 0 for a dirty reset), records it,
+ * and does a software reset. The tinyAVR watchdog has no interrupt to give warning, so for hangs, something that
+ * does - the Supervisor library's PIT ISR, or the sketch's own - is written as RESET_INFO_ISR(vector) instead of
+ * ISR(vector), and calls saveResetInfo() once it has decided it's going to let the watchdog reset the chip. It can only
+ * run while interrupts are enabled - or in a level 0 ISR too, if it's the level 1 interrupt - so code stuck with
+ * interrupts disabled still gets a plain watchdog reset, and a record with cause RESET_INFO_NONE.
+ *
+ * With CORE_RESET_INFO_USERROW defined to an offset in the USERROW, init() also copies a new record there (taking
+ * a few ms, and only when there is one) so that it outlasts a power cycle too; getSavedResetInfo() reads it back.
+ */
+#ifndef RESET_INFO_H
+#define RESET_INFO_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+
+#define RESET_INFO_NONE       (0)   // no record: the reset wasn't one of these, or the RAM didn't survive it
+#define RESET_INFO_BADISR     (1)   // an interrupt fired that had no ISR
+#define RESET_INFO_WATCHDOG   (2)   // a RESET_INFO_ISR gave up on the code it interrupted, and left it to the WDT
+                                    // the sketch can pass its own causes, from 0x10 up, to saveResetInfo()
+#if !defined(RESET_INFO_STACK_SIZE)
+  #define RESET_INFO_STACK_SIZE (8)
+#endif
+
+typedef struct {
+  uint8_t  cause;
+  uint8_t  flags;
+  uint8_t  status;
+  uint16_t pc;
+  uint16_t sp;
+  uint8_t  stack[RESET_INFO_STACK_SIZE];
+} reset_info_t;
+
+#if defined(CORE_RESET_INFO)
+  #ifdef __cplusplus
+  extern "C" {
+  #endif
+  extern volatile uint16_t _reset_info_sp;  // from RESET_INFO_ISR(): one less than SP on entry, after its push
+
+  void _reset_info_init();
+  void saveResetInfo(uint8_t cause);      // only from a RESET_INFO_ISR(), which has recorded where it came in
+  bool getResetInfo(reset_info_t *info);  // true if the last reset left a record; flags are filled in either way
+  #if defined(CORE_RESET_INFO_USERROW)
+    bool getSavedResetInfo(reset_info_t *info);  // the last record copied to the USERROW, after any reset
+  #endif
+  #ifdef __cplusplus
+  }
+  #define _RESET_INFO_EXTERN extern "C"
+  #else
+  #define _RESET_INFO_EXTERN
+  #endif
+
+  #if PROGMEM_SIZE > 8192
+    #define _RESET_INFO_JMP "jmp   "
+  #else
+    #define _RESET_INFO_JMP "rjmp  "
+  #endif
+  #define _RESET_INFO_SP_ASM                \
+    "push  r24"                      "\n\t" \
+    "in    r24,   __SP_L__"          "\n\t" \
+    "sts   _reset_info_sp,   r24"    "\n\t" \
+    "in    r24,   __SP_H__"          "\n\t" \
+    "sts   _reset_info_sp+1, r24"    "\n\t" \
+    "pop   r24"                      "\n\t"
+
+  /* Used just like ISR(vect) { ... }: a naked stub saves the stack pointer and jumps to the body, which is an ordinary
+   * ISR in every other way. 9 clocks more on entry. */
+  #define RESET_INFO_ISR(vect)                                                                       \
+    _RESET_INFO_EXTERN void __vector_reset_info_##vect(void) __attribute__((signal, used));          \
+    ISR(vect, ISR_NAKED) {                                                                           \
+      __asm__ __volatile__ (_RESET_INFO_SP_ASM _RESET_INFO_JMP "__vector_reset_info_" #vect "\n\t"); \
+    }                                                                                                \
+    _RESET_INFO_EXTERN void __vector_reset_info_##vect(void)
+#else
+  #define RESET_INFO_ISR(vect) ISR(vect)
+#endif
+
+#endif
@@ -0,0 +1,105 @@
+/* sfr_writes.h - peripheral setup as a table of register writes, worked out at compile time.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The Event, Logic and Comparator libraries keep their settings in objects in RAM, and init() works out the register
+ * values from them at runtime. When the whole setup is known when the sketch is compiled, that's all wasted - so
+ * Event::config<>(), Logic::config<>() and AnalogComparator::config<>() instead give an sfr_table<N>, a list of
+ * register writes worked out by the compiler. Tables can be joined with +, and
+ *
+ *   SFR_STARTUP(Logic::config<0, in::pin, in::masked, in::masked, 0x02, out::enable>() + Logic::config_start());
+ *
+ * puts the whole table in flash and applies it before setup() runs (from a constructor, so before init() too - these
+ * are peripherals init() doesn't touch). An entry is 4 bytes: the address, and a store, or a read-modify-write of
+ * some of the bits for registers that are shared, like PORTMUX. sfrApply() can also be called on a table directly.
+ *
+ * Addresses are worked out from the peripheral base addresses below, which are the same on every tinyAVR 0/1/2-series
+ * part, and offsetof() for the register within it. They don't check whether the part has that peripheral - that's on
+ * the library building the table.
+ */
+#ifndef SFR_WRITES_H
+#define SFR_WRITES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint16_t address;
+  uint8_t  keep;            // bits of the old value to keep - 0 for a plain store
+  uint8_t  value;
+} sfr_write_t;
+
+/* Apply count writes, in order. */
+static inline void sfrApply(const sfr_write_t *writes, uint8_t count) {
+  for (; count; count--, writes++) {
+    volatile uint8_t *reg = (volatile uint8_t *) writes->address;
+    uint8_t keep = writes->keep;
+    *reg = keep ? ((*reg & keep) | writes->value) : writes->value;
+  }
+}
+
+#if defined(__cplusplus)
+
+namespace sfr {
+  constexpr uint16_t vref    = 0x00A0;
+  constexpr uint16_t evsys   = 0x0180;
+  constexpr uint16_t ccl     = 0x01C0;
+  constexpr uint16_t portmux = 0x0200;
+  constexpr uint16_t porta   = 0x0400; // PORTB and PORTC follow, 0x20 apart
+  constexpr uint16_t ac0     = 0x0680; // AC1 and AC2 follow, 8 apart
+  constexpr uint16_t dac0    = 0x06A0; // DAC1 and DAC2 follow, 8 apart
+
+  constexpr sfr_write_t store(uint16_t address, uint8_t value) {
+    return {address, 0, value};
+  }
+  /* Change only the bits in mask; the rest are kept. */
+  constexpr sfr_write_t modify(uint16_t address, uint8_t mask, uint8_t value) {
+    return {address, (uint8_t) ~mask, (uint8_t)(value & mask)};
+  }
+};
+
+template <uint8_t N>
+struct sfr_table {
+  sfr_write_t writes[N];
+  static constexpr uint8_t count = N;
+  void apply() const {
+    sfrApply(writes, N);
+  }
+};
+
+template <uint8_t A, uint8_t B>
+constexpr sfr_table<A + B> operator+(const sfr_table<A> &a, const sfr_table<B> &b) {
+  sfr_table<A + B> out{};
+  for (uint8_t i = 0; i < A; i++) {
+    out.writes[i] = a.writes[i];
+  }
+  for (uint8_t i = 0; i < B; i++) {
+    out.writes[A + i] = b.writes[i];
+  }
+  return out;
+}
+
+/* Pins, by port (PA, PB, PC) and bit, for the things the library init()s would otherwise do to them. */
+constexpr sfr_table<1> sfr_pin_output(uint8_t port, uint8_t bit) {                   // DIRSET
+  return {{sfr::store(sfr::porta + port * 0x20 + 0x01, 1 << bit)}};
+}
+constexpr sfr_table<2> sfr_pin_input(uint8_t port, uint8_t bit, bool pullup = false) { // DIRCLR, and PULLUPEN in PINnCTRL
+  return {{sfr::store(sfr::porta + port * 0x20 + 0x02, 1 << bit),
+           sfr::modify(sfr::porta + port * 0x20 + 0x10 + bit, 0x08, pullup ? 0x08 : 0)}};
+}
+constexpr sfr_table<1> sfr_pin_analog(uint8_t port, uint8_t bit) {                   // ISC = INPUT_DISABLE
+  return {{sfr::modify(sfr::porta + port * 0x20 + 0x10 + bit, 0x07, 0x04)}};
+}
+
+#define _SFR_CAT2(a, b) a##b
+#define _SFR_CAT(a, b)  _SFR_CAT2(a, b)
+/* Put a table in flash, and apply it at startup. Can be used more than once; they're applied in the order the
+   linker puts them, so anything that has to happen in a particular order should be in one table. */
+#define SFR_STARTUP(...)                                                                  \
+  static constexpr auto _SFR_CAT(_sfr_startup_table, __LINE__) = (__VA_ARGS__);           \
+  __attribute__((constructor, used)) static void _SFR_CAT(_sfr_startup, __LINE__)() {     \
+    _SFR_CAT(_sfr_startup_table, __LINE__).apply();                                       \
+  }
+
+#endif // __cplusplus
+#endif // SFR_WRITES_H
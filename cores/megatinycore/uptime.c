@@ -0,0 +1,165 @@
+/* uptime.c - a 64-bit count of RTC ticks since startup, and calendar time from it - see uptime.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "wiring_private.h"
+#include "uptime.h"
+
+#if !defined(MILLIS_USE_TIMERRTC)
+  static volatile uint32_t _uptime_overflows;
+  static bool              _uptime_running;
+
+  /* This replaces the one in wiring_sleep.c: sleepFor() uses the compare match, and turns it back off here (which
+   * leaves the overflow on), as delay() does with the ISR in wiring.c when the RTC is the millis timer. */
+  ISR(RTC_CNT_vect) {
+    uint8_t flags = RTC.INTFLAGS;
+    if (flags & RTC_CMP_bm) {
+      RTC.INTCTRL = RTC_OVF_bm;
+    }
+    if (flags & RTC_OVF_bm) {
+      _uptime_overflows++;
+    }
+    RTC.INTFLAGS = flags & (RTC_OVF_bm | RTC_CMP_bm);
+  }
+#endif
+
+static uint64_t _uptime_offset;          // from uptime() to seconds since 1970, in ticks
+static uint32_t _uptime_day_start;       // the midnight that _uptime_day is the date of (if its year isn't 0)
+static uptime_calendar_t _uptime_day;
+
+bool uptimeBegin(__attribute__((unused)) uint8_t source) {
+  #if defined(MILLIS_USE_TIMERRTC)
+    return true;                         // already running, from the clock chosen in the tools menu.
+  #else
+    if (_uptime_running) {
+      return true;
+    }
+    uint8_t clksel = RTC_CLKSEL_INT32K_gc;
+    if (source == UPTIME_CRYSTAL) {
+      clksel = RTC_CLKSEL_TOSC32K_gc;
+    } else if (source == UPTIME_EXTCLK) {
+      clksel = RTC_CLKSEL_EXTCLK_gc;
+    }
+    /* The PIT runs from whatever clocks the RTC, so if it's on, we can only have the clock it already has. */
+    if ((RTC.CTRLA & RTC_RTCEN_bm) || ((RTC.PITCTRLA & RTC_PITEN_bm) && RTC.CLKSEL != clksel)) {
+      return false;
+    }
+    if (clksel == RTC_CLKSEL_TOSC32K_gc && !(CLKCTRL.XOSC32KCTRLA & CLKCTRL_ENABLE_bm)) {
+      _PROTECTED_WRITE(CLKCTRL.XOSC32KCTRLA, CLKCTRL_RUNSTDBY_bm | CLKCTRL_ENABLE_bm);
+    }
+    uint8_t oldSREG = SREG;
+    cli();
+    while (RTC.STATUS);
+    RTC.CLKSEL   = clksel;
+    RTC.PER      = 0xFFFF;
+    RTC.CNT      = 0;
+    _uptime_overflows = 0;
+    RTC.INTFLAGS = RTC_OVF_bm | RTC_CMP_bm;
+    RTC.INTCTRL  = RTC_OVF_bm;
+    RTC.CTRLA    = RTC_RUNSTDBY_bm | RTC_RTCEN_bm | RTC_PRESCALER_DIV1_gc;
+    _uptime_running = true;
+    SREG = oldSREG;
+    while (RTC.STATUS & RTC_CTRLABUSY_bm);
+    return true;
+  #endif
+}
+
+uint64_t uptime() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t count = RTC.CNT;
+  #if defined(MILLIS_USE_TIMERRTC)
+    uint32_t high = timer_overflow_count;
+  #else
+    uint32_t high = _uptime_overflows;
+  #endif
+  if ((RTC.INTFLAGS & RTC_OVF_bm) && !(count & 0x8000)) {
+    high++;                              // it's overflowed, and the ISR hasn't got to it yet - as in millis().
+  }
+  SREG = oldSREG;
+  uint64_t ticks = ((uint64_t)high << 16) | count;
+  #if defined(MILLIS_USE_TIMERRTC)
+    ticks <<= 5;                         // the millis RTC is prescaled by 32.
+  #endif
+  return ticks;
+}
+
+uint32_t uptimeSeconds() {
+  return uptime() >> 15;
+}
+
+void uptimeSetTime(uint32_t epoch) {
+  _uptime_offset = ((uint64_t)epoch << 15) - uptime();
+}
+
+uint32_t uptimeTime() {
+  return (uptime() + _uptime_offset) >> 15;
+}
+
+static bool _uptime_leap(uint16_t year) {  // 2100 is the only century in range.
+  return !(year & 3) && year != 2100;
+}
+
+static uint8_t _uptime_month_days(uint16_t year, uint8_t month) {
+  static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  return days[month - 1] + (month == 2 && _uptime_leap(year));
+}
+
+void uptimeToCalendar(uint32_t epoch, uptime_calendar_t *calendar) {
+  uint32_t second = epoch - _uptime_day_start;
+  if (second >= 86400UL || !_uptime_day.year) {  // another day, or the first: the only divisions.
+    uint16_t days     = epoch / 86400UL;
+    _uptime_day_start = days * 86400UL;
+    second            = epoch - _uptime_day_start;
+    uint16_t year     = 1970;
+    while (days >= 365U + _uptime_leap(year)) {
+      days -= 365U + _uptime_leap(year);
+      year++;
+    }
+    uint8_t month = 1;
+    while (days >= _uptime_month_days(year, month)) {
+      days -= _uptime_month_days(year, month);
+      month++;
+    }
+    _uptime_day.year  = year;
+    _uptime_day.month = month;
+    _uptime_day.day   = days + 1;
+  }
+  /* The time of day with multiplies: for anything under 86400, s * 37283 >> 27 is s / 3600, and under 3600,
+   * s * 2185 >> 17 is s / 60. */
+  uint8_t hour      = (second * 37283UL) >> 27;
+  uint16_t rest     = second - hour * 3600UL;
+  uint8_t minute    = ((uint32_t)rest * 2185UL) >> 17;
+  *calendar         = _uptime_day;
+  calendar->hour    = hour;
+  calendar->minute  = minute;
+  calendar->second  = rest - minute * 60U;
+}
+
+void uptimeCalendar(uptime_calendar_t *now) {
+  uptimeToCalendar(uptimeTime(), now);
+}
+
+uint32_t uptimeFromCalendar(const uptime_calendar_t *calendar) {
+  uint16_t days = calendar->day - 1;
+  for (uint16_t year = 1970; year < calendar->year; year++) {
+    days += 365U + _uptime_leap(year);
+  }
+  for (uint8_t month = 1; month < calendar->month; month++) {
+    days += _uptime_month_days(calendar->year, month);
+  }
+  return days * 86400UL + calendar->hour * 3600UL + calendar->minute * 60U + calendar->second;
+}
+
+void uptimeFatDateTime(uint16_t *date, uint16_t *time) {
+  uptime_calendar_t now;
+  uptimeCalendar(&now);
+  if (now.year < 1980) {                 // FAT starts in 1980; before the time has been set, that's when it is.
+    *date = (1 << 5) | 1;
+    *time = 0;
+    return;
+  }
+  *date = ((now.year - 1980U) << 9) | (now.month << 5) | now.day;
+  *time = ((unsigned int)now.hour << 11) | (now.minute << 5) | (now.second >> 1);
+}
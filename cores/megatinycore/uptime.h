@@ -0,0 +1,55 @@
+/* uptime.h - a 64-bit count of RTC ticks since startup, that keeps going in standby, and calendar time from it
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * uptime() is RTC.CNT with an overflow count above it, in 1/32768ths of a second - read with interrupts off for
+ * a couple of dozen clocks, and adjusted for an overflow the ISR hasn't got to yet, the same way millis() is.
+ * After uptimeBegin(), the RTC runs from the 32.768 kHz oscillator or crystal with no prescaling, and in standby
+ * too (so sleep goes no deeper than that: in power down, the RTC counter stops). With the RTC as the millis timer,
+ * uptimeBegin() takes it as it is: the counting is shared with millis, at its 1024 ticks per second, so uptime() has
+ * that resolution (still in 1/32768ths), and set_millis() moves it.
+ *
+ * Wall clock time is the uptime plus an offset, set by uptimeSetTime() from whatever knows the time (a GPS, NTP over
+ * serial, the user). Everything on the way to uptimeTime() is shifts and adds; the calendar form keeps the date of
+ * the current day, and only works it out again (with divisions) when the day changes - the time of day is done
+ * with multiplies by reciprocals - so stamping each record in a log costs almost nothing. uptimeFatDateTime() has
+ * the signature of the SD library's SdFile::dateTimeCallback(), so files get the right dates.
+ */
+#ifndef UPTIME_H
+#define UPTIME_H
+
+#include <avr/io.h>
+#include <stdbool.h>
+
+#define UPTIME_HZ           (32768)
+#define UPTIME_INTERNAL     (0)    // uptimeBegin(): the internal 32.768 kHz oscillator, +/- 10% or so
+#define UPTIME_CRYSTAL      (1)    // a 32.768 kHz crystal on TOSC1/TOSC2 (not on the 8-pin parts)
+#define UPTIME_EXTCLK       (2)    // a 32.768 kHz clock on the EXTCLK pin (PA3)
+
+typedef struct {
+  uint16_t year;                   // 1970 to 2105
+  uint8_t  month;                  // 1 to 12
+  uint8_t  day;                    // 1 to 31
+  uint8_t  hour;
+  uint8_t  minute;
+  uint8_t  second;
+} uptime_calendar_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* False if the RTC is already running for something else, or the PIT is using another clock. */
+bool     uptimeBegin(uint8_t source);
+uint64_t uptime();                                  // 1/32768ths of a second since uptimeBegin()
+uint32_t uptimeSeconds();                           // the same in seconds
+void     uptimeSetTime(uint32_t epoch);             // it's now this many seconds since 1970 (UTC or local, as you like)
+uint32_t uptimeTime();                              // and now it's this many
+void     uptimeCalendar(uptime_calendar_t *now);    // the same, as a date and time
+void     uptimeToCalendar(uint32_t epoch, uptime_calendar_t *calendar);
+uint32_t uptimeFromCalendar(const uptime_calendar_t *calendar);
+void     uptimeFatDateTime(uint16_t *date, uint16_t *time);   // for SdFile::dateTimeCallback()
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -65,15 +65,12 @@ inline unsigned long microsecondsToClockCycles(unsigned long microseconds) {
   volatile uint32_t timer_millis = 0; // That's all we need to track here
 
 #elif !defined(MILLIS_USE_TIMERRTC) // all of this stuff is not used when the RTC is used as the timekeeping timer
-  static uint16_t timer_fract = 0;
+  uint16_t timer_fract = 0;    // FRACT_INC and MILLIS_INC are in wiring_private.h, with _millisTick().
   uint16_t fract_inc;
   volatile uint32_t timer_millis = 0;
-  #define FRACT_MAX (1000)
-  #define FRACT_INC (millisClockCyclesToMicroseconds(TIME_TRACKING_CYCLES_PER_OVF)%1000);
-  #define MILLIS_INC (millisClockCyclesToMicroseconds(TIME_TRACKING_CYCLES_PER_OVF)/1000);
   volatile uint32_t timer_overflow_count = 0;
 #else
-  volatile uint16_t timer_overflow_count = 0;
+  volatile uint32_t timer_overflow_count = 0;   // 32 bits, so uptime() can count past 2^16 of them.
 #endif
 
 // overflow count is tracked for all timer options, even the RTC
@@ -126,57 +123,31 @@ inline unsigned long microsecondsToMillisClockCycles(unsigned long microseconds)
 #endif // end #if !defined(MILLIS_USE_TIMERRTC)
 
 
-#if defined(MILLIS_USE_TIMERA0)
-  ISR(TCA0_HUNF_vect)
-#elif defined(MILLIS_USE_TIMERD0)
-  ISR(TCD0_OVF_vect)
-#elif defined(MILLIS_USE_TIMERRTC)
-  ISR(RTC_CNT_vect)
-#elif defined(MILLIS_USE_TIMERB0)
-  ISR(TCB0_INT_vect)
-#elif defined(MILLIS_USE_TIMERB1)
-  ISR(TCB1_INT_vect)
+#if defined(MILLIS_USE_TIMERRTC)
+  ISR(RTC_CNT_vect) {
+    ISR_TRACE_ENTER(MILLIS);
+    TRACE_ISR(MILLIS, 0);
+    // if RTC is used as timer, we only increment the overflow count - but the compare match, used by delay(),
+    // shares the vector. delay() is waiting for the compare interrupt to turn itself off.
+    uint8_t flags = RTC.INTFLAGS;
+    if (flags & RTC_CMP_bm) {
+      RTC.INTCTRL = RTC_OVF_bm;
+    }
+    if (flags & RTC_OVF_bm) {
+      timer_overflow_count++;
+    }
+    /* Clear flag */
+    RTC.INTFLAGS = flags & (RTC_OVF_bm | RTC_CMP_bm);
+    ISR_TRACE_EXIT(MILLIS);
+  }
 #else
-  #error "No millis timer selected, but not disabled - cannot determine millis vector"
+  ISR(MILLIS_TIMER_VECT, __attribute__((weak))) {
+    ISR_TRACE_ENTER(MILLIS);
+    TRACE_ISR(MILLIS, 0);
+    _millisTick();
+    ISR_TRACE_EXIT(MILLIS);
+  }
 #endif
-{
-  // copy these to local variables so they can be stored in registers
-  // (volatile variables must be read from memory on every access)
-
-  #if (defined(MILLIS_USE_TIMERB0)|defined(MILLIS_USE_TIMERB1))
-    #if (F_CPU>1000000)
-      timer_millis++; // that's all we need to do!
-    #else
-      timer_millis += 2;
-    #endif
-  #else
-    #if !defined(MILLIS_USE_TIMERRTC) // TCA0 or TCD0
-      uint32_t m = timer_millis;
-      uint16_t f = timer_fract;
-      m += MILLIS_INC;
-      f += FRACT_INC;
-      if (f >= FRACT_MAX) {
-
-        f -= FRACT_MAX;
-        m += 1;
-      }
-      timer_fract = f;
-      timer_millis = m;
-    #endif
-    // if RTC is used as timer, we only increment the overflow count
-    timer_overflow_count++;
-  #endif
-  /* Clear flag */
-  #if defined(MILLIS_USE_TIMERA0)
-    TCA0.SPLIT.INTFLAGS = TCA_SPLIT_HUNF_bm;
-  #elif defined(MILLIS_USE_TIMERD0)
-    TCD0.INTFLAGS = TCD_OVF_bm;
-  #elif defined(MILLIS_USE_TIMERRTC)
-    RTC.INTFLAGS = RTC_OVF_bm;
-  #else // timerb
-    _timer->INTFLAGS = TCB_CAPT_bm;
-  #endif
-}
 
 /*  Both millis and micros must take great care to prevent any kind of backward time travel.
  *
@@ -258,8 +229,9 @@ unsigned long millis() {
   return m;
 }
 #ifndef MILLIS_USE_TIMERRTC
-
-  unsigned long micros() {
+  /* micros() and micros16() are the same code - with the latter, the compiler narrows the math to 16 bits, since only
+   * the low word of the result is used. The ticks -> microseconds conversion below is already done on 16-bit values. */
+  static inline __attribute__((always_inline)) unsigned long _micros() {
     unsigned long overflows, microseconds;
     #if (defined(MILLIS_USE_TIMERD0) || defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1))
       uint16_t ticks;
@@ -654,6 +626,14 @@ unsigned long millis() {
     #endif // end of timer-specific part of micros calculations
     return microseconds;
   }
+
+  unsigned long micros() {
+    return _micros();
+  }
+
+  uint16_t micros16() {
+    return (uint16_t) _micros();
+  }
   #else // end of non-RTC micros code
   /* We do not have a timebase sufficiently accurate to give microsecond timing. In fact, we barely have millisecond timing available
    * The microsecond delay counts clock cycles, and so it does still work. It is planned that a future library will switch the millis
@@ -665,7 +645,75 @@ unsigned long millis() {
       badCall("microsecond timekeeping is not supported when the RTC is used as the sole timekeeping timer (though delayMicroseconds() is)");
       return -1;
     }
+    uint16_t micros16() {
+      badCall("microsecond timekeeping is not supported when the RTC is used as the sole timekeeping timer (though delayMicroseconds() is)");
+      return -1;
+    }
   #endif
+
+  /* timeSnapshot() - millis and the raw count of the millis timer from a single critical section, so the two are
+   * consistent with each other. Same overflow compensation as micros(). ticks counts up from the last millis timer
+   * overflow (which is 1 ms for a TCB, not for TCA0/TCD0; see TIME_TRACKING_TIMER_PERIOD), or is RTC.CNT. */
+  time_snapshot_t timeSnapshot() {
+    time_snapshot_t snap;
+    uint8_t flags;
+    uint8_t oldSREG = SREG;
+    cli();
+    #if defined(MILLIS_USE_TIMERRTC)
+      snap.ticks = RTC.CNT;
+      flags      = RTC.INTFLAGS;
+      uint32_t m = timer_overflow_count;
+    #else
+      #if defined(MILLIS_USE_TIMERA0)
+        snap.ticks = (TIME_TRACKING_TIMER_PERIOD) - TCA0.SPLIT.HCNT;
+        flags      = TCA0.SPLIT.INTFLAGS;
+      #elif defined(MILLIS_USE_TIMERD0)
+        TCD0.CTRLE = TCD_SCAPTUREA_bm;
+        while (!(TCD0.STATUS & TCD_CMDRDY_bm));
+        flags      = TCD0.INTFLAGS;
+        snap.ticks = TCD0.CAPTUREA;
+      #else
+        snap.ticks = _timer->CNT;
+        flags      = _timer->INTFLAGS;
+      #endif
+      uint32_t m = timer_millis;
+      #if !(defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1))
+        uint16_t f = timer_fract;
+      #endif
+    #endif
+    SREG = oldSREG;
+    #if defined(MILLIS_USE_TIMERRTC)
+      if ((flags & RTC_OVF_bm) && !(snap.ticks & 0x8000)) {
+        m++;
+      }
+      m = (m << 16) + snap.ticks;
+      m = m - (m >> 5) + (m >> 7);
+    #elif defined(MILLIS_USE_TIMERD0)
+      if ((flags & TCD_OVF_bm) && (snap.ticks < 0x07)) {
+    #elif defined(MILLIS_USE_TIMERA0)
+      if ((flags & TCA_SPLIT_HUNF_bm) && (snap.ticks < 0x4)) {
+    #else
+      if ((flags & TCB_CAPT_bm) && !(snap.ticks & 0xFF00)) {
+    #endif
+    #if !defined(MILLIS_USE_TIMERRTC) // the ISR hasn't run for an overflow we can see - do its job.
+      #if (defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1))
+        #if (F_CPU > 1000000)
+          m++;
+        #else
+          m += 2;
+        #endif
+      #else
+        m += MILLIS_INC;
+        f += FRACT_INC;
+        if (f >= FRACT_MAX) {
+          m++;
+        }
+      #endif
+      }
+    #endif
+    snap.millis = m;
+    return snap;
+  }
 #else
   /* Uses should not call millis() or micros() if the core timekeeping has been disabled. Usually, encountering this error either means
    * that they disabled millis earlier for some other sketch, and the preferences were saved with that - or that they are using a library
@@ -681,6 +729,15 @@ unsigned long millis() {
     badCall("millis() is not available because it has been disabled through the tools -> millis()/micros() menu");
     return -1;
   }
+  uint16_t micros16() {
+    badCall("micros16() is not available because it has been disabled through the tools -> millis()/micros() menu");
+    return -1;
+  }
+  time_snapshot_t timeSnapshot() {
+    badCall("timeSnapshot() is not available because it has been disabled through the tools -> millis()/micros() menu");
+    time_snapshot_t snap = {0, 0};
+    return snap;
+  }
 #endif // end of non-MILLIS_USE_TIMERNONE code
 
 
@@ -710,7 +767,7 @@ unsigned long millis() {
  *  the delay duration of up to 1ms. That doesn't matter much when you call delay(1000) on an internal clock that's within
  *  1% on a good day. It matters greatly when you call delay(1);    */
 
-#if defined(MILLIS_USE_TIMERNONE) || (PROGMEM_SIZE < 16384 && defined(MILLIS_USE_TIMERRTC))
+#if defined(MILLIS_USE_TIMERNONE)
   void delay(uint32_t ms) { /* Interrupts will prolong this delay */
     if (__builtin_constant_p(ms)) {
       _delay_ms(ms);
@@ -720,10 +777,59 @@ unsigned long millis() {
       }
     }
   }
+#elif defined(MILLIS_USE_TIMERRTC)
+  /* Tickless delay - with the RTC the only periodic wakeup is the overflow every 64 seconds, so rather than spin,
+   * we set the compare match to when the delay is up and sit in idle sleep until then. Other interrupts still
+   * wake us up and get serviced, we just go back to sleep afterwards. The RTC ticks 1024 times a second, so a
+   * delay is rounded up to the next whole tick; under 16 ms we use _delay_ms() instead, like the other timers.
+   * Working from RTC.CNT rather than millis() means set_millis() does not affect a delay already in progress
+   * (unless it's called from an ISR during one), and keeps this small enough for the small-flash parts. */
+  void delay(uint32_t ms) {
+    if (ms < 16) {
+      if (__builtin_constant_p(ms)) {
+        _delay_ms(ms);
+      } else {
+        while (ms--) {
+          _delay_ms(1);
+        }
+      }
+      return;
+    }
+    uint32_t ticks = ms + (ms >> 6) + (ms >> 7) + (ms >> 11) + 1; // ms * 1.024, that's 1.023926 - plus 1 to round up.
+    do {
+      uint16_t chunk = (ticks > 0x4000) ? 0x4000 : (uint16_t) ticks;
+      ticks -= chunk;
+      uint8_t oldSREG = SREG;
+      cli();
+      while (RTC.STATUS & RTC_CMPBUSY_bm);   // CMP is synchronized to the RTC clock
+      RTC.CMP      = RTC.CNT + chunk;        // PER is 0xFFFF, so this wraps just the same as CNT.
+      RTC.INTFLAGS = RTC_CMP_bm;
+      RTC.INTCTRL  = RTC_OVF_bm | RTC_CMP_bm;
+      if (oldSREG & CPU_I_bm) {
+        uint8_t slpctrl = SLPCTRL.CTRLA;
+        SLPCTRL.CTRLA   = SLPCTRL_SMODE_IDLE_gc | SLPCTRL_SEN_bm;
+        while (RTC.INTCTRL & RTC_CMP_bm) {   // the ISR clears that bit when the compare match happens.
+          sei();
+          yield();                           // any tasks get a turn each time we wake
+          cli();
+          if (RTC.INTCTRL & RTC_CMP_bm) {
+            __asm__ __volatile__ ("sei" "\n\t" "sleep" "\n\t" "cli"); // sei takes effect after the sleep, so
+          }                                  // an interrupt between the check and the sleep still wakes us.
+        }
+        SLPCTRL.CTRLA   = slpctrl;
+      } else {                               // called with interrupts off - no sleeping, just watch the flag.
+        while (!(RTC.INTFLAGS & RTC_CMP_bm));
+        RTC.INTFLAGS = RTC_CMP_bm;
+        RTC.INTCTRL  = RTC_OVF_bm;
+      }
+      SREG = oldSREG;
+    } while (ticks);
+  }
 #elif (PROGMEM_SIZE >= 16384 && !defined(MILLIS_USE_TIMERRTC))
   void delay(uint32_t ms) { /* Interrupts will not prolong this less flash-efficient delay */
     uint16_t start = (uint16_t) micros();
     while (ms > 0) {
+      yield();
       while (((uint16_t) micros() - start) >= 1000 && ms) {
         ms-- ;
         start += 1000;
@@ -740,7 +846,9 @@ unsigned long millis() {
       }
     } else {
       uint32_t start = millis();
-      while (millis() - start < ms);
+      while (millis() - start < ms) {
+        yield();
+      }
     }
   }
 #endif
@@ -1115,6 +1223,61 @@ __attribute__ ((noinline)) void _delayMicroseconds(unsigned int us) {
   // return = 4 cycles
 }
 
+/* delayPrecise() times the delay with a timer rather than by counting loop passes, so time spent in ISRs meanwhile is
+ * part of the delay instead of being added to it, and it doesn't depend on a loop tuned for each F_CPU. With a TCB
+ * as millis timer, it watches that; otherwise it borrows a TCB (TCB1, or TCB0 on parts that only have one - or
+ * DELAYPRECISE_TCB), clocked at F_CPU, for the length of the delay. If that TCB is in use (tone, Servo), it falls
+ * back to delayMicroseconds(). It ends within a pass of the polling loop (around 8 clocks with a borrowed TCB, 20
+ * with the millis one) of the time asked for; the couple of dozen clocks the call and setup take are allowed for.
+ * An ISR that takes longer than the timer's wrap (1 ms with the millis TCB, 65536 clocks otherwise) loses time.
+ */
+#define DELAYPRECISE_OVERHEAD (40)          // clocks from the call to the first read of the timer, roughly.
+#if defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1)
+  void delayPrecise(unsigned int us) {
+    int32_t left = (int32_t)(microsecondsToClockCycles(us) - DELAYPRECISE_OVERHEAD) / TIME_TRACKING_TIMER_DIVIDER;
+    uint16_t last = _timer->CNT;
+    while (left > 0) {
+      uint16_t now   = _timer->CNT;
+      uint16_t ticks = now - last;
+      if (now < last) {
+        ticks += TIME_TRACKING_TICKS_PER_OVF;   // it wraps at the end of each ms, not at 0xFFFF.
+      }
+      last  = now;
+      left -= ticks;
+    }
+  }
+#else
+  #if !defined(DELAYPRECISE_TCB)
+    #if defined(TCB1)
+      #define DELAYPRECISE_TCB TCB1
+    #else
+      #define DELAYPRECISE_TCB TCB0
+    #endif
+  #endif
+  void delayPrecise(unsigned int us) {
+    if (DELAYPRECISE_TCB.CTRLA & TCB_ENABLE_bm) {
+      _delayMicroseconds(us);
+      return;
+    }
+    int32_t left = (int32_t)microsecondsToClockCycles(us) - DELAYPRECISE_OVERHEAD;
+    DELAYPRECISE_TCB.CTRLB = TCB_CNTMODE_INT_gc;  // periodic interrupt (with the interrupt off), wrapping at 0xFFFF.
+    DELAYPRECISE_TCB.CCMP  = 0xFFFF;
+    DELAYPRECISE_TCB.CNT   = 0;
+    DELAYPRECISE_TCB.CTRLA = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;
+    uint16_t last = 0;
+    while (left > 0x4000) {                   // long delays a piece at a time, so a wrap is never missed...
+      uint16_t now = DELAYPRECISE_TCB.CNT;
+      left -= (uint16_t)(now - last);
+      last  = now;
+    }
+    if (left > 0) {                           // ...and then straight to the end, in a tight loop.
+      uint16_t end = last + (uint16_t)left;
+      while ((int16_t)(DELAYPRECISE_TCB.CNT - end) < 0);
+    }
+    DELAYPRECISE_TCB.CTRLA = 0;
+  }
+#endif
+
 void stop_millis()
 { // Disable the interrupt:
   #if defined(MILLIS_USE_TIMERNONE)
@@ -1244,14 +1407,100 @@ void set_millis(__attribute__((unused))uint32_t newmillis)
 }
 
 
+#if defined(CORE_LAZY_ADC_INIT) || defined(CORE_LAZY_PWM_INIT)
+  uint8_t _init_pending = 0;
+
+  void _initPending(uint8_t what) {
+    uint8_t oldSREG = SREG;
+    cli();
+    what &= _init_pending;
+    _init_pending &= ~what;
+    SREG = oldSREG;
+    #if defined(CORE_LAZY_ADC_INIT)
+      if (what & INIT_PENDING_ADC0) {
+        init_ADC0();
+      }
+    #endif
+    #if defined(CORE_LAZY_PWM_INIT)
+      if (what & TIMERA0) {
+        init_TCA0();
+      }
+      #if (defined(TCD0) && defined(USE_TIMERD0_PWM) && !defined(MILLIS_USE_TIMERD0))
+        if (what & TIMERD0) {
+          init_TCD0();
+        }
+      #endif
+    #endif
+  }
+#endif
+
+#if defined(CORE_MEASURE_INIT)
+  /* A TCB clocked by CLK_PER counts system clock cycles whatever init_clock() sets the clock to, so each entry is
+   * the cycles that step of init() took (plus 2 or 3 for reading the timer), the last one the total. It isn't the
+   * millis timer and is put back to its reset state afterwards. */
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define INIT_MEASURE_TIMER TCB1
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define INIT_MEASURE_TIMER TCB0
+  #else
+    #error "CORE_MEASURE_INIT needs a type B timer that millis isn't using"
+  #endif
+  uint16_t init_cycles[5];
+  #define INIT_MEASURE(step) (init_cycles[step] = INIT_MEASURE_TIMER.CNT)
+#else
+  #define INIT_MEASURE(step)
+#endif
+
 void init() {
   // Initializes hardware: First we configure the main clock, then fire up the other peripherals
+  #if defined(CORE_RESET_INFO)
+    _reset_info_init();
+  #endif
+  #if defined(CORE_TRACE)
+    _trace_init();
+  #endif
+  #if defined(CORE_MEASURE_INIT)
+    INIT_MEASURE_TIMER.CCMP  = 0xFFFF;
+    INIT_MEASURE_TIMER.CTRLA = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;
+  #endif
   init_clock();
-  init_ADC0();
-  init_timers();
+  INIT_MEASURE(INIT_CYCLES_CLOCK);
+  #if defined(CORE_LAZY_ADC_INIT)
+    _init_pending |= INIT_PENDING_ADC0;     // analogRead() and the rest do it the first time
+  #else
+    init_ADC0();
+  #endif
+  INIT_MEASURE(INIT_CYCLES_ADC);
+  #if defined(CORE_LAZY_PWM_INIT)
+    // analogWrite() and pwmAttach() do it the first time - except TCA0 when millis needs it running.
+    #if defined(MILLIS_USE_TIMERA0)
+      init_TCA0();
+    #else
+      _init_pending |= TIMERA0;
+    #endif
+    #if (defined(TCD0) && defined(USE_TIMERD0_PWM) && !defined(MILLIS_USE_TIMERD0))
+      _init_pending |= TIMERD0;
+    #endif
+  #else
+    init_timers();
+  #endif
+  INIT_MEASURE(INIT_CYCLES_TIMERS);
   #ifndef MILLIS_USE_TIMERNONE
     init_millis();
   #endif
+  INIT_MEASURE(INIT_CYCLES_MILLIS);
+  #if defined(CORE_MEASURE_INIT)
+    INIT_MEASURE_TIMER.CTRLA = 0;
+    INIT_MEASURE_TIMER.CCMP  = 0;
+    INIT_MEASURE_TIMER.CNT   = 0;
+    init_cycles[INIT_CYCLES_TOTAL] = init_cycles[INIT_CYCLES_MILLIS];
+    for (uint8_t i = INIT_CYCLES_MILLIS; i; i--) {
+      init_cycles[i] -= init_cycles[i - 1];
+    }
+  #endif
+  #if ISR_TRACE_MASK
+    ((VPORT_t *)(ISR_TRACE_VPORT * 4))->DIR |= ISR_TRACE_MASK;
+  #endif
   /*************************** ENABLE GLOBAL INTERRUPTS *************************/
   // Finally, after everything is initialized, we go ahead and enable interrupts.
   sei();
@@ -107,11 +107,9 @@ inline __attribute__((always_inline)) void check_valid_dac_ref(uint8_t mode) {
   }
 }
 
-inline __attribute__((always_inline)) void check_valid_duty_cycle(int16_t val) {
-  if (__builtin_constant_p(val)) {
-    if (val < 0 || val > 255)
-      badArg("analogWrite duty cycle called with a constant not between 0 and 255");
-  }
+inline __attribute__((always_inline)) void check_valid_duty_cycle(__attribute__((unused)) int16_t val) {
+  // Nothing to check at compile time any more - with analogWriteResolution(), any int can be a valid duty cycle.
+  // An int is 16 bits, so at 16-bit resolution, values above 32767 come in negative and are taken as unsigned.
 }
 
 inline __attribute__((always_inline)) void check_valid_resolution(uint8_t res) {
@@ -135,6 +133,7 @@ inline __attribute__((always_inline)) void check_valid_resolution(uint8_t res) {
 
 inline bool analogReadResolution(uint8_t res) {
   check_valid_resolution(res);
+  _lazyInitADC0();
   #if MEGATINYCORE_SERIES == 2
     bool temp = (res == 8 || res == 10 || res == 12);
     _analog_options = (_analog_options & 0xF0) | (temp ? res : 10); // just set that variable, setting the bit is awkward.
@@ -295,6 +294,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 
   void analogReference(uint8_t mode) {
     check_valid_analog_ref(mode);
+    _lazyInitADC0();
     #if defined(STRICT_ERROR_CHECKING)
       if (mode > 7) return;
     #else
@@ -306,19 +306,50 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
     // Uh? Is that it? That was, ah, a tiny bit simpler.
   }
 
-  int16_t analogRead(uint8_t pin) {
-    check_valid_analog_pin(pin);
+  /* The last pin (or channel) that was looked up and found valid, and its MUXPOS value - a sketch that reads the
+   * same pin over and over skips the lookup and the checks. Everything else analogRead() depends on is left in the
+   * ADC registers by the functions that set it, so there's nothing more to redo. MUXPOS itself is always written,
+   * since the sensor functions and the rest change it. */
+  static uint8_t _adc_last_pin = NOT_A_PIN;
+  static uint8_t _adc_last_channel;
+
+  static uint8_t _analogChannel(uint8_t pin) {
+    if (pin == _adc_last_pin) {
+      return _adc_last_channel;
+    }
+    uint8_t channel;
     if (pin < 0x80) {
       // If high bit set, it's a channel, otherwise it's a digital pin so we look it up..
-      pin = digitalPinToAnalogInput(pin);
+      channel = digitalPinToAnalogInput(pin);
     } else {
-      pin &= 0x3F;
+      channel = pin & 0x3F;
     }
     #if PROGMEM_SIZE < 8096
-      if (pin > 0x33) { // covers most ways a bad channel could come about
+      if (channel > 0x33) { // covers most ways a bad channel could come about
     #else
-      if (pin > NUM_ANALOG_INPUTS && ((pin < 0x30) || (pin > 0x33))) {
+      if (channel > NUM_ANALOG_INPUTS && ((channel < 0x30) || (channel > 0x33))) {
     #endif
+      return NOT_A_PIN;
+    }
+    _adc_last_pin     = pin;
+    _adc_last_channel = channel;
+    return channel;
+  }
+
+  bool analogPrepare(uint8_t pin) {
+    check_valid_analog_pin(pin);
+    _lazyInitADC0();
+    pin = _analogChannel(pin);
+    if (pin == NOT_A_PIN || (ADC0.COMMAND & ADC_START_gm)) return false;
+    ADC0.MUXPOS = pin;
+    return true;
+  }
+
+  HOT_PATH int16_t analogRead(uint8_t pin) {
+    check_valid_analog_pin(pin);
+    _lazyInitADC0();
+    pin = _analogChannel(pin);
+    if (pin == NOT_A_PIN) {
       return ADC_ERROR_BAD_PIN_OR_CHANNEL;
     }
     if (!ADC0.CTRLA & 0x01) return ADC_ERROR_DISABLED;
@@ -343,6 +374,29 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
     return ADC0.RESULT;
   }
 
+  bool analogReadStart(uint8_t pin) {
+    check_valid_analog_pin(pin);
+    _lazyInitADC0();
+    pin = _analogChannel(pin);
+    if (pin == NOT_A_PIN) {
+      return false;
+    }
+    if (!(ADC0.CTRLA & 0x01) || (ADC0.COMMAND & ADC_START_gm)) return false;
+    ADC0.MUXPOS   = pin;
+    ADC0.INTFLAGS = ADC_RESRDY_bm; // in case an earlier result was never read.
+    ADC0.COMMAND  = (_analog_options & 0x0F) > 8 ? 0x11 : 0x01;
+    return true;
+  }
+
+  int16_t analogReadResult() {
+    if (!(ADC0.INTFLAGS & ADC_RESRDY_bm)) return ADC_ERROR_BUSY;
+    int16_t temp = ADC0.RESULT;  // clears RESRDY
+    if ((_analog_options & 0x0F) == 10) {
+      temp >>= 2;
+    }
+    return temp;
+  }
+
 
   inline __attribute__((always_inline)) void check_valid_negative_pin(uint8_t pin) {
     if (__builtin_constant_p(pin)) {
@@ -358,6 +412,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
   }
 
   void ADCPowerOptions(uint8_t options) {
+    _lazyInitADC0();
     // 0b 0000 PPLL
     // LL = LOWLAT
     // 00 = No action.
@@ -385,13 +440,94 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 
   }
   bool analogSampleDuration(uint8_t sampdur) {
+    _lazyInitADC0();
     // any uint8_t ius a legal value...
     ADC0.CTRLE = sampdur;
     return true;
   }
 
+  uint8_t getAnalogReadResolution() {
+    return _analog_options & 0x0F;
+  }
+
+
+  /* ADC_GAIN_AUTO: the PGA gain last used for each channel (0-15, and the internal ones, 0x30-0x33), as log2(gain) + 1,
+   * 0 if there hasn't been an auto-ranged read of it yet. The reading at that gain is kept unless it's clipping, or low
+   * enough that the next gain up would still fit - only then is there an 8-bit conversion at unity gain to pick a new
+   * one. So a steady signal costs exactly one conversion, like a fixed gain. */
+  static uint8_t _adc_autogain[20];
+
+  int32_t _analogReadEnh(uint8_t pin, uint8_t neg, uint8_t res, uint8_t gain);
+
+  #define ADC_AUTOGAIN_ERROR_MIN (-2000000000L) // the ADC_ENH_ERROR_ codes are all below this
+
+  /* Below 7/8 of full scale doesn't clip, and the PGA's own headroom is about that. */
+  static bool _autogain_fits(int32_t result, int32_t fullscale) {
+    if (result < 0) {
+      result = -result;
+    }
+    return (result << 3) < fullscale * 7;
+  }
+
+  /* Over 3/8 of full scale, the next gain up could clip. The gap between that and 7/16 - where a new gain puts it - is
+   * so a signal sitting right on the boundary doesn't pick a new gain every time. */
+  static bool _autogain_high(int32_t result, int32_t fullscale) {
+    if (result < 0) {
+      result = -result;
+    }
+    return (result << 3) >= fullscale * 3;
+  }
+
+  static int32_t _analogReadAutoGain(uint8_t pin, uint8_t neg, uint8_t res) {
+    uint8_t ch = (pin < 0x80) ? digitalPinToAnalogInput(pin) : (pin & 0x3F);
+    uint8_t *cache = NULL;
+    if (ch < 16) {
+      cache = &_adc_autogain[ch];
+    } else if (ch >= 0x30 && ch <= 0x33) {
+      cache = &_adc_autogain[ch - 0x30 + 16];
+    }
+    // Full scale of the result at this res: 12 bits accumulated 2^n times raw, or res bits - half that either way
+    // for a differential reading, which is signed.
+    int32_t fullscale = (res & 0x80) ? (4096L << (res & 0x0F)) : (1L << (res & 0x1F));
+    if (neg != SINGLE_ENDED) {
+      fullscale >>= 1;
+    }
+    uint8_t shift = cache ? *cache : 0;
+    int32_t result;
+    if (shift) {
+      shift--;
+      result = _analogReadEnh(ch | 0x80, neg, res, 1 << shift);
+      if (result < ADC_AUTOGAIN_ERROR_MIN) {
+        return result;
+      }
+      if (_autogain_fits(result, fullscale) && (shift == 4 || _autogain_high(result, fullscale))) {
+        return result << (4 - shift);
+      }
+    }
+    int32_t coarse = _analogReadEnh(ch | 0x80, neg, 8, 1);
+    if (coarse < ADC_AUTOGAIN_ERROR_MIN) {
+      return coarse;
+    }
+    int32_t coarse_fs = (neg != SINGLE_ENDED) ? 128 : 256;
+    shift = 0;
+    while (shift < 4 && _autogain_fits(coarse << (shift + 1), coarse_fs)) {
+      shift++;
+    }
+    if (cache) {
+      *cache = shift + 1;
+    }
+    result = _analogReadEnh(ch | 0x80, neg, res, 1 << shift);
+    if (result < ADC_AUTOGAIN_ERROR_MIN) {
+      return result;
+    }
+    return result << (4 - shift);  // in units of 1/16 LSB at unity gain, whatever gain it took
+  }
 
   int32_t _analogReadEnh(uint8_t pin, uint8_t neg, uint8_t res, uint8_t gain) {
+    if (gain == ADC_GAIN_AUTO) {
+      return _analogReadAutoGain(pin, neg, res);
+    }
+    _lazyInitADC0();
     if (!(ADC0.CTRLA & 0x01)) return ADC_ENH_ERROR_DISABLED;
     uint8_t sampnum;
     if (res > 0x80) { // raw accumulation
@@ -485,8 +621,8 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
     check_valid_enh_res(res);
     check_valid_analog_pin(pin);
     if (__builtin_constant_p(gain)) {
-      if (gain != 0 && gain != 1 && gain != 2 && gain != 4 && gain != 8 && gain != 16)
-        badArg("The requested gain is not available on this part, accepted values are 0, 1, 2, 4, 8 and 16.");
+      if (gain != 0 && gain != 1 && gain != 2 && gain != 4 && gain != 8 && gain != 16 && gain != ADC_GAIN_AUTO)
+        badArg("The requested gain is not available on this part, accepted values are 0, 1, 2, 4, 8, 16 and ADC_GAIN_AUTO.");
     }
     return _analogReadEnh(pin, SINGLE_ENDED, res, gain);
   }
@@ -496,8 +632,8 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
     check_valid_analog_pin(pos);
     check_valid_negative_pin(neg);
     if (__builtin_constant_p(gain)) {
-      if (gain != 0 && gain != 1 && gain != 2 && gain != 4 && gain != 8 && gain != 16)
-        badArg("The requested gain is not available on this part, accepted values are 0, 1, 2, 4, 8 and 16.");
+      if (gain != 0 && gain != 1 && gain != 2 && gain != 4 && gain != 8 && gain != 16 && gain != ADC_GAIN_AUTO)
+        badArg("The requested gain is not available on this part, accepted values are 0, 1, 2, 4, 8, 16 and ADC_GAIN_AUTO.");
     }
     return _analogReadEnh(pos, neg, res, gain);
   }
@@ -516,6 +652,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
   0 takes action, and -1 sets to default.
   */
   int16_t analogClockSpeed(int16_t frequency, uint8_t options) {
+    _lazyInitADC0();
     if (frequency == -1) {
       frequency = 2750;
     }
@@ -549,6 +686,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
   *****************************************************/
   void analogReference(uint8_t mode) {
     check_valid_analog_ref(mode);
+    _lazyInitADC0();
     switch (mode) {
       #if defined(EXTERNAL)
         case EXTERNAL:
@@ -574,21 +712,48 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
   }
 
 
-  int analogRead(uint8_t pin) {
-    check_valid_analog_pin(pin);
+  /* The last pin (or channel) that was looked up and found valid, and its channel - see the 2-series ones above. */
+  static uint8_t _adc_last_pin = NOT_A_PIN;
+  static uint8_t _adc_last_channel;
 
+  static uint8_t _analogChannel(uint8_t pin) {
+    if (pin == _adc_last_pin) {
+      return _adc_last_channel;
+    }
+    uint8_t channel = pin;
     if (pin < 0x80) {
       // If high bit set, it's a channel, otherwise it's a digital pin so we look it up..
-      pin = digitalPinToAnalogInput(pin);
+      channel = digitalPinToAnalogInput(pin);
     }
     #if (PROGMEM_SIZE > 4096)
       // don't waste flash on smallest parts.
-      if ((pin & 0x7F) > 0x1F) { // highest valid mux value for any 0 or 1-series part.
-        return ADC_ERROR_BAD_PIN_OR_CHANNEL;
+      if ((channel & 0x7F) > 0x1F) { // highest valid mux value for any 0 or 1-series part.
+        return NOT_A_PIN;
       }
     #endif
+    channel &= 0x1F;
+    _adc_last_pin     = pin;
+    _adc_last_channel = channel;
+    return channel;
+  }
+
+  bool analogPrepare(uint8_t pin) {
+    check_valid_analog_pin(pin);
+    _lazyInitADC0();
+    pin = _analogChannel(pin);
+    if (pin == NOT_A_PIN || ADC0.COMMAND) return false;
+    ADC0.MUXPOS = pin << ADC_MUXPOS_gp;
+    return true;
+  }
+
+  int analogRead(uint8_t pin) {
+    check_valid_analog_pin(pin);
+    _lazyInitADC0();
+    pin = _analogChannel(pin);
+    if (pin == NOT_A_PIN) {
+      return ADC_ERROR_BAD_PIN_OR_CHANNEL;
+    }
     if (!ADC0.CTRLA & 0x01) return ADC_ERROR_DISABLED;
-    pin &= 0x1F;
     /* Reference should be already set up */
     /* Select channel */
     ADC0.MUXPOS = (pin << ADC_MUXPOS_gp);
@@ -607,6 +772,25 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
     return ADC0.RES;
   }
 
+  bool analogReadStart(uint8_t pin) {
+    check_valid_analog_pin(pin);
+    _lazyInitADC0();
+    pin = _analogChannel(pin);
+    if (pin == NOT_A_PIN) {
+      return false;
+    }
+    if (!(ADC0.CTRLA & 0x01) || ADC0.COMMAND) return false;
+    ADC0.MUXPOS   = pin << ADC_MUXPOS_gp;
+    ADC0.INTFLAGS = ADC_RESRDY_bm; // in case an earlier result was never read.
+    ADC0.COMMAND  = ADC_STCONV_bm;
+    return true;
+  }
+
+  int16_t analogReadResult() {
+    if (!(ADC0.INTFLAGS & ADC_RESRDY_bm)) return ADC_ERROR_BUSY;
+    return ADC0.RES;             // clears RESRDY
+  }
+
 
   inline __attribute__((always_inline)) void check_valid_duration(uint8_t samplen) {
     if (__builtin_constant_p(samplen)) {
@@ -617,6 +801,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 
   bool analogSampleDuration(uint8_t dur) {
     check_valid_duration(dur);
+    _lazyInitADC0();
     if (dur > 0x1F) {
       ADC0.SAMPCTRL = 0x1F;
       return false;
@@ -628,6 +813,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 
 
   int32_t analogReadEnh(uint8_t pin, uint8_t res, uint8_t gain) {
+    _lazyInitADC0();
     if (!(ADC0.CTRLA & 0x01)) return ADC_ENH_ERROR_DISABLED;
     check_valid_enh_res(res);
     check_valid_analog_pin(pin);
@@ -710,6 +896,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 
 
   int16_t analogClockSpeed(int16_t frequency, uint8_t options) {
+    _lazyInitADC0();
     if (frequency == -1) {
       frequency = 1450;
     }
@@ -741,6 +928,10 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 #endif
 
 
+#if !defined(MILLIS_USE_TIMERA0)
+  uint8_t _pwm_tca_bits;        // 0 while TCA0 is in split mode, as init_TCA0() sets it up - see analogWriteResolution().
+#endif
+
 // PWM output only works on the pins with
 // hardware support.  These are defined in the variant
 // pins_arduino.h file.  For the rest of the pins, we default
@@ -748,6 +939,7 @@ void DACReference(__attribute__ ((unused))uint8_t mode) {
 void analogWrite(uint8_t pin, int val) {
   check_valid_digital_pin(pin);
   check_valid_duty_cycle(val);
+  _lazyInitPWM();
   uint8_t bit_mask = digitalPinToBitMask(pin);
   if (bit_mask == NOT_A_PIN) {
     return;
@@ -768,6 +960,33 @@ void analogWrite(uint8_t pin, int val) {
   uint8_t digital_pin_timer =  digitalPinToTimer(pin) & PeripheralControl;
   /* end megaTinyCore-specific section */
 
+  #if !defined(MILLIS_USE_TIMERA0)
+    if (_pwm_tca_bits && digital_pin_timer == TIMERA0) {
+      // TCA0 is one 16-bit timer - see analogWriteResolution(). Only WO0-2 have PWM, and val is scaled to the period.
+      #ifdef __AVR_ATtinyxy2__
+      if (bit_mask == 0x80) {
+        bit_mask = 1;  // on the xy2, WO0 is on PA7
+      }
+      #endif
+      uint16_t duty = val;
+      uint16_t top  = 0xFFFF >> (16 - _pwm_tca_bits);
+      if (bit_mask > 0x04) {
+        digitalWrite(pin, duty > (top >> 1) ? HIGH : LOW);
+      } else if (duty == 0) {
+        digitalWrite(pin, LOW);
+      } else if (duty >= top) {
+        digitalWrite(pin, HIGH);
+      } else {
+        uint8_t channel = bit_mask >> 1; // 1, 2, 4 -> 0, 1, 2
+        (&TCA0.SINGLE.CMP0BUF)[channel] = ((uint32_t) duty * (TCA0.SINGLE.PER + 1UL)) >> _pwm_tca_bits;
+        TCA0.SINGLE.CTRLB |= (bit_mask << 4);
+        _setPWMActive(pin);
+      }
+      pinMode(pin, OUTPUT);
+      return;
+    }
+  #endif
+
   uint8_t *timer_cmp_out;
   /* Find out Port and Pin to correctly handle port mux, and timer. */
   switch (digital_pin_timer) {
@@ -891,26 +1110,226 @@ void analogWrite(uint8_t pin, int val) {
       }
       break;
   } // end of switch/case
+  if (digital_pin_timer != NOT_ON_TIMER) {
+    _setPWMActive(pin); // even if it was 0 or 255 and got digitalWrite() - at worst the next digitalWrite() calls turnOffPWM() for nothing.
+  }
   // Now that everything is said and done, we've set the pin high or low as if it's not a PWM pin, or told the timer to give it PWM if it is - this is a better timwe to finally turn on the output drivers.
   // True, it is at most 1-2 PWM timer ticks under typical settings, it's probably at least 1 tick, maybe several at 1 MHz (haven't timed analogWrite lately)
   pinMode(pin, OUTPUT);
 } // end of analogWrite
 
+/* pwmAttach() does what analogWrite() has to on every call - finding the timer and compare channel, and turning the
+ * output on - once, and keeps the compare register's address in the handle, so pwmWrite() is a single store. Pins
+ * without PWM get a handle to a dummy byte, so writing to it does nothing. */
+static uint8_t _pwm_dummy;
+
+pwm_handle_t pwmAttach(uint8_t pin) {
+  check_valid_digital_pin(pin);
+  _lazyInitPWM();
+  pwm_handle_t handle = {&_pwm_dummy, NOT_ON_TIMER, 0};
+  uint8_t bit_mask = digitalPinToBitMask(pin);
+  if (bit_mask == NOT_A_PIN) {
+    return handle;
+  }
+  uint8_t digital_pin_timer = digitalPinToTimer(pin) & PeripheralControl;
+  #if !defined(MILLIS_USE_TIMERA0)
+    if (_pwm_tca_bits && digital_pin_timer == TIMERA0) {
+      return handle;     // 16-bit compare registers; 8-bit handles are for split mode only.
+    }
+  #endif
+  switch (digital_pin_timer) {
+    case TIMERA0:
+    {
+      /* Same compare register as analogWrite() */
+      #ifdef __AVR_ATtinyxy2__
+      if (bit_mask == 0x80) {
+        bit_mask = 1;  // on the xy2, WO0 is on PA7
+      }
+      #endif
+      uint8_t offset = 0;
+      if (bit_mask > 0x04) { // HCMP
+        bit_mask <<= 1;      // mind the gap
+        offset = 1;
+      }
+      if      (bit_mask & 0x44) offset += 4;
+      else if (bit_mask & 0x22) offset += 2;
+      handle.reg   = ((volatile uint8_t *)(&TCA0.SPLIT.LCMP0)) + offset;
+      *handle.reg  = 0;
+      TCA0.SPLIT.CTRLB |= bit_mask;
+      break;
+    }
+  #if defined(DAC0)
+    case DACOUT:
+      handle.reg   = &DAC0.DATA;
+      DAC0.DATA    = 0;
+      DAC0.CTRLA   = 0x41; // OUTEN=1, ENABLE=1
+      break;
+  #endif
+  #if (defined(TCD0) && defined(USE_TIMERD0_PWM))
+    case TIMERD0:
+      handle.bit_mask = bit_mask;
+      analogWrite(pin, 1); // turns the channel on, which has to stop the timer briefly.
+      _pwmWriteTCD0(handle, 0);
+      break;
+  #endif
+    default:
+      return handle;
+  }
+  handle.timer = digital_pin_timer;
+  _setPWMActive(pin);
+  pinMode(pin, OUTPUT);
+  return handle;
+}
+
+#if defined(TCD0)
+  /* TCD0 can't be a single store - it takes a sync command to load the new compare value, and 0 and 255 are done by
+   * setting it to never match, inverted or not, as analogWrite() does with NO_GLITCH_TIMERD0. */
+  void _pwmWriteTCD0(pwm_handle_t handle, uint8_t duty) {
+    uint16_t cmpset  = 509;   // never set, stays low
+    uint8_t  inven   = 0;
+    if (duty == 255) {
+      inven = PORT_INVEN_bm;
+    } else if (duty) {
+      cmpset = ((255 - duty) << 1) - 1;
+    }
+    uint8_t oldSREG = SREG;
+    cli();
+    while ((TCD0.STATUS & (TCD_ENRDY_bm | TCD_CMDRDY_bm)) != (TCD_ENRDY_bm | TCD_CMDRDY_bm));
+    if (handle.bit_mask == 2) {  // PIN_PC1
+      TCD0.CMPBSET = cmpset;
+      PORTC.PIN1CTRL = (PORTC.PIN1CTRL & ~PORT_INVEN_bm) | inven;
+    } else {                     // PIN_PC0
+      TCD0.CMPASET = cmpset;
+      PORTC.PIN0CTRL = (PORTC.PIN0CTRL & ~PORT_INVEN_bm) | inven;
+    }
+    TCD0.CTRLE = TCD_SYNCEOC_bm;
+    SREG = oldSREG;
+  }
+#endif
+
 void takeOverTCA0() {
   TCA0.SPLIT.CTRLA = 0;                                 // Stop TCA0
   PeripheralControl &= ~TIMERA0;                        // Mark timer as user controlled
+  #if defined(CORE_LAZY_PWM_INIT)
+    _init_pending &= ~TIMERA0;                          // and don't set it up on the first analogWrite()
+  #endif
+  #if !defined(MILLIS_USE_TIMERA0)
+    _pwm_tca_bits = 0;
+  #endif
   /* Okay, seriously? The datasheets and io headers disagree here */
   TCA0.SPLIT.CTRLESET = TCA_SPLIT_CMD_RESET_gc | 0x03;  // Reset TCA0
 }
 
 uint8_t digitalPinToTimerNow(uint8_t pin) {
-  return digitalPinToTimer(pin) & PeripheralControl;
+  uint8_t timer = digitalPinToTimer(pin) & PeripheralControl;
+  #if !defined(MILLIS_USE_TIMERA0)
+    if (timer == TIMERA0 && _pwm_tca_bits) {
+      uint8_t bit_mask = digitalPinToBitMask(pin);
+      #ifdef __AVR_ATtinyxy2__
+      if (bit_mask == 0x80) {
+        bit_mask = 1;  // on the xy2, WO0 is on PA7
+      }
+      #endif
+      if (bit_mask > 0x04) {
+        return NOT_ON_TIMER;  // WO3-5 only exist in split mode.
+      }
+    }
+  #endif
+  return timer;
 }
 
+#if !defined(MILLIS_USE_TIMERA0)
+  /* analogWriteResolution() and analogWriteFrequency() rebuild TCA0 as a single 16-bit timer - 3 channels instead of
+   * the 6 that split mode has - with the period set by the frequency, and analogWrite() values scaled to it. Going back
+   * to 8 bits at the default frequency puts it back in split mode, with init_TCA0(). Can't be done if millis uses it. */
+  static uint32_t _pwm_tca_freq;
+
+  static void _pwm_tca_reset() {
+    TCA0.SPLIT.CTRLA    = 0;                                  // Stop TCA0
+    TCA0.SPLIT.CTRLESET = TCA_SPLIT_CMD_RESET_gc | 0x03;      // Reset TCA0 - same as takeOverTCA0().
+  }
+
+  static uint32_t _pwm_tca_single(uint8_t bits, uint32_t hz) {
+    static const uint8_t presc_log2[8] = {0, 1, 2, 3, 4, 6, 8, 10}; // CLKSEL 0-7: DIV1 to DIV1024
+    uint8_t  clksel = 0;
+    uint32_t ticks  = F_CPU / hz;
+    while (clksel < 8 && (ticks >> presc_log2[clksel]) > 0x10000) {
+      clksel++;
+    }
+    if (clksel == 8 || ticks < 2) {
+      return 0;
+    }
+    ticks >>= presc_log2[clksel];
+    uint8_t oldSREG = SREG;
+    cli();
+    uint8_t enabled = _pwm_tca_bits ? TCA0.SINGLE.CTRLB & 0x70 : 0; // keep the channels that were on, if we were single already
+    _pwm_tca_reset();
+    TCA0.SINGLE.CTRLD = 0;
+    TCA0.SINGLE.PER   = ticks - 1;
+    TCA0.SINGLE.CTRLB = TCA_SINGLE_WGMODE_SINGLESLOPE_gc | enabled;
+    TCA0.SINGLE.CTRLA = (clksel << 1) | TCA_SINGLE_ENABLE_bm;
+    _pwm_tca_bits = bits;
+    SREG = oldSREG;
+    return (F_CPU >> presc_log2[clksel]) / ticks;
+  }
+
+  bool analogWriteResolution(uint8_t bits) {
+    _lazyInitPWM();
+    if (!(PeripheralControl & TIMERA0) || bits < 8 || bits > 16) {
+      return false;
+    }
+    if (bits == 8 && !_pwm_tca_freq) {
+      if (_pwm_tca_bits) {
+        _pwm_tca_reset();
+        _pwm_tca_bits = 0;
+        init_TCA0();
+      }
+      return true;
+    }
+    if (_pwm_tca_bits) {
+      _pwm_tca_bits = bits;   // just how values are scaled changes.
+      return true;
+    }
+    return _pwm_tca_single(bits, _pwm_tca_freq ? _pwm_tca_freq : 1000) != 0;
+  }
+
+  uint32_t analogWriteFrequency(uint32_t hz) {
+    _lazyInitPWM();
+    if (!(PeripheralControl & TIMERA0)) {
+      return 0;
+    }
+    if (!hz) {                // back to the default
+      _pwm_tca_freq = 0;
+      if (_pwm_tca_bits == 8 || !_pwm_tca_bits) {
+        analogWriteResolution(8);
+        return 0;
+      }
+      return _pwm_tca_single(_pwm_tca_bits, 1000);
+    }
+    uint32_t actual = _pwm_tca_single(_pwm_tca_bits ? _pwm_tca_bits : 8, hz);
+    if (actual) {
+      _pwm_tca_freq = hz;
+    }
+    return actual;
+  }
+#else
+  bool analogWriteResolution(__attribute__((unused)) uint8_t bits) {
+    badCall("analogWriteResolution() can't change TCA0 when it is used for millis");
+    return false;
+  }
+  uint32_t analogWriteFrequency(__attribute__((unused)) uint32_t hz) {
+    badCall("analogWriteFrequency() can't change TCA0 when it is used for millis");
+    return 0;
+  }
+#endif
+
 #if defined(TCD0)
 void takeOverTCD0() {
   TCD0.CTRLA = 0;                     // Stop TCD0
   _PROTECTED_WRITE(TCD0.FAULTCTRL,0); // Turn off all outputs
   PeripheralControl &= ~TIMERD0;      // Mark timer as user controlled
+  #if defined(CORE_LAZY_PWM_INIT)
+    _init_pending &= ~TIMERD0;
+  #endif
 }
 #endif
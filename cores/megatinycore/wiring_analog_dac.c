@@ -0,0 +1,143 @@
+/* wiring_analog_dac.c - playing a table of samples out of the DAC at a fixed rate
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * dacPlay() writes one sample to DAC0.DATA from the periodic interrupt of a TCB - the only other thing the ISR does is
+ * step to the next sample and check whether it's reached the end (or, double buffered, the middle) of the table. The
+ * samples are 8 bits (the DAC is 8-bit), from RAM, or from flash with DAC_PROGMEM. The range is set by DACReference().
+ *
+ * This file, and the TCB interrupt it defines, are only linked in if the sketch calls dacPlay(); like tone() and
+ * Servo, which also define the interrupts of their TCB, it can't be used together with anything else that does.
+ */
+
+#include "wiring_private.h"
+
+#if defined(DAC0)
+
+#if !defined(DAC_PLAY_TCB) // pick a TCB that millis isn't using; TCB1 if we have one, since tone() uses TCB0.
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define DAC_PLAY_TCB 1
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define DAC_PLAY_TCB 0
+  #endif
+#endif
+
+#if defined(DAC_PLAY_TCB)
+  #if DAC_PLAY_TCB == 1
+    #define _DAC_TCB  TCB1
+    #define _DAC_VECT TCB1_INT_vect
+  #else
+    #define _DAC_TCB  TCB0
+    #define _DAC_VECT TCB0_INT_vect
+  #endif
+
+static const uint8_t      *_dac_samples;
+static uint16_t            _dac_len;
+static volatile uint16_t   _dac_index;
+static uint8_t             _dac_mode;
+static dacCallback_t       _dac_callback;
+static volatile uint8_t    _dac_busy;
+
+static void _dac_end() {
+  _DAC_TCB.CTRLA    = 0;
+  _DAC_TCB.INTCTRL  = 0;
+  _DAC_TCB.INTFLAGS = TCB_CAPT_bm;
+  _dac_busy         = 0;
+}
+
+ISR(_DAC_VECT) {
+  uint16_t index    = _dac_index;
+  if (_dac_mode & DAC_PROGMEM) {
+    DAC0.DATA       = pgm_read_byte(&_dac_samples[index]);
+  } else {
+    DAC0.DATA       = _dac_samples[index];
+  }
+  _DAC_TCB.INTFLAGS = TCB_CAPT_bm;
+  index++;
+  if (index == _dac_len) {
+    index           = 0;
+    if ((_dac_mode & 0x03) == DAC_ONESHOT) {
+      _dac_end();   // the DAC holds the last sample.
+    }
+    if (_dac_callback) {
+      _dac_callback((uint8_t *) _dac_samples + ((_dac_mode & 0x03) == DAC_DOUBLEBUF ? (_dac_len >> 1) : 0));
+    }
+  } else if ((_dac_mode & 0x03) == DAC_DOUBLEBUF && index == (_dac_len >> 1)) {
+    if (_dac_callback) {
+      _dac_callback((uint8_t *) _dac_samples);
+    }
+  }
+  _dac_index        = index;
+}
+
+bool dacPlay(const uint8_t *samples, uint16_t len, uint32_t rate, uint8_t mode, dacCallback_t callback) {
+  if (!samples || !len || !rate) {
+    return false;
+  }
+  if ((mode & 0x03) == DAC_DOUBLEBUF && ((mode & DAC_PROGMEM) || (len & 1) || !callback)) {
+    return false;   // the sketch has to refill the halves, so they must be in RAM.
+  }
+  uint8_t  clksel = TCB_CLKSEL_DIV1_gc;
+  uint32_t ticks  = F_CPU / rate;
+  if (ticks > 0x10000) {
+    ticks >>= 1;
+    clksel = TCB_CLKSEL_DIV2_gc;
+  }
+  if (ticks > 0x10000 || ticks < 64) {
+    return false;   // too slow for the timer (under F_CPU/131072), or too fast for the ISR to keep up.
+  }
+  dacStop();
+  _dac_samples      = samples;
+  _dac_len          = len;
+  _dac_index        = 0;
+  _dac_mode         = mode;
+  _dac_callback     = callback;
+  _dac_busy         = 1;
+  DAC0.CTRLA        = DAC_OUTEN_bm | DAC_ENABLE_bm;
+  _DAC_TCB.CTRLB    = TCB_CNTMODE_INT_gc;
+  _DAC_TCB.CCMP     = ticks - 1;
+  _DAC_TCB.CNT      = 0;
+  _DAC_TCB.INTFLAGS = TCB_CAPT_bm;
+  _DAC_TCB.INTCTRL  = TCB_CAPT_bm;
+  _DAC_TCB.CTRLA    = clksel | TCB_ENABLE_bm;
+  return true;
+}
+
+void dacStop() {
+  uint8_t oldSREG = SREG;
+  cli();
+  _dac_end();
+  SREG = oldSREG;
+}
+
+bool dacBusy() {
+  return _dac_busy;
+}
+
+#else
+  bool dacPlay(__attribute__((unused)) const uint8_t *samples, __attribute__((unused)) uint16_t len, __attribute__((unused)) uint32_t rate, __attribute__((unused)) uint8_t mode, __attribute__((unused)) dacCallback_t callback) {
+    badCall("dacPlay() needs a TCB that isn't used for millis");
+    return false;
+  }
+  void dacStop() {
+    badCall("dacPlay() needs a TCB that isn't used for millis");
+  }
+  bool dacBusy() {
+    badCall("dacPlay() needs a TCB that isn't used for millis");
+    return false;
+  }
+#endif
+
+#else
+  bool dacPlay(__attribute__((unused)) const uint8_t *samples, __attribute__((unused)) uint16_t len, __attribute__((unused)) uint32_t rate, __attribute__((unused)) uint8_t mode, __attribute__((unused)) dacCallback_t callback) {
+    badCall("dacPlay() is not available - this part does not have a DAC");
+    return false;
+  }
+  void dacStop() {
+    badCall("dacPlay() is not available - this part does not have a DAC");
+  }
+  bool dacBusy() {
+    badCall("dacPlay() is not available - this part does not have a DAC");
+    return false;
+  }
+#endif
@@ -0,0 +1,85 @@
+/* wiring_analog_filter.c - digital filters on ADC results, run in the RESRDY ISRs of the stream and scan engines
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Each filter is a handful of adds, shifts and compares on int32_t, so it costs the ISR a few microseconds at most,
+ * and the sketch only ever sees filtered values. The moving average and the medians keep the last few raw results in
+ * a history array that the caller hands out (wiring_analog_scan.c from a pool, so channels without one don't pay for
+ * it); the IIR needs only its accumulator. The first result fills the history (or the accumulator) with itself, so
+ * there's no ramp up from 0 at the start.
+ */
+
+#include "wiring_private.h"
+
+uint8_t _analogFilterLength(uint8_t filter) {
+  uint8_t n = filter & 0x0F;
+  switch (filter & 0xF0) {
+    case 0x00:
+      return n ? 0xFF : 0;
+    case ADC_FILTER_AVG2 & 0xF0:
+      return (n >= 1 && n <= 4) ? (1 << n) : 0xFF;
+    case ADC_FILTER_MEDIAN3 & 0xF0:
+      return (n == 3 || n == 5) ? n : 0xFF;
+    case ADC_FILTER_IIR(1) & 0xF0:
+      return (n >= 1 && n <= 8) ? 0 : 0xFF;
+  }
+  return 0xFF;
+}
+
+static inline int32_t _median3(int32_t a, int32_t b, int32_t c) {
+  if (a > b) {
+    int32_t t = a;
+    a = b;
+    b = t;
+  }
+  // now a <= b: the median is b, unless c is below it, when it's whichever of a and c is higher
+  if (c < b) {
+    b = (c > a) ? c : a;
+  }
+  return b;
+}
+
+static int32_t _median5(const int32_t *hist) {
+  int32_t v[5];
+  for (uint8_t i = 0; i < 5; i++) {   // insertion sort - 5 isn't worth anything cleverer
+    int32_t x = hist[i];
+    uint8_t j = i;
+    while (j && v[j - 1] > x) {
+      v[j] = v[j - 1];
+      j--;
+    }
+    v[j] = x;
+  }
+  return v[2];
+}
+
+int32_t _analogFilter(_adc_filter_t *f, int32_t x) {
+  uint8_t type = f->type;
+  uint8_t n    = type & 0x0F;
+  int32_t *hist = f->hist;
+  if (!f->primed) {
+    f->primed = 1;
+    f->index  = 0;
+    f->acc    = x << n;                 // the sum of the window for the average, y << n for the IIR
+    uint8_t len = _analogFilterLength(type);
+    for (uint8_t i = 0; i < len; i++) {
+      hist[i] = x;
+    }
+  }
+  uint8_t index = f->index;
+  switch (type & 0xF0) {
+    case ADC_FILTER_AVG2 & 0xF0:
+      f->acc     += x - hist[index];
+      hist[index] = x;
+      f->index    = (index + 1) & ((1 << n) - 1);
+      return f->acc >> n;
+    case ADC_FILTER_MEDIAN3 & 0xF0:
+      hist[index] = x;
+      f->index    = (index + 1 == n) ? 0 : index + 1;
+      return (n == 3) ? _median3(hist[0], hist[1], hist[2]) : _median5(hist);
+    case ADC_FILTER_IIR(1) & 0xF0:
+      f->acc     += x - (f->acc >> n);  // y += (x - y) / 2^n, with n fraction bits kept in acc
+      return (f->acc + (1L << (n - 1))) >> n;
+  }
+  return x;
+}
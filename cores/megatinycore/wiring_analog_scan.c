@@ -0,0 +1,297 @@
+/* wiring_analog_scan.c - converting a list of analog channels back to back, from the ADC interrupt
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * analogScanBegin() takes a list of channels, each with its own resolution or accumulation (as analogReadEnh() takes
+ * it), and on the 2-series, PGA gain. Those are worked out into register values once, up front, so all the RESRDY ISR
+ * has to do is store the result, write the next channel's settings and start it - nothing waits on the ADC, and the
+ * only time between conversions is the ISR's. After the last channel of a sweep, the callback gets the results.
+ * Sweeps are started either by a TCB, rate times a second, through the event system (see wiring_analog_trigger.c),
+ * or if rate is 0, by calling analogScanStart() - or by a TCA0 or TCD0 event, after analogScanTrigger(), so each one
+ * starts at the same point in the PWM cycle, to the clock, whatever the ISRs are doing.
+ *
+ * Each channel can have a filter (wiring_analog_filter.c) on its results, so what the callback gets is already
+ * smoothed or despiked; the history the moving averages and medians need comes out of ADC_SCAN_FILTER_POOL.
+ *
+ * This file, like wiring_analog_stream.c, defines the ADC RESRDY vector, so a sketch can use one or the other.
+ */
+
+#include "wiring_private.h"
+
+#if !defined(ADC_SCAN_MAX_CHANNELS)
+  #define ADC_SCAN_MAX_CHANNELS 8
+#endif
+#if !defined(ADC_SCAN_FILTER_POOL)  // results kept for the moving average and median filters, for all channels
+  #define ADC_SCAN_FILTER_POOL 16
+#endif
+
+typedef struct {
+  uint8_t muxpos;
+  uint8_t sampnum;  // 0/1: CTRLB, 2-series: CTRLF
+  uint8_t mode;     // 0/1: the RESSEL bit for CTRLA, 2-series: the MODE bits for COMMAND
+  #if MEGATINYCORE_SERIES == 2
+    uint8_t gain;   // GAIN bits for PGACTRL; only used if muxpos is via the PGA.
+  #endif
+  uint8_t shift;    // how far to rightshift the result
+} _scan_channel_t;
+
+static _scan_channel_t         _scan_channels[ADC_SCAN_MAX_CHANNELS];
+static uint8_t                 _scan_count;
+static volatile uint8_t        _scan_index;
+static volatile uint8_t        _scan_busy;       // in the middle of a sweep
+static uint8_t                 _scan_paced;      // sweeps started by the trigger timer
+static int32_t                *_scan_results;
+static analogScanCallback_t    _scan_callback;
+static _adc_filter_t           _scan_filters[ADC_SCAN_MAX_CHANNELS];
+static int32_t                 _scan_filter_pool[ADC_SCAN_FILTER_POOL];
+#if MEGATINYCORE_SERIES != 2
+  static uint8_t               _scan_ctrla;      // to put RESSEL back the way analogReadResolution() left it
+#endif
+
+static inline __attribute__((always_inline)) void _scan_select(_scan_channel_t *ch) {
+  #if MEGATINYCORE_SERIES == 2
+    if (ch->muxpos & ADC_VIA_PGA_gc) {
+      ADC0.PGACTRL = (ADC0.PGACTRL & ~ADC_GAIN_gm) | ch->gain | ADC_PGAEN_bm;
+    }
+    ADC0.MUXPOS  = ch->muxpos;
+    ADC0.CTRLF   = ch->sampnum;
+  #else
+    ADC0.MUXPOS  = ch->muxpos;
+    ADC0.CTRLB   = ch->sampnum;
+    ADC0.CTRLA   = (ADC0.CTRLA & ~ADC_RESSEL_bm) | ch->mode;
+  #endif
+}
+
+static inline __attribute__((always_inline)) void _scan_start(_scan_channel_t *ch) {
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.COMMAND = ch->mode | ADC_START_IMMEDIATE_gc;
+  #else
+    (void) ch;
+    ADC0.COMMAND = ADC_STCONV_bm;
+  #endif
+}
+
+ISR(ADC0_RESRDY_vect) {
+  uint8_t index = _scan_index;
+  _scan_channel_t *ch = &_scan_channels[index];
+  #if MEGATINYCORE_SERIES == 2
+    int32_t result = ADC0.RESULT;  // reading the result clears the flag.
+    result >>= ch->shift;
+  #else
+    int32_t result = ADC0.RES;
+    uint8_t shift  = ch->shift;
+    if (shift) {
+      if (ch->sampnum) {           // decimation is rounded, the way analogReadEnh() does it.
+        result >>= shift - 1;
+        result = (result >> 1) + (result & 0x01);
+      } else {
+        result >>= shift;
+      }
+    }
+  #endif
+  if (_scan_filters[index].type) {
+    result = _analogFilter(&_scan_filters[index], result);
+  }
+  _scan_results[index++] = result;
+  if (index < _scan_count) {
+    _scan_index = index;
+    ch++;
+    _scan_select(ch);
+    _scan_start(ch);
+  } else {
+    _scan_index = 0;
+    _scan_busy  = 0;
+    _scan_select(_scan_channels);   // ready for the next sweep.
+    #if MEGATINYCORE_SERIES == 2
+      if (_scan_paced) {
+        ADC0.COMMAND = _scan_channels[0].mode | ADC_START_EVENT_TRIGGER_gc;
+      }
+    #endif
+    if (_scan_callback) {
+      _scan_callback(_scan_results, _scan_count);
+    }
+  }
+}
+
+/* Work out the register settings for one channel, or return false if it's not valid. */
+static bool _scan_prepare(_scan_channel_t *ch, const analogScanChannel_t *entry) {
+  uint8_t pin = entry->pin;
+  uint8_t res = entry->res;
+  if (pin < 0x80) {
+    // If high bit set, it's a channel, otherwise it's a digital pin so we look it up..
+    pin = digitalPinToAnalogInput(pin);
+  }
+  ch->shift    = 0;
+  ch->sampnum  = 0;
+  #if MEGATINYCORE_SERIES == 2
+    pin &= 0x3F;
+    if (pin > NUM_ANALOG_INPUTS && ((pin < 0x30) || (pin > 0x33))) {
+      return false;
+    }
+    uint8_t gain = entry->gain;
+    ch->gain     = 0;
+    ch->muxpos   = pin;
+    if (gain) {
+      if (gain != 1 && gain != 2 && gain != 4 && gain != 8 && gain != 16) {
+        return false;
+      }
+      while (gain > 1) {
+        gain >>= 1;
+        ch->gain += 32;
+      }
+      ch->muxpos |= ADC_VIA_PGA_gc;
+    }
+    if (!res) {
+      res = getAnalogReadResolution();
+    }
+    if (res & 0x80) {                         // raw accumulation
+      ch->sampnum = res & 0x7F;
+      if (ch->sampnum > 10) {
+        return false;
+      }
+      ch->mode    = ADC_MODE_BURST_gc;
+    } else if (res == 8) {
+      ch->mode    = ADC_MODE_SINGLE_8BIT_gc;
+    } else if (res < ADC_NATIVE_RESOLUTION_LOW || res > ADC_MAX_OVERSAMPLED_RESOLUTION) {
+      return false;
+    } else if (res > ADC_NATIVE_RESOLUTION) { // oversampling and decimation
+      ch->sampnum = (res - ADC_NATIVE_RESOLUTION) << 1;
+      ch->shift   = res - ADC_NATIVE_RESOLUTION;
+      ch->mode    = ADC_MODE_BURST_gc;
+    } else {
+      ch->shift   = ADC_NATIVE_RESOLUTION - res;
+      ch->mode    = ADC_MODE_SINGLE_12BIT_gc;
+    }
+  #else
+    if (entry->gain) {
+      return false;                           // no PGA on these parts.
+    }
+    pin &= 0x7F;
+    if (pin > 0x1F) {                         // highest valid mux value for any 0 or 1-series part.
+      return false;
+    }
+    ch->muxpos    = pin;
+    ch->mode      = 0;
+    if (!res) {
+      res = getAnalogReadResolution();
+    }
+    if (res & 0x80) {                         // raw accumulation
+      ch->sampnum = res & 0x7F;
+      if (ch->sampnum > 6) {
+        return false;
+      }
+    } else if (res == 8) {
+      ch->mode    = ADC_RESSEL_bm;
+    } else if (res < ADC_NATIVE_RESOLUTION_LOW || res > ADC_MAX_OVERSAMPLED_RESOLUTION) {
+      return false;
+    } else if (res > ADC_NATIVE_RESOLUTION) { // oversampling and decimation
+      ch->sampnum = (res - ADC_NATIVE_RESOLUTION) << 1;
+      ch->shift   = res - ADC_NATIVE_RESOLUTION;
+    } else if (res == ADC_NATIVE_RESOLUTION - 1) {
+      ch->shift   = 1;                        // 9 bits - as in analogReadEnh(), not rounded.
+    }
+  #endif
+  return true;
+}
+
+bool analogScanBegin(const analogScanChannel_t *channels, uint8_t count, int32_t *results, uint32_t rate, analogScanCallback_t callback) {
+  _lazyInitADC0();
+  if (!(ADC0.CTRLA & ADC_ENABLE_bm) || !channels || !results || !count || count > ADC_SCAN_MAX_CHANNELS) {
+    return false;
+  }
+  analogScanStop();
+  uint8_t pool = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (!_scan_prepare(&_scan_channels[i], &channels[i])) {
+      return false;
+    }
+    uint8_t len = _analogFilterLength(channels[i].filter);
+    if (len == 0xFF || pool + len > ADC_SCAN_FILTER_POOL) {
+      return false;               // not a filter, or the history for it won't fit in what's left of the pool
+    }
+    _scan_filters[i].type   = channels[i].filter;
+    _scan_filters[i].hist   = &_scan_filter_pool[pool];
+    _scan_filters[i].primed = 0;
+    pool += len;
+  }
+  if (rate && !_analogTriggerBegin(rate)) {
+    return false;
+  }
+  _scan_count     = count;
+  _scan_index     = 0;
+  _scan_busy      = 0;
+  _scan_results   = results;
+  _scan_callback  = callback;
+  _scan_paced     = (rate != 0);
+  #if MEGATINYCORE_SERIES != 2
+    _scan_ctrla   = ADC0.CTRLA;
+  #endif
+  _scan_select(_scan_channels);
+  ADC0.INTFLAGS   = ADC_RESRDY_bm;
+  ADC0.INTCTRL   |= ADC_RESRDY_bm;
+  if (rate) {
+    #if MEGATINYCORE_SERIES == 2
+      ADC0.COMMAND  = _scan_channels[0].mode | ADC_START_EVENT_TRIGGER_gc;
+    #else
+      ADC0.EVCTRL   = ADC_STARTEI_bm;
+    #endif
+  }
+  return true;
+}
+
+bool analogScanStart() {
+  if (!_scan_count || _scan_paced) {
+    return false;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_scan_busy) {
+    SREG = oldSREG;
+    return false;
+  }
+  _scan_busy = 1;
+  _scan_start(_scan_channels);
+  SREG = oldSREG;
+  return true;
+}
+
+bool analogScanTrigger(uint8_t source) {
+  if (!_scan_count || _scan_paced || _scan_busy || !_analogTriggerFrom(source)) {
+    return false;
+  }
+  _scan_paced     = 1;
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.COMMAND  = _scan_channels[0].mode | ADC_START_EVENT_TRIGGER_gc;
+  #else
+    ADC0.EVCTRL   = ADC_STARTEI_bm;
+  #endif
+  return true;
+}
+
+bool analogScanBusy() {
+  return _scan_busy;
+}
+
+void analogScanStop() {
+  if (!_scan_count) {
+    return;
+  }
+  if (_scan_paced) {
+    _analogTriggerEnd();
+    _scan_paced = 0;
+  }
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.COMMAND   = ADC_START_STOP_gc;
+    ADC0.CTRLF     = 0;
+    ADC0.PGACTRL  &= ~ADC_PGAEN_bm;
+  #else
+    ADC0.EVCTRL    = 0;
+    while (ADC0.COMMAND & ADC_STCONV_bm);
+    ADC0.CTRLB     = 0;
+    ADC0.CTRLA     = _scan_ctrla;
+  #endif
+  ADC0.INTCTRL    &= ~ADC_RESRDY_bm;
+  ADC0.INTFLAGS    = ADC_RESRDY_bm;
+  _scan_count      = 0;
+  _scan_busy       = 0;
+}
@@ -0,0 +1,119 @@
+/* wiring_analog_sensors.c - the internal temperature sensor and the supply voltage, in degrees and millivolts
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Both take 16 samples (ADC_ACC16) with the reference and sample duration the datasheet asks for, after one that is
+ * thrown away while the reference settles, then put back the reference and sample duration that were in use, so they
+ * can be mixed freely with analogRead(). The temperature sensor's calibration is read from the signature row on the
+ * first call and kept; the conversions are integer only.
+ *
+ * 0/1-series: the sensor is read against the internal 1.1V reference, and is (reading + TEMPSENSE1) * TEMPSENSE0 / 256
+ *   Kelvin, with TEMPSENSE1 signed. The supply is found by reading the 1.1V reference with VDD as the reference.
+ * 2-series: the sensor is read against the 1.024V reference, at 12 bits, and is (TEMPSENSE1 * 16 - reading) *
+ *   TEMPSENSE0 / 256 Kelvin. The supply is read directly, on the VDD/10 channel, against the 1.024V reference.
+ * Either way the datasheet wants at least 32 us of sampling.
+ */
+
+#include "wiring_private.h"
+
+static int16_t _sensor_offset;
+static uint8_t _sensor_gain;            // 0 until the calibration has been read
+
+static int16_t _sensor_error(int32_t result) {
+  return (result == ADC_ENH_ERROR_DISABLED) ? ADC_ERROR_DISABLED : ADC_ERROR_BUSY;
+}
+
+/* ADC clocks in 32 us, at the ADC clock as it is set now. */
+static uint8_t _sensor_sample_clocks() {
+  uint16_t clocks = ((uint32_t)analogClockSpeed(0, 0) * 32 + 999) / 1000;
+  return clocks > 255 ? 255 : clocks;
+}
+
+#if MEGATINYCORE_SERIES == 2
+  /* Take 16 samples of channel against the 1.024V reference, with SAMPDUR at least 32 us. */
+  static int32_t _sensor_read(uint8_t channel) {
+    uint8_t samp  = _sensor_sample_clocks();
+    uint8_t ctrlc = ADC0.CTRLC;
+    uint8_t ctrle = ADC0.CTRLE;
+    ADC0.CTRLC = (ctrlc & ~ADC_REFSEL_gm) | ADC_REFSEL_1024MV_gc;
+    if (ctrle < samp) {
+      ADC0.CTRLE = samp;
+    }
+    int32_t result = analogReadEnh(channel, 12, 0);    // the reference settles during this one
+    if (result >= 0) {
+      result = analogReadEnh(channel, ADC_ACC16, 0);
+    }
+    ADC0.CTRLC = ctrlc;
+    ADC0.CTRLE = ctrle;
+    return result;
+  }
+
+  int16_t readTemperature() {
+    if (!_sensor_gain) {
+      _sensor_offset = SIGROW.TEMPSENSE1;
+      _sensor_gain   = SIGROW.TEMPSENSE0;
+    }
+    int32_t acc = _sensor_read(ADC_TEMPERATURE);
+    if (acc < 0) {
+      return _sensor_error(acc);
+    }
+    // 16 samples, so ((TEMPSENSE1 << 8) - acc) * TEMPSENSE0 / 256 is in 1/16ths of a Kelvin.
+    int32_t k16 = ((((int32_t)_sensor_offset << 8) - acc) * _sensor_gain) >> 8;
+    return (k16 - 4370 + 8) >> 4;   // 273.15 K is 4370 16ths
+  }
+
+  int16_t readSupplyVoltage() {
+    int32_t acc = _sensor_read(ADC_VDDDIV10);
+    if (acc < 0) {
+      return _sensor_error(acc);
+    }
+    // 16 samples of VDD/10 at 0.25 mV a count: VDD is acc * 10 / 64 mV.
+    return (acc * 5 + 16) >> 5;
+  }
+#else
+  /* Take 16 samples of channel with the given ADC0 reference, and VREF set to 1.1V for the ADC, with as long a sample
+   * as there is - at most 33 ADC clocks, which is 32 us at the core's ADC clock. */
+  static int32_t _sensor_read(uint8_t channel, uint8_t refsel) {
+    uint8_t samp     = _sensor_sample_clocks();
+    uint8_t ctrlc    = ADC0.CTRLC;
+    uint8_t vref     = VREF.CTRLA;
+    uint8_t sampctrl = ADC0.SAMPCTRL;
+    VREF.CTRLA    = (vref & ~VREF_ADC0REFSEL_gm) | VREF_ADC0REFSEL_1V1_gc;
+    ADC0.CTRLC    = (ctrlc & ADC_PRESC_gm) | refsel | ADC_SAMPCAP_bm;
+    samp          = (samp > 33) ? 31 : ((samp > 2) ? samp - 2 : 0);
+    if (sampctrl < samp) {
+      ADC0.SAMPCTRL = samp;
+    }
+    int32_t result = analogReadEnh(channel, 10, 0);    // the reference settles during this one
+    if (result >= 0) {
+      result = analogReadEnh(channel, ADC_ACC16, 0);
+    }
+    ADC0.SAMPCTRL = sampctrl;
+    ADC0.CTRLC    = ctrlc;
+    VREF.CTRLA    = vref;
+    return result;
+  }
+
+  int16_t readTemperature() {
+    if (!_sensor_gain) {
+      _sensor_offset = (int8_t)SIGROW.TEMPSENSE1;   // signed - and added, not subtracted as the datasheet says
+      _sensor_gain   = SIGROW.TEMPSENSE0;
+    }
+    int32_t acc = _sensor_read(ADC_TEMPERATURE, ADC_REFSEL_INTREF_gc);
+    if (acc < 0) {
+      return _sensor_error(acc);
+    }
+    // 16 samples, so (acc + 16 * TEMPSENSE1) * TEMPSENSE0 / 256 is in 1/16ths of a Kelvin.
+    int32_t k16 = ((acc + ((int32_t)_sensor_offset << 4)) * _sensor_gain) >> 8;
+    return (k16 - 4370 + 8) >> 4;   // 273.15 K is 4370 16ths
+  }
+
+  int16_t readSupplyVoltage() {
+    int32_t acc = _sensor_read(ADC_INTREF, ADC_REFSEL_VDDREF_gc);
+    if (acc <= 0) {
+      return acc ? _sensor_error(acc) : ADC_ERROR_BUSY;
+    }
+    // 16 samples of 1.1V with VDD as full scale: VDD is 1100 mV * 1023 * 16 / acc.
+    return (1100UL * 1023 * 16 + (acc >> 1)) / acc;
+  }
+#endif
@@ -0,0 +1,172 @@
+/* wiring_analog_stream.c - continuous sampling of one analog pin into a double buffer
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * analogStreamBegin() sets the ADC converting one pin over and over - either free-running, as fast as the ADC goes
+ * (rate = 0), or started by the CAPT event of a TCB in periodic interrupt mode, so the time between samples is set by
+ * the timer, not by when an interrupt happens to get run; there is no jitter. The RESRDY ISR stores each result, and
+ * each time half of the buffer is full, the callback is called with that half, while the other half fills. Since the
+ * callback runs in the ISR, it has to be done with that half before the other half is full. With no callback, the
+ * sketch polls analogStreamRead() instead. The timer is set up by wiring_analog_trigger.c. analogStreamFilter() puts
+ * one of the filters in wiring_analog_filter.c on the samples before they are stored.
+ *
+ * This file, and the ADC interrupt it defines, are only linked in if the sketch calls analogStreamBegin(). While it
+ * runs, nothing else may use the ADC - analogRead() would change the mux out from under it.
+ */
+
+#include "wiring_private.h"
+
+static int16_t              *_stream_buffer;
+static uint16_t              _stream_half;      // samples in each half of the buffer
+static volatile uint16_t     _stream_index;     // where the next one goes
+static analogStreamCallback_t _stream_callback;
+static int16_t * volatile    _stream_ready;     // with no callback, the half that was filled and hasn't been read.
+static volatile uint16_t     _stream_overruns;
+static uint8_t               _stream_paced;     // started by the trigger timer, not free-running
+#if MEGATINYCORE_SERIES == 2
+  static uint8_t             _stream_shift;     // 2 in 10-bit compatibility mode, the 2-series ADC is 12 bits.
+#endif
+static _adc_filter_t         _stream_filter;    // see analogStreamFilter()
+static int32_t               _stream_filter_hist[16];
+
+ISR(ADC0_RESRDY_vect) {
+  #if MEGATINYCORE_SERIES == 2
+    int16_t sample = ((int16_t) ADC0.RESULT) >> _stream_shift; // reading the result clears the flag.
+  #else
+    int16_t sample = ADC0.RES;
+  #endif
+  if (_stream_filter.type) {
+    sample = _analogFilter(&_stream_filter, sample);
+  }
+  uint16_t index = _stream_index;
+  _stream_buffer[index++] = sample;
+  int16_t *done = NULL;
+  if (index == _stream_half) {
+    done  = _stream_buffer;
+  } else if (index == (_stream_half << 1)) {
+    done  = _stream_buffer + _stream_half;
+    index = 0;
+  }
+  _stream_index = index;
+  if (done) {
+    if (_stream_callback) {
+      _stream_callback(done, _stream_half);
+    } else {
+      if (_stream_ready) {
+        _stream_overruns++;
+      }
+      _stream_ready = done;
+    }
+  }
+}
+
+bool analogStreamFilter(uint8_t filter) {
+  if (_analogFilterLength(filter) > sizeof(_stream_filter_hist) / sizeof(_stream_filter_hist[0])) {
+    return false;       // including 0xFF, for something that isn't a filter
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _stream_filter.type   = filter;
+  _stream_filter.hist   = _stream_filter_hist;
+  _stream_filter.primed = 0;
+  SREG = oldSREG;
+  return true;
+}
+
+bool analogStreamBegin(uint8_t pin, uint32_t rate, int16_t *buffer, uint16_t len, analogStreamCallback_t callback) {
+  _lazyInitADC0();
+  if (!(ADC0.CTRLA & ADC_ENABLE_bm) || !buffer || len < 2) {
+    return false;
+  }
+  if (pin < 0x80) {
+    // If high bit set, it's a channel, otherwise it's a digital pin so we look it up..
+    pin = digitalPinToAnalogInput(pin);
+  }
+  #if MEGATINYCORE_SERIES == 2
+    pin &= 0x3F;
+    if (pin > NUM_ANALOG_INPUTS && ((pin < 0x30) || (pin > 0x33))) {
+      return false;
+    }
+  #else
+    pin &= 0x7F;
+    if (pin > 0x1F) { // highest valid mux value for any 0 or 1-series part.
+      return false;
+    }
+  #endif
+  analogStreamStop();
+  if (rate && !_analogTriggerBegin(rate)) {
+    return false;
+  }
+  _stream_buffer    = buffer;
+  _stream_half      = len >> 1;
+  _stream_index     = 0;
+  _stream_callback  = callback;
+  _stream_ready     = NULL;
+  _stream_overruns  = 0;
+  _stream_filter.primed = 0;  // the filter, if any, starts over from the first sample
+  #if MEGATINYCORE_SERIES == 2
+    uint8_t res     = getAnalogReadResolution();
+    uint8_t command = (res == 8 ? ADC_MODE_SINGLE_8BIT_gc : ADC_MODE_SINGLE_12BIT_gc);
+    _stream_shift   = (res == 10 ? 2 : 0);
+    ADC0.MUXPOS     = pin; // VIA bits = 0, not through the PGA.
+    ADC0.INTFLAGS   = ADC_RESRDY_bm;
+    ADC0.INTCTRL   |= ADC_RESRDY_bm;
+  #else
+    ADC0.MUXPOS     = pin;
+    ADC0.CTRLB      = 0;   // no accumulation - analogReadEnh() may have left it on.
+    ADC0.INTFLAGS   = ADC_RESRDY_bm;
+    ADC0.INTCTRL   |= ADC_RESRDY_bm;
+  #endif
+  _stream_paced       = (rate != 0);
+  if (rate) {
+    #if MEGATINYCORE_SERIES == 2
+      ADC0.CTRLF      = 0;  // SAMPNUM = 0, not free-running.
+      ADC0.COMMAND    = command | ADC_START_EVENT_TRIGGER_gc;
+    #else
+      ADC0.EVCTRL     = ADC_STARTEI_bm;
+    #endif
+    return true;
+  }
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.CTRLF     = ADC_FREERUN_bm;
+    ADC0.COMMAND   = command | ADC_START_IMMEDIATE_gc;
+  #else
+    ADC0.CTRLA    |= ADC_FREERUN_bm;
+    ADC0.COMMAND   = ADC_STCONV_bm;
+  #endif
+  return true;
+}
+
+void analogStreamStop() {
+  if (_stream_paced) {
+    _analogTriggerEnd();
+    _stream_paced = 0;
+  }
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.CTRLF    &= ~ADC_FREERUN_bm;
+    ADC0.COMMAND   = ADC_START_STOP_gc;
+  #else
+    ADC0.CTRLA    &= ~ADC_FREERUN_bm;
+    ADC0.EVCTRL    = 0;
+    while (ADC0.COMMAND & ADC_STCONV_bm); // let the last conversion finish, so analogRead() doesn't start on top of it.
+  #endif
+  ADC0.INTCTRL    &= ~ADC_RESRDY_bm;
+  ADC0.INTFLAGS    = ADC_RESRDY_bm;
+}
+
+int16_t *analogStreamRead() {
+  uint8_t oldSREG = SREG;
+  cli();
+  int16_t *ready  = _stream_ready;
+  _stream_ready   = NULL;
+  SREG = oldSREG;
+  return ready;
+}
+
+uint16_t analogStreamOverruns() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t overruns = _stream_overruns;
+  SREG = oldSREG;
+  return overruns;
+}
@@ -0,0 +1,129 @@
+/* wiring_analog_trigger.c - a TCB, or a PWM timer's event, to start ADC conversions through the event system
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Used by analogStreamBegin() and analogScanBegin(). The TCB runs in periodic interrupt mode (without the interrupt)
+ * and its CAPT event is connected to the ADC's start input; the caller sets up the ADC side - ADC0.EVCTRL on the
+ * 0/1-series, an event triggered COMMAND on the 2-series. The event goes through event channel 5 on the 2-series,
+ * and through SYNCCH0 (the only synchronous channel on parts with less than 8k of flash) on the 0/1-series, so the
+ * Event library must not be given that channel while this is in use.
+ *
+ * _analogTriggerFrom() connects a TCA0 or TCD0 event to the same input instead, for analogScanTrigger(), so the ADC
+ * starts converting at a fixed point in the PWM cycle. The TCA0 ones use the same channel. TCD0's events can only go
+ * through an asynchronous channel on the 1-series, so those take ASYNCCH3.
+ */
+
+#include "wiring_private.h"
+
+#if !defined(ADC_TRIGGER_TCB) // pick a TCB that millis isn't using; TCB1 if we have one, since tone() uses TCB0.
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define ADC_TRIGGER_TCB 1
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define ADC_TRIGGER_TCB 0
+  #endif
+#endif
+
+#if MEGATINYCORE_SERIES == 2
+  #define _TRIGGER_EVENT_CHANNEL EVSYS_CHANNEL5
+  #define _TRIGGER_EVENT_USER    EVSYS_USER_CHANNEL5_gc
+#else
+  #define _TRIGGER_EVENT_CHANNEL EVSYS_SYNCCH0
+  #define _TRIGGER_EVENT_USER    EVSYS_ASYNCUSER1_SYNCCH0_gc
+#endif
+
+static uint8_t _trigger_source;     // 0 = none, 1 = the TCB, otherwise the ADC_TRIGGER_ constant
+
+#if defined(ADC_TRIGGER_TCB)
+  #if ADC_TRIGGER_TCB == 1
+    #define _TRIGGER_TCB TCB1
+  #else
+    #define _TRIGGER_TCB TCB0
+  #endif
+  #if MEGATINYCORE_SERIES == 2
+    #if ADC_TRIGGER_TCB == 1
+      #define _TRIGGER_EVENT_GEN   EVSYS_CHANNEL5_TCB1_CAPT_gc
+    #else
+      #define _TRIGGER_EVENT_GEN   EVSYS_CHANNEL5_TCB0_CAPT_gc
+    #endif
+  #else
+    #if ADC_TRIGGER_TCB == 1
+      #define _TRIGGER_EVENT_GEN   EVSYS_SYNCCH0_TCB1_gc
+    #else
+      #define _TRIGGER_EVENT_GEN   EVSYS_SYNCCH0_TCB0_gc
+    #endif
+  #endif
+
+  bool _analogTriggerBegin(uint32_t rate) {
+    uint8_t  clksel = TCB_CLKSEL_DIV1_gc;
+    uint32_t ticks  = F_CPU / rate;
+    if (ticks > 0x10000) {
+      ticks >>= 1;
+      clksel = TCB_CLKSEL_DIV2_gc;
+    }
+    if (ticks > 0x10000 || ticks < 2) {
+      return false;   // too slow for the timer (under F_CPU/131072), or faster than it can count.
+    }
+    _TRIGGER_TCB.CTRLA      = 0;
+    _TRIGGER_TCB.CTRLB      = TCB_CNTMODE_INT_gc;
+    _TRIGGER_TCB.INTCTRL    = 0;
+    _TRIGGER_TCB.CCMP       = ticks - 1;
+    _TRIGGER_TCB.CNT        = 0;
+    _TRIGGER_EVENT_CHANNEL  = _TRIGGER_EVENT_GEN;
+    EVSYS_USERADC0START     = _TRIGGER_EVENT_USER;
+    _TRIGGER_TCB.CTRLA      = clksel | TCB_ENABLE_bm;
+    _trigger_source         = 1;
+    return true;
+  }
+#else
+  bool _analogTriggerBegin(__attribute__((unused)) uint32_t rate) {
+    return false;     // millis is using the only TCB - nothing to pace it with.
+  }
+#endif
+
+bool _analogTriggerFrom(uint8_t source) {
+  #if defined(TCD0)
+    if (source >= ADC_TRIGGER_TCD0_CMPBCLR && source <= ADC_TRIGGER_TCD0_PROGEV) {
+      #if defined(MILLIS_USE_TIMERD0)
+        return false;   // millis has it, and its events are of no use for this
+      #else
+        EVSYS_ASYNCCH3      = source - ADC_TRIGGER_TCD0_CMPBCLR + EVSYS_ASYNCCH3_TCD0_CMPBCLR_gc;
+        EVSYS_USERADC0START = EVSYS_ASYNCUSER1_ASYNCCH3_gc;
+        _trigger_source     = source;
+        return true;
+      #endif
+    }
+  #endif
+  if (source < ADC_TRIGGER_TCA0_OVF || source > ADC_TRIGGER_TCA0_CMP2 || source == 0x82 || source == 0x83) {
+    return false;
+  }
+  #if defined(MILLIS_USE_TIMERA0)
+    return false;
+  #else
+    #if MEGATINYCORE_SERIES == 2
+      _TRIGGER_EVENT_CHANNEL  = source;     // the ADC_TRIGGER_ constants are the 2-series generator numbers
+    #else
+      _TRIGGER_EVENT_CHANNEL  = source - (source < ADC_TRIGGER_TCA0_CMP0 ? 0x7E : 0x80); // OVF = 2 ... CMP2 = 6 here
+    #endif
+    EVSYS_USERADC0START       = _TRIGGER_EVENT_USER;
+    _trigger_source           = source;
+    return true;
+  #endif
+}
+
+void _analogTriggerEnd() {
+  EVSYS_USERADC0START       = 0;
+  #if defined(TCD0)
+    if (_trigger_source >= ADC_TRIGGER_TCD0_CMPBCLR) {
+      EVSYS_ASYNCCH3        = 0;
+      _trigger_source       = 0;
+      return;
+    }
+  #endif
+  #if defined(_TRIGGER_TCB)
+    if (_trigger_source == 1) {
+      _TRIGGER_TCB.CTRLA    = 0;
+    }
+  #endif
+  _TRIGGER_EVENT_CHANNEL    = 0;
+  _trigger_source           = 0;
+}
@@ -0,0 +1,131 @@
+/* wiring_analog_watch.c - watching an analog pin with the ADC window comparator
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * analogWatch() leaves the ADC converting one pin - free-running, or started by an event that the sketch connects to
+ * the ADC's start input (like the RTC PIT, with the Event library) - and has the window comparator check each result
+ * against the thresholds. The CPU isn't involved until a result matches: then the WCMP interrupt stops the ADC and
+ * calls the callback with that result, once; call analogWatch() again to watch for the next crossing. With WATCH_WAKE,
+ * the ADC keeps running in standby sleep mode, and the interrupt wakes the part.
+ *
+ * This file, and the interrupt it defines, are only linked in if analogWatch() is used. On the 0/1-series, that's
+ * ADC0_WCOMP; on the 2-series, the window comparator shares the ADC0_SAMPRDY vector, so neither clashes with
+ * analogStreamBegin() or analogScanBegin() - though they can't use the ADC at the same time.
+ */
+
+#include "wiring_private.h"
+
+#if MEGATINYCORE_SERIES == 2
+  #define _WATCH_VECT       ADC0_SAMPRDY_vect
+  #define _WATCH_RUNSTBY_bm ADC_RUNSTDBY_bm
+#else
+  #define _WATCH_VECT       ADC0_WCOMP_vect
+  #define _WATCH_RUNSTBY_bm ADC_RUNSTBY_bm
+#endif
+
+static analogWatchCallback_t _watch_callback;
+#if MEGATINYCORE_SERIES == 2
+  static uint8_t             _watch_shift;  // 2 in 10-bit compatibility mode, the 2-series ADC is 12 bits.
+#endif
+
+static void _watch_end() {
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.COMMAND   = ADC_START_STOP_gc;
+    ADC0.CTRLF    &= ~ADC_FREERUN_bm;
+    ADC0.CTRLD    &= ~ADC_WINCM_gm;
+  #else
+    ADC0.CTRLA    &= ~ADC_FREERUN_bm;
+    ADC0.EVCTRL    = 0;
+    ADC0.CTRLE     = 0;
+  #endif
+  ADC0.CTRLA      &= ~_WATCH_RUNSTBY_bm;
+  ADC0.INTCTRL    &= ~ADC_WCMP_bm;
+  ADC0.INTFLAGS    = ADC_WCMP_bm | ADC_RESRDY_bm;
+}
+
+ISR(_WATCH_VECT) {
+  #if MEGATINYCORE_SERIES == 2
+    int16_t reading = ((int16_t) ADC0.RESULT) >> _watch_shift;
+  #else
+    int16_t reading = ADC0.RES;
+  #endif
+  _watch_end();
+  analogWatchCallback_t callback = _watch_callback;
+  _watch_callback = NULL;
+  if (callback) {
+    callback(reading);
+  }
+}
+
+bool analogWatch(uint8_t pin, int16_t low, int16_t high, uint8_t mode, analogWatchCallback_t callback) {
+  _lazyInitADC0();
+  uint8_t wincm = mode & 0x07;
+  if (!(ADC0.CTRLA & ADC_ENABLE_bm) || !callback || wincm < WATCH_BELOW || wincm > WATCH_OUTSIDE) {
+    return false;
+  }
+  if (pin < 0x80) {
+    // If high bit set, it's a channel, otherwise it's a digital pin so we look it up..
+    pin = digitalPinToAnalogInput(pin);
+  }
+  #if MEGATINYCORE_SERIES == 2
+    pin &= 0x3F;
+    if (pin > NUM_ANALOG_INPUTS && ((pin < 0x30) || (pin > 0x33))) {
+      return false;
+    }
+    if (ADC0.COMMAND & ADC_START_gm) {
+      return false;
+    }
+    uint8_t res     = getAnalogReadResolution();
+    uint8_t command = (res == 8 ? ADC_MODE_SINGLE_8BIT_gc : ADC_MODE_SINGLE_12BIT_gc);
+    _watch_shift    = (res == 10 ? 2 : 0);
+    low           <<= _watch_shift;  // the thresholds are compared with the 12-bit result.
+    high          <<= _watch_shift;
+  #else
+    pin &= 0x7F;
+    if (pin > 0x1F) { // highest valid mux value for any 0 or 1-series part.
+      return false;
+    }
+    if (ADC0.COMMAND & ADC_STCONV_bm) {
+      return false;
+    }
+  #endif
+  _watch_callback   = callback;
+  ADC0.MUXPOS       = pin;
+  ADC0.WINLT        = low;
+  ADC0.WINHT        = high;
+  ADC0.INTFLAGS     = ADC_WCMP_bm | ADC_RESRDY_bm;
+  ADC0.INTCTRL     |= ADC_WCMP_bm;
+  if (mode & WATCH_WAKE) {
+    ADC0.CTRLA     |= _WATCH_RUNSTBY_bm;
+  }
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.CTRLD      = (ADC0.CTRLD & ~(ADC_WINCM_gm | ADC_WINSRC_bm)) | wincm;
+    if (mode & WATCH_EVENT) {
+      ADC0.CTRLF    = 0;
+      ADC0.COMMAND  = command | ADC_START_EVENT_TRIGGER_gc;
+    } else {
+      ADC0.CTRLF    = ADC_FREERUN_bm;
+      ADC0.COMMAND  = command | ADC_START_IMMEDIATE_gc;
+    }
+  #else
+    ADC0.CTRLB      = 0;  // no accumulation - analogReadEnh() may have left it on.
+    ADC0.CTRLE      = wincm;
+    if (mode & WATCH_EVENT) {
+      ADC0.EVCTRL   = ADC_STARTEI_bm;
+    } else {
+      ADC0.CTRLA   |= ADC_FREERUN_bm;
+      ADC0.COMMAND  = ADC_STCONV_bm;
+    }
+  #endif
+  return true;
+}
+
+void analogWatchStop() {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_watch_callback) {
+    _watch_callback = NULL;
+    _watch_end();
+  }
+  SREG = oldSREG;
+}
@@ -0,0 +1,166 @@
+/* wiring_cpufreq.c - changing the CPU clock prescaler at runtime, and re-timing what depends on it
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Everything in the core is worked out for F_CPU at compile time. setCPUFrequency() lets the sketch drop the clock to
+ * F_CPU/2, /4 ... /64 while there's nothing much to do, and go back up to F_CPU for a burst of work, by changing only
+ * the main clock prescaler - the oscillator keeps running, so the switch takes effect at once. For that to not break
+ * everything, the clock of whatever is timed from CLK_PER is divided by the same power of two less:
+ *  - the millis timer runs at the same tick rate: TCA0's prescaler is lowered (so PWM on TCA0 keeps its frequency),
+ *    or a TCB's period is shortened. TCD0 runs from the oscillator and the RTC from the 32 kHz one, so they don't care.
+ *  - the USART BAUD registers are divided by the same amount, so the baud rate stays the same.
+ *  - the ADC prescaler is lowered to keep the ADC clock about where it was.
+ * If one of those can't follow (TCA0 has no /32 prescaler, a baud rate needs a BAUD value under 64 at the lower
+ * clock), nothing is changed, and it returns 0.
+ *
+ * Only powers of two, and never faster than F_CPU - the constants in micros() assume at most F_CPU ticks per second.
+ */
+
+#include "wiring_private.h"
+
+static uint8_t  _cpu_shift;               // log2(F_CPU / the current clock)
+static uint8_t  _cpu_pdiv;                // MCLKCTRLB at F_CPU
+static uint8_t  _cpu_adc_presc;           // the ADC prescaler at F_CPU
+#if defined(ADC1)
+  static uint8_t _cpu_adc1_presc;
+#endif
+static uint16_t _cpu_baud[2];             // the USART BAUD registers at F_CPU, 0 if it was off
+#if defined(MILLIS_USE_TIMERA0)
+  static uint8_t _cpu_tca_clksel;         // TCA0's CLKSEL at F_CPU
+#endif
+
+/* The main clock division each MCLKCTRLB PDIV value gives, 0 for reserved ones. */
+static const uint8_t _cpu_pdivs[16] = {2, 4, 8, 16, 32, 64, 0, 0, 6, 10, 12, 24, 48, 0, 0, 0};
+
+#if MEGATINYCORE_SERIES == 2
+  #define _CPU_ADC_PRESC      ADC0.CTRLB
+  #define _CPU_ADC_PRESC_gm   ADC_PRESC_gm
+  static const uint8_t  _cpu_adc_divs[16] = {2, 4, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 40, 48, 56, 64};
+#else
+  #define _CPU_ADC_PRESC      ADC0.CTRLC
+  #define _CPU_ADC_PRESC_gm   ADC_PRESC_gm
+  static const uint16_t _cpu_adc_divs[8]  = {2, 4, 8, 16, 32, 64, 128, 256};
+#endif
+
+/* The lowest ADC prescaler that doesn't make the ADC clock faster than it was at F_CPU. */
+static uint8_t _cpu_adc_rescale(uint8_t presc, uint8_t shift) {
+  uint16_t target = _cpu_adc_divs[presc] >> shift;
+  presc = sizeof(_cpu_adc_divs) / sizeof(_cpu_adc_divs[0]) - 1;
+  while (presc && _cpu_adc_divs[presc - 1] >= target) {
+    presc--;
+  }
+  return presc;
+}
+
+uint32_t getCPUFrequency() {
+  return F_CPU >> _cpu_shift;
+}
+
+uint32_t setCPUFrequency(uint32_t hz) {
+  uint8_t shift = 0;
+  while (shift < 7 && (F_CPU >> shift) > hz) {
+    shift++;
+  }
+  if ((F_CPU >> shift) != hz || (F_CPU % hz)) {
+    return 0;                             // not F_CPU divided by a power of two.
+  }
+  if (shift == _cpu_shift) {
+    return hz;
+  }
+  _lazyInitADC0();                        // so the prescaler noted below is the one for F_CPU
+  uint8_t oldSREG = SREG;
+  cli();
+  if (!_cpu_shift) {                      // running at F_CPU; that's what everything is set for, so note it.
+    _cpu_pdiv       = CLKCTRL.MCLKCTRLB;
+    _cpu_adc_presc  = _CPU_ADC_PRESC & _CPU_ADC_PRESC_gm;
+    #if defined(ADC1)
+      _cpu_adc1_presc = ADC1.CTRLC & ADC_PRESC_gm;
+    #endif
+    _cpu_baud[0]    = (USART0.CTRLB & (USART_TXEN_bm | USART_RXEN_bm)) ? USART0.BAUD : 0;
+    #if defined(USART1)
+      _cpu_baud[1]  = (USART1.CTRLB & (USART_TXEN_bm | USART_RXEN_bm)) ? USART1.BAUD : 0;
+    #endif
+    #if defined(MILLIS_USE_TIMERA0)
+      _cpu_tca_clksel = (TCA0.SPLIT.CTRLA & TCA_SPLIT_CLKSEL_gm) >> TCA_SPLIT_CLKSEL_gp;
+    #endif
+  }
+  // Check that everything can follow before changing anything.
+  uint16_t div = (_cpu_pdiv & CLKCTRL_PEN_bm) ? _cpu_pdivs[(_cpu_pdiv & CLKCTRL_PDIV_gm) >> CLKCTRL_PDIV_gp] : 1;
+  div <<= shift;
+  uint8_t pdiv = 0xFF;
+  if (div == 1) {
+    pdiv = 0;
+  } else {
+    for (uint8_t i = 0; i < 16; i++) {
+      if (_cpu_pdivs[i] == div) {
+        pdiv = (i << CLKCTRL_PDIV_gp) | CLKCTRL_PEN_bm;
+        break;
+      }
+    }
+  }
+  uint8_t ok = (pdiv != 0xFF);
+  for (uint8_t i = 0; i < 2; i++) {
+    if (_cpu_baud[i] && (_cpu_baud[i] >> shift) < 64) {
+      ok = 0;                             // under 64, the USART can't run.
+    }
+  }
+  #if defined(MILLIS_USE_TIMERA0)
+    /* TCA0 CLKSEL 0-7 divide by 1, 2, 4, 8, 16, 64, 256, 1024 - so log2 is the CLKSEL, or 2 more than it above 4 */
+    uint8_t tca_log2 = _cpu_tca_clksel + (_cpu_tca_clksel > 4 ? ((_cpu_tca_clksel - 4) << 1) : 0);
+    uint8_t tca_new  = 0xFF;
+    if (tca_log2 >= shift) {
+      tca_log2 -= shift;
+      if (tca_log2 <= 4) {
+        tca_new = tca_log2;
+      } else if (!(tca_log2 & 1)) {
+        tca_new = 4 + ((tca_log2 - 4) >> 1);
+      }
+    }
+    if (tca_new == 0xFF) {
+      ok = 0;
+    }
+  #endif
+  if (!ok) {
+    SREG = oldSREG;
+    return 0;
+  }
+  _PROTECTED_WRITE(CLKCTRL.MCLKCTRLB, pdiv);
+  _cpu_shift = shift;
+  #if defined(MILLIS_USE_TIMERA0)
+    TCA0.SPLIT.CTRLA = (TCA0.SPLIT.CTRLA & ~TCA_SPLIT_CLKSEL_gm) | (tca_new << TCA_SPLIT_CLKSEL_gp);
+  #elif defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1)
+    #if defined(MILLIS_USE_TIMERB0)
+      TCB_t *tcb = &TCB0;
+    #else
+      TCB_t *tcb = &TCB1;
+    #endif
+    /* The timer still overflows once a ms - at CLK_PER/1, rather than /2, once the clock is lower, for resolution. */
+    uint32_t ticks = (uint32_t) TIME_TRACKING_TICKS_PER_OVF * TIME_TRACKING_TIMER_DIVIDER;
+    uint8_t  ctrla = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;
+    if (!shift) {
+      ticks        = TIME_TRACKING_TICKS_PER_OVF;
+      ctrla        = (TIME_TRACKING_TIMER_DIVIDER == 2 ? TCB_CLKSEL_DIV2_gc : TCB_CLKSEL_DIV1_gc) | TCB_ENABLE_bm;
+    } else {
+      ticks      >>= shift;
+    }
+    tcb->CTRLA     = ctrla;
+    tcb->CCMP      = ticks - 1;
+    if (tcb->CNT >= ticks) {
+      tcb->CNT     = 0;                   // otherwise it would count all the way around first.
+    }
+  #endif
+  _CPU_ADC_PRESC   = (_CPU_ADC_PRESC & ~_CPU_ADC_PRESC_gm) | _cpu_adc_rescale(_cpu_adc_presc, shift);
+  #if defined(ADC1)
+    ADC1.CTRLC     = (ADC1.CTRLC & ~ADC_PRESC_gm) | _cpu_adc_rescale(_cpu_adc1_presc, shift);
+  #endif
+  if (_cpu_baud[0]) {
+    USART0.BAUD    = _cpu_baud[0] >> shift;
+  }
+  #if defined(USART1)
+    if (_cpu_baud[1]) {
+      USART1.BAUD  = _cpu_baud[1] >> shift;
+    }
+  #endif
+  SREG = oldSREG;
+  return hz;
+}
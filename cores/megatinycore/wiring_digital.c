@@ -48,6 +48,19 @@ inline __attribute__((always_inline)) void check_valid_pin_mode(uint8_t mode) {
   }
 }
 
+#if defined(CORE_DIGITAL_DESCRIPTORS)
+uint8_t _digital_pin_desc[NUM_TOTAL_PINS];
+
+/* .init5 runs after .data and .bss are set up and before the constructors in .init6, so a constructor can use
+ * digitalWrite(). It's naked and never returns - execution just continues into the next init section. */
+void _initDigitalPinDesc() __attribute__((naked, used, section(".init5")));
+void _initDigitalPinDesc() {
+  for (uint8_t pin = 0; pin < NUM_TOTAL_PINS; pin++) {
+    _digital_pin_desc[pin] = (digital_pin_to_port[pin] << 5) | 0x10 | digital_pin_to_bit_position[pin];
+  }
+}
+#endif
+
 void pinConfigure(uint8_t pin, uint16_t pinconfig) {
   check_valid_digital_pin(pin);
   uint8_t bit_mask = digitalPinToBitMask(pin);
@@ -194,6 +207,14 @@ void turnOffPWM(uint8_t pin) {
           bit_mask = 1;  // on the xy2, WO0 is on PA7
         }
       #endif
+      #if !defined(MILLIS_USE_TIMERA0)
+        if (_pwm_tca_bits) {   // single mode - see analogWriteResolution(). Only WO0-2, enabled by CMP0EN-CMP2EN.
+          if (bit_mask <= 0x04) {
+            TCA0.SINGLE.CTRLB &= ~(bit_mask << 4);
+          }
+          break;
+        }
+      #endif
       if (bit_mask > 0x04) { // -> bit_pos > 2 -> output channel controlled by HCMP
         bit_mask <<= 1;      // mind the gap (between LCMP and HCMP)
       }
@@ -256,6 +277,14 @@ void turnOffPWM(uint8_t pin) {
 
 void digitalWrite(uint8_t pin, uint8_t val) {
   check_valid_digital_pin(pin);
+  #if defined(CORE_DIGITAL_DESCRIPTORS)
+  if (pin >= NUM_TOTAL_PINS) {
+    return;
+  }
+  uint8_t desc = _digital_pin_desc[pin];
+  uint8_t bit_mask = digital_pin_to_bit_mask[pin];
+  PORT_t *port = (PORT_t *)(0x0400 | (desc & 0xE0));
+  #else
   /* Get bit mask for pin */
   uint8_t bit_mask = digitalPinToBitMask(pin);
   if (bit_mask == NOT_A_PIN) {
@@ -264,6 +293,7 @@ void digitalWrite(uint8_t pin, uint8_t val) {
 
   /* Get port */
   PORT_t *port = digitalPinToPortStruct(pin);
+  #endif
 
 
   /*
@@ -299,11 +329,15 @@ void digitalWrite(uint8_t pin, uint8_t val) {
       Should we purposely implement this side effect?
     */
 
+    #if defined(CORE_DIGITAL_DESCRIPTORS)
+    volatile uint8_t *pin_ctrl_reg = (volatile uint8_t *)(0x0400 | (desc & ~DIGITAL_DESC_PWM));
+    #else
     /* Get bit position for getting pin ctrl reg */
     uint8_t bit_pos = digitalPinToBitPosition(pin);
 
     /* Calculate where pin control register is */
     volatile uint8_t *pin_ctrl_reg = getPINnCTRLregister(port, bit_pos);
+    #endif
 
     /* Save system status and disable interrupts */
     uint8_t status = SREG;
@@ -330,7 +364,14 @@ void digitalWrite(uint8_t pin, uint8_t val) {
    * would turn it off for the time between turnOffPWM() and
    * PORT->OUTCLR)
    * Since there's no penalty, why make a glitch we don't have to? */
+  #if defined(CORE_DIGITAL_DESCRIPTORS)
+  if (desc & DIGITAL_DESC_PWM) {
+    _digital_pin_desc[pin] = desc & ~DIGITAL_DESC_PWM;
+    turnOffPWM(pin);
+  }
+  #else
   turnOffPWM(pin);
+  #endif
 }
 
 inline __attribute__((always_inline)) void digitalWriteFast(uint8_t pin, uint8_t val) {
@@ -364,11 +405,18 @@ inline __attribute__((always_inline)) void digitalWriteFast(uint8_t pin, uint8_t
 
 int8_t digitalRead(uint8_t pin) {
   check_valid_digital_pin(pin);
+  #if defined(CORE_DIGITAL_DESCRIPTORS)
+  if (pin >= NUM_TOTAL_PINS) {
+    return -1;
+  }
+  uint8_t bit_mask = digital_pin_to_bit_mask[pin];
+  #else
   /* Get bit mask and check valid pin */
   uint8_t bit_mask = digitalPinToBitMask(pin);
   if (bit_mask == NOT_A_PIN) {
     return -1;
   }
+  #endif
   // Origionbally the Arduino core this was derived from turned off PWM on the pin
   // I cannot fathom why, insofar as the Arduino team sees Arduino as an educational
   // tool, and I can't think of a better way to learn about PWM...
@@ -378,8 +426,12 @@ int8_t digitalRead(uint8_t pin) {
   //
   // turnOffPWM(pin);
 
+  #if defined(CORE_DIGITAL_DESCRIPTORS)
+  PORT_t *port = (PORT_t *)(0x0400 | (_digital_pin_desc[pin] & 0xE0));
+  #else
   /* Get port and check valid port */
   PORT_t *port = digitalPinToPortStruct(pin);
+  #endif
 
   /* Read pin value from PORTx.IN register */
   if (port->IN & bit_mask) {
@@ -0,0 +1,220 @@
+/* wiring_osctune.c - measuring the internal oscillator against a 32.768 kHz crystal, and keeping it tuned at runtime
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * tune_internal() (wiring.c) applies the calibration the tuning sketch stored, or a guess, once, at startup; after that
+ * the oscillator drifts with temperature and supply voltage, by around a percent over the full range. oscMeasure()
+ * counts system clock cycles over 8 periods of one of the RTC PIT's event outputs, with the RTC running from the
+ * crystal on TOSC1/TOSC2: a TCB in frequency measurement mode gets the PIT event through the event system, and each
+ * capture is one period. oscTune() measures, then moves the calibration one step at a time for as long as that makes
+ * the error smaller, so it doesn't need to know how big a step is (that differs from chip to chip, and across the
+ * range). Even one step is usually far more than the error in the measurement.
+ *
+ * The event goes through ASYNCCH3 on the 0/1-series, and channel 3 on the 2-series, so the Event library must not be
+ * given that channel while this runs, and the TCB is the one analogStreamBegin() and analogScanBegin() use.
+ *
+ * oscErrorFromBaud() works out the same error from the BAUD register after a generic auto-baud sync (SERIAL_AUTOBAUD):
+ * the USART has measured the sender's bit time in system clocks. Auto-baud already corrects the baud rate itself, so
+ * that is only for knowing the error, for the other things that are timed from the clock.
+ */
+
+#include "wiring_private.h"
+
+int16_t oscErrorFromBaud(uint16_t baudreg, uint32_t baud) {
+  /* BAUD = 64 * f / (16 * baud) at the clock f the chip is really at, so f / F_CPU - 1 = BAUD * baud / (4 * F_CPU) - 1.
+   * The difference from F_CPU is then divided by F_CPU in MHz for ppm. */
+  if (!baudreg || !baud || baudreg > 0xFFFFFFFFUL / baud) {
+    return OSC_ERROR_NO_REFERENCE;  // a BAUD that far off isn't from this clock (4 * F_CPU fits easily)
+  }
+  int32_t diff = (int32_t)(((uint32_t)baudreg * baud) / 4 - F_CPU);
+  int32_t ppm  = diff / (int32_t)(F_CPU / 1000000UL);
+  return (ppm > OSC_ERROR_MAX) ? OSC_ERROR_MAX : ((ppm < -OSC_ERROR_MAX) ? -OSC_ERROR_MAX : ppm);
+}
+
+#if defined(CLKCTRL_XOSC32KS_bm) && !defined(__AVR_ATtinyxy2__) && (CLOCK_SOURCE == 0)
+
+#if !defined(OSC_TUNE_TCB) // pick a TCB that millis isn't using; TCB1 if we have one, since tone() uses TCB0.
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define OSC_TUNE_TCB 1
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define OSC_TUNE_TCB 0
+  #endif
+#endif
+
+#if defined(OSC_TUNE_TCB)
+  #if OSC_TUNE_TCB == 1
+    #define _TUNE_TCB           TCB1
+  #else
+    #define _TUNE_TCB           TCB0
+  #endif
+  /* The PIT output divides the 32.768 kHz clock by 64 to 512: the most that keeps a period, at up to 12% fast, within
+   * the 16-bit counter - above 28 MHz, at the system clock divided by 2. 8 periods of 2^_TUNE_PIT_LOG2 RTC clocks are
+   * then the counting frequency divided by 2^(12 - _TUNE_PIT_LOG2). */
+  #if F_CPU > 28000000UL
+    #define _TUNE_CLKSEL        TCB_CLKSEL_DIV2_gc
+    #define _TUNE_FREQ          (F_CPU / 2)
+  #else
+    #define _TUNE_CLKSEL        TCB_CLKSEL_DIV1_gc
+    #define _TUNE_FREQ          (F_CPU)
+  #endif
+  #if   _TUNE_FREQ <= 3500000UL
+    #define _TUNE_PIT_LOG2      9
+  #elif _TUNE_FREQ <= 7000000UL
+    #define _TUNE_PIT_LOG2      8
+  #elif _TUNE_FREQ <= 14000000UL
+    #define _TUNE_PIT_LOG2      7
+  #else
+    #define _TUNE_PIT_LOG2      6
+  #endif
+  #if MEGATINYCORE_SERIES == 2
+    #define _TUNE_EVENT_CHANNEL EVSYS_CHANNEL3
+    #define _TUNE_EVENT_GEN     (EVSYS_CHANNEL3_RTC_PIT_DIV64_gc - (_TUNE_PIT_LOG2 - 6))
+    #if OSC_TUNE_TCB == 1
+      #define _TUNE_EVENT_USER  EVSYS_USERTCB1CAPT
+    #else
+      #define _TUNE_EVENT_USER  EVSYS_USERTCB0CAPT
+    #endif
+    #define _TUNE_EVENT_USER_gc EVSYS_USER_CHANNEL3_gc
+  #else
+    #define _TUNE_EVENT_CHANNEL EVSYS_ASYNCCH3
+    #define _TUNE_EVENT_GEN     (EVSYS_ASYNCCH3_PIT_DIV64_gc - (_TUNE_PIT_LOG2 - 6))
+    #if OSC_TUNE_TCB == 1
+      #define _TUNE_EVENT_USER  EVSYS_ASYNCUSER11
+    #else
+      #define _TUNE_EVENT_USER  EVSYS_ASYNCUSER0
+    #endif
+    #define _TUNE_EVENT_USER_gc EVSYS_ASYNCUSER0_ASYNCCH3_gc
+  #endif
+  #define _TUNE_PERIOD          ((uint16_t)(_TUNE_FREQ >> (15 - _TUNE_PIT_LOG2)))
+
+  static int16_t _osc_error = OSC_ERROR_NO_REFERENCE;
+
+  int16_t oscError() {
+    return _osc_error;
+  }
+
+  /* Start the crystal if it isn't running. It takes a few hundred ms to start; until it has, oscMeasure() returns
+   * OSC_ERROR_STARTING. It is left running in standby too, so it doesn't have to start again every time. */
+  static bool _osc_crystal_ready() {
+    if (!(CLKCTRL.XOSC32KCTRLA & CLKCTRL_ENABLE_bm)) {
+      _PROTECTED_WRITE(CLKCTRL.XOSC32KCTRLA, CLKCTRL_RUNSTDBY_bm | CLKCTRL_ENABLE_bm);
+    }
+    return CLKCTRL.MCLKSTATUS & CLKCTRL_XOSC32KS_bm;
+  }
+
+  int16_t oscMeasure() {
+    if (getCPUFrequency() != F_CPU || (_TUNE_TCB.CTRLA & TCB_ENABLE_bm)) {
+      return OSC_ERROR_BUSY;
+    }
+    /* The PIT runs from whatever clocks the RTC. If that isn't the crystal, we can only switch it over if neither the
+     * RTC nor the PIT is in use. */
+    uint8_t pit = RTC.PITCTRLA;
+    if (RTC.CLKSEL != RTC_CLKSEL_TOSC32K_gc) {
+      if ((RTC.CTRLA & RTC_RTCEN_bm) || (pit & RTC_PITEN_bm)) {
+        return OSC_ERROR_BUSY;
+      }
+      RTC.CLKSEL = RTC_CLKSEL_TOSC32K_gc;
+    }
+    if (!_osc_crystal_ready()) {
+      return _osc_error = OSC_ERROR_STARTING;
+    }
+    if (!(pit & RTC_PITEN_bm)) {
+      while (RTC.PITSTATUS);
+      RTC.PITCTRLA = RTC_PERIOD_CYC8192_gc | RTC_PITEN_bm;  // the PIT interrupt stays off; only the events are used
+    }
+    _TUNE_TCB.CTRLB       = TCB_CNTMODE_FRQ_gc;
+    _TUNE_TCB.EVCTRL      = TCB_CAPTEI_bm;
+    _TUNE_TCB.INTCTRL     = 0;
+    _TUNE_TCB.CNT         = 0;
+    _TUNE_EVENT_CHANNEL   = _TUNE_EVENT_GEN;
+    _TUNE_EVENT_USER      = _TUNE_EVENT_USER_gc;
+    _TUNE_TCB.INTFLAGS    = TCB_CAPT_bm;
+    _TUNE_TCB.CTRLA       = _TUNE_CLKSEL | TCB_ENABLE_bm;
+    /* The first capture ends a period that started whenever the timer did, so it's thrown away. Any period more than
+     * an eighth off means the events aren't what we think (no crystal on the pins, or an interrupt made us miss one). */
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < 9; i++) {
+      uint16_t timeout = 0;
+      while (!(_TUNE_TCB.INTFLAGS & TCB_CAPT_bm)) {
+        if (!--timeout) {
+          sum = 0;
+          goto done;
+        }
+      }
+      uint16_t period = _TUNE_TCB.CCMP;   // clears CAPT
+      if (i) {
+        if (period < _TUNE_PERIOD - (_TUNE_PERIOD >> 3) || period > _TUNE_PERIOD + (_TUNE_PERIOD >> 3)) {
+          sum = 0;
+          break;
+        }
+        sum += period;
+      }
+    }
+    done:
+    _TUNE_TCB.CTRLA       = 0;
+    _TUNE_TCB.EVCTRL      = 0;
+    _TUNE_TCB.CTRLB       = 0;
+    _TUNE_EVENT_USER      = 0;
+    _TUNE_EVENT_CHANNEL   = 0;
+    if (!(pit & RTC_PITEN_bm)) {
+      while (RTC.PITSTATUS);
+      RTC.PITCTRLA = 0;
+    }
+    if (!sum) {
+      return _osc_error = OSC_ERROR_NO_REFERENCE;
+    }
+    int32_t ppm = ((int32_t)(sum << (12 - _TUNE_PIT_LOG2)) - (int32_t)_TUNE_FREQ) / (int32_t)(_TUNE_FREQ / 1000000UL);
+    return _osc_error = (ppm > OSC_ERROR_MAX) ? OSC_ERROR_MAX : ((ppm < -OSC_ERROR_MAX) ? -OSC_ERROR_MAX : ppm);
+  }
+
+  static void _osc_set_cal(uint8_t cal) {
+    _PROTECTED_WRITE(CLKCTRL.OSC20MCALIBA, (CLKCTRL.OSC20MCALIBA & ~CLKCTRL_CAL20M_gm) | cal);
+    _NOP();
+  }
+
+  int16_t oscTune() {
+    int16_t err = oscMeasure();
+    if (err < -OSC_ERROR_MAX || (CLKCTRL.OSC20MCALIBB & CLKCTRL_LOCK_bm)) {
+      return err;   // nothing to tune against - or the OSCLOCK fuse has locked the calibration
+    }
+    uint8_t cal = CLKCTRL.OSC20MCALIBA & CLKCTRL_CAL20M_gm;
+    for (uint8_t steps = 0; steps < 8 && err; steps++) {
+      uint8_t next = cal;
+      if (err > 0) {          // running fast: a lower calibration value is slower
+        if (!next) {
+          break;
+        }
+        next--;
+      } else {
+        if (next == CLKCTRL_CAL20M_gm) {
+          break;
+        }
+        next++;
+      }
+      _osc_set_cal(next);
+      int16_t newerr = oscMeasure();
+      if (newerr < -OSC_ERROR_MAX || abs(newerr) >= abs(err)) {
+        _osc_set_cal(cal);    // that step went past the best value (or the measurement failed); go back
+        _osc_error = err;
+        break;
+      }
+      cal = next;
+      err = newerr;
+    }
+    return err;
+  }
+#endif
+#endif
+
+#if !defined(_TUNE_TCB)
+  /* No crystal oscillator (0-series and 8-pin parts), not on the internal oscillator, or millis has the only TCB. */
+  int16_t oscError() {
+    return OSC_ERROR_NO_REFERENCE;
+  }
+  int16_t oscMeasure() {
+    return OSC_ERROR_NO_REFERENCE;
+  }
+  int16_t oscTune() {
+    return OSC_ERROR_NO_REFERENCE;
+  }
+#endif
@@ -0,0 +1,86 @@
+/* wiring_park.c - pinsSaveAndPark() and pinsRestore(): pins to a low-power state for sleep, and back
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Going through pinMode() or pinConfigure() for every pin costs a lookup per pin, each way, on every wake.
+ * Here it's a pass over the PORT registers instead: the masks of the pins each port has come from the variant
+ * (PORTx_PINS in pins_arduino.h), and the state of the pins being parked is kept in a few bytes per port.
+ */
+
+#include "wiring_private.h"
+
+#if defined(PORTC_PINS)
+  #define PARK_PORTS      (3)
+  static const uint8_t _park_present[PARK_PORTS] = {PORTA_PINS, PORTB_PINS, PORTC_PINS};
+#elif defined(PORTB_PINS)
+  #define PARK_PORTS      (2)
+  static const uint8_t _park_present[PARK_PORTS] = {PORTA_PINS, PORTB_PINS};
+#else
+  #define PARK_PORTS      (1)
+  static const uint8_t _park_present[PARK_PORTS] = {PORTA_PINS};
+#endif
+
+static struct {
+  uint8_t mask[PARK_PORTS];        // the pins parked, 0 for none - so pinsRestore() with nothing parked does nothing
+  uint8_t dir[PARK_PORTS];
+  uint8_t out[PARK_PORTS];
+  uint8_t ctrl[PARK_PORTS][8];
+} _park;
+
+void pinsSaveAndPark(uint32_t pins, uint16_t parkConfig) {
+  uint8_t  ctrl    = (uint8_t)parkConfig;
+  PORT_t  *port    = &PORTA;
+  uint8_t  oldSREG = SREG;
+  cli();
+  for (uint8_t p = 0; p < PARK_PORTS; p++, port++, pins >>= 8) {
+    uint8_t mask = (uint8_t)pins & _park_present[p];
+    if (!mask) {
+      continue;
+    }
+    volatile uint8_t *pinctrl = &port->PIN0CTRL;
+    if (!_park.mask[p]) {          // parking again before a restore keeps what was saved the first time.
+      _park.mask[p] = mask;
+      _park.dir[p]  = port->DIR;
+      _park.out[p]  = port->OUT;
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        _park.ctrl[p][bit] = pinctrl[bit];
+      }
+    }
+    if (parkConfig & 0x0100) {     // PARK_OUTPUT_LOW: low, then output, so it never drives high.
+      port->OUTCLR = mask;
+      port->DIRSET = mask;
+    } else {
+      port->DIRCLR = mask;
+    }
+    for (uint8_t bit = 0; bit < 8; bit++, mask >>= 1) {
+      if (mask & 1) {
+        pinctrl[bit] = ctrl;
+      }
+    }
+  }
+  SREG = oldSREG;
+}
+
+void pinsRestore() {
+  PORT_t  *port    = &PORTA;
+  uint8_t  oldSREG = SREG;
+  cli();
+  for (uint8_t p = 0; p < PARK_PORTS; p++, port++) {
+    uint8_t mask = _park.mask[p];
+    if (!mask) {
+      continue;
+    }
+    _park.mask[p] = 0;
+    volatile uint8_t *pinctrl = &port->PIN0CTRL;
+    for (uint8_t bit = 0, m = mask; bit < 8; bit++, m >>= 1) {
+      if (m & 1) {
+        pinctrl[bit] = _park.ctrl[p][bit];
+      }
+    }
+    /* OUT before DIR, so a pin going back to being an output goes straight to its old level. The pins that weren't
+     * parked are left as they are now, in case something changed them in the meantime. */
+    port->OUT = (port->OUT & ~mask) | (_park.out[p] & mask);
+    port->DIR = (port->DIR & ~mask) | (_park.dir[p] & mask);
+  }
+  SREG = oldSREG;
+}
@@ -36,11 +36,128 @@ extern "C" {
 #endif
 
 extern uint8_t PeripheralControl;
+#if !defined(MILLIS_USE_TIMERA0)
+  extern uint8_t _pwm_tca_bits; // non-zero if analogWriteResolution()/Frequency() made TCA0 a single 16-bit timer.
+#endif
+
+#if defined(CORE_DIGITAL_DESCRIPTORS)
+  /* One byte per pin, built before the constructors run (wiring_digital.c): the low byte of its PINnCTRL address,
+   * which is 0x20 * port | 0x10 | bit position, so the PORT struct is at 0x0400 | (desc & 0xE0). Bit 3 is always
+   * clear in that address; it's set when analogWrite() or pwmAttach() may have put PWM on the pin, and digitalWrite()
+   * only calls turnOffPWM() when it is. */
+  extern uint8_t _digital_pin_desc[];
+  #define DIGITAL_DESC_PWM          (0x08)
+  #define _setPWMActive(pin)        (_digital_pin_desc[(pin)] |= DIGITAL_DESC_PWM)
+#else
+  #define _setPWMActive(pin)
+#endif
+
+#if defined(CORE_LAZY_ADC_INIT) || defined(CORE_LAZY_PWM_INIT)
+  /* What init() left to be done on first use (wiring.c): INIT_PENDING_ADC0, and TIMERA0 and TIMERD0 - the same bits
+   * as in PeripheralControl. The functions that use the ADC or the PWM timers call these first. */
+  extern uint8_t _init_pending;
+  #define INIT_PENDING_ADC0         (0x01)
+  void _initPending(uint8_t what);
+#endif
+#if defined(CORE_LAZY_ADC_INIT)
+  #define _lazyInitADC0()           do {if (_init_pending & INIT_PENDING_ADC0) _initPending(INIT_PENDING_ADC0);} while (0)
+#else
+  #define _lazyInitADC0()
+#endif
+#if defined(CORE_LAZY_PWM_INIT)
+  #define _lazyInitPWM()            do {if (_init_pending & (TIMERA0 | TIMERD0)) _initPending(TIMERA0 | TIMERD0);} while (0)
+#else
+  #define _lazyInitPWM()
+#endif
 
 uint32_t countPulseASM(volatile uint8_t *port, uint8_t bit, uint8_t stateMask, unsigned long maxloops);
 
 typedef void (*voidFuncPtr)(void);
 
+/* A TCB starting ADC conversions through the event system, for analogStreamBegin() and analogScanBegin() - see
+ * wiring_analog_trigger.c. Returns false if the rate can't be done, or millis has the only TCB. */
+bool _analogTriggerBegin(uint32_t rate);
+/* Or a TCA0 or TCD0 event, one of the ADC_TRIGGER_ constants - false if millis has that timer. */
+bool _analogTriggerFrom(uint8_t source);
+
+/* ADC result filters for the stream and scan ISRs - see wiring_analog_filter.c. hist must have room for as many as
+ * _analogFilterLength() says (0xFF if filter isn't valid), and primed is cleared to start over. */
+typedef struct {
+  int32_t   acc;
+  int32_t  *hist;
+  uint8_t   type;     // the ADC_FILTER_ constant
+  uint8_t   index;    // where the next result goes in hist
+  uint8_t   primed;
+} _adc_filter_t;
+uint8_t _analogFilterLength(uint8_t filter);
+int32_t _analogFilter(_adc_filter_t *f, int32_t x);
+void _analogTriggerEnd();
+
+#if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+  /* The millis timer overflow ISR in wiring.c is weak; the timer service (TimerService.c) replaces it with one that
+   * also checks for due timers, but only if the sketch uses it. Both do the timekeeping with _millisTick(). */
+  #if defined(MILLIS_USE_TIMERA0)
+    #define MILLIS_TIMER_VECT TCA0_HUNF_vect
+  #elif defined(MILLIS_USE_TIMERD0)
+    #define MILLIS_TIMER_VECT TCD0_OVF_vect
+  #elif defined(MILLIS_USE_TIMERB0)
+    #define MILLIS_TIMER_VECT TCB0_INT_vect
+  #elif defined(MILLIS_USE_TIMERB1)
+    #define MILLIS_TIMER_VECT TCB1_INT_vect
+  #else
+    #error "No millis timer selected, but not disabled - cannot determine millis vector"
+  #endif
+  extern volatile uint32_t timer_millis;
+  #if !(defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1))
+    extern uint16_t timer_fract;
+    extern volatile uint32_t timer_overflow_count;
+    #if defined(MILLIS_USE_TIMERD0) && (F_CPU == 20000000UL || F_CPU == 10000000UL || F_CPU == 5000000UL)
+      #define MILLIS_TIMER_US_PER_OVF (TIME_TRACKING_CYCLES_PER_OVF / 20) // TCD0 runs from the unprescaled oscillator
+    #elif defined(MILLIS_USE_TIMERD0)
+      #define MILLIS_TIMER_US_PER_OVF (TIME_TRACKING_CYCLES_PER_OVF / 16)
+    #else
+      #define MILLIS_TIMER_US_PER_OVF (TIME_TRACKING_CYCLES_PER_OVF / (F_CPU / 1000000L))
+    #endif
+    #define FRACT_MAX  (1000)
+    #define FRACT_INC  (MILLIS_TIMER_US_PER_OVF % 1000)
+    #define MILLIS_INC (MILLIS_TIMER_US_PER_OVF / 1000)
+  #endif
+
+  static inline __attribute__((always_inline)) void _millisTick(void) {
+    #if (defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1))
+      #if (F_CPU > 1000000)
+        timer_millis++; // that's all we need to do!
+      #else
+        timer_millis += 2;
+      #endif
+      #if defined(MILLIS_USE_TIMERB0)
+        TCB0.INTFLAGS = TCB_CAPT_bm;
+      #else
+        TCB1.INTFLAGS = TCB_CAPT_bm;
+      #endif
+    #else // TCA0 or TCD0
+      // copy these to local variables so they can be stored in registers
+      // (volatile variables must be read from memory on every access)
+      uint32_t m = timer_millis;
+      uint16_t f = timer_fract;
+      m += MILLIS_INC;
+      f += FRACT_INC;
+      if (f >= FRACT_MAX) {
+        f -= FRACT_MAX;
+        m += 1;
+      }
+      timer_fract = f;
+      timer_millis = m;
+      timer_overflow_count++;
+      #if defined(MILLIS_USE_TIMERA0)
+        TCA0.SPLIT.INTFLAGS = TCA_SPLIT_HUNF_bm;
+      #else
+        TCD0.INTFLAGS = TCD_OVF_bm;
+      #endif
+    #endif
+  }
+#endif
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
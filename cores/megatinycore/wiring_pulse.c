@@ -95,3 +95,174 @@ unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout) {
   return micros() - start;
 }
 #endif
+
+#if !(defined(DISABLEMILLIS) || defined(MILLIS_USE_TIMERRTC)|| defined(MILLIS_USE_TIMERRT_XTAL) || defined(MILLIS_USE_TIMERNONE))
+/* Non-blocking pulseIn(). Instead of spinning on the pin, this attaches a CHANGE interrupt to it and takes micros() at
+   each edge, so the CPU is only busy while an edge is being handled. Both edges go through the same ISR, so its
+   latency mostly cancels out; what's left is the jitter from whatever else was running at the time.
+
+   The pin interrupt handler doesn't get told which pin it was called for, hence one small function per slot.
+   The timeout is checked on each edge and by pulseInAsyncResult() - if neither happen, nothing notices it expired.
+*/
+#if !defined(PULSEIN_ASYNC_SLOTS)
+  #define PULSEIN_ASYNC_SLOTS 4
+#endif
+#if PULSEIN_ASYNC_SLOTS > 4
+  #error "PULSEIN_ASYNC_SLOTS can't be more than 4"
+#endif
+
+#define PIA_FREE      (0)
+#define PIA_WAITING   (1)   // for the pulse to start (and any pulse already in progress to end)
+#define PIA_IN_PULSE  (2)
+#define PIA_DONE      (3)   // width is valid, waiting for pulseInAsyncResult()
+
+typedef struct {
+  pulseCallback_t   callback;
+  volatile uint8_t *in;
+  uint8_t           mask;
+  uint8_t           state;  // mask if measuring a HIGH pulse, else 0
+  uint8_t           pin;
+  volatile uint8_t  status;
+  unsigned long     begin;  // micros() when it was called
+  unsigned long     start;  // micros() at start of pulse
+  unsigned long     timeout;
+  unsigned long     width;
+} _pia_slot_t;
+
+static _pia_slot_t _pia_slots[PULSEIN_ASYNC_SLOTS];
+
+/* Call with interrupts off. */
+static void _pia_finish(uint8_t i, unsigned long width) {
+  _pia_slot_t *slot = &_pia_slots[i];
+  detachInterrupt(slot->pin);
+  pulseCallback_t callback = slot->callback;
+  if (callback) {
+    slot->status = PIA_FREE;  // before the callback, so it can start the next measurement with this slot.
+    callback(width);
+  } else {
+    slot->width  = width;
+    slot->status = PIA_DONE;
+  }
+}
+
+static void _pia_edge(uint8_t i) {
+  _pia_slot_t *slot = &_pia_slots[i];
+  unsigned long now = micros();
+  uint8_t level = *(slot->in) & slot->mask;
+  if (now - slot->begin > slot->timeout) {
+    _pia_finish(i, 0);
+  } else if (slot->status == PIA_WAITING) {
+    if (level == slot->state) {
+      slot->start  = now;
+      slot->status = PIA_IN_PULSE;
+    }
+  } else if (slot->status == PIA_IN_PULSE) {
+    if (level != slot->state) {
+      _pia_finish(i, now - slot->start);
+    }
+  }
+}
+
+static void _pia_edge0() {_pia_edge(0);}
+#if PULSEIN_ASYNC_SLOTS > 1
+  static void _pia_edge1() {_pia_edge(1);}
+#endif
+#if PULSEIN_ASYNC_SLOTS > 2
+  static void _pia_edge2() {_pia_edge(2);}
+#endif
+#if PULSEIN_ASYNC_SLOTS > 3
+  static void _pia_edge3() {_pia_edge(3);}
+#endif
+static const voidFuncPtr _pia_handlers[PULSEIN_ASYNC_SLOTS] = {
+  _pia_edge0,
+  #if PULSEIN_ASYNC_SLOTS > 1
+    _pia_edge1,
+  #endif
+  #if PULSEIN_ASYNC_SLOTS > 2
+    _pia_edge2,
+  #endif
+  #if PULSEIN_ASYNC_SLOTS > 3
+    _pia_edge3,
+  #endif
+};
+
+/* Start measuring a pulse on the pin; state is HIGH or LOW, the type of pulse to measure. If there is a callback,
+   it is called from the pin ISR with the width in microseconds (0 if it timed out), and the handle is freed. If not,
+   poll pulseInAsyncResult() until it returns something other than PULSE_PENDING. Returns -1 if the pin is invalid or
+   all the slots are in use. This uses attachInterrupt() on the pin, replacing anything you had attached to it.
+*/
+int8_t pulseInAsync(uint8_t pin, uint8_t state, pulseCallback_t callback, unsigned long timeout) {
+  uint8_t bit = digitalPinToBitMask(pin);
+  if (bit == NOT_A_PIN) {
+    return -1;
+  }
+  int8_t handle = -1;
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < PULSEIN_ASYNC_SLOTS; i++) {
+    _pia_slot_t *slot = &_pia_slots[i];
+    if (slot->status == PIA_FREE) {
+      slot->callback = callback;
+      slot->in       = portInputRegister(digitalPinToPort(pin));
+      slot->mask     = bit;
+      slot->state    = (state ? bit : 0);
+      slot->pin      = pin;
+      slot->timeout  = timeout;
+      slot->begin    = micros();
+      slot->status   = PIA_WAITING;
+      attachInterrupt(pin, _pia_handlers[i], CHANGE);
+      handle = i;
+      break;
+    }
+  }
+  SREG = oldSREG;
+  return handle;
+}
+
+long pulseInAsyncResult(int8_t handle) {
+  if ((uint8_t) handle >= PULSEIN_ASYNC_SLOTS) {
+    return 0;
+  }
+  _pia_slot_t *slot = &_pia_slots[handle];
+  long retval = PULSE_PENDING;
+  uint8_t oldSREG = SREG;
+  cli();
+  if (slot->status == PIA_DONE) {
+    retval       = slot->width;
+    slot->status = PIA_FREE;
+  } else if (slot->status == PIA_FREE) {
+    retval       = 0;  // a callback already got the result, or it was cancelled.
+  } else if (micros() - slot->begin > slot->timeout) {
+    _pia_finish(handle, 0);  // if there's a callback, this calls it, otherwise we give the result here.
+    slot->status = PIA_FREE;
+    retval       = 0;
+  }
+  SREG = oldSREG;
+  return retval;
+}
+
+void pulseInAsyncCancel(int8_t handle) {
+  if ((uint8_t) handle >= PULSEIN_ASYNC_SLOTS) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_pia_slots[handle].status != PIA_FREE) {
+    detachInterrupt(_pia_slots[handle].pin);
+    _pia_slots[handle].status = PIA_FREE;
+  }
+  SREG = oldSREG;
+}
+#else
+  int8_t pulseInAsync(__attribute__((unused)) uint8_t pin, __attribute__((unused)) uint8_t state, __attribute__((unused)) pulseCallback_t callback, __attribute__((unused)) unsigned long timeout) {
+    badCall("pulseInAsync() times pulses with micros(), which is not available with millis disabled or on the RTC");
+    return -1;
+  }
+  long pulseInAsyncResult(__attribute__((unused)) int8_t handle) {
+    badCall("pulseInAsyncResult() times pulses with micros(), which is not available with millis disabled or on the RTC");
+    return 0;
+  }
+  void pulseInAsyncCancel(__attribute__((unused)) int8_t handle) {
+    badCall("pulseInAsyncCancel() times pulses with micros(), which is not available with millis disabled or on the RTC");
+  }
+#endif
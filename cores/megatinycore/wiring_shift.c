@@ -70,7 +70,58 @@ uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
   return val;
 }
 
+#if defined(CORE_SHIFTOUT_HARDWARE)
+/* shiftOut() on the pins of SPI0 (MOSI and SCK) or USART0 (TX and XCK), with the peripheral not already in use, is
+ * sent by the peripheral at F_CPU/2 instead, in mode 0 like the bit-banged version. The peripheral is enabled only for
+ * the one byte, and its registers are put back afterwards. Opt-in because that's 100 times faster, and code that
+ * has worked for years with a slow shift register, or long wires, may have been relying on the slow version. */
+static bool _shiftOutHardware(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+  // Only the default pin mapping of either one - these are the pins that the SPI and Serial libraries default to.
+  #if defined(PORTMUX_SPIROUTEA)
+  if (!(PORTMUX.SPIROUTEA & 0x03)
+  #else
+  if (!(PORTMUX.CTRLB & PORTMUX_SPI0_bm)
+  #endif
+    && dataPin == PIN_SPI_MOSI && clockPin == PIN_SPI_SCK && !(SPI0.CTRLA & SPI_ENABLE_bm)) {
+    uint8_t ctrlb = SPI0.CTRLB;
+    SPI0.CTRLB = SPI_SSD_bm;                            // mode 0, and the SS pin can't switch us to slave mode
+    SPI0.CTRLA = (bitOrder == LSBFIRST ? SPI_DORD_bm : 0) | SPI_MASTER_bm | SPI_CLK2X_bm | SPI_PRESC_DIV4_gc | SPI_ENABLE_bm;
+    SPI0.DATA  = val;
+    while (!(SPI0.INTFLAGS & SPI_IF_bm));
+    (void) SPI0.DATA;                                   // clears IF
+    SPI0.CTRLA = 0;
+    SPI0.CTRLB = ctrlb;
+    return true;
+  }
+  #if defined(PORTMUX_USARTROUTEA)
+  if (!(PORTMUX.USARTROUTEA & 0x03)
+  #else
+  if (!(PORTMUX.CTRLB & 0x01)
+  #endif
+    && dataPin == PIN_HWSERIAL0_TX && clockPin == PIN_HWSERIAL0_XCK && !(USART0.CTRLB & (USART_TXEN_bm | USART_RXEN_bm))) {
+    uint16_t baud  = USART0.BAUD;
+    uint8_t  ctrlc = USART0.CTRLC;
+    USART0.BAUD    = 1 << 6;                            // in MSPI mode only BAUD[15:6] count: F_CPU / (2 * 1)
+    USART0.CTRLC   = USART_CMODE_MSPI_gc | (bitOrder == LSBFIRST ? USART_UDORD_bm : 0);
+    USART0.CTRLB   = USART_TXEN_bm;
+    USART0.STATUS  = USART_TXCIF_bm;
+    USART0.TXDATAL = val;
+    while (!(USART0.STATUS & USART_TXCIF_bm));
+    USART0.CTRLB   = 0;
+    USART0.CTRLC   = ctrlc;
+    USART0.BAUD    = baud;
+    return true;
+  }
+  return false;
+}
+#endif
+
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+  #if defined(CORE_SHIFTOUT_HARDWARE)
+  if (_shiftOutHardware(dataPin, clockPin, bitOrder, val)) {
+    return;
+  }
+  #endif
   for (uint8_t i = 0; i != 8; i++)  {
     if (bitOrder == LSBFIRST) {
       digitalWrite(dataPin, val & 0x01), val >>= 1;
@@ -82,3 +133,67 @@ void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
     digitalWrite(clockPin, LOW);
   }
 }
+
+/* With constant pins and bit order, each bit is a skip and an SBI or CBI for the data, and an SBI and a CBI for the
+ * clock - about 6 clocks a bit, and unrolled, so there's no loop either. */
+inline __attribute__((always_inline)) void _shiftOutBitFast(uint8_t dataPin, uint8_t clockPin, uint8_t bit) {
+  if (bit) {
+    digitalWriteFast(dataPin, HIGH);
+  } else {
+    digitalWriteFast(dataPin, LOW);
+  }
+  digitalWriteFast(clockPin, HIGH);
+  digitalWriteFast(clockPin, LOW);
+}
+
+inline __attribute__((always_inline)) void shiftOutFast(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val) {
+  check_constant_pin(dataPin);
+  check_constant_pin(clockPin);
+  if (!__builtin_constant_p(bitOrder)) {
+    badArg("bitOrder must be constant when used with shiftOutFast");
+  }
+  if (bitOrder == LSBFIRST) {
+    _shiftOutBitFast(dataPin, clockPin, val & 0x01);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x02);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x04);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x08);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x10);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x20);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x40);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x80);
+  } else {
+    _shiftOutBitFast(dataPin, clockPin, val & 0x80);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x40);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x20);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x10);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x08);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x04);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x02);
+    _shiftOutBitFast(dataPin, clockPin, val & 0x01);
+  }
+}
+
+inline __attribute__((always_inline)) uint8_t shiftInFast(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+  check_constant_pin(dataPin);
+  check_constant_pin(clockPin);
+  if (!__builtin_constant_p(bitOrder)) {
+    badArg("bitOrder must be constant when used with shiftInFast");
+  }
+  uint8_t val = 0;
+  for (uint8_t i = 0; i != 8; i++) {
+    digitalWriteFast(clockPin, HIGH);
+    if (bitOrder == LSBFIRST) {
+      val >>= 1;
+      if (digitalReadFast(dataPin)) {
+        val |= 0x80;
+      }
+    } else {
+      val <<= 1;
+      if (digitalReadFast(dataPin)) {
+        val |= 0x01;
+      }
+    }
+    digitalWriteFast(clockPin, LOW);
+  }
+  return val;
+}
@@ -0,0 +1,293 @@
+/* wiring_sleep.c - sleeping as deeply as what's running allows, and waking on the RTC, with millis kept
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * sleepModeAllowed() looks at the peripherals, and returns the deepest sleep mode that won't break anything that's
+ * running: IDLE while a byte is still being sent by the USART, the TWI host owns the bus, a client transaction is
+ * underway, the ADC is converting, or a timer is making PWM or generating interrupts; STANDBY if something has been
+ * set to run in standby (RUNSTDBY), since that's what it's for and power down would stop it; otherwise power down.
+ * sleepLimit() sets how deep it may ever go, for things it can't see (like Serial needing to receive).
+ *
+ * sleepFor() sleeps for a number of milliseconds, waking on an RTC compare match - the RTC counter keeps running in
+ * standby, so how long we were asleep is known exactly, even when some other interrupt woke us. Each time we wake,
+ * the interrupt is serviced, the mode is chosen again (the USART may have finished since), and we go back to sleep.
+ * With the RTC as millis timer, millis simply keeps counting. With any other, the millis timer stops in standby, so
+ * sleepFor() takes over the RTC while it runs, and afterwards moves millis forward to account for the time asleep.
+ * If uptime (uptime.h) has the RTC, it's left running as it is, and the sleep is timed from its count.
+ *
+ * Timed sleeps stop at standby, rather than power down with the PIT: the PIT counter can't be read, so when anything
+ * else woke us, we wouldn't know how long we'd slept, and on these parts the RTC in standby, running from the 32 kHz
+ * oscillator, uses no more current than the PIT in power down. sleepUntilInterrupt() does go to power down, if allowed;
+ * it's for when a pin interrupt, a TWI address match, or the sketch's own PIT interrupt is what should wake us.
+ *
+ * A USART that Serial.enableWakeOnRx() was called for keeps us in standby at most, and start-of-frame detection is
+ * turned on just for the sleep: the start bit starts the oscillator, the character is received, and its RXC
+ * interrupt wakes us.
+ */
+
+#include "wiring_private.h"
+
+static uint8_t          _sleep_limit = SLPCTRL_SMODE_PDOWN_gc;
+static volatile uint8_t _sleep_woken;
+uint8_t                 _usart_wake;      // bit n: USARTn wakes us from standby on a start bit - see enableWakeOnRx()
+
+uint8_t sleepModeAllowed() {
+  uint8_t mode = SLPCTRL_SMODE_PDOWN_gc;
+  // Anything that has been told to run in standby stops in power down.
+  if ((RTC.CTRLA & (RTC_RTCEN_bm | RTC_RUNSTDBY_bm)) == (RTC_RTCEN_bm | RTC_RUNSTDBY_bm)) {
+    mode = SLPCTRL_SMODE_STDBY_gc;
+  }
+  #if MEGATINYCORE_SERIES == 2
+    if ((ADC0.CTRLA & (ADC_ENABLE_bm | ADC_RUNSTDBY_bm)) == (ADC_ENABLE_bm | ADC_RUNSTDBY_bm)) {
+      mode = SLPCTRL_SMODE_STDBY_gc;
+    } else if (ADC0.STATUS & ADC_ADCBUSY_bm) {
+      return SLPCTRL_SMODE_IDLE_gc;
+    }
+  #else
+    if ((ADC0.CTRLA & (ADC_ENABLE_bm | ADC_RUNSTBY_bm)) == (ADC_ENABLE_bm | ADC_RUNSTBY_bm)) {
+      mode = SLPCTRL_SMODE_STDBY_gc;
+    } else if (ADC0.COMMAND & ADC_STCONV_bm) {
+      return SLPCTRL_SMODE_IDLE_gc;
+    }
+  #endif
+  if ((AC0.CTRLA & (AC_ENABLE_bm | AC_RUNSTDBY_bm)) == (AC_ENABLE_bm | AC_RUNSTDBY_bm)) {
+    mode = SLPCTRL_SMODE_STDBY_gc;
+  }
+  #if defined(AC1)
+    if ((AC1.CTRLA & (AC_ENABLE_bm | AC_RUNSTDBY_bm)) == (AC_ENABLE_bm | AC_RUNSTDBY_bm)) {
+      mode = SLPCTRL_SMODE_STDBY_gc;
+    }
+  #endif
+  #if defined(AC2)
+    if ((AC2.CTRLA & (AC_ENABLE_bm | AC_RUNSTDBY_bm)) == (AC_ENABLE_bm | AC_RUNSTDBY_bm)) {
+      mode = SLPCTRL_SMODE_STDBY_gc;
+    }
+  #endif
+  if ((CCL.CTRLA & (CCL_ENABLE_bm | CCL_RUNSTDBY_bm)) == (CCL_ENABLE_bm | CCL_RUNSTDBY_bm)) {
+    mode = SLPCTRL_SMODE_STDBY_gc;
+  }
+  #if defined(DAC0)
+    if (DAC0.CTRLA & DAC_ENABLE_bm) {
+      if (!(DAC0.CTRLA & DAC_RUNSTDBY_bm)) {
+        return SLPCTRL_SMODE_IDLE_gc;       // the output would go away.
+      }
+      mode = SLPCTRL_SMODE_STDBY_gc;
+    }
+  #endif
+  // The TCBs that aren't running in standby only matter if they're making an output or interrupts.
+  #if !defined(MILLIS_USE_TIMERB0)
+    if (TCB0.CTRLA & TCB_ENABLE_bm) {
+      if (TCB0.CTRLA & TCB_RUNSTDBY_bm) {
+        mode = SLPCTRL_SMODE_STDBY_gc;
+      } else if ((TCB0.CTRLB & TCB_CCMPEN_bm) || TCB0.INTCTRL) {
+        return SLPCTRL_SMODE_IDLE_gc;
+      }
+    }
+  #endif
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    if (TCB1.CTRLA & TCB_ENABLE_bm) {
+      if (TCB1.CTRLA & TCB_RUNSTDBY_bm) {
+        mode = SLPCTRL_SMODE_STDBY_gc;
+      } else if ((TCB1.CTRLB & TCB_CCMPEN_bm) || TCB1.INTCTRL) {
+        return SLPCTRL_SMODE_IDLE_gc;
+      }
+    }
+  #endif
+  // TCA0 and TCD0 always run (for analogWrite()), so only PWM that's actually on a pin, or interrupts, count.
+  if (TCA0.SPLIT.CTRLA & TCA_SPLIT_ENABLE_bm) {
+    if (TCA0.SPLIT.CTRLB & ((TCA0.SPLIT.CTRLD & TCA_SPLIT_SPLITM_bm) ? 0x77 : 0x70)) {
+      return SLPCTRL_SMODE_IDLE_gc;       // LCMPnEN/HCMPnEN in split mode, CMPnEN in single mode.
+    }
+    #if !defined(MILLIS_USE_TIMERA0)
+      if (TCA0.SPLIT.INTCTRL) {
+        return SLPCTRL_SMODE_IDLE_gc;
+      }
+    #endif
+  }
+  #if defined(TCD0)
+    if (TCD0.CTRLA & TCD_ENABLE_bm) {
+      if (TCD0.FAULTCTRL & (TCD_CMPAEN_bm | TCD_CMPBEN_bm | TCD_CMPCEN_bm | TCD_CMPDEN_bm)) {
+        return SLPCTRL_SMODE_IDLE_gc;
+      }
+      #if !defined(MILLIS_USE_TIMERD0)
+        if (TCD0.INTCTRL) {
+          return SLPCTRL_SMODE_IDLE_gc;
+        }
+      #endif
+    }
+  #endif
+  // Start-of-frame detection only works in standby, and only a receiver that's on can use it.
+  if ((_usart_wake & 1) && (USART0.CTRLB & USART_RXEN_bm)) {
+    mode = SLPCTRL_SMODE_STDBY_gc;
+  }
+  #if defined(USART1)
+    if ((_usart_wake & 2) && (USART1.CTRLB & USART_RXEN_bm)) {
+      mode = SLPCTRL_SMODE_STDBY_gc;
+    }
+  #endif
+  // A byte in the TX buffer (DREIE on), or one still being shifted out (TXCIF not set yet).
+  if ((USART0.CTRLB & USART_TXEN_bm) && ((USART0.CTRLA & USART_DREIE_bm) || !(USART0.STATUS & USART_TXCIF_bm))) {
+    return SLPCTRL_SMODE_IDLE_gc;
+  }
+  #if defined(USART1)
+    if ((USART1.CTRLB & USART_TXEN_bm) && ((USART1.CTRLA & USART_DREIE_bm) || !(USART1.STATUS & USART_TXCIF_bm))) {
+      return SLPCTRL_SMODE_IDLE_gc;
+    }
+  #endif
+  // The TWI host owns the bus, or a client transaction hasn't been handled yet. An address match wakes us anyway.
+  if ((TWI0.MCTRLA & TWI_ENABLE_bm) && (TWI0.MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_OWNER_gc) {
+    return SLPCTRL_SMODE_IDLE_gc;
+  }
+  if ((TWI0.SCTRLA & TWI_ENABLE_bm) && (TWI0.SSTATUS & (TWI_DIF_bm | TWI_APIF_bm | TWI_CLKHOLD_bm))) {
+    return SLPCTRL_SMODE_IDLE_gc;
+  }
+  return (mode > _sleep_limit) ? _sleep_limit : mode;
+}
+
+void sleepLimit(uint8_t mode) {
+  _sleep_limit = mode & SLPCTRL_SMODE_gm;
+}
+
+void sleepWake() {
+  _sleep_woken = 1;
+}
+
+/* SFDEN is only set while we're in standby: the erratum "Start-of-Frame Detection Can Unintentionally Be Enabled in
+ * Active Mode When RXCIF Is 0" corrupts characters received while awake with it on. */
+static void _sleep_sfd(uint8_t on) {
+  if (_usart_wake & 1) {
+    USART0.CTRLB = on ? (USART0.CTRLB | USART_SFDEN_bm) : (USART0.CTRLB & ~USART_SFDEN_bm);
+  }
+  #if defined(USART1)
+    if (_usart_wake & 2) {
+      USART1.CTRLB = on ? (USART1.CTRLB | USART_SFDEN_bm) : (USART1.CTRLB & ~USART_SFDEN_bm);
+    }
+  #endif
+}
+
+/* Sleep once, in the deepest mode allowed (at most maxmode), until any interrupt. Called with interrupts off. */
+static void _sleep_once(uint8_t maxmode) {
+  uint8_t mode = sleepModeAllowed();
+  if (mode > maxmode) {
+    mode = maxmode;
+  }
+  uint8_t sfd = _usart_wake && (mode == SLPCTRL_SMODE_STDBY_gc);
+  if (sfd) {
+    _sleep_sfd(1);
+  }
+  SLPCTRL.CTRLA = mode | SLPCTRL_SEN_bm;
+  __asm__ __volatile__ ("sei" "\n\t" "sleep" "\n\t" "cli"); // sei takes effect after the sleep, so an interrupt
+  SLPCTRL.CTRLA = 0;                                          // after the caller's last check still wakes us.
+  if (sfd) {
+    _sleep_sfd(0);
+  }
+}
+
+void sleepUntilInterrupt() {
+  uint8_t oldSREG = SREG;
+  if (!(oldSREG & CPU_I_bm)) {
+    return;                               // nothing could ever wake us.
+  }
+  cli();
+  #if defined(MILLIS_USE_TIMERRTC)
+    _sleep_once(SLPCTRL_SMODE_STDBY_gc);  // millis needs the RTC counter, which stops in power down.
+  #else
+    _sleep_once(SLPCTRL_SMODE_PDOWN_gc);  // the millis timer stops in standby or power down; millis doesn't move.
+  #endif
+  SREG = oldSREG;
+}
+
+#if !defined(MILLIS_USE_TIMERRTC)
+  /* wiring.c has the RTC ISR when the RTC is the millis timer, which does the same for the compare match, and
+   * uptime.c has one that counts overflows too, which replaces this when the sketch uses uptime. */
+  ISR(RTC_CNT_vect, __attribute__((weak))) {
+    RTC.INTCTRL  = 0;
+    RTC.INTFLAGS = RTC_OVF_bm | RTC_CMP_bm;
+  }
+#endif
+
+uint32_t sleepFor(uint32_t ms) {
+  uint8_t oldSREG = SREG;
+  if (!ms || !(oldSREG & CPU_I_bm)) {
+    return 0;
+  }
+  #if defined(MILLIS_USE_TIMERRTC)
+    const uint8_t shift = 0;
+  #else
+    /* If the RTC is already running in standby - uptime() has it - it's used as it is, at whatever rate it counts;
+     * each prescaler step below /32 is one more bit to shift by. Otherwise it's started here at 1024 per second. */
+    uint8_t ctrla = RTC.CTRLA;
+    bool    start = !(ctrla & RTC_RTCEN_bm);
+    uint8_t shift = 0;
+    if (!start) {
+      uint8_t prescaler = (ctrla & RTC_PRESCALER_gm) >> RTC_PRESCALER_gp;
+      if (!(ctrla & RTC_RUNSTDBY_bm) || prescaler > 5) {
+        return 0;                         // it would stop while we slept, or counts too slowly to time it.
+      }
+      shift = 5 - prescaler;
+    }
+  #endif
+  if (ms > (0xF0000000UL >> shift)) {
+    ms = 0xF0000000UL >> shift;           // so the tick count fits in 32 bits.
+  }
+  uint32_t ticks = ms + (ms >> 6) + (ms >> 7) + (ms >> 11) + 1; // ms * 1.024, plus 1 to round up, as delay() does.
+  ticks <<= shift;
+  _sleep_woken = 0;
+  cli();
+  #if !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERNONE)
+    uint32_t start_ms = millis();
+  #endif
+  #if !defined(MILLIS_USE_TIMERRTC)
+    uint8_t overflow = RTC.INTCTRL & RTC_OVF_bm;   // uptime's, left as it is.
+    if (start) {
+      while (RTC.STATUS);
+      RTC.CLKSEL   = RTC_CLKSEL_INT32K_gc;
+      RTC.PER      = 0xFFFF;
+      RTC.CNT      = 0;
+      RTC.CTRLA    = RTC_RUNSTDBY_bm | RTC_RTCEN_bm | RTC_PRESCALER_DIV32_gc; // 1024 ticks per second, like millis.
+      while (RTC.STATUS & RTC_CTRLABUSY_bm);
+    }
+  #endif
+  uint16_t last    = RTC.CNT;
+  uint32_t elapsed = 0;
+  while (1) {
+    uint16_t now = RTC.CNT;
+    elapsed     += (uint16_t)(now - last);  // each sleep is under 16 seconds, so this can't wrap twice.
+    last         = now;
+    if (elapsed >= ticks || _sleep_woken) {
+      break;
+    }
+    uint32_t left  = ticks - elapsed;
+    uint16_t chunk = (left > 0x4000) ? 0x4000 : (left < 2 ? 2 : (uint16_t) left); // CNT + 1 could be missed.
+    while (RTC.STATUS & RTC_CMPBUSY_bm);
+    RTC.CMP      = now + chunk;
+    RTC.INTFLAGS = RTC_CMP_bm;
+    #if defined(MILLIS_USE_TIMERRTC)
+      RTC.INTCTRL = RTC_OVF_bm | RTC_CMP_bm;
+    #else
+      RTC.INTCTRL = RTC_CMP_bm | overflow;
+    #endif
+    _sleep_once(SLPCTRL_SMODE_STDBY_gc);  // the RTC counter stops in power down.
+  }
+  #if defined(MILLIS_USE_TIMERRTC)
+    RTC.INTCTRL  = RTC_OVF_bm;
+  #else
+    RTC.INTCTRL  = overflow;
+    if (start && !(RTC.PITCTRLA & RTC_PITEN_bm)) { // see the errata - turning off the RTC can stop the PIT too.
+      while (RTC.STATUS & RTC_CTRLABUSY_bm);
+      RTC.CTRLA  = 0;
+    }
+  #endif
+  elapsed >>= shift;
+  uint32_t slept = elapsed - (elapsed >> 5) + (elapsed >> 7); // ticks * 0.9765625, as in millis().
+  #if !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERNONE)
+    /* While we were in idle, millis kept counting, and while in standby, it didn't. Either way, this much time has
+     * really gone by - unless an ISR called set_millis() meanwhile, and millis is already past it. */
+    uint32_t now_ms = millis();
+    if ((int32_t)(now_ms - (start_ms + slept)) < 0) {
+      set_millis(start_ms + slept);
+    }
+  #endif
+  SREG = oldSREG;
+  return slept;
+}
@@ -0,0 +1,142 @@
+/* wiring_tcd0_motor.c - complementary PWM with dead-time and a hardware fault input, on TCD0
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * motorPWMBegin() takes over TCD0 and runs it in dual slope mode, counting from 0 up to TOP (CMPBCLR) and back down.
+ * WOA is high while the count is below CMPASET, and WOB while it's above CMPBSET, so the two outputs are centered on
+ * opposite ends of the cycle, and as long as CMPBSET is CMPASET + the dead-time, they are never on at the same time:
+ * there are dead-time counts with both off on each edge. That's the half-bridge drive a motor or a synchronous buck
+ * converter wants. motorPWMWrite() writes both compare values and then issues SYNCEOC, so they take effect together
+ * at the end of the cycle - there's never a cycle with one updated and not the other.
+ *
+ * The fault input is TCD0's input A. Whatever event generator the sketch connects to the tcd0_in_a user with the
+ * Event library (typically an AC output, see the Comparator library) shuts off both outputs in the timer hardware,
+ * with no interrupt involved: with MOTOR_FAULT_CYCLE, only while the fault is active, with MOTOR_FAULT_LATCH, until
+ * motorPWMClearFault() is called. The event is asynchronous, so this takes a few tens of ns, not an ISR's worth.
+ *
+ * Only the 1-series has TCD0, and it can't be used while millis is using it.
+ */
+
+#include "wiring_private.h"
+
+#if defined(TCD0) && !defined(MILLIS_USE_TIMERD0)
+
+#if _AVR_PINCOUNT == 8
+  #define _MOTOR_PIN_WOA PIN_PA6
+  #define _MOTOR_PIN_WOB PIN_PA7
+#else
+  #define _MOTOR_PIN_WOA PIN_PA4
+  #define _MOTOR_PIN_WOB PIN_PA5
+#endif
+
+static uint16_t _motor_top;       // 0 when not running
+static uint16_t _motor_deadtime;  // in timer counts
+
+uint16_t motorPWMBegin(uint32_t frequency, uint16_t deadtime_ns, uint8_t fault) {
+  if (!frequency) {
+    return 0;
+  }
+  uint8_t  ctrla    = TCD_CLKSEL_SYSCLK_gc | TCD_CNTPRES_DIV1_gc;
+  uint8_t  prescale = 0;                         // log2 of the total prescaling
+  uint32_t ticks    = F_CPU / 2 / frequency;     // up to TOP and back down is one period.
+  if (ticks > 0x0FFF) {                          // the TCD0 counter is 12 bits.
+    ctrla    = TCD_CLKSEL_SYSCLK_gc | TCD_CNTPRES_DIV4_gc;
+    prescale = 2;
+  }
+  if ((ticks >> prescale) > 0x0FFF) {
+    ctrla    = TCD_CLKSEL_SYSCLK_gc | TCD_CNTPRES_DIV32_gc;
+    prescale = 5;
+  }
+  while ((ticks >> prescale) > 0x0FFF && prescale < 8) {
+    ctrla   += TCD_SYNCPRES0_bm;                 // the synchronizer prescaler gets us up to 256.
+    prescale++;
+  }
+  ticks >>= prescale;
+  uint32_t scale    = 1000UL << prescale;        // round the dead-time up, it's a minimum.
+  uint16_t deadtime = ((uint32_t) deadtime_ns * (F_CPU / 1000000UL) + scale - 1) / scale;
+  if (ticks > 0x0FFF || ticks < 4 || deadtime >= (ticks >> 1)) {
+    return 0;
+  }
+  takeOverTCD0();                                // stops it and turns off the outputs
+  while (!(TCD0.STATUS & TCD_ENRDY_bm));         // wait until the disable has gone through
+  _motor_top        = ticks;
+  _motor_deadtime   = deadtime;
+  TCD0.CTRLB        = TCD_WGMODE_DS_gc;
+  TCD0.CTRLC        = 0;
+  TCD0.CMPBCLR      = ticks;
+  TCD0.CMPASET      = 0;                         // start with both outputs off.
+  TCD0.CMPBSET      = ticks;
+  if (fault & 0x0F) {
+    TCD0.EVCTRLA    = TCD_CFG_ASYNC_gc | ((fault & MOTOR_FAULT_LOW) ? 0 : TCD_EDGE_bm) | TCD_ACTION_FAULT_gc | TCD_TRIGEI_bm;
+    TCD0.INPUTCTRLA = ((fault & 0x0F) == MOTOR_FAULT_LATCH) ? TCD_INPUTMODE_WAITSW_gc : TCD_INPUTMODE_LVLTRIGFREQ_gc;
+  } else {
+    TCD0.EVCTRLA    = 0;
+    TCD0.INPUTCTRLA = TCD_INPUTMODE_NONE_gc;
+  }
+  TCD0.INTFLAGS     = TCD_TRIGA_bm;
+  _PROTECTED_WRITE(TCD0.FAULTCTRL, TCD_CMPAEN_bm | TCD_CMPBEN_bm); // CMPA and CMPB are 0 - both are low in a fault.
+  pinMode(_MOTOR_PIN_WOA, OUTPUT);
+  pinMode(_MOTOR_PIN_WOB, OUTPUT);
+  TCD0.CTRLA        = ctrla | TCD_ENABLE_bm;
+  return ticks;
+}
+
+bool motorPWMWrite(uint16_t duty) {
+  uint16_t top = _motor_top;
+  if (!top) {
+    return false;
+  }
+  if (duty > top - _motor_deadtime) {
+    duty = top - _motor_deadtime;                // at the top, WOB is never on.
+  }
+  while (!(TCD0.STATUS & TCD_CMDRDY_bm));        // a sync from the last write may still be pending.
+  TCD0.CMPASET      = duty;
+  TCD0.CMPBSET      = duty + _motor_deadtime;
+  TCD0.CTRLE        = TCD_SYNCEOC_bm;            // both take effect at the end of this cycle.
+  return true;
+}
+
+bool motorPWMFaulted() {
+  return TCD0.INTFLAGS & TCD_TRIGA_bm;
+}
+
+void motorPWMClearFault() {
+  TCD0.INTFLAGS     = TCD_TRIGA_bm;
+  if (_motor_top && TCD0.INPUTCTRLA == TCD_INPUTMODE_WAITSW_gc) {
+    while (!(TCD0.STATUS & TCD_CMDRDY_bm));
+    TCD0.CTRLE      = TCD_RESTART_bm;            // the software action WAITSW is waiting on.
+  }
+}
+
+void motorPWMStop() {
+  if (_motor_top) {
+    _motor_top      = 0;
+    takeOverTCD0();                              // the pins are still outputs, and the PORT drives them low.
+  }
+}
+
+#else
+  #if defined(TCD0)
+    #define _MOTOR_BADCALL "motorPWMBegin() can't use TCD0 when it is used for millis"
+  #else
+    #define _MOTOR_BADCALL "motorPWMBegin() needs TCD0, which only the 1-series has"
+  #endif
+  uint16_t motorPWMBegin(__attribute__((unused)) uint32_t frequency, __attribute__((unused)) uint16_t deadtime_ns, __attribute__((unused)) uint8_t fault) {
+    badCall(_MOTOR_BADCALL);
+    return 0;
+  }
+  bool motorPWMWrite(__attribute__((unused)) uint16_t duty) {
+    badCall(_MOTOR_BADCALL);
+    return false;
+  }
+  bool motorPWMFaulted() {
+    badCall(_MOTOR_BADCALL);
+    return false;
+  }
+  void motorPWMClearFault() {
+    badCall(_MOTOR_BADCALL);
+  }
+  void motorPWMStop() {
+    badCall(_MOTOR_BADCALL);
+  }
+#endif
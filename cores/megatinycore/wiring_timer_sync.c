@@ -0,0 +1,105 @@
+/* wiring_timer_sync.c - stopping the PWM timers and starting them again together, for phase-aligned outputs
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * None of these parts have an event that can start TCA0, the TCBs and TCD0 together - only the 2-series TCA0 can be
+ * restarted by an event, and that clears its count, taking any phase offset with it. So syncTimersStart() does it
+ * with interrupts off and every value worked out beforehand, leaving nothing between the writes to the CTRLA
+ * registers but the stores and the tests of which timers to start. The TCBs go first: one clocked from TCA0 (CLKSEL
+ * TCA0) doesn't count until TCA0 does, so it starts exactly in step with it, whatever TCA0's prescaler. TCA0 is last.
+ * Anything on another clock starts the same number of clocks ahead every time, so the phase between them, once set,
+ * stays put.
+ */
+
+#include "wiring_private.h"
+
+#if defined(MILLIS_USE_TIMERA0)
+  #define _SYNC_MILLIS SYNC_TCA0
+#elif defined(MILLIS_USE_TIMERB0)
+  #define _SYNC_MILLIS SYNC_TCB0
+#elif defined(MILLIS_USE_TIMERB1)
+  #define _SYNC_MILLIS SYNC_TCB1
+#elif defined(MILLIS_USE_TIMERD0)
+  #define _SYNC_MILLIS SYNC_TCD0
+#else
+  #define _SYNC_MILLIS 0
+#endif
+
+#if !defined(TCB1)
+  #define _SYNC_NONE_B1 SYNC_TCB1
+#else
+  #define _SYNC_NONE_B1 0
+#endif
+#if !defined(TCD0)
+  #define _SYNC_NONE_D0 SYNC_TCD0
+#else
+  #define _SYNC_NONE_D0 0
+#endif
+
+/* Timers the part doesn't have, or millis is using, can't be stopped or started here. */
+#define _SYNC_INVALID (_SYNC_MILLIS | _SYNC_NONE_B1 | _SYNC_NONE_D0 | (uint8_t) ~(SYNC_TCA0 | SYNC_TCB0 | SYNC_TCB1 | SYNC_TCD0))
+
+bool syncTimersStop(uint8_t timers) {
+  if (timers & _SYNC_INVALID) {
+    return false;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  if (timers & SYNC_TCA0) {
+    TCA0.SPLIT.CTRLA &= ~TCA_SPLIT_ENABLE_bm;  // ENABLE is bit 0 in single mode too
+  }
+  if (timers & SYNC_TCB0) {
+    TCB0.CTRLA &= ~TCB_ENABLE_bm;
+  }
+  #if defined(TCB1)
+    if (timers & SYNC_TCB1) {
+      TCB1.CTRLA &= ~TCB_ENABLE_bm;
+    }
+  #endif
+  #if defined(TCD0)
+    if (timers & SYNC_TCD0) {
+      while (!(TCD0.STATUS & TCD_ENRDY_bm));  // a write to CTRLA before this is ignored
+      TCD0.CTRLA &= ~TCD_ENABLE_bm;
+    }
+  #endif
+  SREG = oldSREG;
+  return true;
+}
+
+bool syncTimersStart(uint8_t timers) {
+  if (timers & _SYNC_INVALID) {
+    return false;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t tca0 = TCA0.SPLIT.CTRLA | TCA_SPLIT_ENABLE_bm;
+  uint8_t tcb0 = TCB0.CTRLA       | TCB_ENABLE_bm;
+  #if defined(TCB1)
+    uint8_t tcb1 = TCB1.CTRLA     | TCB_ENABLE_bm;
+  #endif
+  #if defined(TCD0)
+    uint8_t tcd0 = TCD0.CTRLA     | TCD_ENABLE_bm;
+    if (timers & SYNC_TCD0) {
+      while (!(TCD0.STATUS & TCD_ENRDY_bm));  // TCD0 takes a few of its clocks to finish being disabled
+    }
+  #endif
+  // Only the branches on timers between the stores - the same ones for the same timers, every time.
+  if (timers & SYNC_TCB0) {
+    TCB0.CTRLA = tcb0;
+  }
+  #if defined(TCB1)
+    if (timers & SYNC_TCB1) {
+      TCB1.CTRLA = tcb1;
+    }
+  #endif
+  #if defined(TCD0)
+    if (timers & SYNC_TCD0) {
+      TCD0.CTRLA = tcd0;
+    }
+  #endif
+  if (timers & SYNC_TCA0) {
+    TCA0.SPLIT.CTRLA = tca0;
+  }
+  SREG = oldSREG;
+  return true;
+}
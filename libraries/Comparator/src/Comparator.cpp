@@ -98,10 +98,13 @@ AltOUT |  PIN_PC6* |  PIN_PC6* |  PIN_PC6* |   n/a    | PIN_PC6* | PIN_PC6* |
 // Array for storing ISR function pointers
 #if defined(AC2_AC_vect)
   static volatile voidFuncPtr intFuncAC[3];
+  static uint8_t              deferAC[3];     // DEFERRED, DEFERRED_LOW or 0 - from the mode
 #elif defined(AC1_AC_vect)
   static volatile voidFuncPtr intFuncAC[2];
+  static uint8_t              deferAC[2];
 #elif defined(AC0_AC_vect)
   static volatile voidFuncPtr intFuncAC[1];
+  static uint8_t              deferAC[1];
 #else
   #error "Unsupported part? This device does not have an analog comparator!"
 #endif
@@ -649,6 +652,8 @@ void AnalogComparator::stop(bool restorepins) {
 
 
 void AnalogComparator::attachInterrupt(void (*userFunc)(void), uint8_t mode) {
+  uint8_t deferred = mode & DEFERRED_LOW;
+  mode &= ~DEFERRED_LOW;
   #if !defined(DXCORE)
   AC_INTMODE_t intmode;
   switch (mode) {
@@ -686,6 +691,7 @@ void AnalogComparator::attachInterrupt(void (*userFunc)(void), uint8_t mode) {
   #endif
   // Store function pointer
   intFuncAC[comparator_number] = userFunc;
+  deferAC[comparator_number]   = deferred;
 
 
   // Set interrupt trigger and enable interrupt
@@ -700,12 +706,93 @@ void AnalogComparator::attachInterrupt(void (*userFunc)(void), uint8_t mode) {
 void AnalogComparator::detachInterrupt() {
   // Disable interrupt
   AC.INTCTRL = 0;
+  window_on = false;
+}
+
+void AnalogComparator::setDacref(uint8_t value) {
+  dacref = value;
+  #if defined(MEGATINYCORE) && !defined(VREF_AC0REFEN_bm)
+    /* 1-series: the DACREF of each AC is a DAC */
+    #if defined(DAC0)
+      if (comparator_number == 0) {
+        DAC0.DATA = value;
+      }
+    #endif
+    #if defined(AC1)
+      if (comparator_number == 1) {
+        DAC1.DATA = value;
+      }
+    #endif
+    #if defined(AC2)
+      if (comparator_number == 2) {
+        DAC2.DATA = value;
+      }
+    #endif
+  #else
+    AC.DACREF = value;
+  #endif
+}
+
+bool AnalogComparator::window(uint8_t low, uint8_t high) {
+  #if defined(MEGATINYCORE) && MEGATINYCORE_SERIES == 0
+    (void) low; (void) high;
+    return false;
+  #else
+    uint8_t oldSREG = SREG;
+    cli();
+    window_low  = low;
+    window_high = high;
+    window_on   = true;
+    _windowEdge();                      // and from now on, after every edge
+    attachInterrupt(intFuncAC[comparator_number], CHANGE | deferAC[comparator_number]);
+    SREG = oldSREG;
+    return true;
+  #endif
+}
+
+void AnalogComparator::_windowEdge() {
+  if (window_on) {
+    setDacref(read() ? window_low : window_high);
+  }
+}
+
+uint8_t AnalogComparator::measure(uint8_t settle) {
+  #if defined(MEGATINYCORE) && MEGATINYCORE_SERIES == 0
+    (void) settle;
+    return 0;
+  #else
+    uint8_t intctrl = AC.INTCTRL;
+    uint8_t saved   = dacref;
+    AC.INTCTRL      = 0;                // the output will go up and down as it searches
+    uint8_t result  = 0;
+    for (uint8_t bit = 0x80; bit; bit >>= 1) {
+      setDacref(result | bit);
+      delayMicroseconds(settle);
+      if (read()) {                     // still above it, so this bit is a 1
+        result |= bit;
+      }
+    }
+    setDacref(saved);
+    delayMicroseconds(settle);
+    AC.STATUS       = AC_CMP_bm;        // the edges it made aren't real ones
+    AC.INTCTRL      = intctrl;
+    if (window_on) {
+      uint8_t oldSREG = SREG;
+      cli();
+      _windowEdge();                    // the output may have settled on the other side - put the right threshold back
+      SREG = oldSREG;
+    }
+    return result;
+  #endif
 }
 
 #ifdef AC0_AC_vect
 ISR(AC0_AC_vect) {
+  Comparator0._windowEdge();
   // Run user function
-  intFuncAC[0]();
+  if (intFuncAC[0]) {
+    _deferOrCallVoid(intFuncAC[0], deferAC[0]);
+  }
 
   // Clear flag
   AC0.STATUS = AC_CMP_bm;
@@ -714,8 +801,11 @@ ISR(AC0_AC_vect) {
 
 #ifdef AC1_AC_vect
 ISR(AC1_AC_vect) {
+  Comparator1._windowEdge();
   // Run user function
-  intFuncAC[1]();
+  if (intFuncAC[1]) {
+    _deferOrCallVoid(intFuncAC[1], deferAC[1]);
+  }
 
   // Clear flag
   AC1.STATUS = AC_CMP_bm;
@@ -724,8 +814,11 @@ ISR(AC1_AC_vect) {
 
 #ifdef AC2_AC_vect
 ISR(AC2_AC_vect) {
+  Comparator2._windowEdge();
   // Run user function
-  intFuncAC[2]();
+  if (intFuncAC[2]) {
+    _deferOrCallVoid(intFuncAC[2], deferAC[2]);
+  }
 
   // Clear flag
   AC2.STATUS = AC_CMP_bm;
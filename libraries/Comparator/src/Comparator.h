@@ -2,6 +2,9 @@
 #define COMPARATOR_h
 
 #include <Arduino.h>
+#if defined(MEGATINYCORE)
+  #include "sfr_writes.h"
+#endif
 // *INDENT-OFF* - astyle wants me to indent the #if's in a way that makes it harder to read.
 /* First, let's figure out how many pins we support.... */
 #if !defined(MEGATINYCORE)
@@ -291,8 +294,19 @@ class AnalogComparator {
     void init();
     void start(bool state = true);
     void stop(bool restorepins = false);
-    void attachInterrupt(voidFuncPtr callback, uint8_t mode);
+    void attachInterrupt(voidFuncPtr callback, uint8_t mode);   // mode | DEFERRED to run it from deferDispatch()
     void detachInterrupt();
+    /* A Schmitt trigger with thresholds anywhere: with input_n = in_n::dacref, each edge of the output moves DACREF -
+     * to low once the input has risen above high, and back to high once it has fallen below low. This uses the AC
+     * interrupt on both edges; a callback that's attached is still called, and sees both. The output itself, and so
+     * anything timing it through the event system, is not delayed. Returns false on parts without a DACREF. */
+    bool window(uint8_t low, uint8_t high);
+    void _windowEdge();  // called from the ISR
+    /* With input_n = in_n::dacref and the comparator started: a successive-approximation measurement of input_p, one
+     * DACREF step at a time, highest bit first - 8 comparisons, with settle microseconds for each. The result is the
+     * highest DACREF level the input is above, 0 to 255, in 256ths of the reference. Interrupts from this comparator
+     * are held off while it runs, and DACREF is put back afterwards. Always 0 on parts without a DACREF. */
+    uint8_t measure(uint8_t settle = 2);
     bool read() {
       #if defined(AC_CMPSTATE_bm)
         return !!(AC.STATUS & AC_CMPSTATE_bm);
@@ -303,6 +317,63 @@ class AnalogComparator {
     AC_t& getPeripheral() {
       return AC;
     }
+    #if defined(MEGATINYCORE)
+      /* Compile-time setup - what init() and start() write for comparator 0, 1 or 2, as a table for SFR_STARTUP() (see
+       * sfr_writes.h), with no AnalogComparator object involved. Turning the pins' digital input buffers off isn't
+       * included; sfr_pin_analog() does that. With ref::disable, the reference isn't touched. */
+      template <uint8_t comparator, in_p::inputP_t input_p, in_n::inputN_t input_n,
+                hyst::hysteresis_t hysteresis = hyst::disable,
+                out::output_t output          = out::disable,
+                ref::reference_t reference    = ref::disable,
+                uint8_t dacref                = 0xFF,
+                bool enable                   = true>
+      static constexpr auto config() {
+        constexpr uint16_t ac = sfr::ac0 + comparator * 8;
+        constexpr sfr_table<2> ac_writes = {{
+          sfr::store(ac + offsetof(AC_t, MUXCTRLA), (input_p << 3) | input_n | (output & 0x80)),
+          sfr::store(ac + offsetof(AC_t, CTRLA), hysteresis | (output & 0x40) | (enable ? AC_ENABLE_bm : 0)),
+        }};
+        if constexpr (reference == ref::disable) {
+          return ac_writes;
+        } else if constexpr (comparator == 0) {
+          #if defined(VREF_AC0REFEN_bm)  // 2-series - AC0 has its own reference and DACREF
+            constexpr sfr_table<3> ref_writes = {{
+              sfr::store(sfr::vref + offsetof(VREF_t, CTRLA), reference),
+              sfr::modify(sfr::vref + offsetof(VREF_t, CTRLB), VREF_AC0REFEN_bm, 0xFF),
+              sfr::store(ac + offsetof(AC_t, DACREF), dacref),
+            }};
+          #elif defined(DAC0)            // 1-series - the reference is shared with ADC0, and DAC0 is the DACREF
+            constexpr sfr_table<4> ref_writes = {{
+              sfr::modify(sfr::vref + offsetof(VREF_t, CTRLA), 0x07, reference),
+              sfr::modify(sfr::vref + offsetof(VREF_t, CTRLB), VREF_DAC0REFEN_bm, 0xFF),
+              sfr::modify(sfr::dac0 + offsetof(DAC_t, CTRLA), DAC_ENABLE_bm, 0xFF),
+              sfr::store(sfr::dac0 + offsetof(DAC_t, DATA), dacref),
+            }};
+          #else                          // 0-series
+            constexpr sfr_table<2> ref_writes = {{
+              sfr::modify(sfr::vref + offsetof(VREF_t, CTRLA), 0x07, reference),
+              sfr::modify(sfr::vref + offsetof(VREF_t, CTRLB), VREF_DAC0REFEN_bm, 0xFF),
+            }};
+          #endif
+          return ref_writes + ac_writes;
+        } else {
+          #if defined(AC1)               // golden 1-series - AC1 and AC2 each have their own reference and DAC
+            constexpr uint16_t dac = sfr::dac0 + comparator * 8;
+            constexpr sfr_table<4> ref_writes = {{
+              comparator == 1 ? sfr::modify(sfr::vref + offsetof(VREF_t, CTRLC), 0x07, reference)
+                              : sfr::store(sfr::vref + offsetof(VREF_t, CTRLD), reference),
+              sfr::modify(sfr::vref + offsetof(VREF_t, CTRLB), comparator == 1 ? VREF_DAC1REFEN_bm : VREF_DAC2REFEN_bm, 0xFF),
+              sfr::modify(dac + offsetof(DAC_t, CTRLA), DAC_ENABLE_bm, 0xFF),
+              sfr::store(dac + offsetof(DAC_t, DATA), dacref),
+            }};
+            return ref_writes + ac_writes;
+          #else
+            static_assert(comparator == 0, "This part only has AC0");
+            return ac_writes;
+          #endif
+        }
+      }
+    #endif
 
     out::output_t      output         = out::disable;
     #if defined(DXCORE)
@@ -378,6 +449,10 @@ class AnalogComparator {
       register8_t &IN2_N;
     #endif
     bool enable = false;
+    bool window_on = false;
+    uint8_t window_low;
+    uint8_t window_high;
+    void setDacref(uint8_t value);
 };
 
 #if defined(AC0_AC_vect)
@@ -0,0 +1,42 @@
+/* Settings - keep a counter and a setting in EEKV, so that saving them every few seconds doesn't wear out the EEPROM.
+ *
+ * Uses the last 128 bytes of the EEPROM - 16 slots of 8 bytes, each holding one 4-byte value - for two keys, so each
+ * slot is written once for every 16 saves or so, rather than the same cells being written every time.
+ */
+#include <EEKV.h>
+
+enum : uint8_t {
+  KEY_BOOTS,
+  KEY_SETPOINT,
+  KEY_COUNT
+};
+
+EEKV<KEY_COUNT, 8> settings(EEPROM_SIZE - 128, 128);
+
+uint32_t boots = 0;
+uint16_t setpoint = 500;
+
+void setup() {
+  Serial.begin(115200);
+  if (!settings.begin()) {
+    Serial.println("Region is too small for that many keys");
+    while (1);
+  }
+  settings.get(KEY_BOOTS, boots);            // leaves them alone if they've never been saved.
+  settings.get(KEY_SETPOINT, setpoint);
+  boots++;
+  settings.put(KEY_BOOTS, boots);
+  Serial.print("Boot number ");
+  Serial.println(boots);
+}
+
+void loop() {
+  static uint32_t lastSave = 0;
+  setpoint = 400 + (analogRead(PIN_PA7) >> 2); // pretend this is a knob
+  if (millis() - lastSave > 5000) {
+    lastSave = millis();
+    settings.put(KEY_SETPOINT, setpoint);    // only written when it has changed
+    Serial.print("Setpoint ");
+    Serial.println(setpoint);
+  }
+}
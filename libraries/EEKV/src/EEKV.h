@@ -0,0 +1,229 @@
+/* EEKV.h - a wear-levelled key/value store in the EEPROM or USERROW
+ *
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The region is divided into slots of SlotSize bytes, which are never split across an EEPROM page, so one slot takes
+ * one page erase-write. Each slot holds one record:
+ *
+ *   key | sequence (16 bits, little endian) | CRC8 of the rest | value (SlotSize - 4 bytes)
+ *
+ * A new value doesn't go back where the old one was - it goes in the next slot around the ring, with the next
+ * sequence number, so the writes are spread over all the slots instead of one cell taking all of them. The record for
+ * a key with the highest sequence number is the current one; the older ones are dead and are written over on the way
+ * round. At begin() every slot is read once to find those, and which slot was written last, and the slot number of
+ * each key's current record is kept in RAM (one byte per key) - so get() after that is a direct read.
+ *
+ * When the next slot still holds a current record for another key, that record is carried forward into the next
+ * dead slot first (with a sequence number that makes it the last one written), and then the new record goes where it
+ * was - so a put() is at most two page writes, and values that never change move round the ring too, rather than
+ * leaving the writes to fall on fewer slots. Power lost partway through a put() leaves either the old record or the
+ * new one: a torn record fails its CRC and is ignored.
+ */
+
+#ifndef EEKV_h
+#define EEKV_h
+
+#include <Arduino.h>
+#include <util/crc16.h>
+#include <EEPROM.h>
+#include <USERSIG.h>
+
+/* Where the records go. */
+struct EEKV_EEPROM {
+  static constexpr uint16_t size     = EEPROM_SIZE;
+  static constexpr uint8_t  pageSize = EEPROM_PAGE_SIZE;
+  static void read(uint16_t address, void *buf, uint8_t len) {
+    EEPROM.readBlock(address, buf, len);
+  }
+  static void write(uint16_t address, const void *buf, uint8_t len) {
+    EEPROM.writeBlock(address, buf, len);
+  }
+};
+
+struct EEKV_USERSIG {
+  static constexpr uint16_t size     = USER_SIGNATURES_SIZE;
+  static constexpr uint8_t  pageSize = USER_SIGNATURES_SIZE;
+  static void read(uint16_t address, void *buf, uint8_t len) {
+    uint8_t *ptr = (uint8_t *) buf;
+    for (; len; --len) {
+      *ptr++ = USERSIG.read(address++);
+    }
+  }
+  static void write(uint16_t address, const void *buf, uint8_t len) {
+    USERSIG.writeBlock(address, buf, len);
+  }
+};
+
+template <uint8_t Keys, uint8_t SlotSize = 16, class Storage = EEKV_EEPROM>
+class EEKV {
+    static_assert(SlotSize == 8 || SlotSize == 16 || SlotSize == 32, "SlotSize must be 8, 16 or 32");
+    static_assert(SlotSize <= Storage::pageSize, "SlotSize can't be bigger than a page");
+    static_assert(Keys >= 1 && Keys < 255, "Keys must be 1 to 254");
+
+  public:
+    static constexpr uint8_t valueSize = SlotSize - 4;
+
+    /* start must be a multiple of SlotSize. There must be at least Keys + 2 slots. */
+    EEKV(uint16_t start = 0, uint16_t length = Storage::size) : _start(start), _slots(length / SlotSize) {}
+
+    /* Reads every slot to find the current records. Returns false if the region is the wrong shape. */
+    bool begin() {
+      if ((_start & (SlotSize - 1)) || _slots < Keys + 2 || _slots > 254) {
+        return false;
+      }
+      for (uint8_t k = 0; k < Keys; k++) {
+        _index[k] = 0xFF;
+      }
+      _head = _slots - 1;                 // so a blank region starts at slot 0
+      bool any = false;
+      for (uint8_t s = 0; s < _slots; s++) {
+        uint8_t rec[SlotSize];
+        if (!readRecord(s, rec)) {
+          continue;
+        }
+        uint16_t seq = sequence(rec);
+        uint8_t key = rec[0];
+        if (_index[key] == 0xFF || newer(seq, sequenceAt(_index[key]))) {
+          _index[key] = s;
+        }
+        if (!any || newer(seq, _seq)) {
+          _seq  = seq;
+          _head = s;
+          any   = true;
+        }
+      }
+      _seq++;
+      return true;
+    }
+
+    /* Copies up to len bytes of key's value to buf. Returns false if key has never been written. */
+    bool get(uint8_t key, void *buf, uint8_t len) {
+      if (key >= Keys || _index[key] == 0xFF) {
+        return false;
+      }
+      Storage::read(address(_index[key]) + 4, buf, len < valueSize ? len : valueSize);
+      return true;
+    }
+    template <typename T> bool get(uint8_t key, T &t) {
+      static_assert(sizeof(T) <= valueSize, "Too big for a slot");
+      return get(key, &t, sizeof(T));
+    }
+
+    /* Stores len bytes from buf as key's value - nothing is written if that's what is stored already. Returns false
+       if the key or the length are out of range. */
+    bool put(uint8_t key, const void *buf, uint8_t len) {
+      if (key >= Keys || len > valueSize) {
+        return false;
+      }
+      uint8_t rec[SlotSize];
+      memset(rec + 4, 0, valueSize);
+      memcpy(rec + 4, buf, len);
+      if (_index[key] != 0xFF) {
+        uint8_t old[SlotSize];
+        Storage::read(address(_index[key]), old, SlotSize);
+        if (!memcmp(old + 4, rec + 4, valueSize)) {
+          return true;
+        }
+      }
+      uint8_t target = next(_head);
+      if (target == _index[key]) {        // never write over the record we're replacing - it's all we have until
+        target = next(target);            // the new one is written.
+      }
+      rec[0] = key;
+      if (live(target)) {
+        // Carry that one forward, into the next slot that isn't current for anything, as the newest record.
+        uint8_t other = keyAt(target);
+        uint8_t dest = next(target);
+        while (live(dest)) {
+          dest = next(dest);
+        }
+        uint8_t moved[SlotSize];
+        Storage::read(address(target), moved, SlotSize);
+        writeRecord(dest, moved, _seq + 1);
+        _index[other] = dest;
+        writeRecord(target, rec, _seq);
+        _index[key] = target;
+        _head = dest;
+        _seq += 2;
+      } else {
+        writeRecord(target, rec, _seq);
+        _index[key] = target;
+        _head = target;
+        _seq++;
+      }
+      return true;
+    }
+    template <typename T> bool put(uint8_t key, const T &t) {
+      static_assert(sizeof(T) <= valueSize, "Too big for a slot");
+      return put(key, &t, sizeof(T));
+    }
+
+    bool contains(uint8_t key) {
+      return key < Keys && _index[key] != 0xFF;
+    }
+
+    /* Forgets everything: blanks the key byte of every slot. */
+    void clear() {
+      const uint8_t blank = 0xFF;
+      for (uint8_t s = 0; s < _slots; s++) {
+        Storage::write(address(s), &blank, 1);
+      }
+      begin();
+    }
+
+  private:
+    uint16_t _start;
+    uint8_t  _slots;
+    uint8_t  _head = 0;                   // the slot written last
+    uint16_t _seq  = 0;                   // the sequence number for the next record
+    uint8_t  _index[Keys];                // the slot with each key's current record, or 0xFF
+
+    uint16_t address(uint8_t slot) {
+      return _start + (uint16_t) slot * SlotSize;
+    }
+    uint8_t next(uint8_t slot) {
+      return (slot + 1 < _slots) ? slot + 1 : 0;
+    }
+    static bool newer(uint16_t a, uint16_t b) {
+      return (int16_t)(a - b) > 0;
+    }
+    static uint16_t sequence(const uint8_t *rec) {
+      return rec[1] | (rec[2] << 8);
+    }
+    static uint8_t crc(const uint8_t *rec) {
+      uint8_t c = 0xFF;                   // so that a slot of all zeros isn't a valid record
+      for (uint8_t i = 0; i < SlotSize; i++) {
+        if (i != 3) {
+          c = _crc8_ccitt_update(c, rec[i]);
+        }
+      }
+      return c;
+    }
+    uint8_t keyAt(uint8_t slot) {
+      uint8_t key;
+      Storage::read(address(slot), &key, 1);
+      return key;
+    }
+    uint16_t sequenceAt(uint8_t slot) {
+      uint8_t rec[3];
+      Storage::read(address(slot), rec, 3);
+      return sequence(rec);
+    }
+    bool live(uint8_t slot) {
+      uint8_t key = keyAt(slot);
+      return key < Keys && _index[key] == slot;
+    }
+    bool readRecord(uint8_t slot, uint8_t *rec) {
+      Storage::read(address(slot), rec, SlotSize);
+      return rec[0] < Keys && crc(rec) == rec[3];
+    }
+    void writeRecord(uint8_t slot, uint8_t *rec, uint16_t seq) {
+      rec[1] = seq;
+      rec[2] = seq >> 8;
+      rec[3] = crc(rec);
+      Storage::write(address(slot), rec, SlotSize);
+    }
+};
+
+#endif
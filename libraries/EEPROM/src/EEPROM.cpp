@@ -0,0 +1,101 @@
+/* EEPROM.cpp - the write queue for EEPROM.writeAsync()
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The library is linked as an archive (dot_a_linkage), so none of this - the queue in RAM, nor the ISR - ends up in a
+ * sketch that doesn't use writeAsync().
+ */
+#include "EEPROM.h"
+
+#if defined(MEGATINYCORE)
+
+#define EEPROM_QUEUE_SIZE 16
+
+typedef struct {
+  INDEXDATATYPE index;
+  uint8_t value;
+} eeprom_queued_t;
+
+static eeprom_queued_t _queue[EEPROM_QUEUE_SIZE];
+static volatile uint8_t _queueHead  = 0;
+static volatile uint8_t _queueCount = 0;
+
+/* Load the oldest queued byte, and the ones queued after it that are in the same page, into the page buffer, and
+   start the page erase-write. Interrupts have to be off, the NVM controller not busy, and something in the queue. */
+static void _eepromCommit() {
+  _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+  uint8_t head  = _queueHead;
+  uint8_t count = _queueCount;
+  INDEXDATATYPE page = _queue[head].index & ~(EEPROM_PAGE_SIZE - 1);
+  do {
+    *(volatile uint8_t *)((uint16_t)MAPPED_EEPROM_START + _queue[head].index) = _queue[head].value;
+    head = (head + 1) & (EEPROM_QUEUE_SIZE - 1);
+    count--;
+  } while (count && (_queue[head].index & ~(EEPROM_PAGE_SIZE - 1)) == page);
+  _queueHead  = head;
+  _queueCount = count;
+  _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+}
+
+// Whatever the interrupt would do, for when we are waiting on it - which might be with interrupts disabled.
+static void _eepromService() {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_queueCount && !(NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm)) {
+    _eepromCommit();
+  }
+  SREG = oldSREG;
+}
+
+ISR(NVMCTRL_EE_vect) {
+  if (_queueCount) {
+    _eepromCommit();
+    NVMCTRL.INTFLAGS = NVMCTRL_EEREADY_bm;  // set again when this write is done
+  } else {
+    NVMCTRL.INTCTRL = 0;                    // nothing left - otherwise it would fire forever
+  }
+}
+
+void EEPROMClass::writeAsync(INDEXDATATYPE idx, uint8_t val) {
+  idx &= EEPROM_INDEX_MASK;
+  uint8_t oldSREG = SREG;
+  while (1) {
+    cli();
+    uint8_t count = _queueCount;
+    for (uint8_t i = 0, n = _queueHead; i < count; i++, n = (n + 1) & (EEPROM_QUEUE_SIZE - 1)) {
+      if (_queue[n].index == idx) {
+        _queue[n].value = val;              // still waiting, so just change what it will write
+        SREG = oldSREG;
+        return;
+      }
+    }
+    if (val == *(uint8_t *)((uint16_t)MAPPED_EEPROM_START + idx)) {
+      SREG = oldSREG;
+      return;
+    }
+    if (count < EEPROM_QUEUE_SIZE) {
+      break;
+    }
+    SREG = oldSREG;
+    _eepromService();
+  }
+  uint8_t n = (_queueHead + _queueCount) & (EEPROM_QUEUE_SIZE - 1);
+  _queue[n].index = idx;
+  _queue[n].value = val;
+  _queueCount++;
+  NVMCTRL.INTCTRL = NVMCTRL_EEREADY_bm;
+  SREG = oldSREG;
+}
+
+bool EEPROMClass::busy() {
+  return _queueCount || (NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+}
+
+void EEPROMClass::flush() {
+  while (_queueCount) {
+    _eepromService();
+  }
+  while (NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+}
+
+#endif
@@ -248,25 +248,186 @@ struct EEPROMClass {
     return EEPROM_SIZE;
   }
 
+  // Block reads and writes. Addresses wrap at the end, as for everything else.
+  void readBlock(INDEXDATATYPE idx, void *buf, uint16_t len) {
+    uint8_t *ptr = (uint8_t *) buf;
+    for (; len; --len, ++idx) {
+      *ptr++ = EERef(idx);
+    }
+  }
+
+  /* Like update() on each byte, but on tinyAVR all the bytes in one EEPROM page go into the page buffer together and
+   * are committed with a single page erase-write - only the bytes loaded into the buffer are erased and written, so
+   * it is the cells that changed, and 4 ms per page touched instead of per byte. Pages with no changes are skipped.
+   * Interrupts are disabled while a page is loaded (as long as that takes to loop over up to a page of bytes, not the
+   * write itself) so an ISR writing to the EEPROM can't get its byte into our page buffer, nor ours into its write. */
+  void writeBlock(INDEXDATATYPE idx, const void *buf, uint16_t len) {
+    const uint8_t *ptr = (const uint8_t *) buf;
+    #ifdef MEGATINYCORE
+    while (len) {
+      volatile uint8_t *cell = (volatile uint8_t *)((uint16_t)MAPPED_EEPROM_START + (idx & EEPROM_INDEX_MASK));
+      uint8_t room = EEPROM_PAGE_SIZE - (idx & (EEPROM_PAGE_SIZE - 1)); // the EEPROM starts on a page boundary
+      bool changed = false;
+      uint8_t oldSREG = SREG;
+      while (1) {                       // wait for any write before we touch the buffer - checked with interrupts off,
+        cli();                          // so that writeAsync()'s ISR can't start one after we've looked.
+        if (!(NVMCTRL.STATUS & (NVMCTRL_EEBUSY_bm | NVMCTRL_FBUSY_bm))) {
+          break;
+        }
+        SREG = oldSREG;
+      }
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc); // in case something left bytes in it.
+      for (; room && len; --room, --len, ++idx, ++cell, ++ptr) {
+        if (*cell != *ptr) {
+          *cell = *ptr;                 // goes into the page buffer
+          changed = true;
+        }
+      }
+      if (changed) {
+        _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+      }
+      SREG = oldSREG;
+    }
+    #else
+    // Dx-series EEPROM is erased and written a byte at a time anyway.
+    for (; len; --len, ++idx) {
+      EERef(idx).update(*ptr++);
+    }
+    #endif
+  }
+
+  #ifdef MEGATINYCORE
+  /* Writes that don't wait: the byte is queued in RAM (a later write to the same address replaces it in the queue,
+   * and one that wouldn't change anything is dropped), and the NVM controller's EEREADY interrupt writes the queue out,
+   * all the queued bytes in the same page with one page erase-write. They only wait if the queue is full. Until a byte
+   * has been written, reading that address gives the old value - flush() first if that matters. */
+  void writeAsync(INDEXDATATYPE idx, uint8_t val);
+  void writeBlockAsync(INDEXDATATYPE idx, const void *buf, uint16_t len) {
+    const uint8_t *ptr = (const uint8_t *) buf;
+    for (; len; --len, ++idx) {
+      writeAsync(idx, *ptr++);
+    }
+  }
+  template< typename T > const T &putAsync(INDEXDATATYPE idx, const T &t) {
+    writeBlockAsync(idx, &t, sizeof(T));
+    return t;
+  }
+  // True while there are queued writes, or a write in progress.
+  bool busy();
+  // Wait until everything queued has been written. Works with interrupts disabled too.
+  void flush();
+  #endif
+
   // Functionality to 'get' and 'put' objects to and from EEPROM.
   template< typename T > T &get(INDEXDATATYPE idx, T &t) {
-    EEPtr e = idx;
-    uint8_t *ptr = (uint8_t *) &t;
-    for (uint8_t count = sizeof(T); count; --count, ++e) {
-      *ptr++ = *e;
-    }
+    readBlock(idx, &t, sizeof(T));
     return t;
   }
 
   template< typename T > const T &put(INDEXDATATYPE idx, const T &t) {
-    EEPtr e = idx;
-    const uint8_t *ptr = (const uint8_t *) &t;
-    for (uint8_t count = sizeof(T); count; --count, ++e) {
-      (*e).update(*ptr++);
-    }
+    writeBlock(idx, &t, sizeof(T));
     return t;
   }
 };
 
 static EEPROMClass EEPROM;
+
+/* EEPROMShadow class.
+ *
+ * A copy in RAM of a T kept in the EEPROM at address, for settings that are changed a field at a time. Changes are
+ * made to the copy, and the EEPROM pages they fall in are marked dirty; commit() writes out only the dirty pages - and
+ * of those only the bytes that differ - through the write queue on megaTinyCore. With a debounce interval, task()
+ * does the commit() once nothing has changed for that many milliseconds, so a setting being turned through a range of
+ * values is written once, not for every step.
+ */
+
+template< typename T > class EEPROMShadow {
+  public:
+    EEPROMShadow(INDEXDATATYPE address, uint16_t debounce = 0) : _address(address), _debounce(debounce) {}
+
+    // Load the copy from the EEPROM. Nothing is dirty afterwards.
+    void begin() {
+      EEPROM.get(_address, _data);
+      clean();
+    }
+    const T &get() const {
+      return _data;
+    }
+    const T *operator -> () const {
+      return &_data;
+    }
+    // Change one field: shadow.set(&Settings::volume, 7). Marks nothing if it's unchanged.
+    template< typename M > void set(M T::*field, const M &value) {
+      if (memcmp(&(_data.*field), &value, sizeof(M))) {
+        memcpy(&(_data.*field), &value, sizeof(M));
+        markDirty(&(_data.*field), sizeof(M));
+      }
+    }
+    // For changes made some other way - a pointer to what was changed anywhere in the copy, and its length.
+    void markDirty(const void *changed, uint16_t len) {
+      if (!len) {
+        return;
+      }
+      uint16_t start = (const uint8_t *) changed - (const uint8_t *) &_data + _pageOffset();
+      for (uint16_t page = start / EEPROM_PAGE_SIZE; page <= (start + len - 1) / EEPROM_PAGE_SIZE; page++) {
+        _dirty[page >> 3] |= 1 << (page & 7);
+      }
+      _changed = millis();
+    }
+    // The whole copy, to change as you like - which marks all of it dirty. commit() still only writes what changed.
+    T &edit() {
+      markDirty(&_data, sizeof(T));
+      return _data;
+    }
+    bool dirty() const {
+      for (uint8_t i = 0; i < sizeof(_dirty); i++) {
+        if (_dirty[i]) {
+          return true;
+        }
+      }
+      return false;
+    }
+    // Write the dirty pages. On megaTinyCore this only queues them - EEPROM.flush() to wait for them.
+    void commit() {
+      for (uint16_t page = 0; page < _pages; page++) {
+        if (_dirty[page >> 3] & (1 << (page & 7))) {
+          int16_t start = page * EEPROM_PAGE_SIZE - _pageOffset();
+          int16_t end   = start + EEPROM_PAGE_SIZE;
+          if (start < 0) {
+            start = 0;
+          }
+          if (end > (int16_t) sizeof(T)) {
+            end = sizeof(T);
+          }
+          #ifdef MEGATINYCORE
+          EEPROM.writeBlockAsync(_address + start, (const uint8_t *) &_data + start, end - start);
+          #else
+          EEPROM.writeBlock(_address + start, (const uint8_t *) &_data + start, end - start);
+          #endif
+        }
+      }
+      clean();
+    }
+    // Call from loop(): commits once the debounce interval has passed since the last change.
+    void task() {
+      if (_debounce && dirty() && (uint16_t)(millis() - _changed) >= _debounce) {
+        commit();
+      }
+    }
+
+  private:
+    // the pages a T can touch: one more than it fills, if it doesn't start at the start of one
+    static constexpr uint16_t _pages = (sizeof(T) + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE + 1;
+    uint8_t _pageOffset() const {
+      return _address & (EEPROM_PAGE_SIZE - 1);
+    }
+    void clean() {
+      memset(_dirty, 0, sizeof(_dirty));
+    }
+    T             _data;
+    INDEXDATATYPE _address;
+    uint16_t      _debounce;
+    uint16_t      _changed = 0;               // millis() when it last changed, low 16 bits
+    uint8_t       _dirty[(_pages + 7) / 8];   // one bit per page
+};
 #endif
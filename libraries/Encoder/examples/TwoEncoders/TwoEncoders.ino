@@ -0,0 +1,38 @@
+/* TwoEncoders - one encoder counted in hardware on TCA0, the other with pin interrupts, for comparison.
+ * tinyAVR 2-series only. The hardware one doesn't use any CPU time until read() is called; the other one
+ * runs an interrupt on every edge of both of its pins.
+ */
+#include <Encoder.h>
+
+Encoder fast(TCA0);                   // Logic2 and Logic3, 2 counts per cycle
+
+volatile int32_t slowPosition = 0;
+void slowEdge() {                     // the same decoding, done in software - 2 counts per cycle.
+  if (digitalReadFast(PIN_PA5) == digitalReadFast(PIN_PA4)) {
+    slowPosition--;
+  } else {
+    slowPosition++;
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(PIN_PA1, INPUT_PULLUP);
+  pinMode(PIN_PA2, INPUT_PULLUP);
+  pinMode(PIN_PA4, INPUT_PULLUP);
+  pinMode(PIN_PA5, INPUT_PULLUP);
+  if (!fast.begin(PIN_PA1, PIN_PA2)) {
+    Serial.println("TCA0, the Logic blocks or the event channels aren't available");
+  }
+  attachInterrupt(digitalPinToInterrupt(PIN_PA4), slowEdge, CHANGE);
+}
+
+void loop() {
+  Serial.print(fast.read());
+  Serial.print(' ');
+  noInterrupts();
+  int32_t slow = slowPosition;
+  interrupts();
+  Serial.println(slow);
+  delay(100);
+}
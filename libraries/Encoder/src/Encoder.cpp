@@ -0,0 +1,207 @@
+/* Encoder.cpp - see Encoder.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Nothing here runs in an interrupt. The counters are 16 bits, and read() adds the (signed) change since the last
+ * call to a 32-bit position - which is right as long as they haven't moved by more than 32767 in between.
+ */
+
+#include "Encoder.h"
+
+static int8_t blockNumber(Logic *block) {
+  if (block == &Logic0) {
+    return 0;
+  }
+  if (block == &Logic1) {
+    return 1;
+  }
+  if (block == &Logic2) {
+    return 2;
+  }
+  if (block == &Logic3) {
+    return 3;
+  }
+  return -1;
+}
+
+// The 2-series numbers the CCL event users event_a, event_b for each block in turn.
+static user::user_t lutEvent(uint8_t block, bool b) {
+  return (user::user_t)(user::ccl0_event_a + block * 2 + b);
+}
+
+static bool routePin(uint8_t pin, user::user_t event_user) {
+  Event &channel = Event::assign_generator_pin(pin);
+  if (channel.get_channel_number() == 255) {
+    return false;
+  }
+  channel.set_user(event_user);
+  channel.start();
+  return true;
+}
+
+static bool routeLUT(uint8_t block, user::user_t event_user) {
+  Event &channel = Event::assign_generator((gen::generator_t)(gen::ccl0_out + block));
+  if (channel.get_channel_number() == 255) {
+    return false;
+  }
+  channel.set_user(event_user);
+  channel.start();
+  return true;
+}
+
+static void setBlock(Logic &block, in::input_t in0, in::input_t in1, in::input_t in2, uint8_t truth, filter::filter_t filt) {
+  block.enable      = true;
+  block.input0      = in0;
+  block.input1      = in1;
+  block.input2      = in2;
+  block.truth       = truth;
+  block.filter      = filt;
+  block.clocksource = clocksource::clk_per;
+  block.edgedetect  = edgedetect::disable;
+  block.sequencer   = sequencer::disable;
+  block.output      = out::disable;
+  block.init();
+}
+
+bool Encoder::begin(uint8_t pinA, uint8_t pinB, bool reverse) {
+  end();
+  _reverse  = reverse;
+  _position = 0;
+  _last     = 0;
+  if (_tca) {
+    #if defined(MILLIS_USE_TIMERA0)
+      return false;
+    #else
+      int8_t d = blockNumber(_dir);
+      int8_t s = blockNumber(_step);
+      if (_tca != &TCA0 || d < 0 || s < 0 || d == s) {
+        return false;
+      }
+      // A to both blocks, B to the direction one; the direction to count input B, and the delayed A to count input A.
+      if (!routePin(pinA, lutEvent(d, 0)) || !routePin(pinA, lutEvent(s, 0)) || !routePin(pinB, lutEvent(d, 1)) ||
+          !routeLUT(d, user::tca0_cnt_b) || !routeLUT(s, user::tca0_cnt_a)) {
+        return false;
+      }
+      takeOverTCA0();
+      TCA0.SINGLE.CTRLD   = 0;
+      TCA0.SINGLE.CTRLB   = TCA_SINGLE_WGMODE_NORMAL_gc;
+      TCA0.SINGLE.PER     = 0xFFFF;
+      TCA0.SINGLE.CNT     = 0;
+      // Count on both edges of the step, down while the direction is high.
+      TCA0.SINGLE.EVCTRL  = TCA_SINGLE_CNTAEI_bm | TCA_SINGLE_EVACTA_CNT_ANYEDGE_gc |
+                            TCA_SINGLE_CNTBEI_bm | TCA_SINGLE_EVACTB_UPDOWN_gc;
+      TCA0.SINGLE.CTRLA   = TCA_SINGLE_ENABLE_bm;
+      Logic::stop();
+      setBlock(*_dir,  in::event_a, in::event_b, in::masked, 0x99, filter::disable); // A XNOR B: low turning forwards
+      setBlock(*_step, in::event_a, in::masked,  in::masked, 0xAA, filter::filter);  // A, 4 clocks behind the direction
+      Logic::start();
+      return true;
+    #endif
+  }
+  uint8_t up   = (_up   == &TCB0) ? 0 : 1;
+  uint8_t down = (_down == &TCB0) ? 0 : 1;
+  if (up == down || (_up != &TCB0 && _up != &TCB1) || (_down != &TCB0 && _down != &TCB1)) {
+    return false;
+  }
+  #if defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1)
+    return false;                       // both TCBs are needed.
+  #else
+    // A to all three blocks, B to the two that count; the rising edge pulse to the up TCB, and the falling to the down.
+    if (!routePin(pinA, user::ccl0_event_a) || !routePin(pinA, user::ccl1_event_a) || !routePin(pinA, user::ccl3_event_a) ||
+        !routePin(pinB, user::ccl1_event_b) || !routePin(pinB, user::ccl3_event_b) ||
+        !routeLUT(1, up ? user::tcb1_cnt : user::tcb0_cnt) || !routeLUT(3, down ? user::tcb1_cnt : user::tcb0_cnt)) {
+      return false;
+    }
+    TCB_t *timers[2] = {_up, _down};
+    for (uint8_t i = 0; i < 2; i++) {
+      TCB_t *t   = timers[i];
+      t->CTRLA   = 0;
+      t->CTRLB   = TCB_CNTMODE_INT_gc;
+      t->EVCTRL  = 0;
+      t->INTCTRL = 0;
+      t->CCMP    = 0xFFFF;
+      t->CNT     = 0;
+      t->CTRLA   = TCB_CLKSEL_EVENT_gc | TCB_ENABLE_bm;
+    }
+    Logic::stop();
+    setBlock(Logic0, in::event_a, in::masked,   in::masked,  0xAA, filter::filter);  // A, a few clocks late
+    setBlock(Logic1, in::event_a, in::feedback, in::event_b, 0x02, filter::disable); // A & !Logic0 & !B
+    setBlock(Logic3, in::event_a, in::link,     in::event_b, 0x04, filter::disable); // !A & Logic0 & !B
+    Logic::start();
+    return true;
+  #endif
+}
+
+void Encoder::end() {
+  uint8_t was = CCL.CTRLA;
+  Logic::stop();
+  if (_tca) {
+    int8_t d = blockNumber(_dir);
+    int8_t s = blockNumber(_step);
+    if (_tca != &TCA0 || d < 0 || s < 0) {
+      CCL.CTRLA = was;
+      return;
+    }
+    if (Event::get_user_channel_number(user::tca0_cnt_a) >= 0) {
+      TCA0.SINGLE.CTRLA  = 0;           // only if it's ours - begin() set that user up.
+      TCA0.SINGLE.EVCTRL = 0;
+      Event::clear_user(user::tca0_cnt_a);
+      Event::clear_user(user::tca0_cnt_b);
+    }
+    Event::clear_user(lutEvent(d, 0));
+    Event::clear_user(lutEvent(d, 1));
+    Event::clear_user(lutEvent(s, 0));
+    _dir->enable  = false;
+    _dir->init();
+    _step->enable = false;
+    _step->init();
+  } else {
+    TCB_t *timers[2] = {_up, _down};
+    for (uint8_t i = 0; i < 2; i++) {
+      user::user_t cnt = (timers[i] == &TCB0) ? user::tcb0_cnt : user::tcb1_cnt;
+      if (Event::get_user_channel_number(cnt) >= 0) {
+        timers[i]->CTRLA = 0;
+        Event::clear_user(cnt);
+      }
+    }
+    Event::clear_user(user::ccl0_event_a);
+    Event::clear_user(user::ccl1_event_a);
+    Event::clear_user(user::ccl1_event_b);
+    Event::clear_user(user::ccl3_event_a);
+    Event::clear_user(user::ccl3_event_b);
+    Logic0.enable = false;
+    Logic0.init();
+    Logic1.enable = false;
+    Logic1.init();
+    Logic3.enable = false;
+    Logic3.init();
+  }
+  CCL.CTRLA = was;                      // the channels are left running - something else may be using those pins' events.
+}
+
+uint16_t Encoder::_count() {
+  uint8_t oldSREG = SREG;
+  cli();                                // the 16-bit reads share TEMP with anything an ISR reads from the same timer.
+  uint16_t count = _tca ? TCA0.SINGLE.CNT : (uint16_t)(_up->CNT - _down->CNT);
+  SREG = oldSREG;
+  return count;
+}
+
+int32_t Encoder::read() {
+  uint16_t now   = _count();
+  int16_t  delta = (int16_t)(now - _last);
+  _last          = now;
+  _position     += _reverse ? -delta : delta;
+  return _position;
+}
+
+void Encoder::write(int32_t position) {
+  _last     = _count();
+  _position = position;
+}
+
+int32_t Encoder::readAndReset() {
+  int32_t position = read();
+  _position = 0;
+  return position;
+}
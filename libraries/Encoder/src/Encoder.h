@@ -0,0 +1,50 @@
+/* Encoder.h - quadrature encoder position counted in hardware, with the CCL, the event system and a timer.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Two ways to count, picked by the constructor:
+ *   Encoder(TCA0)        - 2 steps per cycle. One Logic block gives A XNOR B as the direction, on event input B of
+ *                          TCA0, and another gives A (delayed by its filter, so the direction is always settled first),
+ *                          on event input A, which counts on both edges, up or down.
+ *   Encoder(TCB0, TCB1)  - 1 step per cycle, on Logic0, Logic1 and Logic3. Logic0 is A through the filter, and so a few
+ *                          clocks late; Logic1 is A & !Adelayed & !B - a pulse on each rising edge of A while B is low -
+ *                          and Logic3 the same for falling edges. One TCB counts each.
+ * Both count the edges of A that go one way, and the ones that go back, and so stay right when an encoder sitting on
+ * an edge jitters back and forth over it. Both only work on the 2-series: the 0/1-series TCA has only one event
+ * input, and their TCBs can't count events. See README.md.
+ */
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <Arduino.h>
+#include <Event.h>
+#include <Logic.h>
+
+#if !defined(MEGATINYCORE) || MEGATINYCORE_SERIES != 2
+  #error "The Encoder library needs a tinyAVR 2-series part - the 0/1-series timers can't count up and down on events."
+#endif
+
+class Encoder {
+  public:
+    Encoder(TCA_t &timer, Logic &dirBlock = Logic2, Logic &stepBlock = Logic3) :
+      _tca(&timer), _up(NULL), _down(NULL), _dir(&dirBlock), _step(&stepBlock) {}
+    Encoder(TCB_t &upTimer, TCB_t &downTimer) :
+      _tca(NULL), _up(&upTimer), _down(&downTimer), _dir(NULL), _step(NULL) {}
+    bool    begin(uint8_t pinA, uint8_t pinB, bool reverse = false);
+    void    end();
+    int32_t read();          // has to be called at least once every 32767 steps, or some are lost.
+    void    write(int32_t position);
+    int32_t readAndReset();
+  private:
+    uint16_t _count();       // up - down for the TCBs, CNT for TCA0
+    TCA_t   *_tca;
+    TCB_t   *_up;
+    TCB_t   *_down;
+    Logic   *_dir;
+    Logic   *_step;
+    int32_t  _position;
+    uint16_t _last;
+    bool     _reverse;
+};
+
+#endif
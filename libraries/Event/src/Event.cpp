@@ -1160,3 +1160,270 @@ void Event::start(bool state) {
 void Event::stop() {
   start(false);
 }
+
+
+/* Route planner. Each route() is one generator -> user link; commit() works out which channel each distinct generator
+ * goes on, so that every one of them gets a channel that can carry it and every user listening to it can reach, and
+ * only then writes the channel and user registers - if it can't place everything, nothing is changed.
+ */
+#define EVENT_ROUTE_ANY    0x80        // a gen:: generator
+#define EVENT_ROUTE_SYNC   0x81        // a gens:: generator (0/1-series)
+#define EVENT_ROUTE_PIN    0x82        // an Arduino pin
+
+Event::route_t Event::_routes[EVENT_MAX_ROUTES];
+uint8_t  Event::_route_count;
+uint16_t Event::_route_channels;
+
+/**
+ * @brief The generator value for a pin on a particular channel
+ *
+ * @param port Port of the pin
+ * @param port_pin Bit position of the pin within its port
+ * @param channel Event channel number
+ * @return uint8_t Generator value, or 0 if that channel can't use that pin
+ */
+static uint8_t _pin_generator(uint8_t port, uint8_t port_pin, uint8_t channel) {
+  if (port == NOT_A_PIN || port_pin == NOT_A_PIN) {
+    return 0;
+  }
+  #if !defined(MEGATINYCORE) // each pair of channels has a pair of ports
+    if ((channel >> 1) == (port >> 1)) {
+      return 0x40 | (port & 0x01) << 3 | port_pin;
+    }
+  #elif MEGATINYCORE_SERIES == 2 // channels 0/1: PA and PB, 2/3: PC and PA, 4/5: PB and PC
+    static const uint8_t first[3] = {PA, PC, PB};
+    static const uint8_t second[3] = {PB, PA, PC};
+    if (channel < 6) {
+      if (port == first[channel >> 1]) {
+        return 0x40 | port_pin;
+      }
+      if (port == second[channel >> 1]) {
+        return 0x48 | port_pin;
+      }
+    }
+  #else // 0/1-series, see the genN:: lists.
+    if (channel == 0 && port == PA) {
+      return 0x0D + port_pin;
+    }
+    if (channel == 0 && port == PC) {
+      return 0x07 + port_pin;
+    }
+    #if MEGATINYCORE_SERIES == 1
+      if (channel == 1 && port == PB) {
+        return 0x08 + port_pin;
+      }
+      if (channel == 4 && port == PC) {
+        return 0x0A + port_pin;
+      }
+    #endif
+    if ((channel == 2 && port == PA) || (channel == 3 && port == PB)) {
+      return 0x0A + port_pin;
+    }
+  #endif
+  return 0;
+}
+
+/**
+ * @brief The generator value a route needs on a particular channel
+ *
+ * @return uint8_t Generator value, or 0 if that channel can't carry it
+ */
+static uint8_t _route_generator(uint8_t source, uint8_t kind, uint8_t channel) {
+  if (kind == EVENT_ROUTE_PIN) {
+    return _pin_generator(digitalPinToPort(source), digitalPinToBitPosition(source), channel);
+  }
+  #if defined(TINY_0_OR_1_SERIES) // the common generators are different on the sync and async channels.
+    if (kind == EVENT_ROUTE_ANY) {
+      return channel >= 2 ? source : 0;
+    }
+    if (kind == EVENT_ROUTE_SYNC) {
+      return channel < 2 ? source : 0;
+    }
+  #else
+    if (kind == EVENT_ROUTE_ANY) {
+      return source;
+    }
+  #endif
+  return kind == channel ? source : 0;
+}
+
+/**
+ * @brief The channels a user can be connected to
+ */
+static uint16_t _user_channels(uint8_t event_user) {
+  #if defined(TINY_0_OR_1_SERIES)
+    if ((event_user & 0x7F) >= 0x10) {
+      return 0x03;                     // sync users can only use the sync channels
+    }
+  #else
+    (void) event_user;
+  #endif
+  return 0xFFFF;
+}
+
+/**
+ * @brief Find a channel for a generator, moving the ones already placed if that's what it takes
+ *
+ * @param sig The generator, as the index of the first route that uses it
+ * @param allowed The channels each generator could go on
+ * @param owner The generator on each channel, -1 if none
+ * @param seen Channels already looked at in this search
+ * @return true if it was placed
+ */
+static bool _route_place(uint8_t sig, const uint16_t *allowed, int8_t *owner, uint16_t *seen) {
+  for (int8_t ch = 9; ch >= 0; ch--) { // highest first, like assign_generator()
+    uint16_t bit = 1 << ch;
+    if ((allowed[sig] & bit) && !(*seen & bit)) {
+      *seen |= bit;
+      if (owner[ch] < 0 || _route_place(owner[ch], allowed, owner, seen)) {
+        owner[ch] = sig;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+int8_t Event::_add_route(uint8_t source, uint8_t kind, user::user_t event_user) {
+  if (_route_count >= EVENT_MAX_ROUTES) {
+    return -1;
+  }
+  _routes[_route_count].source = source;
+  _routes[_route_count].kind   = kind;
+  _routes[_route_count].user   = event_user;
+  return _route_count++;
+}
+
+
+/**
+ * @brief Adds a generator -> user link to the routes commit() will set up.
+ *        Nothing is written until commit() is called.
+ *
+ * @param generator Generator - gen:: to let commit() pick the channel
+ * @param event_user The user to connect to it
+ * @return int8_t The index of the route, or -1 if there are already EVENT_MAX_ROUTES
+ */
+int8_t Event::route(gen::generator_t generator, user::user_t event_user) {
+  return _add_route(generator, EVENT_ROUTE_ANY, event_user);
+}
+
+#if defined(TINY_0_OR_1_SERIES)
+  int8_t Event::route(gens::generator_t generator, user::user_t event_user) {
+    return _add_route(generator, EVENT_ROUTE_SYNC, event_user);
+  }
+#endif
+
+/**
+ * @brief Adds a route for a generator that only one channel has (the genN:: ones)
+ *
+ * @param channel The channel object the generator has to be on
+ * @param generator Generator
+ * @param event_user The user to connect to it
+ * @return int8_t The index of the route, or -1 if the table is full or channel is Event_empty
+ */
+int8_t Event::route(Event& channel, uint8_t generator, user::user_t event_user) {
+  if (channel.channel_number == 255) {
+    return -1;
+  }
+  return _add_route(generator, channel.channel_number, event_user);
+}
+
+/**
+ * @brief Adds a route with an Arduino pin as the generator; commit() picks a channel that can use that pin
+ *
+ * @param pin_number Arduino pin number
+ * @param event_user The user to connect to it
+ * @return int8_t The index of the route, or -1 if the table is full or it's not a pin
+ */
+int8_t Event::route_pin(uint8_t pin_number, user::user_t event_user) {
+  if (digitalPinToPort(pin_number) == NOT_A_PIN) {
+    return -1;
+  }
+  return _add_route(pin_number, EVENT_ROUTE_PIN, event_user);
+}
+
+/**
+ * @brief Forgets all the routes. Channels set up by the last commit() are left running until the next one.
+ */
+void Event::clear_routes() {
+  _route_count = 0;
+}
+
+/**
+ * @brief Picks a channel for every generator in the routes, then sets up the channels and connects the users, with
+ *        interrupts off. Channels that the last commit() set up, and channels with no generator, are free for it
+ *        to use; others are left alone. Channels from the last commit() that aren't needed any more are stopped.
+ *
+ * @return int8_t -1 if everything was set up. Otherwise, the index of the first route that couldn't be placed -
+ *         either a user routed to two different generators, or no channel left that can carry the generator and
+ *         reach all its users - and nothing is changed.
+ */
+int8_t Event::commit() {
+  uint8_t  sig[EVENT_MAX_ROUTES];      // for each route, the first route with the same generator
+  uint16_t allowed[EVENT_MAX_ROUTES];  // for the first route of each generator, the channels it could go on
+  int8_t   owner[10];                  // the generator on each channel, -1 if it's free
+  uint16_t free_channels = 0;
+  for (uint8_t ch = 0; ch < 10; ch++) {
+    Event& channel = get_channel(ch);
+    owner[ch] = -1;
+    if (channel.channel_number != 255 && (channel.generator_type == gen::disable || (_route_channels & (1 << ch)))) {
+      free_channels |= 1 << ch;
+    }
+  }
+  for (uint8_t i = 0; i < _route_count; i++) {
+    sig[i] = i;
+    for (uint8_t j = 0; j < i; j++) {
+      if (_routes[j].source == _routes[i].source && _routes[j].kind == _routes[i].kind) {
+        sig[i] = sig[j];
+        break;
+      }
+    }
+    for (uint8_t j = 0; j < i; j++) {
+      if (_routes[j].user == _routes[i].user && sig[j] != sig[i]) {
+        return i;                      // a user can only listen to one channel.
+      }
+    }
+    if (sig[i] == i) {
+      allowed[i] = 0;
+      for (uint8_t ch = 0; ch < 10; ch++) {
+        if ((free_channels & (1 << ch)) && _route_generator(_routes[i].source, _routes[i].kind, ch)) {
+          allowed[i] |= 1 << ch;
+        }
+      }
+    }
+    allowed[sig[i]] &= _user_channels(_routes[i].user);
+  }
+  for (uint8_t i = 0; i < _route_count; i++) {
+    uint16_t seen = 0;
+    if (sig[i] == i && !_route_place(i, allowed, owner, &seen)) {
+      return i;
+    }
+  }
+  // Everything has a place, so now write it all.
+  uint8_t  oldSREG = SREG;
+  cli();
+  uint16_t used = 0;
+  for (uint8_t ch = 0; ch < 10; ch++) {
+    if (owner[ch] >= 0) {
+      Event& channel = get_channel(ch);
+      channel.generator_type = _route_generator(_routes[owner[ch]].source, _routes[owner[ch]].kind, ch);
+      channel.start();
+      used |= 1 << ch;
+    } else if (_route_channels & (1 << ch)) {
+      Event& channel = get_channel(ch);
+      channel.stop();
+      channel.generator_type = gen::disable;
+    }
+  }
+  for (uint8_t i = 0; i < _route_count; i++) {
+    for (uint8_t ch = 0; ch < 10; ch++) {
+      if (owner[ch] == sig[i]) {
+        get_channel(ch).set_user((user::user_t)_routes[i].user);
+        break;
+      }
+    }
+  }
+  _route_channels = used;
+  SREG = oldSREG;
+  return -1;
+}
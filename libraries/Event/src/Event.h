@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #if defined(MEGATINYCORE)
+  #include "sfr_writes.h"
   #if (MEGATINYCORE_SERIES != 2)
     #define TINY_0_OR_1_SERIES
   #endif
@@ -18,6 +19,10 @@
     #define TINY_2_SERIES
   #endif
 #endif
+#if !defined(EVENT_MAX_ROUTES)
+  #define EVENT_MAX_ROUTES 12            // how many generator -> user links Event::route() can hold
+#endif
+
 // *INDENT-OFF* astyle hates how we formatted this.
 // I mean, I do too, but I hated all the alternatives we tried even more.
 // Readable code always takes priority over formatting dogma. -Spence
@@ -1235,12 +1240,88 @@ class Event {
     static gen::generator_t gen_from_peripheral(CCL_t& logic, uint8_t event_type = 0);
     static user::user_t    user_from_peripheral(CCL_t& logic, uint8_t user_type  = 0);
     static gen::generator_t gen_from_peripheral(AC_t&  comp);
+    /* Route planner - describe every generator -> user link, and commit() picks the channels, all in one go */
+    static int8_t route(gen::generator_t generator, user::user_t event_user);
+    #if defined(TINY_0_OR_1_SERIES)
+      static int8_t route(gens::generator_t generator, user::user_t event_user);
+    #endif
+    static int8_t route(Event& channel, uint8_t generator, user::user_t event_user);
+    static int8_t route_pin(uint8_t pin_number, user::user_t event_user);
+    static int8_t commit();
+    static void clear_routes();
+    #if defined(MEGATINYCORE)
+      /* Compile-time setup - the writes that put generator on channel and connect those users to it, as a table
+       * for SFR_STARTUP() (see sfr_writes.h). The Event objects aren't used or changed. generator is the value for
+       * that channel, ie, gen:: or that channel's genN:: */
+      template <uint8_t channel, uint8_t generator, user::user_t... users>
+      static constexpr auto config() {
+        constexpr uint8_t list[sizeof...(users) + 1] = {users..., 0};
+        constexpr uint8_t evouts = _config_evouts(list, sizeof...(users));
+        sfr_table<1 + sizeof...(users) + evouts> table{};
+        uint8_t n = 0;
+        table.writes[n++] = sfr::store(_config_channel(channel), generator);
+        for (uint8_t i = 0; i < sizeof...(users); i++) {
+          table.writes[n++] = sfr::store(_config_user(list[i]), channel + 1);
+          if (_config_is_evout(list[i])) {
+            table.writes[n++] = _config_evout(list[i]);
+          }
+        }
+        return table;
+      }
+    #endif
 
   private:
     const uint8_t channel_number;      // Holds the event generator channel number
     volatile uint8_t &channel_address; // Reference to the event channel address
     uint8_t generator_type;            // Generator type the event channel is using
     static void _long_soft_event(uint8_t channel, uint8_t length);    // holds the bulky assembly routine for the long softevent.
+    typedef struct {
+      uint8_t source;                  // the generator - or for a pin, the Arduino pin number
+      uint8_t kind;                    // the channel it has to be on, or any channel, any sync channel, or a pin
+      uint8_t user;
+    } route_t;
+    static route_t  _routes[EVENT_MAX_ROUTES];
+    static uint8_t  _route_count;
+    static uint16_t _route_channels;   // the channels the last commit() set up
+    static int8_t _add_route(uint8_t source, uint8_t kind, user::user_t event_user);
+    #if defined(MEGATINYCORE)
+      // The addresses config() writes to, and the EVOUT pin routing for the users that are pins.
+      static constexpr uint16_t _config_channel(uint8_t channel) {
+        #if defined(TINY_0_OR_1_SERIES)
+          return sfr::evsys + (channel < 2 ? offsetof(EVSYS_t, SYNCCH0) + channel : offsetof(EVSYS_t, ASYNCCH0) + channel - 2);
+        #else
+          return sfr::evsys + offsetof(EVSYS_t, CHANNEL0) + channel;
+        #endif
+      }
+      static constexpr uint16_t _config_user(uint8_t event_user) {
+        #if defined(TINY_0_OR_1_SERIES)
+          return sfr::evsys + offsetof(EVSYS_t, ASYNCUSER0) + event_user;
+        #else
+          return sfr::evsys + offsetof(EVSYS_t, USERCCLLUT0A) + (event_user & 0x7F);
+        #endif
+      }
+      static constexpr bool _config_is_evout(uint8_t event_user) {
+        #if defined(TINY_0_OR_1_SERIES)
+          return event_user >= 0x08 && event_user <= 0x0A;
+        #else
+          return (event_user & 0x7F) >= 0x09 && (event_user & 0x7F) <= 0x0B;
+        #endif
+      }
+      static constexpr sfr_write_t _config_evout(uint8_t event_user) {
+        #if defined(TINY_0_OR_1_SERIES)  // EVOUTn enable bits
+          return sfr::modify(sfr::portmux + offsetof(PORTMUX_t, CTRLA), 1 << (event_user - 0x08), 0xFF);
+        #else                            // EVOUTn alternate pin bits
+          return sfr::modify(sfr::portmux + offsetof(PORTMUX_t, EVSYSROUTEA), 1 << ((event_user & 0x7F) - 0x09), (event_user & 0x80) ? 0xFF : 0);
+        #endif
+      }
+      static constexpr uint8_t _config_evouts(const uint8_t *list, uint8_t count) {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < count; i++) {
+          n += _config_is_evout(list[i]);
+        }
+        return n;
+      }
+    #endif
 };
 #if defined(MEGATINYCORE) && MEGATINYCORE_SERIES !=2
   #if defined(EVSYS_SYNCCH0)
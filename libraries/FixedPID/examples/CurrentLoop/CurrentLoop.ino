@@ -0,0 +1,29 @@
+/* CurrentLoop - hold the current through a load (a motor, a LED string, a heater) at a setpoint, run from the ADC.
+ * The load is switched by a MOSFET driven from PB0 (TCA0 WO0), and its current is measured across a shunt resistor
+ * on PA1. TCA0's overflow starts each conversion, so there's one per PWM cycle, at the same point in it, and the loop
+ * runs in the ADC interrupt as soon as the result is in - nothing in loop() can hold it up.
+ */
+#include <FixedPID.h>
+
+const analogScanChannel_t shunt[] = {{PIN_PA1, 10, 0}};
+int32_t current[1];
+FixedPID pid;
+pwm_handle_t gate;
+
+void control(int32_t *results, __attribute__((unused)) uint8_t count) {
+  pwmWrite(gate, pid.compute(results[0]));
+}
+
+void setup() {
+  gate = pwmAttach(PIN_PB0);
+  // TCA0 runs PWM at F_CPU / 64 / 256 - 1.2 kHz at 20 MHz, so that's the loop rate too.
+  pid.setTunings(0.5, 200, 0, F_CPU / 64 / 256);
+  pid.setOutputLimits(0, 255);
+  pid.setDerivativeFilter(2);
+  pid.setSetpoint(300);            // in ADC counts across the shunt
+  analogScanBegin(shunt, 1, current, 0, control);
+  analogScanTrigger(ADC_TRIGGER_TCA0_OVF);
+}
+
+void loop() {
+}
@@ -0,0 +1,133 @@
+/* FixedPID.cpp - see FixedPID.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "FixedPID.h"
+
+static inline int16_t _clamp16(int32_t x) {
+  return (x > 32767) ? 32767 : (x < -32768 ? -32768 : x);
+}
+
+static int16_t _gain(float k, float scale, bool *ok) {
+  float x = k * scale;
+  if (x >= 32767.5 || x <= -32768.5) {
+    *ok = false;
+    return 0;
+  }
+  return (int16_t)(x < 0 ? x - 0.5 : x + 0.5);
+}
+
+bool FixedPID::setTunings(float kp, float ki, float kd, float rate) {
+  if (rate <= 0) {
+    return false;
+  }
+  bool ok = true;
+  int16_t p = _gain(kp, 256.0, &ok);
+  int16_t i = _gain(ki / rate, 32768.0, &ok);
+  int16_t d = _gain(kd * rate, 256.0, &ok);
+  if (ok) {
+    setTuningsRaw(p, i, d);
+  }
+  return ok;
+}
+
+void FixedPID::setTuningsRaw(int16_t kp, int16_t ki, int16_t kd) {
+  uint8_t oldSREG = SREG;
+  cli();
+  _kp = kp;
+  _ki = ki;
+  _kd = kd;
+  SREG = oldSREG;
+}
+
+void FixedPID::setOutputLimits(int16_t min, int16_t max) {
+  if (min > max) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _min = min;
+  _max = max;
+  int32_t lo = (int32_t) min << 15;
+  int32_t hi = (int32_t) max << 15;
+  _integral  = (_integral < lo) ? lo : (_integral > hi ? hi : _integral);
+  SREG = oldSREG;
+}
+
+void FixedPID::setDerivativeFilter(uint8_t k) {
+  if (k > 8) {
+    k = 8;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _dfilter = k;
+  _primed  = false;   // the state is scaled by it
+  SREG = oldSREG;
+}
+
+void FixedPID::setSetpoint(int16_t setpoint) {
+  uint8_t oldSREG = SREG;
+  cli();
+  _setpoint = setpoint;
+  SREG = oldSREG;
+}
+
+void FixedPID::reset(int16_t output) {
+  output = (output < _min) ? _min : (output > _max ? _max : output);
+  uint8_t oldSREG = SREG;
+  cli();
+  _integral = (int32_t) output << 15;
+  _output   = output;
+  _primed   = false;
+  SREG = oldSREG;
+}
+
+int16_t FixedPID::output() {
+  uint8_t oldSREG = SREG;
+  cli();
+  int16_t out = _output;
+  SREG = oldSREG;
+  return out;
+}
+
+/* The products are each under 2^30 in magnitude, as is the integrator (being held to the output range), so the sums
+ * of two of them can't overflow. */
+int16_t FixedPID::compute(int16_t measurement) {
+  if (!_primed) {
+    _primed = true;
+    _last   = measurement;
+    _dstate = 0;
+  }
+  int16_t error = _clamp16((int32_t) _setpoint - measurement);
+  int16_t diff  = _clamp16((int32_t) _last - measurement);   // minus the change: d(error)/dt at a fixed setpoint
+  _last         = measurement;
+  uint8_t k     = _dfilter;
+  _dstate      += diff - (_dstate >> k);                       // just diff, when k is 0
+  int16_t dfilt = _clamp16(_dstate >> k);
+  int32_t pd    = ((int32_t) _kp * error + (int32_t) _kd * dfilt) >> 8;
+  int32_t integral = _integral + (int32_t) _ki * error;
+  int32_t lo    = (int32_t) _min << 15;
+  int32_t hi    = (int32_t) _max << 15;
+  if (integral > hi) {
+    integral = hi;
+  } else if (integral < lo) {
+    integral = lo;
+  }
+  int32_t out   = pd + (integral >> 15);
+  if (out > _max) {
+    out = _max;
+    if (integral < _integral) {     // at a limit, it's only allowed to unwind
+      _integral = integral;
+    }
+  } else if (out < _min) {
+    out = _min;
+    if (integral > _integral) {
+      _integral = integral;
+    }
+  } else {
+    _integral = integral;
+  }
+  _output = out;
+  return out;
+}
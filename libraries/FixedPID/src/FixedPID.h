@@ -0,0 +1,49 @@
+/* FixedPID.h - PID controller in fixed point, fast and constant-time enough to run from the ADC interrupt
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Every term is one 16 x 16 -> 32 bit multiply, which the hardware multiplier does in a handful of MULs: the
+ * proportional and derivative gains are Q8.8, the integral gain Q1.15 (it's per sample, so at a few kHz it's always
+ * small) and the integrator keeps 15 fraction bits. The derivative is of the measurement, not the error, so a change
+ * of setpoint doesn't kick the output, and goes through a first order filter. The integrator stops when the output is
+ * at a limit and the error would take it further, and is itself held to the output range - no windup. See README.md.
+ */
+#ifndef FIXEDPID_H
+#define FIXEDPID_H
+
+#include <Arduino.h>
+
+class FixedPID {
+  public:
+    /* Gains in the usual units: ki per second and kd seconds, for a loop run rate times per second. False if one of
+     * them comes out of range per sample - kp and kd * rate must be under 128, ki / rate under 1. */
+    bool     setTunings(float kp, float ki, float kd, float rate);
+    /* The same, already per sample and scaled: kp and kd are 256 for 1.0, ki 32768 for 1.0. */
+    void     setTuningsRaw(int16_t kp, int16_t ki, int16_t kd);
+    void     setOutputLimits(int16_t min, int16_t max);   // 0 to 255 unless set - pwmWrite()'s range
+    void     setDerivativeFilter(uint8_t k);               // 0 = none, or 1 to 8: a time constant of about 2^k samples
+    void     setSetpoint(int16_t setpoint);
+    int16_t  setpoint() {
+      return _setpoint;
+    }
+    /* Start over from the given output, without a bump: the integrator takes it, and the next measurement is the one
+     * the derivative starts from. */
+    void     reset(int16_t output = 0);
+    int16_t  compute(int16_t measurement);   // returns the new output; call once per sample, at rate
+    int16_t  output();
+  private:
+    int16_t           _kp;
+    int16_t           _ki;
+    int16_t           _kd;
+    int16_t           _min = 0;
+    int16_t           _max = 255;
+    uint8_t           _dfilter;
+    bool              _primed;
+    volatile int16_t  _setpoint;
+    int16_t           _last;      // the last measurement
+    int32_t           _dstate;    // the filtered difference, << _dfilter
+    int32_t           _integral;  // Q16.15
+    volatile int16_t  _output;
+};
+
+#endif
@@ -0,0 +1,23 @@
+/* FrequencyMeter - print the frequency of the signal on PIN_PA2 once a second.
+ * From a few Hz up to several MHz; below 10 kHz the period is timed as well, so the reading has decimals that mean
+ * something. For the count to be accurate, the RTC should be running from a 32.768 kHz crystal - the internal
+ * oscillator it uses otherwise is only good to a few percent.
+ */
+#include <FreqCount.h>
+
+void setup() {
+  Serial.begin(115200);
+  if (!FreqCount.begin(PIN_PA2, FREQCOUNT_GATE_1S)) {
+    Serial.println("No event channel for the pin, or the PIT is in use");
+  }
+}
+
+void loop() {
+  if (FreqCount.available()) {
+    uint32_t edges = FreqCount.read();
+    Serial.print(FreqCount.hertz(), 3);
+    Serial.print(" Hz (");
+    Serial.print(edges);
+    Serial.println(" edges counted)");
+  }
+}
@@ -0,0 +1,212 @@
+/* FreqCount.cpp - see FreqCount.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The ISRs are weak, like InputCapture's: if something else in the sketch has the same vector, theirs wins, and
+ * FreqCount won't work - Supervisor's PIT ISR, for one, which begin() checks for as well.
+ */
+
+#include "FreqCount.h"
+
+FreqCountClass FreqCount;
+
+#if MEGATINYCORE_SERIES == 2
+  #define FREQCOUNT_EVCTRL (TCA_SINGLE_CNTAEI_bm | TCA_SINGLE_EVACTA_CNT_POSEDGE_gc)
+#else
+  #define FREQCOUNT_EVCTRL (TCA_SINGLE_CNTEI_bm  | TCA_SINGLE_EVACT_POSEDGE_gc)
+#endif
+
+bool FreqCountClass::begin(uint8_t pin, uint8_t gate) {
+  end();
+  if (RTC.PITCTRLA & RTC_PITEN_bm) {
+    return false;   // somebody else has the PIT
+  }
+  Event &channel = Event::assign_generator_pin(pin);
+  if (channel.get_channel_number() == 255) {
+    return false;   // not a pin, or no channel left that can take it.
+  }
+  // The PIT runs from the RTC's clock, which is 32.768 kHz unless it has been set to the 1.024 kHz one.
+  _rtc_hz   = (RTC.CLKSEL == RTC_CLKSEL_INT1K_gc) ? 1024 : 32768;
+  gate     &= RTC_PERIOD_gm;
+  if (gate < RTC_PERIOD_CYC4_gc) {
+    gate    = FREQCOUNT_GATE_1S;    // RTC_PERIOD_OFF_gc, or nonsense
+  }
+  _cycles   = 1UL << ((gate >> RTC_PERIOD_gp) + 1);
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    // Counts per gate for which the periods are measured: from a little over the slowest the TCB can time without
+    // wrapping at F_CPU/2, to FREQCOUNT_PERIOD_BELOW.
+    _period_min = (uint32_t)((F_CPU / 2 / 65536 * 5 / 4 + 1) * _cycles / _rtc_hz) + 1;
+    _period_max = (uint32_t)(FREQCOUNT_PERIOD_BELOW * _cycles / _rtc_hz);
+  #endif
+  takeOverTCA0();
+  uint8_t oldSREG = SREG;
+  cli();
+  _overflows  = 0;
+  _last       = 0;
+  _gates      = 0;
+  _available  = false;
+  _count      = 0;
+  TCA0.SINGLE.CTRLB    = 0;                   // normal mode, no outputs
+  TCA0.SINGLE.PER      = 0xFFFF;
+  TCA0.SINGLE.CNT      = 0;
+  TCA0.SINGLE.EVCTRL   = FREQCOUNT_EVCTRL;
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+  TCA0.SINGLE.INTCTRL  = TCA_SINGLE_OVF_bm;
+  TCA0.SINGLE.CTRLA    = TCA_SINGLE_ENABLE_bm;   // counts events, not the clock, with CNTEI set
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    _sum            = 0;
+    _captures       = 0;
+    _last_sum       = 0;
+    _last_captures  = 0;
+    FREQCOUNT_TCB.CTRLA    = 0;
+    FREQCOUNT_TCB.CTRLB    = TCB_CNTMODE_FRQ_gc;
+    FREQCOUNT_TCB.EVCTRL   = TCB_CAPTEI_bm;
+    FREQCOUNT_TCB.INTCTRL  = 0;               // only while the frequency is in range, see _gate()
+    FREQCOUNT_TCB.INTFLAGS = TCB_CAPT_bm;
+    FREQCOUNT_TCB.CTRLA    = TCB_CLKSEL_DIV2_gc | TCB_ENABLE_bm;
+  #endif
+  SREG = oldSREG;
+  while (RTC.PITSTATUS);
+  RTC.PITINTFLAGS = RTC_PI_bm;
+  RTC.PITINTCTRL  = RTC_PI_bm;
+  RTC.PITCTRLA    = gate | RTC_PITEN_bm;
+  channel.set_user(user::tca0);
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    channel.set_user(Event::user_from_peripheral(FREQCOUNT_TCB));
+  #endif
+  channel.start();
+  return true;
+}
+
+void FreqCountClass::end() {
+  if (!_cycles) {
+    return;
+  }
+  while (RTC.PITSTATUS);
+  RTC.PITCTRLA    = 0;
+  RTC.PITINTCTRL  = 0;
+  RTC.PITINTFLAGS = RTC_PI_bm;
+  uint8_t oldSREG = SREG;
+  cli();
+  TCA0.SINGLE.CTRLA    = 0;
+  TCA0.SINGLE.INTCTRL  = 0;
+  TCA0.SINGLE.EVCTRL   = 0;
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    FREQCOUNT_TCB.CTRLA    = 0;
+    FREQCOUNT_TCB.INTCTRL  = 0;
+    FREQCOUNT_TCB.EVCTRL   = 0;
+    FREQCOUNT_TCB.INTFLAGS = TCB_CAPT_bm;
+  #endif
+  _cycles    = 0;
+  _available = false;
+  SREG = oldSREG;
+  // TCA0 stays taken over - analogWrite() won't use it again. The channel is left running, as something else may be
+  // using the pin's event.
+  Event::clear_user(user::tca0);
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    Event::clear_user(Event::user_from_peripheral(FREQCOUNT_TCB));
+  #endif
+}
+
+uint32_t FreqCountClass::read() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t count = _count;
+  _available = false;
+  SREG = oldSREG;
+  return count;
+}
+
+float FreqCountClass::hertz() {
+  if (!_cycles) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t count    = _count;
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    uint32_t sum      = _last_sum;
+    uint32_t captures = _last_captures;
+  #endif
+  _available = false;
+  SREG = oldSREG;
+  float counted = (float) count * _rtc_hz / _cycles;
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    if (captures && sum) {
+      float timed = (float) captures * (F_CPU / 2) / sum;
+      // The two should agree to within an edge per gate, give or take the accuracy of the clocks: if they don't,
+      // the input was changing, or the TCB wrapped on a period too long for it, and the count is the safer answer.
+      float tolerance = counted / 8 + 2.0 * _rtc_hz / _cycles;
+      if (timed > counted - tolerance && timed < counted + tolerance) {
+        return timed;
+      }
+    }
+  #endif
+  return counted;
+}
+
+/* End of a gate. Nothing else at this priority can run in between, so TCA0's overflow flag being set means an
+ * overflow not yet added to _overflows - and the count read before looking at the flag may be from before or after
+ * it, so it's read again. */
+void FreqCountClass::_gate() {
+  RTC.PITINTFLAGS = RTC_PI_bm;
+  uint16_t low  = TCA0.SINGLE.CNT;
+  uint16_t high = _overflows;
+  if (TCA0.SINGLE.INTFLAGS & TCA_SINGLE_OVF_bm) {
+    low  = TCA0.SINGLE.CNT;
+    high++;
+  }
+  uint32_t total = ((uint32_t) high << 16) | low;
+  uint32_t count = total - _last;
+  _last = total;
+  if (_gates < 2) {
+    _gates++;       // the first gate started when the PIT's prescaler said so, not when we did
+  }
+  if (_gates == 2) {
+    _count     = count;
+    _available = true;
+  }
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    _last_sum       = _sum;
+    _last_captures  = _captures;
+    _sum            = 0;
+    _captures       = 0;
+    if (count >= _period_min && count <= _period_max) {
+      if (!FREQCOUNT_TCB.INTCTRL) {
+        _skip = true;
+        FREQCOUNT_TCB.INTFLAGS = TCB_CAPT_bm;
+        FREQCOUNT_TCB.INTCTRL  = TCB_CAPT_bm;
+      }
+    } else {
+      FREQCOUNT_TCB.INTCTRL = 0;
+    }
+  #endif
+}
+
+void FreqCountClass::_capture() {
+  #if !defined(FREQCOUNT_NO_PERIOD)
+    uint16_t period = FREQCOUNT_TCB.CCMP;   // reading CCMP clears the CAPT flag
+    if (_skip) {
+      _skip = false;
+      return;
+    }
+    _sum += period;
+    _captures++;
+  #endif
+}
+
+ISR(RTC_PIT_vect, __attribute__((weak))) {
+  FreqCount._gate();
+}
+
+ISR(TCA0_OVF_vect, __attribute__((weak))) {
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+  FreqCount._overflow();
+}
+
+#if !defined(FREQCOUNT_NO_PERIOD)
+  ISR(FREQCOUNT_TCB_vect, __attribute__((weak))) {
+    FreqCount._capture();
+  }
+#endif
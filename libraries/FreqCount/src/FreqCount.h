@@ -0,0 +1,88 @@
+/* FreqCount.h - frequency counter: TCA0 counts the edges on a pin through the event system, gated by the RTC's PIT
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The pin's event goes to TCA0's count input, so the edges are counted by the hardware, with no interrupt per edge -
+ * TCA0's overflow interrupt adds 65536 to the count once every 65536 of them. The PIT interrupt at the end of each
+ * gate is the only other one: it reads the count and works out how many edges there were since the last. Counting
+ * resolves one edge per gate, which is poor at low frequencies, so below FREQCOUNT_PERIOD_BELOW a TCB also measures
+ * the periods in FRQ mode, on the same event, and hertz() uses their average instead. See README.md.
+ */
+#ifndef FREQCOUNT_H
+#define FREQCOUNT_H
+
+#include <Arduino.h>
+#include <Event.h>
+
+#if defined(MILLIS_USE_TIMERA0)
+  #error "FreqCount uses TCA0 to count the edges, so millis has to be on a TCB, the RTC, or disabled"
+#endif
+
+/* The TCB for period measurement: TCB1 if there is one and millis isn't on it, since tone() uses TCB0 - the same as
+ * the core's PIN_EVENT_TCB. Define FREQCOUNT_NO_PERIOD to count edges only, and leave the TCB for something else. */
+#if !defined(FREQCOUNT_NO_PERIOD)
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define FREQCOUNT_TCB      TCB1
+    #define FREQCOUNT_TCB_vect TCB1_INT_vect
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define FREQCOUNT_TCB      TCB0
+    #define FREQCOUNT_TCB_vect TCB0_INT_vect
+  #else
+    #define FREQCOUNT_NO_PERIOD
+  #endif
+#endif
+
+/* Below this many Hz, periods are measured as well as edges counted. Each edge is then an interrupt, so this is also
+ * a limit on how much of the CPU it takes. */
+#if !defined(FREQCOUNT_PERIOD_BELOW)
+  #define FREQCOUNT_PERIOD_BELOW (10000UL)
+#endif
+
+/* Gate lengths, in RTC clocks: with the 32.768 kHz clock, FREQCOUNT_GATE_1S is one second, and each step down halves
+ * it. With the 1.024 kHz one, they are 32 times as long. */
+#define FREQCOUNT_GATE_1S     (RTC_PERIOD_CYC32768_gc)
+#define FREQCOUNT_GATE_500MS  (RTC_PERIOD_CYC16384_gc)
+#define FREQCOUNT_GATE_250MS  (RTC_PERIOD_CYC8192_gc)
+#define FREQCOUNT_GATE_125MS  (RTC_PERIOD_CYC4096_gc)
+#define FREQCOUNT_GATE_62MS   (RTC_PERIOD_CYC2048_gc)
+
+class FreqCountClass {
+  public:
+    /* Returns false if there's no event channel left that can take the pin, or if something else has the PIT. */
+    bool     begin(uint8_t pin, uint8_t gate = FREQCOUNT_GATE_1S);
+    void     end();
+    bool     available() {     // true once per gate, when there's a new reading
+      return _available;
+    }
+    uint32_t read();           // edges counted in the last gate; clears available()
+    float    hertz();          // the last gate's frequency, from the periods when they were measured
+    float    gateSeconds() {
+      return (float) _cycles / _rtc_hz;
+    }
+    void     _gate();          // called from the ISRs
+    void     _capture();
+    void     _overflow() {
+      _overflows++;
+    }
+  private:
+    uint32_t          _cycles;       // RTC clocks per gate
+    uint16_t          _rtc_hz;
+    volatile uint16_t _overflows;    // the high half of TCA0's count
+    uint32_t          _last;         // the count at the last gate
+    uint8_t           _gates;        // gates since begin(), up to 2 - the first has no start to measure from
+    volatile bool     _available;
+    volatile uint32_t _count;
+    #if !defined(FREQCOUNT_NO_PERIOD)
+      uint32_t          _period_min;   // the range of counts per gate that periods are measured for
+      uint32_t          _period_max;
+      bool              _skip;         // the first capture after the TCB is enabled isn't a whole period
+      uint32_t          _sum;          // TCB clocks in the periods captured in this gate
+      uint32_t          _captures;
+      volatile uint32_t _last_sum;     // and in the last one
+      volatile uint32_t _last_captures;
+    #endif
+};
+
+extern FreqCountClass FreqCount;
+
+#endif
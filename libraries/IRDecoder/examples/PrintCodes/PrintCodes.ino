@@ -0,0 +1,29 @@
+/* PrintCodes - print the codes from any NEC, Sony or RC5 remote control.
+ * Connect the output of a 38 kHz IR receiver module (TSOP38238, VS1838B...) to PA2, and power it from Vcc.
+ */
+#include <IRDecoder.h>
+
+IRDecoder ir(TCB1);     // TCB0 on parts that only have the one - and millis not on it
+
+void setup() {
+  Serial.begin(115200);
+  if (!ir.begin(PIN_PA2)) {
+    Serial.println("Can't use TCB1, or no event channel for the pin");
+  }
+}
+
+void loop() {
+  IRCode code;
+  if (ir.decode(code)) {
+    static const char *names[] = {"?", "NEC", "Sony", "RC5"};
+    Serial.print(names[code.protocol]);
+    Serial.print(" address 0x");
+    Serial.print(code.address, HEX);
+    Serial.print(" command 0x");
+    Serial.print(code.command, HEX);
+    if (code.repeat) {
+      Serial.print(" (repeat)");
+    }
+    Serial.println();
+  }
+}
@@ -0,0 +1,317 @@
+/* IRDecoder.cpp - see IRDecoder.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The receiver's output is low during a mark (a burst of carrier) and high for a space. The timings, in us:
+ *   NEC:  9000 mark, 4500 space, then 32 bits LSB first, each a 560 mark and a 560 (0) or 1690 (1) space, and a 560
+ *         stop mark. A key held down sends 9000 mark, 2250 space, 560 mark every 108 ms.
+ *   Sony: 2400 mark, then 12, 15 or 20 bits LSB first, each a 600 space and a 600 (0) or 1200 (1) mark. Nothing marks
+ *         the end, so it's the next space being longer than 600 - or, after the last frame, no edge for 5 ms.
+ *   RC5:  14 bits MSB first, Manchester coded at 889 per half bit: a 1 is space then mark, a 0 mark then space. The
+ *         first bit is always 1, and the space before it is the idle line, so the first edge is the end of an 889
+ *         mark. A 0 at the end doesn't end with an edge, but it's the only thing a 14th bit starting with a mark can be.
+ * The ISRs are weak, the same as InputCapture's, so if something else (millis, tone, Servo) has that TCB, theirs wins.
+ */
+
+#include "IRDecoder.h"
+
+#define IR_IDLE         (0)
+#define IR_NEC_LEADER   (1)   // had the 9000 mark, waiting for the space
+#define IR_NEC_MARK     (2)   // waiting for a bit's mark, or the stop mark after 32 bits
+#define IR_NEC_SPACE    (3)
+#define IR_NEC_REPEAT   (4)   // had the 2250 space, waiting for the stop mark
+#define IR_SONY_SPACE   (5)
+#define IR_SONY_MARK    (6)
+#define IR_RC5          (7)
+
+#define IR_CLKSEL_TCA   (0x04)  // CLKSEL for TCA0's clock - named TCB_CLKSEL_CLKTCA_gc or TCB_CLKSEL_TCA0_gc by series
+
+#if defined(TCB1)
+  static IRDecoder *_ir_owner[2];
+#else
+  static IRDecoder *_ir_owner[1];
+#endif
+
+/* Within a quarter, plus 100 us - the receivers stretch marks and shorten spaces by up to about that. */
+static bool _near(uint16_t us, uint16_t target) {
+  uint16_t slack = (target >> 2) + 100;
+  return us >= target - slack && us <= target + slack;
+}
+
+bool IRDecoder::begin(uint8_t pin) {
+  uint8_t tcbnum = 0;
+  user::user_t usr = user::tcb0_capt;
+  if (_timer != &TCB0) {
+    #if defined(TCB1)
+      if (_timer != &TCB1) {
+        return false;
+      }
+      tcbnum = 1;
+      usr    = user::tcb1_capt;
+    #else
+      return false;
+    #endif
+  }
+  #if defined(MILLIS_USE_TIMERB0)
+    if (tcbnum == 0) {
+      return false;
+    }
+  #elif defined(MILLIS_USE_TIMERB1)
+    if (tcbnum == 1) {
+      return false;
+    }
+  #endif
+  Event &channel = Event::assign_generator_pin(pin);
+  if (channel.get_channel_number() == 255) {
+    return false;   // not a pin, or no channel left that can take it.
+  }
+  end();
+  static const uint8_t tca_shift[8] = {0, 1, 2, 3, 4, 6, 8, 10};
+  uint8_t  shift = tca_shift[(TCA0.SINGLE.CTRLA & TCA_SINGLE_CLKSEL_gm) >> TCA_SINGLE_CLKSEL_gp];
+  _mult       = (uint32_t)((256.0 * 1000000.0 / F_CPU) * (1 << shift) + 0.5);
+  uint32_t longest = 5120000UL / _mult;            // 20 ms - so the product always fits
+  _long_ticks = (longest > 0xFFFF) ? 0xFFFF : longest;
+  _user       = usr;
+  _state      = IR_IDLE;
+  _toggle     = 0xFF;
+  _ready      = false;
+  _nec_last.protocol = IR_NONE;
+  pinMode(pin, INPUT_PULLUP);       // the receivers' outputs are open collector with a weak pullup, or none
+  uint8_t oldSREG = SREG;
+  cli();
+  _ir_owner[tcbnum] = this;
+  _last_ms          = millis();
+  _timer->CTRLA     = 0;
+  _timer->CTRLB     = TCB_CNTMODE_FRQ_gc;
+  // Capture the end of whatever the line is doing now: a falling edge if it's idle, as it should be.
+  _timer->EVCTRL    = TCB_CAPTEI_bm | TCB_FILTER_bm | (digitalRead(pin) ? TCB_EDGE_bm : 0);
+  _timer->CNT       = 0;
+  _timer->INTFLAGS  = TCB_CAPT_bm;
+  _timer->INTCTRL   = TCB_CAPT_bm;
+  _timer->CTRLA     = IR_CLKSEL_TCA | TCB_ENABLE_bm;
+  SREG = oldSREG;
+  channel.set_user(usr);
+  channel.start();
+  return true;
+}
+
+void IRDecoder::end() {
+  uint8_t tcbnum = (_timer == &TCB0) ? 0 : 1;
+  if (_ir_owner[tcbnum] != this) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _timer->CTRLA     = 0;
+  _timer->INTCTRL   = 0;
+  _timer->EVCTRL    = 0;
+  _timer->INTFLAGS  = TCB_CAPT_bm;
+  _ir_owner[tcbnum] = NULL;
+  SREG = oldSREG;
+  Event::clear_user(_user); // the channel is left running - something else may be using that pin's event.
+}
+
+bool IRDecoder::decode(IRCode &code) {
+  bool got = false;
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_state != IR_IDLE && millis() - _last_ms > 5) {
+    if (_state == IR_SONY_SPACE) {
+      _sonyEnd();
+    }
+    _state = IR_IDLE;   // anything else that's gone quiet that long was noise, or cut short
+  }
+  if (_ready) {
+    code   = _code;
+    _ready = false;
+    got    = true;
+  }
+  SREG = oldSREG;
+  return got;
+}
+
+void IRDecoder::_edge() {
+  uint16_t ticks  = _timer->CCMP;             // reading CCMP clears the CAPT flag
+  uint8_t  evctrl = _timer->EVCTRL;
+  _timer->EVCTRL  = evctrl ^ TCB_EDGE_bm;     // next, the opposite edge
+  bool     mark   = !(evctrl & TCB_EDGE_bm);  // a rising edge ends a mark
+  uint32_t now    = millis();
+  uint16_t us     = 0xFFFF;                   // longer than anything we care about
+  if (now - _last_ms < 20 && ticks <= _long_ticks) {  // the count wraps on a long idle; millis doesn't
+    us = ((uint32_t) ticks * _mult) >> 8;
+  }
+  _last_ms = now;
+  _level(us, mark);
+}
+
+void IRDecoder::_level(uint16_t us, bool mark) {
+  switch (_state) {
+    case IR_IDLE:
+      if (!mark) {
+        return;
+      }
+      _bits = 0;
+      _data = 0;
+      if (_near(us, 9000)) {
+        _state = IR_NEC_LEADER;
+      } else if (_near(us, 2400)) {
+        _state = IR_SONY_SPACE;
+      } else if (_near(us, 889)) {
+        _state      = IR_RC5;
+        _half       = 1;
+        _first_mark = false;        // the idle line was the first half of the first bit
+        _rc5Half(true);
+      }
+      return;
+    case IR_NEC_LEADER:
+      if (_near(us, 4500)) {
+        _state = IR_NEC_MARK;
+      } else if (_near(us, 2250)) {
+        _state = IR_NEC_REPEAT;
+      } else {
+        _state = IR_IDLE;
+      }
+      return;
+    case IR_NEC_MARK:
+      if (mark && _near(us, 560)) {
+        if (_bits == 32) {
+          _emit(IR_NEC, 32, _data);
+          _state = IR_IDLE;
+        } else {
+          _state = IR_NEC_SPACE;
+        }
+        return;
+      }
+      break;
+    case IR_NEC_SPACE:
+      if (_near(us, 560) || _near(us, 1690)) {
+        if (us > 1000) {
+          _data |= 1UL << _bits;
+        }
+        _bits++;
+        _state = IR_NEC_MARK;
+        return;
+      }
+      break;
+    case IR_NEC_REPEAT:
+      if (mark && _near(us, 560) && _nec_last.protocol == IR_NEC) {
+        _code        = _nec_last;
+        _code.repeat = true;
+        _ready       = true;
+      }
+      _state = IR_IDLE;
+      return;
+    case IR_SONY_SPACE:
+      if (_near(us, 600)) {
+        _state = IR_SONY_MARK;
+      } else {
+        if (us > 1000) {
+          _sonyEnd();               // the gap before the next frame
+        }
+        _state = IR_IDLE;
+      }
+      return;
+    case IR_SONY_MARK:
+      if (_near(us, 600) || _near(us, 1200)) {   // 800 to 850 is both; call it a 0
+        if (us > 850) {
+          _data |= 1UL << _bits;
+        }
+        if (++_bits > 20) {
+          _state = IR_IDLE;
+        } else {
+          _state = IR_SONY_SPACE;
+        }
+        return;
+      }
+      break;
+    case IR_RC5:
+      if (_near(us, 889)) {
+        _rc5Half(mark);
+      } else if (_near(us, 1778)) {
+        _rc5Half(mark);
+        if (_state == IR_RC5) {
+          _rc5Half(mark);
+        }
+      } else {
+        break;
+      }
+      if (_state == IR_RC5 && _bits == 13 && _half && _first_mark) {
+        _data <<= 1;                // the last bit starts with a mark, so it's a 0
+        _emit(IR_RC5, 14, _data);
+        _state = IR_IDLE;
+      }
+      return;
+  }
+  // Not what this protocol should have come next - but it might be the start of something.
+  _state = IR_IDLE;
+  _level(us, mark);
+}
+
+void IRDecoder::_rc5Half(bool mark) {
+  if (!_half) {
+    _first_mark = mark;
+    _half       = 1;
+    return;
+  }
+  if (_first_mark == mark) {
+    _state = IR_IDLE;               // no transition in the middle of the bit - not Manchester
+    return;
+  }
+  _half = 0;
+  _data = (_data << 1) | mark;      // space then mark is a 1
+  if (++_bits == 14) {
+    _emit(IR_RC5, 14, _data);
+    _state = IR_IDLE;
+  }
+}
+
+void IRDecoder::_sonyEnd() {
+  if (_bits == 12 || _bits == 15 || _bits == 20) {
+    _emit(IR_SONY, _bits, _data);
+  }
+}
+
+void IRDecoder::_emit(uint8_t protocol, uint8_t bits, uint32_t raw) {
+  _code.protocol = protocol;
+  _code.bits     = bits;
+  _code.raw      = raw;
+  _code.repeat   = false;
+  if (protocol == IR_NEC) {
+    uint8_t low  = raw;
+    uint8_t high = raw >> 8;
+    _code.address = (high == (uint8_t) ~low) ? low : (raw & 0xFFFF);  // extended NEC has no inverted address
+    _code.command = raw >> 16;
+    _nec_last     = _code;
+  } else if (protocol == IR_SONY) {
+    _code.command = raw & 0x7F;
+    _code.address = raw >> 7;
+  } else {
+    if ((raw & 0x3000) != 0x3000) {
+      return;                       // both start bits have to be 1 (RC5X is not supported)
+    }
+    uint8_t toggle = (raw >> 11) & 1;
+    _code.repeat  = (toggle == _toggle);
+    _toggle       = toggle;
+    _code.address = (raw >> 6) & 0x1F;
+    _code.command = raw & 0x3F;
+  }
+  _ready = true;
+}
+
+ISR(TCB0_INT_vect, __attribute__((weak))) {
+  if (_ir_owner[0]) {
+    _ir_owner[0]->_edge();
+  } else {
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+  }
+}
+
+#if defined(TCB1)
+  ISR(TCB1_INT_vect, __attribute__((weak))) {
+    if (_ir_owner[1]) {
+      _ir_owner[1]->_edge();
+    } else {
+      TCB1.INTFLAGS = TCB_CAPT_bm;
+    }
+  }
+#endif
@@ -0,0 +1,66 @@
+/* IRDecoder.h - infrared remote control receiver, timing the pulses with a TCB instead of sampling the pin
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The output of an IR receiver module (TSOP38238 and the like) goes to a TCB's capture input through the event
+ * system. The TCB is in frequency measurement mode, which captures and restarts the count on an edge, and the ISR
+ * flips EDGE after each capture, so every capture is the length of the mark or space that just ended. There's one
+ * interrupt per edge, so with no IR about, there are none at all. The ISR feeds each length to the state machines for
+ * NEC, Sony SIRC and RC5, which are told apart by the first mark. See README.md.
+ */
+#ifndef IRDECODER_H
+#define IRDECODER_H
+
+#include <Arduino.h>
+#include <Event.h>
+
+#if defined(MILLIS_USE_TIMERNONE)
+  #error "IRDecoder needs millis, to tell when a Sony code has ended"
+#endif
+
+#define IR_NONE             (0)
+#define IR_NEC              (1)
+#define IR_SONY             (2)
+#define IR_RC5              (3)
+
+typedef struct {
+  uint8_t  protocol;  // IR_NEC, IR_SONY or IR_RC5
+  uint8_t  bits;      // 32 (NEC), 12, 15 or 20 (Sony), 14 (RC5)
+  bool     repeat;    // NEC repeat code, or RC5 with the same toggle bit as the last one - the key is being held.
+  uint16_t address;   // NEC: 8 bits, or 16 for extended NEC; Sony: 5, 8 or 13; RC5: 5
+  uint8_t  command;   // NEC: 8 bits; Sony: 7; RC5: 6
+  uint32_t raw;       // all the bits, in the order they were sent, the first in bit 0 - except RC5, first in the MSB
+} IRCode;
+
+class IRDecoder {
+  public:
+    IRDecoder(TCB_t &timer) : _timer(&timer) {}
+    /* False if the timer is millis's, or the pin can't be an event generator or has no channel left. The TCB is
+     * clocked from TCA0, so that has to be running - as it is unless it's been taken over and stopped. */
+    bool     begin(uint8_t pin);
+    void     end();
+    /* True, once, for each code received. Call often enough to catch the end of Sony codes - every few ms. */
+    bool     decode(IRCode &code);
+    void     _edge();         // called from the ISR
+  private:
+    void     _level(uint16_t us, bool mark);
+    void     _emit(uint8_t protocol, uint8_t bits, uint32_t raw);
+    void     _sonyEnd();
+    void     _rc5Half(bool mark);
+    TCB_t            *_timer;
+    user::user_t      _user;
+    uint32_t          _mult;          // us = ticks * _mult >> 8
+    uint16_t          _long_ticks;    // anything longer is just long
+    uint8_t           _state;
+    uint8_t           _bits;
+    uint8_t           _half;          // RC5: whether there's a first half waiting for its second
+    bool              _first_mark;    // and what it was
+    uint8_t           _toggle;        // RC5: the toggle bit of the last code, or 0xFF at first
+    uint32_t          _data;
+    volatile uint32_t _last_ms;       // millis() at the last edge
+    volatile bool     _ready;
+    IRCode            _code;          // the last complete code
+    IRCode            _nec_last;      // the last NEC code, for repeats
+};
+
+#endif
@@ -0,0 +1,34 @@
+/* PulseWidth - measure the high time of pulses on PIN_PA2 (an RC receiver or servo signal, for example),
+ * without the interrupt latency that attachInterrupt() and micros() would add to every measurement.
+ * The TCB is clocked from CLK_PER/2, so pulses up to 65535 * 2 clocks long can be measured (6.5 ms at 20 MHz).
+ */
+#include <InputCapture.h>
+
+#if defined(TCB1)
+  InputCapture capture(TCB1);
+#else
+  InputCapture capture(TCB0);
+#endif
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(PIN_PA2, INPUT);
+  if (!capture.begin(PIN_PA2, CAPTURE_PULSE_HIGH | CAPTURE_FILTER, CAPTURE_CLK_DIV2)) {
+    Serial.println("Timer or pin not available");
+  }
+}
+
+void loop() {
+  while (capture.available()) {
+    uint16_t ticks = capture.read();
+    Serial.print(ticks);
+    Serial.print(" ticks, ");
+    Serial.print(capture.toMicros(ticks));
+    Serial.println(" us");
+  }
+  uint8_t lost = capture.overruns();
+  if (lost) {
+    Serial.print(lost);
+    Serial.println(" pulses lost");
+  }
+}
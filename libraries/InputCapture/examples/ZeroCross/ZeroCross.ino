@@ -0,0 +1,41 @@
+/* ZeroCross - timestamp the upward zero crossings of an AC signal with the analog comparator and a TCB,
+ * and print the line frequency. tinyAVR 1-series or 2-series (the 0-series has no DACREF).
+ * The signal goes, divided down and biased to mid-supply, to AINP0 (PA7); DACREF is the negative input.
+ * With VDD = 5 V, the reference at 4.3 V (1-series) or 4.096 V (2-series) and DACREF 128, the midpoint is about
+ * 2.1 V; window() adds about 0.1 V of hysteresis either side of it.
+ */
+#include <InputCapture.h>
+#include <Comparator.h>
+
+#if defined(TCB1)
+  InputCapture capture(TCB1);
+#else
+  InputCapture capture(TCB0);
+#endif
+
+void setup() {
+  Serial.begin(115200);
+  Comparator.input_p    = in_p::in0;
+  Comparator.input_n    = in_n::dacref;
+  #if MEGATINYCORE_SERIES == 2
+    Comparator.reference = ref::vref_4v096;
+  #else
+    Comparator.reference = ref::vref_4v3;
+  #endif
+  Comparator.dacref     = 128;
+  Comparator.hysteresis = hyst::large;
+  Comparator.init();
+  Comparator.start();
+  Comparator.window(122, 134);
+  // TCA0's clock, prescaled by 64 by default - 3.2 us per tick at 20 MHz, so 20 ms is 6250 ticks.
+  if (!capture.begin(gen::ac0_out, CAPTURE_PERIOD, CAPTURE_CLK_TCA)) {
+    Serial.println("Timer or event channel not available");
+  }
+}
+
+void loop() {
+  while (capture.available()) {
+    Serial.print(capture.toHertz(capture.read()), 2);
+    Serial.println(" Hz");
+  }
+}
@@ -0,0 +1,191 @@
+/* InputCapture.cpp - see InputCapture.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The TCB ISRs are weak, the same as the ones for Serial.onFrame(), so if something else (millis, tone, Servo)
+ * has claimed that TCB, theirs wins - you can't use the same TCB for two things anyway.
+ */
+
+#include "InputCapture.h"
+
+#if defined(TCB1)
+  static InputCapture *_capture_owner[2];
+#else
+  static InputCapture *_capture_owner[1];
+#endif
+
+bool InputCapture::begin(uint8_t pin, uint8_t mode, uint8_t clock) {
+  return _begin(Event::assign_generator_pin(pin), mode, clock);
+}
+
+bool InputCapture::begin(gen::generator_t generator, uint8_t mode, uint8_t clock) {
+  if (generator == (gen::generator_t) -1) {
+    return false;   // what gen_from_peripheral() gives for a generator that isn't in gen::
+  }
+  return _begin(Event::assign_generator(generator), mode, clock);
+}
+
+bool InputCapture::_begin(Event &channel, uint8_t mode, uint8_t clock) {
+  uint8_t tcbnum = 0;
+  user::user_t usr = user::tcb0_capt;
+  if (_timer != &TCB0) {
+    #if defined(TCB1)
+      if (_timer != &TCB1) {
+        return false;
+      }
+      tcbnum = 1;
+      usr    = user::tcb1_capt;
+    #else
+      return false;
+    #endif
+  }
+  #if defined(MILLIS_USE_TIMERB0)
+    if (tcbnum == 0) {
+      return false;
+    }
+  #elif defined(MILLIS_USE_TIMERB1)
+    if (tcbnum == 1) {
+      return false;
+    }
+  #endif
+  if (channel.get_channel_number() == 255) {
+    return false;   // not a pin, or no channel left that can take it.
+  }
+  end();
+  _user  = usr;
+  _clock = clock & TCB_CLKSEL_gm;
+  uint8_t oldSREG = SREG;
+  cli();
+  _capture_owner[tcbnum] = this;
+  _head                  = 0;
+  _tail                  = 0;
+  _overruns              = 0;
+  _timer->CTRLA          = 0;
+  _timer->CTRLB          = mode & TCB_CNTMODE_gm;
+  _timer->EVCTRL         = (mode & (TCB_EDGE_bm | TCB_FILTER_bm)) | TCB_CAPTEI_bm;
+  _timer->CNT            = 0;
+  _timer->INTFLAGS       = TCB_CAPT_bm;
+  _timer->INTCTRL        = TCB_CAPT_bm;
+  _timer->CTRLA          = _clock | TCB_ENABLE_bm;
+  SREG = oldSREG;
+  channel.set_user(usr);
+  channel.start();
+  return true;
+}
+
+void InputCapture::end() {
+  uint8_t tcbnum = (_timer == &TCB0) ? 0 : 1;
+  if (_capture_owner[tcbnum] != this) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _timer->CTRLA          = 0;
+  _timer->INTCTRL        = 0;
+  _timer->EVCTRL         = 0;
+  _timer->INTFLAGS       = TCB_CAPT_bm;
+  _capture_owner[tcbnum] = NULL;
+  SREG = oldSREG;
+  Event::clear_user(_user); // the channel is left running - something else may be using that pin's event.
+}
+
+uint8_t InputCapture::available() {
+  return (uint8_t)(_head - _tail) & (CAPTURE_BUFFER_SIZE - 1);
+}
+
+uint16_t InputCapture::peek() {
+  uint8_t tail = _tail;
+  if (tail == _head) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli(); // the ISR might be writing the slot after this one, but never this one - the copy just needs to be atomic
+  uint16_t value = _buffer[tail];
+  SREG = oldSREG;
+  return value;
+}
+
+uint16_t InputCapture::read() {
+  uint8_t tail = _tail;
+  if (tail == _head) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t value = _buffer[tail];
+  _tail = (tail + 1) & (CAPTURE_BUFFER_SIZE - 1);
+  SREG = oldSREG;
+  return value;
+}
+
+void InputCapture::flush() {
+  _tail = _head;
+}
+
+uint8_t InputCapture::overruns() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t count = _overruns;
+  _overruns = 0;
+  SREG = oldSREG;
+  return count;
+}
+
+uint16_t InputCapture::now() {
+  uint8_t oldSREG = SREG;
+  cli(); // CNT is read through TEMP, which the ISR's read of CCMP uses too.
+  uint16_t count = _timer->CNT;
+  SREG = oldSREG;
+  return count;
+}
+
+uint8_t InputCapture::_shift() {
+  if (_clock == CAPTURE_CLK_TCA) {
+    static const uint8_t tca_shift[8] = {0, 1, 2, 3, 4, 6, 8, 10};
+    return tca_shift[(TCA0.SINGLE.CTRLA & TCA_SINGLE_CLKSEL_gm) >> TCA_SINGLE_CLKSEL_gp];
+  }
+  return _clock >> 1;           // 0 for DIV1, 1 for DIV2
+}
+
+uint32_t InputCapture::toMicros(uint16_t ticks) {
+  return ((uint32_t) ticks << _shift()) / (F_CPU / 1000000UL);
+}
+
+float InputCapture::toHertz(uint16_t ticks) {
+  if (!ticks) {
+    return 0;
+  }
+  return (float)(F_CPU >> _shift()) / ticks;
+}
+
+void InputCapture::_capture() {
+  uint16_t value = _timer->CCMP;  // reading CCMP clears the CAPT flag
+  uint8_t  head  = _head;
+  uint8_t  next  = (head + 1) & (CAPTURE_BUFFER_SIZE - 1);
+  if (next == _tail) {
+    if (_overruns != 255) {
+      _overruns++;
+    }
+  } else {
+    _buffer[head] = value;
+    _head         = next;
+  }
+}
+
+ISR(TCB0_INT_vect, __attribute__((weak))) {
+  if (_capture_owner[0]) {
+    _capture_owner[0]->_capture();
+  } else {
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+  }
+}
+
+#if defined(TCB1)
+  ISR(TCB1_INT_vect, __attribute__((weak))) {
+    if (_capture_owner[1]) {
+      _capture_owner[1]->_capture();
+    } else {
+      TCB1.INTFLAGS = TCB_CAPT_bm;
+    }
+  }
+#endif
@@ -0,0 +1,63 @@
+/* InputCapture.h - timestamp pin edges in hardware, with the event system and a type B timer.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The pin is an event generator, and the TCB's capture input is the user. The timer copies its count to CCMP
+ * when the edge arrives, so the value is the same however long the CPU takes to get to the ISR - which only
+ * has to move it into the ring buffer before the next one arrives. See README.md.
+ */
+#ifndef INPUTCAPTURE_H
+#define INPUTCAPTURE_H
+
+#include <Arduino.h>
+#include <Event.h>
+
+#if !defined(CAPTURE_BUFFER_SIZE)
+  #define CAPTURE_BUFFER_SIZE (8)
+#endif
+#if (CAPTURE_BUFFER_SIZE & (CAPTURE_BUFFER_SIZE - 1)) || CAPTURE_BUFFER_SIZE > 128
+  #error "CAPTURE_BUFFER_SIZE must be a power of 2, and no more than 128"
+#endif
+
+/* mode is the TCB CNTMODE in the low 3 bits, and the EVCTRL EDGE and FILTER bits. */
+#define CAPTURE_RISING      (TCB_CNTMODE_CAPT_gc)                   // timestamp of each rising edge
+#define CAPTURE_FALLING     (TCB_CNTMODE_CAPT_gc | TCB_EDGE_bm)     // timestamp of each falling edge
+#define CAPTURE_PERIOD      (TCB_CNTMODE_FRQ_gc)                    // time from one rising edge to the next
+#define CAPTURE_PULSE_HIGH  (TCB_CNTMODE_PW_gc)                     // time from rising edge to falling edge
+#define CAPTURE_PULSE_LOW   (TCB_CNTMODE_PW_gc | TCB_EDGE_bm)       // time from falling edge to rising edge
+#define CAPTURE_FILTER      (TCB_FILTER_bm)  // OR with the mode: the input has to be stable for 4 timer clocks.
+
+/* These are the CLKSEL values, which are the same on all tinyAVR parts even though the enum names aren't. */
+#define CAPTURE_CLK_DIV1    (0x00)
+#define CAPTURE_CLK_DIV2    (0x02)
+#define CAPTURE_CLK_TCA     (0x04)  // whatever TCA0 is prescaled to - this is how to time things longer than 65535 clocks.
+
+class InputCapture {
+  public:
+    InputCapture(TCB_t &timer) : _timer(&timer) {}
+    bool     begin(uint8_t pin, uint8_t mode = CAPTURE_RISING, uint8_t clock = CAPTURE_CLK_DIV1);
+    /* Any event generator instead of a pin - Event::gen_from_peripheral(AC0) for the comparator output, say. */
+    bool     begin(gen::generator_t generator, uint8_t mode = CAPTURE_RISING, uint8_t clock = CAPTURE_CLK_DIV1);
+    void     end();
+    uint8_t  available();
+    uint16_t read();       // oldest capture, in timer ticks - or 0 if there isn't one.
+    uint16_t peek();
+    void     flush();
+    uint8_t  overruns();   // captures lost because the buffer was full since the last call; saturates at 255.
+    uint16_t now();        // current timer count, to compare CAPTURE_RISING/FALLING timestamps with.
+    uint32_t toMicros(uint16_t ticks);
+    float    toHertz(uint16_t ticks);  // for CAPTURE_PERIOD: the frequency that's one period of ticks.
+    void     _capture();   // called from the ISR
+  private:
+    bool     _begin(Event &channel, uint8_t mode, uint8_t clock);
+    uint8_t  _shift();
+    TCB_t            *_timer;
+    user::user_t      _user;
+    uint8_t           _clock;
+    volatile uint8_t  _head;
+    volatile uint8_t  _tail;
+    volatile uint8_t  _overruns;
+    volatile uint16_t _buffer[CAPTURE_BUFFER_SIZE];
+};
+
+#endif
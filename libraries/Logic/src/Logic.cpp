@@ -2,10 +2,12 @@
 // *INDENT-OFF* // This file was lovingly hand indented, thankyouverymuch!
 // Array for storing ISR function pointers
 #if defined(CCL_CCL_vect)
-  #if defined(TRUTH5)
+  #if defined(CCL_TRUTH5)
     static volatile voidFuncPtr intFuncCCL[6];
+    static uint8_t              deferCCL[6];    // DEFERRED, DEFERRED_LOW or 0 - from the mode
   #else
     static volatile voidFuncPtr intFuncCCL[4];
+    static uint8_t              deferCCL[4];
   #endif
 #endif
 
@@ -459,9 +461,9 @@ void Logic::init() {
       block.PORT_ALT_OUT.DIRSET = block.output_bm;
     }
   }
-  // Set inputs modes
-  block.LUTCTRLB = (input1 << CCL_INSEL1_gp) | (input0 << CCL_INSEL0_gp);
-  block.LUTCTRLC = (input2 << CCL_INSEL2_gp);
+  // Set inputs modes - in::input leaves the pin setup flags in the high nibble
+  block.LUTCTRLB = ((input1 & 0x0F) << CCL_INSEL1_gp) | ((input0 & 0x0F) << CCL_INSEL0_gp);
+  block.LUTCTRLC = ((input2 & 0x0F) << CCL_INSEL2_gp);
 
   // Set truth table
   block.TRUTH = truth;
@@ -484,11 +486,63 @@ void Logic::init() {
                    | (enable ? CCL_ENABLE_bm : 0);
 }
 
+void Logic::setTruth(uint8_t truth_table) {
+  truth = truth_table;
+  block.TRUTH = truth_table;
+}
+
+void Logic::setInput(uint8_t n, in::input_t input) {
+  if (n == 0) {
+    input0 = input;
+    initInput(input0, block.PORT_IN, block.input0_bm);
+    protectedWrite(block.LUTCTRLB, CCL_INSEL0_gm, (input0 & 0x0F) << CCL_INSEL0_gp);
+  } else if (n == 1) {
+    input1 = input;
+    initInput(input1, block.PORT_IN, block.input1_bm);
+    protectedWrite(block.LUTCTRLB, CCL_INSEL1_gm, (input1 & 0x0F) << CCL_INSEL1_gp);
+  } else if (n == 2) {
+    input2 = input;
+    initInput(input2, block.PORT_IN, block.input2_bm);
+    protectedWrite(block.LUTCTRLC, CCL_INSEL2_gm, (input2 & 0x0F) << CCL_INSEL2_gp);
+  }
+}
+
+void Logic::setFilter(filter::filter_t filter_mode) {
+  filter = filter_mode;
+  protectedWrite(block.LUTCTRLA, CCL_FILTSEL_gm, filter_mode << CCL_FILTSEL_gp);
+}
+
+/* Both levels of enable protection: the LUT is disabled for the write (and LUTnCTRLA is only ever changed with
+ * ENABLE 0 before and after), and so is the whole CCL. The other LUTs stop for that long - a dozen clocks or so -
+ * and their outputs fall back to the PORT value meanwhile; there's no way around that on any current silicon. */
+void Logic::protectedWrite(volatile register8_t &reg, uint8_t mask, uint8_t value) {
+  uint8_t newval = (reg & ~mask) | value;
+  if (newval == reg) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t ctrla    = CCL.CTRLA;
+  uint8_t lutctrla = block.LUTCTRLA;
+  CCL.CTRLA        = 0;
+  block.LUTCTRLA   = lutctrla & ~CCL_ENABLE_bm;
+  if (&reg == &block.LUTCTRLA) {
+    lutctrla       = newval;
+    block.LUTCTRLA = newval & ~CCL_ENABLE_bm;
+  } else {
+    reg            = newval;
+  }
+  block.LUTCTRLA   = lutctrla;
+  CCL.CTRLA        = ctrla;
+  SREG = oldSREG;
+}
+
 
 #if defined(CCL_CCL_vect)
 void Logic::attachInterrupt(void (*userFunc)(void), uint8_t mode) {
   CCL_INTMODE0_t intmode;
-  switch (mode) { // Set RISING, FALLING or CHANGE interrupt trigger for a block output
+  uint8_t deferred = mode & DEFERRED_LOW;
+  switch (mode & ~DEFERRED_LOW) { // Set RISING, FALLING or CHANGE interrupt trigger for a block output
     case RISING:
       intmode = CCL_INTMODE0_RISING_gc;
       break;
@@ -515,6 +569,7 @@ void Logic::attachInterrupt(void (*userFunc)(void), uint8_t mode) {
   #endif
   // Store function pointer
   intFuncCCL[block.number] = userFunc;
+  deferCCL[block.number]   = deferred;
 }
 
 void Logic::detachInterrupt() {
@@ -531,54 +586,16 @@ void Logic::detachInterrupt() {
 }
 
 // CCL interrupt service routine
-// Use attachIntterupt to activate this.
-ISR(CCL_CCL_vect) {
-  // Check for block 0 interrupt
-  if (CCL.INTFLAGS & CCL_INT0_bm) {
-    // Run user function
-    intFuncCCL[CCL_INT0_bp]();
-    // Clear flag
-    CCL.INTFLAGS |= CCL_INT0_bm;
-  }
-  // Check for block 1 interrupt
-  if (CCL.INTFLAGS & CCL_INT1_bm) {
-    // Run user function
-    intFuncCCL[CCL_INT1_bp]();
-    // Clear flag
-    CCL.INTFLAGS |= CCL_INT1_bm;
-  }
-  // Check for block 2 interrupt
-  if (CCL.INTFLAGS & CCL_INT2_bm) {
-    // Run user function
-    intFuncCCL[CCL_INT2_bp]();
-    // Clear flag
-    CCL.INTFLAGS |= CCL_INT2_bm;
-  }
-  // Check for block 3 interrupt
-  if (CCL.INTFLAGS & CCL_INT3_bm) {
-    // Run user function
-    intFuncCCL[CCL_INT3_bp]();
-    // Clear flag
-    CCL.INTFLAGS |= CCL_INT3_bm;
-  }
-  #if defined(TRUTH4)
-  // Check for block 4 interrupt
-  if (CCL.INTFLAGS & CCL_INT4_bm) {
-    // Run user function
-    intFuncCCL[CCL_INT4_bp]();
-    // Clear flag
-    CCL.INTFLAGS |= CCL_INT4_bm;
-  }
-  #endif
-  #if defined(TRUTH5)
-  // Check for block 5 interrupt
-  if (CCL.INTFLAGS & CCL_INT5_bm) {
-    // Run user function
-    intFuncCCL[CCL_INT5_bp]();
-    // Clear flag
-    CCL.INTFLAGS |= CCL_INT5_bm;
+// Use attachIntterupt to activate this. It's weak, so LOGIC_ISR_BLOCK() or LOGIC_ISR_FLAGS() in the sketch replace it.
+ISR(CCL_CCL_vect, __attribute__((weak))) {
+  uint8_t flags = CCL.INTFLAGS;
+  // Clear only the ones being handled; one that's set while the callbacks run brings us straight back here.
+  CCL.INTFLAGS = flags;
+  for (uint8_t n = 0; flags; n++, flags >>= 1) {
+    if ((flags & 1) && intFuncCCL[n]) {
+      _deferOrCallVoid(intFuncCCL[n], deferCCL[n]);
+    }
   }
-  #endif // CCL_CCL_vect
 }
 
 #endif
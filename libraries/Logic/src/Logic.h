@@ -2,6 +2,9 @@
 #define LOGIC_h
 
 #include <Arduino.h>
+#if defined(MEGATINYCORE)
+  #include "sfr_writes.h"
+#endif
 
 namespace in {
   enum input_t : uint8_t {
@@ -220,8 +223,15 @@ class Logic {
 
     Logic(const uint8_t block_number);
     void init();
+    /* Change one setting of a block that's running, and update the property to match. The truth table can be
+     * written while the CCL is enabled, so setTruth() disturbs nothing. The others are enable-protected and, by the
+     * erratum, need the whole CCL off, so they turn it off for the few clocks the write takes, with interrupts
+     * disabled, and back on - and do nothing at all if the register wouldn't change. */
+    void setTruth(uint8_t truth_table);
+    void setInput(uint8_t n, in::input_t input);                 // n is 0, 1 or 2
+    void setFilter(filter::filter_t filter_mode);
     #if defined(CCL_CCL_vect)
-    void attachInterrupt(voidFuncPtr callback, uint8_t mode);
+    void attachInterrupt(voidFuncPtr callback, uint8_t mode);   // mode | DEFERRED to run it from deferDispatch()
     void detachInterrupt();
     #endif
 
@@ -239,10 +249,67 @@ class Logic {
 
     struct CCLBlock;
 
+    #if defined(MEGATINYCORE)
+      /* Compile-time setup - the same register values init() would work out for one block, as a table for
+       * SFR_STARTUP() (see sfr_writes.h), with no Logic object involved. The pins aren't included; in::input and
+       * in::input_pullup are the same as in::pin here, and sfr_pin_input()/sfr_pin_output() set the pins up.
+       * Logic::config_start() is CCL.CTRLA, for the end of the table. */
+      template <uint8_t block,
+                in::input_t input0, in::input_t input1, in::input_t input2, uint8_t truth,
+                out::output_t output                = out::disable,
+                out::pinswap_t output_swap          = out::no_swap,
+                filter::filter_t filter             = filter::disable,
+                edgedetect::edgedet_t edgedetect    = edgedetect::disable,
+                sequencer::sequencer_t sequencer    = sequencer::disable,
+                clocksource::clocksource_t clocksource = clocksource::clk_per,
+                bool enable = true>
+      static constexpr auto config() {
+        constexpr bool seq  = !(block & 0x01) && sequencer;
+        constexpr bool swap = output && output_swap;
+        sfr_table<5 + seq + swap> table{};
+        uint8_t n = 0;
+        table.writes[n++] = sfr::store(_config_lut(block, offsetof(CCL_t, LUT0CTRLA)), 0);
+        table.writes[n++] = sfr::store(_config_lut(block, offsetof(CCL_t, LUT0CTRLB)),
+                                     ((input1 & 0x0F) << CCL_INSEL1_gp) | ((input0 & 0x0F) << CCL_INSEL0_gp));
+        table.writes[n++] = sfr::store(_config_lut(block, offsetof(CCL_t, LUT0CTRLC)), (input2 & 0x0F) << CCL_INSEL2_gp);
+        table.writes[n++] = sfr::store(_config_lut(block, offsetof(CCL_t, TRUTH0)), truth);
+        if (seq) {
+          table.writes[n++] = sfr::store(sfr::ccl + offsetof(CCL_t, SEQCTRL0) + (block >> 1), sequencer);
+        }
+        if (swap) {
+          #if MEGATINYCORE_SERIES == 2
+            table.writes[n++] = sfr::modify(sfr::portmux + offsetof(PORTMUX_t, CCLROUTEA), 1 << block, 0xFF);
+          #else
+            table.writes[n++] = sfr::modify(sfr::portmux + offsetof(PORTMUX_t, CTRLA), 1 << (block + 4), 0xFF);
+          #endif
+        }
+        table.writes[n++] = sfr::store(_config_lut(block, offsetof(CCL_t, LUT0CTRLA)),
+                                     (output ? CCL_OUTEN_bm : 0)
+                                     | (edgedetect ? CCL_EDGEDET_EN_gc : 0)
+                                     | (filter << CCL_FILTSEL_gp)
+                                     #ifdef CCL_CLKSRC_gp
+                                     | (clocksource << CCL_CLKSRC_gp)
+                                     #else
+                                     | (clocksource ? CCL_CLKSRC_bm : 0)
+                                     #endif
+                                     | (enable ? CCL_ENABLE_bm : 0));
+        return table;
+      }
+      static constexpr sfr_table<1> config_start(bool state = true) {
+        return {{sfr::store(sfr::ccl + offsetof(CCL_t, CTRLA), state ? CCL_ENABLE_bm : 0)}};
+      }
+    #endif
+
   private:
+    #if defined(MEGATINYCORE)
+      static constexpr uint16_t _config_lut(uint8_t block, uint8_t reg) { // LUTnCTRLA, B, C and TRUTHn; 4 per block
+        return sfr::ccl + reg + block * 4;
+      }
+    #endif
     const struct CCLBlock &block;
 
     void initInput(in::input_t &input, PORT_t &port, const uint8_t pin_bm);
+    void protectedWrite(volatile register8_t &reg, uint8_t mask, uint8_t value);
 };
 
 #if defined(CCL_TRUTH0)
@@ -264,4 +331,35 @@ class Logic {
   extern Logic Logic5;
 #endif
 
+#if defined(CCL_CCL_vect)
+/* The CCL has one interrupt vector for every block, and the ISR in Logic.cpp finds out which ones fired and calls
+ * their attachInterrupt() callbacks through pointers - so it has to save every register a function call could use.
+ * When that latency matters, put one of these in the sketch instead; the ISR in Logic.cpp is weak, and this replaces
+ * it. The body is inlined into the ISR. Set the trigger with LogicN.attachInterrupt(NULL, mode).
+ *
+ *   LOGIC_ISR_BLOCK(0) {       // only block 0 has its interrupt on. Its flag is already cleared.
+ *     VPORTA.OUT |= 1 << 7;
+ *   }
+ *   LOGIC_ISR_FLAGS(flags) {   // any number of them; flags is INTFLAGS, already cleared - CCL_INTn_bm for block n.
+ *     if (flags & CCL_INT2_bm) { ... }
+ *   }
+ */
+#define LOGIC_ISR_BLOCK(n)                                                      \
+  static inline void _logic_isr_block(void) __attribute__((always_inline));    \
+  ISR(CCL_CCL_vect) {                                                           \
+    CCL.INTFLAGS = CCL_INT##n##_bm;                                             \
+    _logic_isr_block();                                                         \
+  }                                                                             \
+  static inline void _logic_isr_block(void)
+
+#define LOGIC_ISR_FLAGS(flags)                                                  \
+  static inline void _logic_isr_flags(uint8_t) __attribute__((always_inline)); \
+  ISR(CCL_CCL_vect) {                                                           \
+    uint8_t _flags = CCL.INTFLAGS;                                              \
+    CCL.INTFLAGS = _flags;                                                      \
+    _logic_isr_flags(_flags);                                                   \
+  }                                                                             \
+  static inline void _logic_isr_flags(uint8_t flags)
+#endif
+
 #endif
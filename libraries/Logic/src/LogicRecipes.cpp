@@ -0,0 +1,209 @@
+#include "LogicRecipes.h"
+// *INDENT-OFF*
+#if defined(MEGATINYCORE)
+#include <Event.h>
+
+int8_t LogicRecipes::blockNumber(Logic &block) {
+  #if defined(CCL_TRUTH0)
+    if (&block == &Logic0) {
+      return 0;
+    }
+  #endif
+  #if defined(CCL_TRUTH1)
+    if (&block == &Logic1) {
+      return 1;
+    }
+  #endif
+  #if defined(CCL_TRUTH2)
+    if (&block == &Logic2) {
+      return 2;
+    }
+  #endif
+  #if defined(CCL_TRUTH3)
+    if (&block == &Logic3) {
+      return 3;
+    }
+  #endif
+  return -1;
+}
+
+// The event user that is event input A (or B) of a block.
+static user::user_t lutEvent(uint8_t block, bool b) {
+  #if MEGATINYCORE_SERIES == 2
+    return (user::user_t)(user::ccl0_event_a + block * 2 + b);
+  #else
+    return (user::user_t)(user::ccl0_event_a + block + (b ? 2 : 0));
+  #endif
+}
+
+// Connect a pin to an event user, through a channel that has, or can take, that pin.
+static bool routePin(uint8_t pin, user::user_t event_user) {
+  Event &channel = Event::assign_generator_pin(pin);
+  if (channel.get_channel_number() == 255) {
+    return false;
+  }
+  channel.set_user(event_user);
+  channel.start();
+  return true;
+}
+
+// Which LUT input (0 or 1) can have this TCB's WO, and what to select there; -1 if it can't be used.
+static int8_t tcbInput(TCB_t &timer, in::input_t &insel, user::user_t &event_user) {
+  #if defined(MILLIS_USE_TIMERB0)
+    if (&timer == &TCB0) {
+      return -1;
+    }
+  #elif defined(MILLIS_USE_TIMERB1)
+    if (&timer == &TCB1) {
+      return -1;
+    }
+  #endif
+  if (&timer == &TCB0) {
+    event_user = user::tcb0_capt;
+    #if MEGATINYCORE_SERIES == 2
+      insel = in::tcb;                  // on IN0 it's TCB0, on IN1 TCB1.
+      return 0;
+    #else
+      insel = in::tcb0;
+      return 1;
+    #endif
+  }
+  #if defined(TCB1)
+    if (&timer == &TCB1) {
+      event_user = user::tcb1_capt;
+      #if MEGATINYCORE_SERIES == 2
+        insel = in::tcb;
+      #else
+        insel = in::tcb1;
+      #endif
+      return 1;
+    }
+  #endif
+  return -1;
+}
+
+// Single-shot, started by the event, high for ticks; WO is what the LUT sees.
+static void oneShot(TCB_t &timer, uint16_t ticks, bool anyEdge) {
+  timer.CTRLA   = 0;
+  timer.CTRLB   = TCB_CNTMODE_SINGLE_gc | TCB_CCMPEN_bm;
+  timer.EVCTRL  = TCB_CAPTEI_bm | (anyEdge ? TCB_EDGE_bm : 0);
+  timer.INTCTRL = 0;
+  timer.CCMP    = ticks;
+  timer.CNT     = ticks;                // at TOP - stopped, and low, until the first edge.
+  timer.CTRLA   = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;
+}
+
+bool LogicRecipes::glitchFilter(Logic &block, in::input_t input, clocksource::clocksource_t clock) {
+  if (blockNumber(block) < 0) {
+    return false;
+  }
+  uint8_t was = CCL.CTRLA;
+  Logic::stop();
+  block.enable      = true;
+  block.input0      = input;
+  block.input1      = in::masked;
+  block.input2      = in::masked;
+  block.truth       = 0xAA;             // IN0
+  block.filter      = filter::filter;
+  block.clocksource = clock;
+  block.edgedetect  = edgedetect::disable;
+  block.sequencer   = sequencer::disable;
+  block.output      = out::enable;
+  block.init();
+  CCL.CTRLA = was;
+  return true;
+}
+
+bool LogicRecipes::pulseStretch(Logic &block, uint8_t pin, TCB_t &timer, uint16_t ticks) {
+  int8_t n = blockNumber(block);
+  in::input_t    tcb_insel = in::masked;
+  user::user_t   tcb_user  = user::tcb0_capt;
+  int8_t slot = tcbInput(timer, tcb_insel, tcb_user);
+  if (n < 0 || slot < 0 || !routePin(pin, lutEvent(n, 0)) || !routePin(pin, tcb_user)) {
+    return false;                       // the second routePin() uses the same channel as the first.
+  }
+  oneShot(timer, ticks, false);
+  uint8_t was = CCL.CTRLA;
+  Logic::stop();
+  block.enable      = true;
+  block.input0      = slot ? in::event_a : tcb_insel;
+  block.input1      = slot ? tcb_insel   : in::event_a;
+  block.input2      = in::masked;
+  block.truth       = 0x0E;             // IN0 | IN1
+  block.filter      = filter::disable;
+  block.clocksource = clocksource::clk_per;
+  block.edgedetect  = edgedetect::disable;
+  block.sequencer   = sequencer::disable;
+  block.output      = out::enable;
+  block.init();
+  CCL.CTRLA = was;
+  return true;
+}
+
+// The even block of a pair gets D on event A, the odd one G, either on event A or a TCB input. The flip-flop is
+// clocked by CLK_PER, and loads D on every clock G is high - so G goes through the edge detector, and is one clock long.
+static void latchPair(Logic &even, Logic &odd, in::input_t g0, in::input_t g1, uint8_t g_truth, out::output_t output) {
+  uint8_t was = CCL.CTRLA;
+  Logic::stop();
+  even.enable       = true;
+  even.input0       = in::event_a;
+  even.input1       = in::masked;
+  even.input2       = in::masked;
+  even.truth        = 0xAA;             // IN0
+  even.filter       = filter::synchronizer;
+  even.clocksource  = clocksource::clk_per;
+  even.edgedetect   = edgedetect::disable;
+  even.sequencer    = sequencer::d_flip_flop;
+  even.output       = output;
+  odd.enable        = true;
+  odd.input0        = g0;
+  odd.input1        = g1;
+  odd.input2        = in::masked;
+  odd.truth         = g_truth;
+  odd.filter        = filter::synchronizer;
+  odd.clocksource   = clocksource::clk_per;
+  odd.edgedetect    = edgedetect::enable;
+  odd.sequencer     = sequencer::disable;
+  odd.output        = output;
+  odd.init();
+  even.init();
+  CCL.CTRLA = was;
+}
+
+static Logic *oddOf(int8_t n) {
+  #if defined(CCL_TRUTH3)
+    if (n == 2) {
+      return &Logic3;
+    }
+  #endif
+  return n == 0 ? &Logic1 : NULL;
+}
+
+bool LogicRecipes::quadrature(Logic &even, uint8_t pinA, uint8_t pinB, out::output_t output) {
+  int8_t n = blockNumber(even);
+  if (n < 0 || (n & 1) || !routePin(pinB, lutEvent(n, 0)) || !routePin(pinA, lutEvent(n + 1, 0))) {
+    return false;
+  }
+  latchPair(even, *oddOf(n), in::event_a, in::masked, 0xAA, output);
+  return true;
+}
+
+bool LogicRecipes::manchester(Logic &even, uint8_t pin, TCB_t &timer, uint16_t bitTicks, out::output_t output) {
+  #if MEGATINYCORE_SERIES == 2
+    int8_t n = blockNumber(even);
+    in::input_t    tcb_insel = in::masked;
+    user::user_t   tcb_user  = user::tcb0_capt;
+    int8_t slot = tcbInput(timer, tcb_insel, tcb_user);
+    if (n < 0 || (n & 1) || slot < 0 || !routePin(pin, lutEvent(n, 0)) || !routePin(pin, tcb_user)) {
+      return false;
+    }
+    oneShot(timer, (uint16_t)(((uint32_t) bitTicks * 3) >> 2), true);
+    // The TCB output, on IN0 (TCB0) or IN1 (TCB1). It starts a few clocks after the data changes, so D is settled.
+    latchPair(even, *oddOf(n), slot ? in::masked : tcb_insel, slot ? tcb_insel : in::masked, slot ? 0xCC : 0xAA, output);
+    return true;
+  #else
+    (void) even; (void) pin; (void) timer; (void) bitTicks; (void) output;
+    return false;
+  #endif
+}
+#endif
@@ -0,0 +1,43 @@
+#ifndef LOGICRECIPES_h
+#define LOGICRECIPES_h
+/* LogicRecipes - ready-made CCL setups for jobs that would otherwise take a pin interrupt per edge.
+ * Part of the Logic library. Each recipe sets up the Logic block(s) it's given through their properties and init(),
+ * routes the pins into them through the Event library, and where it needs a timer, sets up the TCB it's given.
+ * Logic::start() still has to be called afterwards, as for anything else done with this library (and calling them
+ * with the CCL running, it is stopped while the blocks are reconfigured, and started again). They return false if
+ * they can't do it - a block or timer that can't be used for it, or no event channel free for a pin.
+ */
+
+#include "Logic.h"
+
+#if defined(MEGATINYCORE)
+
+class LogicRecipes {
+  public:
+    /* The block's output follows the IN0 pin of that block (see the pin table), through the filter - so a pulse
+       shorter than about 4 periods of the clock is dropped. On the 2-series, osc32k or osc1k as the clock gives a
+       filter of around 100 us or 4 ms, which is enough to debounce a switch. */
+    static bool glitchFilter(Logic &block, in::input_t input = in::input_pullup,
+                             clocksource::clocksource_t clock = clocksource::clk_per);
+    /* The block's output is high while pin is, and for at least ticks CLK_PER cycles after every rising edge - pin
+       OR a TCB one-shot that the rising edge starts. For LEDs that show pulses too short to see. */
+    static bool pulseStretch(Logic &block, uint8_t pin, TCB_t &timer, uint16_t ticks);
+    /* Encoder on pinA and pinB: the odd block of the pair (even + 1) gives a pulse one clock long on each rising
+       edge of A, and the D flip-flop of the pair latches B on it - so the even block's output is the direction, and
+       the odd one's is a step, one per cycle of A. output puts both on the blocks' output pins. For a position that
+       stays right when the encoder jitters back and forth over an edge, use the Encoder library. */
+    static bool quadrature(Logic &even, uint8_t pinA, uint8_t pinB, out::output_t output = out::disable);
+    /* Manchester data on pin at bitTicks CLK_PER cycles per bit. A TCB one-shot started by any edge of it, and 3/4 of
+       a bit long, ignores the transitions between bits and so follows the ones in the middle; the odd block of the pair
+       gives a pulse one clock long on its rising edge, which is the recovered clock. The D flip-flop latches the data on it, so the even
+       block's output is the data, one bit per clock (the level after the mid-bit transition). Needs a preamble of
+       alternating bits to lock on to, as Manchester protocols have. 2-series only - the 0/1-series TCBs can't start a
+       one-shot on both edges. output puts data and clock on the blocks' output pins, for an SPI client or USART. */
+    static bool manchester(Logic &even, uint8_t pin, TCB_t &timer, uint16_t bitTicks, out::output_t output = out::disable);
+
+  private:
+    static int8_t blockNumber(Logic &block);
+};
+
+#endif
+#endif
@@ -0,0 +1,41 @@
+/* Registers - a Modbus RTU server at address 17, on Serial at 115200 baud 8E1, over an RS-485 transceiver.
+ *
+ * Holding registers 0-3: 0 is a PWM duty cycle (0-255) for PIN_PA5, 1 is a blink interval in ms for LED_BUILTIN,
+ *                        2 and 3 are just stored.
+ * Input registers 0-1:   0 is analogRead(PIN_PA6), 1 is millis() / 1000.
+ *
+ * The transceiver's DE and /RE go to the XDIR pin (SERIAL_RS485); if that isn't free, use any pin, with
+ * Serial.setRS485Pin(pin) after begin(). TCB1 finds the end of each request, so it can't be used for millis.
+ */
+#include <ModbusRTU.h>
+
+ModbusRTU modbus(Serial);
+uint16_t holding[4] = {0, 500, 0, 0};
+uint16_t input[2];
+uint32_t lastBlink;
+
+void written(uint16_t index, uint16_t count) {
+  if (index == 0) {                   // the first register written is index, and there are count of them
+    analogWrite(PIN_PA5, holding[0] > 255 ? 255 : holding[0]);
+  }
+  (void) count;
+}
+
+void setup() {
+  pinMode(LED_BUILTIN, OUTPUT);
+  Serial.begin(115200, SERIAL_8E1 | SERIAL_RS485);
+  modbus.holdingRegisters(holding, 4);
+  modbus.inputRegisters(input, 2);
+  modbus.onWrite(written);
+  modbus.begin(17);
+}
+
+void loop() {
+  input[0] = analogRead(PIN_PA6);
+  input[1] = millis() / 1000;
+  modbus.poll();
+  if (millis() - lastBlink >= holding[1]) {
+    lastBlink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  }
+}
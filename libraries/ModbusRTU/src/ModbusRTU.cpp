@@ -0,0 +1,193 @@
+/* ModbusRTU.cpp - see ModbusRTU.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details */
+
+#include "ModbusRTU.h"
+
+#if MODBUS_CRC_TABLE
+  // CRC-16/MODBUS (0xA001 reflected, from 0xFFFF) of each byte value. It's const, so it stays in flash, where the
+  // tinyAVR parts can read it with ld just like RAM.
+  static const uint16_t _modbus_crc_table[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+  };
+
+  uint16_t ModbusRTU::crc16(uint16_t crc, uint8_t data) {
+    return (crc >> 8) ^ _modbus_crc_table[(uint8_t)crc ^ data];
+  }
+#else
+  #include <util/crc16.h>
+
+  uint16_t ModbusRTU::crc16(uint16_t crc, uint8_t data) {
+    return _crc16_update(crc, data);
+  }
+#endif
+
+bool ModbusRTU::begin(uint8_t address, volatile TCB_t *timer, uint8_t gap) {
+  _address = address;
+  return _port.onFrame(timer, gap);
+}
+
+void ModbusRTU::end() {
+  _port.noOnFrame();
+}
+
+/* The end of a request has been seen, so everything in the RX buffer is it (or line noise). It's left there while it
+ * is handled, and only consumed at the end. A request may have been missed if this wasn't called for a long time,
+ * but the master then times out and tries again, as it would for any lost frame. */
+uint8_t ModbusRTU::poll() {
+  if (!_port.frameReady()) {
+    return 0;
+  }
+  uint8_t length = _port.available();          // at most SERIALn_RX_BUFFER_SIZE - 1
+  _first_length  = _port.peekSpan(&_first);
+  if (_first_length > length) {
+    _first_length = length;                     // the next request has already started to come in
+  }
+  _port.peekSpan(&_second, _first_length);
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < _first_length; i++) {
+    crc = crc16(crc, _first[i]);
+  }
+  for (uint8_t i = 0; i < length - _first_length; i++) {
+    crc = crc16(crc, _second[i]);
+  }
+  uint8_t result = 0;
+  if (length < 4 || crc) {                      // the CRC goes on low byte first, so over the whole frame it comes out as 0
+    _crc_errors++;
+  } else if (_at(0) == _address || _at(0) == 0) {
+    _broadcast = !_at(0);
+    result = _handle(length);
+  }
+  _port.consume(length);
+  return result;
+}
+
+uint8_t ModbusRTU::_handle(uint8_t length) {
+  uint8_t  function = _at(1);
+  uint16_t start    = _word(2);
+  uint16_t count    = _word(4);
+  if (function == MODBUS_READ_HOLDING_REGISTERS || function == MODBUS_READ_INPUT_REGISTERS) {
+    const uint16_t *registers = _holding;
+    uint16_t first = _holding_first;
+    uint16_t total = _holding_count;
+    if (function == MODBUS_READ_INPUT_REGISTERS) {
+      registers = _input;
+      first     = _input_first;
+      total     = _input_count;
+    }
+    if (length != 8 || count == 0 || count > 125) {
+      return _exception(MODBUS_ILLEGAL_DATA_VALUE);
+    }
+    if (start < first || count > total || start - first > total - count) {
+      return _exception(MODBUS_ILLEGAL_DATA_ADDRESS);
+    }
+    if (_broadcast) {                           // nobody to send it to
+      return function;
+    }
+    registers += start - first;
+    _begin(2);
+    _put(count << 1);
+    for (uint8_t i = 0; i < count; i++) {
+      _put(registers[i] >> 8);
+      _put(registers[i]);
+    }
+    _end();
+    return function;
+  }
+  if (function == MODBUS_WRITE_SINGLE_REGISTER || function == MODBUS_WRITE_MULTIPLE_REGISTERS) {
+    uint8_t data = 4;                           // where the values start
+    if (function == MODBUS_WRITE_SINGLE_REGISTER) {
+      if (length != 8) {
+        return _exception(MODBUS_ILLEGAL_DATA_VALUE);
+      }
+      count = 1;
+    } else {
+      if (count == 0 || count > 123 || _at(6) != count << 1 || length != 9 + (count << 1)) {
+        return _exception(MODBUS_ILLEGAL_DATA_VALUE);
+      }
+      data = 7;
+    }
+    if (start < _holding_first || count > _holding_count || start - _holding_first > _holding_count - count) {
+      return _exception(MODBUS_ILLEGAL_DATA_ADDRESS);
+    }
+    uint16_t index = start - _holding_first;
+    for (uint8_t i = 0; i < count; i++) {
+      _holding[index + i] = _word(data + (i << 1));
+    }
+    if (_write_callback) {
+      _write_callback(index, count);
+    }
+    if (!_broadcast) {
+      if (function == MODBUS_WRITE_SINGLE_REGISTER) {
+        // the response is the request, CRC and all - which can go straight from the RX buffer to the TX buffer
+        _port.write(_first, _first_length);
+        _port.write(_second, length - _first_length);
+      } else {
+        _begin(6);                              // address, function, start and count, as they came in
+        _end();
+      }
+    }
+    return function;
+  }
+  return _exception(MODBUS_ILLEGAL_FUNCTION);
+}
+
+uint8_t ModbusRTU::_exception(uint8_t code) {
+  uint8_t function = _at(1) | 0x80;
+  if (!_broadcast) {
+    _begin(1);
+    _put(function);
+    _put(code);
+    _end();
+  }
+  return function;
+}
+
+/* Starts a response with the first length bytes of the request. */
+void ModbusRTU::_begin(uint8_t length) {
+  _crc = 0xFFFF;
+  for (uint8_t i = 0; i < length; i++) {
+    _put(_at(i));
+  }
+}
+
+void ModbusRTU::_put(uint8_t c) {
+  _crc = crc16(_crc, c);
+  _port.write(c);
+}
+
+void ModbusRTU::_end() {
+  _port.write((uint8_t)_crc);
+  _port.write((uint8_t)(_crc >> 8));
+}
@@ -0,0 +1,100 @@
+/* ModbusRTU.h - a Modbus RTU server (slave) on a hardware serial port
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The end of each request is found by the port's idle line detection (Serial.onFrame()), on a TCB, so nothing
+ * happens per character but what the RXC ISR does anyway. poll() then checks the CRC and parses the request where
+ * it lies in the RX buffer - peekSpan() gives it the one or two parts of it - and writes the response straight into
+ * the TX buffer as it goes, from the register arrays the sketch supplies: no frame is ever copied. The driver enable
+ * is left to the port: SERIAL_RS485 for XDIR, or setRS485Pin(), which turn the bus round as soon as the last stop
+ * bit has gone. See README.md.
+ */
+#ifndef MODBUSRTU_H
+#define MODBUSRTU_H
+
+#include <Arduino.h>
+
+/* The CRC is worked out a byte at a time from a 512 byte table in flash (about 12 clocks a byte), or where flash is
+ * short, by avr-libc's _crc16_update() (about 60). Define it as 0 or 1 to choose. */
+#if !defined(MODBUS_CRC_TABLE)
+  #if PROGMEM_SIZE > 8192
+    #define MODBUS_CRC_TABLE 1
+  #else
+    #define MODBUS_CRC_TABLE 0
+  #endif
+#endif
+
+#define MODBUS_READ_HOLDING_REGISTERS     (0x03)
+#define MODBUS_READ_INPUT_REGISTERS       (0x04)
+#define MODBUS_WRITE_SINGLE_REGISTER      (0x06)
+#define MODBUS_WRITE_MULTIPLE_REGISTERS   (0x10)
+
+#define MODBUS_ILLEGAL_FUNCTION           (0x01)  // exception codes
+#define MODBUS_ILLEGAL_DATA_ADDRESS       (0x02)
+#define MODBUS_ILLEGAL_DATA_VALUE         (0x03)
+
+class ModbusRTU {
+  public:
+    ModbusRTU(UartClass &port) : _port(port) {}
+    /* After port.begin(); address is 1 to 247. gap is the silence that ends a request, in bit times: 3.5 characters
+     * of 11 bits by default, at any baud rate. The spec recommends 1750 us above 19200 baud - that's 202 at 115200 -
+     * but that's 5 times as long a wait before each response there. False if the timer isn't TCB0 or TCB1. */
+    bool     begin(uint8_t address, volatile TCB_t *timer = &TCB1, uint8_t gap = 39);
+    void     end();
+    /* The registers: Modbus addresses first to first + count - 1, in native byte order (they go on the wire high byte
+     * first, as Modbus wants). Anything outside them gets an illegal data address exception. */
+    void     holdingRegisters(uint16_t *registers, uint16_t count, uint16_t first = 0) {
+      _holding       = registers;
+      _holding_count = count;
+      _holding_first = first;
+    }
+    void     inputRegisters(const uint16_t *registers, uint16_t count, uint16_t first = 0) {
+      _input         = registers;
+      _input_count   = count;
+      _input_first   = first;
+    }
+    /* Called from poll() after the master has written holding registers (by index into the array), before the
+     * response is sent. */
+    void     onWrite(void (*callback)(uint16_t index, uint16_t count)) {
+      _write_callback = callback;
+    }
+    /* Call from loop(). Handles a request if one has come in: returns its function code if it was for us (or a
+     * broadcast), with the high bit set if an exception was sent in reply, or 0. */
+    uint8_t  poll();
+    uint16_t crcErrors() {       // frames that failed the CRC, or were too short to have one
+      return _crc_errors;
+    }
+
+    static uint16_t crc16(uint16_t crc, uint8_t data);
+
+  private:
+    uint8_t  _at(uint8_t i) {    // byte i of the request, from whichever part of the RX buffer it's in
+      return (i < _first_length) ? _first[i] : _second[i - _first_length];
+    }
+    uint16_t _word(uint8_t i) {
+      return (_at(i) << 8) | _at(i + 1);
+    }
+    uint8_t  _handle(uint8_t length);
+    uint8_t  _exception(uint8_t code);
+    void     _begin(uint8_t length);
+    void     _put(uint8_t c);
+    void     _end();
+
+    UartClass      &_port;
+    const uint8_t  *_first;
+    const uint8_t  *_second;
+    uint8_t         _first_length;
+    uint8_t         _address        = 0;
+    bool            _broadcast;
+    uint16_t        _crc;
+    uint16_t       *_holding        = NULL;
+    const uint16_t *_input          = NULL;
+    uint16_t        _holding_count  = 0;
+    uint16_t        _holding_first  = 0;
+    uint16_t        _input_count    = 0;
+    uint16_t        _input_first    = 0;
+    void          (*_write_callback)(uint16_t index, uint16_t count) = NULL;
+    uint16_t        _crc_errors     = 0;
+};
+
+#endif
@@ -0,0 +1,23 @@
+/* CharlieplexChase - 12 LEDs on 4 pins, PA4 to PA7, lit one after another with a tail of three.
+ * Each pair of pins has two LEDs between them, one each way round, and each pin has a resistor (half what a
+ * single LED would get, as there are two in the path) between it and the LEDs.
+ */
+#include <Multiplex.h>
+
+const uint8_t pins[] = {PIN_PA4, PIN_PA5, PIN_PA6, PIN_PA7};
+
+Charlieplex leds(pins, 4);
+
+#define LED_COUNT (4 * 3)
+
+void setup() {
+  leds.begin();
+}
+
+void loop() {
+  for (uint8_t i = 0; i < LED_COUNT; i++) {
+    leds.set(i, true);
+    leds.set((i + LED_COUNT - 3) % LED_COUNT, false);
+    delay(80);
+  }
+}
@@ -0,0 +1,53 @@
+/* KeypadAndDisplay - type a number up to 999 on a 3x4 phone-style keypad, and see it on a 3 digit common cathode
+ * 7-segment display. * clears it, # counts it down to 0, one a second. For a 20-pin part: that's every pin but
+ * UPDI, so no Serial.
+ *
+ * Keypad rows on PC0 to PC3 and columns on PB2, PB3 and PB5; segments a to g on PA1 to PA7 (through resistors),
+ * and the digits' common cathodes on PB0, PB1 and PB4, through NPN transistors - so SEG_DIGIT_HIGH.
+ */
+#include <Multiplex.h>
+
+const uint8_t rows[]     = {PIN_PC0, PIN_PC1, PIN_PC2, PIN_PC3};
+const uint8_t cols[]     = {PIN_PB2, PIN_PB3, PIN_PB5};
+const uint8_t digits[]   = {PIN_PB0, PIN_PB1, PIN_PB4};
+const uint8_t segments[] = {PIN_PA1, PIN_PA2, PIN_PA3, PIN_PA4, PIN_PA5, PIN_PA6, PIN_PA7, NOT_A_PIN};
+
+const char    keymap[]   = "123456789*0#";
+
+MatrixKeypad   keypad(rows, 4, cols, 3);
+SegmentDisplay display(digits, 3, segments, SEG_DIGIT_HIGH);
+
+int16_t  number;
+bool     counting;
+uint32_t last;
+
+void setup() {
+  keypad.begin();
+  display.begin();
+  display.print(0);
+}
+
+void loop() {
+  int16_t key = keypad.read();
+  if (key >= 0 && !(key & KEY_RELEASED)) {
+    char c = keymap[key];
+    if (c == '*') {
+      number   = 0;
+      counting = false;
+    } else if (c == '#') {
+      counting = true;
+      last     = millis();
+    } else if (!counting && number < 100) {
+      number = number * 10 + (c - '0');
+    }
+    display.print(number);
+  }
+  if (counting && millis() - last >= 1000) {
+    last += 1000;
+    if (number) {
+      display.print(--number);
+    } else {
+      counting = false;
+    }
+  }
+}
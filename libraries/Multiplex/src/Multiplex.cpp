@@ -0,0 +1,384 @@
+/* Multiplex.cpp - see Multiplex.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "Multiplex.h"
+
+static MultiplexDevice *_mux_devices;   // a linked list, through _next
+static int8_t           _mux_timer = -1;
+
+static void _mux_tick() {
+  for (MultiplexDevice *dev = _mux_devices; dev; dev = dev->_next) {
+    dev->_tick();
+  }
+}
+
+#define _MUX_PORT(p)  ((PORT_t *)&PORTA + (p))
+
+bool MultiplexDevice::_attach() {
+  if (_attached) {
+    return true;
+  }
+  if (_mux_timer < 0) {
+    _mux_timer = timerAdd(_mux_tick, 1, TIMER_PERIODIC);
+    if (_mux_timer < 0) {
+      return false;
+    }
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _next        = _mux_devices;
+  _mux_devices = this;
+  _attached    = true;
+  SREG = oldSREG;
+  return true;
+}
+
+void MultiplexDevice::_detach() {
+  if (!_attached) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  MultiplexDevice **link = &_mux_devices;
+  while (*link != this) {
+    link = &(*link)->_next;
+  }
+  *link     = _next;
+  _attached = false;
+  SREG = oldSREG;
+  if (!_mux_devices) {
+    timerCancel(_mux_timer);
+    _mux_timer = -1;
+  }
+}
+
+/* Port number and mask of each pin, false if one isn't a pin. NOT_A_PIN is allowed where optional is set, and gets a
+ * mask of 0, so it's left out of everything. */
+static bool _mux_pins(const uint8_t *pins, uint8_t count, uint8_t *port, uint8_t *mask, bool optional) {
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t pin = pins[i];
+    if (pin >= NUM_TOTAL_PINS) {
+      if (optional && pin == NOT_A_PIN) {
+        port[i] = 0;
+        mask[i] = 0;
+        continue;
+      }
+      return false;
+    }
+    port[i] = digitalPinToPort(pin);
+    mask[i] = digitalPinToBitMask(pin);
+  }
+  return true;
+}
+
+/*************
+ * Keypad
+ *************/
+
+bool MatrixKeypad::begin() {
+  if (!_nrows || _nrows > 8 || !_ncols || _ncols > 8 ||
+      !_mux_pins(_row_pins, _nrows, _row_port, _row_mask, false) ||
+      !_mux_pins(_col_pins, _ncols, _col_port, _col_mask, false)) {
+    return false;
+  }
+  end();
+  for (uint8_t i = 0; i < _nrows; i++) {
+    pinMode(_row_pins[i], INPUT);     // a row is only driven (low) during its turn
+    digitalWrite(_row_pins[i], LOW);
+    _state[i]  = 0;
+    _count0[i] = 0xFF;
+    _count1[i] = 0xFF;
+  }
+  for (uint8_t i = 0; i < _ncols; i++) {
+    pinMode(_col_pins[i], INPUT_PULLUP);
+  }
+  _head = 0;
+  _tail = 0;
+  _row  = 0;
+  _MUX_PORT(_row_port[0])->DIRSET = _row_mask[0];
+  return _attach();
+}
+
+void MatrixKeypad::end() {
+  _detach();
+  for (uint8_t i = 0; i < _nrows; i++) {
+    _MUX_PORT(_row_port[i])->DIRCLR = _row_mask[i];
+  }
+}
+
+/* The row being read has been driven since the last tick, so the columns have long since settled; read it, then
+ * move on to the next, to be read next time. */
+void MatrixKeypad::_tick() {
+  uint8_t row = _row;
+  uint8_t raw = 0;
+  for (uint8_t i = 0; i < _ncols; i++) {
+    if (!(_MUX_PORT(_col_port[i])->IN & _col_mask[i])) {
+      raw |= 1 << i;
+    }
+  }
+  _MUX_PORT(_row_port[row])->DIRCLR = _row_mask[row];
+  uint8_t next = (row + 1 == _nrows) ? 0 : row + 1;
+  _MUX_PORT(_row_port[next])->DIRSET = _row_mask[next];
+  _row = next;
+  // A key's state changes after it's read the other way 4 times running; the count goes back to the start when
+  // it reads the same as the state.
+  uint8_t state   = _state[row];
+  uint8_t changed = state ^ raw;
+  uint8_t c0      = ~(_count0[row] & changed);
+  uint8_t c1      = c0 ^ (_count1[row] & changed);
+  _count0[row]    = c0;
+  _count1[row]    = c1;
+  changed        &= c0 & c1;
+  if (changed) {
+    state        ^= changed;
+    _state[row]   = state;
+    uint8_t key   = row * _ncols;
+    for (uint8_t bit = 1; bit; bit <<= 1, key++) {
+      if (changed & bit) {
+        _queue((state & bit) ? key : key | KEY_RELEASED);
+      }
+    }
+  }
+}
+
+void MatrixKeypad::_queue(uint8_t event) {
+  uint8_t head = _head;
+  uint8_t next = (head + 1) & (KEYPAD_QUEUE_SIZE - 1);
+  if (next != _tail) {      // full - drop it
+    _events[head] = event;
+    _head         = next;
+  }
+}
+
+uint8_t MatrixKeypad::available() {
+  return (uint8_t)(_head - _tail) & (KEYPAD_QUEUE_SIZE - 1);
+}
+
+int16_t MatrixKeypad::read() {
+  uint8_t tail = _tail;
+  if (tail == _head) {
+    return -1;
+  }
+  uint8_t event = _events[tail];
+  _tail = (tail + 1) & (KEYPAD_QUEUE_SIZE - 1);
+  return event;
+}
+
+bool MatrixKeypad::pressed(uint8_t key) {
+  uint8_t row = key / _ncols;
+  if (row >= _nrows) {
+    return false;
+  }
+  return _state[row] & (1 << (key - row * _ncols));
+}
+
+/*************
+ * 7-segment
+ *************/
+
+static const uint8_t _seg_font[16] = {
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F, // 0-9
+  0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71                          // A b C d E F
+};
+
+bool SegmentDisplay::begin() {
+  if (!_ndigits || _ndigits > 8 ||
+      !_mux_pins(_digit_pins, _ndigits, _digit_port, _digit_mask, false) ||
+      !_mux_pins(_seg_pins, 8, _seg_port, _seg_mask, true)) {
+    return false;
+  }
+  end();
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {
+    _seg_all[p] = 0;
+  }
+  for (uint8_t i = 0; i < 8; i++) {
+    _seg_all[_seg_port[i]] |= _seg_mask[i];
+  }
+  for (uint8_t i = 0; i < _ndigits; i++) {
+    digitalWrite(_digit_pins[i], (_flags & SEG_DIGIT_HIGH) ? LOW : HIGH);   // off
+    pinMode(_digit_pins[i], OUTPUT);
+  }
+  for (uint8_t i = 0; i < 8; i++) {
+    if (_seg_pins[i] != NOT_A_PIN) {
+      digitalWrite(_seg_pins[i], (_flags & SEG_SEGMENT_LOW) ? HIGH : LOW);
+      pinMode(_seg_pins[i], OUTPUT);
+    }
+  }
+  clear();
+  _digit = 0;
+  return _attach();
+}
+
+void SegmentDisplay::end() {
+  _detach();
+  for (uint8_t i = 0; i < _ndigits; i++) {
+    digitalWrite(_digit_pins[i], (_flags & SEG_DIGIT_HIGH) ? LOW : HIGH);
+  }
+}
+
+void SegmentDisplay::writeRaw(uint8_t digit, uint8_t segments) {
+  if (digit >= _ndigits) {
+    return;
+  }
+  uint8_t on[MUX_PORTS] = {0};
+  for (uint8_t i = 0; i < 8; i++) {
+    if (segments & (1 << i)) {
+      on[_seg_port[i]] |= _seg_mask[i];
+    }
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {
+    // the bits to OUTSET: the lit segments if they're active high, the dark ones if they're active low
+    _on[digit][p] = (_flags & SEG_SEGMENT_LOW) ? (_seg_all[p] & ~on[p]) : on[p];
+  }
+  SREG = oldSREG;
+}
+
+void SegmentDisplay::writeDigit(uint8_t digit, uint8_t value, bool dp) {
+  writeRaw(digit, _seg_font[value & 0x0F] | (dp ? 0x80 : 0));
+}
+
+void SegmentDisplay::print(int32_t value) {
+  bool     negative = value < 0;
+  uint32_t v        = negative ? -(uint32_t) value : value;
+  int8_t   digit    = _ndigits - 1;
+  do {
+    writeDigit(digit--, v % 10);
+    v /= 10;
+  } while (v && digit >= 0);
+  if (v || (negative && digit < 0)) {
+    for (uint8_t i = 0; i < _ndigits; i++) {
+      writeRaw(i, 0x40);                // doesn't fit
+    }
+    return;
+  }
+  if (negative) {
+    writeRaw(digit--, 0x40);
+  }
+  while (digit >= 0) {
+    writeRaw(digit--, 0);
+  }
+}
+
+void SegmentDisplay::clear() {
+  for (uint8_t i = 0; i < _ndigits; i++) {
+    writeRaw(i, 0);
+  }
+}
+
+void SegmentDisplay::_tick() {
+  uint8_t digit = _digit;
+  PORT_t *d     = _MUX_PORT(_digit_port[digit]);
+  if (_flags & SEG_DIGIT_HIGH) {      // this one off,
+    d->OUTCLR = _digit_mask[digit];
+  } else {
+    d->OUTSET = _digit_mask[digit];
+  }
+  digit = (digit + 1 == _ndigits) ? 0 : digit + 1;
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {   // the next one's segments,
+    uint8_t all = _seg_all[p];
+    if (all) {
+      PORT_t *port = _MUX_PORT(p);
+      uint8_t set  = _on[digit][p];
+      port->OUTCLR = all & ~set;
+      port->OUTSET = set;
+    }
+  }
+  d = _MUX_PORT(_digit_port[digit]);  // and it on.
+  if (_flags & SEG_DIGIT_HIGH) {
+    d->OUTSET = _digit_mask[digit];
+  } else {
+    d->OUTCLR = _digit_mask[digit];
+  }
+  _digit = digit;
+}
+
+/*************
+ * Charlieplex
+ *************/
+
+bool Charlieplex::begin() {
+  if (_npins < 2 || _npins > 8 || !_mux_pins(_pins, _npins, _port, _mask, false)) {
+    return false;
+  }
+  end();
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {
+    _all[p] = 0;
+  }
+  for (uint8_t i = 0; i < _npins; i++) {
+    _all[_port[i]] |= _mask[i];
+    pinMode(_pins[i], INPUT);
+    digitalWrite(_pins[i], LOW);
+  }
+  clear();
+  _anode = 0;
+  return _attach();
+}
+
+void Charlieplex::end() {
+  _detach();
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {
+    if (_all[p]) {
+      _MUX_PORT(p)->DIRCLR = _all[p];
+      _MUX_PORT(p)->OUTCLR = _all[p];
+    }
+  }
+}
+
+void Charlieplex::set(uint8_t high, uint8_t low, bool on) {
+  if (high >= _npins || low >= _npins || high == low) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  if (on) {
+    _low[high][_port[low]] |= _mask[low];
+  } else {
+    _low[high][_port[low]] &= ~_mask[low];
+  }
+  SREG = oldSREG;
+}
+
+void Charlieplex::set(uint8_t led, bool on) {
+  uint8_t high = led / (_npins - 1);
+  uint8_t low  = led - high * (_npins - 1);
+  if (low >= high) {
+    low++;                            // skipping the high pin itself
+  }
+  set(high, low, on);
+}
+
+void Charlieplex::clear() {
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < 8; i++) {
+    for (uint8_t p = 0; p < MUX_PORTS; p++) {
+      _low[i][p] = 0;
+    }
+  }
+  SREG = oldSREG;
+}
+
+/* Everything off - all inputs, all OUT bits low - then the next pin high, and its LEDs' other ends low. */
+void Charlieplex::_tick() {
+  uint8_t anode = (_anode + 1 == _npins) ? 0 : _anode + 1;
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {
+    if (_all[p]) {
+      _MUX_PORT(p)->DIRCLR = _all[p];
+    }
+  }
+  _MUX_PORT(_port[_anode])->OUTCLR = _mask[_anode];
+  PORT_t *a = _MUX_PORT(_port[anode]);
+  a->OUTSET = _mask[anode];
+  a->DIRSET = _mask[anode];
+  for (uint8_t p = 0; p < MUX_PORTS; p++) {
+    uint8_t low = _low[anode][p];
+    if (low) {
+      _MUX_PORT(p)->DIRSET = low;
+    }
+  }
+  _anode = anode;
+}
@@ -0,0 +1,128 @@
+/* Multiplex.h - matrix keypads, multiplexed 7-segment displays and charlieplexed LEDs, refreshed in the background
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Everything here runs from one timer service slot (timerAdd()), once a millisecond: each device does one row or one
+ * digit per tick, so the refresh rate is the same however long loop() takes, and loop() only writes what to show
+ * and reads the keys. The pins are worked out into port numbers and masks once, in begin(), and what the display is
+ * to show into the bits to write to each port when it's written, so the tick is the same few stores every time.
+ * See README.md.
+ */
+#ifndef MULTIPLEX_H
+#define MULTIPLEX_H
+
+#include <Arduino.h>
+
+#if defined(MILLIS_USE_TIMERNONE) || defined(MILLIS_USE_TIMERRTC)
+  #error "Multiplex runs from the timer service, which needs millis on TCA0, a TCB or TCD0"
+#endif
+
+#define MUX_PORTS             (3)     // PORTA, PORTB, PORTC - all a tinyAVR has
+
+#if !defined(KEYPAD_QUEUE_SIZE)
+  #define KEYPAD_QUEUE_SIZE   (8)
+#endif
+#if (KEYPAD_QUEUE_SIZE & (KEYPAD_QUEUE_SIZE - 1)) || KEYPAD_QUEUE_SIZE > 64
+  #error "KEYPAD_QUEUE_SIZE must be a power of 2, and no more than 64"
+#endif
+
+#define KEY_RELEASED          (0x80)  // or'ed into what MatrixKeypad::read() returns for a release
+
+/* SegmentDisplay flags - which level turns a digit or a segment on. */
+#define SEG_COMMON_CATHODE    (0x00)  // digit low, segments high
+#define SEG_COMMON_ANODE      (0x03)  // digit high, segments low
+#define SEG_DIGIT_HIGH        (0x01)  // digit high - as with an NPN low side switch on a common cathode
+#define SEG_SEGMENT_LOW       (0x02)
+
+class MultiplexDevice {
+  public:
+    virtual void     _tick() = 0;    // called from the timer, one row or digit's worth
+    MultiplexDevice *_next;
+  protected:
+    bool             _attach();
+    void             _detach();
+    bool             _attached = false;
+};
+
+class MatrixKeypad : public MultiplexDevice {
+  public:
+    /* Up to 8 rows and 8 columns; the pin arrays have to stay around (const arrays in flash are fine). Key numbers
+     * are row * columns + column. */
+    MatrixKeypad(const uint8_t *rows, uint8_t nrows, const uint8_t *cols, uint8_t ncols) :
+      _row_pins(rows), _col_pins(cols), _nrows(nrows), _ncols(ncols) {}
+    bool     begin();
+    void     end();
+    uint8_t  available();
+    int16_t  read();                  // the next key pressed, or released (| KEY_RELEASED), or -1
+    bool     pressed(uint8_t key);    // whether it's down now, debounced
+    virtual void _tick();
+  private:
+    void     _queue(uint8_t event);
+    const uint8_t    *_row_pins;
+    const uint8_t    *_col_pins;
+    uint8_t           _nrows;
+    uint8_t           _ncols;
+    uint8_t           _row;
+    uint8_t           _row_port[8];
+    uint8_t           _row_mask[8];
+    uint8_t           _col_port[8];
+    uint8_t           _col_mask[8];
+    /* Per row, one bit per column: the debounced state, and a two bit counter for each key, in two bytes - a
+     * "vertical" counter, so all eight keys of a row are counted at once with a handful of logic operations. */
+    volatile uint8_t  _state[8];
+    uint8_t           _count0[8];
+    uint8_t           _count1[8];
+    volatile uint8_t  _head;
+    volatile uint8_t  _tail;
+    volatile uint8_t  _events[KEYPAD_QUEUE_SIZE];
+};
+
+class SegmentDisplay : public MultiplexDevice {
+  public:
+    /* Up to 8 digits, and 8 segment pins in the order a, b, c, d, e, f, g, dp - dp can be NOT_A_PIN. */
+    SegmentDisplay(const uint8_t *digits, uint8_t ndigits, const uint8_t *segments, uint8_t flags = SEG_COMMON_CATHODE) :
+      _digit_pins(digits), _seg_pins(segments), _ndigits(ndigits), _flags(flags) {}
+    bool     begin();
+    void     end();
+    void     writeRaw(uint8_t digit, uint8_t segments);  // bit 0 = a ... bit 7 = dp
+    void     writeDigit(uint8_t digit, uint8_t value, bool dp = false);  // 0-15, as hex
+    void     print(int32_t value);        // right aligned, with a - if negative; all dashes if it doesn't fit
+    void     clear();
+    virtual void _tick();
+  private:
+    const uint8_t    *_digit_pins;
+    const uint8_t    *_seg_pins;
+    uint8_t           _ndigits;
+    uint8_t           _flags;
+    uint8_t           _digit;
+    uint8_t           _digit_port[8];
+    uint8_t           _digit_mask[8];
+    uint8_t           _seg_port[8];
+    uint8_t           _seg_mask[8];
+    uint8_t           _seg_all[MUX_PORTS];   // all the segment pins on each port
+    /* For each digit, the segment pins on each port that are at their on level - worked out by writeRaw(). */
+    volatile uint8_t  _on[8][MUX_PORTS];
+};
+
+class Charlieplex : public MultiplexDevice {
+  public:
+    /* n pins (2 to 8) drive n * (n - 1) LEDs; LED (a, b) is the one lit with pin a high and pin b low. */
+    Charlieplex(const uint8_t *pins, uint8_t npins) : _pins(pins), _npins(npins) {}
+    bool     begin();
+    void     end();
+    void     set(uint8_t high, uint8_t low, bool on);
+    void     set(uint8_t led, bool on);  // led = high * (n - 1) + (low, counting only the pins that aren't high)
+    void     clear();
+    virtual void _tick();
+  private:
+    const uint8_t    *_pins;
+    uint8_t           _npins;
+    uint8_t           _anode;
+    uint8_t           _port[8];
+    uint8_t           _mask[8];
+    uint8_t           _all[MUX_PORTS];
+    /* For each pin as the high one, the pins on each port to drive low - and so to be outputs. */
+    volatile uint8_t  _low[8][MUX_PORTS];
+};
+
+#endif
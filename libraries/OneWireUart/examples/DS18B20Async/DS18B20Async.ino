@@ -0,0 +1,81 @@
+/* DS18B20Async - read every DS18B20 on the bus once a second, without the conversion or the reads holding up loop().
+ * The bus goes on the USART1 TX pin (PA1 on most parts) with a 4.7k pullup to VCC; the sensors can't use parasite
+ * power. On parts without USART1, use USART0, and don't use Serial.
+ */
+#include <OneWireUart.h>
+
+#define MAX_SENSORS 4
+
+OneWireUart bus(USART1);
+uint8_t  roms[MAX_SENSORS][8];
+uint8_t  sensors;
+uint8_t  scratchpad[9];
+uint8_t  current;
+uint8_t  step;
+uint32_t started;
+
+void setup() {
+  Serial.begin(115200);
+  bus.begin();
+  while (sensors < MAX_SENSORS && bus.search(roms[sensors])) {
+    if (roms[sensors][0] == 0x28) {       // DS18B20 family code
+      sensors++;
+    }
+  }
+  Serial.print(sensors);
+  Serial.println(" sensors");
+}
+
+void loop() {
+  static const uint8_t convert[] = {ONEWIRE_SKIP_ROM, 0x44};
+  static uint8_t       readcmd[] = {ONEWIRE_MATCH_ROM, 0, 0, 0, 0, 0, 0, 0, 0, 0xBE};
+  if (bus.busy() || !sensors) {
+    return;                               // a real sketch would be doing its other work here
+  }
+  switch (step) {
+    case 0:                               // every sensor starts converting at once
+      bus.startReset();
+      step = 1;
+      break;
+    case 1:
+      bus.startWrite(convert, sizeof(convert));
+      started = millis();
+      current = 0;
+      step    = 2;
+      break;
+    case 2:
+      if (millis() - started >= 750) {    // 12-bit conversion time
+        bus.startReset();
+        step = 3;
+      }
+      break;
+    case 3:
+      memcpy(&readcmd[1], roms[current], 8);
+      bus.startWrite(readcmd, sizeof(readcmd));
+      step = 4;
+      break;
+    case 4:
+      bus.startRead(scratchpad, 9);
+      step = 5;
+      break;
+    case 5:
+      if (OneWireUart::crc8(scratchpad, 8) == scratchpad[8]) {
+        int16_t raw = scratchpad[0] | (scratchpad[1] << 8);   // 16ths of a degree
+        Serial.print(current);
+        Serial.print(": ");
+        Serial.println(raw / 16.0);
+      }
+      if (++current < sensors) {
+        bus.startReset();
+        step = 3;
+      } else {
+        step = 6;
+      }
+      break;
+    case 6:
+      if (millis() - started >= 1000) {
+        step = 0;
+      }
+      break;
+  }
+}
@@ -0,0 +1,342 @@
+/* OneWireUart.cpp - see OneWireUart.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The RXC ISRs are weak, like InputCapture's TCB ones: if Serial (or Serial1) is used, the core's ISR for that USART
+ * wins - and that USART can't be used for both anyway.
+ *
+ * The USART always runs at double speed (CLK2X), so BAUD is 8 * F_CPU / baud, and 9600 baud still fits in 16 bits at
+ * any clock speed these parts run at, while 115200 stays above the minimum of 64 down to 1 MHz. BAUD is only
+ * changed when nothing is being sent, or in the RXC interrupt for the reset, when all that's left is the second half
+ * of the stop bit, which is high anyway.
+ */
+
+#include "OneWireUart.h"
+
+#define ONEWIRE_BAUD_RESET  ((uint16_t)((8 * F_CPU +  4800) /   9600))
+#define ONEWIRE_BAUD_SLOT   ((uint16_t)((8 * F_CPU + 57600) / 115200))
+
+#define ONEWIRE_IDLE          (0)
+#define ONEWIRE_RESET         (1)
+#define ONEWIRE_BYTES         (2)
+#define ONEWIRE_SEARCH_RESET  (3)
+#define ONEWIRE_SEARCH_CMD    (4)
+#define ONEWIRE_SEARCH        (5)
+
+#if defined(USART1)
+  static OneWireUart *_onewire_owner[2];
+#else
+  static OneWireUart *_onewire_owner[1];
+#endif
+
+bool OneWireUart::begin(uint8_t mux) {
+  uint8_t usartnum = 0;
+  if (_usart != &USART0) {
+    #if defined(USART1)
+      if (_usart != &USART1) {
+        return false;
+      }
+      usartnum = 1;
+    #else
+      return false;
+    #endif
+  }
+  uint8_t row = usartnum + mux;   // the same rows Serial uses - USART1's default pins are USART0's alternate ones
+  if (mux > 1 || row >= sizeof(_usart_pins) / sizeof(_usart_pins[0])) {
+    return false;
+  }
+  end();
+  uint8_t oldSREG = SREG;
+  cli();
+  _onewire_owner[usartnum] = this;
+  #if defined(PORTMUX_USARTROUTEA)
+    PORTMUX.USARTROUTEA = (PORTMUX.USARTROUTEA & ~(usartnum ? 0x0C : 0x03)) | (mux << (usartnum ? 2 : 0));
+  #else
+    if (mux) {
+      PORTMUX.CTRLB |= 0x01;
+    } else {
+      PORTMUX.CTRLB &= 0xFE;
+    }
+  #endif
+  _usart->CTRLB = 0;
+  _usart->CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_CHSIZE_8BIT_gc;
+  _usart->BAUD  = ONEWIRE_BAUD_SLOT;
+  _usart->CTRLA = USART_LBME_bm | USART_RXCIE_bm;
+  _usart->CTRLB = USART_RXEN_bm | USART_TXEN_bm | USART_ODME_bm | USART_RXMODE_CLK2X_gc;
+  SREG = oldSREG;
+  pinMode(_usart_pins[row][0], INPUT_PULLUP);   // as Serial does in open drain mode - the bus needs a real pullup too
+  return true;
+}
+
+void OneWireUart::end() {
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < sizeof(_onewire_owner) / sizeof(_onewire_owner[0]); i++) {
+    if (_onewire_owner[i] == this) {
+      _usart->CTRLB      = 0;
+      _usart->CTRLA      = 0;
+      _onewire_owner[i]  = NULL;
+    }
+  }
+  _state = ONEWIRE_IDLE;
+  SREG = oldSREG;
+}
+
+/* Send the slot for the low bit of _shift: 0xFF (only the start bit low) for a 1 or a read, 0x00 for a 0. */
+void OneWireUart::_slot() {
+  _usart->TXDATAL = (_shift & 1) ? 0xFF : 0x00;
+}
+
+bool OneWireUart::startReset() {
+  if (_state) {
+    return false;
+  }
+  _state          = ONEWIRE_RESET;
+  _usart->BAUD    = ONEWIRE_BAUD_RESET;
+  _usart->TXDATAL = 0xF0;
+  return true;
+}
+
+bool OneWireUart::startWrite(const uint8_t *buffer, uint8_t length) {
+  if (_state || !length) {
+    return false;
+  }
+  _buffer  = (uint8_t *) buffer;
+  _length  = length;
+  _reading = false;
+  _shift   = *buffer;
+  _bits    = 8;
+  _state   = ONEWIRE_BYTES;
+  _slot();
+  return true;
+}
+
+bool OneWireUart::startRead(uint8_t *buffer, uint8_t length) {
+  if (_state || !length) {
+    return false;
+  }
+  _buffer  = buffer;
+  _length  = length;
+  _reading = true;
+  _shift   = 0xFF;
+  _bits    = 8;
+  _state   = ONEWIRE_BYTES;
+  _slot();
+  return true;
+}
+
+bool OneWireUart::startSearch() {
+  if (_state) {
+    return false;
+  }
+  _found = false;
+  if (_last_device) {
+    resetSearch();    // that was all of them - the next call starts over
+    return false;
+  }
+  _command        = ONEWIRE_SEARCH_ROM;
+  _state          = ONEWIRE_SEARCH_RESET;
+  _usart->BAUD    = ONEWIRE_BAUD_RESET;
+  _usart->TXDATAL = 0xF0;
+  return true;
+}
+
+bool OneWireUart::searchResult(uint8_t *rom) {
+  if (_state || !_found) {
+    return false;
+  }
+  memcpy(rom, _rom, 8);
+  return true;
+}
+
+void OneWireUart::resetSearch() {
+  _last_discrepancy = 0;
+  _last_device      = false;
+  _found            = false;
+}
+
+bool OneWireUart::reset() {
+  _wait();
+  startReset();
+  _wait();
+  return _presence;
+}
+
+void OneWireUart::write(uint8_t value) {
+  _wait();
+  _byte = value;
+  startWrite(&_byte, 1);
+  _wait();
+}
+
+void OneWireUart::write(const uint8_t *buffer, uint8_t length) {
+  _wait();
+  startWrite(buffer, length);
+  _wait();
+}
+
+uint8_t OneWireUart::read() {
+  _wait();
+  startRead(&_byte, 1);
+  _wait();
+  return _byte;
+}
+
+void OneWireUart::read(uint8_t *buffer, uint8_t length) {
+  _wait();
+  startRead(buffer, length);
+  _wait();
+}
+
+void OneWireUart::select(const uint8_t *rom) {
+  write(ONEWIRE_MATCH_ROM);
+  write(rom, 8);
+}
+
+void OneWireUart::skip() {
+  write(ONEWIRE_SKIP_ROM);
+}
+
+bool OneWireUart::search(uint8_t *rom) {
+  _wait();
+  if (!startSearch()) {
+    return false;
+  }
+  _wait();
+  return searchResult(rom);
+}
+
+/* The Dallas/Maxim CRC (x^8 + x^5 + x^4 + 1), LSB first - the last byte of a ROM, or of a DS18B20 scratchpad, is the
+ * CRC of the ones before it. */
+uint8_t OneWireUart::crc8(const uint8_t *data, uint8_t length) {
+  uint8_t crc = 0;
+  while (length--) {
+    uint8_t inbyte = *data++;
+    for (uint8_t i = 8; i; i--) {
+      uint8_t mix = (crc ^ inbyte) & 1;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8C;
+      }
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
+
+void OneWireUart::_rxc() {
+  uint8_t echo  = _usart->RXDATAL;
+  uint8_t state = _state;
+  if (state == ONEWIRE_RESET || state == ONEWIRE_SEARCH_RESET) {
+    _presence    = (echo != 0xF0);    // something pulled the bus low after we let go
+    _usart->BAUD = ONEWIRE_BAUD_SLOT;
+    if (state == ONEWIRE_RESET) {
+      _state = ONEWIRE_IDLE;
+    } else if (!_presence) {
+      resetSearch();
+      _state = ONEWIRE_IDLE;
+    } else {
+      _buffer  = &_command;
+      _length  = 1;
+      _reading = false;
+      _shift   = _command;
+      _bits    = 8;
+      _state   = ONEWIRE_SEARCH_CMD;
+      _slot();
+    }
+    return;
+  }
+  uint8_t bit = (echo == 0xFF);       // a device holding the bus low past the start bit is a 0
+  if (state == ONEWIRE_BYTES || state == ONEWIRE_SEARCH_CMD) {
+    _shift = (_shift >> 1) | (bit ? 0x80 : 0);
+    if (--_bits) {
+      _slot();
+      return;
+    }
+    if (_reading) {
+      *_buffer = _shift;
+    }
+    if (--_length) {
+      _buffer++;
+      _shift = _reading ? 0xFF : *_buffer;
+      _bits  = 8;
+      _slot();
+    } else if (state == ONEWIRE_SEARCH_CMD) {
+      _search_bit  = 0;
+      _search_step = 0;
+      _last_zero   = 0;
+      _state       = ONEWIRE_SEARCH;
+      _usart->TXDATAL = 0xFF;
+    } else {
+      _state = ONEWIRE_IDLE;
+    }
+    return;
+  }
+  if (state != ONEWIRE_SEARCH) {
+    return;
+  }
+  // Each bit of the ROM is a triplet: every device sends its bit, then the complement, then we write the direction,
+  // and the ones whose bit doesn't match drop out until the next reset. Algorithm from Maxim's application note 187.
+  if (_search_step == 0) {
+    _id_bit         = bit;
+    _search_step    = 1;
+    _usart->TXDATAL = 0xFF;
+  } else if (_search_step == 1) {
+    if (_id_bit && bit) {             // nobody answered
+      resetSearch();
+      _state = ONEWIRE_IDLE;
+      return;
+    }
+    uint8_t  mask = 1 << (_search_bit & 7);
+    uint8_t *romb = &_rom[_search_bit >> 3];
+    uint8_t  dir;
+    if (_id_bit != bit) {
+      dir = _id_bit;                  // they all agree
+    } else {                          // a 0 and a 1: take the branch that leads to devices not found yet
+      uint8_t position = _search_bit + 1;
+      if (position < _last_discrepancy) {
+        dir = *romb & mask;
+      } else {
+        dir = (position == _last_discrepancy);
+      }
+      if (!dir) {
+        _last_zero = position;
+      }
+    }
+    if (dir) {
+      *romb |= mask;
+    } else {
+      *romb &= ~mask;
+    }
+    _search_step    = 2;
+    _usart->TXDATAL = dir ? 0xFF : 0x00;
+  } else {
+    _search_step = 0;
+    if (++_search_bit < 64) {
+      _usart->TXDATAL = 0xFF;
+      return;
+    }
+    _last_discrepancy = _last_zero;
+    _last_device      = !_last_zero;
+    _found            = _rom[0] && crc8(_rom, 7) == _rom[7];  // family code 0 is what a shorted bus reads as
+    _state            = ONEWIRE_IDLE;
+  }
+}
+
+ISR(USART0_RXC_vect, __attribute__((weak))) {
+  if (_onewire_owner[0]) {
+    _onewire_owner[0]->_rxc();
+  } else {
+    (void) USART0.RXDATAL;
+  }
+}
+
+#if defined(USART1)
+  ISR(USART1_RXC_vect, __attribute__((weak))) {
+    if (_onewire_owner[1]) {
+      _onewire_owner[1]->_rxc();
+    } else {
+      (void) USART1.RXDATAL;
+    }
+  }
+#endif
@@ -0,0 +1,82 @@
+/* OneWireUart.h - 1-Wire bus master on a USART, with the slot timing done by the hardware
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The USART is put in loopback and open-drain mode, so TX and RX are the same pin, and it only ever pulls the bus low.
+ * Every 1-Wire slot is one character: 0xF0 at 9600 baud is a reset (520 us low) followed by a presence window, where
+ * a device pulling the bus low changes the character received; at 115200 baud, 0xFF is a read slot or a 1 (only the
+ * start bit is low) and 0x00 is a 0. The RX interrupt for each character's echo starts the next one, so nothing has
+ * to run with interrupts off, and a byte, a buffer, or a complete ROM search can go on in the background. See
+ * README.md.
+ */
+#ifndef ONEWIREUART_H
+#define ONEWIREUART_H
+
+#include <Arduino.h>
+
+#define ONEWIRE_SEARCH_ROM  (0xF0)
+#define ONEWIRE_MATCH_ROM   (0x55)
+#define ONEWIRE_SKIP_ROM    (0xCC)
+
+class OneWireUart {
+  public:
+    OneWireUart(USART_t &usart) : _usart(&usart) {}
+    // mux is the same as for Serial.swap(). Returns false if there's no such USART or mux option.
+    bool     begin(uint8_t mux = 0);
+    void     end();
+
+    /* Asynchronous: these start the operation and return at once - false if one is still running. busy() is true
+     * until it's done. The buffers have to stay valid till then. */
+    bool     startReset();
+    bool     startWrite(const uint8_t *buffer, uint8_t length);
+    bool     startRead(uint8_t *buffer, uint8_t length);
+    bool     startSearch();                 // reset, SEARCH ROM, and the next device's 64 bits - see searchResult()
+    bool     busy() {
+      return _state;
+    }
+    bool     presence() {                   // did anything answer the last reset?
+      return _presence;
+    }
+    bool     searchResult(uint8_t *rom);    // after startSearch(): true, and the ROM, if it found one with a good CRC
+    void     resetSearch();                 // start the next search from the first device again
+
+    /* Blocking, built on the above - interrupts must be on. */
+    bool     reset();
+    void     write(uint8_t value);
+    void     write(const uint8_t *buffer, uint8_t length);
+    uint8_t  read();
+    void     read(uint8_t *buffer, uint8_t length);
+    void     select(const uint8_t *rom);    // MATCH ROM and the 8 bytes
+    void     skip();                        // SKIP ROM - every device listens
+    bool     search(uint8_t *rom);
+
+    static uint8_t crc8(const uint8_t *data, uint8_t length);
+
+    void     _rxc();                        // called from the ISR
+
+  private:
+    void     _wait() {
+      while (_state);
+    }
+    void     _slot();
+    volatile USART_t *_usart;
+    volatile uint8_t  _state;
+    bool              _presence;
+    uint8_t          *_buffer;              // startWrite()'s buffer is only read, never written
+    uint8_t           _length;
+    uint8_t           _shift;               // slots go out from bit 0, and what's read comes in at bit 7
+    uint8_t           _bits;                // bits of it still to do
+    bool              _reading;
+    uint8_t           _byte;                // for the single byte read() and write()
+    uint8_t           _command;             // ONEWIRE_SEARCH_ROM, for startSearch()
+    uint8_t           _rom[8];
+    uint8_t           _search_bit;          // 0-63
+    uint8_t           _search_step;         // 0 = id bit, 1 = complement, 2 = the direction we write
+    uint8_t           _id_bit;
+    uint8_t           _last_discrepancy;    // 1-64, 0 = none
+    uint8_t           _last_zero;
+    bool              _last_device;
+    bool              _found;
+};
+
+#endif
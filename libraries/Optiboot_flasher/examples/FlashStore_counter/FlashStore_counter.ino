@@ -0,0 +1,49 @@
+/***********************************************************************|
+| Optiboot Flash read/write interface library                           |
+|                                                                       |
+| FlashStore_counter.ino                                                |
+|                                                                       |
+| Counts resets, and saves a value read from a pin every few seconds,   |
+| in a FlashStore log in 4 pages of flash. Each save appends a record   |
+| of a few bytes to the log, rather than erasing and writing a page,    |
+| and a page is only erased each time the log has gone round to it.    |
+|***********************************************************************/
+
+#include <FlashStore.h>
+
+enum : uint8_t {
+  KEY_RESETS,
+  KEY_READING,
+  KEY_COUNT
+};
+
+#define NUMBER_OF_PAGES 4
+const uint8_t flashSpace[SPM_PAGESIZE * NUMBER_OF_PAGES] __attribute__((aligned(SPM_PAGESIZE))) = {};
+uint16_t storeIndex[KEY_COUNT];
+
+FlashStore store(flashSpace, sizeof(flashSpace), storeIndex, KEY_COUNT);
+
+void setup() {
+  Serial.begin(115200);
+  if (!store.begin()) {
+    Serial.println("Needs Optiboot, to write to the flash");
+    while (1);
+  }
+  uint16_t resets = 0;
+  store.get(KEY_RESETS, resets);
+  resets++;
+  store.put(KEY_RESETS, resets);
+  Serial.print("Reset number ");
+  Serial.println(resets);
+  uint16_t reading;
+  if (store.get(KEY_READING, reading)) {
+    Serial.print("Last reading was ");
+    Serial.println(reading);
+  }
+}
+
+void loop() {
+  uint16_t reading = analogRead(PIN_PA7);
+  store.put(KEY_READING, reading);  // only written if it changed
+  delay(5000);
+}
@@ -0,0 +1,77 @@
+/***********************************************************************|
+| Optiboot Flash read/write interface library                           |
+|                                                                       |
+| Staged_update.ino                                                     |
+|                                                                       |
+| Receives a new sketch over Serial (an RS-485 transceiver on the       |
+| UART works the same way) while this one keeps running, and has the    |
+| bootloader put it in place. Needs Optiboot built with                 |
+| STAGED_UPDATE=1.                                                      |
+|                                                                       |
+| Commands, each answered with 'K' (ok) or 'N' (not ok):                |
+|   'B' pages(2)              start a new image of that many pages      |
+|   'R'                       resume - answered with K and the next     |
+|                             page needed (2), or N if there is none    |
+|   'P' page(2) data crc(2)   one page: SPM_PAGESIZE bytes, CRC-16/XMODEM|
+|   'F'                       finish, and reset into the new sketch     |
+| Numbers are little endian. Pages are the sketch's .bin from address   |
+| 0x200 (the start of the application) onwards, padded with 0xFF to a   |
+| whole page.                                                           |
+|***********************************************************************/
+
+#include <StagedUpdate.h>
+
+StagedUpdate update;
+
+uint8_t readByte() {
+  while (!Serial.available());
+  return Serial.read();
+}
+
+uint16_t readWord() {
+  uint16_t low = readByte();
+  return low | (readByte() << 8);
+}
+
+void reply(bool ok) {
+  Serial.write(ok ? 'K' : 'N');
+}
+
+void setup() {
+  Serial.begin(115200);
+  update.resume();         // if the power went partway through, carry on from there
+}
+
+void loop() {
+  // ... whatever this sketch normally does ...
+
+  if (!Serial.available()) {
+    return;
+  }
+  switch (Serial.read()) {
+    case 'B':
+      reply(update.begin(readWord()));
+      break;
+    case 'R':
+      reply(update.pages());
+      if (update.pages()) {
+        uint16_t next = update.nextPage();
+        Serial.write((uint8_t) next);
+        Serial.write((uint8_t)(next >> 8));
+      }
+      break;
+    case 'P': {
+        static uint8_t data[StagedUpdate::pageSize];
+        uint16_t page = readWord();
+        for (uint16_t i = 0; i < StagedUpdate::pageSize; i++) {
+          data[i] = readByte();
+        }
+        reply(update.writePage(page, data, readWord()));
+      }
+      break;
+    case 'F':
+      Serial.flush();
+      reply(update.finish()); // only returns if pages are missing
+      break;
+  }
+}
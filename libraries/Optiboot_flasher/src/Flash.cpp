@@ -63,7 +63,7 @@ bool Flash::check_writable() {
  * filled with. Defaults to 0x00 if not present
  */
 void Flash::clear_buffer(uint8_t fill) {
-  memset(_ram_array, fill, sizeof(_ram_array_size));
+  memset(_ram_array, fill, _ram_array_size);
 }
 
 /**
@@ -98,21 +98,81 @@ uint16_t Flash::buffer_size() {
 }
 
 /**
- * @brief Writes the current content of the RAM buffer to a flash page
+ * @brief Copies length bytes from the RAM buffer, starting at index, to data.
+ * The copy stops at the end of the buffer.
+ *
+ * @param index where in the buffer to start
+ * @param data where to copy the bytes to
+ * @param length number of bytes to copy
+ * @return uint16_t number of bytes copied
+ */
+uint16_t Flash::readBlock(uint16_t index, void *data, uint16_t length) {
+  if (index >= _ram_array_size) {
+    return 0;
+  }
+  if (length > _ram_array_size - index) {
+    length = _ram_array_size - index;
+  }
+  memcpy(data, &_ram_array[index], length);
+  return length;
+}
+
+/**
+ * @brief Copies length bytes from data to the RAM buffer, starting at index.
+ * The copy stops at the end of the buffer.
+ *
+ * @param index where in the buffer to start
+ * @param data the bytes to copy
+ * @param length number of bytes to copy
+ * @return uint16_t number of bytes copied
+ */
+uint16_t Flash::writeBlock(uint16_t index, const void *data, uint16_t length) {
+  if (index >= _ram_array_size) {
+    return 0;
+  }
+  if (length > _ram_array_size - index) {
+    length = _ram_array_size - index;
+  }
+  memcpy(&_ram_array[index], data, length);
+  return length;
+}
+
+/**
+ * @brief Writes the current content of the RAM buffer to a flash page. If
+ * the page already holds exactly that, nothing is written - saving the time
+ * and the wear of an erase/write.
  *
  * @param flash_page_number page number to write the buffer to
  */
 void Flash::write_page(uint16_t flash_page_number) {
+  write_page_if_changed(flash_page_number);
+}
+
+/**
+ * @brief As write_page(), but tells you whether the page was written. The
+ * flash is mapped into the data space, so the page is compared in place with
+ * memcmp() before anything is erased.
+ *
+ * @param flash_page_number page number to write the buffer to
+ * @return true if the page was erased and written
+ * @return false if it already held the content of the buffer
+ */
+bool Flash::write_page_if_changed(uint16_t flash_page_number) {
   // For devices with 128kiB or more, and data is stored in far progmem
   #ifdef RAMPZ
   if (_far_flash_array_addr != 0x0000) {
     optiboot_writePage(_far_flash_array_addr, _ram_array, flash_page_number);
+    return true;
   }
   // For devices with where flash space is allocated in near progmem, <64kiB
   else
   #endif
   {
+    if (!memcmp(&_flash_array[SPM_PAGESIZE * flash_page_number], _ram_array, SPM_PAGESIZE)) {
+      return false;
+    }
     optiboot_writePage(_flash_array, _ram_array, flash_page_number);
+    return true;
   }
 }
 
@@ -131,7 +191,7 @@ void Flash::fetch_page(uint16_t flash_page_number) {
   else
   #endif
   {
-    optiboot_read(_flash_array, _ram_array, flash_page_number, 0, _ram_array_size);
+    memcpy(_ram_array, &_flash_array[SPM_PAGESIZE * flash_page_number], _ram_array_size);
   }
 }
 
@@ -150,7 +210,7 @@ void Flash::fetch_page(uint16_t flash_page_number) {
 void Flash::fetch_data(uint16_t start_address, uint16_t stop_address) {
   uint16_t end_address;
   if (stop_address - start_address > _ram_array_size) {
-    end_address = _ram_array_size;
+    end_address = start_address + _ram_array_size;
   } else {
     end_address = stop_address;
   }
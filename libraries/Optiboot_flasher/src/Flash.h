@@ -16,27 +16,33 @@ class Flash {
     void write_buffer(uint8_t index, uint8_t value);
     uint16_t buffer_size();
     void write_page(uint16_t flash_page_number);
+    bool write_page_if_changed(uint16_t flash_page_number);
     void fetch_page(uint16_t flash_page_number);
     void fetch_data(uint16_t start_address, uint16_t stop_address);
+    uint16_t readBlock(uint16_t index, void *data, uint16_t length);
+    uint16_t writeBlock(uint16_t index, const void *data, uint16_t length);
 
     // Operator overload to be able to read and write directly to the RAM array from a byte level
     uint8_t &operator[](int16_t index);
 
+    // Pointers to the start and one past the end of the RAM array, so it can be walked with a range for loop or
+    // handed to anything that takes a pair of pointers
+    uint8_t *begin() {
+      return _ram_array;
+    }
+    uint8_t *end() {
+      return _ram_array + _ram_array_size;
+    }
+
     // Template function to 'put' objects in RAM array
     template <typename T> const T &put(uint16_t idx, const T &t) {
-      const uint8_t *ptr = (const uint8_t *) &t;
-      for (uint16_t count = 0; count < sizeof(T); count++) {
-        _ram_array[idx + count] = *ptr++;
-      }
+      memcpy(&_ram_array[idx], &t, sizeof(T));
       return t;
     }
 
     // Template function to 'get' objects from the RAM array
     template <typename T> T &get(uint16_t idx, T &t) {
-      uint8_t *ptr = (uint8_t *) &t;
-      for (uint16_t count = 0; count < sizeof(T); count++) {
-        *ptr++ = _ram_array[idx + count];
-      }
+      memcpy(&t, &_ram_array[idx], sizeof(T));
       return t;
     }
 
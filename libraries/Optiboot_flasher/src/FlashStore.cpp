@@ -0,0 +1,280 @@
+#include "FlashStore.h"
+#include <util/crc16.h>
+
+/**
+ * @brief Construct a new FlashStore object
+ *
+ * @param flash_space the flash space the log is kept in - a whole number of
+ * pages, at least 2, aligned to SPM_PAGESIZE
+ * @param flash_space_size total size of the flash space in bytes
+ * @param index a RAM array of one uint16_t per key
+ * @param keys the number of keys, numbered from 0
+ */
+FlashStore::FlashStore(const uint8_t *flash_space, const uint16_t flash_space_size, uint16_t *index, const uint8_t keys)
+  : _flash_space(flash_space),
+    _pages(flash_space_size / SPM_PAGESIZE),
+    _index(index),
+    _keys(keys) {}
+
+uint8_t FlashStore::readByte(uint16_t offset) {
+  return ((const volatile uint8_t *) _flash_space)[offset];  // the compiler may think it knows what's in there
+}
+
+uint8_t FlashStore::nextPage(uint8_t page) {
+  return (page + 1 < _pages) ? page + 1 : 0;
+}
+
+bool FlashStore::pageValid(uint8_t page, uint16_t &seq) {
+  uint16_t start = page * SPM_PAGESIZE;
+  seq = readByte(start) | (readByte(start + 1) << 8);
+  uint16_t check = readByte(start + 2) | (readByte(start + 3) << 8);
+  return seq == (uint16_t) ~check;
+}
+
+bool FlashStore::pageErased(uint8_t page) {
+  for (uint16_t i = page * SPM_PAGESIZE; i < (page + 1) * SPM_PAGESIZE; i++) {
+    if (readByte(i) != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* How long the record at offset is, or 0 if there isn't a good one there: the end of the records in that page, or
+   one that was cut off. */
+uint16_t FlashStore::recordLength(uint16_t offset) {
+  uint16_t end = (offset / SPM_PAGESIZE + 1) * SPM_PAGESIZE;
+  if (offset + 3 > end) {
+    return 0;
+  }
+  uint8_t key = readByte(offset);
+  uint8_t len = readByte(offset + 1);
+  if (key >= _keys || offset + 3 + len > end) {
+    return 0;
+  }
+  uint8_t crc = 0xFF;
+  for (uint8_t i = 0; i < len + 2; i++) {
+    crc = _crc8_ccitt_update(crc, readByte(offset + i));
+  }
+  return (crc == readByte(offset + 2 + len)) ? len + 3 : 0;
+}
+
+/* Writes data at offset without erasing - the rest of the page buffer is still 0xFF, so the rest of the page is left
+   as it was. Interrupts stay off from the first byte into the buffer until the write, so nothing else (like an EEPROM
+   write, which uses the same buffer) can get in between. */
+void FlashStore::program(uint16_t offset, const uint8_t *data, uint8_t len) {
+  uint8_t sreg_save = SREG;
+  cli();
+  while (NVMCTRL.STATUS & (NVMCTRL_EEBUSY_bm | NVMCTRL_FBUSY_bm));
+  for (uint8_t i = 0; i < len; i++) {
+    optiboot_page_fill((optiboot_addr_t) &_flash_space[offset + i], data[i]);
+  }
+  optiboot_page_write((optiboot_addr_t) &_flash_space[offset]);
+  SREG = sreg_save;
+}
+
+void FlashStore::erase(uint8_t page) {
+  uint8_t sreg_save = SREG;
+  cli();
+  while (NVMCTRL.STATUS & (NVMCTRL_EEBUSY_bm | NVMCTRL_FBUSY_bm));
+  optiboot_page_erase((optiboot_addr_t) &_flash_space[page * SPM_PAGESIZE]);
+  SREG = sreg_save;
+}
+
+void FlashStore::open(uint8_t page, uint16_t seq) {
+  uint8_t header[4] = {(uint8_t) seq, (uint8_t)(seq >> 8), (uint8_t) ~seq, (uint8_t)(~seq >> 8)};
+  program(page * SPM_PAGESIZE, header, 4);
+  _head = page;
+  _offset = page * SPM_PAGESIZE + 4;
+  _seq = seq;
+}
+
+/* Put a whole record (key, length, value, CRC) at the end of the head page, if there's room. */
+bool FlashStore::write(const uint8_t *record, uint8_t len) {
+  if (_offset + len > (_head + 1) * SPM_PAGESIZE) {
+    return false;
+  }
+  program(_offset, record, len);
+  _index[record[0]] = _offset;
+  _offset += len;
+  return true;
+}
+
+bool FlashStore::append(uint8_t key, const uint8_t *data, uint8_t len) {
+  uint8_t record[SPM_PAGESIZE];
+  record[0] = key;
+  record[1] = len;
+  memcpy(record + 2, data, len);
+  uint8_t crc = 0xFF;
+  for (uint8_t i = 0; i < len + 2; i++) {
+    crc = _crc8_ccitt_update(crc, record[i]);
+  }
+  record[len + 2] = crc;
+  return write(record, len + 3);
+}
+
+/* Copy the records in page that are still current to the head, then erase it. Returns false if they don't fit. */
+bool FlashStore::reclaim(uint8_t page) {
+  uint16_t offset = page * SPM_PAGESIZE + 4;
+  uint16_t len;
+  uint8_t record[SPM_PAGESIZE];
+  while ((len = recordLength(offset))) {
+    if (_index[readByte(offset)] == offset) {
+      for (uint8_t i = 0; i < len; i++) {
+        record[i] = readByte(offset + i);
+      }
+      if (!write(record, len)) {
+        return false;
+      }
+    }
+    offset += len;
+  }
+  erase(page);
+  return true;
+}
+
+/* Start the next page, which is kept erased, and reclaim the one after it, so that it will be. */
+bool FlashStore::advance() {
+  if (!pageErased(nextPage(_head))) {
+    return false;                   // only if a reclaim didn't fit - everything is current values
+  }
+  open(nextPage(_head), _seq + 1);
+  uint8_t oldest = nextPage(_head);
+  uint16_t seq;
+  if (pageValid(oldest, seq)) {
+    return reclaim(oldest);
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the log, and fills in the index. Any pages that aren't part of
+ * it (like flash space that the sketch put zeros in) are erased. The first
+ * time, that's all of them.
+ *
+ * @return false if the flash space is less than 2 pages, or there is no
+ * bootloader to write with
+ */
+bool FlashStore::begin() {
+  if (_pages < 2 || !optiboot_check_writable()) {
+    return false;
+  }
+  for (uint8_t k = 0; k < _keys; k++) {
+    _index[k] = 0xFFFF;
+  }
+  bool any = false;
+  uint16_t seq;
+  for (uint8_t p = 0; p < _pages; p++) {
+    if (pageValid(p, seq)) {
+      if (!any || (int16_t)(seq - _seq) > 0) {
+        _seq = seq;
+        _head = p;
+        any = true;
+      }
+    } else if (!pageErased(p)) {
+      erase(p);
+    }
+  }
+  if (!any) {
+    open(0, 0);
+    return true;
+  }
+  // Oldest first, so that the last record for each key is the one left in the index
+  uint8_t p = _head;
+  do {
+    p = nextPage(p);
+    if (pageValid(p, seq)) {
+      uint16_t offset = p * SPM_PAGESIZE + 4;
+      uint16_t len;
+      while ((len = recordLength(offset))) {
+        _index[readByte(offset)] = offset;
+        offset += len;
+      }
+      if (p == _head) {
+        // Anything after the last good record other than blank flash was a write that was cut off; don't write there.
+        _offset = (readByte(offset) == 0xFF) ? offset : (p + 1) * SPM_PAGESIZE;
+      }
+    }
+  } while (p != _head);
+  // If the power went while the last page was being reclaimed, finish it.
+  if (pageValid(nextPage(_head), seq)) {
+    return reclaim(nextPage(_head));
+  }
+  return true;
+}
+
+/**
+ * @brief The length of the value stored for a key
+ *
+ * @return 0 if the key has never been written
+ */
+uint8_t FlashStore::length(uint8_t key) {
+  if (key >= _keys || _index[key] == 0xFFFF) {
+    return 0;
+  }
+  return readByte(_index[key] + 1);
+}
+
+/**
+ * @brief Reads the value of a key. If it is shorter than len, only that much
+ * is read.
+ *
+ * @return false if the key has never been written
+ */
+bool FlashStore::get(uint8_t key, void *buf, uint8_t len) {
+  if (key >= _keys || _index[key] == 0xFFFF) {
+    return false;
+  }
+  uint8_t stored = length(key);
+  uint8_t *ptr = (uint8_t *) buf;
+  for (uint8_t i = 0; i < len && i < stored; i++) {
+    ptr[i] = readByte(_index[key] + 2 + i);
+  }
+  return true;
+}
+
+/**
+ * @brief Stores a new value for a key, unless that is what it already is.
+ *
+ * @return false if the key or the length is out of range, or the flash space
+ * is full of current values
+ */
+bool FlashStore::put(uint8_t key, const void *buf, uint8_t len) {
+  if (key >= _keys || len > maxLength) {
+    return false;
+  }
+  const uint8_t *data = (const uint8_t *) buf;
+  if (_index[key] != 0xFFFF && length(key) == len) {
+    uint8_t i = 0;
+    while (i < len && readByte(_index[key] + 2 + i) == data[i]) {
+      i++;
+    }
+    if (i == len) {
+      return true;
+    }
+  }
+  for (uint8_t tries = _pages; tries; tries--) {
+    if (append(key, data, len)) {
+      return true;
+    }
+    if (!advance()) {
+      return false;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Erases the whole flash space, and starts again with no keys
+ */
+void FlashStore::clear() {
+  for (uint8_t p = 0; p < _pages; p++) {
+    if (!pageErased(p)) {
+      erase(p);
+    }
+  }
+  for (uint8_t k = 0; k < _keys; k++) {
+    _index[k] = 0xFFFF;
+  }
+  open(0, _seq + 1);
+}
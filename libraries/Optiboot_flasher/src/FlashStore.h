@@ -0,0 +1,62 @@
+#ifndef FLASHSTORE_H
+#define FLASHSTORE_H
+
+#include <Arduino.h>
+#include <optiboot.h>
+
+/* FlashStore - key/value records kept in a log in flash, through the same bootloader functions as Flash.
+ *
+ * Each page starts with a 4 byte header (a sequence number and its complement), followed by records:
+ *
+ *   key | length | value (length bytes) | CRC8 of the rest
+ *
+ * Records are appended to the newest page in place - the page buffer only has the new bytes, so a page write (without
+ * an erase) programs just those. The last record for a key is its current value, and where it is, is kept in a RAM
+ * array (2 bytes per key) that begin() fills in by reading the log. When the newest page is full, the next one (which
+ * is always kept erased) is started, and the oldest page after it has its records that are still current copied into
+ * it, and is erased - so a page is only erased when the log comes round to it, and a put() takes at most one page
+ * erase plus a page's worth of copying. A record cut off by a power failure fails its CRC and is ignored.
+ */
+
+class FlashStore {
+  public:
+    FlashStore(const uint8_t *flash_space, const uint16_t flash_space_size, uint16_t *index, const uint8_t keys);
+    bool begin();
+    uint8_t length(uint8_t key);
+    bool get(uint8_t key, void *buf, uint8_t len);
+    bool put(uint8_t key, const void *buf, uint8_t len);
+    void clear();
+    static constexpr uint8_t maxLength = SPM_PAGESIZE - 4 - 3;
+
+    template <typename T> bool get(uint8_t key, T &t) {
+      return get(key, &t, sizeof(T));
+    }
+    template <typename T> bool put(uint8_t key, const T &t) {
+      static_assert(sizeof(T) <= maxLength, "Too big for a flash page");
+      return put(key, &t, sizeof(T));
+    }
+
+  private:
+    const uint8_t *_flash_space;      // Pointer to allocated flash space, a whole number of pages
+    const uint8_t _pages;             // Number of pages in it
+    uint16_t *_index;                 // Offset of each key's current record, or 0xFFFF
+    const uint8_t _keys;
+    uint8_t _head = 0;                // The page being appended to
+    uint16_t _offset = 0;             // Where the next record goes
+    uint16_t _seq = 0;                // Sequence number of the head page
+
+    uint8_t readByte(uint16_t offset);
+    uint8_t nextPage(uint8_t page);
+    bool pageValid(uint8_t page, uint16_t &seq);
+    bool pageErased(uint8_t page);
+    uint16_t recordLength(uint16_t offset);
+    void program(uint16_t offset, const uint8_t *data, uint8_t len);
+    void erase(uint8_t page);
+    void open(uint8_t page, uint16_t seq);
+    bool write(const uint8_t *record, uint8_t len);
+    bool append(uint8_t key, const uint8_t *data, uint8_t len);
+    bool reclaim(uint8_t page);
+    bool advance();
+};
+
+#endif
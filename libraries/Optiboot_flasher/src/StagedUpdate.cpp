@@ -0,0 +1,181 @@
+#include "StagedUpdate.h"
+#include <util/crc16.h>
+
+extern const uint8_t __data_load_end[];  // the end of the running sketch in flash
+
+// Where the control block is, in the last page of flash (as mapped into the data space)
+#define CONTROL_ADDRESS (MAPPED_PROGMEM_END - (SPM_PAGESIZE - 1))
+#define BITMAP_OFFSET   8
+
+volatile const uint16_t *StagedUpdate::control() {
+  return (volatile const uint16_t *) CONTROL_ADDRESS;
+}
+
+uint16_t StagedUpdate::stagingStart(uint16_t pages) {
+  return CONTROL_ADDRESS - pages * SPM_PAGESIZE;
+}
+
+/**
+ * @brief The largest image that can be staged: the staged copy has to be
+ * above both the running sketch and where the new one will go, and there has
+ * to be a bit for each page in the control block
+ *
+ * @return number of pages
+ */
+uint16_t StagedUpdate::maxPages() {
+  uint16_t top = CONTROL_ADDRESS - MAPPED_PROGMEM_START;
+  uint16_t used = ((uint16_t) __data_load_end + SPM_PAGESIZE - 1) & ~(SPM_PAGESIZE - 1);
+  uint16_t pages = (top - used) / SPM_PAGESIZE;        // above the running sketch
+  uint16_t half  = (top - 512) / SPM_PAGESIZE / 2;     // and not overlapping where it's copied to
+  if (pages > half) {
+    pages = half;
+  }
+  if (pages > (SPM_PAGESIZE - BITMAP_OFFSET) * 8) {
+    pages = (SPM_PAGESIZE - BITMAP_OFFSET) * 8;
+  }
+  return pages;
+}
+
+/* Clear bits in one byte of the control block, with a page write that doesn't erase - the rest of the page buffer is
+   0xFF so nothing else changes. */
+void StagedUpdate::program(uint16_t address, uint8_t value) {
+  uint8_t sreg_save = SREG;
+  cli();
+  do_nvmctrl(0, NVMCTRL_CMD_PAGEBUFCLR_gc, 0);
+  optiboot_page_fill(address, value);
+  optiboot_page_write(address);
+  SREG = sreg_save;
+}
+
+/**
+ * @brief Start receiving a new image, forgetting any earlier one
+ *
+ * @param pages the size of the image, in pages
+ * @return false if it's bigger than maxPages(), or there's no bootloader
+ * that can write the flash
+ */
+bool StagedUpdate::begin(uint16_t pages) {
+  if (!pages || pages > maxPages() || !optiboot_check_writable()) {
+    return false;
+  }
+  optiboot_page_erase(CONTROL_ADDRESS);
+  uint16_t header[3] = {STAGED_MAGIC, pages, (uint16_t) ~pages};
+  uint8_t sreg_save = SREG;
+  cli();
+  for (uint8_t i = 0; i < 6; i++) {
+    optiboot_page_fill(CONTROL_ADDRESS + i, ((uint8_t *) header)[i]);
+  }
+  optiboot_page_write(CONTROL_ADDRESS);
+  SREG = sreg_save;
+  _pages = pages;
+  return true;
+}
+
+/**
+ * @brief Pick up a transfer that was started before a reset
+ *
+ * @return true if there is one, and it hasn't been finished. pages() and
+ * nextPage() then say what is left to do.
+ */
+bool StagedUpdate::resume() {
+  volatile const uint16_t *c = control();
+  if (c[0] != STAGED_MAGIC || c[1] != (uint16_t) ~c[2] || c[3] != 0xFFFF || c[1] > maxPages()) {
+    _pages = 0;
+    return false;
+  }
+  _pages = c[1];
+  return true;
+}
+
+uint16_t StagedUpdate::pages() {
+  return _pages;
+}
+
+bool StagedUpdate::received(uint16_t page) {
+  uint8_t bits = *(volatile const uint8_t *)(CONTROL_ADDRESS + BITMAP_OFFSET + (page >> 3));
+  return !(bits & (1 << (page & 7)));
+}
+
+/**
+ * @brief The first page that hasn't been received yet
+ *
+ * @return a page number, or pages() if they are all in
+ */
+uint16_t StagedUpdate::nextPage() {
+  uint16_t page = 0;
+  while (page < _pages && received(page)) {
+    page++;
+  }
+  return page;
+}
+
+/**
+ * @brief Check one page of the image against its CRC, and write it to the
+ * staging area. Pages can come in any order, and again - one that was
+ * already received is just acknowledged.
+ *
+ * @param page page number, from 0
+ * @param data pageSize bytes
+ * @param crc the crc() of them
+ * @return false if the CRC doesn't match, the page number is out of range, or
+ * it didn't read back right
+ */
+bool StagedUpdate::writePage(uint16_t page, const uint8_t *data, uint16_t crc) {
+  if (page >= _pages || StagedUpdate::crc(data, SPM_PAGESIZE) != crc) {
+    return false;
+  }
+  if (received(page)) {
+    return true;
+  }
+  uint16_t address = stagingStart(_pages) + page * SPM_PAGESIZE;
+  uint8_t sreg_save = SREG;
+  cli();
+  for (uint16_t i = 0; i < SPM_PAGESIZE; i++) {
+    optiboot_page_fill(address + i, data[i]);
+  }
+  optiboot_page_erase_write();
+  SREG = sreg_save;
+  for (uint16_t i = 0; i < SPM_PAGESIZE; i++) {
+    if (((volatile const uint8_t *) address)[i] != data[i]) {
+      return false;
+    }
+  }
+  program(CONTROL_ADDRESS + BITMAP_OFFSET + (page >> 3), ~(1 << (page & 7)));
+  return true;
+}
+
+/**
+ * @brief Once every page has been received, mark the image ready and reset;
+ * the bootloader copies it over this sketch, and starts it.
+ *
+ * @return false (and doesn't reset) if some pages are missing
+ */
+bool StagedUpdate::finish() {
+  if (!_pages || nextPage() != _pages) {
+    return false;
+  }
+  program(CONTROL_ADDRESS + 6, 0);
+  program(CONTROL_ADDRESS + 7, 0);
+  // A watchdog reset, so the bootloader goes straight to the new sketch once it's copied it.
+  _PROTECTED_WRITE(WDT.CTRLA, WDT_PERIOD_8CLK_gc);
+  while (1);
+}
+
+/**
+ * @brief Forget the transfer in progress
+ */
+void StagedUpdate::cancel() {
+  optiboot_page_erase(CONTROL_ADDRESS);
+  _pages = 0;
+}
+
+/**
+ * @brief The CRC used for pages: CRC-16/XMODEM (polynomial 0x1021, starting
+ * from 0), which is easy to find for whatever sends the image.
+ */
+uint16_t StagedUpdate::crc(const uint8_t *data, uint16_t len, uint16_t crc) {
+  while (len--) {
+    crc = _crc_xmodem_update(crc, *data++);
+  }
+  return crc;
+}
@@ -0,0 +1,45 @@
+#ifndef STAGEDUPDATE_H
+#define STAGEDUPDATE_H
+
+#include <Arduino.h>
+#include <optiboot.h>
+
+/* StagedUpdate - receive a new sketch into spare flash while the old one keeps running, and have the bootloader copy
+ * it into place at the next reset. Needs Optiboot built with STAGED_UPDATE=1.
+ *
+ * The image goes into the pages just below the last page of flash, which is the control block:
+ *
+ *   magic | number of pages | its complement | ready (0) | one bit per page, cleared once that page is written
+ *
+ * Pages are sent with a CRC each, and only marked as received once they've been written and read back. Since the
+ * marks are kept in flash, a transfer that was cut off - by the link, or the power - can be picked up where it
+ * stopped with resume() and nextPage(). When every page is in, finish() clears the ready word and resets; the
+ * bootloader sees that and copies the staged pages over the application before starting it.
+ */
+
+#define STAGED_MAGIC 0x5354             // "ST", must match optiboot_x.c
+
+class StagedUpdate {
+  public:
+    static constexpr uint16_t pageSize = SPM_PAGESIZE;
+    uint16_t maxPages();
+    bool begin(uint16_t pages);
+    bool resume();
+    uint16_t pages();
+    uint16_t nextPage();
+    bool writePage(uint16_t page, const uint8_t *data, uint16_t crc);
+    bool finish();
+    void cancel();
+
+    static uint16_t crc(const uint8_t *data, uint16_t len, uint16_t crc = 0);
+
+  private:
+    uint16_t _pages = 0;
+
+    static volatile const uint16_t *control();
+    static uint16_t stagingStart(uint16_t pages);
+    bool received(uint16_t page);
+    void program(uint16_t address, uint8_t value);
+};
+
+#endif
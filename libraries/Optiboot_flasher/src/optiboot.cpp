@@ -1,4 +1,5 @@
 #include "optiboot.h"
+#include <string.h>
 
 
 /*
@@ -113,9 +114,9 @@ void optiboot_page_write(optiboot_addr_t address) {
  * @param stop_address the address where we stop reading, relative to the flash page number
  */
 void optiboot_read(const uint8_t allocated_flash_space[], uint8_t storage_array[], uint16_t page_number, uint16_t start_address, uint16_t stop_address) {
-  for (uint16_t j = start_address; j < stop_address; j++) {
-    uint8_t read_character = allocated_flash_space[j + SPM_PAGESIZE * (page_number)];
-    storage_array[j - start_address] = read_character;
+  // The flash is mapped into the data space, so this is just a copy
+  if (stop_address > start_address) {
+    memcpy(storage_array, &allocated_flash_space[start_address + SPM_PAGESIZE * page_number], stop_address - start_address);
   }
 }
 
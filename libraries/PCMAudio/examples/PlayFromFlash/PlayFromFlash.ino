@@ -0,0 +1,26 @@
+/* PlayFromFlash - play a short sound stored in flash, once a second, as PWM on TCD0 (PA4) on the 1-series, or TCA0
+ * (PB0) otherwise. Put a 1k resistor and a 10 nF capacitor to ground on the pin, as a low-pass filter, and take the
+ * audio from the capacitor to an amplifier - not straight to a speaker.
+ * The sound here is just one cycle of a 1 kHz sine at 8 kHz, over and over; to make a real one, convert an audio file
+ * to 8-bit unsigned mono raw data at the rate you want (Audacity can export that), and then to a C array.
+ */
+#include <PCMAudio.h>
+
+const uint8_t sine[] PROGMEM = {128, 218, 255, 218, 128, 38, 1, 38};
+uint8_t beep[800];
+
+void setup() {
+  #if defined(TCD0)
+    PCMAudio.beginPWM(PCM_TCD0);
+  #else
+    PCMAudio.beginPWM(PCM_TCA0);
+  #endif
+  for (uint16_t i = 0; i < sizeof(beep); i++) {   // a tenth of a second of it, in RAM
+    beep[i] = pgm_read_byte(&sine[i & 7]);
+  }
+}
+
+void loop() {
+  PCMAudio.play(beep, sizeof(beep), 8000);
+  delay(1000);
+}
@@ -0,0 +1,36 @@
+/* PlayFromSD - play SOUND.WAV from an SD card, over and over, out of the DAC (PA6) on 1-series parts with one.
+ * The file must be an 8-bit unsigned mono WAV; pass the sample rate it was made at to play(). The 44 byte header of
+ * a plain WAV file is skipped - a file with extra chunks in the header will click at the start.
+ */
+#include <SPI.h>
+#include <SD.h>
+#include <PCMAudio.h>
+
+File sound;
+
+void setup() {
+  Serial.begin(115200);
+  if (!SD.begin(PIN_PA7)) {     // the card's CS pin
+    Serial.println("No card");
+    while (1);
+  }
+  DACReference(INTERNAL4V3);
+  PCMAudio.beginDAC();
+}
+
+void loop() {
+  sound = SD.open("SOUND.WAV");
+  if (!sound) {
+    Serial.println("No SOUND.WAV");
+    while (1);
+  }
+  sound.seek(44);
+  PCMAudio.play(sound, 11025);
+  while (PCMAudio.update());    // keep the buffer filled until it's done
+  sound.close();
+  if (PCMAudio.underruns()) {
+    Serial.print(PCMAudio.underruns());
+    Serial.println(" underruns");
+  }
+  delay(500);
+}
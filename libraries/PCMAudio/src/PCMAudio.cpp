@@ -0,0 +1,161 @@
+/* PCMAudio.cpp - see PCMAudio.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The sources and the double buffer. The outputs are in PCMAudio_pwm.cpp and PCMAudio_dac.cpp; the library is linked
+ * as an archive (dot_a_linkage), so an output that isn't begun isn't linked at all.
+ */
+
+#include "PCMAudio.h"
+
+PCMAudioClass PCMAudio;
+
+bool PCMAudioClass::play(const uint8_t *samples, uint16_t len, uint16_t rate) {
+  return _play(samples, len, PCM_SRC_RAM, rate);
+}
+
+bool PCMAudioClass::play_P(const uint8_t *samples, uint16_t len, uint16_t rate) {
+  return _play(samples, len, PCM_SRC_PROGMEM, rate);
+}
+
+bool PCMAudioClass::play(Stream &source, uint16_t rate) {
+  if (!_start) {
+    return false;
+  }
+  stop();
+  _stream = &source;
+  uint8_t final = 0;
+  const uint16_t half = PCM_BUFFER_SIZE / 2;
+  if (_fill(_buffer, half) < half) {
+    memset(_buffer + half, 128, half);
+    final = 1;
+  } else if (_fill(_buffer + half, half) < half) {
+    final = 2;
+  }
+  _final = final;
+  return _play(_buffer, PCM_BUFFER_SIZE, PCM_SRC_STREAM, rate);
+}
+
+/* Read what the Stream has, up to len, without waiting - a File's available() is what's left of it, so when it's 0
+ * the file's over. The rest is filled with silence. */
+uint16_t PCMAudioClass::_fill(uint8_t *dest, uint16_t len) {
+  uint16_t got = 0;
+  while (got < len) {
+    int avail = _stream->available();
+    if (avail <= 0) {
+      break;
+    }
+    uint16_t n = len - got;
+    if ((uint16_t) avail < n) {
+      n = avail;
+    }
+    uint16_t r = _stream->readBytes(dest + got, n);
+    if (!r) {
+      break;
+    }
+    got += r;
+  }
+  memset(dest + got, 128, len - got);
+  return got;
+}
+
+bool PCMAudioClass::_play(const uint8_t *data, uint16_t len, uint8_t source, uint16_t rate) {
+  if (!_start || !len) {
+    return false;
+  }
+  if (source != PCM_SRC_STREAM) {
+    stop();
+  }
+  _data       = data;
+  _len        = len;
+  _index      = 0;
+  _source     = source;
+  _need       = 0;
+  _underruns  = 0;
+  _playing    = true;
+  if (!_start(data, len, source, rate)) {
+    _playing  = false;
+    return false;
+  }
+  return true;
+}
+
+bool PCMAudioClass::update() {
+  if (_playing && _source == PCM_SRC_STREAM && !_final) {
+    uint8_t need = _need;
+    const uint16_t half = PCM_BUFFER_SIZE / 2;
+    for (uint8_t h = 0; h < 2; h++) {
+      if (need & (1 << h)) {
+        uint8_t final = (_fill(_buffer + (h ? half : 0), half) < half) ? h + 1 : 0;
+        uint8_t oldSREG = SREG;
+        cli();
+        _need &= ~(1 << h);
+        _final = final;
+        SREG = oldSREG;
+        if (final) {
+          break;      // the other half plays before this one, and then it's over
+        }
+      }
+    }
+  }
+  return _playing;
+}
+
+void PCMAudioClass::stop() {
+  if (_stop) {
+    uint8_t oldSREG = SREG;
+    cli();
+    _stop();
+    _playing = false;
+    SREG = oldSREG;
+  }
+}
+
+uint16_t PCMAudioClass::underruns() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t count = _underruns;
+  SREG = oldSREG;
+  return count;
+}
+
+/* The next sample, for the PWM output's ISR - dacPlay() does this itself. */
+uint8_t PCMAudioClass::_next() {
+  uint16_t index = _index;
+  uint8_t  sample;
+  if (_source == PCM_SRC_PROGMEM) {
+    sample = pgm_read_byte(&_data[index]);
+  } else {
+    sample = _data[index];
+  }
+  index++;
+  if (index == _len) {
+    index = 0;
+    if (_source == PCM_SRC_STREAM) {
+      _half(1);
+    } else {
+      _done();
+    }
+  } else if (_source == PCM_SRC_STREAM && index == PCM_BUFFER_SIZE / 2) {
+    _half(0);
+  }
+  _index = index;
+  return sample;
+}
+
+void PCMAudioClass::_half(uint8_t half) {
+  if (_final == half + 1) {
+    _done();
+    return;
+  }
+  uint8_t bit = 1 << half;
+  if ((_need & bit) && _underruns != 0xFFFF) {
+    _underruns++;
+  }
+  _need |= bit;
+}
+
+void PCMAudioClass::_done() {
+  _stop();
+  _playing = false;
+}
@@ -0,0 +1,73 @@
+/* PCMAudio.h - 8-bit PCM sample playback, as high frequency PWM on TCD0 or TCA0, or out of the DAC
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The samples are unsigned 8-bit, 128 being silence - the same as an 8-bit WAV file. With beginPWM(), a TCB
+ * interrupts at the sample rate and writes each one to the compare register of a PWM timer running at 256 counts per
+ * cycle, from the 20 MHz oscillator for TCD0 (so 78 kHz whatever the system clock) or the system clock for TCA0; an
+ * RC low-pass filter on the pin turns that into audio. With beginDAC(), dacPlay() does it, straight to the DAC. The
+ * samples can be in RAM, in flash, or come from a Stream - a File on an SD card, typically - through a double buffer
+ * that update() refills from loop(). See README.md.
+ */
+#ifndef PCMAUDIO_H
+#define PCMAUDIO_H
+
+#include <Arduino.h>
+
+#if !defined(PCM_BUFFER_SIZE)
+  #define PCM_BUFFER_SIZE   (256)   // for play(Stream), two halves
+#endif
+#if (PCM_BUFFER_SIZE & 1) || PCM_BUFFER_SIZE < 16
+  #error "PCM_BUFFER_SIZE must be even, and at least 16"
+#endif
+
+#define PCM_TCD0            (0x01)  // WOA: PA4, or PA6 on 8-pin parts - 1-series only
+#define PCM_TCA0            (0x02)  // WO0: PB0, or PA7 on 8-pin parts
+
+#define PCM_SRC_RAM         (0x00)
+#define PCM_SRC_PROGMEM     (0x01)
+#define PCM_SRC_STREAM      (0x02)
+
+class PCMAudioClass {
+  public:
+    /* PWM output. False if the part doesn't have the timer, millis is using it, or there's no TCB for the sample rate.
+     * The timer is taken over (takeOverTCA0()/takeOverTCD0()) and stays that way. */
+    bool     beginPWM(uint8_t timer);
+    /* DAC output, with dacPlay(); false if the part has no DAC. Set the range with DACReference() first. */
+    bool     beginDAC();
+    /* Start playing; false if begin hasn't been called, or the rate can't be done. Anything playing is stopped. */
+    bool     play(const uint8_t *samples, uint16_t len, uint16_t rate);
+    bool     play_P(const uint8_t *samples, uint16_t len, uint16_t rate);
+    bool     play(Stream &source, uint16_t rate);
+    bool     update();                   // refill the buffer from the Stream; call often. Returns playing().
+    bool     playing() {
+      return _playing;
+    }
+    void     stop();
+    uint16_t underruns();                // halves played again because update() didn't get to them in time
+    /* Called from the ISRs */
+    uint8_t  _next();
+    void     _half(uint8_t half);
+    void     _done();
+    uint8_t  _buffer[PCM_BUFFER_SIZE];
+    /* Set by beginPWM() or beginDAC(), so only the one the sketch uses gets linked in - the DAC one brings dacPlay()'s
+     * TCB interrupt with it, which would clash with the PWM one. */
+    bool   (*_start)(const uint8_t *data, uint16_t len, uint8_t source, uint16_t rate) = NULL;
+    void   (*_stop)() = NULL;
+  private:
+    bool     _play(const uint8_t *data, uint16_t len, uint8_t source, uint16_t rate);
+    uint16_t _fill(uint8_t *dest, uint16_t len);
+    const uint8_t    *_data;
+    uint16_t          _len;
+    volatile uint16_t _index;
+    uint8_t           _source;
+    Stream           *_stream;
+    volatile uint8_t  _need;             // halves waiting to be refilled, one bit each
+    volatile uint8_t  _final;            // 1 + the half the Stream ended in, or 0
+    volatile bool     _playing;
+    volatile uint16_t _underruns;
+};
+
+extern PCMAudioClass PCMAudio;
+
+#endif
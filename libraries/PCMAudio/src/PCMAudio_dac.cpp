@@ -0,0 +1,40 @@
+/* PCMAudio_dac.cpp - the DAC output of PCMAudio, which is just dacPlay()
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "PCMAudio.h"
+
+#if defined(DAC0)
+
+static void _pcm_dac_done(__attribute__((unused)) uint8_t *played) {
+  PCMAudio._done();
+}
+
+static void _pcm_dac_half(uint8_t *played) {
+  PCMAudio._half(played == PCMAudio._buffer ? 0 : 1);
+}
+
+static bool _pcm_dac_start(const uint8_t *data, uint16_t len, uint8_t source, uint16_t rate) {
+  if (source == PCM_SRC_STREAM) {
+    return dacPlay(data, len, rate, DAC_DOUBLEBUF, _pcm_dac_half);
+  }
+  return dacPlay(data, len, rate, DAC_ONESHOT | (source == PCM_SRC_PROGMEM ? DAC_PROGMEM : 0), _pcm_dac_done);
+}
+
+static void _pcm_dac_stop() {
+  dacStop();
+}
+
+bool PCMAudioClass::beginDAC() {
+  stop();
+  _start = _pcm_dac_start;
+  _stop  = _pcm_dac_stop;
+  return true;
+}
+
+#else
+bool PCMAudioClass::beginDAC() {
+  return false;
+}
+#endif
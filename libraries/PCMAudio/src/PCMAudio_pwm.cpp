@@ -0,0 +1,128 @@
+/* PCMAudio_pwm.cpp - the PWM outputs of PCMAudio, and the TCB that paces them
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Both timers count 0 to 255, so each cycle is 256 counts and the duty cycle is the sample. TCD0 runs from the 20 MHz
+ * oscillator, asynchronously, so its carrier is 78 kHz (62.5 kHz with the oscillator at 16 MHz) at any system clock;
+ * its new compare value takes a sync command, which takes effect at the end of the cycle. TCA0 runs from the system
+ * clock in single slope mode, where the compare register is buffered, so that's glitch free too. Like dacPlay(), this
+ * defines the interrupt of its TCB, so it can't be used with tone(), Servo or anything else on that TCB.
+ */
+
+#include "PCMAudio.h"
+
+#if !defined(PCM_TCB)       // pick a TCB that millis isn't using; TCB1 if we have one, since tone() uses TCB0.
+  #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define PCM_TCB 1
+  #elif !defined(MILLIS_USE_TIMERB0)
+    #define PCM_TCB 0
+  #endif
+#endif
+
+#if _AVR_PINCOUNT == 8
+  #define _PCM_PIN_TCD0 PIN_PA6
+  #define _PCM_PIN_TCA0 PIN_PA7     // where the core puts WO0 on 8-pin parts
+#else
+  #define _PCM_PIN_TCD0 PIN_PA4
+  #define _PCM_PIN_TCA0 PIN_PB0
+#endif
+
+#if defined(PCM_TCB)
+  #if PCM_TCB == 1
+    #define _PCM_TCB  TCB1
+    #define _PCM_VECT TCB1_INT_vect
+  #else
+    #define _PCM_TCB  TCB0
+    #define _PCM_VECT TCB0_INT_vect
+  #endif
+
+static uint8_t _pcm_timer;
+
+ISR(_PCM_VECT) {
+  _PCM_TCB.INTFLAGS = TCB_CAPT_bm;
+  uint8_t sample    = PCMAudio._next();
+  #if defined(TCD0) && !defined(MILLIS_USE_TIMERD0)
+    if (_pcm_timer == PCM_TCD0) {
+      if (TCD0.STATUS & TCD_CMDRDY_bm) {  // it always is, unless the rate is over the carrier frequency
+        TCD0.CMPASET = 255 - sample;      // high from CMPASET to the end of the cycle
+        TCD0.CTRLE   = TCD_SYNCEOC_bm;
+      }
+      return;
+    }
+  #endif
+  TCA0.SINGLE.CMP0BUF = sample;
+}
+
+static bool _pcm_pwm_start(__attribute__((unused)) const uint8_t *data, __attribute__((unused)) uint16_t len, __attribute__((unused)) uint8_t source, uint16_t rate) {
+  if (!rate) {
+    return false;
+  }
+  uint8_t  clksel = TCB_CLKSEL_DIV1_gc;
+  uint32_t ticks  = F_CPU / rate;
+  if (ticks > 0x10000) {
+    ticks >>= 1;
+    clksel = TCB_CLKSEL_DIV2_gc;
+  }
+  if (ticks > 0x10000 || ticks < 128) {
+    return false;   // too slow for the timer, or too fast for the ISR to keep up.
+  }
+  _PCM_TCB.CTRLA    = 0;
+  _PCM_TCB.CTRLB    = TCB_CNTMODE_INT_gc;
+  _PCM_TCB.CCMP     = ticks - 1;
+  _PCM_TCB.CNT      = 0;
+  _PCM_TCB.INTFLAGS = TCB_CAPT_bm;
+  _PCM_TCB.INTCTRL  = TCB_CAPT_bm;
+  _PCM_TCB.CTRLA    = clksel | TCB_ENABLE_bm;
+  return true;
+}
+
+static void _pcm_pwm_stop() {
+  _PCM_TCB.CTRLA    = 0;
+  _PCM_TCB.INTCTRL  = 0;
+  _PCM_TCB.INTFLAGS = TCB_CAPT_bm;
+}
+
+bool PCMAudioClass::beginPWM(uint8_t timer) {
+  if (timer == PCM_TCD0) {
+    #if defined(TCD0) && !defined(MILLIS_USE_TIMERD0)
+      stop();
+      takeOverTCD0();
+      while (!(TCD0.STATUS & TCD_ENRDY_bm));
+      TCD0.CTRLB   = TCD_WGMODE_ONERAMP_gc;
+      TCD0.CTRLC   = 0;
+      TCD0.CMPBCLR = 255;               // TOP - 256 counts
+      TCD0.CMPACLR = 255;
+      TCD0.CMPASET = 127;               // 50%: silence
+      TCD0.CMPBSET = 255;
+      _PROTECTED_WRITE(TCD0.FAULTCTRL, TCD_CMPAEN_bm);
+      pinMode(_PCM_PIN_TCD0, OUTPUT);
+      TCD0.CTRLA   = TCD_CLKSEL_20MHZ_gc | TCD_CNTPRES_DIV1_gc | TCD_ENABLE_bm;
+    #else
+      return false;
+    #endif
+  } else if (timer == PCM_TCA0) {
+    #if !defined(MILLIS_USE_TIMERA0)
+      stop();
+      takeOverTCA0();                   // which resets it - single mode, everything 0
+      TCA0.SINGLE.PER     = 255;
+      TCA0.SINGLE.CMP0    = 128;
+      TCA0.SINGLE.CTRLB   = TCA_SINGLE_CMP0EN_bm | TCA_SINGLE_WGMODE_SINGLESLOPE_gc;
+      pinMode(_PCM_PIN_TCA0, OUTPUT);
+      TCA0.SINGLE.CTRLA   = TCA_SINGLE_CLKSEL_DIV1_gc | TCA_SINGLE_ENABLE_bm;
+    #else
+      return false;
+    #endif
+  } else {
+    return false;
+  }
+  _pcm_timer = timer;
+  _start     = _pcm_pwm_start;
+  _stop      = _pcm_pwm_stop;
+  return true;
+}
+
+#else
+bool PCMAudioClass::beginPWM(__attribute__((unused)) uint8_t timer) {
+  return false;     // millis is using the only TCB - nothing to pace it with.
+}
+#endif
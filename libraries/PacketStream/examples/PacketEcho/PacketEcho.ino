@@ -0,0 +1,37 @@
+/* PacketEcho - send back every packet that arrives on Serial, with its bytes in reverse order.
+ *
+ * Packets are COBS framed, with a CRC-16 on the end: each one is sent as bytes that are never 0, followed by a 0.
+ * A packet that's damaged on the way, or too long for the buffer, is dropped, and counted; every 5 seconds, if there
+ * have been any, the counts are sent as a packet of their own, starting with 0xEE.
+ */
+#include <PacketStream.h>
+
+uint8_t buffer[66];                      // packets of up to 64 bytes, plus the CRC
+PacketStream link(Serial, buffer, sizeof(buffer));
+uint16_t lastErrors = 0;
+uint32_t lastReport = 0;
+
+void setup() {
+  Serial.begin(115200);
+}
+
+void loop() {
+  int16_t length = link.receive();
+  if (length != PACKET_NONE) {
+    uint8_t reply[64];
+    for (uint8_t i = 0; i < length; i++) {
+      reply[i] = link.packet()[length - 1 - i];
+    }
+    link.send(reply, length);
+  }
+  if (millis() - lastReport > 5000) {
+    lastReport = millis();
+    uint16_t errors = link.crcErrors() + link.frameErrors();
+    if (errors != lastErrors) {
+      lastErrors = errors;
+      uint8_t report[5] = {0xEE, (uint8_t)(link.crcErrors() >> 8), (uint8_t)link.crcErrors(),
+                           (uint8_t)(link.frameErrors() >> 8), (uint8_t)link.frameErrors()};
+      link.send(report, 5);
+    }
+  }
+}
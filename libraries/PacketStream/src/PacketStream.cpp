@@ -0,0 +1,183 @@
+/* PacketStream.cpp - see PacketStream.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details */
+
+#include "PacketStream.h"
+#include <util/crc16.h>
+
+#define SLIP_END          (0xC0)
+#define SLIP_ESC          (0xDB)
+#define SLIP_ESC_END      (0xDC)
+#define SLIP_ESC_ESC      (0xDD)
+
+uint16_t PacketStream::crc16(uint16_t crc, uint8_t data) {
+  return _crc_xmodem_update(crc, data);   // the same polynomial, not reflected; only the start value differs
+}
+
+void PacketStream::reset() {
+  _length = 0;
+  _left   = 0;
+  _zero   = false;
+  _drop   = false;
+  _crc    = 0xFFFF;
+}
+
+void PacketStream::_put(uint8_t c) {
+  if (_drop) {
+    return;
+  }
+  if (_length >= _size) {
+    _drop = true;             // too long: throw the rest of it away
+    return;
+  }
+  _buffer[_length++] = c;
+  _crc = crc16(_crc, c);
+}
+
+/* At a delimiter. The CRC is run over the bytes of the CRC too, which comes out as 0 if it was right. */
+int16_t PacketStream::_end() {
+  int16_t result = PACKET_NONE;
+  if (_drop || _left) {       // too long, a bad SLIP escape, or a COBS block cut short
+    _frame_errors++;
+  } else if (_mode & PACKET_NOCRC) {
+    if (_length) {
+      result = _length;
+    }
+  } else if (_length) {       // nothing between two delimiters isn't an error - SLIP sends one before each packet
+    if (_length < 2 || _crc) {
+      _crc_errors++;
+    } else {
+      result = _length - 2;
+    }
+  }
+  reset();                    // the packet stays in the buffer, but the next one will be decoded over it
+  return result;
+}
+
+int16_t PacketStream::_decode(uint8_t c) {
+  if (_mode & PACKET_SLIP) {
+    if (c == SLIP_END) {
+      return _end();
+    }
+    if (_left) {
+      _left = 0;
+      if (c == SLIP_ESC_END) {
+        c = SLIP_END;
+      } else if (c == SLIP_ESC_ESC) {
+        c = SLIP_ESC;
+      } else {
+        _drop = true;
+        return PACKET_NONE;
+      }
+    } else if (c == SLIP_ESC) {
+      _left = 1;
+      return PACKET_NONE;
+    }
+    _put(c);
+  } else {
+    if (!c) {
+      return _end();
+    }
+    if (_left) {
+      _put(c);
+      _left--;
+    } else {                  // a code byte: the block before it (if any) ended in a 0, unless it was a full one
+      if (_zero) {
+        _put(0);
+      }
+      _left = c - 1;
+      _zero = (c != 0xFF);
+    }
+  }
+  return PACKET_NONE;
+}
+
+int16_t PacketStream::receive() {
+  const uint8_t *span;
+  size_t n;
+  while ((n = _stream.peekSpan(&span))) {
+    for (size_t i = 0; i < n; i++) {
+      int16_t length = _decode(span[i]);
+      if (length != PACKET_NONE) {
+        _stream.consume(i + 1);
+        return length;
+      }
+    }
+    _stream.consume(n);
+  }
+  while (_stream.available() > 0) {
+    int16_t length = _decode(_stream.read());
+    if (length != PACKET_NONE) {
+      return length;
+    }
+  }
+  return PACKET_NONE;
+}
+
+/* Bytes from to to of the packet followed by its CRC, with one write() for each of the two that it covers. */
+bool PacketStream::_write(const uint8_t *data, uint8_t length, const uint8_t *crc, uint16_t from, uint16_t to) {
+  bool ok = true;
+  if (from < length) {
+    uint8_t n = (to < length ? to : length) - from;
+    ok = (_stream.write(data + from, n) == n);
+    from += n;
+  }
+  if (from < to) {
+    uint8_t n = to - from;
+    ok &= (_stream.write(crc + from - length, n) == n);
+  }
+  return ok;
+}
+
+bool PacketStream::send(const uint8_t *data, uint8_t length) {
+  uint8_t  crc[2];
+  uint16_t total = length;
+  if (!(_mode & PACKET_NOCRC)) {
+    uint16_t c = 0xFFFF;
+    for (uint8_t i = 0; i < length; i++) {
+      c = crc16(c, data[i]);
+    }
+    crc[0] = c >> 8;
+    crc[1] = c;
+    total += 2;
+  }
+  bool ok = true;
+  uint16_t i = 0;
+  if (_mode & PACKET_SLIP) {
+    ok = (_stream.write(SLIP_END) == 1);       // ends any noise there's been since the last one
+    while (i < total) {
+      uint16_t j = i;
+      uint8_t  c = 0;
+      while (j < total && (c = (j < length ? data[j] : crc[j - length])) != SLIP_END && c != SLIP_ESC) {
+        j++;
+      }
+      ok &= _write(data, length, crc, i, j);
+      if (j < total) {
+        uint8_t escape[2] = {SLIP_ESC, (uint8_t)((c == SLIP_END) ? SLIP_ESC_END : SLIP_ESC_ESC)};
+        ok &= (_stream.write(escape, 2) == 2);
+        j++;
+      }
+      i = j;
+    }
+    ok &= (_stream.write(SLIP_END) == 1);
+  } else {
+    while (1) {
+      // a block: up to 254 bytes that aren't 0, after a code byte of how many plus 1. All but a full one stand for
+      // a 0 after them, the one we're skipping - except the last, which is why a packet ending in 0 (or an empty
+      // one) gets an empty block on the end.
+      uint16_t j = i;
+      while (j < total && j - i < 254 && (j < length ? data[j] : crc[j - length])) {
+        j++;
+      }
+      uint8_t code = j - i + 1;
+      ok &= (_stream.write(code) == 1);
+      ok &= _write(data, length, crc, i, j);
+      if (j == total) {
+        break;
+      }
+      i = (code == 0xFF) ? j : j + 1;
+    }
+    ok &= (_stream.write((uint8_t)0) == 1);
+  }
+  return ok;
+}
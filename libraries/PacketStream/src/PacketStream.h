@@ -0,0 +1,66 @@
+/* PacketStream.h - COBS or SLIP framed packets with a CRC-16, over any Stream
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * receive() decodes whatever has arrived since the last call into the packet buffer, a byte at a time but as it's
+ * scanned, and says when a whole packet with a good CRC is there. With a Stream that has peekSpan() and consume() -
+ * Serial and Serial1 - the bytes are decoded straight out of its RX buffer, one virtual call per run of them instead
+ * of an available() and a read() per byte; with others, like SoftwareSerial, it falls back on read(). send() encodes
+ * a packet with as few write() calls as the framing allows: every run of bytes that need no stuffing is written
+ * straight from the caller's buffer in one. See README.md.
+ */
+#ifndef PACKETSTREAM_H
+#define PACKETSTREAM_H
+
+#include <Arduino.h>
+
+#define PACKET_COBS           (0x00)  // Consistent Overhead Byte Stuffing, each packet ending in a 0x00
+#define PACKET_SLIP           (0x01)  // RFC 1055, each packet between two 0xC0s
+#define PACKET_NOCRC          (0x80)  // or'ed in - no CRC-16 on the end
+#define PACKET_NONE           (-1)    // from receive(), when there's no complete packet yet
+
+class PacketStream {
+  public:
+    /* Received packets are decoded into buffer, which has to be big enough for the largest packet plus its CRC (2
+     * bytes), up to 255. */
+    PacketStream(Stream &stream, uint8_t *buffer, uint8_t size, uint8_t mode = PACKET_COBS) :
+      _stream(stream), _buffer(buffer), _size(size), _mode(mode), _crc_errors(0), _frame_errors(0) {
+      reset();
+    }
+    /* The length of the packet now in the buffer (not counting the CRC) - valid until the next receive() - or
+     * PACKET_NONE. Call it often enough that the Stream's RX buffer doesn't overflow; it only reads up to the end
+     * of a packet, so it can be called again straight away for the next. */
+    int16_t  receive();
+    const uint8_t *packet() {
+      return _buffer;
+    }
+    bool     send(const uint8_t *data, uint8_t length);  // false if the Stream took less than all of it
+    void     reset();                                     // forget a packet that's part way through
+    uint16_t crcErrors() {
+      return _crc_errors;
+    }
+    uint16_t frameErrors() {                              // malformed, or too long for the buffer
+      return _frame_errors;
+    }
+
+    static uint16_t crc16(uint16_t crc, uint8_t data);    // CRC-16/CCITT-FALSE: 0x1021, from 0xFFFF
+
+  private:
+    int16_t  _decode(uint8_t c);                           // the length at the end of a good packet
+    void     _put(uint8_t c);
+    int16_t  _end();
+    bool     _write(const uint8_t *data, uint8_t length, const uint8_t *crc, uint16_t from, uint16_t to);
+    Stream  &_stream;
+    uint8_t *_buffer;
+    uint8_t  _size;
+    uint8_t  _mode;
+    uint8_t  _length;
+    uint8_t  _left;                                        // COBS: bytes to go in this block; SLIP: 1 after ESC
+    bool     _zero;                                        // COBS: a 0 goes before the next block's bytes
+    bool     _drop;                                        // discarding up to the next delimiter
+    uint16_t _crc;
+    uint16_t _crc_errors;
+    uint16_t _frame_errors;
+};
+
+#endif
@@ -0,0 +1,40 @@
+/* ProfileISR - measure how long a function and an ISR take, in clock cycles.
+ * Comment out the #define and all the PROF_ lines compile to nothing.
+ */
+#define PROFILER_ENABLE
+#include <Profiler.h>
+
+volatile uint8_t count;
+
+void onPinChange() {
+  PROF_BEGIN(1);
+  count++;
+  PROF_END(1);
+}
+
+uint16_t slowThing(uint16_t x) {
+  for (uint8_t i = 0; i < 10; i++) {
+    x = (x << 1) ^ (x >> 3) ^ i;
+  }
+  return x;
+}
+
+void setup() {
+  Serial.begin(115200);
+  PROF_INIT();
+  pinMode(PIN_PA1, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(PIN_PA1), onPinChange, CHANGE);
+}
+
+void loop() {
+  static uint16_t x = 1;
+  PROF_BEGIN(0);
+  x = slowThing(x);
+  PROF_END(0);
+  static uint32_t last;
+  if (millis() - last > 1000) {
+    last = millis();
+    PROF_DUMP(Serial);   // id count min max total
+    PROF_RESET();
+  }
+}
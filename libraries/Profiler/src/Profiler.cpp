@@ -0,0 +1,86 @@
+/* Profiler.cpp - see Profiler.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details */
+
+#include "Profiler.h"
+
+ProfilerClass Profiler;
+
+void ProfilerClass::begin(volatile TCB_t *timer) {
+  _timer          = timer;
+  timer->CTRLA    = 0;
+  timer->CTRLB    = TCB_CNTMODE_INT_gc;  // periodic interrupt mode, with no interrupt - it just counts 0 to 0xFFFF.
+  timer->INTCTRL  = 0;
+  timer->EVCTRL   = 0;
+  timer->CCMP     = 0xFFFF;
+  timer->CNT      = 0;
+  timer->CTRLA    = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;
+  reset();
+}
+
+void ProfilerClass::end() {
+  if (_timer) {
+    _timer->CTRLA = 0;
+    _timer        = NULL;
+  }
+}
+
+void ProfilerClass::reset() {
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < PROFILER_SLOTS; i++) {
+    _stats[i].count = 0;
+    _stats[i].min   = 0xFFFF;
+    _stats[i].max   = 0;
+    _stats[i].total = 0;
+  }
+  SREG = oldSREG;
+}
+
+void ProfilerClass::record(uint8_t id, uint16_t elapsed) {
+  if (id >= PROFILER_SLOTS) {
+    return;
+  }
+  elapsed = (elapsed > _overhead) ? elapsed - _overhead : 0;
+  uint8_t oldSREG = SREG;
+  cli(); // the same id could be used in an ISR and outside of one - that won't give meaningful numbers, but shouldn't corrupt them.
+  profiler_stat_t *s = &_stats[id];
+  s->count++;
+  s->total += elapsed;
+  if (elapsed < s->min) {
+    s->min = elapsed;
+  }
+  if (elapsed > s->max) {
+    s->max = elapsed;
+  }
+  SREG = oldSREG;
+}
+
+void ProfilerClass::get(uint8_t id, profiler_stat_t *stat) {
+  if (id >= PROFILER_SLOTS) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  *stat = _stats[id];
+  SREG = oldSREG;
+}
+
+void ProfilerClass::dump(UartClass &port) {
+  // One line per id that has been used: id, count, min, max, total - all hex, in clock cycles.
+  for (uint8_t i = 0; i < PROFILER_SLOTS; i++) {
+    profiler_stat_t s;
+    get(i, &s);
+    if (s.count) {
+      port.printHex(i);
+      port.write(' ');
+      port.printHex(s.count);
+      port.write(' ');
+      port.printHex(s.min);
+      port.write(' ');
+      port.printHex(s.max);
+      port.write(' ');
+      port.printHexln(s.total);
+    }
+  }
+}
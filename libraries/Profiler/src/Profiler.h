@@ -0,0 +1,81 @@
+/* Profiler.h - cycle counting for code sections, using a type B timer clocked from CLK_PER.
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * #define PROFILER_ENABLE before #include <Profiler.h> to turn it on - otherwise every PROF_ macro is empty,
+ * so the instrumentation can be left in the code. See README.md.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+#define PROFILER_SLOTS    (8)
+
+typedef struct {
+  uint16_t count;   // times PROF_END() was reached (wraps around)
+  uint16_t min;     // clock cycles, less the measurement overhead
+  uint16_t max;
+  uint32_t total;
+} profiler_stat_t;
+
+class ProfilerClass {
+  public:
+    void begin(volatile TCB_t *timer);
+    void end();
+    void reset();
+    void record(uint8_t id, uint16_t elapsed);
+    void get(uint8_t id, profiler_stat_t *stat);
+    void dump(UartClass &port);
+    // Used by the macros - they need to be inlined at the place being measured.
+    uint16_t  _start[PROFILER_SLOTS];
+    uint16_t  _overhead;
+  private:
+    profiler_stat_t _stats[PROFILER_SLOTS];
+    volatile TCB_t *_timer;
+};
+
+extern ProfilerClass Profiler;
+
+#if defined(PROFILER_ENABLE)
+  #if !defined(PROFILER_TIMER) // pick a TCB that millis isn't using; TCB1 if we have one, since tone() uses TCB0.
+    #if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+      #define PROFILER_TIMER TCB1
+    #elif !defined(MILLIS_USE_TIMERB0)
+      #define PROFILER_TIMER TCB0
+    #else
+      #error "Profiler needs a type B timer and millis is using the only one. #define PROFILER_TIMER to override."
+    #endif
+  #endif
+  /* CNT is read through the TEMP register, which an ISR that also reads it would clobber, so interrupts are off
+   * for the read. That, like everything else in here, is a fixed cost which PROF_INIT() measures, and record()
+   * takes back off. */
+  static inline __attribute__((always_inline)) uint16_t _prof_now() {
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t t = PROFILER_TIMER.CNT;
+    SREG = oldSREG;
+    return t;
+  }
+  #define PROF_INIT()       do {                                           \
+                              Profiler.begin(&PROFILER_TIMER);             \
+                              Profiler._start[0] = _prof_now();            \
+                              uint16_t _prof_t   = _prof_now();            \
+                              Profiler._overhead = _prof_t - Profiler._start[0]; \
+                            } while (0)
+  #define PROF_BEGIN(id)    (Profiler._start[(id)] = _prof_now())
+  #define PROF_END(id)      do {                                           \
+                              uint16_t _prof_t = _prof_now();              \
+                              Profiler.record((id), _prof_t - Profiler._start[(id)]); \
+                            } while (0)
+  #define PROF_RESET()      Profiler.reset()
+  #define PROF_DUMP(port)   Profiler.dump(port)
+#else
+  #define PROF_INIT()       do {} while (0)
+  #define PROF_BEGIN(id)    do {} while (0)
+  #define PROF_END(id)      do {} while (0)
+  #define PROF_RESET()      do {} while (0)
+  #define PROF_DUMP(port)   do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+/*
+  ISR Logger
+
+  This example logs a reading taken in a pin interrupt, and one taken
+  in loop(), to a file on an SD card with SDLogger. The records go
+  into a RAM ring buffer, and are written out a whole block at a time
+  by logger.task() - the interrupt never has to wait for the card.
+
+  Send anything over serial to stop logging and close the file.
+
+  The circuit:
+  - SD card attached to SPI, CS on the default SS pin
+  - a signal to count on PIN_PA5
+
+  This example code is in the public domain.
+*/
+
+#include <SD.h>
+#include <SDLogger.h>
+
+const char filename[] = "isrlog.bin";
+
+uint8_t ring[1024];             // two blocks: one fills while the other is written
+SDLogger logger(ring, sizeof(ring));
+
+struct record_t {
+  uint8_t  source;
+  uint32_t time;
+};
+
+void onEdge() {
+  record_t rec = {1, micros()};
+  logger.log(&rec, sizeof(rec));
+}
+
+void setup() {
+  Serial.begin(115200);
+  if (!SD.begin()) {
+    Serial.println("Card failed, or not present");
+    while (1);
+  }
+  SD.remove(filename);
+  if (!logger.begin(filename, 1048576UL)) {   // room for 1 MB
+    Serial.println("Couldn't create the file");
+    while (1);
+  }
+  attachInterrupt(digitalPinToInterrupt(PIN_PA5), onEdge, RISING);
+}
+
+void loop() {
+  static uint32_t last = 0;
+  if (millis() - last >= 10) {
+    last = millis();
+    record_t rec = {0, last};
+    logger.log(&rec, sizeof(rec));
+  }
+  if (!logger.task()) {
+    Serial.println("Card error");
+  }
+  if (Serial.available()) {
+    detachInterrupt(digitalPinToInterrupt(PIN_PA5));
+    logger.end();
+    Serial.print("Written: ");
+    Serial.print(logger.bytesWritten());
+    Serial.print(" High water: ");
+    Serial.print(logger.highWater());
+    Serial.print(" Dropped: ");
+    Serial.println(logger.dropped());
+    while (1);
+  }
+}
@@ -0,0 +1,64 @@
+/*
+  Raw Log
+
+  This example logs an analog reading and the time it was taken, as
+  fast as loop() goes round, with SDRawLog: fixed size records, written
+  a block at a time in one long multiple block write, to the blocks of a
+  contiguous file used as a ring. Nothing of the filesystem is touched
+  while it logs. When the sketch starts again, it carries on where the
+  log left off.
+
+  Send 'd' over serial to stop and dump the log, or 'f' to empty it.
+
+  The circuit:
+  - SD card attached to SPI, CS on the default SS pin
+  - a voltage to measure on PIN_PA1
+
+  This example code is in the public domain.
+*/
+
+#include <SD.h>
+#include <SDRawLog.h>
+
+SDRawLog rawlog;
+
+struct record_t {
+  uint32_t time;
+  uint16_t value;
+};
+
+void setup() {
+  Serial.begin(115200);
+  if (!SD.begin()) {
+    Serial.println("Card failed, or not present");
+    while (1);
+  }
+  // 4 MB of ring, created the first time
+  if (!rawlog.begin("rawlog.bin", sizeof(record_t), 4194304UL)) {
+    Serial.println("Couldn't open or create the log");
+    while (1);
+  }
+  Serial.print("Next block: ");
+  Serial.println(rawlog.sequence());
+}
+
+void loop() {
+  record_t rec = {micros(), (uint16_t) analogRead(PIN_PA1)};
+  if (!rawlog.log(&rec)) {
+    Serial.println("Card error");
+  }
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 'f') {
+      rawlog.format();
+    } else if (c == 'd') {
+      rawlog.rewind();
+      while (rawlog.readNext(&rec)) {
+        Serial.print(rec.time);
+        Serial.print(',');
+        Serial.println(rec.value);
+      }
+      while (1);
+    }
+  }
+}
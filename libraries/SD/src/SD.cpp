@@ -486,6 +486,33 @@ namespace SDLib {
     return File(file, filepath);
   }
 
+  File SDClass::openByIndex(const char *dirpath, uint16_t index, uint8_t mode) {
+    /*
+
+       Open the index'th entry of a directory, reading just that entry. The
+       name is taken from it.
+
+    */
+    File dir = open(dirpath);
+    if (!dir.isDirectory()) {
+      dir.close();
+      return File();
+    }
+    SdFile file;
+    dir_t p;
+    if (!file.open(dir._file, index, mode) || !file.dirEntry(&p)) {
+      dir.close();
+      return File();
+    }
+    dir.close();
+    char name[13];
+    SdFile::dirName(p, name);
+    if ((mode & (O_APPEND | O_WRITE)) == (O_APPEND | O_WRITE)) {
+      file.seekSet(file.fileSize());
+    }
+    return File(file, name);
+  }
+
 
   /*
     File SDClass::open(char *filepath, uint8_t mode) {
@@ -613,7 +640,9 @@ namespace SDLib {
       // Serial.print("try to open file ");
       // Serial.println(name);
 
-      if (f.open(_file, name, mode)) {
+      // by where it is, not by name - that would search the directory again
+      // from the start, for every file
+      if (f.open(_file, (_file->curPosition() >> 5) - 1, mode)) {
         // Serial.println("OK!");
         return File(f, name);
       } else {
@@ -53,6 +53,8 @@ namespace SDLib {
       void rewindDirectory(void);
 
       using Print::write;
+
+      friend class SDClass;
   };
 
   class SDClass {
@@ -81,6 +83,10 @@ namespace SDLib {
       File open(const String &filename, uint8_t mode = FILE_READ) {
         return open(filename.c_str(), mode);
       }
+      // Open the entry at index in the directory dirpath - counting every
+      // 32 byte entry, used or not, as openNextFile() goes through them -
+      // without searching for it by name.
+      File openByIndex(const char *dirpath, uint16_t index, uint8_t mode = FILE_READ);
 
       // Methods to determine if the requested file path exists.
       boolean exists(const char *filepath);
@@ -116,6 +122,8 @@ namespace SDLib {
       int fileOpenMode;
 
       friend class File;
+      friend class SDLogger;
+      friend class SDRawLog;
       friend boolean callback_openPath(SdFile &, const char *, boolean, void *);
   };
 
@@ -0,0 +1,144 @@
+/*
+
+  SDLogger - logging to an SD card from ISRs and tight loops
+
+  License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+*/
+
+#include "SDLogger.h"
+
+#define SDLOGGER_OPEN   0x01      // begin() succeeded, end() hasn't been called
+#define SDLOGGER_FULL   0x02      // every block of the file has been written
+
+namespace SDLib {
+
+  SDLogger::SDLogger(uint8_t *buffer, uint16_t size) {
+    _buffer    = buffer;
+    _size      = size & ~0x1FF;
+    _head      = 0;
+    _tail      = 0;
+    _count     = 0;
+    _state     = 0;
+    _highWater = 0;
+    _dropped   = 0;
+  }
+
+  boolean SDLogger::begin(const char *filename, uint32_t maxSize) {
+    if (_state || !_size || !_file.createContiguous(&SD.root, filename, maxSize)) {
+      return false;
+    }
+    if (!_file.contiguousRange(&_firstBlock, &_lastBlock)) {
+      _file.remove();
+      return false;
+    }
+    // the blocks are written around the cache, so nothing of the file may be in it
+    SdVolume::cacheClear();
+    _block     = _firstBlock;
+    _head      = 0;
+    _tail      = 0;
+    _count     = 0;
+    _highWater = 0;
+    _dropped   = 0;
+    _state     = SDLOGGER_OPEN;
+    return true;
+  }
+
+  boolean SDLogger::log(const void *record, uint8_t length) {
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(record);
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t count = _count;
+    if (_state != SDLOGGER_OPEN || length > _size - count) {
+      _dropped++;
+      SREG = oldSREG;
+      return false;
+    }
+    uint16_t head = _head;
+    for (uint8_t i = 0; i < length; i++) {
+      _buffer[head++] = src[i];
+      if (head == _size) {
+        head = 0;
+      }
+    }
+    _head = head;
+    count += length;
+    _count = count;
+    if (count > _highWater) {
+      _highWater = count;
+    }
+    SREG = oldSREG;
+    return true;
+  }
+
+  // Write count blocks from the tail of the ring, as one multiple block write,
+  // handing each back to log() as soon as it's out.
+  boolean SDLogger::writeBlocks(uint16_t count) {
+    if (!SD.card.writeStart(_block, count)) {
+      return false;
+    }
+    while (count--) {
+      if (!SD.card.writeData(_buffer + _tail)) {
+        return false;
+      }
+      _block++;
+      _tail += 512;
+      if (_tail == _size) {
+        _tail = 0;
+      }
+      uint8_t oldSREG = SREG;
+      cli();
+      _count -= 512;
+      SREG = oldSREG;
+    }
+    return SD.card.writeStop();
+  }
+
+  boolean SDLogger::task() {
+    if (!(_state & SDLOGGER_OPEN) || (_state & SDLOGGER_FULL)) {
+      return true;
+    }
+    uint8_t oldSREG = SREG;
+    cli();
+    uint16_t blocks = _count >> 9;
+    SREG = oldSREG;
+    if (!blocks) {
+      return true;
+    }
+    uint32_t left = _lastBlock - _block + 1;
+    if (blocks > left) {
+      blocks = left;
+    }
+    boolean ok = writeBlocks(blocks);
+    if (_block > _lastBlock) {
+      _state |= SDLOGGER_FULL;    // log() drops everything from now on
+    }
+    return ok;
+  }
+
+  boolean SDLogger::end() {
+    if (!(_state & SDLOGGER_OPEN)) {
+      return false;
+    }
+    boolean ok = task();
+    _state = 0;                   // log() can't add anything now
+    uint32_t size = bytesWritten();
+    uint16_t partial = _count;
+    if (ok && partial && _block <= _lastBlock) {
+      // the rest of the block after it is free, since the ring is whole blocks
+      uint8_t *last = _buffer + _tail;
+      for (uint16_t i = partial; i < 512; i++) {
+        last[i] = 0;
+      }
+      ok = SD.card.writeBlock(_block, last);
+      if (ok) {
+        size += partial;
+      }
+    }
+    _count = 0;
+    ok = _file.truncate(size) && ok;
+    return _file.close() && ok;
+  }
+
+};
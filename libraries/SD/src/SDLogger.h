@@ -0,0 +1,74 @@
+/*
+
+  SDLogger - logging to an SD card from ISRs and tight loops
+
+  Records go into a RAM ring buffer, which never waits for the card, and are
+  written out from loop() a whole 512 byte block at a time, straight from the
+  ring, into a file created with createContiguous() - one multiple block write
+  per call, with no FAT updates and no cluster allocation while logging.
+
+  License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+*/
+
+#ifndef __SDLOGGER_H__
+#define __SDLOGGER_H__
+
+#include "SD.h"
+
+namespace SDLib {
+
+  class SDLogger {
+    public:
+      // buffer is the ring, size a multiple of 512 - 1024 or more, so records
+      // keep going in while a block is being written.
+      SDLogger(uint8_t *buffer, uint16_t size);
+
+      // Create filename (which must not exist yet), with room for maxSize bytes.
+      // SD.begin() must have been called.
+      boolean begin(const char *filename, uint32_t maxSize);
+
+      // Add a record. Safe in an ISR, and in loop() at the same time - interrupts
+      // are off while it's copied in. If there isn't room for all of it, none of
+      // it goes in, it's counted as dropped, and false is returned.
+      boolean log(const void *record, uint8_t length);
+
+      // Call from loop(): writes out the full blocks in the ring. false if the
+      // card returned an error.
+      boolean task();
+
+      // Write out the rest, the last block padded with zeros, trim the file to
+      // what was logged, and close it.
+      boolean end();
+
+      uint16_t highWater() {      // the most the ring has ever held
+        return _highWater;
+      }
+      uint32_t dropped() {        // records that didn't fit
+        return _dropped;
+      }
+      uint32_t bytesWritten() {   // logged bytes on the card so far
+        return (_block - _firstBlock) << 9;
+      }
+
+    private:
+      uint8_t  *_buffer;
+      uint16_t  _size;
+      uint16_t  _head;            // where log() puts the next byte
+      uint16_t  _tail;            // start of the next block to write, a multiple of 512
+      volatile uint16_t _count;   // bytes in the ring
+      volatile uint8_t  _state;   // SDLOGGER_OPEN, SDLOGGER_FULL
+      uint16_t  _highWater;
+      uint32_t  _dropped;
+      uint32_t  _firstBlock;
+      uint32_t  _block;           // next block of the file to write
+      uint32_t  _lastBlock;
+      SdFile    _file;
+
+      boolean writeBlocks(uint16_t count);
+  };
+
+};
+
+#endif
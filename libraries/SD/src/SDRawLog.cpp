@@ -0,0 +1,193 @@
+/*
+
+  SDRawLog - fixed size records in a ring of raw blocks, with no filesystem
+
+  License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+*/
+
+#include "SDRawLog.h"
+
+namespace SDLib {
+
+  boolean SDRawLog::begin(Sd2Card &card, uint32_t firstBlock, uint32_t blockCount, uint16_t recordSize) {
+    if (!recordSize || recordSize > 512 - sizeof(SDRawLogHeader) || !blockCount) {
+      return false;
+    }
+    _card       = &card;
+    _firstBlock = firstBlock;
+    _blockCount = blockCount;
+    _recordSize = recordSize;
+    _perBlock   = (512 - sizeof(SDRawLogHeader)) / recordSize;
+    _count      = 0;
+    _streaming  = false;
+    _written    = 0;
+    _readLeft   = 0;
+    _readIndex  = 0xFFFF;
+    _next       = 0;
+    _sequence   = 0;
+    SDRawLogHeader header;
+    if (!readHeader(0, &header)) {
+      return false;
+    }
+    if (header.magic != SDRAWLOG_MAGIC) {
+      return true;                // nothing logged yet
+    }
+    // The blocks written since the ring last came round to the first one
+    // follow on from it in sequence; the ones after them are older, or were
+    // never written. So the last one that does is where the log got to.
+    uint32_t base = header.sequence;
+    uint32_t lo = 0;              // follows on
+    uint32_t hi = blockCount;     // doesn't, or is past the end
+    while (hi - lo > 1) {
+      uint32_t mid = lo + ((hi - lo) >> 1);
+      if (!readHeader(mid, &header)) {
+        return false;
+      }
+      if (header.magic == SDRAWLOG_MAGIC && header.sequence == base + mid) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    _sequence = base + lo + 1;
+    _next     = (lo + 1 == blockCount) ? 0 : lo + 1;
+    return true;
+  }
+
+  boolean SDRawLog::begin(const char *filename, uint16_t recordSize, uint32_t size) {
+    SdFile file;
+    boolean created = false;
+    if (!file.open(&SD.root, filename, O_READ)) {
+      if (!size || !file.createContiguous(&SD.root, filename, size)) {
+        return false;
+      }
+      created = true;
+    }
+    uint32_t first, last;
+    boolean ok = file.contiguousRange(&first, &last);
+    file.close();
+    if (!ok) {
+      return false;
+    }
+    // the blocks are written around the cache, so nothing of the file may be in it
+    SdVolume::cacheClear();
+    if (!begin(SD.card, first, last - first + 1, recordSize)) {
+      return false;
+    }
+    // whatever a new file's blocks held before, it isn't a log
+    return created ? format() : true;
+  }
+
+  // The log is started again with an empty block at the start of the ring,
+  // numbered past every block that could be left over in it, so none of
+  // them look like they follow on from it.
+  boolean SDRawLog::format() {
+    if (!_card || !flush()) {
+      return false;
+    }
+    _sequence += _blockCount;
+    _next      = 0;
+    return writeBuffer() && flush();
+  }
+
+  boolean SDRawLog::log(const void *record) {
+    if (!_card) {
+      return false;
+    }
+    // a block that couldn't be written is tried again first
+    if (_count == _perBlock && !writeBuffer()) {
+      return false;
+    }
+    memcpy(_buffer + sizeof(SDRawLogHeader) + _count * _recordSize, record, _recordSize);
+    if (++_count == _perBlock) {
+      return writeBuffer();
+    }
+    return true;
+  }
+
+  boolean SDRawLog::writeBuffer() {
+    SDRawLogHeader *header = reinterpret_cast<SDRawLogHeader *>(_buffer);
+    header->magic    = SDRAWLOG_MAGIC;
+    header->count    = _count;
+    header->sequence = _sequence;
+    if (!_streaming) {
+      // pre-erase everything up to the end of the ring
+      if (!_card->writeStart(_firstBlock + _next, _blockCount - _next)) {
+        return false;
+      }
+      _streaming = true;
+    }
+    if (!_card->writeData(_buffer)) {
+      _streaming = false;
+      return false;
+    }
+    _count = 0;
+    _sequence++;
+    _written++;
+    if (++_next == _blockCount) {
+      _next      = 0;
+      _streaming = false;
+      return _card->writeStop();
+    }
+    return true;
+  }
+
+  boolean SDRawLog::flush() {
+    if (_count && !writeBuffer()) {
+      return false;
+    }
+    if (_streaming) {
+      _streaming = false;
+      return _card->writeStop();
+    }
+    return true;
+  }
+
+  boolean SDRawLog::readHeader(uint32_t block, SDRawLogHeader *header) {
+    return _card->readData(_firstBlock + block, 0, sizeof(SDRawLogHeader), reinterpret_cast<uint8_t *>(header));
+  }
+
+  boolean SDRawLog::rewind() {
+    if (!_card || !flush()) {
+      return false;
+    }
+    // if the ring has come round, the block to be written next is the oldest
+    SDRawLogHeader header;
+    if (!readHeader(_next, &header)) {
+      return false;
+    }
+    if (header.magic == SDRAWLOG_MAGIC && header.sequence == _sequence - _blockCount) {
+      _readBlock = _next;
+      _readLeft  = _blockCount;
+    } else {
+      _readBlock = 0;
+      _readLeft  = _next;
+    }
+    _readIndex = 0xFFFF;
+    return true;
+  }
+
+  boolean SDRawLog::readNext(void *record) {
+    SDRawLogHeader *header = reinterpret_cast<SDRawLogHeader *>(_buffer);
+    while (_readIndex == 0xFFFF || _readIndex >= header->count) {
+      if (!_readLeft) {
+        return false;
+      }
+      if (!_card->readBlock(_firstBlock + _readBlock, _buffer)) {
+        return false;
+      }
+      if (header->magic != SDRAWLOG_MAGIC || header->count > _perBlock) {
+        header->count = 0;
+      }
+      _readIndex = 0;
+      _readBlock = (_readBlock + 1 == _blockCount) ? 0 : _readBlock + 1;
+      _readLeft--;
+    }
+    memcpy(record, _buffer + sizeof(SDRawLogHeader) + _readIndex * _recordSize, _recordSize);
+    _readIndex++;
+    return true;
+  }
+
+};
@@ -0,0 +1,92 @@
+/*
+
+  SDRawLog - fixed size records in a ring of raw blocks, with no filesystem
+
+  The records go into a 512 byte block buffer, and each full block is sent
+  with one long multiple block write that stays open from block to block,
+  so logging runs at close to the SPI rate. The blocks are either a range on
+  the card that's kept for it, or the blocks of a contiguous file. Each block
+  starts with a header giving its sequence number; begin() finds where the
+  log left off with a binary search over them, and carries on after it,
+  overwriting the oldest block once the ring is full.
+
+  License: GNU General Public License V3
+          (Because sdfatlib is licensed with this.)
+
+*/
+
+#ifndef __SDRAWLOG_H__
+#define __SDRAWLOG_H__
+
+#include "SD.h"
+
+#define SDRAWLOG_MAGIC  0x4C52      // "RL"
+
+namespace SDLib {
+
+  struct SDRawLogHeader {          // at the start of every block
+    uint16_t magic;                 // SDRAWLOG_MAGIC
+    uint16_t count;                 // records in this block
+    uint32_t sequence;              // one more than the block written before it
+  };
+
+  class SDRawLog {
+    public:
+      // Log to blocks firstBlock to firstBlock + blockCount - 1 of an
+      // initialized card. recordSize is at most 504 (512 less the header).
+      boolean begin(Sd2Card &card, uint32_t firstBlock, uint32_t blockCount, uint16_t recordSize);
+
+      // Log to the blocks of filename, created with room for size bytes if
+      // it doesn't exist yet. SD.begin() must have been called, and the file
+      // must be contiguous, as createContiguous() makes them.
+      boolean begin(const char *filename, uint16_t recordSize, uint32_t size = 0);
+
+      // Erase every block of the ring, and start the log again from nothing.
+      boolean format();
+
+      // Add a record of recordSize bytes. When that fills the block, the block
+      // is written before it returns. Not for ISRs - see SDLogger for that.
+      boolean log(const void *record);
+
+      // Write the block that's being filled, even if it isn't full, and end
+      // the multiple block write so something else can use the SPI bus. The
+      // next record starts a new block.
+      boolean flush();
+      boolean end() {
+        return flush();
+      }
+
+      // Read the log back, oldest record first; rewind() flushes it first.
+      boolean rewind();
+      boolean readNext(void *record);
+
+      uint32_t blocksWritten() {    // since begin()
+        return _written;
+      }
+      uint32_t sequence() {         // of the next block to be written
+        return _sequence;
+      }
+
+    private:
+      Sd2Card  *_card = NULL;
+      uint32_t  _firstBlock;
+      uint32_t  _blockCount;
+      uint32_t  _next;              // block to be written next, from _firstBlock
+      uint32_t  _sequence;
+      uint32_t  _written;
+      uint16_t  _recordSize;
+      uint16_t  _perBlock;          // records in a full block
+      uint16_t  _count;             // records in _buffer
+      boolean   _streaming;         // a multiple block write is open
+      uint32_t  _readBlock;         // where readNext() is, from _firstBlock
+      uint32_t  _readLeft;          // blocks it has still to read, this one included
+      uint16_t  _readIndex;         // record in _buffer it returns next, or 0xFFFF when it needs a block
+      uint8_t   _buffer[512];
+
+      boolean writeBuffer();
+      boolean readHeader(uint32_t block, SDRawLogHeader *header);
+  };
+
+};
+
+#endif
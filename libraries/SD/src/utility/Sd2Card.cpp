@@ -109,6 +109,48 @@ void spiSend(uint8_t data) {
 }
 #endif  // SOFTWARE_SPI
 //------------------------------------------------------------------------------
+/** Receive count bytes from the card - with the SPI library's buffered block
+    transfer, there's no gap between the bytes. */
+static void spiRecBlock(uint8_t *dst, uint16_t count) {
+  #if defined(USE_SPI_LIB) && !defined(SOFTWARE_SPI)
+  SDCARD_SPI.readBytes(dst, count);
+  #else
+  for (uint16_t i = 0; i < count; i++) {
+    dst[i] = spiRec();
+  }
+  #endif
+}
+//------------------------------------------------------------------------------
+/** Send count bytes to the card */
+static void spiSendBlock(const uint8_t *src, uint16_t count) {
+  #if defined(USE_SPI_LIB) && !defined(SOFTWARE_SPI)
+  SDCARD_SPI.writeBytes(src, count);
+  #else
+  for (uint16_t i = 0; i < count; i++) {
+    spiSend(src[i]);
+  }
+  #endif
+}
+#if SD_USE_CRC
+//------------------------------------------------------------------------------
+#include <util/crc16.h>
+/** CRC16 (CCITT, as the card uses for data blocks) of a 512 byte block */
+static uint16_t blockCRC(const uint8_t *data) {
+  uint16_t crc = 0;
+  for (uint16_t i = 0; i < 512; i++) {
+    crc = _crc_xmodem_update(crc, data[i]);
+  }
+  return crc;
+}
+//------------------------------------------------------------------------------
+/** Receive the two CRC bytes that follow a block, and check them against it */
+static uint8_t blockCRCMatches(const uint8_t *data) {
+  uint16_t crc = spiRec() << 8;
+  crc |= spiRec();
+  return crc == blockCRC(data);
+}
+#endif  // SD_USE_CRC
+//------------------------------------------------------------------------------
 // send command and return error code.  Return zero for OK
 uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   // end read if in partialBlockRead mode
@@ -173,6 +215,17 @@ uint32_t Sd2Card::cardSize(void) {
 }
 //------------------------------------------------------------------------------
 static uint8_t chip_select_asserted = 0;
+#if SD_ASYNC_BUFFER
+// the second block buffer, and what's going on with it
+static uint8_t sd_async_buffer[512];
+static uint32_t sd_async_block = 0XFFFFFFFF;  // the block it holds, if valid
+static volatile uint8_t sd_async_op = 0;      // SD_ASYNC_READ or _WRITE while one runs
+static uint8_t sd_async_failed = 0;           // a write-behind wasn't accepted
+static uint16_t sd_async_crc;
+static Sd2Card *sd_async_card;
+uint8_t const SD_ASYNC_READ = 1;
+uint8_t const SD_ASYNC_WRITE = 2;
+#endif
 
 void Sd2Card::chipSelectHigh(void) {
   digitalWrite(chipSelectPin_, HIGH);
@@ -185,6 +238,10 @@ void Sd2Card::chipSelectHigh(void) {
 }
 //------------------------------------------------------------------------------
 void Sd2Card::chipSelectLow(void) {
+  #if SD_ASYNC_BUFFER
+  // the card stays selected through a background transfer - wait it out
+  while (sd_async_op);
+  #endif
   #ifdef USE_SPI_LIB
   if (!chip_select_asserted) {
     chip_select_asserted = 1;
@@ -212,6 +269,9 @@ uint8_t Sd2Card::erase(uint32_t firstBlock, uint32_t lastBlock) {
     error(SD_CARD_ERROR_ERASE_SINGLE_BLOCK);
     goto fail;
   }
+  #if SD_ASYNC_BUFFER
+  sd_async_block = 0XFFFFFFFF;
+  #endif
   if (type_ != SD_CARD_TYPE_SDHC) {
     firstBlock <<= 9;
     lastBlock <<= 9;
@@ -407,6 +467,21 @@ uint8_t Sd2Card::readData(uint32_t block,
   if ((count + offset) > 512) {
     goto fail;
   }
+  #if SD_ASYNC_BUFFER
+  if (block == sd_async_block) {
+    while (sd_async_op);
+    #if SD_USE_CRC
+    if (sd_async_crc != blockCRC(sd_async_buffer)) {  // a write-behind's matches anyway
+      sd_async_block = 0XFFFFFFFF;
+    }
+    #endif
+    // a failed write-behind, or a bad CRC, leaves nothing here to be had
+    if (block == sd_async_block) {
+      memcpy(dst, sd_async_buffer + offset, count);
+      return true;
+    }
+  }
+  #endif  // SD_ASYNC_BUFFER
   if (!inBlock_ || block != block_ || offset < offset_) {
     block_ = block;
     // use address if not SDHC card
@@ -454,18 +529,97 @@ uint8_t Sd2Card::readData(uint32_t block,
     spiRec();
   }
   // transfer data
-  for (uint16_t i = 0; i < count; i++) {
-    dst[i] = spiRec();
-  }
+  spiRecBlock(dst, count);
   #endif  // OPTIMIZE_HARDWARE_SPI
 
   offset_ += count;
+  #if SD_USE_CRC
+  if (count == 512) {
+    // the whole block was read, so its CRC can be checked
+    offset_ += 2;
+    if (!blockCRCMatches(dst)) {
+      error(SD_CARD_ERROR_READ_CRC);
+      readEnd();
+      return false;
+    }
+  }
+  #endif  // SD_USE_CRC
   if (!partialBlockRead_ || offset_ >= 512) {
     // read rest of data, checksum and set chip select high
     readEnd();
   }
   return true;
 
+fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
+/** Read one data block in a multiple block read sequence
+
+   \param[in] dst Pointer to the location for the 512 bytes read.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readData(uint8_t *dst) {
+  if (!waitStartBlock()) {
+    return false;
+  }
+  spiRecBlock(dst, 512);
+  #if SD_USE_CRC
+  if (!blockCRCMatches(dst)) {
+    error(SD_CARD_ERROR_READ_CRC);
+    chipSelectHigh();
+    return false;
+  }
+  #else
+  spiRec();  // get first crc byte
+  spiRec();  // get second crc byte
+  #endif
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Start a read multiple blocks sequence.
+
+   \param[in] blockNumber Address of first block in sequence.
+
+   \note This function is used with readData() and readStop()
+   for optimized multiple block reads.  The card stays selected
+   for the whole sequence.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readStart(uint32_t blockNumber) {
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) {
+    blockNumber <<= 9;
+  }
+  if (cardCommand(CMD18, blockNumber)) {
+    error(SD_CARD_ERROR_CMD18);
+    goto fail;
+  }
+  return true;
+
+fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+
+  \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readStop(void) {
+  if (cardCommand(CMD12, 0)) {
+    error(SD_CARD_ERROR_CMD12);
+    goto fail;
+  }
+  chipSelectHigh();
+  return true;
+
 fail:
   chipSelectHigh();
   return false;
@@ -620,6 +774,11 @@ uint8_t Sd2Card::writeBlock(uint32_t blockNumber, const uint8_t *src, uint8_t bl
     goto fail;
   }
   #endif  // SD_PROTECT_BLOCK_ZERO
+  #if SD_ASYNC_BUFFER
+  if (blockNumber == sd_async_block) {
+    sd_async_block = 0XFFFFFFFF;
+  }
+  #endif
 
   // use address if not SDHC card
   if (type() != SD_CARD_TYPE_SDHC) {
@@ -686,12 +845,16 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t *src) {
 
   #else  // OPTIMIZE_HARDWARE_SPI
   spiSend(token);
-  for (uint16_t i = 0; i < 512; i++) {
-    spiSend(src[i]);
-  }
+  spiSendBlock(src, 512);
   #endif  // OPTIMIZE_HARDWARE_SPI
+  #if SD_USE_CRC
+  uint16_t crc = blockCRC(src);
+  spiSend(crc >> 8);
+  spiSend(crc);
+  #else
   spiSend(0xff);  // dummy crc
   spiSend(0xff);  // dummy crc
+  #endif
 
   status_ = spiRec();
   if ((status_ & DATA_RES_MASK) != DATA_RES_ACCEPTED) {
@@ -721,6 +884,9 @@ uint8_t Sd2Card::writeStart(uint32_t blockNumber, uint32_t eraseCount) {
     goto fail;
   }
   #endif  // SD_PROTECT_BLOCK_ZERO
+  #if SD_ASYNC_BUFFER
+  sd_async_block = 0XFFFFFFFF;
+  #endif
   // send pre-erase count
   if (cardAcmd(ACMD23, eraseCount)) {
     error(SD_CARD_ERROR_ACMD23);
@@ -775,3 +941,126 @@ uint8_t Sd2Card::isBusy(void) {
 
   return (b != 0XFF);
 }
+#if SD_ASYNC_BUFFER
+//------------------------------------------------------------------------------
+/** Start reading a block into the second buffer in the background, for
+    readData() to take it from there when it's asked for. Does nothing if the
+    buffer already has it, or is busy.
+
+   \param[in] blockNumber Logical block to be read.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure.
+*/
+uint8_t Sd2Card::readAhead(uint32_t blockNumber) {
+  if (sd_async_op || blockNumber == sd_async_block) {
+    return true;
+  }
+  sd_async_block = 0XFFFFFFFF;
+  uint32_t address = blockNumber;
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) {
+    address <<= 9;
+  }
+  if (cardCommand(CMD17, address)) {
+    error(SD_CARD_ERROR_CMD17);
+    goto fail;
+  }
+  if (!waitStartBlock()) {
+    goto fail;
+  }
+  sd_async_card = this;
+  sd_async_block = blockNumber;
+  sd_async_op = SD_ASYNC_READ;
+  SDCARD_SPI.transferAsync(NULL, sd_async_buffer, 512, asyncDone);
+  return true;
+
+fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
+/** Write a 512 byte block in the background. The data is copied to the
+    second buffer first, so src can be reused as soon as this returns; whether
+    the card took it is known by the next asyncWait().
+
+   \param[in] blockNumber Logical block to be written.
+   \param[in] src Pointer to the location of the data to be written.
+
+   \return The value one, true, is returned for success and
+   the value zero, false, is returned for failure - including the failure of
+   the write before it.
+*/
+uint8_t Sd2Card::writeBlockAsync(uint32_t blockNumber, const uint8_t *src) {
+  #if SD_PROTECT_BLOCK_ZERO
+  // don't allow write to first block
+  if (blockNumber == 0) {
+    error(SD_CARD_ERROR_WRITE_BLOCK_ZERO);
+    return false;
+  }
+  #endif  // SD_PROTECT_BLOCK_ZERO
+  if (!asyncWait()) {
+    return false;
+  }
+  memcpy(sd_async_buffer, src, 512);
+  sd_async_block = 0XFFFFFFFF;
+  #if SD_USE_CRC
+  sd_async_crc = blockCRC(sd_async_buffer);
+  #else
+  sd_async_crc = 0XFFFF;  // dummy crc
+  #endif
+  uint32_t address = blockNumber;
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) {
+    address <<= 9;
+  }
+  if (cardCommand(CMD24, address)) {
+    error(SD_CARD_ERROR_CMD24);
+    chipSelectHigh();
+    return false;
+  }
+  spiSend(DATA_START_BLOCK);
+  sd_async_card = this;
+  // the buffer holds what the block will have, if the card takes it
+  sd_async_block = blockNumber;
+  sd_async_op = SD_ASYNC_WRITE;
+  SDCARD_SPI.transferAsync(sd_async_buffer, NULL, 512, asyncDone);
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Wait for the background transfer, if there is one, to finish.
+
+   \return The value one, true, is returned for success and the value zero,
+   false, if the last write-behind wasn't accepted by the card.
+*/
+uint8_t Sd2Card::asyncWait(void) {
+  while (sd_async_op);
+  if (sd_async_failed) {
+    sd_async_failed = 0;
+    error(SD_CARD_ERROR_WRITE);
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// the end of a background transfer, from the SPI interrupt: two CRC bytes
+// and, for a write, the card's data response, then the card is deselected.
+// The card being busy programming a write is left to the next command.
+void Sd2Card::asyncDone(void) {
+  if (sd_async_op == SD_ASYNC_WRITE) {
+    spiSend(sd_async_crc >> 8);
+    spiSend(sd_async_crc);
+    sd_async_card->status_ = spiRec();
+    if ((sd_async_card->status_ & DATA_RES_MASK) != DATA_RES_ACCEPTED) {
+      sd_async_failed = 1;
+      sd_async_block = 0XFFFFFFFF;
+    }
+  } else {
+    // checked by readData(), if SD_USE_CRC is set - it's too slow for here
+    sd_async_crc = spiRec() << 8;
+    sd_async_crc |= spiRec();
+  }
+  sd_async_card->chipSelectHigh();
+  sd_async_op = 0;
+}
+#endif  // SD_ASYNC_BUFFER
@@ -106,6 +106,29 @@ uint8_t const SPI_QUARTER_SPEED = 2;
 //------------------------------------------------------------------------------
 /** Protect block zero from write if nonzero */
 #define SD_PROTECT_BLOCK_ZERO 1
+/**
+   Check the CRC16 of every whole block read, and send the right one with
+   every block written, if nonzero. The card only checks it if CRC checking
+   has been turned on with CMD59, which this library doesn't do.
+*/
+#ifndef SD_USE_CRC
+  #define SD_USE_CRC 0
+#endif
+/**
+   Give the card a second 512 byte block buffer, if nonzero, for read-ahead
+   and write-behind: SdFile::read() has the next block of the file read into
+   it while the sketch works through the one it's on, and SdVolume writes the
+   block cache out from it, so the data goes over SPI from the SPI library's
+   transferAsync() interrupt while the sketch carries on. Only the data phase
+   is in the background - the command, and waiting for the card to have a
+   block ready to send, are not.
+*/
+#ifndef SD_ASYNC_BUFFER
+  #define SD_ASYNC_BUFFER 0
+#endif
+#if SD_ASYNC_BUFFER && (!defined(USE_SPI_LIB) || defined(SOFTWARE_SPI))
+  #error "SD_ASYNC_BUFFER needs the SPI library's transferAsync()"
+#endif
 /** init timeout ms */
 unsigned int const SD_INIT_TIMEOUT = 2000;
 /** erase timeout ms */
@@ -160,6 +183,12 @@ uint8_t const SD_CARD_ERROR_WRITE_PROGRAMMING = 0X14;
 uint8_t const SD_CARD_ERROR_WRITE_TIMEOUT = 0X15;
 /** incorrect rate selected */
 uint8_t const SD_CARD_ERROR_SCK_RATE = 0X16;
+/** card returned an error response for CMD18 (read multiple blocks) */
+uint8_t const SD_CARD_ERROR_CMD18 = 0X17;
+/** card returned an error response for CMD12 (stop multiple block read) */
+uint8_t const SD_CARD_ERROR_CMD12 = 0X18;
+/** the CRC16 of a block read didn't match its data */
+uint8_t const SD_CARD_ERROR_READ_CRC = 0X19;
 //------------------------------------------------------------------------------
 // card types
 /** Standard capacity V1 SD card */
@@ -214,6 +243,9 @@ class Sd2Card {
     uint8_t readBlock(uint32_t block, uint8_t *dst);
     uint8_t readData(uint32_t block,
                      uint16_t offset, uint16_t count, uint8_t *dst);
+    uint8_t readData(uint8_t *dst);
+    uint8_t readStart(uint32_t blockNumber);
+    uint8_t readStop(void);
     /**
        Read a cards CID register. The CID contains card identification
        information such as Manufacturer ID, Product name, Product serial
@@ -241,6 +273,11 @@ class Sd2Card {
     uint8_t writeStart(uint32_t blockNumber, uint32_t eraseCount);
     uint8_t writeStop(void);
     uint8_t isBusy(void);
+    #if SD_ASYNC_BUFFER
+    uint8_t readAhead(uint32_t blockNumber);
+    uint8_t writeBlockAsync(uint32_t blockNumber, const uint8_t *src);
+    uint8_t asyncWait(void);
+    #endif
   private:
     uint32_t block_;
     uint8_t chipSelectPin_;
@@ -269,5 +306,8 @@ class Sd2Card {
     uint8_t waitNotBusy(unsigned int timeoutMillis);
     uint8_t writeData(uint8_t token, const uint8_t *src);
     uint8_t waitStartBlock(void);
+    #if SD_ASYNC_BUFFER
+    static void asyncDone(void);
+    #endif
 };
 #endif  // Sd2Card_h
@@ -35,6 +35,51 @@
 */
 #define ALLOW_DEPRECATED_FUNCTIONS 1
 //------------------------------------------------------------------------------
+/**
+   Clusters to allocate at a time, when possible, for a file opened with
+   O_APPEND, so a log file grows in contiguous chunks and most new clusters
+   need no FAT search. What isn't used is freed by close(); a file that is
+   never closed keeps them in its cluster chain. 1 to allocate one at a time.
+*/
+#ifndef SD_APPEND_PREALLOCATE
+  #define SD_APPEND_PREALLOCATE 8
+#endif
+//------------------------------------------------------------------------------
+/**
+   Give the FAT a 512 byte cache of its own if non-zero. Otherwise FAT blocks
+   and file data share one, and every new cluster while writing a file has the
+   data block written out and the FAT block read in, then the other way around.
+   Only worth the RAM on parts with 2k or more of it.
+*/
+#ifndef SD_FAT_CACHE
+  #define SD_FAT_CACHE 0
+#endif
+//------------------------------------------------------------------------------
+/**
+   Number of runs of consecutive clusters each SdFile remembers, if non-zero.
+   The clusters of a file are learned as it is read, written or seeked
+   through, from the start, so seekSet() can go straight to any of them
+   instead of following the FAT chain from the first cluster - and for a file
+   that contiguousRange() found contiguous, or createContiguous() made, one
+   run covers the whole file. If a file has more fragments than there are runs,
+   the ones after that are followed through the FAT as before, starting from
+   the last one known. Costs 8 bytes per run in every SdFile, plus 5.
+*/
+#ifndef SD_CLUSTER_CACHE
+  #define SD_CLUSTER_CACHE 0
+#endif
+/**
+   Number of files whose place in their directory is remembered, if non-zero,
+   most recently opened first, so opening one of them again - or checking that
+   it exists - reads the one directory entry instead of searching the
+   directory for it. What's remembered is checked against the entry before
+   it's used, so a file that has since been removed or renamed is just
+   searched for as before. Costs 8 bytes per file.
+*/
+#ifndef SD_DIR_CACHE
+  #define SD_DIR_CACHE 0
+#endif
+//------------------------------------------------------------------------------
 // forward declaration since SdVolume is used in SdFile
 class SdVolume;
 //==============================================================================
@@ -445,9 +490,20 @@ class SdFile : public Print {
     uint32_t  fileSize_;      // file size in bytes
     uint32_t  firstCluster_;  // first cluster of file
     SdVolume *vol_;           // volume where file is located
+    #if SD_CLUSTER_CACHE
+    struct {
+      uint32_t index;         // first cluster of the run, counting from the start of the file
+      uint32_t cluster;       // and its cluster number on the volume
+    } runs_[SD_CLUSTER_CACHE];
+    uint32_t  knownClusters_; // clusters 0 to knownClusters_ - 1 are in runs_
+    uint8_t   runCount_;
+    #endif
 
     // private functions
     uint8_t addCluster(void);
+    uint8_t nextCluster(uint32_t index, uint32_t *next);
+    void runsAdd(uint32_t index, uint32_t cluster);
+    void runsReset(uint32_t contiguous = 0);
     uint8_t addDirCluster(void);
     dir_t *cacheDirEntry(uint8_t action);
     static void (*dateTime_)(uint16_t *date, uint16_t *time);
@@ -581,6 +637,26 @@ class SdVolume {
     static Sd2Card *sdCard_;            // Sd2Card object for cache
     static uint8_t cacheDirty_;         // cacheFlush() will write block if true
     static uint32_t cacheMirrorBlock_;  // block number for mirror FAT
+    #if SD_FAT_CACHE
+    static cache_t fatCache_;           // 512 byte cache for FAT blocks only
+    static uint32_t fatCacheBlockNumber_;  // Logical number of block in fatCache_
+    static uint8_t fatCacheDirty_;      // fatCacheFlush() will write block if true
+    static uint32_t fatCacheMirrorBlock_;  // block number for mirror FAT
+    static uint8_t fatCacheBlock(uint32_t blockNumber);
+    static uint8_t fatCacheFlush(void);
+    #endif
+    #if SD_DIR_CACHE
+    struct dirCacheEntry_t {
+      uint32_t dirCluster;  // first cluster of the directory, 0 for a FAT16 root
+      uint16_t hash;        // of the 8.3 name
+      uint16_t index;       // of the entry in the directory, 0XFFFF if unused
+    };
+    static dirCacheEntry_t dirCache_[SD_DIR_CACHE];  // most recently used first
+    static uint16_t dirHash(const uint8_t *name);
+    static uint16_t dirCacheFind(uint32_t dirCluster, uint16_t hash);
+    static void dirCacheAdd(uint32_t dirCluster, uint16_t hash, uint16_t index);
+    static void dirCacheClear(void);
+    #endif
     //
     uint32_t allocSearchStart_;   // start cluster for alloc search
     uint8_t blocksPerCluster_;    // cluster size in blocks
@@ -628,9 +704,23 @@ class SdVolume {
                      uint16_t count, uint8_t *dst) {
       return sdCard_->readData(block, offset, count, dst);
     }
+    #if SD_ASYNC_BUFFER
+    uint8_t readAhead(uint32_t block) {
+      return sdCard_->readAhead(block);
+    }
+    #endif
     uint8_t writeBlock(uint32_t block, const uint8_t *dst, uint8_t blocking = 1) {
       return sdCard_->writeBlock(block, dst, blocking);
     }
+    uint8_t writeStart(uint32_t block, uint32_t eraseCount) {
+      return sdCard_->writeStart(block, eraseCount);
+    }
+    uint8_t writeData(const uint8_t *src) {
+      return sdCard_->writeData(src);
+    }
+    uint8_t writeStop(void) {
+      return sdCard_->writeStop();
+    }
     uint8_t isBusy(void) {
       return sdCard_->isBusy();
     }
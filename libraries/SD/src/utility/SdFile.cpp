@@ -33,8 +33,15 @@ void (*SdFile::dateTime_)(uint16_t *date, uint16_t *time) = NULL;
 //------------------------------------------------------------------------------
 // add a cluster to a file
 uint8_t SdFile::addCluster() {
-  if (!vol_->allocContiguous(1, &curCluster_)) {
-    return false;
+  #if SD_APPEND_PREALLOCATE > 1
+  // files being appended to get a contiguous chunk if there's one, which
+  // write() then walks through like any other cluster chain
+  if (!(flags_ & O_APPEND) || !vol_->allocContiguous(SD_APPEND_PREALLOCATE, &curCluster_))
+  #endif
+  {
+    if (!vol_->allocContiguous(1, &curCluster_)) {
+      return false;
+    }
   }
 
   // if first cluster of file link to directory entry
@@ -46,6 +53,71 @@ uint8_t SdFile::addCluster() {
   return true;
 }
 //------------------------------------------------------------------------------
+// get the cluster after curCluster_, which is cluster index - 1 of the file,
+// from the run cache if it's there, and add it to the cache if it's next
+uint8_t SdFile::nextCluster(uint32_t index, uint32_t *next) {
+  #if SD_CLUSTER_CACHE
+  if (index < knownClusters_) {
+    uint8_t i = runCount_ - 1;
+    while (runs_[i].index > index) {
+      i--;
+    }
+    *next = runs_[i].cluster + (index - runs_[i].index);
+    return true;
+  }
+  if (!vol_->fatGet(curCluster_, next)) {
+    return false;
+  }
+  if (!vol_->isEOC(*next)) {
+    runsAdd(index, *next);
+  }
+  return true;
+  #else
+  (void) index;
+  return vol_->fatGet(curCluster_, next);
+  #endif
+}
+//------------------------------------------------------------------------------
+// the run cache only ever holds the clusters from the start of the file up to
+// knownClusters_, so a cluster is only added if it's the next one
+void SdFile::runsAdd(uint32_t index, uint32_t cluster) {
+  #if SD_CLUSTER_CACHE
+  if (index != knownClusters_) {
+    return;
+  }
+  if (runCount_) {
+    uint8_t i = runCount_ - 1;
+    if (runs_[i].cluster + (index - runs_[i].index) == cluster) {
+      knownClusters_++;
+      return;
+    }
+  }
+  if (runCount_ == SD_CLUSTER_CACHE) {
+    return;  // full - the rest is found through the FAT
+  }
+  runs_[runCount_].index = index;
+  runs_[runCount_].cluster = cluster;
+  runCount_++;
+  knownClusters_++;
+  #else
+  (void) index;
+  (void) cluster;
+  #endif
+}
+//------------------------------------------------------------------------------
+// forget the cluster chain, or, if contiguous isn't 0, set it to that many
+// clusters in one run from firstCluster_
+void SdFile::runsReset(uint32_t contiguous) {
+  #if SD_CLUSTER_CACHE
+  runs_[0].index = 0;
+  runs_[0].cluster = firstCluster_;
+  runCount_ = contiguous ? 1 : 0;
+  knownClusters_ = contiguous;
+  #else
+  (void) contiguous;
+  #endif
+}
+//------------------------------------------------------------------------------
 // Add a cluster to a directory file and zero the cluster.
 // return with first block of cluster in the cache
 uint8_t SdFile::addDirCluster(void) {
@@ -83,6 +155,28 @@ dir_t *SdFile::cacheDirEntry(uint8_t action) {
    Reasons for failure include no file is open or an I/O error.
 */
 uint8_t SdFile::close(void) {
+  #if SD_APPEND_PREALLOCATE > 1
+  // free the clusters addCluster() allocated beyond the end of the file
+  if (isFile() && (flags_ & O_APPEND) && (flags_ & O_WRITE) && firstCluster_) {
+    if (fileSize_ == 0) {
+      if (!vol_->freeChain(firstCluster_)) {
+        return false;
+      }
+      firstCluster_ = 0;
+      flags_ |= F_FILE_DIR_DIRTY;
+    } else {
+      uint32_t next;
+      if (!seekSet(fileSize_) || !vol_->fatGet(curCluster_, &next)) {
+        return false;
+      }
+      if (!vol_->isEOC(next)) {
+        if (!vol_->freeChain(next) || !vol_->fatPutEOC(curCluster_)) {
+          return false;
+        }
+      }
+    }
+  }
+  #endif
   if (!sync()) {
     return false;
   }
@@ -119,6 +213,7 @@ uint8_t SdFile::contiguousRange(uint32_t *bgnBlock, uint32_t *endBlock) {
       if (!vol_->isEOC(next)) {
         return false;
       }
+      runsReset(c - firstCluster_ + 1);
       *bgnBlock = vol_->clusterStartBlock(firstCluster_);
       *endBlock = vol_->clusterStartBlock(c)
                   + vol_->blocksPerCluster_ - 1;
@@ -163,6 +258,7 @@ uint8_t SdFile::createContiguous(SdFile *dirFile,
     remove();
     return false;
   }
+  runsReset(count);
   fileSize_ = size;
 
   // insure sync() will update dir entry
@@ -463,6 +559,22 @@ uint8_t SdFile::open(SdFile *dirFile, const char *fileName, uint8_t oflag) {
     return false;
   }
   vol_ = dirFile->vol_;
+
+  #if SD_DIR_CACHE
+  // try where it was last time first
+  uint16_t hash = SdVolume::dirHash(dname);
+  uint16_t slot = SdVolume::dirCacheFind(dirFile->firstCluster_, hash);
+  if (slot != 0XFFFF && dirFile->seekSet(32UL * slot)) {
+    p = dirFile->readDirCache();
+    if (p && !memcmp(dname, p->name, 11)) {
+      if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) {
+        return false;
+      }
+      return openCachedEntry(0XF & slot, oflag);
+    }
+  }
+  uint16_t emptySlot = 0XFFFF;
+  #endif
   dirFile->rewind();
 
   // bool for empty entry found
@@ -482,6 +594,9 @@ uint8_t SdFile::open(SdFile *dirFile, const char *fileName, uint8_t oflag) {
         emptyFound = true;
         dirIndex_ = index;
         dirBlock_ = SdVolume::cacheBlockNumber_;
+        #if SD_DIR_CACHE
+        emptySlot = (dirFile->curPosition_ >> 5) - 1;
+        #endif
       }
       // done if no entries follow
       if (p->name[0] == DIR_NAME_FREE) {
@@ -493,6 +608,9 @@ uint8_t SdFile::open(SdFile *dirFile, const char *fileName, uint8_t oflag) {
         return false;
       }
 
+      #if SD_DIR_CACHE
+      SdVolume::dirCacheAdd(dirFile->firstCluster_, hash, (dirFile->curPosition_ >> 5) - 1);
+      #endif
       // open found file
       return openCachedEntry(0XF & index, oflag);
     }
@@ -508,6 +626,9 @@ uint8_t SdFile::open(SdFile *dirFile, const char *fileName, uint8_t oflag) {
     if (!p) {
       return false;
     }
+    #if SD_DIR_CACHE
+    SdVolume::dirCacheAdd(dirFile->firstCluster_, hash, emptySlot);
+    #endif
   } else {
     if (dirFile->type_ == FAT_FILE_TYPE_ROOT16) {
       return false;
@@ -632,6 +753,7 @@ uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
+  runsReset();
 
   // truncate file to zero length if requested
   if (oflag & O_TRUNC) {
@@ -677,6 +799,7 @@ uint8_t SdFile::openRoot(SdVolume *vol) {
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
+  runsReset();
 
   // root has no directory entry
   dirBlock_ = 0;
@@ -793,9 +916,10 @@ int16_t SdFile::read(void *buf, uint16_t nbyte) {
         if (curPosition_ == 0) {
           // use first cluster in file
           curCluster_ = firstCluster_;
+          runsAdd(0, curCluster_);
         } else {
-          // get next cluster from FAT
-          if (!vol_->fatGet(curCluster_, &curCluster_)) {
+          // get next cluster from the cache or the FAT
+          if (!nextCluster(curPosition_ >> (vol_->clusterSizeShift_ + 9), &curCluster_)) {
             return -1;
           }
         }
@@ -827,6 +951,15 @@ int16_t SdFile::read(void *buf, uint16_t nbyte) {
         *dst++ = *src++;
       }
     }
+    #if SD_ASYNC_BUFFER
+    // read-ahead: start on the next block while this one is used, if it's
+    // in the file, and in the same cluster
+    uint32_t nextPosition = (curPosition_ | 0X1FF) + 1;
+    if (nextPosition < fileSize_ && block + 1 != SdVolume::cacheBlockNumber_ &&
+        (type_ == FAT_FILE_TYPE_ROOT16 || vol_->blockOfCluster(nextPosition) != 0)) {
+      vol_->readAhead(block + 1);
+    }
+    #endif
     curPosition_ += n;
     toRead -= n;
   }
@@ -1105,12 +1238,21 @@ uint8_t SdFile::seekSet(uint32_t pos) {
   if (nNew < nCur || curPosition_ == 0) {
     // must follow chain from first cluster
     curCluster_ = firstCluster_;
-  } else {
-    // advance from curPosition
-    nNew -= nCur;
+    nCur = 0;
+    runsAdd(0, curCluster_);
+  }
+  #if SD_CLUSTER_CACHE
+  // skip ahead to the known cluster nearest the new position
+  if (nCur + 1 < knownClusters_ && nCur < nNew) {
+    uint32_t nKnown = nNew < knownClusters_ ? nNew : knownClusters_ - 1;
+    if (!nextCluster(nKnown, &curCluster_)) {
+      return false;
+    }
+    nCur = nKnown;
   }
-  while (nNew--) {
-    if (!vol_->fatGet(curCluster_, &curCluster_)) {
+  #endif
+  while (nCur < nNew) {
+    if (!nextCluster(++nCur, &curCluster_)) {
       return false;
     }
   }
@@ -1163,7 +1305,14 @@ uint8_t SdFile::sync(uint8_t blocking) {
     flags_ &= ~F_FILE_NON_BLOCKING_WRITE;
   }
 
+  #if SD_ASYNC_BUFFER
+  if (!SdVolume::cacheFlush(blocking)) {
+    return false;
+  }
+  return !blocking || SdVolume::sdCard()->asyncWait();
+  #else
   return SdVolume::cacheFlush(blocking);
+  #endif
 }
 //------------------------------------------------------------------------------
 /**
@@ -1280,6 +1429,7 @@ uint8_t SdFile::truncate(uint32_t length) {
       return false;
     }
     firstCluster_ = 0;
+    runsReset();
   } else {
     uint32_t toFree;
     if (!vol_->fatGet(curCluster_, &toFree)) {
@@ -1296,6 +1446,7 @@ uint8_t SdFile::truncate(uint32_t length) {
       if (!vol_->fatPutEOC(curCluster_)) {
         return false;
       }
+      runsReset();
     }
   }
   fileSize_ = length;
@@ -1362,9 +1513,11 @@ size_t SdFile::write(const void *buf, uint16_t nbyte) {
         } else {
           curCluster_ = firstCluster_;
         }
+        runsAdd(0, curCluster_);
       } else {
+        uint32_t index = curPosition_ >> (vol_->clusterSizeShift_ + 9);
         uint32_t next;
-        if (!vol_->fatGet(curCluster_, &next)) {
+        if (!nextCluster(index, &next)) {
           return false;
         }
         if (vol_->isEOC(next)) {
@@ -1372,6 +1525,7 @@ size_t SdFile::write(const void *buf, uint16_t nbyte) {
           if (!addCluster()) {
             goto writeErrorReturn;
           }
+          runsAdd(index, curCluster_);
         } else {
           curCluster_ = next;
         }
@@ -1389,14 +1543,53 @@ size_t SdFile::write(const void *buf, uint16_t nbyte) {
     uint32_t block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
     if (n == 512) {
       // full block - don't need to use cache
-      // invalidate cache if block is in cache
-      if (SdVolume::cacheBlockNumber_ == block) {
+      // count the full blocks that follow it on the card: the rest of this
+      // cluster, and the clusters after it while the chain is contiguous, as
+      // it always is in a file made with createContiguous()
+      uint16_t nb = nToWrite >> 9;
+      uint16_t run = vol_->blocksPerCluster() - blockOfCluster;
+      uint32_t lastCluster = curCluster_;
+      while (run < nb) {
+        uint32_t next;
+        if (!vol_->fatGet(lastCluster, &next)) {
+          goto writeErrorReturn;
+        }
+        if (next != lastCluster + 1) {
+          break;
+        }
+        lastCluster = next;
+        run += vol_->blocksPerCluster();
+      }
+      if (run > nb) {
+        run = nb;
+      }
+      // invalidate cache if a block is in cache
+      if (SdVolume::cacheBlockNumber_ - block < run) {
         SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
       }
-      if (!vol_->writeBlock(block, src, blocking)) {
-        goto writeErrorReturn;
+      if (run == 1) {
+        if (!vol_->writeBlock(block, src, blocking)) {
+          goto writeErrorReturn;
+        }
+        src += 512;
+      } else {
+        // one multiple block write, with the blocks pre-erased
+        if (!vol_->writeStart(block, run)) {
+          goto writeErrorReturn;
+        }
+        for (uint16_t i = 0; i < run; i++) {
+          if (!vol_->writeData(src)) {
+            goto writeErrorReturn;
+          }
+          src += 512;
+        }
+        if (!vol_->writeStop()) {
+          goto writeErrorReturn;
+        }
+        n = run << 9;
+        // leave curCluster_ on the cluster of the last block written
+        curCluster_ += (blockOfCluster + run - 1) / vol_->blocksPerCluster();
       }
-      src += 512;
     } else {
       if (blockOffset == 0 && curPosition_ >= fileSize_) {
         // start of new block don't need to read into cache
@@ -26,35 +26,41 @@ cache_t  SdVolume::cacheBuffer_;     // 512 byte cache for Sd2Card
 Sd2Card *SdVolume::sdCard_;          // pointer to SD card object
 uint8_t  SdVolume::cacheDirty_ = 0;  // cacheFlush() will write block if true
 uint32_t SdVolume::cacheMirrorBlock_ = 0;  // mirror  block for second FAT
+#if SD_FAT_CACHE
+cache_t  SdVolume::fatCache_;        // 512 byte cache for FAT blocks
+uint32_t SdVolume::fatCacheBlockNumber_ = 0XFFFFFFFF;
+uint8_t  SdVolume::fatCacheDirty_ = 0;
+uint32_t SdVolume::fatCacheMirrorBlock_ = 0;
+#endif
+#if SD_DIR_CACHE
+SdVolume::dirCacheEntry_t SdVolume::dirCache_[SD_DIR_CACHE];
+#endif
 //------------------------------------------------------------------------------
 // find a contiguous group of clusters
+// allocSearchStart_ is kept at or below the first free cluster, so a search
+// that starts there skips the clusters that are known to be in use - without
+// it, every new cluster of a file would be searched for from the end of the
+// file, over whatever lies between there and the next free cluster.
 uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t *curCluster) {
-  // start of group
-  uint32_t bgnCluster;
-
-  // flag to save place to start next search
-  uint8_t setStart;
-
-  // set search start cluster
-  if (*curCluster) {
-    // try to make file contiguous
-    bgnCluster = *curCluster + 1;
+  // last cluster of FAT
+  uint32_t fatEnd = clusterCount_ + 1;
 
-    // don't save new start location
-    setStart = false;
-  } else {
-    // start at likely place for free cluster
-    bgnCluster = allocSearchStart_;
+  // start of group - at likely place for free cluster
+  uint32_t bgnCluster = allocSearchStart_;
 
-    // save next search start if one cluster
-    setStart = 1 == count;
+  if (*curCluster && *curCluster < fatEnd) {
+    // try to make file contiguous, if the next cluster is free
+    uint32_t f;
+    if (!fatGet(*curCluster + 1, &f)) {
+      return false;
+    }
+    if (f == 0) {
+      bgnCluster = *curCluster + 1;
+    }
   }
   // end of group
   uint32_t endCluster = bgnCluster;
 
-  // last cluster of FAT
-  uint32_t fatEnd = clusterCount_ + 1;
-
   // search the FAT for free clusters
   for (uint32_t n = 0;; n++, endCluster++) {
     // can't find space checked all clusters
@@ -74,11 +80,20 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t *curCluster) {
     if (f != 0) {
       // cluster in use try next cluster as bgnCluster
       bgnCluster = endCluster + 1;
+      if (endCluster == allocSearchStart_) {
+        // no free cluster below the next one
+        allocSearchStart_ = bgnCluster;
+      }
     } else if ((endCluster - bgnCluster + 1) == count) {
       // done - found space
       break;
     }
   }
+  // remember possible next free cluster
+  if (bgnCluster == allocSearchStart_) {
+    allocSearchStart_ = endCluster + 1;
+  }
+
   // mark end of chain
   if (!fatPutEOC(endCluster)) {
     return false;
@@ -100,16 +115,28 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t *curCluster) {
   // return first cluster number to caller
   *curCluster = bgnCluster;
 
-  // remember possible next free cluster
-  if (setStart) {
-    allocSearchStart_ = bgnCluster + 1;
-  }
-
   return true;
 }
 //------------------------------------------------------------------------------
 uint8_t SdVolume::cacheFlush(uint8_t blocking) {
+  #if SD_FAT_CACHE
+  // the FAT block is always written blocking - it has to be done first
+  if (!fatCacheFlush()) {
+    return false;
+  }
+  #endif
   if (cacheDirty_) {
+    #if SD_ASYNC_BUFFER
+    // with nothing to mirror, write-behind: the block goes out in the
+    // background, and SdFile::sync() waits to see it accepted
+    if (blocking && !cacheMirrorBlock_) {
+      if (!sdCard_->writeBlockAsync(cacheBlockNumber_, cacheBuffer_.data)) {
+        return false;
+      }
+      cacheDirty_ = 0;
+      return true;
+    }
+    #endif
     if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data, blocking)) {
       return false;
     }
@@ -136,6 +163,39 @@ uint8_t SdVolume::cacheMirrorBlockFlush(uint8_t blocking) {
   }
   return true;
 }
+#if SD_FAT_CACHE
+//------------------------------------------------------------------------------
+uint8_t SdVolume::fatCacheBlock(uint32_t blockNumber) {
+  if (fatCacheBlockNumber_ != blockNumber) {
+    if (!fatCacheFlush()) {
+      return false;
+    }
+    fatCacheBlockNumber_ = 0XFFFFFFFF;
+    if (!sdCard_->readBlock(blockNumber, fatCache_.data)) {
+      return false;
+    }
+    fatCacheBlockNumber_ = blockNumber;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+uint8_t SdVolume::fatCacheFlush(void) {
+  if (fatCacheDirty_) {
+    if (!sdCard_->writeBlock(fatCacheBlockNumber_, fatCache_.data)) {
+      return false;
+    }
+    // mirror FAT tables
+    if (fatCacheMirrorBlock_) {
+      if (!sdCard_->writeBlock(fatCacheMirrorBlock_, fatCache_.data)) {
+        return false;
+      }
+      fatCacheMirrorBlock_ = 0;
+    }
+    fatCacheDirty_ = 0;
+  }
+  return true;
+}
+#endif  // SD_FAT_CACHE
 //------------------------------------------------------------------------------
 uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
   if (cacheBlockNumber_ != blockNumber) {
@@ -186,15 +246,23 @@ uint8_t SdVolume::fatGet(uint32_t cluster, uint32_t *value) const {
   }
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
+  #if SD_FAT_CACHE
+  if (!fatCacheBlock(lba)) {
+    return false;
+  }
+  cache_t *fat = &fatCache_;
+  #else
   if (lba != cacheBlockNumber_) {
     if (!cacheRawBlock(lba, CACHE_FOR_READ)) {
       return false;
     }
   }
+  cache_t *fat = &cacheBuffer_;
+  #endif
   if (fatType_ == 16) {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    *value = fat->fat16[cluster & 0XFF];
   } else {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    *value = fat->fat32[cluster & 0X7F] & FAT32MASK;
   }
   return true;
 }
@@ -215,6 +283,23 @@ uint8_t SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
 
+  #if SD_FAT_CACHE
+  if (!fatCacheBlock(lba)) {
+    return false;
+  }
+  // store entry
+  if (fatType_ == 16) {
+    fatCache_.fat16[cluster & 0XFF] = value;
+  } else {
+    fatCache_.fat32[cluster & 0X7F] = value;
+  }
+  fatCacheDirty_ = 1;
+
+  // mirror second FAT
+  if (fatCount_ > 1) {
+    fatCacheMirrorBlock_ = lba + blocksPerFat_;
+  }
+  #else
   if (lba != cacheBlockNumber_) {
     if (!cacheRawBlock(lba, CACHE_FOR_READ)) {
       return false;
@@ -232,15 +317,18 @@ uint8_t SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   if (fatCount_ > 1) {
     cacheMirrorBlock_ = lba + blocksPerFat_;
   }
+  #endif
   return true;
 }
 //------------------------------------------------------------------------------
 // free a cluster chain
 uint8_t SdVolume::freeChain(uint32_t cluster) {
-  // clear free cluster location
-  allocSearchStart_ = 2;
-
   do {
+    // the search for free clusters has to start here now
+    if (cluster < allocSearchStart_) {
+      allocSearchStart_ = cluster;
+    }
+
     uint32_t next;
     if (!fatGet(cluster, &next)) {
       return false;
@@ -275,6 +363,15 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
 uint8_t SdVolume::init(Sd2Card *dev, uint8_t part) {
   uint32_t volumeStartBlock = 0;
   sdCard_ = dev;
+  allocSearchStart_ = 2;
+  #if SD_FAT_CACHE
+  // whatever is in the FAT cache came from another volume
+  fatCacheBlockNumber_ = 0XFFFFFFFF;
+  fatCacheDirty_ = 0;
+  #endif
+  #if SD_DIR_CACHE
+  dirCacheClear();
+  #endif
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
   if (part) {
@@ -349,3 +446,50 @@ uint8_t SdVolume::init(Sd2Card *dev, uint8_t part) {
   }
   return true;
 }
+#if SD_DIR_CACHE
+//------------------------------------------------------------------------------
+// hash of an 8.3 name as it is in a directory entry
+uint16_t SdVolume::dirHash(const uint8_t *name) {
+  uint16_t h = 0;
+  for (uint8_t i = 0; i < 11; i++) {
+    h = (h << 5) + h + name[i];
+  }
+  return h;
+}
+//------------------------------------------------------------------------------
+// index in its directory of a file opened recently, or 0XFFFF if there's none
+// with that hash. The caller checks the entry; a hit is moved to the front.
+uint16_t SdVolume::dirCacheFind(uint32_t dirCluster, uint16_t hash) {
+  for (uint8_t i = 0; i < SD_DIR_CACHE; i++) {
+    if (dirCache_[i].index != 0XFFFF && dirCache_[i].hash == hash &&
+        dirCache_[i].dirCluster == dirCluster) {
+      uint16_t index = dirCache_[i].index;
+      dirCacheAdd(dirCluster, hash, index);
+      return index;
+    }
+  }
+  return 0XFFFF;
+}
+//------------------------------------------------------------------------------
+// remember where a file is, in front of the rest: it replaces the entry for the
+// same name if there is one, and otherwise the least recently used one
+void SdVolume::dirCacheAdd(uint32_t dirCluster, uint16_t hash, uint16_t index) {
+  uint8_t i = 0;
+  while (i < SD_DIR_CACHE - 1 && !(dirCache_[i].hash == hash &&
+                                   dirCache_[i].dirCluster == dirCluster)) {
+    i++;
+  }
+  for (; i > 0; i--) {
+    dirCache_[i] = dirCache_[i - 1];
+  }
+  dirCache_[0].dirCluster = dirCluster;
+  dirCache_[0].hash = hash;
+  dirCache_[0].index = index;
+}
+//------------------------------------------------------------------------------
+void SdVolume::dirCacheClear(void) {
+  for (uint8_t i = 0; i < SD_DIR_CACHE; i++) {
+    dirCache_[i].index = 0XFFFF;
+  }
+}
+#endif  // SD_DIR_CACHE
@@ -0,0 +1,61 @@
+/* DirtyRectangles - a square bouncing around a 160x128 ST7735 TFT, with no framebuffer.
+ *
+ * Each frame, the square's old and new positions are marked dirty, and update() redraws just the rectangle covering
+ * both: a few hundred bytes, instead of the 40k a whole frame would be. render() works out each pixel from the
+ * square's position, a band of rows at a time, into a 640 byte buffer.
+ *
+ * The display's CS is on PIN_PA4 and DC on PIN_PA5 here, with MOSI and SCK on the SPI pins; its reset is tied high.
+ */
+#include <SPI.h>
+#include <SPIDisplay.h>
+
+#define SQUARE 12
+#define BLACK  0x0000
+#define ORANGE 0xFC00               // RGB565
+
+SPIDisplay tft(SPI, SPISettings(8000000, MSBFIRST, SPI_MODE0), PIN_PA4, PIN_PA5, 160, 128);
+uint8_t band[640];                  // 2 rows of the widest rectangle
+int16_t x = 20, y = 30, dx = 2, dy = 1;
+
+void render(uint16_t x0, uint16_t y0, uint16_t width, uint8_t rows, uint8_t *pixels) {
+  for (uint8_t r = 0; r < rows; r++) {
+    int16_t row = y0 + r;
+    for (uint16_t i = 0; i < width; i++) {
+      int16_t  column = x0 + i;
+      uint16_t color  = (column >= x && column < x + SQUARE && row >= y && row < y + SQUARE) ? ORANGE : BLACK;
+      *pixels++ = color >> 8;
+      *pixels++ = color;
+    }
+  }
+}
+
+void setup() {
+  SPI.begin();
+  tft.begin();
+  tft.command(0x01);                // software reset
+  delay(150);
+  tft.command(0x11);                // out of sleep
+  delay(255);
+  uint8_t colmod = 0x05;            // 16 bits per pixel
+  tft.command(0x3A, &colmod, 1);
+  uint8_t madctl = 0x60;            // landscape
+  tft.command(0x36, &madctl, 1);
+  tft.command(0x29);                // display on
+  tft.markAllDirty();
+  tft.update(render, band, sizeof(band));   // the whole screen, to clear it: 2 rows at a time
+}
+
+void loop() {
+  tft.markDirty(x, y, x + SQUARE - 1, y + SQUARE - 1);   // where it was
+  x += dx;
+  y += dy;
+  if (x <= 0 || x + SQUARE >= 160) {
+    dx = -dx;
+  }
+  if (y <= 0 || y + SQUARE >= 128) {
+    dy = -dy;
+  }
+  tft.markDirty(x, y, x + SQUARE - 1, y + SQUARE - 1);   // and where it is now
+  tft.update(render, band, sizeof(band));
+  delay(20);
+}
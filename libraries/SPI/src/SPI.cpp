@@ -28,6 +28,7 @@ const SPISettings DEFAULT_SPI_SETTINGS = SPISettings();
 
 SPIClass::SPIClass() {
   initialized = false;
+  asyncState = 0;
 
 }
 
@@ -261,7 +262,9 @@ void SPIClass::reattachMaskedInterrupts() {
   }
 }
 
-void SPIClass::beginTransaction(SPISettings settings) {
+/* The part of beginTransaction() that is only needed with usingInterrupt() or during an async transfer. */
+void SPIClass::beginTransactionMask() {
+  while (asyncState & SPI_ASYNC_BUSY);          // an async transfer is still using the settings of the last one
   if (interruptMode != SPI_IMODE_NONE) {
     if (interruptMode & SPI_IMODE_GLOBAL) {
       noInterrupts();
@@ -269,10 +272,17 @@ void SPIClass::beginTransaction(SPISettings settings) {
       detachMaskedInterrupts();
     }
   }
-  config(settings);
 }
 
 void SPIClass::endTransaction(void) {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (asyncState & SPI_ASYNC_BUSY) {
+    asyncState |= SPI_ASYNC_END;                // the interrupts stay masked until the async transfer is done
+    SREG = oldSREG;
+    return;
+  }
+  SREG = oldSREG;
   if (interruptMode != SPI_IMODE_NONE) {
     if (interruptMode & SPI_IMODE_GLOBAL) {
       interrupts();
@@ -336,12 +346,83 @@ uint16_t SPIClass::transfer16(uint16_t data) {
   return t.val;
 }
 
+/*
+  The block transfers switch to buffered mode for the duration, so the next byte is already waiting in the
+  transmit buffer when one is done, and the bus doesn't sit idle while we store one byte and load the next.
+  No more than two bytes are ever in flight - one shifting, one in the transmit buffer - so the two byte
+  receive buffer can't overflow, however long an interrupt holds us up; we just lose a little speed then.
+  BUFWR makes the first byte go straight to the shift register.
+*/
+#define SPI_BUFFERED_bm   (SPI_BUFEN_bm | SPI_BUFWR_bm)
+
+static inline void spiDrainReceive() {
+  while (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+    SPI0.DATA;                                  // also clears BUFOVF
+  }
+}
+
 void SPIClass::transfer(void *buf, size_t count) {
-  uint8_t *buffer = reinterpret_cast<uint8_t *>(buf);
-  for (size_t i = 0; i < count; i++) {
-    *buffer = transfer(*buffer);
-    buffer++;
+  transfer(buf, buf, count);                    // each byte is sent before it's overwritten
+}
+
+void SPIClass::transfer(const void *txbuf, void *rxbuf, size_t count) {
+  if (rxbuf == NULL) {
+    writeBytes(txbuf, count);
+    return;
+  }
+  if (txbuf == NULL) {
+    readBytes(rxbuf, count);
+    return;
+  }
+  const uint8_t *tx = reinterpret_cast<const uint8_t *>(txbuf);
+  uint8_t *rx = reinterpret_cast<uint8_t *>(rxbuf);
+  uint8_t ctrlb = SPI0.CTRLB;
+  SPI0.CTRLB = ctrlb | SPI_BUFFERED_bm;
+  spiDrainReceive();
+  size_t sent = 0;
+  size_t received = 0;
+  while (received < count) {
+    uint8_t flags = SPI0.INTFLAGS;
+    if (flags & SPI_RXCIF_bm) {
+      rx[received++] = SPI0.DATA;
+    } else if ((flags & SPI_DREIF_bm) && sent < count && (sent - received) < 2) {
+      SPI0.DATA = tx[sent++];
+    }
+  }
+  SPI0.CTRLB = ctrlb;
+}
+
+void SPIClass::writeBytes(const void *buf, size_t count) {
+  const uint8_t *tx = reinterpret_cast<const uint8_t *>(buf);
+  uint8_t ctrlb = SPI0.CTRLB;
+  SPI0.CTRLB = ctrlb | SPI_BUFFERED_bm;
+  SPI0.INTFLAGS = SPI_TXCIF_bm;                 // cleared, so we can tell when the last byte is out
+  while (count--) {
+    while ((SPI0.INTFLAGS & SPI_DREIF_bm) == 0);
+    SPI0.DATA = *tx++;
+  }
+  while ((SPI0.INTFLAGS & SPI_TXCIF_bm) == 0);  // so the caller can raise SS as soon as we return
+  spiDrainReceive();                            // what came back is thrown away
+  SPI0.CTRLB = ctrlb;
+}
+
+void SPIClass::readBytes(void *buf, size_t count, uint8_t fill) {
+  uint8_t *rx = reinterpret_cast<uint8_t *>(buf);
+  uint8_t ctrlb = SPI0.CTRLB;
+  SPI0.CTRLB = ctrlb | SPI_BUFFERED_bm;
+  spiDrainReceive();
+  size_t sent = 0;
+  size_t received = 0;
+  while (received < count) {
+    uint8_t flags = SPI0.INTFLAGS;
+    if (flags & SPI_RXCIF_bm) {
+      rx[received++] = SPI0.DATA;
+    } else if ((flags & SPI_DREIF_bm) && sent < count && (sent - received) < 2) {
+      SPI0.DATA = fill;
+      sent++;
+    }
   }
+  SPI0.CTRLB = ctrlb;
 }
 
 #if SPI_INTERFACES_COUNT > 0
@@ -48,6 +48,28 @@
 #define SPI_INTERRUPT_DISABLE     0
 #define SPI_INTERRUPT_ENABLE      1
 
+#define SPI_ASYNC_BUSY            0x01  // an async transfer is running
+#define SPI_ASYNC_END             0x02  // endTransaction() was called during it, and will be done at the end
+#define SPI_ASYNC_QUEUE           0x04  // and it's the transaction queue's
+
+#define SPI_QUEUE_NORMAL          0     // spiTransaction.priority
+#define SPI_QUEUE_HIGH            1     // goes ahead of normal ones, between their chunks
+#define SPI_QUEUE_WAITING         1     // spiTransaction.status
+#define SPI_QUEUE_RUNNING         2
+#define SPI_QUEUE_DONE            0
+
+#ifndef SPI_QUEUE_CHUNK
+  #define SPI_QUEUE_CHUNK         32    // of a normal transaction, between which a high priority one can go
+#endif
+
+typedef void (*spiAsyncCallback_t)(void);   // called from the SPI interrupt when an async transfer is done
+
+#ifndef SPI_CLIENT_BUFFER_SIZE
+  #define SPI_CLIENT_BUFFER_SIZE  16            // each of the client mode ring buffers; a power of 2, at most 128
+#endif
+
+extern void (*spiInterruptHandler)(void);      // what the SPI0 interrupt runs - async transfers or client mode
+
 //#define EXTERNAL_NUM_INTERRUPTS   NUM_TOTAL_PINS
 
 class SPISettings {
@@ -65,12 +87,8 @@ class SPISettings {
       init_AlwaysInline(4000000, MSBFIRST, SPI_MODE0);
     }
 
-  private:
-    void init_MightInline(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
-      init_AlwaysInline(clock, bitOrder, dataMode);
-    }
-
-    void init_AlwaysInline(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) __attribute__((__always_inline__)) {
+    // The register values for those settings; constexpr, so SPISettingsStatic can work them out at compile time.
+    static constexpr uint8_t ctrlaFor(uint32_t clock, uint8_t bitOrder) {
       // Clock settings are defined as follows. Note that this shows SPI2X
       // inverted, so the bits form increasing numbers. Also note that
       // fosc/64 appears twice.  If FOSC is 16 Mhz
@@ -88,7 +106,7 @@ class SPISettings {
       // given clock rate. The clock divider that results in clock_setting
       // is 2 ^^ (clock_div + 1). If nothing is slow enough, we'll use the
       // slowest (128 == 2 ^^ 7, so clock_div = 6).
-      uint8_t clockDiv;
+      uint8_t clockDiv = 0;
 
       // When the clock is known at compile time, use this if-then-else
       // cascade, which the compiler knows how to completely optimize
@@ -116,32 +134,79 @@ class SPISettings {
       // Invert the SPI2X bit
       clockDiv ^= 0x1;
 
-      /* Pack into the SPISettings::ctrlb class */
-      /* Set mode, disable master slave select, and disable buffering. */
-      /* dataMode is register correct, when using SPI_MODE defines     */
-      ctrlb = (dataMode)            |
-              (SPI_SSD_bm)          |
-              (0 << SPI_BUFWR_bp)   |
-              (0 << SPI_BUFEN_bp);
-
       /* Get Clock related values.*/
       uint8_t clockDiv_mult = (clockDiv & 0x1);
       uint8_t clockDiv_pres = (clockDiv >> 1);
 
-      /* Pack into the SPISettings::ctrlb class     */
+      /* Pack into the SPISettings::ctrla class     */
       /* Set Prescaler, x2, SPI to Master, and Bit Order. */
 
-      ctrla = (clockDiv_pres  << SPI_PRESC_gp)        |
-              (clockDiv_mult << SPI_CLK2X_bp)         |
-              (SPI_ENABLE_bm)                         |
-              (SPI_MASTER_bm)                         |
-              ((bitOrder == LSBFIRST) << SPI_DORD_bp);
+      return (clockDiv_pres  << SPI_PRESC_gp)        |
+             (clockDiv_mult << SPI_CLK2X_bp)         |
+             (SPI_ENABLE_bm)                         |
+             (SPI_MASTER_bm)                         |
+             ((bitOrder == LSBFIRST) << SPI_DORD_bp);
+    }
+
+    static constexpr uint8_t ctrlbFor(uint8_t dataMode) {
+      /* Set mode, disable master slave select, and disable buffering. */
+      /* dataMode is register correct, when using SPI_MODE defines     */
+      return (dataMode)            |
+             (SPI_SSD_bm)          |
+             (0 << SPI_BUFWR_bp)   |
+             (0 << SPI_BUFEN_bp);
+    }
+
+  protected:
+    struct registers_t {};                // so this can't be mistaken for the (clock, bitOrder, dataMode) one
+    constexpr SPISettings(registers_t, uint8_t ctrla_val, uint8_t ctrlb_val) : ctrla(ctrla_val), ctrlb(ctrlb_val) {}
+
+  private:
+    void init_MightInline(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) {
+      init_AlwaysInline(clock, bitOrder, dataMode);
+    }
 
+    void init_AlwaysInline(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) __attribute__((__always_inline__)) {
+      ctrla = ctrlaFor(clock, bitOrder);
+      ctrlb = ctrlbFor(dataMode);
     }
     /* member variables containing the desired SPI settings */
     uint8_t ctrla;
     uint8_t ctrlb;
     friend class SPIClass;
+    friend class USARTSPIClass;
+};
+
+/* SPISettingsStatic<8000000, MSBFIRST, SPI_MODE0>() is an SPISettings whose register values are worked out by the
+   compiler, whatever the optimizer makes of the arguments, so beginTransaction() with it is just the two stores. */
+template <uint32_t clock, uint8_t bitOrder, uint8_t dataMode>
+class SPISettingsStatic : public SPISettings {
+  public:
+    constexpr SPISettingsStatic() : SPISettings(registers_t(), ctrla_val, ctrlb_val) {}
+  private:
+    static constexpr uint8_t ctrla_val = SPISettings::ctrlaFor(clock, bitOrder);
+    static constexpr uint8_t ctrlb_val = SPISettings::ctrlbFor(dataMode);
+};
+
+struct spiDevice {          // one of the devices on the bus, for SPI.queue()
+  SPISettings settings;
+  uint8_t csPin;
+  bool noSplit;             // must stay selected for a whole transaction, so never paused for a high priority one
+};
+
+struct spiTransaction;
+typedef void (*spiQueueCallback_t)(struct spiTransaction *t);  // called from the SPI interrupt when t is done
+
+struct spiTransaction {     // one transfer with CS low, for SPI.queue(); must stay valid until it's done
+  const struct spiDevice *device;
+  const void *txbuf;        // either may be NULL, as for transfer()
+  void *rxbuf;
+  uint16_t count;
+  spiQueueCallback_t callback;  // may be NULL; may queue another, this one included
+  uint8_t priority;         // SPI_QUEUE_NORMAL or SPI_QUEUE_HIGH
+  volatile uint8_t status;  // SPI_QUEUE_WAITING, _RUNNING, or _DONE
+  uint16_t _done;           // the rest is used by the queue
+  struct spiTransaction *_next;
 };
 
 class SPIClass {
@@ -151,11 +216,49 @@ class SPIClass {
     byte transfer(uint8_t data);
     uint16_t transfer16(uint16_t data);
     void transfer(void *buf, size_t count);
+    void transfer(const void *txbuf, void *rxbuf, size_t count);  // either may be NULL
+    void writeBytes(const void *buf, size_t count);                // nothing is stored
+    void readBytes(void *buf, size_t count, uint8_t fill = 0xFF);   // fill is sent
+
+    // Interrupt driven transfer, SPI_async.cpp. Either buffer may be NULL; csPin is taken low for it if given
+    bool transferAsync(const void *txbuf, void *rxbuf, size_t count, spiAsyncCallback_t callback = NULL, uint8_t csPin = NOT_A_PIN);
+    inline bool asyncBusy() {
+      return asyncState & SPI_ASYNC_BUSY;
+    }
+    void onAsyncIRQ();                          // is called by the SPI interrupt
+
+    // Transaction queue for several devices, SPI_queue.cpp. High priority transactions go in between the chunks of
+    // normal ones; false if t is already queued, or an async transfer or client mode has the SPI
+    bool queue(struct spiTransaction *t);
+    inline bool queueBusy() {
+      return asyncState & SPI_ASYNC_QUEUE;
+    }
+    void onQueueIRQ();                          // is called by the SPI interrupt
+
+    // Client (slave) mode, SPI_client.cpp. The host mode methods can't be used until endClient()
+    bool beginClient(uint8_t dataMode = SPI_MODE0, uint8_t bitOrder = MSBFIRST);
+    void endClient();
+    void onClientSelect(void (*callback)(void));          // SS went low: a frame begins
+    void onClientDeselect(void (*callback)(uint8_t count)); // SS went high, after count bytes
+    uint8_t clientAvailable();
+    int     clientRead();
+    int     clientPeek();
+    size_t  clientWrite(uint8_t data);
+    size_t  clientWrite(const uint8_t *buf, size_t count);
+    uint8_t clientAvailableForWrite();
+    void    clientFlush();                       // throw away what hasn't been sent yet
 
     // Transaction Functions
     void usingInterrupt(int interruptNumber);
     void notUsingInterrupt(int interruptNumber);
-    void beginTransaction(SPISettings settings);
+    // Inline, so settings known at compile time come down to the two stores
+    inline void beginTransaction(SPISettings settings) __attribute__((__always_inline__)) {
+      if (interruptMode | (asyncState & SPI_ASYNC_BUSY)) {
+        beginTransactionMask();
+      }
+      SPI0.CTRLA = settings.ctrla;
+      SPI0.CTRLB = settings.ctrlb;
+    }
     void endTransaction(void);
 
     bool pins(uint8_t pinMOSI, uint8_t pinMISO, uint8_t pinSCK, uint8_t pinSS = NOT_A_PIN);
@@ -171,6 +274,7 @@ class SPIClass {
 
     void init();
     void config(SPISettings settings);
+    void beginTransactionMask();
 
     // These undocumented functions should not be used.  SPI.transfer()
     // polls the hardware flag which is automatically cleared as the
@@ -184,6 +288,7 @@ class SPIClass {
 
     void detachMaskedInterrupts();
     void reattachMaskedInterrupts();
+    void queueNext();
 
     uint8_t _uc_pinMiso;
     uint8_t _uc_pinMosi;
@@ -192,6 +297,7 @@ class SPIClass {
     uint8_t _uc_mux;
 
     bool initialized;
+    volatile uint8_t asyncState;
     uint8_t interruptMode;
     char interruptSave;
     uint32_t interruptMask_lo;
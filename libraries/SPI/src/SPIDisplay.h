@@ -0,0 +1,166 @@
+/* SPIDisplay.h - redraw only what changed on an SPI display, with no framebuffer
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The sketch says what it changed with markDirty(), and the union of those - one rectangle - is all that update()
+ * sends. It sets the display's window to that rectangle and renders it a band of rows at a time, through a callback,
+ * into a buffer just big enough for one band; each band goes out with writeBytes(), in buffered mode with no gap
+ * between bytes. CS is taken low and DC high once for the whole of the pixel data, and the window command is the only
+ * other traffic, so a small change is a few dozen bytes, not a whole frame.
+ *
+ * It works with SPI (SPIDisplay) or a USART in MSPI mode (USARTSPIDisplay, after #include <USARTSPI.h>). The window
+ * is set with the MIPI DCS commands (0x2A, 0x2B, 0x2C) that the ILI9341, ST7735, ST7789 and most other TFT
+ * controllers use; for anything else, onWindow() supplies the sequence. Header only - it's a template so either port
+ * can be used, and so the compiler can see the SPI writes.
+ */
+
+#ifndef _SPIDISPLAY_H_INCLUDED
+#define _SPIDISPLAY_H_INCLUDED
+
+#include <Arduino.h>
+#include "SPI.h"
+
+template <class Port>
+class SPIDisplayPort {
+  public:
+    // Fills pixels with rows rows of the width pixels starting at x, y (bytesPerPixel each, in the display's format).
+    typedef void (*renderCallback_t)(uint16_t x, uint16_t y, uint16_t width, uint8_t rows, uint8_t *pixels);
+    // Sends whatever the controller needs so that the pixel data that follows fills x0, y0 to x1, y1 (inclusive).
+    typedef void (*windowCallback_t)(SPIDisplayPort &display, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+    SPIDisplayPort(Port &port, SPISettings settings, uint8_t csPin, uint8_t dcPin, uint16_t width, uint16_t height,
+                   uint8_t bytesPerPixel = 2) :
+      _port(port), _settings(settings), _cs(csPin), _dc(dcPin), _width(width), _height(height), _bpp(bytesPerPixel) {
+      clean();
+    }
+
+    void begin() {                 // after port.begin(); then send the controller's init sequence with command()
+      digitalWrite(_cs, HIGH);
+      pinMode(_cs, OUTPUT);
+      pinMode(_dc, OUTPUT);
+    }
+    void onWindow(windowCallback_t callback) {
+      _window = callback;
+    }
+    /* A command byte, with DC low, then length bytes of parameters with DC high. CS is taken low for it, unless it's
+     * in a window callback, during update(), when it already is. */
+    void command(uint8_t cmd, const uint8_t *data = NULL, uint8_t length = 0) {
+      bool active = _active;
+      if (!active) {
+        _select();
+      }
+      digitalWrite(_dc, LOW);
+      _port.transfer(cmd);
+      digitalWrite(_dc, HIGH);
+      if (length) {
+        _port.writeBytes(data, length);
+      }
+      if (!active) {
+        _deselect();
+      }
+    }
+
+    /* x0, y0 to x1, y1 (inclusive) need to be redrawn. Off the edge of the screen is clipped. */
+    void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+      x0 = (x0 < 0) ? 0 : x0;
+      y0 = (y0 < 0) ? 0 : y0;
+      x1 = (x1 >= (int16_t)_width)  ? _width - 1  : x1;
+      y1 = (y1 >= (int16_t)_height) ? _height - 1 : y1;
+      if (x0 > x1 || y0 > y1) {
+        return;
+      }
+      if (!dirty()) {
+        _x0 = x0;
+        _y0 = y0;
+        _x1 = x1;
+        _y1 = y1;
+        return;
+      }
+      _x0 = ((uint16_t)x0 < _x0) ? x0 : _x0;
+      _y0 = ((uint16_t)y0 < _y0) ? y0 : _y0;
+      _x1 = ((uint16_t)x1 > _x1) ? x1 : _x1;
+      _y1 = ((uint16_t)y1 > _y1) ? y1 : _y1;
+    }
+    void markDirtyRows(int16_t y0, int16_t y1) {
+      markDirty(0, y0, _width - 1, y1);
+    }
+    void markAllDirty() {
+      markDirty(0, 0, _width - 1, _height - 1);
+    }
+    bool dirty() {
+      return _x0 <= _x1;
+    }
+    void clean() {                 // forget it all; there's nothing to redraw
+      _x0 = 0xFFFF;
+      _y0 = 0xFFFF;
+      _x1 = 0;
+      _y1 = 0;
+    }
+
+    /* Redraws the dirty rectangle, if any, a band at a time: as many rows of it as fit in the buffer, rendered and then
+     * sent. Returns the number of rows sent - 0 if nothing was dirty, or if not even one row of it fits. */
+    uint16_t update(renderCallback_t render, uint8_t *buffer, uint16_t size) {
+      if (!dirty()) {
+        return 0;
+      }
+      uint16_t width = _x1 - _x0 + 1;
+      uint16_t bytes = width * _bpp;          // per row
+      if (bytes > size) {
+        return 0;
+      }
+      uint8_t  band = ((size / bytes) > 255) ? 255 : (size / bytes);
+      uint16_t x = _x0, y = _y0, y1 = _y1;
+      clean();                                // anything marked by render() is for the next update()
+      _port.beginTransaction(_settings);
+      _active = true;
+      _select();
+      if (_window) {
+        _window(*this, x, y, x + width - 1, y1);
+      } else {
+        _mipiWindow(x, y, x + width - 1, y1);
+      }                                       // command() leaves DC high, for the pixels
+      uint16_t rows = y1 - y + 1;
+      for (uint16_t done = 0; done < rows; done += band) {
+        uint8_t n = (rows - done < band) ? (rows - done) : band;
+        render(x, y + done, width, n, buffer);
+        _port.writeBytes(buffer, bytes * n);
+      }
+      _deselect();
+      _active = false;
+      _port.endTransaction();
+      return rows;
+    }
+
+  private:
+    void _select() {
+      digitalWrite(_cs, LOW);
+    }
+    void _deselect() {
+      digitalWrite(_cs, HIGH);
+    }
+    void _mipiWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+      uint8_t columns[4] = {(uint8_t)(x0 >> 8), (uint8_t)x0, (uint8_t)(x1 >> 8), (uint8_t)x1};
+      uint8_t rows[4]    = {(uint8_t)(y0 >> 8), (uint8_t)y0, (uint8_t)(y1 >> 8), (uint8_t)y1};
+      command(0x2A, columns, 4);              // CASET
+      command(0x2B, rows, 4);                 // RASET
+      command(0x2C);                          // RAMWR
+    }
+
+    Port            &_port;
+    SPISettings      _settings;
+    uint8_t          _cs;
+    uint8_t          _dc;
+    uint16_t         _width;
+    uint16_t         _height;
+    uint8_t          _bpp;
+    bool             _active = false;
+    windowCallback_t _window = NULL;
+    uint16_t         _x0, _y0, _x1, _y1;
+};
+
+typedef SPIDisplayPort<SPIClass> SPIDisplay;
+#if defined(_USARTSPI_H_INCLUDED)
+  typedef SPIDisplayPort<USARTSPIClass> USARTSPIDisplay;
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+/*
+   SPI_async.cpp - interrupt driven transfers for the SPI library
+   Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+   Free Software - LGPL 2.1, please see LICENCE.md for details
+
+   transferAsync() does what transfer(txbuf, rxbuf, count) does, but from the SPI interrupt, so it returns at
+   once. It runs in buffered mode with the receive complete interrupt: two bytes are loaded to start with, and
+   each interrupt stores one and loads the next, so a byte is always waiting in the transmit buffer and no more
+   than two are ever in flight. This is in its own file, so none of it is linked in unless it's used.
+*/
+
+#include "SPI.h"
+#include <Arduino.h>
+
+static struct {
+  const uint8_t *tx;
+  uint8_t *rx;
+  size_t count;
+  size_t sent;
+  size_t received;
+  spiAsyncCallback_t callback;
+  uint8_t csPin;
+  uint8_t ctrlb;                                // CTRLB to go back to
+} spiAsync;
+
+static void spiAsyncIRQ() {
+  SPI.onAsyncIRQ();
+}
+
+/*
+  Returns false if one is already running. If interrupts are off - including when usingInterrupt() made
+  beginTransaction() turn them off - the interrupt could never run, so it's done right here, blocking,
+  and the callback is called before it returns. An endTransaction() while it runs is put off until it's done,
+  so the interrupts usingInterrupt() masked stay masked, and beginTransaction() waits for it to finish.
+*/
+bool SPIClass::transferAsync(const void *txbuf, void *rxbuf, size_t count, spiAsyncCallback_t callback, uint8_t csPin) {
+  if (asyncState & SPI_ASYNC_BUSY) {
+    return false;
+  }
+  if (csPin != NOT_A_PIN) {
+    digitalWrite(csPin, LOW);
+  }
+  if (count == 0 || !(SREG & CPU_I_bm)) {
+    transfer(txbuf, rxbuf, count);
+    if (csPin != NOT_A_PIN) {
+      digitalWrite(csPin, HIGH);
+    }
+    if (callback != NULL) {
+      callback();
+    }
+    return true;
+  }
+  spiAsync.tx       = reinterpret_cast<const uint8_t *>(txbuf);
+  spiAsync.rx       = reinterpret_cast<uint8_t *>(rxbuf);
+  spiAsync.count    = count;
+  spiAsync.received = 0;
+  spiAsync.callback = callback;
+  spiAsync.csPin    = csPin;
+  uint8_t oldSREG = SREG;
+  cli();
+  asyncState        = SPI_ASYNC_BUSY;
+  spiAsync.ctrlb    = SPI0.CTRLB;
+  SPI0.CTRLB        = spiAsync.ctrlb | SPI_BUFEN_bm | SPI_BUFWR_bm;
+  while (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+    SPI0.DATA;                                  // nothing stale in the receive buffer
+  }
+  uint8_t first = (count > 1) ? 2 : 1;
+  for (uint8_t i = 0; i < first; i++) {
+    SPI0.DATA = (spiAsync.tx != NULL) ? spiAsync.tx[i] : 0xFF;
+  }
+  spiAsync.sent     = first;
+  spiInterruptHandler = spiAsyncIRQ;
+  SPI0.INTCTRL      = SPI_RXCIE_bm;
+  SREG = oldSREG;
+  return true;
+}
+
+void SPIClass::onAsyncIRQ() {
+  uint8_t data = SPI0.DATA;
+  if (spiAsync.rx != NULL) {
+    spiAsync.rx[spiAsync.received] = data;
+  }
+  spiAsync.received++;
+  if (spiAsync.sent < spiAsync.count) {
+    SPI0.DATA = (spiAsync.tx != NULL) ? spiAsync.tx[spiAsync.sent] : 0xFF;
+    spiAsync.sent++;
+  } else if (spiAsync.received == spiAsync.count) {
+    SPI0.INTCTRL = 0;
+    SPI0.CTRLB   = spiAsync.ctrlb;
+    if (spiAsync.csPin != NOT_A_PIN) {
+      digitalWrite(spiAsync.csPin, HIGH);
+    }
+    uint8_t state = asyncState;
+    asyncState = 0;
+    if (state & SPI_ASYNC_END) {
+      endTransaction();
+    }
+    if (spiAsync.callback != NULL) {
+      spiAsync.callback();
+    }
+  }
+}
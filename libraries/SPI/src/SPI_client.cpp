@@ -0,0 +1,183 @@
+/*
+   SPI_client.cpp - client (slave) mode for the SPI library
+   Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+   Free Software - LGPL 2.1, please see LICENCE.md for details
+
+   For using the part as an SPI peripheral of some other microcontroller. SPI0 runs in buffered mode, so the
+   next byte to send is waiting in the transmit buffer and a received one can wait for the ISR in the receive
+   buffer, and the ISR moves bytes between those and a pair of ring buffers, so the host can clock at full
+   speed. The start of a frame comes from the SS trigger interrupt; the hardware has nothing for the end of one,
+   so that's a RISING pin interrupt on SS, through attachInterrupt().
+
+   When there's nothing queued to send, the hardware sends whatever it has left - queue the reply before the
+   host clocks it out - and what arrives while the receive ring is full is dropped.
+*/
+
+#include "SPI.h"
+#include <Arduino.h>
+
+#if (SPI_CLIENT_BUFFER_SIZE & (SPI_CLIENT_BUFFER_SIZE - 1)) || SPI_CLIENT_BUFFER_SIZE > 128
+  #error "SPI_CLIENT_BUFFER_SIZE must be a power of 2, no larger than 128"
+#endif
+#define SPI_CLIENT_MASK   (SPI_CLIENT_BUFFER_SIZE - 1)
+
+static struct {
+  volatile uint8_t rxHead;
+  volatile uint8_t rxTail;
+  volatile uint8_t txHead;
+  volatile uint8_t txTail;
+  volatile uint8_t frameCount;                  // bytes received since SS went low
+  uint8_t ssPin;
+  uint8_t misoPin;
+  void (*onSelect)(void);
+  void (*onDeselect)(uint8_t count);
+  uint8_t rxBuffer[SPI_CLIENT_BUFFER_SIZE];
+  uint8_t txBuffer[SPI_CLIENT_BUFFER_SIZE];
+} spiClient;
+
+static void spiClientIRQ() {
+  uint8_t flags = SPI0.INTFLAGS;
+  if (flags & SPI_SSIF_bm) {
+    SPI0.INTFLAGS = SPI_SSIF_bm;
+    spiClient.frameCount = 0;
+    if (spiClient.onSelect != NULL) {
+      spiClient.onSelect();
+    }
+  }
+  while (flags & SPI_RXCIF_bm) {                // there can be two
+    uint8_t data = SPI0.DATA;
+    uint8_t head = spiClient.rxHead;
+    uint8_t next = (head + 1) & SPI_CLIENT_MASK;
+    if (next != spiClient.rxTail) {
+      spiClient.rxBuffer[head] = data;
+      spiClient.rxHead = next;
+    }
+    if (spiClient.frameCount != 255) {
+      spiClient.frameCount++;
+    }
+    flags = SPI0.INTFLAGS;
+  }
+  if ((flags & SPI_DREIF_bm) && (SPI0.INTCTRL & SPI_DREIE_bm)) {
+    uint8_t tail = spiClient.txTail;
+    if (tail != spiClient.txHead) {
+      SPI0.DATA = spiClient.txBuffer[tail];
+      tail = (tail + 1) & SPI_CLIENT_MASK;
+      spiClient.txTail = tail;
+    }
+    if (tail == spiClient.txHead) {
+      SPI0.INTCTRL &= ~SPI_DREIE_bm;            // nothing more queued; clientWrite() turns it back on
+    }
+  }
+}
+
+static void spiClientDeselected() {
+  spiClientIRQ();                               // collect the last byte, which may still be waiting
+  if (spiClient.onDeselect != NULL) {
+    spiClient.onDeselect(spiClient.frameCount);
+  }
+}
+
+bool SPIClass::beginClient(uint8_t dataMode, uint8_t bitOrder) {
+  init();
+  #if defined(PORTMUX_CTRLB)
+  PORTMUX.CTRLB = _uc_mux | (PORTMUX.CTRLB & ~PORTMUX_SPI0_bm);
+  #elif defined(PORTMUX_SPIROUTEA)
+  PORTMUX.SPIROUTEA = _uc_mux | (PORTMUX.SPIROUTEA & ~3);
+  #endif
+  spiClient.ssPin   = PIN_SPI_SS;
+  spiClient.misoPin = PIN_SPI_MISO;
+  #if defined(PIN_SPI_SS_PINSWAP_1) && defined(PIN_SPI_MISO_PINSWAP_1)
+  if (_uc_mux != 0) {
+    spiClient.ssPin   = PIN_SPI_SS_PINSWAP_1;
+    spiClient.misoPin = PIN_SPI_MISO_PINSWAP_1;
+  }
+  #endif
+  SPI0.CTRLA = 0;
+  SPI0.INTCTRL = 0;
+  spiClient.rxHead = spiClient.rxTail = 0;
+  spiClient.txHead = spiClient.txTail = 0;
+  spiClient.frameCount = 0;
+  pinMode(spiClient.misoPin, OUTPUT);           // the hardware only drives it while SS is low
+  pinMode(spiClient.ssPin, INPUT_PULLUP);       // so a floating SS doesn't select us
+  attachInterrupt(digitalPinToInterrupt(spiClient.ssPin), spiClientDeselected, RISING);
+  spiInterruptHandler = spiClientIRQ;
+  SPI0.CTRLB   = dataMode | SPI_BUFEN_bm | SPI_BUFWR_bm;
+  SPI0.INTFLAGS = SPI_SSIF_bm | SPI_TXCIF_bm;
+  SPI0.INTCTRL = SPI_RXCIE_bm | SPI_SSIE_bm;
+  SPI0.CTRLA   = SPI_ENABLE_bm | ((bitOrder == LSBFIRST) ? SPI_DORD_bm : 0);
+  return true;
+}
+
+void SPIClass::endClient() {
+  SPI0.INTCTRL = 0;
+  SPI0.CTRLA   = 0;
+  detachInterrupt(digitalPinToInterrupt(spiClient.ssPin));
+  pinMode(spiClient.misoPin, INPUT);
+  spiInterruptHandler = NULL;
+  initialized = false;                          // begin() sets up host mode again
+}
+
+void SPIClass::onClientSelect(void (*callback)(void)) {
+  spiClient.onSelect = callback;
+}
+
+void SPIClass::onClientDeselect(void (*callback)(uint8_t count)) {
+  spiClient.onDeselect = callback;
+}
+
+uint8_t SPIClass::clientAvailable() {
+  return (spiClient.rxHead - spiClient.rxTail) & SPI_CLIENT_MASK;
+}
+
+int SPIClass::clientRead() {
+  uint8_t tail = spiClient.rxTail;
+  if (tail == spiClient.rxHead) {
+    return -1;
+  }
+  uint8_t data = spiClient.rxBuffer[tail];
+  spiClient.rxTail = (tail + 1) & SPI_CLIENT_MASK;
+  return data;
+}
+
+int SPIClass::clientPeek() {
+  uint8_t tail = spiClient.rxTail;
+  if (tail == spiClient.rxHead) {
+    return -1;
+  }
+  return spiClient.rxBuffer[tail];
+}
+
+size_t SPIClass::clientWrite(uint8_t data) {
+  uint8_t head = spiClient.txHead;
+  uint8_t next = (head + 1) & SPI_CLIENT_MASK;
+  if (next == spiClient.txTail) {
+    return 0;                                   // full
+  }
+  spiClient.txBuffer[head] = data;
+  spiClient.txHead = next;
+  uint8_t oldSREG = SREG;
+  cli();
+  SPI0.INTCTRL |= SPI_DREIE_bm;
+  SREG = oldSREG;
+  return 1;
+}
+
+size_t SPIClass::clientWrite(const uint8_t *buf, size_t count) {
+  size_t written = 0;
+  while (written < count && clientWrite(buf[written])) {
+    written++;
+  }
+  return written;
+}
+
+uint8_t SPIClass::clientAvailableForWrite() {
+  return SPI_CLIENT_MASK - ((spiClient.txHead - spiClient.txTail) & SPI_CLIENT_MASK);
+}
+
+void SPIClass::clientFlush() {
+  uint8_t oldSREG = SREG;
+  cli();
+  spiClient.txTail = spiClient.txHead;
+  SPI0.INTCTRL &= ~SPI_DREIE_bm;
+  SREG = oldSREG;
+}
@@ -0,0 +1,21 @@
+/*
+   SPI_isr.cpp - the SPI0 interrupt, shared by async transfers and client mode
+   Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+   Free Software - LGPL 2.1, please see LICENCE.md for details
+
+   Whichever of them is started points spiInterruptHandler at its own handler, so using one doesn't pull in
+   the other; this file is only linked in when one of them refers to spiInterruptHandler.
+*/
+
+#include "SPI.h"
+#include <Arduino.h>
+
+void (*spiInterruptHandler)(void) = NULL;
+
+ISR(SPI0_INT_vect) {
+  if (spiInterruptHandler != NULL) {
+    spiInterruptHandler();
+  } else {
+    SPI0.INTCTRL = 0;                           // nothing wants it
+  }
+}
@@ -0,0 +1,147 @@
+/*
+   SPI_queue.cpp - a prioritized transaction queue for several devices sharing the bus
+   Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+   Free Software - LGPL 2.1, please see LICENCE.md for details
+
+   queue() takes a transaction - a device (settings and CS pin), buffers, and a count - from the sketch or from an
+   ISR, and the SPI interrupt runs them one after another, with each device's settings and CS, the same way
+   transferAsync() moves the bytes. Normal priority ones are moved SPI_QUEUE_CHUNK bytes at a time; at the end of
+   each chunk, if a high priority one is waiting, the normal one's CS goes high, the high priority one runs, and
+   then the normal one picks up where it left off. So a short read of an ADC that just signalled it has a result
+   waits for at most one chunk of a 512 byte SD block, not the whole block. Devices that can't be deselected in the
+   middle of a transaction have noSplit set, which makes it wait instead.
+   Queued transactions are kept in two lists, linked through the transactions themselves, so nothing is allocated.
+*/
+
+#include "SPI.h"
+#include <Arduino.h>
+
+static struct {
+  struct spiTransaction *high;                  // the head of each list
+  struct spiTransaction *normal;
+  struct spiTransaction *current;               // the one the SPI is moving, or NULL between them
+  uint16_t sent;                                // bytes of current loaded into DATA
+  uint16_t chunkEnd;                            // where this part of it ends
+  uint8_t ctrla;                                // CTRLA and CTRLB to go back to when the queue is empty
+  uint8_t ctrlb;
+} spiQueue;
+
+static void spiQueueIRQ() {
+  SPI.onQueueIRQ();
+}
+
+static void spiQueueAppend(struct spiTransaction **list, struct spiTransaction *t) {
+  t->_next = NULL;
+  while (*list != NULL) {
+    list = &((*list)->_next);
+  }
+  *list = t;
+}
+
+static void spiQueueLoad() {                    // start a part: up to two bytes, as transferAsync() does
+  struct spiTransaction *t = spiQueue.current;
+  const uint8_t *tx = reinterpret_cast<const uint8_t *>(t->txbuf);
+  uint16_t end = t->_done + ((t->priority == SPI_QUEUE_HIGH || t->device->noSplit) ? t->count : SPI_QUEUE_CHUNK);
+  spiQueue.chunkEnd = (end > t->count || end < t->_done) ? t->count : end;
+  spiQueue.sent     = t->_done;
+  for (uint8_t i = 0; i < 2 && spiQueue.sent < spiQueue.chunkEnd; i++) {
+    SPI0.DATA = (tx != NULL) ? tx[spiQueue.sent] : 0xFF;
+    spiQueue.sent++;
+  }
+}
+
+/* At the end of a part of the current transaction, or with nothing running: go on with it, or pause it for a high
+   priority one, or start the next. Called with interrupts off. */
+void SPIClass::queueNext() {
+  struct spiTransaction *t = spiQueue.current;
+  if (t != NULL) {
+    if (spiQueue.high == NULL || t->priority == SPI_QUEUE_HIGH) {
+      spiQueueLoad();
+      return;
+    }
+    digitalWrite(t->device->csPin, HIGH);       // paused, to be picked up first among the normal ones
+    t->status        = SPI_QUEUE_WAITING;
+    t->_next         = spiQueue.normal;
+    spiQueue.normal  = t;
+    spiQueue.current = NULL;
+  }
+  if (spiQueue.high != NULL) {
+    t = spiQueue.high;
+    spiQueue.high = t->_next;
+  } else if (spiQueue.normal != NULL) {
+    t = spiQueue.normal;
+    spiQueue.normal = t->_next;
+  } else {                                      // all done
+    SPI0.INTCTRL = 0;
+    SPI0.CTRLA   = spiQueue.ctrla;
+    SPI0.CTRLB   = spiQueue.ctrlb;
+    uint8_t state = asyncState;
+    asyncState = 0;
+    if (state & SPI_ASYNC_END) {
+      endTransaction();
+    }
+    return;
+  }
+  spiQueue.current = t;
+  t->status        = SPI_QUEUE_RUNNING;
+  SPI0.CTRLA       = t->device->settings.ctrla;
+  SPI0.CTRLB       = t->device->settings.ctrlb | SPI_BUFEN_bm | SPI_BUFWR_bm;
+  while (SPI0.INTFLAGS & SPI_RXCIF_bm) {
+    SPI0.DATA;                                  // nothing stale in the receive buffer
+  }
+  digitalWrite(t->device->csPin, LOW);
+  spiQueueLoad();
+}
+
+/*
+  Returns false if t is already waiting or running or has a count of 0, if begin() hasn't set the SPI up as a
+  host, or if transferAsync() is using it. Otherwise it's added to the end of the list for its priority, and if
+  the queue was idle, it starts at once. While anything is queued, beginTransaction() waits for the queue to empty, as it
+  does for transferAsync().
+*/
+bool SPIClass::queue(struct spiTransaction *t) {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (t->status != SPI_QUEUE_DONE || t->count == 0 || !(SPI0.CTRLA & SPI_MASTER_bm) ||
+      ((asyncState & SPI_ASYNC_BUSY) && !(asyncState & SPI_ASYNC_QUEUE))) {
+    SREG = oldSREG;
+    return false;
+  }
+  t->_done  = 0;
+  t->status = SPI_QUEUE_WAITING;
+  spiQueueAppend((t->priority == SPI_QUEUE_HIGH) ? &spiQueue.high : &spiQueue.normal, t);
+  if (!(asyncState & SPI_ASYNC_QUEUE)) {
+    asyncState          = SPI_ASYNC_BUSY | SPI_ASYNC_QUEUE;
+    spiQueue.ctrla      = SPI0.CTRLA;
+    spiQueue.ctrlb      = SPI0.CTRLB;
+    spiInterruptHandler = spiQueueIRQ;
+    SPI0.INTCTRL        = SPI_RXCIE_bm;
+    queueNext();
+  }
+  SREG = oldSREG;
+  return true;
+}
+
+void SPIClass::onQueueIRQ() {
+  struct spiTransaction *t = spiQueue.current;
+  uint8_t data = SPI0.DATA;
+  if (t->rxbuf != NULL) {
+    reinterpret_cast<uint8_t *>(t->rxbuf)[t->_done] = data;
+  }
+  t->_done++;
+  if (spiQueue.sent < spiQueue.chunkEnd) {
+    const uint8_t *tx = reinterpret_cast<const uint8_t *>(t->txbuf);
+    SPI0.DATA = (tx != NULL) ? tx[spiQueue.sent] : 0xFF;
+    spiQueue.sent++;
+  } else if (t->_done == spiQueue.chunkEnd) {
+    if (t->_done == t->count) {
+      digitalWrite(t->device->csPin, HIGH);
+      spiQueue.current = NULL;
+      t->status = SPI_QUEUE_DONE;
+      if (t->callback != NULL) {
+        t->callback(t);                         // queue() from here just adds to the lists
+      }
+    }
+    queueNext();
+  }
+}
@@ -0,0 +1,215 @@
+/* USARTSPI.cpp - a USART in Master SPI mode (MSPI) as a second SPI host
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "USARTSPI.h"
+
+/* In MSPI mode only BAUD[15:6] count: SCK = CLK_PER / (2 * BAUD[15:6]). */
+#define USARTSPI_BAUD(n)  ((uint16_t)(n) << 6)
+
+USARTSPIClass::USARTSPIClass(volatile USART_t *module, uint8_t module_number) :
+  _module(module), _module_number(module_number) {
+  _mux   = 0;
+  _ctrlc = USART_CMODE_MSPI_gc;
+}
+
+bool USARTSPIClass::swap(uint8_t state) {
+  if (_module_number + state >= sizeof(_usart_pins) / sizeof(_usart_pins[0])) {
+    return false;
+  }
+  if (_usart_pins[_module_number + state][2] == NOT_A_PIN) {
+    return false;                             // no XCK there (the 8-pin parts' alternate pins)
+  }
+  _mux = state;
+  return true;
+}
+
+bool USARTSPIClass::pins(uint8_t pinMOSI, uint8_t pinMISO) {
+  uint8_t state = UartClass::_pins_to_swap(_module_number, pinMOSI, pinMISO);
+  if (state > 1) {
+    return false;
+  }
+  return swap(state);
+}
+
+uint8_t USARTSPIClass::getSCK() {
+  return _usart_pins[_module_number + _mux][2];
+}
+
+void USARTSPIClass::begin() {
+  uint8_t oldSREG = SREG;
+  cli();
+  _module->CTRLB = 0;
+  _module->CTRLA = 0;                         // polled; the Serial ISRs must never see it
+  UartClass::_set_pins(_module_number, _mux, USART_TXEN_bm | USART_RXEN_bm);  // MOSI output, MISO input
+  uint8_t sck = getSCK();
+  digitalWrite(sck, LOW);
+  pinMode(sck, OUTPUT);
+  SREG = oldSREG;
+  beginTransaction(SPISettings());
+}
+
+void USARTSPIClass::end() {
+  _module->CTRLB = 0;
+  uint8_t sck = getSCK();
+  volatile uint8_t *pinctrl = getPINnCTRLregister(digitalPinToPortStruct(sck), digitalPinToBitPosition(sck));
+  *pinctrl &= ~PORT_INVEN_bm;
+  pinMode(sck, INPUT);
+  pinMode(_usart_pins[_module_number + _mux][0], INPUT);
+}
+
+void USARTSPIClass::beginTransaction(SPISettings settings) {
+  /* Work the SPI0 clock divider back out of the settings: PRESC is /4, /16, /64 or /128, halved by CLK2X. */
+  static const uint8_t divs[4] = {4, 16, 64, 128};
+  uint8_t div = divs[(settings.ctrla & SPI_PRESC_gm) >> SPI_PRESC_gp];
+  if (settings.ctrla & SPI_CLK2X_bm) {
+    div >>= 1;
+  }
+  config(USARTSPI_BAUD(div >> 1), (settings.ctrla & SPI_DORD_bm) ? LSBFIRST : MSBFIRST, settings.ctrlb & SPI_MODE_gm);
+}
+
+void USARTSPIClass::config(uint16_t baud, uint8_t bitOrder, uint8_t dataMode) {
+  _module->BAUD = baud;
+  _ctrlc = USART_CMODE_MSPI_gc;
+  setBitOrder(bitOrder);
+  setDataMode(dataMode);
+  _module->CTRLB = USART_TXEN_bm | USART_RXEN_bm;
+}
+
+void USARTSPIClass::setClock(uint32_t clock) {
+  uint32_t n = (F_CPU + (2 * clock) - 1) / (2 * clock);
+  if (n == 0) {
+    n = 1;
+  } else if (n > 1023) {
+    n = 1023;
+  }
+  _module->BAUD = USARTSPI_BAUD(n);
+}
+
+void USARTSPIClass::setBitOrder(uint8_t order) {
+  if (order == LSBFIRST) {
+    _ctrlc |= USART_UDORD_bm;
+  } else {
+    _ctrlc &= ~USART_UDORD_bm;
+  }
+  _module->CTRLC = _ctrlc;
+}
+
+void USARTSPIClass::setDataMode(uint8_t mode) {
+  /* UCPHA is the phase; the polarity is had by inverting the XCK pin, which is how the datasheet says to do it. */
+  if (mode & 0x01) {
+    _ctrlc |= USART_UCPHA_bm;
+  } else {
+    _ctrlc &= ~USART_UCPHA_bm;
+  }
+  _module->CTRLC = _ctrlc;
+  uint8_t sck = getSCK();
+  volatile uint8_t *pinctrl = getPINnCTRLregister(digitalPinToPortStruct(sck), digitalPinToBitPosition(sck));
+  if (mode & 0x02) {
+    *pinctrl |= PORT_INVEN_bm;
+  } else {
+    *pinctrl &= ~PORT_INVEN_bm;
+  }
+}
+
+uint8_t USARTSPIClass::transfer(uint8_t data) {
+  while (!(_module->STATUS & USART_DREIF_bm));
+  _module->TXDATAL = data;
+  while (!(_module->STATUS & USART_RXCIF_bm));
+  return _module->RXDATAL;
+}
+
+uint16_t USARTSPIClass::transfer16(uint16_t data) {
+  union {
+    uint16_t val;
+    struct {
+      uint8_t lsb;
+      uint8_t msb;
+    };
+  } t;
+  t.val = data;
+  if (!(_ctrlc & USART_UDORD_bm)) {
+    t.msb = transfer(t.msb);
+    t.lsb = transfer(t.lsb);
+  } else {
+    t.lsb = transfer(t.lsb);
+    t.msb = transfer(t.msb);
+  }
+  return t.val;
+}
+
+/* The block transfers keep the transmit buffer full, like SPIClass does in buffered mode: at most 2 bytes in flight,
+   so the 2 byte receive FIFO can never overflow. */
+static inline void usartSpiDrainReceive(volatile USART_t *module) {
+  while (module->STATUS & USART_RXCIF_bm) {
+    module->RXDATAL;
+  }
+}
+
+void USARTSPIClass::transfer(void *buf, size_t count) {
+  transfer(buf, buf, count);
+}
+
+void USARTSPIClass::transfer(const void *txbuf, void *rxbuf, size_t count) {
+  if (rxbuf == NULL) {
+    writeBytes(txbuf, count);
+    return;
+  }
+  if (txbuf == NULL) {
+    readBytes(rxbuf, count);
+    return;
+  }
+  const uint8_t *tx = reinterpret_cast<const uint8_t *>(txbuf);
+  uint8_t *rx = reinterpret_cast<uint8_t *>(rxbuf);
+  volatile USART_t *module = _module;
+  usartSpiDrainReceive(module);
+  size_t sent = 0;
+  size_t received = 0;
+  while (received < count) {
+    uint8_t flags = module->STATUS;
+    if (flags & USART_RXCIF_bm) {
+      rx[received++] = module->RXDATAL;
+    } else if ((flags & USART_DREIF_bm) && sent < count && (sent - received) < 2) {
+      module->TXDATAL = tx[sent++];
+    }
+  }
+}
+
+void USARTSPIClass::writeBytes(const void *buf, size_t count) {
+  const uint8_t *tx = reinterpret_cast<const uint8_t *>(buf);
+  volatile USART_t *module = _module;
+  module->STATUS = USART_TXCIF_bm;            // cleared, so we can tell when the last byte is out
+  while (count--) {
+    while (!(module->STATUS & USART_DREIF_bm)) {
+      usartSpiDrainReceive(module);           // the FIFO is only 2 deep, and nothing reads it
+    }
+    module->TXDATAL = *tx++;
+  }
+  while (!(module->STATUS & USART_TXCIF_bm));
+  usartSpiDrainReceive(module);
+}
+
+void USARTSPIClass::readBytes(void *buf, size_t count, uint8_t fill) {
+  uint8_t *rx = reinterpret_cast<uint8_t *>(buf);
+  volatile USART_t *module = _module;
+  usartSpiDrainReceive(module);
+  size_t sent = 0;
+  size_t received = 0;
+  while (received < count) {
+    uint8_t flags = module->STATUS;
+    if (flags & USART_RXCIF_bm) {
+      rx[received++] = module->RXDATAL;
+    } else if ((flags & USART_DREIF_bm) && sent < count && (sent - received) < 2) {
+      module->TXDATAL = fill;
+      sent++;
+    }
+  }
+}
+
+#if defined(USART0)
+  USARTSPIClass USARTSPI0(&USART0, 0);
+#endif
+#if defined(USART1)
+  USARTSPIClass USARTSPI1(&USART1, 1);
+#endif
@@ -0,0 +1,57 @@
+/* USARTSPI.h - a USART in Master SPI mode (MSPI) as a second SPI host
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Every USART on these parts can be put into MSPI mode, where TX is MOSI, RX is MISO, and XCK is SCK. It's host only,
+ * there's no SS (use any pin), and SCK is CLK_PER / (2 * n) for any n from 1 to 1023 - every clock SPI0 has, and the
+ * ones in between its prescaler steps. The methods match those of SPIClass, so code written against SPI works with
+ * either. The USART can't be used as a Serial port while it's doing this.
+ */
+
+#ifndef _USARTSPI_H_INCLUDED
+#define _USARTSPI_H_INCLUDED
+
+#include <Arduino.h>
+#include "SPI.h"
+
+class USARTSPIClass {
+  public:
+    USARTSPIClass(volatile USART_t *module, uint8_t module_number);
+
+    uint8_t transfer(uint8_t data);
+    uint16_t transfer16(uint16_t data);
+    void transfer(void *buf, size_t count);
+    void transfer(const void *txbuf, void *rxbuf, size_t count);  // either may be NULL
+    void writeBytes(const void *buf, size_t count);                // nothing is stored
+    void readBytes(void *buf, size_t count, uint8_t fill = 0xFF);   // fill is sent
+
+    void beginTransaction(SPISettings settings);
+    void endTransaction(void) {}
+
+    bool pins(uint8_t pinMOSI, uint8_t pinMISO);  // SCK is the XCK pin of that mapping
+    bool swap(uint8_t state = 1);
+    void begin();
+    void end();
+
+    void setBitOrder(uint8_t order);
+    void setDataMode(uint8_t mode);
+    void setClock(uint32_t clock);                 // the fastest CLK_PER / (2 * n) that isn't faster than clock
+    uint8_t getSCK();                              // the pin SCK is on with the current mapping
+
+  private:
+    void config(uint16_t baud, uint8_t bitOrder, uint8_t dataMode);
+
+    volatile USART_t *const _module;
+    const uint8_t _module_number;
+    uint8_t _mux;
+    uint8_t _ctrlc;
+};
+
+#if defined(USART0)
+  extern USARTSPIClass USARTSPI0;
+#endif
+#if defined(USART1)
+  extern USARTSPIClass USARTSPI1;
+#endif
+
+#endif
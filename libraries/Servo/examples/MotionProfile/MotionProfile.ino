@@ -0,0 +1,21 @@
+/* MotionProfile
+  Sweeps a servo back and forth like Sweep, but with moveTo(), so the library ramps the speed up and down, and
+  loop() doesn't have to write every step. This example code is in the public domain.
+*/
+
+#include <Servo.h>
+
+Servo myservo;  // create servo object to control a servo
+
+void setup() {
+  myservo.attach(9);  // attaches the servo on pin 9 to the servo object
+}
+
+void loop() {
+  myservo.moveTo(180, 2000, 4000);   // to 180 degrees, at up to 2000 us/s, accelerating at 4000 us/s^2
+  while (myservo.moving());          // loop() is free to do anything else in the meantime
+  delay(500);
+  myservo.moveTo(0, 2000, 4000);
+  while (myservo.moving());
+  delay(500);
+}
@@ -26,6 +26,53 @@ uint8_t ServoCount = 0;                                    // the total number o
 #define SERVO_MIN() (MIN_PULSE_WIDTH - this->min * 4)                                               // minimum value in uS for this servo
 #define SERVO_MAX() (MAX_PULSE_WIDTH - this->max * 4)                                               // maximum value in uS for this servo
 
+/* Advance each servo that moveTo() is moving by one frame of its profile: speed up by accel until it's at vmax, or
+ * it's time to start slowing down to stop at the target, then slow down by accel. If it was moving the other way when
+ * the target was set, it slows down to a stop first. All fixed point, ticks << 8. Called from the ISR in the gap
+ * after the last pulse of a frame, so the time it takes doesn't end up in anyone's pulse width. */
+static void servoStepMotion() {
+  for (uint8_t i = 0; i < ServoCount; i++) {
+    servoMotion_t *m = servos[i].motion;
+    if (!m) {
+      continue;
+    }
+    int32_t  dist     = (int32_t) (((uint32_t) m->target) << 8) - (int32_t) m->position;
+    int32_t  v        = m->velocity;
+    uint16_t a        = m->accel;
+    uint32_t left     = dist < 0 ? -dist : dist;
+    if (!a) {
+      v = dist < 0 ? -(int32_t) m->vmax : (int32_t) m->vmax;
+    } else if (v && ((v < 0) != (dist < 0))) {  // heading away from the target
+      if (v < 0) {
+        v = (v + a > 0) ? 0 : v + a;
+      } else {
+        v = (v - a < 0) ? 0 : v - a;
+      }
+    } else {
+      uint32_t speed  = v < 0 ? -v : v;
+      if ((speed / a) * (speed >> 1) + speed >= left) { // the distance it takes to stop from this speed
+        speed = (speed > ((uint32_t) a << 1)) ? speed - a : a;
+      } else if (speed < m->vmax) {
+        speed += a;
+        if (speed > m->vmax) {
+          speed = m->vmax;
+        }
+      }
+      v = dist < 0 ? -(int32_t) speed : (int32_t) speed;
+    }
+    uint32_t step = v < 0 ? -v : v;
+    if (((v < 0) == (dist < 0)) && step >= left) {
+      m->position = ((uint32_t) m->target) << 8;  // there.
+      m->velocity = 0;
+      servos[i].motion = NULL;
+    } else {
+      m->position += v;
+      m->velocity  = v;
+    }
+    servos[i].ticks = (m->position >> 8) - TRIM_DURATION;
+  }
+}
+
 void ServoHandler(int timer) {
   // SEVENTEEN TICKS (already!)
 
@@ -95,6 +142,7 @@ void ServoHandler(int timer) {
       currentCycleTicks = usToTicks(REFRESH_INTERVAL);
     }
     currentServoIndex[timer] = -1;   // this will get incremented at the end of the refresh period to start again at the first channel
+    servoStepMotion();
   }
   // 105 TICKS or 210 CLOCKS
   /* Clear flag */
@@ -202,6 +250,7 @@ void Servo::detach() {
   timer16_Sequence_t timer;
 
   servos[this->servoIndex].Pin.isActive = false;
+  servos[this->servoIndex].motion = NULL;
   timer = SERVO_INDEX_TO_TIMER(servoIndex);
   if (isTimerActive(timer) == false) {
     finISR();
@@ -235,7 +284,11 @@ void Servo::writeMicroseconds(unsigned int value) {
     value = usToTicks(value);
     // convert to ticks BEFORE compensating for interrupt overhead
     value = value - TRIM_DURATION;
+    uint8_t oldSREG = SREG;
+    cli();
+    servos[channel].motion = NULL;        // a write cancels any moveTo()
     servos[channel].ticks = value;
+    SREG = oldSREG;
   }
 }
 
@@ -257,4 +310,50 @@ bool Servo::attached() {
   return servos[this->servoIndex].Pin.isActive;
 }
 
+void Servo::moveTo(unsigned int value, unsigned int speed, unsigned int accel) {
+  if (this->servoIndex >= MAX_SERVOS) {
+    return;
+  }
+  if (value < MIN_PULSE_WIDTH) {          // an angle, as in write()
+    if (value > 180) {
+      value = 180;
+    }
+    value = map(value, 0, 180, SERVO_MIN(), SERVO_MAX());
+  }
+  if (value < (uint16_t) SERVO_MIN()) {
+    value = SERVO_MIN();
+  } else if (value > (uint16_t) SERVO_MAX()) {
+    value = SERVO_MAX();
+  }
+  if (!speed) {
+    writeMicroseconds(value);
+    return;
+  }
+  // per second to per frame, and per second squared to per frame squared, at one frame per REFRESH_INTERVAL.
+  uint32_t vmax = (((uint32_t) usToTicks((uint32_t) speed)) << 8) / (1000000UL / REFRESH_INTERVAL);
+  uint32_t acc  = accel ? (((uint32_t) usToTicks((uint32_t) accel)) << 8) / ((1000000UL / REFRESH_INTERVAL) * (1000000UL / REFRESH_INTERVAL)) : 0;
+  servo_t *s = &servos[this->servoIndex];
+  uint8_t oldSREG = SREG;
+  cli();
+  if (!s->motion) {                       // starting from rest, where it is now
+    this->motion.position = ((uint32_t) (s->ticks + TRIM_DURATION)) << 8;
+    this->motion.velocity = 0;
+  }
+  this->motion.target = usToTicks(value);
+  this->motion.vmax   = vmax ? vmax : 1;
+  this->motion.accel  = accel ? (acc > 0xFFFF ? 0xFFFF : (acc ? acc : 1)) : 0;
+  s->motion = &this->motion;
+  SREG = oldSREG;
+}
+
+bool Servo::moving() {
+  return this->servoIndex < MAX_SERVOS && servos[this->servoIndex].motion;
+}
+
+void Servo::stop() {
+  if (this->servoIndex < MAX_SERVOS) {
+    servos[this->servoIndex].motion = NULL;  // ticks is left where the last step put it.
+  }
+}
+
 #endif
@@ -53,6 +53,10 @@
     readMicroseconds()    - Gets the last written servo pulse width in microseconds. (was read_us() in first release)
     attached()            - Returns true if there is a servo attached.
     detach()              - Stops an attached servos from pulsing its i/o pin.
+    moveTo(value, speed, accel) - Moves to value (as for write()) at up to speed microseconds of pulse width per second,
+                            accelerating and decelerating at accel us/s^2 (0 = full speed at once), in the background.
+    moving()              - Returns true until the last moveTo() has got there.
+    stop()                - Stops moving, at the current position.
 
 
   This library supports 12 servos controlled by one timer.
@@ -107,9 +111,18 @@ typedef struct  {
   uint8_t bitmask;      // port & bitmask used instead of pin number to realize dramatic performance boost
 } ServoPin_t   ;
 
+typedef struct {
+  uint32_t position;    // where the pulse width is now, in timer ticks << 8
+  int32_t  velocity;    // ticks << 8 per frame, negative when the pulse is getting shorter
+  uint32_t vmax;        // ticks << 8 per frame
+  uint16_t accel;       // ticks << 8 per frame per frame, 0 to move at vmax the whole way
+  uint16_t target;      // timer ticks
+} servoMotion_t;
+
 typedef struct {
   ServoPin_t Pin;
   volatile unsigned int ticks;
+  servoMotion_t * volatile motion; // non-NULL while moveTo() is moving it - stepped once per frame by the ISR
 } servo_t;
 
 class Servo {
@@ -123,10 +136,39 @@ class Servo {
     int read();                                 // returns current pulse width as an angle between 0 and 180 degrees
     unsigned int readMicroseconds();            // returns current pulse width in microseconds for this servo (was read_us() in first release)
     bool attached();                            // return true if this servo is attached, otherwise false
+    void moveTo(unsigned int value, unsigned int speed, unsigned int accel = 0); // move there, speed in us/s, accel in us/s^2
+    bool moving();                              // true until a moveTo() gets there
+    void stop();                                // stop moving, where it is now
   private:
     uint8_t servoIndex;                         // index into the channel data for this servo
     int8_t min;                                 // minimum is this value times 4 added to MIN_PULSE_WIDTH
     int8_t max;                                 // maximum is this value times 4 added to MAX_PULSE_WIDTH
+    servoMotion_t motion;                       // the profile moveTo() set up
+};
+
+/*
+  ServoTCA0 has the same methods as Servo, but the pulses are generated by TCA0's compare channels, with TCA0 as a
+  single 16-bit timer at 50 Hz - no interrupts at all, so there is no jitter, however busy the part is. Only pins
+  with TCA0 WO0, WO1 or WO2 can be used, so there can be at most 3 of them. While any are attached, analogWrite() on
+  the other TCA0 pins works as it does after analogWriteFrequency(50) and analogWriteResolution(16). Not available
+  if TCA0 is used for millis.
+*/
+class ServoTCA0 {
+  public:
+    ServoTCA0();
+    uint8_t attach(byte pin);                   // returns the WO channel, or INVALID_SERVO if the pin isn't on WO0-2
+    uint8_t attach(byte pin, int min, int max);
+    void detach();
+    void write(unsigned int value);
+    void writeMicroseconds(unsigned int value);
+    int read();
+    unsigned int readMicroseconds();
+    bool attached();
+  private:
+    uint8_t channel;                            // TCA0 WO channel, or INVALID_SERVO when not attached
+    int8_t min;                                 // as in Servo
+    int8_t max;
+    unsigned int us;                            // the pulse width last written
 };
 
 #endif
@@ -0,0 +1,149 @@
+#if defined(ARDUINO_ARCH_MEGAAVR)
+
+#include <Arduino.h>
+#include <Servo_megaTinyCore.h>
+
+/* ServoTCA0 - servo pulses from TCA0's compare channels.
+ * TCA0 is set up the way analogWriteFrequency(50) and analogWriteResolution(16) leave it - a single 16-bit timer,
+ * period 20 ms, with PER as large as the prescaler allows - and each servo's pulse width is written to its CMPnBUF.
+ * The buffer is copied to the compare register at the end of the period, so a pulse is never cut short, and nothing
+ * runs per pulse, or per frame. This is kept in its own file, so it doesn't pull in the TCB ISR that Servo uses. */
+
+#define SERVO_MIN() (MIN_PULSE_WIDTH - this->min * 4)  // minimum value in uS for this servo
+#define SERVO_MAX() (MAX_PULSE_WIDTH - this->max * 4)  // maximum value in uS for this servo
+
+#if !defined(MILLIS_USE_TIMERA0)
+
+static uint8_t servoTCAChannels = 0;                    // the WO channels in use, one bit each
+
+/* The TCA0 compare channel this pin is on - only WO0-2 have one in single mode. */
+static uint8_t servoTCAChannel(uint8_t pin) {
+  if (digitalPinToTimerNow(pin) != TIMERA0) {
+    return INVALID_SERVO;                               // not a TCA0 pin, or TCA0 has been taken over.
+  }
+  uint8_t bit_mask = digitalPinToBitMask(pin);
+  #ifdef __AVR_ATtinyxy2__
+  if (bit_mask == 0x80) {
+    bit_mask = 1;  // on the xy2, WO0 is on PA7
+  }
+  #endif
+  if (bit_mask > 0x04) {
+    return INVALID_SERVO;
+  }
+  return bit_mask >> 1;                                 // 1, 2, 4 -> 0, 1, 2
+}
+
+ServoTCA0::ServoTCA0() {
+  this->channel = INVALID_SERVO;
+  this->us      = DEFAULT_PULSE_WIDTH;
+  this->min     = 0;
+  this->max     = 0;
+}
+
+uint8_t ServoTCA0::attach(byte pin) {
+  return this->attach(pin, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);
+}
+
+uint8_t ServoTCA0::attach(byte pin, int min, int max) {
+  if (this->channel != INVALID_SERVO) {
+    this->detach();
+  }
+  uint8_t channel = servoTCAChannel(pin);
+  if (channel == INVALID_SERVO || (servoTCAChannels & (1 << channel))) {
+    return INVALID_SERVO;
+  }
+  if (!servoTCAChannels) {
+    if (!analogWriteFrequency(1000000UL / REFRESH_INTERVAL)) {
+      return INVALID_SERVO;
+    }
+    analogWriteResolution(16);
+  }
+  servoTCAChannels |= (1 << channel);
+  this->min     = (MIN_PULSE_WIDTH - min) / 4;          // resolution of min/max is 4 uS
+  this->max     = (MAX_PULSE_WIDTH - max) / 4;
+  this->channel = channel;
+  this->writeMicroseconds(this->us);
+  digitalWrite(pin, LOW);
+  pinMode(pin, OUTPUT);
+  TCA0.SINGLE.CTRLB |= (TCA_SINGLE_CMP0EN_bm << channel);
+  return channel;
+}
+
+void ServoTCA0::detach() {
+  if (this->channel == INVALID_SERVO) {
+    return;
+  }
+  TCA0.SINGLE.CTRLB &= ~(TCA_SINGLE_CMP0EN_bm << this->channel);  // the PORT drives the pin low again.
+  servoTCAChannels  &= ~(1 << this->channel);
+  this->channel      = INVALID_SERVO;
+  if (!servoTCAChannels) {
+    analogWriteResolution(8);                           // TCA0 back to split mode, as the core sets it up.
+    analogWriteFrequency(0);
+  }
+}
+
+void ServoTCA0::write(unsigned int value) {
+  // treat values less than 544 as angles in degrees (valid values in microseconds are handled as microseconds)
+  if (value < MIN_PULSE_WIDTH) {
+    if (value > 180) {
+      value = 180;
+    }
+    value = map(value, 0, 180, SERVO_MIN(), SERVO_MAX());
+  }
+  writeMicroseconds(value);
+}
+
+void ServoTCA0::writeMicroseconds(unsigned int value) {
+  if (value < (uint16_t) SERVO_MIN()) {                 // ensure pulse width is valid
+    value = SERVO_MIN();
+  } else if (value > (uint16_t) SERVO_MAX()) {
+    value = SERVO_MAX();
+  }
+  this->us = value;
+  if (this->channel != INVALID_SERVO) {
+    (&TCA0.SINGLE.CMP0BUF)[this->channel] = ((uint32_t) value * (TCA0.SINGLE.PER + 1UL)) / REFRESH_INTERVAL;
+  }
+}
+
+int ServoTCA0::read() { // return the value as degrees
+  return map(readMicroseconds() + 1, SERVO_MIN(), SERVO_MAX(), 0, 180);
+}
+
+unsigned int ServoTCA0::readMicroseconds() {
+  return this->us;
+}
+
+bool ServoTCA0::attached() {
+  return this->channel != INVALID_SERVO;
+}
+
+#else
+ServoTCA0::ServoTCA0() {
+  this->channel = INVALID_SERVO;
+}
+uint8_t ServoTCA0::attach(__attribute__((unused)) byte pin) {
+  badCall("ServoTCA0 can't be used when TCA0 is used for millis");
+  return INVALID_SERVO;
+}
+uint8_t ServoTCA0::attach(__attribute__((unused)) byte pin, __attribute__((unused)) int min, __attribute__((unused)) int max) {
+  badCall("ServoTCA0 can't be used when TCA0 is used for millis");
+  return INVALID_SERVO;
+}
+void ServoTCA0::detach() {
+}
+void ServoTCA0::write(__attribute__((unused)) unsigned int value) {
+}
+void ServoTCA0::writeMicroseconds(__attribute__((unused)) unsigned int value) {
+}
+int ServoTCA0::read() {
+  return 0;
+}
+unsigned int ServoTCA0::readMicroseconds() {
+  return 0;
+}
+bool ServoTCA0::attached() {
+  return false;
+}
+#endif
+
+#endif
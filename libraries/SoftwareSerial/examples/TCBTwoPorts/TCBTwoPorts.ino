@@ -0,0 +1,43 @@
+/*
+  SoftwareSerialTCB: two software serial ports receiving at the same time
+
+  Unlike SoftwareSerial, both ports listen at once, each with its own
+  buffer, so nothing needs to switch between them with listen(), and
+  interrupts (millis, Serial) keep running while bytes arrive.
+  Uses TCB1 where there is one and millis isn't on it, otherwise TCB0 -
+  so not together with tone() or Servo on the same timer. Parts with a
+  second TCB can transmit in the background with the other one too.
+
+  This example code is in the public domain.
+*/
+
+#include <SoftwareSerialTCB.h>
+
+#if defined(TCB1)
+  // TCB1 receives, TCB0 transmits in the background, so write() only waits when the 16 byte buffer is full.
+  SOFTWARESERIALTCB_TX_TIMER(0);
+#endif
+
+SoftwareSerialTCB portOne(PIN_PA4, PIN_PA5);
+SoftwareSerialTCB portTwo(PIN_PA6, PIN_PA7);
+
+void setup() {
+  Serial.begin(115200);
+  portOne.begin(9600);
+  portTwo.begin(19200);
+}
+
+void loop() {
+  while (portOne.available() > 0) {
+    char inByte = portOne.read();
+    Serial.print(F("1: "));
+    Serial.println(inByte);
+    portTwo.write(inByte);      // pass it on to the other port
+  }
+  while (portTwo.available() > 0) {
+    char inByte = portTwo.read();
+    Serial.print(F("2: "));
+    Serial.println(inByte);
+    portOne.write(inByte);
+  }
+}
@@ -48,9 +48,7 @@
 // Static methods
 //
 SoftwareSerial *SoftwareSerial::active_object = 0;
-uint8_t SoftwareSerial::_receive_buffer[_SS_MAX_RX_BUFF];
-volatile uint8_t SoftwareSerial::_receive_buffer_tail = 0;
-volatile uint8_t SoftwareSerial::_receive_buffer_head = 0;
+RingBufferN<_SS_MAX_RX_BUFF> SoftwareSerial::_receive_buffer;
 
 //
 // Debugging
@@ -93,7 +91,7 @@ bool SoftwareSerial::listen() {
     }
 
     _buffer_overflow = false;
-    _receive_buffer_head = _receive_buffer_tail = 0;
+    _receive_buffer.clear();
     active_object = this;
 
     setRxIntMsk(true);
@@ -163,12 +161,7 @@ void SoftwareSerial::recv() {
     }
 
     // if buffer full, set the overflow flag and return
-    uint8_t next = (_receive_buffer_tail + 1) % _SS_MAX_RX_BUFF;
-    if (next != _receive_buffer_head) {
-      // save new data in buffer: tail points to where byte goes
-      _receive_buffer[_receive_buffer_tail] = d; // save new byte
-      _receive_buffer_tail = next;
-    } else {
+    if (!_receive_buffer.push(d)) {
       DebugPulse(_DEBUG_PIN1, 1);
       _buffer_overflow = true;
     }
@@ -353,14 +346,10 @@ int SoftwareSerial::read() {
     return -1;
   }
 
-  // Empty buffer?
-  if (_receive_buffer_head == _receive_buffer_tail) {
-    return -1;
+  uint8_t d;
+  if (!_receive_buffer.pop(d)) {
+    return -1;  // empty buffer
   }
-
-  // Read from "head"
-  uint8_t d = _receive_buffer[_receive_buffer_head]; // grab next byte
-  _receive_buffer_head = (uint8_t)(_receive_buffer_head + 1) % _SS_MAX_RX_BUFF; // this cast saves 6 bytes
   return d;
 }
 
@@ -369,9 +358,7 @@ int SoftwareSerial::available() {
     return 0;
   }
 
-  return (uint8_t)(_receive_buffer_tail + _SS_MAX_RX_BUFF - _receive_buffer_head) % _SS_MAX_RX_BUFF;
-  // this cast saves 86 - and a even a uint16_t saves 78, and cuts > 10 us from the execution time
-  // The shortcut of & (2^n - 1) only works for unsigned operands.
+  return _receive_buffer.available();
 }
 
 size_t SoftwareSerial::write(uint8_t b) {
@@ -440,11 +427,9 @@ int SoftwareSerial::peek() {
     return -1;
   }
 
-  // Empty buffer?
-  if (_receive_buffer_head == _receive_buffer_tail) {
-    return -1;
+  uint8_t d;
+  if (!_receive_buffer.peek(d)) {
+    return -1;  // empty buffer
   }
-
-  // Read from "head"
-  return _receive_buffer[_receive_buffer_head];
+  return d;
 }
@@ -34,6 +34,7 @@
 
 #include <inttypes.h>
 #include <Stream.h>
+#include <api/RingBuffer.h>
 
 /******************************************************************************
   Definitions
@@ -68,9 +69,7 @@ class SoftwareSerial : public Stream {
     uint16_t _inverse_logic: 1;
 
     // static data
-    static uint8_t _receive_buffer[_SS_MAX_RX_BUFF];
-    static volatile uint8_t _receive_buffer_tail;
-    static volatile uint8_t _receive_buffer_head;
+    static RingBufferN<_SS_MAX_RX_BUFF> _receive_buffer;
     static SoftwareSerial *active_object;
 
     // private methods
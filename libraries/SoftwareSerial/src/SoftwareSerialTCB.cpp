@@ -0,0 +1,312 @@
+/* SoftwareSerialTCB.cpp - software serial ports on a free-running type B timer, see SoftwareSerialTCB.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ */
+
+#include "SoftwareSerialTCB.h"
+
+#define SS_TCB_IDLE       (0xFF)
+
+SoftwareSerialTCB *SoftwareSerialTCB::_first = NULL;
+TCB_t *SoftwareSerialTCB::_txTimer = NULL;
+SoftwareSerialTCB * volatile SoftwareSerialTCB::_txOwner = NULL;
+uint16_t SoftwareSerialTCB::_txFrame;
+uint8_t SoftwareSerialTCB::_txBits;
+#if defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+  TCB_t *SoftwareSerialTCB::_timer = &TCB1;
+#elif !defined(MILLIS_USE_TIMERB0)
+  TCB_t *SoftwareSerialTCB::_timer = &TCB0;
+#else
+  TCB_t *SoftwareSerialTCB::_timer = NULL;   // only TCB0, and millis has it - setTimer() can't help either.
+#endif
+
+#if defined(MILLIS_USE_TIMERNONE)
+  #define SS_TCB_MILLIS() (0)
+#else
+  #define SS_TCB_MILLIS() ((uint16_t)millis())
+#endif
+
+SoftwareSerialTCB::SoftwareSerialTCB(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic) :
+  _receivePin(receivePin),
+  _bitTicks(0),
+  _bits(SS_TCB_IDLE),
+  _inverse_logic(inverse_logic ? 1 : 0),
+  _listening(false),
+  _buffer_overflow(false),
+  _next(NULL) {
+  // Set the level before making it an output, so there's no glitch - see SoftwareSerial::setTX()
+  digitalWrite(transmitPin, inverse_logic ? LOW : HIGH);
+  pinMode(transmitPin, OUTPUT);
+  _transmitBitMask = digitalPinToBitMask(transmitPin);
+  _transmitPort = digitalPinToPortStruct(transmitPin);
+  pinMode(receivePin, inverse_logic ? INPUT : INPUT_PULLUP);
+  _receiveBitMask = digitalPinToBitMask(receivePin);
+  _receivePortRegister = portInputRegister(digitalPinToPort(receivePin));
+}
+
+SoftwareSerialTCB::~SoftwareSerialTCB() {
+  end();
+}
+
+void SoftwareSerialTCB::begin(long speed) {
+  _bitTicks = 0;
+  if (!_timer || speed <= 0) {
+    return;
+  }
+  uint32_t ticks = (F_CPU / 2) / speed;
+  // A frame is 10 bits; millis() tells frames apart across timer wraps, so it must be over, by millis(), before
+  // the timer wraps around: that's 1 ms of millis() granularity, plus 1 ms rounding, after the frame itself.
+  uint16_t frameMs = (10000UL + speed - 1) / speed + 2;
+  if (ticks < 16 || (uint32_t)(frameMs + 1) * (F_CPU / 2000) > 0xFFFF) {
+    return;
+  }
+  if (!(_timer->CTRLA & TCB_ENABLE_bm)) {
+    _timer->CTRLB = TCB_CNTMODE_INT_gc;   // periodic interrupt mode, with the interrupt off: just counting
+    _timer->CCMP  = 0xFFFF;
+    _timer->CTRLA = TCB_CLKSEL_DIV2_gc | TCB_ENABLE_bm;
+  }
+  _bitTicks = ticks;
+  _frameMs = frameMs;
+  listen();
+}
+
+void SoftwareSerialTCB::end() {
+  flush();
+  stopListening();
+}
+
+bool SoftwareSerialTCB::listen() {
+  if (_listening || !_bitTicks) {
+    return false;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _rx.clear();
+  _buffer_overflow = false;
+  _bits = SS_TCB_IDLE;
+  _level = rxLevel();
+  _next = _first;
+  _first = this;
+  _listening = true;
+  SREG = oldSREG;
+  attachInterrupt(_receivePin, SoftwareSerialTCB::handle_interrupt, CHANGE);
+  return true;
+}
+
+bool SoftwareSerialTCB::stopListening() {
+  if (!_listening) {
+    return false;
+  }
+  detachInterrupt(_receivePin);
+  uint8_t oldSREG = SREG;
+  cli();
+  SoftwareSerialTCB **p = &_first;
+  while (*p != this) {
+    p = &((*p)->_next);
+  }
+  *p = _next;
+  _listening = false;
+  SREG = oldSREG;
+  return true;
+}
+
+/* The 16-bit timer registers share one TEMP register, so outside the interrupt a read must not be interrupted by the
+ * pin interrupt reading it too. */
+uint16_t SoftwareSerialTCB::count() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t cnt = _timer->CNT;
+  SREG = oldSREG;
+  return cnt;
+}
+
+/* static */
+void SoftwareSerialTCB::handle_interrupt() {
+  // One handler for every pin; the ports whose pin didn't change ignore it.
+  uint16_t now = _timer->CNT;
+  for (SoftwareSerialTCB *p = _first; p; p = p->_next) {
+    p->edge(now);
+  }
+}
+
+bool SoftwareSerialTCB::frameOver() {
+  return (uint16_t)(SS_TCB_MILLIS() - _startMs) > _frameMs;
+}
+
+/* Decide every bit whose middle is less than elapsed ticks after the start bit, at the level the line has been at
+ * since the last edge. The middle of the stop bit ends the frame. */
+void SoftwareSerialTCB::decode(uint16_t elapsed) {
+  while (elapsed >= _center) {
+    if (_bits == 9) {
+      if (!_rx.push(_data)) {
+        _buffer_overflow = true;
+      }
+      _bits = SS_TCB_IDLE;
+      return;
+    }
+    if (_bits) {
+      _data >>= 1;
+      if (_level) {
+        _data |= 0x80;
+      }
+    }
+    _bits++;
+    _center += _bitTicks;
+  }
+}
+
+void SoftwareSerialTCB::edge(uint16_t now) {
+  uint8_t level = rxLevel();
+  if (level == _level) {
+    return;
+  }
+  if (_bits != SS_TCB_IDLE) {
+    decode(frameOver() ? 0xFFFF : (uint16_t)(now - _start));
+  }
+  _level = level;
+  if (_bits == SS_TCB_IDLE && !level) {
+    _start = now;
+    _startMs = SS_TCB_MILLIS();
+    _center = _bitTicks >> 1;
+    _bits = 0;
+    _data = 0;
+  }
+}
+
+/* Finish a frame that ended in 1 bits, so there's been no edge since: if the line is still where the last edge left
+ * it, nothing has happened that the pin interrupt hasn't seen yet. */
+void SoftwareSerialTCB::poll() {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_bits != SS_TCB_IDLE) {
+    uint16_t now = _timer->CNT;
+    if (rxLevel() == _level) {
+      decode(frameOver() ? 0xFFFF : (uint16_t)(now - _start));
+    }
+  }
+  SREG = oldSREG;
+}
+
+int SoftwareSerialTCB::available() {
+  if (!_listening) {
+    return 0;
+  }
+  poll();
+  return _rx.available();
+}
+
+int SoftwareSerialTCB::read() {
+  uint8_t d;
+  if (!_listening) {
+    return -1;
+  }
+  poll();
+  if (!_rx.pop(d)) {
+    return -1;
+  }
+  return d;
+}
+
+int SoftwareSerialTCB::peek() {
+  uint8_t d;
+  if (!_listening) {
+    return -1;
+  }
+  poll();
+  if (!_rx.peek(d)) {
+    return -1;
+  }
+  return d;
+}
+
+/* The TX timer's interrupt, once per bit time: the next bit of the frame, or when the stop bit has lasted a whole bit,
+ * the start bit of the next byte from the buffer - or if there isn't one, stop the timer. */
+void SoftwareSerialTCB::handle_tx() {
+  _txTimer->INTFLAGS = TCB_CAPT_bm;
+  _txOwner->txBit();
+}
+
+void SoftwareSerialTCB::txBit() {
+  if (!_txBits) {
+    uint8_t b;
+    if (!_tx.pop(b)) {
+      _txTimer->CTRLA = 0;
+      _txTimer->INTCTRL = 0;
+      _txOwner = NULL;
+      return;
+    }
+    _txFrame = ((uint16_t)b << 1) | 0x200;
+    if (_inverse_logic) {
+      _txFrame ^= 0x3FF;
+    }
+    _txBits = 10;
+  }
+  if (_txFrame & 1) {
+    _transmitPort->OUTSET = _transmitBitMask;
+  } else {
+    _transmitPort->OUTCLR = _transmitBitMask;
+  }
+  _txFrame >>= 1;
+  _txBits--;
+}
+
+int SoftwareSerialTCB::availableForWrite() {
+  return (_txTimer && _txTimer != _timer) ? _tx.availableForStore() : 0;
+}
+
+void SoftwareSerialTCB::flush() {
+  while (_txOwner == this);
+}
+
+size_t SoftwareSerialTCB::write(uint8_t b) {
+  if (!_bitTicks) {
+    setWriteError();
+    return 0;
+  }
+  if (_txTimer && _txTimer != _timer) {
+    while (!_tx.push(b));                 // buffer full: the interrupt is emptying it
+    while (1) {
+      uint8_t oldSREG = SREG;
+      cli();
+      if (_txOwner == this) {             // it'll get to this byte
+        SREG = oldSREG;
+        return 1;
+      }
+      if (!_txOwner) {                    // start the timer; its first interrupt, a bit time from now, sends it
+        _txOwner = this;
+        _txBits = 0;
+        _txTimer->CTRLA = 0;
+        _txTimer->CTRLB = TCB_CNTMODE_INT_gc;
+        _txTimer->CCMP = _bitTicks - 1;
+        _txTimer->CNT = 0;
+        _txTimer->INTFLAGS = TCB_CAPT_bm;
+        _txTimer->INTCTRL = TCB_CAPT_bm;
+        _txTimer->CTRLA = TCB_CLKSEL_DIV2_gc | TCB_ENABLE_bm;
+        SREG = oldSREG;
+        return 1;
+      }
+      SREG = oldSREG;                     // another port has the timer - wait for it to finish
+    }
+  }
+  PORT_t *port = _transmitPort;
+  uint8_t mask = _transmitBitMask;
+  uint16_t ticks = _bitTicks;
+  // start bit, 8 data bits, stop bit, each put out when the timer reaches its time - with the level for a 1 in
+  // the low bit of frame, which shifts out LSB first.
+  uint16_t frame = ((uint16_t)b << 1) | 0x200;
+  if (_inverse_logic) {
+    frame ^= 0x3FF;
+  }
+  uint16_t t = count();
+  for (uint8_t i = 10; i; i--) {
+    if (frame & 1) {
+      port->OUTSET = mask;
+    } else {
+      port->OUTCLR = mask;
+    }
+    frame >>= 1;
+    t += ticks;
+    while ((int16_t)(count() - t) < 0);
+  }
+  return 1;
+}
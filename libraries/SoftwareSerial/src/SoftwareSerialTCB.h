@@ -0,0 +1,129 @@
+/* SoftwareSerialTCB.h - software serial ports that don't turn interrupts off, on a free-running type B timer
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * SoftwareSerial receives a byte by waiting in the pin interrupt, with interrupts disabled, until the whole byte has
+ * arrived - about 1 ms at 9600 baud - so only one port can listen at a time, and millis, Serial and everything else
+ * stall for the duration. This one has a TCB counting freely at F_CPU/2, and the pin interrupt (on both edges) only
+ * notes the time of each edge and works out which bits the line was at the old level for. So every port can listen
+ * at once, each with its own buffer, and the pin interrupt takes a few microseconds. A byte that ends in 1 bits has
+ * no edge after them; it's finished by the next start bit, or by available(), read() or peek().
+ * Transmitting times the bits off the same timer with interrupts on, so an interrupt that is running at a bit
+ * boundary delays that edge, but not the ones after it.
+ *
+ * The timer is TCB1 if the part has one and millis isn't using it, otherwise TCB0 - call setTimer() before the first
+ * begin() to pick another. begin() starts it counting if it isn't running already, and after that it's only read,
+ * so it can't be shared with tone(), Servo or anything else that uses it, but reading it yourself is fine.
+ *
+ * By default write() waits for the character to go out (with interrupts on). With a second TCB for transmitting,
+ * write() puts the byte in a buffer of _SS_MAX_TX_BUFF bytes and returns, and that timer's interrupt puts out one bit
+ * at a time in the background. Only one port transmits at a time; a write() to another one waits until it's done.
+ * Library code can't define the interrupt without it being linked into every sketch that uses this library, so the
+ * sketch does it, once, outside any function:
+ *   SOFTWARESERIALTCB_TX_TIMER(0);     // TCB0 transmits for all the SoftwareSerialTCB ports
+ *
+ * Edge timing is only as good as the interrupt latency, so this is good to around 38400 baud at 20 MHz, and 19200
+ * at 8-10 MHz. Below about 4800 baud at 20 MHz (2400 baud at 16 MHz and below) a byte lasts longer than the timer
+ * can count without millis to tell wraps apart, and begin() fails.
+ */
+
+#ifndef SoftwareSerialTCB_h
+#define SoftwareSerialTCB_h
+
+#include <Arduino.h>
+#include <Stream.h>
+#include <api/RingBuffer.h>
+#include "SoftwareSerial.h"     // for _SS_MAX_RX_BUFF
+
+#ifndef _SS_MAX_TX_BUFF
+  #define _SS_MAX_TX_BUFF 16
+#endif
+
+class SoftwareSerialTCB : public Stream {
+  public:
+    SoftwareSerialTCB(uint8_t receivePin, uint8_t transmitPin, bool inverse_logic = false);
+    ~SoftwareSerialTCB();
+    static void setTimer(TCB_t *timer) {
+      _timer = timer;
+    }
+    // Through SOFTWARESERIALTCB_TX_TIMER(), which also defines the interrupt this needs.
+    static uint8_t setTxTimer(TCB_t *timer) {
+      _txTimer = timer;
+      return 1;
+    }
+    void begin(long speed);
+    void end();
+    bool listen();                       // Any number can listen at once; returns false if it already was
+    bool stopListening();
+    bool isListening() {
+      return _listening;
+    }
+    bool overflow() {
+      bool ret = _buffer_overflow;
+      _buffer_overflow = false;
+      return ret;
+    }
+
+    virtual size_t write(uint8_t byte);
+    virtual int read();
+    virtual int peek();
+    virtual int available();
+    virtual int availableForWrite();
+    virtual void flush();               // waits until everything written has gone out
+    operator bool() {
+      return true;
+    }
+    using Print::write;
+
+    // public only for the pin interrupt
+    static void handle_interrupt();
+    static void handle_tx();
+
+  private:
+    uint8_t rxLevel() {
+      return (!!(*_receivePortRegister & _receiveBitMask)) ^ _inverse_logic;
+    }
+    void edge(uint16_t now);
+    void decode(uint16_t elapsed);
+    bool frameOver();
+    void poll();
+    void txBit();
+    static uint16_t count();
+
+    uint8_t _receivePin;
+    uint8_t _receiveBitMask;
+    volatile uint8_t *_receivePortRegister;
+    uint8_t _transmitBitMask;
+    PORT_t *_transmitPort;
+
+    uint16_t _bitTicks;                 // bit time in timer ticks, 0 until begin() succeeds
+    uint16_t _start;                    // timer count at the start bit's falling edge
+    uint16_t _center;                   // ticks from _start to the middle of the next bit to decide
+    uint8_t  _bits;                     // bits of the frame decided so far (0 is the start bit), or SS_TCB_IDLE
+    uint8_t  _data;
+    uint8_t  _level;                    // line level before the edge being handled, 1 = idle
+    uint8_t  _frameMs;                  // a frame is certainly over this many millis() after the start bit
+    uint16_t _startMs;
+    uint8_t  _inverse_logic;
+    bool     _listening;
+    volatile bool _buffer_overflow;     // set by the interrupt, so not a bitfield sharing a byte with the others
+
+    SoftwareSerialTCB *_next;           // list of listening ports, for the pin interrupt
+    RingBufferN<_SS_MAX_RX_BUFF> _rx;
+    RingBufferN<_SS_MAX_TX_BUFF> _tx;
+
+    static SoftwareSerialTCB *_first;
+    static TCB_t *_timer;
+    static TCB_t *_txTimer;
+    static SoftwareSerialTCB * volatile _txOwner;   // the port the TX timer is sending for, if any
+    static uint16_t _txFrame;                        // bits still to go out, LSB next
+    static uint8_t _txBits;
+};
+
+#define SOFTWARESERIALTCB_TX_TIMER(n)                                                        \
+  ISR(TCB##n##_INT_vect) {                                                                  \
+    SoftwareSerialTCB::handle_tx();                                                         \
+  }                                                                                         \
+  static const uint8_t _sstcb_tx_timer = SoftwareSerialTCB::setTxTimer(&TCB##n)
+
+#endif
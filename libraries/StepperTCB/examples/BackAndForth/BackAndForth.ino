@@ -0,0 +1,23 @@
+/* BackAndForth - two turns one way and two turns back, over and over, on a step/direction driver
+ * (A4988, DRV8825, TMC2208 and so on) with STEP on PA4 and DIR on PA5, at 1/16 microstepping on a
+ * 200 step/turn motor. The moves run in the background: loop() only has to start the next one.
+ */
+#include <StepperTCB.h>
+
+StepperTCB stepper(TCB1);     // TCB0 on parts that only have the one - and millis not on it
+
+void setup() {
+  Serial.begin(115200);
+  if (!stepper.begin(PIN_PA4, PIN_PA5)) {
+    Serial.println("TCB1 is in use");
+  }
+  stepper.setMaxSpeed(16000);       // steps per second - 5 turns per second
+  stepper.setAcceleration(32000);   // steps per second per second - up to speed in half a second
+}
+
+void loop() {
+  if (!stepper.running()) {
+    delay(500);
+    stepper.moveTo(stepper.position() ? 0 : 6400);
+  }
+}
@@ -0,0 +1,272 @@
+/* StepperTCB.cpp - see StepperTCB.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The TCB ISRs are weak, the same as InputCapture's, so if something else (millis, tone, Servo) has claimed that
+ * TCB, theirs wins - begin() turns down a timer that's already running, which covers tone() while it's playing and
+ * Servo once something's attached, but not one that gets started later.
+ */
+
+#include "StepperTCB.h"
+
+#if defined(TCB1)
+  static StepperTCB *_stepper_owner[2];
+#else
+  static StepperTCB *_stepper_owner[1];
+#endif
+
+#define STEPPER_PULSE_TICKS ((uint16_t)(STEPPER_TICK_HZ / 1000000UL * STEPPER_PULSE_US))
+
+bool StepperTCB::begin(uint8_t stepPin, uint8_t dirPin) {
+  uint8_t tcbnum = 0;
+  if (_timer != &TCB0) {
+    #if defined(TCB1)
+      if (_timer != &TCB1) {
+        return false;
+      }
+      tcbnum = 1;
+    #else
+      return false;
+    #endif
+  }
+  #if defined(MILLIS_USE_TIMERB0)
+    if (tcbnum == 0) {
+      return false;
+    }
+  #elif defined(MILLIS_USE_TIMERB1)
+    if (tcbnum == 1) {
+      return false;
+    }
+  #endif
+  if (stepPin >= NUM_TOTAL_PINS || (dirPin != NOT_A_PIN && dirPin >= NUM_TOTAL_PINS)) {
+    return false;
+  }
+  if (_stepper_owner[tcbnum] != this && (_timer->CTRLA & TCB_ENABLE_bm)) {
+    return false;   // somebody else's
+  }
+  end();
+  _step_port = digitalPinToPortStruct(stepPin);
+  _step_mask = digitalPinToBitMask(stepPin);
+  _dir_port  = NULL;
+  if (dirPin != NOT_A_PIN) {
+    _dir_port  = digitalPinToPortStruct(dirPin);
+    _dir_mask  = digitalPinToBitMask(dirPin);
+    digitalWrite(dirPin, LOW);
+    pinMode(dirPin, OUTPUT);
+  }
+  digitalWrite(stepPin, LOW);
+  pinMode(stepPin, OUTPUT);
+  if (!_set_cmin) {
+    setMaxSpeed(1000);
+  }
+  if (!_set_c0) {
+    setAcceleration(1000);
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _stepper_owner[tcbnum] = this;
+  _togo                  = 0;
+  _timer->CTRLA          = 0;
+  _timer->CTRLB          = TCB_CNTMODE_INT_gc;
+  _timer->EVCTRL         = 0;
+  _timer->INTFLAGS       = TCB_CAPT_bm;
+  _timer->INTCTRL        = TCB_CAPT_bm;
+  SREG = oldSREG;
+  return true;
+}
+
+void StepperTCB::end() {
+  uint8_t tcbnum = (_timer == &TCB0) ? 0 : 1;
+  if (_stepper_owner[tcbnum] != this) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _timer->CTRLA          = 0;
+  _timer->INTCTRL        = 0;
+  _timer->INTFLAGS       = TCB_CAPT_bm;
+  _togo                  = 0;
+  _stepper_owner[tcbnum] = NULL;
+  SREG = oldSREG;
+}
+
+void StepperTCB::setMaxSpeed(float stepsPerSecond) {
+  if (stepsPerSecond < 1) {
+    stepsPerSecond = 1;
+  } else if (stepsPerSecond > STEPPER_MAX_RATE) {
+    stepsPerSecond = STEPPER_MAX_RATE;
+  }
+  _set_cmin = (uint32_t)(256.0 * STEPPER_TICK_HZ / stepsPerSecond);
+}
+
+void StepperTCB::setAcceleration(float stepsPerSecond2) {
+  if (stepsPerSecond2 < 1) {
+    stepsPerSecond2 = 1;
+  }
+  // The first interval, from standing still: sqrt(2 / a) seconds, times 0.676 to make up for the recurrence's error on
+  // the first few steps. At a = 1 and 32 MHz, that's 3.9 * 10^9 - it just fits.
+  _set_c0 = (uint32_t)(0.676 * 256.0 * STEPPER_TICK_HZ * sqrt(2.0 / stepsPerSecond2));
+}
+
+bool StepperTCB::moveTo(int32_t position) {
+  uint8_t tcbnum = (_timer == &TCB0) ? 0 : 1;
+  if (_togo || _stepper_owner[tcbnum] != this) {
+    return false;
+  }
+  int32_t  steps = position - _position;  // the ISR isn't touching it while we aren't moving
+  if (!steps) {
+    return true;
+  }
+  _dir = 1;
+  if (steps < 0) {
+    steps = -steps;
+    _dir  = -1;
+  }
+  if (_dir_port) {
+    if (_dir > 0) {
+      _dir_port->OUTSET = _dir_mask;
+    } else {
+      _dir_port->OUTCLR = _dir_mask;
+    }
+  }
+  _cmin      = _set_cmin;
+  _c0        = (_set_c0 < _cmin) ? _cmin : _set_c0;    // slow enough to start at full speed
+  _ramp_step = 0;
+  _c         = _c0;
+  _rest      = 0;
+  _togo      = steps;
+  _timer->CNT = 0;
+  _load(_c0 >> 8);                      // the first step is one first interval from now - time for the direction pin
+  if (steps > 1) {
+    _ramp(steps - 1);
+  }
+  _timer->INTFLAGS = TCB_CAPT_bm;
+  _timer->CTRLA    = TCB_CLKSEL_DIV2_gc | TCB_ENABLE_bm;
+  return true;
+}
+
+void StepperTCB::stop() {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_togo > _ramp_step + 1) {
+    _togo = _ramp_step + 1;             // just enough to get back down the ramp
+  }
+  SREG = oldSREG;
+}
+
+void StepperTCB::halt() {
+  uint8_t oldSREG = SREG;
+  cli();
+  _timer->CTRLA = 0;
+  _togo         = 0;
+  SREG = oldSREG;
+}
+
+int32_t StepperTCB::position() {
+  uint8_t oldSREG = SREG;
+  cli();
+  int32_t pos = _position;
+  SREG = oldSREG;
+  return pos;
+}
+
+void StepperTCB::setPosition(int32_t position) {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (!_togo) {
+    _position = position;
+  }
+  SREG = oldSREG;
+}
+
+int32_t StepperTCB::target() {
+  uint8_t oldSREG = SREG;
+  cli();
+  int32_t pos = _position + (_dir < 0 ? -(int32_t)_togo : (int32_t)_togo);
+  SREG = oldSREG;
+  return pos;
+}
+
+uint32_t StepperTCB::distanceToGo() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t togo = _togo;
+  SREG = oldSREG;
+  return togo;
+}
+
+/* An interval longer than CCMP can hold is done in pieces of 32768 ticks, the last one between 32768 and 65535, with
+ * no step at the end of any but the last. */
+void StepperTCB::_load(uint32_t ticks) {
+  if (ticks > 0xFFFF) {
+    _rest         = ticks - 0x8000;
+    _timer->CCMP  = 0x7FFF;
+  } else {
+    _rest         = 0;
+    _timer->CCMP  = ticks - 1;          // the period is CCMP + 1
+  }
+}
+
+/* Work out the interval after the next step, when there will be left steps still to do after it. Going up the ramp,
+ * each interval is c - 2c / (4n + 1); coming down, each is the one before it on the way up, c + 2c / (4n - 1). */
+void StepperTCB::_ramp(uint32_t left) {
+  uint32_t c = _c;
+  uint32_t n = _ramp_step;
+  if (left <= n) {
+    n--;
+    c = n ? c + (c / (4 * n + 3)) * 2 : _c0;
+  } else if (c > _cmin) {
+    n++;
+    c -= (c / (4 * n + 1)) * 2;
+    if (c < _cmin) {
+      c = _cmin;
+    }
+  }
+  _c         = c;
+  _ramp_step = n;
+}
+
+void StepperTCB::_step() {
+  _timer->INTFLAGS = TCB_CAPT_bm;
+  uint32_t rest = _rest;
+  if (rest) {                           // part way through a long interval
+    _load(rest);
+    return;
+  }
+  _step_port->OUTSET = _step_mask;
+  uint32_t togo = _togo - 1;
+  _togo         = togo;
+  _position    += _dir;
+  if (togo) {
+    _load(_c >> 8);                     // CNT has only just gone back to 0, and the interval is at least 200 ticks -
+    if (_timer->CNT >= _timer->CCMP) {  // unless another ISR held us up that long; then step right away, not after
+      _timer->CCMP = _timer->CNT + 8;   // CNT has gone all the way round.
+    }
+    if (togo > 1) {
+      _ramp(togo - 1);
+    }
+  }
+  while (_timer->CNT < STEPPER_PULSE_TICKS); // counted from the match, whatever the ISR took to get here
+  _step_port->OUTCLR = _step_mask;
+  if (!togo) {
+    _timer->CTRLA = 0;
+  }
+}
+
+ISR(TCB0_INT_vect, __attribute__((weak))) {
+  if (_stepper_owner[0]) {
+    _stepper_owner[0]->_step();
+  } else {
+    TCB0.INTFLAGS = TCB_CAPT_bm;
+  }
+}
+
+#if defined(TCB1)
+  ISR(TCB1_INT_vect, __attribute__((weak))) {
+    if (_stepper_owner[1]) {
+      _stepper_owner[1]->_step();
+    } else {
+      TCB1.INTFLAGS = TCB_CAPT_bm;
+    }
+  }
+#endif
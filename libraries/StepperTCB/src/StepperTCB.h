@@ -0,0 +1,68 @@
+/* StepperTCB.h - step/direction stepper driver output, with the step timing done by a type B timer
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The TCB runs in periodic interrupt mode, and each compare match is a step: the ISR raises the step pin and loads
+ * the next interval into CCMP, which was worked out during the previous one, so the timing of the steps is the
+ * timer's, not the ISR's. The intervals follow a trapezoidal (or, for short moves, triangular) speed profile, from
+ * D. Austin's recurrence for constant acceleration, in 24.8 fixed point: one division per step while speeding up or
+ * slowing down, none at constant speed. See README.md.
+ */
+#ifndef STEPPERTCB_H
+#define STEPPERTCB_H
+
+#include <Arduino.h>
+
+#if !defined(STEPPER_PULSE_US)
+  #define STEPPER_PULSE_US    (2)   // step pulse width - 2 us is enough for the A4988, DRV8825 and TMC22xx
+#endif
+
+#define STEPPER_TICK_HZ       (F_CPU / 2)             // the TCB runs from CLK_PER/2
+#define STEPPER_MIN_TICKS     (200)                   // 400 system clocks between steps at the most - 50 kHz at 20 MHz
+#define STEPPER_MAX_RATE      (STEPPER_TICK_HZ / STEPPER_MIN_TICKS)
+
+class StepperTCB {
+  public:
+    StepperTCB(TCB_t &timer) : _timer(&timer) {}
+    /* False if the timer is millis's, or is running for something else (tone(), Servo, InputCapture...) */
+    bool     begin(uint8_t stepPin, uint8_t dirPin = NOT_A_PIN);
+    void     end();
+    void     setMaxSpeed(float stepsPerSecond);           // 1 to STEPPER_MAX_RATE
+    void     setAcceleration(float stepsPerSecond2);      // 1 and up
+    /* Start moving; false if a move is still in progress, or begin() hasn't been called. The speed and acceleration
+     * that are set at the time are used for the whole move. */
+    bool     moveTo(int32_t position);
+    bool     move(int32_t steps) {
+      return moveTo(target() + steps);
+    }
+    void     stop();                     // slow down and stop as soon as the acceleration allows
+    void     halt();                     // stop on the spot, without slowing down
+    bool     running() {
+      return _togo;
+    }
+    int32_t  position();
+    void     setPosition(int32_t position); // ignored while moving
+    int32_t  target();
+    uint32_t distanceToGo();
+    void     _step();                    // called from the ISR
+  private:
+    void     _load(uint32_t ticks);
+    void     _ramp(uint32_t left);
+    TCB_t             *_timer;
+    PORT_t            *_step_port;
+    PORT_t            *_dir_port;
+    uint8_t            _step_mask;
+    uint8_t            _dir_mask;
+    int8_t             _dir;
+    uint32_t           _set_c0   = 0;    // the first interval and the shortest one, from the settings, ticks << 8
+    uint32_t           _set_cmin = 0;
+    uint32_t           _c0;              // the same for the move in progress
+    uint32_t           _cmin;
+    uint32_t           _c;               // the interval for the step after the next one, ticks << 8
+    uint32_t           _ramp_step;       // how far up the ramp we are, in steps
+    uint32_t           _rest;            // what's left of an interval too long for CCMP
+    volatile uint32_t  _togo;            // steps still to do
+    volatile int32_t   _position;
+};
+
+#endif
@@ -0,0 +1,33 @@
+/* SuperviseTasks - two tasks checked by the Supervisor, one of which stops checking in when PA1 is grounded.
+ * The watchdog then resets the chip, and after the reset it prints which task stalled.
+ */
+#include <Supervisor.h>
+
+uint8_t blinkTask;
+uint8_t buttonTask;
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(LED_BUILTIN, OUTPUT);
+  pinMode(PIN_PA1, INPUT_PULLUP);
+  if (Supervisor.stalledTask() != SUPERVISOR_NO_TASK) {
+    Serial.print("Reset by the watchdog - task ");
+    Serial.print(Supervisor.stalledTask());
+    Serial.println(" stalled");
+  }
+  blinkTask  = Supervisor.add(600);     // must check in at least every 600 ms
+  buttonTask = Supervisor.add(2000);
+  Supervisor.begin();                   // watchdog about 1 s after a task misses its deadline
+}
+
+void loop() {
+  static uint32_t lastBlink;
+  if (millis() - lastBlink > 250) {
+    lastBlink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+    Supervisor.checkIn(blinkTask);
+  }
+  if (digitalRead(PIN_PA1)) {            // ground PA1 to "hang" this task
+    Supervisor.checkIn(buttonTask);
+  }
+}
@@ -0,0 +1,86 @@
+/* Supervisor.cpp - see Supervisor.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details */
+
+#include "Supervisor.h"
+
+SupervisorClass Supervisor;
+
+/* .noinit isn't cleared by the startup code, so this survives any reset but power-on and brownout - which is when
+ * the check byte, which must be its complement, is what keeps garbage from being believed. */
+static uint8_t _saved_task  __attribute__((section(".noinit")));
+static uint8_t _saved_check __attribute__((section(".noinit")));
+
+bool SupervisorClass::begin(uint8_t wdtPeriod) {
+  // GPIOR0 has the reset flags, saved there by the core's startup code or Optiboot.
+  if ((GPIOR0 & RSTCTRL_WDRF_bm) && (uint8_t)~_saved_task == _saved_check) {
+    _stalled = _saved_task;
+  }
+  _saved_task  = SUPERVISOR_NO_TASK;
+  _saved_check = 0;
+  if (RTC.PITCTRLA & RTC_PITEN_bm) {
+    return false;   // somebody else has the PIT
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < _count; i++) {
+    _left[i] = _deadline[i];
+  }
+  _failed = false;
+  SREG = oldSREG;
+  // The PIT runs from the RTC's clock, which is 32.768 kHz unless it has been set to the 1.024 kHz one.
+  uint8_t period = (RTC.CLKSEL == RTC_CLKSEL_INT1K_gc) ? RTC_PERIOD_CYC128_gc : RTC_PERIOD_CYC4096_gc;
+  #if defined(CORE_RESET_INFO)
+    if (!CPUINT.LVL1VEC) {            // so that a hang in an ISR is caught too, unless something else is level 1
+      CPUINT.LVL1VEC = RTC_PIT_vect_num;
+    }
+  #endif
+  while (RTC.PITSTATUS);
+  RTC.PITINTCTRL = RTC_PI_bm;
+  RTC.PITCTRLA   = period | RTC_PITEN_bm;
+  __asm__ __volatile__ ("wdr");
+  if (!(WDT.STATUS & WDT_LOCK_bm)) {  // if the fuses have locked it on, it has whatever period they set
+    _PROTECTED_WRITE(WDT.CTRLA, wdtPeriod);
+  }
+  return true;
+}
+
+uint8_t SupervisorClass::add(uint16_t deadlineMs) {
+  if (_count >= SUPERVISOR_MAX_TASKS || !deadlineMs) {
+    return SUPERVISOR_NO_TASK;
+  }
+  uint16_t ticks = (deadlineMs + SUPERVISOR_TICK_MS - 1) / SUPERVISOR_TICK_MS + 1;
+  uint8_t task = _count;
+  _deadline[task] = ticks > 255 ? 255 : ticks;
+  _left[task]     = _deadline[task];
+  _count          = task + 1;   // last, so the ISR never looks at it before it's filled in
+  return task;
+}
+
+void SupervisorClass::tick() {
+  if (_failed) {
+    return;       // waiting for the watchdog
+  }
+  for (uint8_t i = 0; i < _count; i++) {
+    if (!_deadline[i]) {
+      continue;
+    }
+    uint8_t left = _left[i];
+    if (!left) {
+      #if defined(CORE_RESET_INFO)
+        saveResetInfo(RESET_INFO_WATCHDOG);   // where the code was that this interrupted, for getResetInfo()
+      #endif
+      _saved_task  = i;
+      _saved_check = ~i;
+      _failed      = true;
+      return;
+    }
+    _left[i] = left - 1;
+  }
+  __asm__ __volatile__ ("wdr");
+}
+
+RESET_INFO_ISR(RTC_PIT_vect) {
+  RTC.PITINTFLAGS = RTC_PI_bm;
+  Supervisor.tick();
+}
@@ -0,0 +1,55 @@
+/* Supervisor.h - task liveness checks in the RTC PIT interrupt, feeding the watchdog only while every task is healthy
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Each part of the firmware that should keep running is added as a task with a deadline, and calls checkIn() at least
+ * that often. The PIT interrupt, 8 times a second, counts each task's time down; while none has run out, it executes
+ * WDR. When one does, its number is saved in RAM that isn't cleared at startup, and the watchdog is no longer fed, so
+ * it resets the chip. After that reset, stalledTask() says which task it was. See README.md.
+ */
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <Arduino.h>
+
+#ifndef SUPERVISOR_MAX_TASKS
+  #define SUPERVISOR_MAX_TASKS  (8)
+#endif
+#define SUPERVISOR_TICK_MS      (125)
+#define SUPERVISOR_NO_TASK      (0xFF)
+
+class SupervisorClass {
+  public:
+    // Start the PIT and the watchdog. wdtPeriod is a WDT_PERIOD_*_gc; it must be longer than a tick (125 ms).
+    bool begin(uint8_t wdtPeriod = WDT_PERIOD_1KCLK_gc);
+    // Returns the task number, or SUPERVISOR_NO_TASK if there are already SUPERVISOR_MAX_TASKS. At most 31 seconds.
+    uint8_t add(uint16_t deadlineMs);
+    void checkIn(uint8_t task) {
+      if (task < _count) {
+        _left[task] = _deadline[task];  // one byte, so the ISR can't see half of it
+      }
+    }
+    void remove(uint8_t task) {
+      if (task < _count) {
+        _deadline[task] = 0;            // 0 is never checked
+      }
+    }
+    // The task that ran out of time before the last reset, if that was a watchdog reset; otherwise SUPERVISOR_NO_TASK.
+    uint8_t stalledTask() {
+      return _stalled;
+    }
+
+    // public only for the PIT interrupt
+    void tick();
+
+  private:
+    uint8_t          _deadline[SUPERVISOR_MAX_TASKS];   // in ticks, rounded up, plus one for the tick in progress
+    volatile uint8_t _left[SUPERVISOR_MAX_TASKS];
+    uint8_t          _count;
+    uint8_t          _stalled = SUPERVISOR_NO_TASK;
+    volatile bool    _failed;
+};
+
+extern SupervisorClass Supervisor;
+
+#endif
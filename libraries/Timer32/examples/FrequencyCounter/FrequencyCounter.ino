@@ -0,0 +1,27 @@
+/* FrequencyCounter - print the frequency of the signal on PIN_PA2, from well under 0.1 Hz up, at full clock resolution.
+ * Every period is measured by the hardware, 32 bits wide, so there's no overflow counting, and a 10 second period
+ * is measured to the same 50 ns (at 20 MHz) as a 10 us one.
+ */
+#include <Timer32.h>
+
+void setup() {
+  Serial.begin(115200);
+  if (!Timer32.begin(PIN_PA2, TIMER32_PERIOD | TIMER32_FILTER)) {
+    Serial.println("No event channel for the pin");
+  }
+}
+
+void loop() {
+  static uint32_t lastPrint;
+  uint32_t ticks = 0;
+  while (Timer32.available()) {
+    ticks = Timer32.read();       // keep only the newest
+  }
+  if (ticks && millis() - lastPrint >= 500) {
+    lastPrint = millis();
+    Serial.print(Timer32.toHertz(ticks), 4);
+    Serial.print(" Hz, period ");
+    Serial.print(Timer32.toMicros(ticks));
+    Serial.println(" us");
+  }
+}
@@ -0,0 +1,25 @@
+/* LongInterval - a periodic interrupt every 5 seconds, to the clock cycle, from the cascaded TCBs.
+ * A single TCB at 20 MHz can't count past 3.3 ms, and TCA0 only reaches about 3.4 s with its largest prescaler.
+ */
+#include <Timer32.h>
+
+volatile uint8_t ticked;
+
+void everyFiveSeconds() {
+  ticked = 1;
+}
+
+void setup() {
+  Serial.begin(115200);
+  Timer32.beginPeriodic(5 * F_CPU, everyFiveSeconds);   // in system clocks
+  Serial.print("Period is ");
+  Serial.print(Timer32.period());
+  Serial.println(" clocks");
+}
+
+void loop() {
+  if (ticked) {
+    ticked = 0;
+    Serial.println(millis());
+  }
+}
@@ -0,0 +1,240 @@
+/* Timer32.cpp - see Timer32.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The TCB ISRs are weak, the same as InputCapture's, so if tone() or Servo has one of the timers, theirs wins.
+ */
+
+#include "Timer32.h"
+
+Timer32Class Timer32;
+
+bool Timer32Class::begin(uint8_t pin, uint8_t mode, uint8_t clock) {
+  return _begin(Event::assign_generator_pin(pin), mode, clock);
+}
+
+bool Timer32Class::begin(gen::generator_t generator, uint8_t mode, uint8_t clock) {
+  if (generator == (gen::generator_t) -1) {
+    return false;   // what gen_from_peripheral() gives for a generator that isn't in gen::
+  }
+  return _begin(Event::assign_generator(generator), mode, clock);
+}
+
+/* Route generator (one of TCB0's event outputs) to TCB1's count input. */
+bool Timer32Class::_carry(gen::generator_t generator) {
+  Event &carry = Event::assign_generator(generator);
+  if (carry.get_channel_number() == 255) {
+    return false;
+  }
+  carry.set_user(user::tcb1_cnt);
+  carry.start();
+  return true;
+}
+
+bool Timer32Class::_begin(Event &channel, uint8_t mode, uint8_t clock) {
+  if (channel.get_channel_number() == 255) {
+    return false;   // not a pin, or no channel left that can take it.
+  }
+  end();
+  if (!_carry(gen::tcb0_ovf)) {
+    return false;
+  }
+  _clock    = clock & TCB_CLKSEL_gm;
+  uint8_t ctrlb  = mode & TCB_CNTMODE_gm;
+  uint8_t evctrl = (mode & (TCB_EDGE_bm | TCB_FILTER_bm)) | TCB_CAPTEI_bm;
+  uint8_t oldSREG = SREG;
+  cli();
+  _head         = 0;
+  _tail         = 0;
+  _overruns     = 0;
+  _mode         = 1;
+  TCB1.CTRLB    = ctrlb;
+  TCB1.EVCTRL   = evctrl;
+  TCB1.CNT      = 0;
+  TCB1.INTFLAGS = TCB_CAPT_bm;
+  TCB1.INTCTRL  = TCB_CAPT_bm;
+  TCB1.CTRLA    = TCB_CLKSEL_EVENT_gc | TCB_CASCADE_bm | TCB_ENABLE_bm;
+  TCB0.CTRLB    = ctrlb;
+  TCB0.EVCTRL   = evctrl;
+  TCB0.CNT      = 0;
+  TCB0.INTFLAGS = TCB_CAPT_bm;
+  TCB0.CTRLA    = _clock | TCB_ENABLE_bm;  // last, so TCB1 is ready for its first overflow
+  SREG = oldSREG;
+  channel.set_user(user::tcb0_capt);
+  channel.set_user(user::tcb1_capt);
+  channel.start();
+  return true;
+}
+
+bool Timer32Class::beginPeriodic(uint32_t ticks, void (*callback)(), uint8_t clock) {
+  if (ticks < 2 || !callback) {
+    return false;
+  }
+  end();
+  // ticks = low * high, with low (TCB0's period) no more than 65536, and high how many of those TCB1 counts. The
+  // smallest high that works is usually not a factor, so look a little further for one that is before rounding.
+  uint32_t high = (ticks + 65535) >> 16;
+  for (uint8_t i = 0; i < 128 && high > 1; i++) {
+    if (!(ticks % (high + i))) {
+      high += i;
+      break;
+    }
+  }
+  uint32_t low  = (ticks + (high >> 1)) / high;
+  if (high > 1 && !_carry(gen::tcb0_capt)) {  // TCB0's capture event is its compare match in this mode
+    return false;
+  }
+  _clock    = clock & TCB_CLKSEL_gm;
+  _callback = callback;
+  _period   = low * high;
+  uint8_t oldSREG = SREG;
+  cli();
+  _mode         = 2;
+  TCB0.CTRLB    = TCB_CNTMODE_INT_gc;
+  TCB0.CCMP     = low - 1;
+  TCB0.CNT      = 0;
+  TCB0.INTFLAGS = TCB_CAPT_bm;
+  if (high > 1) {
+    TCB1.CTRLB    = TCB_CNTMODE_INT_gc;
+    TCB1.CCMP     = high - 1;
+    TCB1.CNT      = 0;
+    TCB1.INTFLAGS = TCB_CAPT_bm;
+    TCB1.INTCTRL  = TCB_CAPT_bm;
+    TCB1.CTRLA    = TCB_CLKSEL_EVENT_gc | TCB_ENABLE_bm;
+  } else {
+    TCB0.INTCTRL  = TCB_CAPT_bm;            // it fits in TCB0 alone
+  }
+  TCB0.CTRLA    = _clock | TCB_ENABLE_bm;
+  SREG = oldSREG;
+  return true;
+}
+
+void Timer32Class::end() {
+  if (!_mode) {
+    return;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  TCB0.CTRLA    = 0;
+  TCB0.INTCTRL  = 0;
+  TCB0.EVCTRL   = 0;
+  TCB0.INTFLAGS = TCB_CAPT_bm;
+  TCB1.CTRLA    = 0;
+  TCB1.INTCTRL  = 0;
+  TCB1.EVCTRL   = 0;
+  TCB1.INTFLAGS = TCB_CAPT_bm;
+  _mode         = 0;
+  SREG = oldSREG;
+  Event::clear_user(user::tcb0_capt);   // the channels are left running - something else may be using a pin's event.
+  Event::clear_user(user::tcb1_capt);
+  Event::clear_user(user::tcb1_cnt);
+}
+
+uint8_t Timer32Class::available() {
+  return (uint8_t)(_head - _tail) & (TIMER32_BUFFER_SIZE - 1);
+}
+
+uint32_t Timer32Class::peek() {
+  uint8_t tail = _tail;
+  if (tail == _head) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t value = _buffer[tail];
+  SREG = oldSREG;
+  return value;
+}
+
+uint32_t Timer32Class::read() {
+  uint8_t tail = _tail;
+  if (tail == _head) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint32_t value = _buffer[tail];
+  _tail = (tail + 1) & (TIMER32_BUFFER_SIZE - 1);
+  SREG = oldSREG;
+  return value;
+}
+
+void Timer32Class::flush() {
+  _tail = _head;
+}
+
+uint8_t Timer32Class::overruns() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint8_t count = _overruns;
+  _overruns = 0;
+  SREG = oldSREG;
+  return count;
+}
+
+uint32_t Timer32Class::now() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t high = TCB1.CNT;
+  uint16_t low  = TCB0.CNT;
+  if (TCB1.CNT != high) {     // TCB0 overflowed in between - it's just wrapped, so read it again
+    high = TCB1.CNT;
+    low  = TCB0.CNT;
+  }
+  SREG = oldSREG;
+  return ((uint32_t) high << 16) | low;
+}
+
+uint8_t Timer32Class::_shift() {
+  if (_clock == TIMER32_CLK_TCA) {
+    static const uint8_t tca_shift[8] = {0, 1, 2, 3, 4, 6, 8, 10};
+    return tca_shift[(TCA0.SINGLE.CTRLA & TCA_SINGLE_CLKSEL_gm) >> TCA_SINGLE_CLKSEL_gp];
+  }
+  return _clock >> 1;           // 0 for DIV1, 1 for DIV2
+}
+
+uint32_t Timer32Class::toMicros(uint32_t ticks) {
+  const uint32_t mhz = F_CPU / 1000000UL;
+  uint8_t shift = _shift();
+  return ((ticks / mhz) << shift) + (((ticks % mhz) << shift) / mhz);   // never overflows before the answer does
+}
+
+float Timer32Class::toHertz(uint32_t ticks) {
+  if (!ticks) {
+    return 0;
+  }
+  return (float) F_CPU / (1 << _shift()) / ticks;
+}
+
+void Timer32Class::_capture() {
+  uint16_t low  = TCB0.CCMP;  // reading CCMP clears the CAPT flag
+  uint16_t high = TCB1.CCMP;
+  uint8_t  head = _head;
+  uint8_t  next = (head + 1) & (TIMER32_BUFFER_SIZE - 1);
+  if (next == _tail) {
+    if (_overruns != 255) {
+      _overruns++;
+    }
+  } else {
+    _buffer[head] = ((uint32_t) high << 16) | low;
+    _head         = next;
+  }
+}
+
+void Timer32Class::_periodic() {
+  TCB0.INTFLAGS = TCB_CAPT_bm;
+  TCB1.INTFLAGS = TCB_CAPT_bm;
+  _callback();
+}
+
+ISR(TCB0_INT_vect, __attribute__((weak))) {
+  Timer32._periodic();          // only enabled for periods TCB0 can do alone
+}
+
+ISR(TCB1_INT_vect, __attribute__((weak))) {
+  if (TCB1.CTRLB & TCB_CNTMODE_gm) {   // a capture mode - periodic interrupt mode is 0
+    Timer32._capture();
+  } else {
+    Timer32._periodic();
+  }
+}
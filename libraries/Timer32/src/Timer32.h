@@ -0,0 +1,82 @@
+/* Timer32.h - TCB0 and TCB1 cascaded into one 32-bit timer, for input capture and long periodic interrupts
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * TCB0 is the low half, counting the selected clock. The event system takes its overflows (or, for periodic
+ * interrupts, its compare matches) to TCB1, which counts them. For capture, the same event goes to both; CASCADE in
+ * TCB1 delays it a clock so an overflow of TCB0 that happens just then has reached TCB1 before it captures. The TCB1
+ * ISR then has both halves of the capture in the two CCMP registers. 2-series only - the 0/1-series TCBs can't count
+ * events. See README.md.
+ */
+#ifndef TIMER32_H
+#define TIMER32_H
+
+#include <Arduino.h>
+#include <Event.h>
+
+#if !defined(MEGATINYCORE_SERIES) || MEGATINYCORE_SERIES != 2
+  #error "Timer32 needs the tinyAVR 2-series, whose TCBs can be cascaded"
+#endif
+#if defined(MILLIS_USE_TIMERB0) || defined(MILLIS_USE_TIMERB1)
+  #error "Timer32 uses both TCBs, so millis has to be on TCA0, the RTC, or disabled"
+#endif
+
+#if !defined(TIMER32_BUFFER_SIZE)
+  #define TIMER32_BUFFER_SIZE (4)
+#endif
+#if (TIMER32_BUFFER_SIZE & (TIMER32_BUFFER_SIZE - 1)) || TIMER32_BUFFER_SIZE > 128
+  #error "TIMER32_BUFFER_SIZE must be a power of 2, and no more than 128"
+#endif
+
+/* The same as InputCapture's: the TCB CNTMODE in the low 3 bits, and the EVCTRL EDGE and FILTER bits. */
+#define TIMER32_RISING      (TCB_CNTMODE_CAPT_gc)                   // timestamp of each rising edge
+#define TIMER32_FALLING     (TCB_CNTMODE_CAPT_gc | TCB_EDGE_bm)     // timestamp of each falling edge
+#define TIMER32_PERIOD      (TCB_CNTMODE_FRQ_gc)                    // time from one rising edge to the next
+#define TIMER32_PULSE_HIGH  (TCB_CNTMODE_PW_gc)                     // time from rising edge to falling edge
+#define TIMER32_PULSE_LOW   (TCB_CNTMODE_PW_gc | TCB_EDGE_bm)       // time from falling edge to rising edge
+#define TIMER32_FILTER      (TCB_FILTER_bm)  // OR with the mode: the input has to be stable for 4 timer clocks.
+
+#define TIMER32_CLK_DIV1    (TCB_CLKSEL_DIV1_gc)
+#define TIMER32_CLK_DIV2    (TCB_CLKSEL_DIV2_gc)
+#define TIMER32_CLK_TCA     (TCB_CLKSEL_TCA0_gc)  // whatever TCA0 is prescaled to
+
+class Timer32Class {
+  public:
+    bool     begin(uint8_t pin, uint8_t mode = TIMER32_RISING, uint8_t clock = TIMER32_CLK_DIV1);
+    /* Any event generator instead of a pin, as with InputCapture. */
+    bool     begin(gen::generator_t generator, uint8_t mode = TIMER32_RISING, uint8_t clock = TIMER32_CLK_DIV1);
+    /* callback is called from the ISR every ticks timer clocks (at least 2). Periods over 65536 are the product of
+     * TCB0's and TCB1's, so exact if ticks has a suitable factor, and otherwise within 1 part in 65536; period() says
+     * what it is. */
+    bool     beginPeriodic(uint32_t ticks, void (*callback)(), uint8_t clock = TIMER32_CLK_DIV1);
+    void     end();
+    uint8_t  available();
+    uint32_t read();       // oldest capture, in timer ticks - or 0 if there isn't one.
+    uint32_t peek();
+    void     flush();
+    uint8_t  overruns();   // captures lost because the buffer was full since the last call; saturates at 255.
+    uint32_t now();        // the count, for TIMER32_RISING/FALLING timestamps to be compared with.
+    uint32_t period() {
+      return _period;
+    }
+    uint32_t toMicros(uint32_t ticks);
+    float    toHertz(uint32_t ticks);
+    void     _capture();   // called from the ISRs
+    void     _periodic();
+  private:
+    bool     _begin(Event &channel, uint8_t mode, uint8_t clock);
+    bool     _carry(gen::generator_t generator);
+    uint8_t  _shift();
+    uint8_t           _clock;
+    uint8_t           _mode;  // 0 = off, 1 = capture, 2 = periodic
+    void            (*_callback)();
+    uint32_t          _period;
+    volatile uint8_t  _head;
+    volatile uint8_t  _tail;
+    volatile uint8_t  _overruns;
+    volatile uint32_t _buffer[TIMER32_BUFFER_SIZE];
+};
+
+extern Timer32Class Timer32;
+
+#endif
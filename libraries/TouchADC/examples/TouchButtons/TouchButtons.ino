@@ -0,0 +1,38 @@
+/* TouchButtons - four touch keys on PA4 to PA7, each lighting up an LED on PB0 to PB3 while it's touched.
+ * The electrodes can be anything conductive - a pad of copper under the front panel is the usual thing - connected
+ * straight to the pin. Send anything over serial to see the readings, for picking the thresholds.
+ */
+#include <TouchADC.h>
+
+const uint8_t keys[] = {PIN_PA4, PIN_PA5, PIN_PA6, PIN_PA7};
+const uint8_t leds[] = {PIN_PB0, PIN_PB1, PIN_PB2, PIN_PB3};
+
+void setup() {
+  Serial.begin(115200);
+  for (uint8_t i = 0; i < 4; i++) {
+    TouchADC.add(keys[i]);
+    pinMode(leds[i], OUTPUT);
+  }
+  if (!TouchADC.begin()) {
+    Serial.println("No timer service slot free");
+  }
+}
+
+void loop() {
+  uint8_t touched = TouchADC.touched();
+  for (uint8_t i = 0; i < 4; i++) {
+    digitalWrite(leds[i], (touched & (1 << i)) ? HIGH : LOW);
+  }
+  if (Serial.available()) {
+    while (Serial.available()) {
+      Serial.read();
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+      Serial.print(TouchADC.raw(i));
+      Serial.print(' ');
+      Serial.print(TouchADC.baseline(i));
+      Serial.print(' ');
+      Serial.println(TouchADC.delta(i));
+    }
+  }
+}
@@ -0,0 +1,196 @@
+/* TouchADC.cpp - see TouchADC.h
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * The ADC settings are saved and put back around every scan, and the reference is Vdd for it, so analogRead() can
+ * still be used in between. A scan is skipped, and tried again on the next tick, if the ADC is converting, has a
+ * result that hasn't been read, or belongs to the stream, scan or watch functions (RESRDY or WCMP interrupt on).
+ */
+
+#include "TouchADC.h"
+
+TouchADCClass TouchADC;
+
+static void _touch_tick() {
+  TouchADC._scan();
+}
+
+static inline __attribute__((always_inline)) uint16_t _touch_convert() {
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.COMMAND = ADC_MODE_SINGLE_12BIT_gc | ADC_START_IMMEDIATE_gc;
+    while (!(ADC0.INTFLAGS & ADC_RESRDY_bm));
+    return ADC0.RESULT;           // reading the result clears the flag.
+  #else
+    ADC0.COMMAND = ADC_STCONV_bm;
+    while (!(ADC0.INTFLAGS & ADC_RESRDY_bm));
+    return ADC0.RES;
+  #endif
+}
+
+int8_t TouchADCClass::add(uint8_t pin, uint16_t threshold) {
+  if (_count >= TOUCH_MAX_KEYS || pin >= NUM_TOTAL_PINS) {
+    return -1;
+  }
+  uint8_t channel = digitalPinToAnalogInput(pin);
+  if (channel == NOT_A_PIN) {
+    return -1;
+  }
+  uint8_t key       = _count;
+  _pin[key]         = pin;
+  _channel[key]     = channel;
+  _threshold[key]   = threshold;
+  _base[key]        = 0;
+  pinMode(pin, OUTPUT);           // grounded between measurements - and no pullup
+  digitalWrite(pin, LOW);
+  _count            = key + 1;    // last, so the ISR never looks at it before it's filled in
+  return key;
+}
+
+bool TouchADCClass::begin(uint16_t interval, uint8_t samples) {
+  end();
+  if (!(ADC0.CTRLA & ADC_ENABLE_bm)) {
+    analogRead(ADC_GROUND);       // the core may have left the ADC to be started on first use
+  }
+  _samples = (samples < 1) ? 1 : (samples > 16 ? 16 : samples);
+  _next    = 0;
+  _timer   = timerAdd(_touch_tick, interval ? interval : 1, TIMER_PERIODIC);
+  return _timer >= 0;
+}
+
+void TouchADCClass::end() {
+  if (_timer >= 0) {
+    timerCancel(_timer);
+    _timer = -1;
+  }
+}
+
+int16_t TouchADCClass::delta(uint8_t key) {
+  if (key >= _count) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  int16_t d = _raw[key] - (uint16_t)(_base[key] >> 4);
+  SREG = oldSREG;
+  return d;
+}
+
+uint16_t TouchADCClass::raw(uint8_t key) {
+  if (key >= _count) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t r = _raw[key];
+  SREG = oldSREG;
+  return r;
+}
+
+uint16_t TouchADCClass::baseline(uint8_t key) {
+  if (key >= _count) {
+    return 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t b = _base[key] >> 4;
+  SREG = oldSREG;
+  return b;
+}
+
+void TouchADCClass::recalibrate() {
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t i = 0; i < _count; i++) {
+    _base[i] = 0;
+  }
+  _touched = 0;
+  SREG = oldSREG;
+}
+
+uint16_t TouchADCClass::_measure(uint8_t key) {
+  uint8_t  pin  = _pin[key];
+  PORT_t  *port = digitalPinToPortStruct(pin);
+  uint8_t  mask = digitalPinToBitMask(pin);
+  uint8_t  channel = _channel[key];
+  uint16_t sum  = 0;
+  for (uint8_t i = _samples; i; i--) {
+    port->OUTSET = mask;
+    port->DIRSET = mask;          // charge the electrode to Vdd,
+    ADC0.MUXPOS  = ADC_MUXPOS_GND_gc;
+    _touch_convert();             // empty the sample capacitor,
+    port->DIRCLR = mask;          // let go of the electrode,
+    ADC0.MUXPOS  = channel;
+    sum += _touch_convert();      // and share its charge with the sample capacitor.
+  }
+  port->OUTCLR = mask;
+  port->DIRSET = mask;            // back to ground, where it shields the others
+  return sum;
+}
+
+/* Runs in the millis ISR, so interrupts are off throughout. */
+void TouchADCClass::_scan() {
+  uint8_t count = _count;
+  if (!count || !(ADC0.CTRLA & ADC_ENABLE_bm) || (ADC0.INTFLAGS & ADC_RESRDY_bm) || ADC0.INTCTRL) {
+    return;
+  }
+  #if MEGATINYCORE_SERIES == 2
+    if ((ADC0.COMMAND & ADC_START_gm) || (ADC0.CTRLF & ADC_FREERUN_bm)) {
+      return;
+    }
+    uint8_t ctrlc  = ADC0.CTRLC;
+    uint8_t ctrle  = ADC0.CTRLE;
+    uint8_t ctrlf  = ADC0.CTRLF;
+    uint8_t muxpos = ADC0.MUXPOS;
+    ADC0.CTRLC     = (ctrlc & ~ADC_REFSEL_gm) | ADC_REFSEL_VDD_gc;
+    ADC0.CTRLE     = 0;           // the shortest sample duration
+    ADC0.CTRLF     = 0;           // one conversion at a time, right adjusted
+  #else
+    if ((ADC0.COMMAND & ADC_STCONV_bm) || (ADC0.CTRLA & ADC_FREERUN_bm) || ADC0.EVCTRL) {
+      return;
+    }
+    uint8_t ctrla  = ADC0.CTRLA;
+    uint8_t ctrlb  = ADC0.CTRLB;
+    uint8_t ctrlc  = ADC0.CTRLC;
+    uint8_t samp   = ADC0.SAMPCTRL;
+    uint8_t muxpos = ADC0.MUXPOS;
+    ADC0.CTRLA     = ctrla & ~ADC_RESSEL_bm;  // 10 bits
+    ADC0.CTRLB     = 0;
+    ADC0.CTRLC     = (ctrlc & ~ADC_REFSEL_gm) | ADC_REFSEL_VDDREF_gc;
+    ADC0.SAMPCTRL  = 0;
+  #endif
+  uint8_t  key = _next;
+  uint16_t raw = _measure(key);
+  #if MEGATINYCORE_SERIES == 2
+    ADC0.CTRLC     = ctrlc;
+    ADC0.CTRLE     = ctrle;
+    ADC0.CTRLF     = ctrlf;
+    ADC0.MUXPOS    = muxpos;
+  #else
+    ADC0.CTRLA     = ctrla;
+    ADC0.CTRLB     = ctrlb;
+    ADC0.CTRLC     = ctrlc;
+    ADC0.SAMPCTRL  = samp;
+    ADC0.MUXPOS    = muxpos;
+  #endif
+  _next = (key + 1 == count) ? 0 : key + 1;
+  _raw[key] = raw;
+  // The baseline is an average over the last 16 measurements while the key isn't touched, kept times 16; it stays
+  // where it was while it's touched, so a finger left there doesn't become the new untouched level.
+  uint32_t base = _base[key];
+  if (!base) {
+    base = (uint32_t) raw << 4;
+  }
+  int16_t delta = raw - (uint16_t)(base >> 4);
+  uint8_t bit   = 1 << key;
+  if (_touched & bit) {
+    if (delta < (int16_t)(_threshold[key] >> 1)) {
+      _touched &= ~bit;
+    }
+  } else if (delta >= (int16_t) _threshold[key]) {
+    _touched |= bit;
+  }
+  if (!(_touched & bit)) {
+    base = base - (base >> 4) + raw;
+  }
+  _base[key] = base;
+}
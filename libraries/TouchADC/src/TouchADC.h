@@ -0,0 +1,67 @@
+/* TouchADC.h - capacitive touch buttons on ordinary ADC pins, by charge sharing with the ADC's sample capacitor
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 2.1, please see LICENCE.md for details
+ *
+ * Each measurement charges the electrode to Vdd with the pin driven high, empties the ADC's sample capacitor with a
+ * conversion of ground, then lets go of the pin and converts it with the shortest sample duration: the charge on the
+ * electrode is shared with the sample capacitor, so the reading is Vdd * C / (C + Csample), and a finger - more C -
+ * makes it higher. Each key's baseline follows slow drift while it isn't being touched. The measurements are done
+ * from a timer service callback (timerAdd()), one key per tick, so the sketch just reads the results. See README.md.
+ */
+#ifndef TOUCHADC_H
+#define TOUCHADC_H
+
+#include <Arduino.h>
+
+#if defined(MILLIS_USE_TIMERNONE) || defined(MILLIS_USE_TIMERRTC)
+  #error "TouchADC runs from the timer service, which needs millis on TCA0, a TCB or TCD0"
+#endif
+
+#if !defined(TOUCH_MAX_KEYS)
+  #define TOUCH_MAX_KEYS            (8)   // touched() is a bit mask, so no more than 8
+#endif
+#if TOUCH_MAX_KEYS > 8
+  #error "TOUCH_MAX_KEYS can't be more than 8"
+#endif
+#if MEGATINYCORE_SERIES == 2
+  #define TOUCH_DEFAULT_THRESHOLD   (160) // in the sum of the measurements per scan, see begin() - 12-bit ADC
+#else
+  #define TOUCH_DEFAULT_THRESHOLD   (40)  // 10-bit ADC
+#endif
+
+class TouchADCClass {
+  public:
+    /* The key number, in the order they're added, or -1 if the pin has no ADC input or there are TOUCH_MAX_KEYS
+     * already. threshold is how far above the baseline counts as a touch; it's released at half that. */
+    int8_t   add(uint8_t pin, uint16_t threshold = TOUCH_DEFAULT_THRESHOLD);
+    /* Measure one key every interval ms, each time summing samples measurements. False if no timer was free. */
+    bool     begin(uint16_t interval = 2, uint8_t samples = 4);
+    void     end();
+    uint8_t  touched() {          // one bit per key
+      return _touched;
+    }
+    bool     touched(uint8_t key) {
+      return _touched & (1 << key);
+    }
+    int16_t  delta(uint8_t key);  // the last measurement minus the baseline
+    uint16_t raw(uint8_t key);    // the last measurement
+    uint16_t baseline(uint8_t key);
+    void     recalibrate();       // take the next measurement of each key as its untouched baseline
+    void     _scan();             // called from the timer callback
+  private:
+    uint16_t          _measure(uint8_t key);
+    uint8_t           _count;
+    uint8_t           _next;
+    uint8_t           _samples;
+    int8_t            _timer = -1;
+    uint8_t           _pin[TOUCH_MAX_KEYS];
+    uint8_t           _channel[TOUCH_MAX_KEYS];
+    uint16_t          _threshold[TOUCH_MAX_KEYS];
+    volatile uint16_t _raw[TOUCH_MAX_KEYS];
+    volatile uint32_t _base[TOUCH_MAX_KEYS];   // the baseline, times 16; 0 until the first measurement
+    volatile uint8_t  _touched;
+};
+
+extern TouchADCClass TouchADC;
+
+#endif
@@ -36,6 +36,9 @@
 
 #include <inttypes.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <string.h>
+#include <util/crc16.h>
 
 
 
@@ -207,6 +210,30 @@ struct USERSIGClass {
     return USER_SIGNATURES_SIZE;
   }
 
+  /* Like update() on each byte, but the changed ones are all loaded into the page buffer and then written with one
+   * page erase-write, instead of one per byte (the USERROW is a single page). Interrupts are off while the buffer is
+   * loaded, so that an ISR writing to the EEPROM can't get its bytes mixed into this. */
+  void writeBlock(int idx, const void *buf, uint8_t len) {
+    const uint8_t *ptr = (const uint8_t *) buf;
+    bool changed = false;
+    while (NVMCTRL.STATUS & (NVMCTRL_EEBUSY_bm | NVMCTRL_FBUSY_bm));
+    uint8_t oldSREG = SREG;
+    cli();
+    _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEBUFCLR_gc);
+    for (; len; --len, ++idx, ++ptr) {
+      volatile uint8_t *cell = (volatile uint8_t *)((idx & (USER_SIGNATURES_SIZE - 1)) | USER_SIGNATURES_START);
+      if (*cell != *ptr) {
+        *cell = *ptr;
+        changed = true;
+      }
+    }
+    if (changed) {
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+    }
+    SREG = oldSREG;
+    while (NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+  }
+
   // Functionality to 'get' and 'put' objects to and from EEPROM.
   template< typename T > T &get(int idx, T &t) {
     USPtr e = idx;
@@ -218,13 +245,79 @@ struct USERSIGClass {
   }
 
   template< typename T > const T &put(int idx, const T &t) {
-    USPtr e = idx;
-    const uint8_t *ptr = (const uint8_t *) &t;
-    for (int count = sizeof(T) ; count ; --count, ++e) {
-      (*e).update(*ptr++);
-    }
+    writeBlock(idx, &t, sizeof(T));
     return t;
   }
+
+  /* Two copies of a T, each with a sequence number and a CRC16, one after the other from idx - 2 * (sizeof(T) + 3)
+   * bytes in all. putSafe() writes over the older copy (or a bad one), so if the power goes while it's being written,
+   * the other is still there, since a page erase-write only erases the bytes that were loaded into the page buffer.
+   * getSafe() reads the newer of the copies whose CRC is right, and returns false if neither is. */
+  template< typename T > bool getSafe(int idx, T &t) {
+    static_assert(2 * (sizeof(T) + 3) <= USER_SIGNATURES_SIZE, "Two copies of this won't fit in the USERROW");
+    int8_t copy = _newestCopy(idx, sizeof(T));
+    if (copy < 0) {
+      return false;
+    }
+    USPtr e = idx + copy * (sizeof(T) + 3) + 1;
+    uint8_t *ptr = (uint8_t *) &t;
+    for (uint8_t count = sizeof(T); count; --count, ++e) {
+      *ptr++ = *e;
+    }
+    return true;
+  }
+  template< typename T > bool putSafe(int idx, const T &t) {
+    static_assert(2 * (sizeof(T) + 3) <= USER_SIGNATURES_SIZE, "Two copies of this won't fit in the USERROW");
+    uint8_t record[sizeof(T) + 3];
+    int8_t newest = _newestCopy(idx, sizeof(T));
+    uint8_t at = idx;
+    record[0] = 0;
+    if (newest >= 0) {
+      record[0] = USRef(idx + newest * (sizeof(T) + 3)) + 1;
+      if (!newest) {
+        at += sizeof(T) + 3;
+      }
+    }
+    memcpy(record + 1, &t, sizeof(T));
+    uint16_t crc = _crc(record, sizeof(T) + 1);
+    record[sizeof(T) + 1] = crc;
+    record[sizeof(T) + 2] = crc >> 8;
+    writeBlock(at, record, sizeof(record));
+    // read back what was written
+    for (uint8_t i = 0; i < sizeof(record); i++) {
+      if (USRef(at + i) != record[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  private:
+  static uint16_t _crc(const uint8_t *data, uint8_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+      crc = _crc16_update(crc, *data++);
+    }
+    return crc;
+  }
+  // Whether the copy at idx, of a len byte object, has the right CRC
+  static bool _copyValid(uint8_t idx, uint8_t len) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i <= len; i++) {
+      crc = _crc16_update(crc, USRef(idx + i));
+    }
+    return crc == (USRef(idx + len + 1) | (USRef(idx + len + 2) << 8));
+  }
+  // 0 or 1 for the newer good copy, -1 if neither is good
+  static int8_t _newestCopy(uint8_t idx, uint8_t len) {
+    bool first  = _copyValid(idx, len);
+    bool second = _copyValid(idx + len + 3, len);
+    if (first && second) {
+      // sequence numbers wrap, so it's newer if it's less than 128 ahead
+      return ((int8_t)(USRef(idx + len + 3) - USRef(idx)) > 0) ? 1 : 0;
+    }
+    return first ? 0 : (second ? 1 : -1);
+  }
 };
 
 static USERSIGClass USERSIG;
@@ -0,0 +1,87 @@
+/* Wire Client Buffers
+ *
+ * A node in the middle: it answers a master above it at address 0x54, and is itself the master of a
+ * temperature sensor on the same bus, which it reads every 100 ms. The slave side uses its own buffers,
+ * with Wire.setClientBuffers(), and the sensor is read with Wire.runTransactions(), into other buffers,
+ * so neither side waits for or overwrites the other.
+ *
+ * A write from the upstream master sets the blink delay in ms (2 bytes, low byte first); a read returns
+ * the last temperature reading (2 bytes, as the sensor sent them) and the number of readings so far.
+ * Results are double buffered: onDone() swaps in the newest copy after each read by the master.
+ *
+ * The sensor address and register are placeholders - change them to the device on your bus.
+ * Requires master and slave to be enabled at once (TWI_MANDS, the default where supported).
+ * Pullup resistors must be connected between both data lines and Vcc.
+ * See the Wire library README.md for more information.
+ */
+
+#include <Wire.h>
+
+const uint8_t sensorAddress = 0x48;
+const uint8_t sensorRegister = 0x00;
+
+uint8_t commands[2];                          // written by the upstream master
+uint8_t replies[2][3];                        // read by it, double buffered
+volatile uint8_t replyReady = 0;              // which of the two is the newest
+twiClientBuffers client;
+
+uint8_t reading[2];
+uint8_t readings = 0;
+twiTransaction poll;
+uint32_t lastPoll = 0;
+bool polling = false;
+
+volatile uint16_t delaytime = 500;
+
+void onDone(bool hostRead, uint8_t count) {   // called from the ISR
+  if (hostRead) {
+    client.txBuffer = replies[replyReady];    // next read gets the newest one
+  } else if (count == 2) {
+    delaytime = commands[0] | (commands[1] << 8);
+  }
+}
+
+void setup() {
+  client.rxBuffer = commands;
+  client.rxLength = sizeof(commands);
+  client.txBuffer = replies[0];
+  client.txLength = sizeof(replies[0]);
+  client.onDone   = onDone;
+  Wire.setClientBuffers(&client);
+  Wire.begin();                               // master
+  Wire.begin(0x54);                           // and slave
+  poll.address     = sensorAddress;
+  poll.writeBuffer = &sensorRegister;
+  poll.writeLength = 1;
+  poll.readBuffer  = reading;
+  poll.readLength  = 2;
+  pinMode(LED_BUILTIN, OUTPUT);
+}
+
+void loop() {
+  if (!polling && millis() - lastPoll >= 100) {
+    lastPoll = millis();
+    polling = (Wire.runTransactions(&poll, 1) == 0);
+  }
+  if (polling && Wire.asyncStatus() != TWI_ASYNC_PENDING) {
+    polling = false;
+    if (poll.status == 0) {
+      noInterrupts();                         // so onDone() can't switch buffers halfway
+      uint8_t next = (client.txBuffer == replies[0]) ? 1 : 0;  // fill the one the master isn't reading
+      replies[next][0] = reading[0];
+      replies[next][1] = reading[1];
+      replies[next][2] = ++readings;
+      replyReady = next;
+      interrupts();
+    }
+  }
+  static uint32_t lastBlinkAt = 0;
+  uint16_t delay_ms;
+  noInterrupts();
+  delay_ms = delaytime;
+  interrupts();
+  if (millis() - lastBlinkAt > delay_ms) {
+    lastBlinkAt = millis();
+    digitalWrite(LED_BUILTIN, CHANGE);
+  }
+}
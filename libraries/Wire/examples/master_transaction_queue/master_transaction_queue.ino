@@ -0,0 +1,58 @@
+/* Wire Master Transaction Queue
+ *
+ * Reads two bytes from register 0x00 of each of three I2C devices every 10 ms, using Wire.runTransactions().
+ * The whole list is run by the TWI interrupt, with repeated starts between the devices and a single STOP at
+ * the end, while loop() keeps running. When it's done, the results are printed.
+ *
+ * The addresses below are placeholders - change them to the devices on your bus. A device that isn't there
+ * just gets an error in the status of its entry; the others are still read.
+ *
+ * Pullup resistors must be connected between both data lines and Vcc.
+ * See the Wire library README.md for more information.
+ */
+
+#define MySerial Serial
+
+#include <Wire.h>
+
+const uint8_t addresses[3] = {0x48, 0x49, 0x4A};
+const uint8_t reg = 0x00;                     // the register each one is read from
+uint8_t results[3][2];
+twiTransaction polls[3];
+uint32_t lastPoll = 0;
+bool printed = true;
+
+void setup() {
+  MySerial.begin(115200);
+  Wire.begin();
+  for (uint8_t i = 0; i < 3; i++) {
+    polls[i].address     = addresses[i];
+    polls[i].writeBuffer = &reg;
+    polls[i].writeLength = 1;
+    polls[i].readBuffer  = results[i];
+    polls[i].readLength  = 2;
+  }
+}
+
+void loop() {
+  if (millis() - lastPoll >= 10 && printed) {
+    lastPoll = millis();
+    if (Wire.runTransactions(polls, 3) == 0) { // returns at once; the ISR does the rest
+      printed = false;
+    }
+  }
+  if (!printed && Wire.asyncStatus() != TWI_ASYNC_PENDING) {
+    for (uint8_t i = 0; i < 3; i++) {
+      MySerial.print(addresses[i], HEX);
+      MySerial.print(": ");
+      if (polls[i].status == 0) {
+        MySerial.println((results[i][0] << 8) | results[i][1]);
+      } else {
+        MySerial.print("error 0x");
+        MySerial.println(polls[i].status, HEX);
+      }
+    }
+    printed = true;
+  }
+  // anything else can be done here while the bus is busy
+}
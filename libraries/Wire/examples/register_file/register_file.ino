@@ -0,0 +1,56 @@
+/* Wire Register File
+ *
+ * The same register machine as the Wire Register Model example, but served entirely by the
+ * TWI client interrupt with Wire.setRegisterFile(), instead of onReceive/onRequest handlers.
+ * The first byte of a write from the master sets the register pointer, the following ones are
+ * written to the registers from there on, masked by WriteMask; a read returns the registers
+ * from the pointer on. The pointer autoincrements and wraps around after the last register.
+ *
+ * No sketch code runs per byte, so the slave never stretches the clock - the master can be
+ * the register_model_master example. Registers 4 and 5 are the low and high bytes of the blink
+ * delay, and they are marked in NotifyMask, so onWrite() is called when the master changes them.
+ */
+#include <Wire.h>
+volatile uint8_t DeviceRegisters[32] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                        0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+                                        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+                                        0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+                                       };
+const uint8_t WriteMask[32]          = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F, 0xFF, 0xFF,
+                                        0x33, 0x33, 0x33, 0x33, 0x00, 0x00, 0x00, 0x00,
+                                        0x0F, 0x0F, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+                                        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+                                       };
+const uint8_t NotifyMask[4]          = {0x30, 0x00, 0x00, 0x00}; // one bit per register: 4 and 5
+volatile uint16_t delaytime          = 0x0504;
+
+void onWrite(uint8_t first, uint8_t count) {  // called from the ISR at the end of the write
+  (void) first;
+  (void) count;
+  delaytime = DeviceRegisters[4] + ((uint16_t)DeviceRegisters[5] << 8);
+}
+
+twiRegisterFile registerFile;
+
+void setup() {
+  registerFile.registers = DeviceRegisters;
+  registerFile.size      = sizeof(DeviceRegisters);
+  registerFile.writable  = WriteMask;
+  registerFile.notify    = NotifyMask;
+  registerFile.onWrite   = onWrite;
+  Wire.setRegisterFile(&registerFile);
+  Wire.begin(0x69);
+  pinMode(LED_BUILTIN, OUTPUT);
+}
+
+void loop() {
+  static uint32_t lastBlinkAt = 0;
+  uint16_t delay_ms;
+  noInterrupts();
+  delay_ms = delaytime;
+  interrupts();
+  if (millis() - lastBlinkAt > delay_ms) {
+    lastBlinkAt = millis();
+    digitalWrite(LED_BUILTIN, CHANGE);
+  }
+}
@@ -0,0 +1,59 @@
+/* Wire Register File, Multi Address
+ *
+ * One tinyAVR answering as three devices with Wire.setAddressMap(): a 256-byte EEPROM made of
+ * two 128-byte pages at 0x50 and 0x51 (like the page addresses of a 24C04), and a temperature
+ * sensor at 0x48 with a read-only result and a writable configuration register. Each address
+ * has its own register file and its own pointer, and the TWI client interrupt picks the file
+ * by the address the master sent - nothing in the sketch needs to check it.
+ *
+ * The addresses differ in bits 0, 3 and 4, so the hardware address mask lets in 0x40, 0x41,
+ * 0x48, 0x49, 0x50, 0x51, 0x58 and 0x59; the ones that aren't in the map are NACKed, just as
+ * if nothing was there.
+ *
+ * Writes to the EEPROM pages are kept in RAM here; onPageWrite() is where they would be
+ * committed to the real EEPROM.
+ */
+#include <Wire.h>
+
+volatile uint8_t Page0[128];
+volatile uint8_t Page1[128];
+volatile uint8_t Sensor[2] = {0x00, 0x00}; // 0: temperature (read only), 1: configuration
+const uint8_t SensorWritable[2] = {0x00, 0xFF};
+
+twiRegisterFile page0File;
+twiRegisterFile page1File;
+twiRegisterFile sensorFile;
+
+const twiAddressMap devices[] = {
+  {0x48, &sensorFile},
+  {0x50, &page0File},
+  {0x51, &page1File},
+};
+
+void onPageWrite(uint8_t first, uint8_t count) {  // called from the ISR at the end of each write
+  (void) first;
+  (void) count;
+}
+
+const uint8_t AllRegisters[16] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+                                 }; // every register of a page calls onPageWrite()
+
+void setup() {
+  page0File.registers  = Page0;
+  page0File.size       = sizeof(Page0);
+  page0File.notify     = AllRegisters;
+  page0File.onWrite    = onPageWrite;
+  page1File            = page0File;
+  page1File.registers  = Page1;
+  sensorFile.registers = Sensor;
+  sensorFile.size      = sizeof(Sensor);
+  sensorFile.writable  = SensorWritable;
+  Wire.setAddressMap(devices, sizeof(devices) / sizeof(devices[0])); // instead of Wire.begin(address)
+}
+
+void loop() {
+  uint8_t temperature = 20 + ((millis() >> 10) & 0x07);  // stand-in for a measurement
+  Sensor[0] = temperature;
+  delay(100);
+}
@@ -204,6 +204,34 @@ void TwoWire::setClock(uint32_t clock) {
 }
 
 
+/**
+ *@brief      setClock with a rise time solves for the baud exactly, instead of using the approximations
+ *
+ *            Uses the data sheet formula with the given rise time and the real CLK_PER (so after
+ *            setCPUFrequency(), call it again), respects the minimum SCL low time of the mode, and
+ *            enables Fast Mode Plus above 400 kHz. Has only an effect when used after begin(void).
+ *
+ *@param      uint32_t clock - the desired clock in Hertz; the result will not be faster
+ *            uint16_t riseTime - the rise time of the bus in nanoseconds, 10% to 90%
+ *
+ *@return     uint32_t
+ *@retval     the clock that results, or 0 if the host isn't enabled
+ */
+uint32_t TwoWire::setClock(uint32_t clock, uint16_t riseTime) {
+  return TWI_MasterSetBaudRise(&vars, clock, riseTime);
+}
+
+
+/**
+ *@brief      getClock returns the SCL frequency the baud setting gives, in Hertz
+ *
+ *            Calculated from the rise time given to setClock(), or 300 ns if none was.
+ */
+uint32_t TwoWire::getClock(void) {
+  return TWI_MasterGetFrequency(&vars);
+}
+
+
 /**
  *@brief      end disables the TWI host and client
  *
@@ -343,6 +371,96 @@ uint8_t TwoWire::endTransmission(bool sendStop) {
 }
 
 
+/**
+ *@brief      writeFrom writes length bytes from the caller's buffer to a client, in one transaction
+ *
+ *            Equivalent to beginTransmission(), write(src, length), endTransmission(sendStop), but the
+ *            data goes to the TWI straight from src instead of being copied into the transmit buffer
+ *            first - so it is not limited to BUFFER_LENGTH, which is handy for EEPROM pages.
+ *
+ *@param      uint8_t address - the address of the client
+ *            const uint8_t *src - the data
+ *            size_t length - the number of bytes to write
+ *            bool sendStop - if the transaction should be terminated with a STOP condition
+ *
+ *@return     uint8_t
+ *@retval     the same as endTransmission()
+ */
+uint8_t TwoWire::writeFrom(uint8_t address, const uint8_t *src, size_t length, bool sendStop) {
+  vars._clientAddress = address << 1;
+  return TWI_MasterWriteFrom(&vars, src, length, sendStop);
+}
+
+
+/**
+ *@brief      readInto reads length bytes from a client straight into the caller's buffer
+ *
+ *            Like requestFrom() followed by reading everything out, but without going through the receive
+ *            buffer, so it is not limited to BUFFER_LENGTH. available() and read() are not affected.
+ *
+ *@param      uint8_t address - the address of the client
+ *            uint8_t *dst - where the data goes
+ *            size_t length - the number of bytes to read
+ *            bool sendStop - if the transaction should be terminated with a STOP condition
+ *
+ *@return     size_t
+ *@retval     the number of bytes read - less than length if there was an error
+ */
+size_t TwoWire::readInto(uint8_t address, uint8_t *dst, size_t length, bool sendStop) {
+  vars._clientAddress = address << 1;
+  return TWI_MasterReadInto(&vars, dst, length, sendStop);
+}
+
+
+/**
+ *@brief      readRegisters reads length bytes starting at register reg of a client, for the many devices that
+ *              auto-increment the register pointer: writes the register address, REPSTART, reads, STOP.
+ *
+ *            readRegisters16() is the same for devices with 16-bit register addresses, like larger EEPROMs,
+ *            which are sent high byte first. The data goes straight into dst, as with readInto().
+ *
+ *@param      uint8_t address - the address of the client
+ *            uint8_t/uint16_t reg - the first register
+ *            uint8_t *dst - where the data goes
+ *            size_t length - the number of bytes to read
+ *
+ *@return     size_t
+ *@retval     the number of bytes read; 0 if the client didn't accept the register address
+ */
+size_t TwoWire::readRegisters(uint8_t address, uint8_t reg, uint8_t *dst, size_t length) {
+  vars._clientAddress = address << 1;
+  return TWI_MasterReadRegisters(&vars, reg, 1, dst, length);
+}
+size_t TwoWire::readRegisters16(uint8_t address, uint16_t reg, uint8_t *dst, size_t length) {
+  vars._clientAddress = address << 1;
+  return TWI_MasterReadRegisters(&vars, reg, 2, dst, length);
+}
+
+
+/**
+ *@brief      writeRegisters writes length bytes starting at register reg of a client: the register address
+ *              and then the data, in one transaction.
+ *
+ *            writeRegisters16() is the same for devices with 16-bit register addresses.
+ *
+ *@param      uint8_t address - the address of the client
+ *            uint8_t/uint16_t reg - the first register
+ *            const uint8_t *src - the data
+ *            size_t length - the number of bytes to write
+ *
+ *@return     uint8_t
+ *@retval     the same as endTransmission()
+ */
+uint8_t TwoWire::writeRegisters(uint8_t address, uint8_t reg, const uint8_t *src, size_t length) {
+  vars._clientAddress = address << 1;
+  return TWI_MasterWriteRegisters(&vars, reg, 1, src, length);
+}
+uint8_t TwoWire::writeRegisters16(uint8_t address, uint16_t reg, const uint8_t *src, size_t length) {
+  vars._clientAddress = address << 1;
+  return TWI_MasterWriteRegisters(&vars, reg, 2, src, length);
+}
+
+
 
 /**
  *@brief      write fills the transmit buffers, host or client depending on when it is called
@@ -610,6 +728,106 @@ uint8_t TwoWire::slaveTransactionOpen() {
   return 1;                     // Otherwise it was a write.
 }
 
+/**
+ *@brief      setRegisterFile makes the client serve a register map from the ISR, like most I2C peripherals do
+ *
+ *            The first byte of each host write sets the register pointer, the next ones are written to
+ *            the registers at the pointer, if writable; host reads read from the pointer. The pointer
+ *            auto-increments, wrapping after the last register. onReceive/onRequest are not called and
+ *            the buffers aren't used while it is set; the onWrite member is called at the end of a write
+ *            that changed a register marked in notify. See the register_file example.
+ *
+ *@param      struct twiRegisterFile *file - the register map, which must stay valid. NULL to go back to
+ *              the buffers and onReceive/onRequest.
+ *
+ *@return     void
+ */
+void TwoWire::setRegisterFile(struct twiRegisterFile *file) {
+  TWI_SetRegisterFile(&vars, file);
+}
+
+
+/**
+ *@brief      setAddressMap makes the client answer each address in the map with its own register file
+ *
+ *            So one part can emulate several I2C devices - EEPROM pages, sensors - each served by the ISR
+ *            as setRegisterFile() does. The address registers are set to match every address in the map,
+ *            and the ISR picks the file for the one addressed, NACKing any other address the mask lets in.
+ *            Starts the client if begin() wasn't called with an address, so it can be used instead of it.
+ *            See the register_file_multi_address example.
+ *
+ *@param      const struct twiAddressMap *map - the address table, which must stay valid, as must its
+ *              register files. NULL to go back to the buffers and onReceive/onRequest.
+ *            uint8_t count - the number of entries in the map
+ *
+ *@return     void
+ */
+void TwoWire::setAddressMap(const struct twiAddressMap *map, uint8_t count) {
+  TWI_SetAddressMap(&vars, map, count);
+}
+
+
+/**
+ *@brief      setClientBuffers makes the client use the caller's buffers, so it runs independently of the host
+ *
+ *            Host writes to us go into rxBuffer and host reads are served from txBuffer, by the ISR, without
+ *            touching the Wire buffers, so the host side can be used at the same time with its own buffers
+ *            (writeFrom()/readInto() or runTransactions()). onDone is called from the ISR at the end of each
+ *            transaction, and may swap in other buffers. See the client_buffers example.
+ *
+ *@param      struct twiClientBuffers *bufs - the buffers, which must stay valid. NULL to go back to the Wire
+ *              buffers and onReceive/onRequest.
+ *
+ *@return     void
+ */
+void TwoWire::setClientBuffers(struct twiClientBuffers *bufs) {
+  TWI_SetClientBuffers(&vars, bufs);
+}
+
+
+/**
+ *@brief      setWireTimeout sets how long the host waits on a stalled bus before giving up, as on the official AVR core
+ *
+ *            The wait restarts whenever a byte goes through, so it limits how long the bus may stall, not how
+ *            long a transaction may take. It is counted in passes through the polling loop, so it's approximate;
+ *            0 restores the default of about 16 ms. When reset_with_timeout is true, a timeout is followed by
+ *            recoverBus(), so a client holding SDA low is dealt with without the sketch having to.
+ *
+ *@param      uint32_t timeout - in microseconds, up to about 52 ms at 20 MHz, a bit more at lower clocks
+ *            bool reset_with_timeout - run recoverBus() on a timeout
+ *
+ *@return     void
+ */
+void TwoWire::setWireTimeout(uint32_t timeout, bool reset_with_timeout) {
+  TWI_SetTimeout(&vars, timeout, reset_with_timeout);
+}
+
+
+/**
+ *@brief      getWireTimeoutFlag returns whether a host transaction timed out since the flag was cleared
+ */
+bool TwoWire::getWireTimeoutFlag(void) {
+  return vars._bools._timedOut;
+}
+
+
+void TwoWire::clearWireTimeoutFlag(void) {
+  vars._bools._timedOut = 0;
+}
+
+
+/**
+ *@brief      recoverBus frees a bus held by a client: takes the pins from the TWI, toggles SCL up to 9 times
+ *              until the client releases SDA, then sends a STOP and gives the pins back.
+ *
+ *@return     uint8_t
+ *@retval     0 if both lines are high afterwards, 17 (TWI_ERR_PULLUP) if they aren't
+ */
+uint8_t TwoWire::recoverBus(void) {
+  return TWI_RecoverBus(&vars);
+}
+
+
 /**
  *@brief      enableDualMode enables the splitting of host and client pins
  *
@@ -767,11 +985,61 @@ uint8_t TwoWire::returnError() {
 #endif
 
 
+#if defined(TWI_STATS_ENABLED)
+/**
+ *@brief      getStats copies the bus statistics kept since begin() or the last resetStats()
+ *
+ *@param      struct twiStats *copy - where they go
+ *            bool reset - also clear them, in one go, so nothing is counted twice or missed
+ *
+ *@return     void
+ */
+void TwoWire::getStats(struct twiStats *copy, bool reset) {
+  TWI_GetStats(&vars, copy, reset);
+}
+
+void TwoWire::resetStats() {
+  TWI_GetStats(&vars, NULL, true);
+}
+#endif
+
+
+#if defined(TWI_PEC_ENABLED)
+/**
+ *@brief      setPEC turns SMBus packet error checking on or off, for both host and client
+ *
+ *            The PEC is sent after the data of endTransmission() and the other writes that end with a STOP,
+ *            and read and checked after the data of requestFrom() and the other reads, but not on the async
+ *            methods, runTransactions() or a register file. A read with a wrong PEC returns 0 bytes.
+ *
+ *@param      bool enable
+ *
+ *@return     void
+ */
+void TwoWire::setPEC(bool enable) {
+  TWI_SetPEC(&vars, enable);
+}
+
+
+/**
+ *@brief      pecFailed tells if data was thrown away for a wrong PEC since it was last called
+ *
+ *@return     bool
+ */
+bool TwoWire::pecFailed() {
+  return TWI_PecFailed(&vars);
+}
+#endif
+
+
 /**
  *@brief      TWI0 Slave Interrupt vector
  */
 ISR(TWI0_TWIS_vect) {
+  ISR_TRACE_ENTER(TWI);
+  TRACE_ISR(TWI, TWI0.SSTATUS);
   TwoWire::onSlaveIRQ(&TWI0);
+  ISR_TRACE_EXIT(TWI);
 }
 
 
@@ -780,7 +1048,10 @@ ISR(TWI0_TWIS_vect) {
  */
 #if defined(TWI1)
   ISR(TWI1_TWIS_vect) {
+    ISR_TRACE_ENTER(TWI);
+    TRACE_ISR(TWI, TWI1.SSTATUS);
     TwoWire::onSlaveIRQ(&TWI1);
+    ISR_TRACE_EXIT(TWI);
   }
 #endif
 
@@ -69,6 +69,8 @@ class TwoWire: public Stream {
     bool swapModule(TWI_t *twi_module);
     void usePullups();
     void setClock(uint32_t);
+    uint32_t setClock(uint32_t clock, uint16_t riseTime);  // exact, for the given rise time in ns
+    uint32_t getClock(void);
 
     void begin(); // all attempts to make these look prettier were rejected by astyle, and it's not worth disabling linting over.
     void begin(uint8_t  address, bool receive_broadcast, uint8_t second_address);
@@ -111,6 +113,26 @@ class TwoWire: public Stream {
 
     uint16_t writeRead(uint8_t quantity, uint8_t sendStop);
 
+    // Write from, or read into, the caller's buffer, bypassing the Wire buffers, so the length is not limited to BUFFER_LENGTH
+    uint8_t  writeFrom(uint8_t address, const uint8_t *src, size_t length, bool sendStop = true);
+    size_t   readInto(uint8_t address, uint8_t *dst, size_t length, bool sendStop = true);
+    // Register access: the register address, then the data, in one transaction (16: 16-bit register addresses)
+    size_t   readRegisters(uint8_t address, uint8_t reg, uint8_t *dst, size_t length);
+    size_t   readRegisters16(uint8_t address, uint16_t reg, uint8_t *dst, size_t length);
+    uint8_t  writeRegisters(uint8_t address, uint8_t reg, const uint8_t *src, size_t length);
+    uint8_t  writeRegisters16(uint8_t address, uint16_t reg, const uint8_t *src, size_t length);
+
+    // Interrupt driven versions of endTransmission() and requestFrom() - they return at once, and the
+    // callback is called from the ISR when it's done, with the status endTransmission() would have returned.
+    uint8_t endTransmissionAsync(twiAsyncCallback_t callback = NULL, bool sendStop = true);
+    uint8_t requestFromAsync(uint8_t address, uint8_t quantity, twiAsyncCallback_t callback = NULL, bool sendStop = true);
+    uint8_t asyncStatus(void);      // TWI_ASYNC_PENDING while running, then the result
+    uint8_t asyncCount(void);       // bytes written or read by the last one
+    void    asyncDefer(uint8_t deferred);  // DEFERRED: post the callbacks to run from deferDispatch() instead
+    void    asyncAbort(void);
+    // Runs a list of write-then-read transactions back to back with repeated starts, from the ISR
+    uint8_t runTransactions(struct twiTransaction *list, uint8_t count, twiAsyncCallback_t callback = NULL);
+
     virtual size_t write(uint8_t);
     virtual size_t write(const uint8_t *, size_t);
     virtual int available(void);
@@ -123,11 +145,19 @@ class TwoWire: public Stream {
     uint8_t slaveTransactionOpen(void);
     void    enableDualMode(bool fmp_enable);      // Moves the Slave to dedicated pins
 
+    void    setWireTimeout(uint32_t timeout = 25000, bool reset_with_timeout = false);  // as the official AVR core
+    bool    getWireTimeoutFlag(void);
+    void    clearWireTimeoutFlag(void);
+    uint8_t recoverBus(void);                     // clock a stuck client free, and send a STOP
+
     inline void selectSlaveBuffer();
     inline void deselectSlaveBuffer();
 
     void onReceive(void (*)(int));
     void onRequest(void (*)(void));
+    void setRegisterFile(struct twiRegisterFile *file);  // serve a register map from the ISR instead
+    void setAddressMap(const struct twiAddressMap *map, uint8_t count);  // or one per address, for several devices
+    void setClientBuffers(struct twiClientBuffers *bufs); // or the caller's own buffers
 
     inline size_t write(unsigned long n) {
       return      write((uint8_t)     n);
@@ -147,6 +177,16 @@ class TwoWire: public Stream {
     uint8_t returnError();
     #endif
 
+    #if defined(TWI_STATS_ENABLED)
+    void    getStats(struct twiStats *copy, bool reset = false);
+    void    resetStats();
+    #endif
+
+    #if defined(TWI_PEC_ENABLED)
+    void    setPEC(bool enable);
+    bool    pecFailed();
+    #endif
+
     void    TWI_onReceiveService(int numBytes);
     uint8_t TWI_onRequestService(void);
 
@@ -0,0 +1,114 @@
+/*
+  Wire_async.cpp - the interrupt driven host methods of TwoWire
+  Part of megaTinyCore and DxCore.
+
+  These are in their own file so that, with the library linked as an archive, the host
+  interrupt in twi_async.c only gets linked in when one of them is used.
+*/
+// *INDENT-OFF*   astyle wants this file to be completely unreadable with no indentation for the many preprocessor conditionals!
+
+#include "Arduino.h"
+#include "Wire.h"
+
+
+/**
+ *@brief      endTransmissionAsync starts a host WRITE of what was written since beginTransmission()
+ *
+ *            Unlike endTransmission(), this returns as soon as the address has been handed to the TWI,
+ *            and the rest of the transaction is driven by the host interrupt. The transmit buffer must
+ *            not be touched until it's done.
+ *
+ *@param      twiAsyncCallback_t callback - called from the ISR with the result, or NULL to poll asyncStatus()
+ *            bool sendStop - if the transaction should be terminated with a STOP condition
+ *
+ *@return     uint8_t
+ *@retval     0 if the write was started,
+ *           21 if an async transaction is already running
+ *          255 (-1) for TWI not initialized (begin not called) or bus somehow in "unknown" state.
+ */
+uint8_t TwoWire::endTransmissionAsync(twiAsyncCallback_t callback, bool sendStop) {
+  return TWI_MasterWriteAsync(&vars, sendStop, callback);
+}
+
+
+/**
+ *@brief      requestFromAsync starts a host READ of quantity bytes into the receive buffer
+ *
+ *            Returns at once; when the callback is called (or asyncStatus() is no longer TWI_ASYNC_PENDING),
+ *            the bytes can be read with available() and read() as after requestFrom().
+ *
+ *@param      uint8_t address - the address of the client
+ *            uint8_t quantity - the number of bytes to read, at most BUFFER_LENGTH
+ *            twiAsyncCallback_t callback - called from the ISR with the result, or NULL to poll asyncStatus()
+ *            bool sendStop - if the transaction should be terminated with a STOP condition
+ *
+ *@return     uint8_t
+ *@retval     0 if the read was started, otherwise the reason it wasn't
+ */
+uint8_t TwoWire::requestFromAsync(uint8_t address, uint8_t quantity, twiAsyncCallback_t callback, bool sendStop) {
+  if (quantity > BUFFER_LENGTH) {
+    quantity = BUFFER_LENGTH;
+  }
+  vars._clientAddress = address << 1;
+  return TWI_MasterReadAsync(&vars, quantity, sendStop, callback);
+}
+
+
+/**
+ *@brief      asyncStatus returns the state of the last async transaction
+ *
+ *@return     uint8_t
+ *@retval     TWI_ASYNC_PENDING (0xFF) while it's running, then 0 for success or the error code
+ */
+uint8_t TwoWire::asyncStatus(void) {
+  return TWI_AsyncStatus(&vars);
+}
+
+
+/**
+ *@brief      asyncCount returns the number of bytes the last async transaction wrote or read
+ */
+uint8_t TwoWire::asyncCount(void) {
+  return TWI_AsyncCount(&vars);
+}
+
+
+/**
+ *@brief      asyncDefer makes the callbacks of the async transactions started after it be posted with defer(), to run
+ *              from deferDispatch(), instead of being called from the ISR.
+ *
+ *@param      uint8_t deferred - DEFERRED, DEFERRED_LOW, or 0 to call them from the ISR again
+ */
+void TwoWire::asyncDefer(uint8_t deferred) {
+  TWI_AsyncDefer(&vars, deferred);
+}
+
+
+/**
+ *@brief      asyncAbort gives up on the running async transaction, sending a STOP if the bus is ours.
+ *
+ *            Its status becomes TWI_ERR_TIMEOUT, and the callback is not called.
+ */
+void TwoWire::asyncAbort(void) {
+  TWI_AsyncAbort(&vars);
+}
+
+
+/**
+ *@brief      runTransactions runs a list of transactions from the host ISR, one after another with repeated starts
+ *
+ *            Each struct twiTransaction writes writeLength bytes from writeBuffer to address, then reads readLength
+ *            bytes into readBuffer, and gets the TWI_ERR_* code it ended with in status. A NACK only ends that
+ *            transaction; the STOP comes after the last one. The Wire buffers are not used, so the list and its
+ *            buffers must stay untouched until it's done. asyncStatus() returns the first error any of them had.
+ *
+ *@param      struct twiTransaction *list - the transactions
+ *            uint8_t count - how many of them
+ *            twiAsyncCallback_t callback - called from the ISR when they're all done, or NULL to poll asyncStatus()
+ *
+ *@return     uint8_t
+ *@retval     0 if it was started, otherwise the reason it wasn't
+ */
+uint8_t TwoWire::runTransactions(struct twiTransaction *list, uint8_t count, twiAsyncCallback_t callback) {
+  return TWI_QueueRun(&vars, list, count, callback);
+}
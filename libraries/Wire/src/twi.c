@@ -73,7 +73,8 @@ void TWI_MasterInit(struct twiData *_data) {
   #endif
 
   _data->_bools._hostEnabled    = 1;
-  _data->_module->MCTRLA        = TWI_ENABLE_bm;  // Master Interrupt flags stay disabled
+  _data->_module->MCTRLA        = TWI_ENABLE_bm | TWI_TIMEOUT_200US_gc;  // Master Interrupt flags stay disabled; a bus
+                                                  // that's gone quiet without a STOP is taken as idle after 200 us
   _data->_module->MSTATUS       = TWI_BUSSTATE_IDLE_gc;
 
   TWI_MasterSetBaud(_data, DEFAULT_FREQUENCY);
@@ -250,6 +251,102 @@ void TWI_MasterSetBaud(struct twiData *_data, uint32_t frequency) {
   }
 }
 
+/**
+ *@brief      TWI_ClockPer returns the frequency of CLK_PER that clocks the TWI
+ *
+ *            On megaTinyCore, that's what setCPUFrequency() left it at, otherwise it's F_CPU.
+ */
+static uint32_t TWI_ClockPer(void) {
+  #if defined(MEGATINYCORE)
+    return getCPUFrequency();
+  #else
+    return F_CPU;
+  #endif
+}
+
+
+/**
+ *@brief      TWI_RiseCycles converts the bus rise time to CLK_PER cycles, rounded
+ */
+static uint16_t TWI_RiseCycles(uint32_t clk, uint16_t rise_ns) {
+  return (((clk / 1000UL) * rise_ns) + 500000UL) / 1000000UL;
+}
+
+
+/**
+ *@brief      TWI_MasterSetBaudRise sets the fastest baud that doesn't exceed frequency, for the given rise time
+ *
+ *            Solves the data sheet formula f_SCL = f_CLK_PER / (10 + 2 * BAUD + f_CLK_PER * t_RISE) exactly,
+ *            for the CLK_PER the TWI is actually running from, and then makes sure the SCL low time is not
+ *            shorter than the minimum of the mode (4.7 us, 1.3 us and 0.5 us at Standard, Fast and Fast Mode
+ *            Plus), since T_LOW = (BAUD + 5) / f_CLK_PER. FMPEN is set for anything over 400 kHz.
+ *            The result depends on the clock, so call it again after changing the CPU clock.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *              _bools._hostEnabled
+ *              _riseTime
+ *              _module
+ *            uint32_t frequency is the desired SCL frequency
+ *            uint16_t rise_ns is the bus rise time in ns, measured, or worked out from the pullup and bus
+ *              capacitance (0.8473 * R * C)
+ *
+ *@return     uint32_t
+ *@retval     the SCL frequency that will result, or 0 if the host isn't enabled
+ */
+uint32_t TWI_MasterSetBaudRise(struct twiData *_data, uint32_t frequency, uint16_t rise_ns) {
+  if (_data->_bools._hostEnabled == 0 || frequency == 0) {
+    return 0;
+  }
+  uint32_t clk  = TWI_ClockPer();
+  uint16_t rise = TWI_RiseCycles(clk, rise_ns);
+  int32_t  baud = (int32_t)(clk / frequency) - 10 - rise;
+  baud = (baud + 1) / 2;                                  // rounded up, as rounding down would be too fast
+  uint16_t low_ns = (frequency > 400000) ? 500 : ((frequency > 100000) ? 1300 : 4700);
+  int32_t  low  = (int32_t)((((clk / 1000UL) * low_ns) + 999999UL) / 1000000UL) - 5;
+  if (baud < low) {
+    baud = low;
+  }
+  if (baud < 1) {
+    baud = 1;
+  } else if (baud > 255) {
+    baud = 255;
+  }
+  _data->_riseTime = rise_ns;
+  TWI_t *module = _data->_module;
+  uint8_t restore = module->MCTRLA;                       // Save the old Master state
+  module->MCTRLA  = 0;                                    // Disable Master
+  module->MBAUD   = (uint8_t) baud;
+  if (frequency > 400000) {
+    module->CTRLA |=  TWI_FMPEN_bm;                       // Enable FastMode+
+  } else {
+    module->CTRLA &= ~TWI_FMPEN_bm;                       // Disable FastMode+
+  }
+  module->MCTRLA  = restore;                              // restore the old register, thus enabling it again
+  module->MSTATUS = TWI_BUSSTATE_IDLE_gc;                 // Force the state machine into Idle according to the data sheet
+  return clk / (10 + 2 * (uint16_t) baud + rise);
+}
+
+
+/**
+ *@brief      TWI_MasterGetFrequency returns the SCL frequency the current baud gives
+ *
+ *            Calculated with the rise time last given to TWI_MasterSetBaudRise(), or TWI_RISE_TIME_DEFAULT
+ *            if there wasn't one, and the current CLK_PER.
+ *
+ *@return     uint32_t
+ *@retval     the SCL frequency in Hz, 0 if the host isn't enabled
+ */
+uint32_t TWI_MasterGetFrequency(struct twiData *_data) {
+  if (_data->_bools._hostEnabled == 0) {
+    return 0;
+  }
+  uint32_t clk = TWI_ClockPer();
+  uint16_t rise = TWI_RiseCycles(clk, _data->_riseTime ? _data->_riseTime : TWI_RISE_TIME_DEFAULT);
+  return clk / (10 + 2 * (uint16_t) _data->_module->MBAUD + rise);
+}
+
+
 /**
  *@brief      TWI_Available returns the amount of bytes that are available to read in the host or client buffer
  *
@@ -312,6 +409,113 @@ uint8_t TWI_Available(struct twiData *_data) {
 }
 
 
+/**
+ *@brief      TWI_TimeoutLoops returns the host timeout, in passes through the polling loop
+ */
+static uint16_t TWI_TimeoutLoops(struct twiData *_data) {
+  return (_data->_timeout == 0) ? TWI_TIMEOUT_DEFAULT : _data->_timeout;
+}
+
+
+/**
+ *@brief      TWI_TimedOut is called by the polling loops when they give up: sets the flag,
+ *              and recovers the bus if that was asked for.
+ */
+static void TWI_TimedOut(struct twiData *_data) {
+  _data->_bools._timedOut = 1;
+  if (_data->_bools._resetOnTimeout) {
+    TWI_RecoverBus(_data);
+  }
+}
+
+
+/**
+ *@brief      TWI_SetTimeout sets the longest the host waits for the bus before giving up on a transaction
+ *
+ *            It's counted in passes through the polling loop, so it's approximate. The wait restarts
+ *            each time a byte goes through, so it limits how long the bus may stall, not how long a
+ *            long transaction may take.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            uint32_t timeout_us is the timeout in microseconds, 0 for the default, limited to
+ *              65535 loop passes (about 52 ms at 20 MHz)
+ *            bool reset_with_timeout runs TWI_RecoverBus() after a timeout
+ *
+ *@return     void
+ */
+void TWI_SetTimeout(struct twiData *_data, uint32_t timeout_us, bool reset_with_timeout) {
+  uint32_t loops = (timeout_us * (F_CPU / 1000000UL)) / TWI_TIMEOUT_LOOP_CYCLES;
+  if (timeout_us != 0 && loops == 0) {
+    loops = 1;
+  } else if (loops > 0xFFFF) {
+    loops = 0xFFFF;
+  }
+  _data->_timeout = loops;
+  _data->_bools._resetOnTimeout = reset_with_timeout;
+}
+
+
+/**
+ *@brief      TWI_RecoverBus frees a bus that a client is holding, by clocking it out of whatever it was doing
+ *
+ *            A client that was reset, or saw a glitch, in the middle of sending a byte, can go on holding
+ *            SDA low forever, waiting for clocks that will never come; the host can't send a START, and
+ *            every transaction times out. The way out (I2C spec, 3.1.16) is to take the pins away from the
+ *            TWI, and toggle SCL until the client lets go of SDA - at most 9 times - then send a STOP.
+ *            The pins are only ever driven low, by setting DIR, as the TWI would.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _module
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS if both lines are high afterwards, TWI_ERR_PULLUP if not
+ */
+uint8_t TWI_RecoverBus(struct twiData *_data) {
+  TWI_t *module = _data->_module;
+  uint8_t sda;
+  uint8_t scl;
+  PORT_t *port;
+  #if defined(TWI1)
+    if (&TWI1 == module) {
+      port = TWI1_HostPins(&sda, &scl);
+    } else
+  #endif
+  {
+    port = TWI0_HostPins(&sda, &scl);
+  }
+  uint8_t mctrla = module->MCTRLA;
+  module->MCTRLA = mctrla & ~TWI_ENABLE_bm;     // The PORT has the pins now
+  port->OUTCLR   = sda | scl;
+  port->DIRCLR   = sda | scl;                   // both released
+  delayMicroseconds(5);
+  for (uint8_t i = 0; i < 9 && !(port->IN & sda); i++) {
+    port->DIRSET = scl;                         // SCL low
+    delayMicroseconds(5);
+    port->DIRCLR = scl;                         // SCL released; the client may stretch it, for a while
+    for (uint16_t wait = 1000; wait && !(port->IN & scl); wait--) {
+      delayMicroseconds(1);
+    }
+    delayMicroseconds(5);
+  }
+  port->DIRSET   = scl;                         // and a STOP: SDA low, SCL high, then SDA high
+  delayMicroseconds(5);
+  port->DIRSET   = sda;
+  delayMicroseconds(5);
+  port->DIRCLR   = scl;
+  delayMicroseconds(5);
+  port->DIRCLR   = sda;
+  delayMicroseconds(5);
+  uint8_t ret    = ((port->IN & (sda | scl)) == (sda | scl)) ? TWI_ERR_SUCCESS : TWI_ERR_PULLUP;
+  module->MCTRLA = mctrla;
+  if (mctrla & TWI_ENABLE_bm) {
+    module->MSTATUS = TWI_BUSSTATE_IDLE_gc;     // we know it's idle - we just sent the STOP
+  }
+  return ret;
+}
+
+
 /**
  *@brief      TWI_MasterWrite performs a host write operation on the TWI bus
  *
@@ -332,7 +536,7 @@ uint8_t TWI_Available(struct twiData *_data) {
  *@retval     amount of bytes that were written. If 0, no write took place, either due
  *            to an error or because of an empty txBuffer
  */
-uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
+HOT_PATH uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
   #if defined(TWI_MERGE_BUFFERS)                              // Same Buffers for tx/rx
     uint8_t* txHead   = &(_data->_trHead);
     uint8_t* txTail   = &(_data->_trTail);
@@ -346,15 +550,23 @@ uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
   TWI_t *module = _data->_module;     // Compiler treats the pointer to the TWI module as volatile and
                                       // creates bloat-y code, this fixes it
   TWI_INIT_ERROR;
+  TWI_STATS_START;
   uint8_t currentSM;
   uint8_t currentStatus;
+  bool addressSent = false;
   uint8_t dataWritten = 0;
   uint16_t timeout = 0;
+  #if defined(TWI_PEC_ENABLED)
+    bool pecSent = false;
+  #endif
 
 
   if ((module->MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_UNKNOWN_gc) {
     return TWI_ERR_UNINIT;                     // If the bus was not initialized, return
   }
+  if (_data->_bools._hostAsync) {
+    return TWI_ERR_BUSY;                       // The host ISR is in the middle of a transaction
+  }
 
 
   while (true) {
@@ -362,7 +574,9 @@ uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
     currentSM = currentStatus & TWI_BUSSTATE_gm;  // get the current mode of the state machine
 
     #if defined(TWI_TIMEOUT_ENABLE)
-      if (++timeout > (F_CPU/1000)) {
+      if (++timeout > TWI_TimeoutLoops(_data)) {
+        TWI_STATS_INC(_data, timeouts);
+        TWI_TimedOut(_data);
         if        (currentSM == TWI_BUSSTATE_OWNER_gc) {
           TWI_SET_ERROR(TWI_ERR_TIMEOUT);
         } else if (currentSM == TWI_BUSSTATE_IDLE_gc) {
@@ -375,27 +589,40 @@ uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
     #endif
 
     if   (currentStatus & (TWI_ARBLOST_bm | TWI_BUSERR_bm)) {     // Check for Bus error
+        TWI_STATS_BUS(_data, currentStatus);
         module->MSTATUS = (TWI_ARBLOST_bm | TWI_BUSERR_bm);       // reset error flags
         TWI_SET_ERROR(TWI_ERR_BUS_ARB);                           // set error flag
         break;                                                    // leave RX loop
     }
 
-    if (currentSM == TWI_BUSSTATE_IDLE_gc) {                      // Bus has not sent START yet and is not BUSY
-        module->MADDR = ADD_WRITE_BIT(_data->_clientAddress);
+    if (!addressSent && (currentSM == TWI_BUSSTATE_IDLE_gc || currentSM == TWI_BUSSTATE_OWNER_gc)) {
+        TWI_PEC_START(_data, ADD_WRITE_BIT(_data->_clientAddress), currentSM == TWI_BUSSTATE_OWNER_gc);
+        module->MADDR = ADD_WRITE_BIT(_data->_clientAddress);   // START, or REPSTART if the bus is still ours
+        addressSent = true;
         timeout = 0;
     } else if (currentSM == TWI_BUSSTATE_OWNER_gc) {              // Address was sent, host is owner
       if     (currentStatus & TWI_WIF_bm) {                       // data sent
         if   (currentStatus & TWI_RXACK_bm) {                     // AND the RXACK bit is set, last byte has failed
+          if (dataWritten == 0) { TWI_STATS_INC(_data, nackAddress); } else { TWI_STATS_INC(_data, nackData); }
           if (dataWritten == 0) TWI_SET_ERROR(TWI_ERR_ACK_ADR);   // if dataWritten is 0, no payload was sent, so address was NACKed
           else                  TWI_SET_ERROR(TWI_ERR_ACK_DAT);   // else payload was NACKed
           break;                                                  // leave loop
         } else {                                                  // otherwise WRITE was ACKed
           if ((*txHead) != (*txTail)) {                           // check if there is data to be written
+            TWI_PEC_ADD(_data, txBuffer[(*txTail)]);
             module->MDATA = txBuffer[(*txTail)];                  // Writing to the register to send data
             (*txTail) = TWI_advancePosition(*txTail);             // advance tail
             dataWritten++;                                        // data was Written
             timeout = 0;                                          // reset timeout
           } else {                                                // else there is no data to be written
+            #if defined(TWI_PEC_ENABLED)
+              if (TWI_PEC_USED(_data) && send_stop && !pecSent) { // the PEC goes after the data, at the end of the transaction
+                module->MDATA = _data->_pec;
+                pecSent = true;
+                timeout = 0;
+                continue;
+              }
+            #endif
             break;                                                // TX finished, leave loop, error is still TWI_NO_ERR
 
           }
@@ -408,6 +635,7 @@ uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
   if ((send_stop != 0) || (TWI_ERR_SUCCESS != TWI_GET_ERROR)) {
     module->MCTRLB = TWI_MCMD_STOP_gc;                        // Send STOP
   }
+  TWI_STATS_END(_data);
   return TWI_GET_ERROR;
 }
 
@@ -434,7 +662,7 @@ uint8_t TWI_MasterWrite(struct twiData *_data, bool send_stop)  {
  *@return     uint8_t
  *@retval     amount of bytes that were actually read. If 0, no read took place due to a bus error
  */
-uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_stop) {
+HOT_PATH uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_stop) {
   #if defined(TWI_MERGE_BUFFERS)                                // Same Buffers for tx/rx
     uint8_t* rxHead   = &(_data->_trHead);
     uint8_t* rxTail   = &(_data->_trTail);
@@ -449,8 +677,15 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
                                       // creates bloat-y code, using a local variable fixes that
 
   TWIR_INIT_ERROR;             // local variable for errors
+  TWI_STATS_START;
   uint8_t dataRead = 0;
-  if ((module->MSTATUS & TWI_BUSSTATE_gm) != TWI_BUSSTATE_UNKNOWN_gc) {
+  bool addressSent = false;
+  #if defined(TWI_PEC_ENABLED)
+    uint8_t rxStart = (*rxHead);               // where the data goes, to take it back out if the PEC is wrong
+  #endif
+  if (_data->_bools._hostAsync) {
+    TWIR_SET_ERROR(TWI_ERR_BUSY);              // The host ISR is in the middle of a transaction
+  } else if ((module->MSTATUS & TWI_BUSSTATE_gm) != TWI_BUSSTATE_UNKNOWN_gc) {
     uint8_t currentSM;
     uint8_t currentStatus;
     uint8_t command  = 0;
@@ -461,7 +696,9 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
       currentSM = currentStatus & TWI_BUSSTATE_gm;  // get the current mode of the state machine
 
       #if defined(TWI_TIMEOUT_ENABLE)
-        if (++timeout > (F_CPU/1000)) {
+        if (++timeout > TWI_TimeoutLoops(_data)) {
+          TWI_STATS_INC(_data, timeouts);
+          TWI_TimedOut(_data);
           if      (currentSM == TWI_BUSSTATE_OWNER_gc) {
             TWIR_SET_ERROR(TWI_ERR_TIMEOUT);
           } else if (currentSM == TWI_BUSSTATE_IDLE_gc) {
@@ -474,6 +711,7 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
       #endif
 
       if (currentStatus & (TWI_ARBLOST_bm | TWI_BUSERR_bm)) {   // Check for Bus error
+          TWI_STATS_BUS(_data, currentStatus);
         module->MSTATUS = (TWI_ARBLOST_bm | TWI_BUSERR_bm);      // reset error flags
         TWIR_SET_ERROR(TWI_ERR_BUS_ARB);                         // set error flag
         break;                                                   // leave TX loop
@@ -487,22 +725,42 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
         }
       }
 
-      if (currentSM == TWI_BUSSTATE_IDLE_gc) {    // Bus has not sent START yet
-          module->MADDR = ADD_READ_BIT(_data->_clientAddress);
+      if (!addressSent && (currentSM == TWI_BUSSTATE_IDLE_gc || currentSM == TWI_BUSSTATE_OWNER_gc)) {
+          TWI_PEC_START(_data, ADD_READ_BIT(_data->_clientAddress), currentSM == TWI_BUSSTATE_OWNER_gc);
+          module->MADDR = ADD_READ_BIT(_data->_clientAddress);  // START, or REPSTART if the bus is still ours
+          addressSent = true;
           timeout = 0;
       } else if (currentSM == TWI_BUSSTATE_OWNER_gc) {  // Address sent, check for WIF/RIF
         if (currentStatus & TWI_RIF_bm) {                    // data received
+          #if defined(TWI_PEC_ENABLED)
+          if (TWI_PEC_USED(_data) && dataRead == bytesToRead) { // all the data is in, this is the PEC
+            if (TWI_PecUpdate(_data->_pec, module->MDATA) != 0) {
+              _data->_pecFlags |= TWI_PEC_FAILED;
+              TWIR_SET_ERROR(TWI_ERR_PEC);
+              (*rxHead) = rxStart;                              // the data can't be trusted, so there is none
+              dataRead = 0;
+            }
+            timeout = 0;
+            if (send_stop != 0) {
+              command = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;       // send STOP + NACK
+            } else {
+              break;
+            }
+            continue;
+          }
+          #endif
           if (dataRead > (BUFFER_LENGTH-1)) {                   // Buffer overflow with this incoming Byte
             TWIR_SET_ERROR(TWI_ERR_BUF_OVERFLOW);
             command = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;         // send STOP + NACK
           } else {
                                                       // Data is fine and we have space, so read out the data register
             rxBuffer[(*rxHead)] = module->MDATA;        // and save it in the Buffer.
+            TWI_PEC_ADD(_data, rxBuffer[(*rxHead)]);
             (*rxHead) = TWI_advancePosition(*rxHead);               // advance head
             dataRead++;                                             // Byte was read
             timeout = 0;                                            // reset timeout
 
-            if (dataRead < bytesToRead) {                           // expecting more bytes, so
+            if (dataRead < bytesToRead || TWI_PEC_USED(_data)) {    // expecting more bytes (or the PEC), so
               module->MCTRLB = TWI_MCMD_RECVTRANS_gc;               // send an ACK so the Slave so it can send the next byte
             } else {                                                // Otherwise,
               if (send_stop != 0) {
@@ -514,6 +772,7 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
           }
         } else if (currentStatus & TWI_WIF_bm) {  // Address NACKed
           TWIR_SET_ERROR(TWI_ERR_RXACK);          // set error flag
+          TWI_STATS_INC(_data, nackAddress);
           command = TWI_MCMD_STOP_gc;
         }
       }
@@ -524,10 +783,790 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
   #if defined(TWI_READ_ERROR_ENABLED) && defined(TWI_ERROR_ENABLED)
     _data->_errors = TWIR_GET_ERROR;                           // save error flags
   #endif
+  TWI_STATS_END(_data);
   return dataRead;
 }
 
 
+/**
+ *@brief      TWI_MasterWriteDirect performs a host write operation on the TWI bus, straight from the caller's buffers
+ *
+ *            The same as TWI_MasterWrite(), except that the data is not copied into the txBuffer first,
+ *            so it is not limited to BUFFER_LENGTH and the txBuffer is left alone. The prefix bytes (a register
+ *            address, usually) are sent first, then the data, in the same transaction.
+ *            If we still own the bus from a write or read without STOP, the address is sent with a REPSTART.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _clientAddress
+ *            const uint8_t *prefix is sent before the data
+ *            uint8_t prefixLength is the number of prefix bytes
+ *            const uint8_t *src is the data to write
+ *            size_t length is the number of bytes to write
+ *            bool send_stop enables the STOP condition at the end of a write
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS, or the error, as TWI_MasterWrite()
+ */
+static uint8_t TWI_MasterWriteDirect(struct twiData *_data, const uint8_t *prefix, uint8_t prefixLength,
+                                     const uint8_t *src, size_t length, bool send_stop) {
+  TWI_t *module = _data->_module;
+  TWI_INIT_ERROR;
+  TWI_STATS_START;
+  uint8_t currentSM;
+  uint8_t currentStatus;
+  bool addressSent = false;
+  size_t dataWritten = 0;
+  uint16_t timeout = 0;
+  #if defined(TWI_PEC_ENABLED)
+    bool pecSent = false;
+  #endif
+  length += prefixLength;
+
+  if ((module->MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_UNKNOWN_gc) {
+    return TWI_ERR_UNINIT;                     // If the bus was not initialized, return
+  }
+  if (_data->_bools._hostAsync) {
+    return TWI_ERR_BUSY;                       // The host ISR is in the middle of a transaction
+  }
+
+  while (true) {
+    currentStatus = module->MSTATUS;
+    currentSM = currentStatus & TWI_BUSSTATE_gm;  // get the current mode of the state machine
+
+    #if defined(TWI_TIMEOUT_ENABLE)
+      if (++timeout > TWI_TimeoutLoops(_data)) {
+        TWI_STATS_INC(_data, timeouts);
+        TWI_TimedOut(_data);
+        if        (currentSM == TWI_BUSSTATE_OWNER_gc) {
+          TWI_SET_ERROR(TWI_ERR_TIMEOUT);
+        } else if (currentSM == TWI_BUSSTATE_IDLE_gc) {
+          TWI_SET_ERROR(TWI_ERR_PULLUP);
+        } else {
+          TWI_SET_ERROR(TWI_ERR_UNDEFINED);
+        }
+        break;
+      }
+    #endif
+
+    if   (currentStatus & (TWI_ARBLOST_bm | TWI_BUSERR_bm)) {     // Check for Bus error
+        TWI_STATS_BUS(_data, currentStatus);
+        module->MSTATUS = (TWI_ARBLOST_bm | TWI_BUSERR_bm);       // reset error flags
+        TWI_SET_ERROR(TWI_ERR_BUS_ARB);                           // set error flag
+        break;                                                    // leave RX loop
+    }
+
+    if (!addressSent && (currentSM == TWI_BUSSTATE_IDLE_gc || currentSM == TWI_BUSSTATE_OWNER_gc)) {
+        TWI_PEC_START(_data, ADD_WRITE_BIT(_data->_clientAddress), currentSM == TWI_BUSSTATE_OWNER_gc);
+        module->MADDR = ADD_WRITE_BIT(_data->_clientAddress);   // START, or REPSTART if the bus is still ours
+        addressSent = true;
+        timeout = 0;
+    } else if (currentSM == TWI_BUSSTATE_OWNER_gc) {              // Address was sent, host is owner
+      if     (currentStatus & TWI_WIF_bm) {                       // data sent
+        if   (currentStatus & TWI_RXACK_bm) {                     // AND the RXACK bit is set, last byte has failed
+          if (dataWritten == 0) { TWI_STATS_INC(_data, nackAddress); } else { TWI_STATS_INC(_data, nackData); }
+          if (dataWritten == 0) TWI_SET_ERROR(TWI_ERR_ACK_ADR);   // if dataWritten is 0, no payload was sent, so address was NACKed
+          else                  TWI_SET_ERROR(TWI_ERR_ACK_DAT);   // else payload was NACKed
+          break;                                                  // leave loop
+        } else if (dataWritten < length) {                        // WRITE was ACKed, and there is more to write
+          uint8_t data = (dataWritten < prefixLength) ? prefix[dataWritten] : src[dataWritten - prefixLength];
+          TWI_PEC_ADD(_data, data);
+          module->MDATA = data;
+          dataWritten++;
+          timeout = 0;
+        } else {
+          #if defined(TWI_PEC_ENABLED)
+            if (TWI_PEC_USED(_data) && send_stop && !pecSent) {   // the PEC goes after the data, at the end of the transaction
+              module->MDATA = _data->_pec;
+              pecSent = true;
+              timeout = 0;
+              continue;
+            }
+          #endif
+          break;                                                  // TX finished, leave loop, error is still TWI_NO_ERR
+        }
+      }
+    }
+  }
+
+  if ((send_stop != 0) || (TWI_ERR_SUCCESS != TWI_GET_ERROR)) {
+    module->MCTRLB = TWI_MCMD_STOP_gc;                        // Send STOP
+  }
+  TWI_STATS_END(_data);
+  return TWI_GET_ERROR;
+}
+
+
+/**
+ *@brief      TWI_MasterWriteFrom performs a host write operation on the TWI bus, straight from the caller's buffer
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            const uint8_t *src is the data to write
+ *            size_t length is the number of bytes to write
+ *            bool send_stop enables the STOP condition at the end of a write
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS, or the error, as TWI_MasterWrite()
+ */
+uint8_t TWI_MasterWriteFrom(struct twiData *_data, const uint8_t *src, size_t length, bool send_stop) {
+  return TWI_MasterWriteDirect(_data, NULL, 0, src, length, send_stop);
+}
+
+
+/**
+ *@brief      TWI_MasterReadInto performs a host read operation on the TWI bus, straight into the caller's buffer
+ *
+ *            The same as TWI_MasterRead(), except that the data is not put in the rxBuffer, so it is not limited
+ *            to BUFFER_LENGTH, and available()/read() are not affected.
+ *            If we still own the bus from a write or read without STOP, the address is sent with a REPSTART.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _clientAddress
+ *            uint8_t *dst is where the data goes
+ *            size_t length is the number of bytes to read. When they have been read, a NACK is issued.
+ *            bool send_stop enables the STOP condition at the end of the read
+ *
+ *@return     size_t
+ *@retval     amount of bytes that were actually read. If 0, no read took place due to a bus error
+ */
+size_t TWI_MasterReadInto(struct twiData *_data, uint8_t *dst, size_t length, bool send_stop) {
+  TWI_t *module = _data->_module;
+  TWIR_INIT_ERROR;
+  TWI_STATS_START;
+  bool addressSent = false;
+  size_t dataRead = 0;
+  if (length == 0) {
+    return 0;
+  }
+  if (_data->_bools._hostAsync) {
+    TWIR_SET_ERROR(TWI_ERR_BUSY);              // The host ISR is in the middle of a transaction
+  } else if ((module->MSTATUS & TWI_BUSSTATE_gm) != TWI_BUSSTATE_UNKNOWN_gc) {
+    uint8_t currentSM;
+    uint8_t currentStatus;
+    uint8_t command  = 0;
+    uint16_t timeout = 0;
+
+    while (true) {
+      currentStatus = module->MSTATUS;
+      currentSM = currentStatus & TWI_BUSSTATE_gm;  // get the current mode of the state machine
+
+      #if defined(TWI_TIMEOUT_ENABLE)
+        if (++timeout > TWI_TimeoutLoops(_data)) {
+          TWI_STATS_INC(_data, timeouts);
+          TWI_TimedOut(_data);
+          if      (currentSM == TWI_BUSSTATE_OWNER_gc) {
+            TWIR_SET_ERROR(TWI_ERR_TIMEOUT);
+          } else if (currentSM == TWI_BUSSTATE_IDLE_gc) {
+            TWIR_SET_ERROR(TWI_ERR_PULLUP);
+          } else {
+            TWIR_SET_ERROR(TWI_ERR_UNDEFINED);
+          }
+          break;
+        }
+      #endif
+
+      if (currentStatus & (TWI_ARBLOST_bm | TWI_BUSERR_bm)) {   // Check for Bus error
+          TWI_STATS_BUS(_data, currentStatus);
+        module->MSTATUS = (TWI_ARBLOST_bm | TWI_BUSERR_bm);      // reset error flags
+        TWIR_SET_ERROR(TWI_ERR_BUS_ARB);                         // set error flag
+        break;                                                   // leave TX loop
+      }
+
+      if (command != 0) {
+        if (currentSM == TWI_BUSSTATE_OWNER_gc) {
+          module->MCTRLB = command;
+        } else {
+          break;
+        }
+      }
+
+      if (!addressSent && (currentSM == TWI_BUSSTATE_IDLE_gc || currentSM == TWI_BUSSTATE_OWNER_gc)) {
+          TWI_PEC_START(_data, ADD_READ_BIT(_data->_clientAddress), currentSM == TWI_BUSSTATE_OWNER_gc);
+          module->MADDR = ADD_READ_BIT(_data->_clientAddress);  // START, or REPSTART if the bus is still ours
+          addressSent = true;
+          timeout = 0;
+      } else if (currentSM == TWI_BUSSTATE_OWNER_gc) {  // Address sent, check for WIF/RIF
+        if (currentStatus & TWI_RIF_bm) {               // data received
+          #if defined(TWI_PEC_ENABLED)
+          if (TWI_PEC_USED(_data) && dataRead == length) {  // all the data is in, this is the PEC
+            if (TWI_PecUpdate(_data->_pec, module->MDATA) != 0) {
+              _data->_pecFlags |= TWI_PEC_FAILED;
+              TWIR_SET_ERROR(TWI_ERR_PEC);
+              dataRead = 0;                             // the data can't be trusted
+            }
+            timeout = 0;
+            if (send_stop != 0) {
+              command = TWI_ACKACT_bm | TWI_MCMD_STOP_gc; // send STOP + NACK
+            } else {
+              break;
+            }
+            continue;
+          }
+          #endif
+          dst[dataRead] = module->MDATA;
+          TWI_PEC_ADD(_data, dst[dataRead]);
+          dataRead++;
+          timeout = 0;
+          if (dataRead < length || TWI_PEC_USED(_data)) {   // expecting more bytes (or the PEC), so
+            module->MCTRLB = TWI_MCMD_RECVTRANS_gc;     // send an ACK so the Slave so it can send the next byte
+          } else if (send_stop != 0) {
+            command = TWI_ACKACT_bm | TWI_MCMD_STOP_gc; // send STOP + NACK
+          } else {
+            break;
+          }
+        } else if (currentStatus & TWI_WIF_bm) {        // Address NACKed
+          TWIR_SET_ERROR(TWI_ERR_ACK_ADR);              // set error flag
+          TWI_STATS_INC(_data, nackAddress);
+          command = TWI_MCMD_STOP_gc;
+        }
+      }
+    }
+  } else {
+    TWIR_SET_ERROR(TWI_ERR_UNINIT);
+  }
+  #if defined(TWI_READ_ERROR_ENABLED) && defined(TWI_ERROR_ENABLED)
+    _data->_errors = TWIR_GET_ERROR;                           // save error flags
+  #endif
+  TWI_STATS_END(_data);
+  return dataRead;
+}
+
+
+/**
+ *@brief      TWI_MasterWriteRegisters writes to consecutive registers of a client: the register address,
+ *              then the data, in one write transaction with a STOP at the end.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            uint16_t reg is the first register
+ *            uint8_t regLength is 1 for 8-bit register addresses, 2 for 16-bit ones (sent high byte first)
+ *            const uint8_t *src is the data to write
+ *            size_t length is the number of bytes to write
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS, or the error, as TWI_MasterWrite()
+ */
+uint8_t TWI_MasterWriteRegisters(struct twiData *_data, uint16_t reg, uint8_t regLength, const uint8_t *src, size_t length) {
+  uint8_t regBytes[2] = {(uint8_t)(reg >> 8), (uint8_t) reg};
+  return TWI_MasterWriteDirect(_data, &regBytes[2 - regLength], regLength, src, length, true);
+}
+
+
+/**
+ *@brief      TWI_MasterReadRegisters reads consecutive registers of a client: writes the register address,
+ *              then reads the data after a REPSTART, with a STOP at the end.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            uint16_t reg is the first register
+ *            uint8_t regLength is 1 for 8-bit register addresses, 2 for 16-bit ones (sent high byte first)
+ *            uint8_t *dst is where the data goes
+ *            size_t length is the number of bytes to read
+ *
+ *@return     size_t
+ *@retval     amount of bytes that were read; 0 if the register address was not accepted
+ */
+size_t TWI_MasterReadRegisters(struct twiData *_data, uint16_t reg, uint8_t regLength, uint8_t *dst, size_t length) {
+  uint8_t regBytes[2] = {(uint8_t)(reg >> 8), (uint8_t) reg};
+  if (TWI_MasterWriteDirect(_data, &regBytes[2 - regLength], regLength, NULL, 0, false) != TWI_ERR_SUCCESS) {
+    return 0;                                                   // and the STOP has been sent
+  }
+  return TWI_MasterReadInto(_data, dst, length, true);
+}
+
+
+#if defined(TWI_STATS_ENABLED)
+/**
+ *@brief      TWI_StatsBus counts the bus errors and lost arbitrations in a host status
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            uint8_t status is MSTATUS with ARBLOST and/or BUSERR set
+ *
+ *@return     void
+ */
+void TWI_StatsBus(struct twiData *_data, uint8_t status) {
+  if (status & TWI_ARBLOST_bm) {
+    _data->_stats.arbitrationLost++;
+  }
+  if (status & TWI_BUSERR_bm) {
+    _data->_stats.busErrors++;
+  }
+}
+
+
+/**
+ *@brief      TWI_StatsEnd counts a host transaction, and how long it took
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            uint32_t start is micros() when it started
+ *
+ *@return     void
+ */
+void TWI_StatsEnd(struct twiData *_data, uint32_t start) {
+  #if defined(MILLIS_USE_TIMERNONE)
+    uint32_t took = 0;
+    (void) start;
+  #else
+    uint32_t took = micros() - start;
+  #endif
+  _data->_stats.transactions++;
+  _data->_stats.lastMicros   = took;
+  _data->_stats.totalMicros += took;
+  if (took > _data->_stats.maxMicros) {
+    _data->_stats.maxMicros  = took;
+  }
+}
+
+
+/**
+ *@brief      TWI_GetStats copies the statistics, with interrupts off so they are consistent, and
+ *              optionally clears them
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            struct twiStats *copy is where they go, or NULL to just reset them
+ *            bool reset clears them
+ *
+ *@return     void
+ */
+void TWI_GetStats(struct twiData *_data, struct twiStats *copy, bool reset) {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (copy != NULL) {
+    *copy = _data->_stats;
+  }
+  if (reset) {
+    memset(&(_data->_stats), 0, sizeof(struct twiStats));
+  }
+  SREG = oldSREG;
+}
+#endif
+
+
+#if defined(TWI_PEC_ENABLED)
+/* SMBus PEC is a CRC-8 with polynomial x^8 + x^2 + x + 1, done a nibble at a time so the table is 16 bytes, not 256 */
+static const uint8_t TWI_PecTable[16] = {   // const is enough: it stays in the mapped flash
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+/**
+ *@brief      TWI_PecUpdate adds a byte to a running SMBus PEC
+ *
+ *            The PEC covers every byte of the transaction, address bytes (with the R/W bit) included,
+ *            starting from 0. A message followed by its correct PEC gives 0.
+ *
+ *@param      uint8_t crc is the PEC so far
+ *            uint8_t data is the next byte
+ *
+ *@return     uint8_t
+ *@retval     the PEC with the byte added
+ */
+uint8_t TWI_PecUpdate(uint8_t crc, uint8_t data) {
+  crc ^= data;
+  crc = (uint8_t)(crc << 4) ^ TWI_PecTable[crc >> 4];
+  crc = (uint8_t)(crc << 4) ^ TWI_PecTable[crc >> 4];
+  return crc;
+}
+
+
+/**
+ *@brief      TWI_SetPEC turns SMBus packet error checking on or off, for host and client
+ *
+ *            When on, the polled host writes send the PEC after the data when they end with a STOP, and
+ *            the polled reads read one more byte, the PEC, and check it; the PEC runs on across a REPSTART,
+ *            so a write without STOP followed by a read is checked as one SMBus transaction. The client
+ *            checks and drops the PEC at the end of a host write, and sends one after its data to a host read.
+ *            Data with a wrong PEC is thrown away, and TWI_PecFailed() reports it.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            bool enable
+ *
+ *@return     void
+ */
+void TWI_SetPEC(struct twiData *_data, bool enable) {
+  uint8_t oldSREG = SREG;
+  cli();
+  _data->_pecFlags = enable ? TWI_PEC_ON : 0;
+  SREG = oldSREG;
+}
+
+
+/**
+ *@brief      TWI_PecFailed tells if a PEC was wrong since it was last called, and clears that
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *
+ *@return     bool
+ *@retval     true if data was thrown away because its PEC was wrong
+ */
+bool TWI_PecFailed(struct twiData *_data) {
+  uint8_t oldSREG = SREG;
+  cli();
+  bool failed = _data->_pecFlags & TWI_PEC_FAILED;
+  _data->_pecFlags &= ~TWI_PEC_FAILED;
+  SREG = oldSREG;
+  return failed;
+}
+
+
+/* The client was addressed: a write starts a new PEC, a read carries on from the write before it, if it had no STOP */
+static void TWI_PecClientAddress(struct twiData *_data, uint8_t address) {
+  uint8_t flags = _data->_pecFlags;
+  if (address & 0x01) {
+    _data->_pec = TWI_PecUpdate((flags & TWI_PEC_CLIENT_WRITE) ? _data->_pec : 0, address);
+    flags &= ~(TWI_PEC_CLIENT_WRITE | TWI_PEC_CLIENT_SENT);
+  } else {
+    _data->_pec = TWI_PecUpdate(0, address);
+    flags |= TWI_PEC_CLIENT_WRITE;
+  }
+  _data->_pecFlags = flags;
+}
+
+
+/* A host write to the client has ended with a STOP: its last byte is the PEC - check it, and take it out of the data */
+static void TWI_PecClientStop(struct twiData *_data) {
+  #if defined(TWI_MANDS)
+    uint8_t* rxHead   = &(_data->_trHeadS);
+    uint8_t* rxTail   = &(_data->_trTailS);
+  #elif defined(TWI_MERGE_BUFFERS)
+    uint8_t* rxHead   = &(_data->_trHead);
+    uint8_t* rxTail   = &(_data->_trTail);
+  #else
+    uint8_t* rxHead   = &(_data->_rxHead);
+    uint8_t* rxTail   = &(_data->_rxTail);
+  #endif
+  uint8_t flags = _data->_pecFlags;
+  if ((flags & TWI_PEC_CLIENT_WRITE) && (*rxHead) != (*rxTail)) {
+    if (_data->_pec == 0) {
+      (*rxHead) = ((*rxHead) == 0 ? BUFFER_LENGTH : (*rxHead)) - 1;
+    } else {
+      (*rxTail) = (*rxHead);                    // the data can't be trusted, so there is none
+      flags |= TWI_PEC_FAILED;
+    }
+  }
+  _data->_pecFlags = flags & ~TWI_PEC_CLIENT_WRITE;
+}
+#endif
+
+
+#define TWI_REGFILE_POINTER   0x01  // _state: the next byte written is the register pointer
+#define TWI_REGFILE_NOTIFY    0x02  // _state: a register in notify was written
+
+/**
+ *@brief      TWI_SetRegisterFile makes the client serve a register map from the ISR, instead of the buffers
+ *
+ *            A host write sets the register pointer with its first byte, and the following ones are stored
+ *            in consecutive registers - if writable, otherwise they are ACKed and dropped. A host read returns
+ *            consecutive registers from the pointer. The pointer wraps after the last register, and stays
+ *            where it was left between transactions, so a write of just the pointer, then a read, reads from it.
+ *            Nothing is called per byte, so the client never stretches the clock waiting for the sketch;
+ *            onWrite is only called, once, at the STOP or REPSTART after a write that changed a notify register.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            struct twiRegisterFile *file is the register map, or NULL for the buffers and onReceive/onRequest
+ *
+ *@return     void
+ */
+void TWI_SetRegisterFile(struct twiData *_data, struct twiRegisterFile *file) {
+  if (file != NULL) {
+    file->_state = TWI_REGFILE_POINTER;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _data->_regFile    = file;
+  _data->_addrMap    = NULL;
+  _data->_clientBufs = NULL;
+  SREG = oldSREG;
+}
+
+
+/**
+ *@brief      TWI_SetAddressMap makes the client answer several addresses, each with a register file of its own
+ *
+ *            Each entry is served as by TWI_SetRegisterFile(), with its own pointer, so one part can stand in
+ *            for several devices. The hardware gets the first address in SADDR, and in SADDRMASK either the
+ *            second address (with two entries) or a mask of every bit the addresses differ in, so it matches
+ *            them all; at the address match, the ISR looks the address up and picks that entry's file, or
+ *            NACKs it if it isn't in the map (it matched the mask, but isn't one of ours). That takes one pass
+ *            over the map, so keep the entries you want answered fastest first. Sets up and enables the client
+ *            if begin() hadn't. The sketch never has to look at the address itself.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            const struct twiAddressMap *map is the address table, which must stay valid, or NULL to go back
+ *              to the buffers and onReceive/onRequest (the hardware keeps the addresses of the map).
+ *            uint8_t count is the number of entries, 1-255
+ *
+ *@return     void
+ */
+void TWI_SetAddressMap(struct twiData *_data, const struct twiAddressMap *map, uint8_t count) {
+  if (map == NULL || count == 0) {
+    TWI_SetRegisterFile(_data, NULL);
+    return;
+  }
+  uint8_t address = map[0].address;
+  uint8_t differ  = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    map[i].file->_state = TWI_REGFILE_POINTER;
+    differ |= map[i].address ^ address;
+  }
+  uint8_t addrmask = (count == 2) ? ((map[1].address << 1) | 0x01) : (differ << 1);  // exact, or masked
+  uint8_t oldSREG = SREG;
+  cli();
+  _data->_regFile      = map[0].file;
+  _data->_addrMap      = map;
+  _data->_addrMapCount = count;
+  _data->_clientBufs   = NULL;
+  SREG = oldSREG;
+  TWI_SlaveInit(_data, address, 0, addrmask); // does nothing if already enabled, so write them either way
+  _data->_module->SADDR     = address << 1;
+  _data->_module->SADDRMASK = addrmask;
+}
+
+
+/**
+ *@brief      TWI_AddressMapFind returns the register file for a 7-bit address, or NULL if it isn't in the map
+ */
+static struct twiRegisterFile *TWI_AddressMapFind(struct twiData *_data, uint8_t address) {
+  const struct twiAddressMap *entry = _data->_addrMap;
+  for (uint8_t i = _data->_addrMapCount; i != 0; i--, entry++) {
+    if (entry->address == address) {
+      return entry->file;
+    }
+  }
+  return NULL;
+}
+
+
+/**
+ *@brief      TWI_RegisterFileMask checks whether the bit for a register is set in the notify bitmap
+ */
+static bool TWI_RegisterFileMask(const uint8_t *mask, uint8_t reg) {
+  return mask[reg >> 3] & (1 << (reg & 0x07));
+}
+
+
+/**
+ *@brief      TWI_RegisterFileEnd calls onWrite if the write that just ended changed a notify register
+ */
+static void TWI_RegisterFileEnd(struct twiRegisterFile *file) {
+  if ((file->_state & TWI_REGFILE_NOTIFY) && file->onWrite != NULL) {
+    file->onWrite(file->_first, file->_count);
+  }
+  file->_state = TWI_REGFILE_POINTER;
+}
+
+
+/**
+ *@brief      SlaveIRQ_RegisterFile is TWI_HandleSlaveIRQ when a register file is set
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _regFile
+ *                _addrMap, _addrMapCount
+ *                _incomingAddress/_clientAddress
+ *                _slaveBytesRead
+ *            uint8_t clientStatus is the SSTATUS that caused the interrupt
+ *
+ *@return     void
+ */
+static void SlaveIRQ_RegisterFile(struct twiData *_data, uint8_t clientStatus) {
+  TWI_t *module = _data->_module;
+  struct twiRegisterFile *file = _data->_regFile;
+
+  if (clientStatus & (TWI_BUSERR_bm | TWI_COLL_bm)) {   // if Bus error/Collision was detected
+    module->SDATA;                                      // Read data to remove Status flags
+    file->_state = TWI_REGFILE_POINTER;                 // Abort; whatever was written stays written
+  } else if (clientStatus & TWI_APIF_bm) {              // Address/Stop Bit set
+    TWI_RegisterFileEnd(file);                          // STOP or REPSTART: the write, if there was one, is over
+    if (clientStatus & TWI_AP_bm) {
+      uint8_t address = module->SDATA;
+      #if defined(TWI_MANDS)
+        _data->_incomingAddress = address;              // for getIncomingAddress()
+      #else
+        _data->_clientAddress   = address;
+      #endif
+      if (_data->_addrMap != NULL) {                    // several devices: pick the one addressed
+        file = TWI_AddressMapFind(_data, address >> 1);
+        if (file == NULL) {
+          module->SCTRLB = TWI_ACKACT_bm | TWI_SCMD_COMPTRANS_gc;   // matched the mask, but not ours: NACK it
+          return;
+        }
+        _data->_regFile = file;
+      }
+      _data->_bools._ackMatters = false;
+      module->SCTRLB = TWI_SCMD_RESPONSE_gc;            // ACK the address
+    } else {
+      module->SSTATUS = TWI_APIF_bm;                    // Clear Flag, no further action needed
+    }
+  } else if (clientStatus & TWI_DIF_bm) {               // Data bit set
+    uint8_t reg = file->pointer;
+    if (clientStatus & TWI_DIR_bm) {                    // Master is reading
+      if ((clientStatus & TWI_RXACK_bm) && _data->_bools._ackMatters) {
+        _data->_bools._ackMatters = false;              // the host NACKed the last byte: done
+        module->SCTRLB = TWI_SCMD_COMPTRANS_gc;
+      } else {
+        _data->_bools._ackMatters = true;
+        _data->_slaveBytesRead++;
+        module->SDATA = (reg < file->size) ? file->registers[reg] : 0xFF;
+        file->pointer = (reg + 1 < file->size) ? reg + 1 : 0;
+        module->SCTRLB = TWI_SCMD_RESPONSE_gc;
+      }
+    } else {                                            // Master is writing
+      uint8_t payload = module->SDATA;
+      if (file->_state & TWI_REGFILE_POINTER) {
+        if (payload >= file->size) {                    // no such register
+          module->SCTRLB = TWI_ACKACT_bm | TWI_SCMD_COMPTRANS_gc;   // NACK it
+          return;
+        }
+        file->pointer = payload;
+        file->_first  = payload;
+        file->_count  = 0;
+        file->_state  = 0;
+      } else {
+        uint8_t mask = (file->writable == NULL) ? 0xFF : file->writable[reg];
+        if (mask) {
+          file->registers[reg] = (file->registers[reg] & ~mask) | (payload & mask);
+          if (file->notify != NULL && TWI_RegisterFileMask(file->notify, reg)) {
+            file->_state |= TWI_REGFILE_NOTIFY;
+          }
+        }
+        file->_count++;
+        file->pointer = (reg + 1 < file->size) ? reg + 1 : 0;
+      }
+      module->SCTRLB = TWI_SCMD_RESPONSE_gc;            // ACK, and on to the next byte
+    }
+  }
+}
+
+
+#define TWI_CLIENTBUF_WRITE   0x01  // _state: the host is writing to us
+#define TWI_CLIENTBUF_READ    0x02  // _state: the host is reading from us
+
+/**
+ *@brief      TWI_SetClientBuffers makes the client use the caller's buffers, independent of the host side
+ *
+ *            Host writes to us are stored in rxBuffer, host reads are served from txBuffer, both from the
+ *            start each time, by the client ISR. Neither the Wire buffers nor onReceive/onRequest are used,
+ *            so the host side - polled, async or runTransactions() - can go on with its own buffers at the
+ *            same time. onDone is called from the ISR once each transaction has ended, at the STOP, the
+ *            REPSTART, or the host's NACK of the last byte it reads; it may point the struct at other
+ *            buffers for the next one. Replaces a register file, if one was set.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            struct twiClientBuffers *bufs are the buffers, or NULL for the Wire buffers and onReceive/onRequest
+ *
+ *@return     void
+ */
+void TWI_SetClientBuffers(struct twiData *_data, struct twiClientBuffers *bufs) {
+  if (bufs != NULL) {
+    bufs->_state = 0;
+  }
+  uint8_t oldSREG = SREG;
+  cli();
+  _data->_clientBufs = bufs;
+  _data->_regFile    = NULL;
+  _data->_addrMap    = NULL;
+  SREG = oldSREG;
+}
+
+
+/**
+ *@brief      TWI_ClientBuffersEnd calls onDone if a transaction was in progress
+ */
+static void TWI_ClientBuffersEnd(struct twiClientBuffers *bufs) {
+  uint8_t state = bufs->_state;
+  bufs->_state = 0;
+  if (state != 0 && bufs->onDone != NULL) {
+    if (state == TWI_CLIENTBUF_READ) {
+      bufs->onDone(true,  bufs->txCount);
+    } else {
+      bufs->onDone(false, bufs->rxCount);
+    }
+  }
+}
+
+
+/**
+ *@brief      SlaveIRQ_ClientBuffers is TWI_HandleSlaveIRQ when client buffers are set
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _clientBufs
+ *                _incomingAddress/_clientAddress
+ *                _slaveBytesRead
+ *            uint8_t clientStatus is the SSTATUS that caused the interrupt
+ *
+ *@return     void
+ */
+static void SlaveIRQ_ClientBuffers(struct twiData *_data, uint8_t clientStatus) {
+  TWI_t *module = _data->_module;
+  struct twiClientBuffers *bufs = _data->_clientBufs;
+
+  if (clientStatus & (TWI_BUSERR_bm | TWI_COLL_bm)) {   // if Bus error/Collision was detected
+    module->SDATA;                                      // Read data to remove Status flags
+    bufs->_state = 0;                                   // Abort, without calling back
+  } else if (clientStatus & TWI_APIF_bm) {              // Address/Stop Bit set
+    TWI_ClientBuffersEnd(bufs);                         // STOP or REPSTART: the transaction before it, if any, is over
+    if (clientStatus & TWI_AP_bm) {
+      #if defined(TWI_MANDS)
+        _data->_incomingAddress = module->SDATA;        // for getIncomingAddress()
+      #else
+        _data->_clientAddress   = module->SDATA;
+      #endif
+      _data->_bools._ackMatters = false;
+      if (clientStatus & TWI_DIR_bm) {
+        bufs->txCount = 0;
+        bufs->_state  = TWI_CLIENTBUF_READ;
+      } else {
+        bufs->rxCount = 0;
+        bufs->_state  = TWI_CLIENTBUF_WRITE;
+      }
+      module->SCTRLB = TWI_SCMD_RESPONSE_gc;            // ACK the address
+    } else {
+      module->SSTATUS = TWI_APIF_bm;                    // Clear Flag, no further action needed
+    }
+  } else if (clientStatus & TWI_DIF_bm) {               // Data bit set
+    if (clientStatus & TWI_DIR_bm) {                    // Master is reading
+      if ((clientStatus & TWI_RXACK_bm) && _data->_bools._ackMatters) {
+        _data->_bools._ackMatters = false;              // the host NACKed the last byte: done
+        module->SCTRLB = TWI_SCMD_COMPTRANS_gc;
+        TWI_ClientBuffersEnd(bufs);
+      } else {
+        uint8_t count = bufs->txCount;
+        _data->_bools._ackMatters = true;
+        _data->_slaveBytesRead++;
+        if (count < bufs->txLength) {
+          module->SDATA = bufs->txBuffer[count];
+          bufs->txCount = count + 1;
+        } else {
+          module->SDATA = 0xFF;                         // nothing more to send
+        }
+        module->SCTRLB = TWI_SCMD_RESPONSE_gc;
+      }
+    } else {                                            // Master is writing
+      uint8_t payload = module->SDATA;
+      uint8_t count = bufs->rxCount;
+      if (count < bufs->rxLength) {
+        bufs->rxBuffer[count] = payload;
+        bufs->rxCount = count + 1;
+        module->SCTRLB = TWI_SCMD_RESPONSE_gc;          // ACK, and on to the next byte
+      } else {
+        module->SCTRLB = TWI_ACKACT_bm | TWI_SCMD_COMPTRANS_gc;   // full: NACK it
+      }
+    }
+  }
+}
+
+
 /**
  *@brief      TWI_HandleSlaveIRQ checks the status register and decides the next action based on that
  *
@@ -555,7 +1594,7 @@ uint8_t TWI_MasterRead(struct twiData *_data, uint8_t bytesToRead, bool send_sto
  *
  *@return     void
  */
-void TWI_HandleSlaveIRQ(struct twiData *_data) {
+HOT_PATH void TWI_HandleSlaveIRQ(struct twiData *_data) {
   #if defined(TWI_MANDS)                            // Master and Slave split
     uint8_t* txHead   = &(_data->_trHeadS);
     uint8_t* txTail   = &(_data->_trTailS);
@@ -578,6 +1617,21 @@ void TWI_HandleSlaveIRQ(struct twiData *_data) {
 
   uint8_t clientStatus = _data->_module->SSTATUS;
 
+  #if defined(TWI_STATS_ENABLED)
+    if (clientStatus & (TWI_BUSERR_bm | TWI_COLL_bm)) {
+      _data->_stats.clientErrors++;
+    } else if ((clientStatus & (TWI_APIF_bm | TWI_AP_bm)) == (TWI_APIF_bm | TWI_AP_bm)) {
+      _data->_stats.clientTransactions++;             // counts a REPSTART to us again
+    }
+  #endif
+  if (_data->_regFile != NULL) {                      // serving a register file instead of the buffers
+    SlaveIRQ_RegisterFile(_data, clientStatus);
+    return;
+  }
+  if (_data->_clientBufs != NULL) {                   // serving the caller's buffers instead of ours
+    SlaveIRQ_ClientBuffers(_data, clientStatus);
+    return;
+  }
   if (clientStatus & (TWI_BUSERR_bm | TWI_COLL_bm)) {  // if Bus error/Collision was detected
     _data->_module->SDATA;                            // Read data to remove Status flags
     (*rxTail) = (*rxHead);                          // Abort
@@ -650,6 +1704,11 @@ void SlaveIRQ_AddrRead(struct twiData *_data) {
 
 
   (*address) = _data->_module->SDATA;         // saving address to pass to the user function
+  #if defined(TWI_PEC_ENABLED)
+    if (TWI_PEC_USED(_data)) {
+      TWI_PecClientAddress(_data, *address);
+    }
+  #endif
                                               // There is no way to identify a REPSTART, so when a Master Read occurs after a host write
   NotifyUser_onReceive(_data);                // Notify user program "onReceive" if necessary
   #if !defined(TWI_MERGE_BUFFERS)             // if not single Buffer operation
@@ -675,6 +1734,11 @@ void SlaveIRQ_AddrWrite(struct twiData *_data) {
 
 
   (*address) = _data->_module->SDATA;
+  #if defined(TWI_PEC_ENABLED)
+    if (TWI_PEC_USED(_data)) {
+      TWI_PecClientAddress(_data, *address);
+    }
+  #endif
   #if defined(TWI_MERGE_BUFFERS) || defined(TWI_MANDS)  // if single Buffer operation
     (*rxTail) = (*rxHead);                    // reset buffer positions so the host can start writing at zero.
   #endif
@@ -697,6 +1761,11 @@ void SlaveIRQ_Stop(struct twiData *_data) {
 
 
   _data->_module->SSTATUS = TWI_APIF_bm;      // Clear Flag, no further action needed
+  #if defined(TWI_PEC_ENABLED)
+    if (TWI_PEC_USED(_data)) {
+      TWI_PecClientStop(_data);               // check and drop the PEC before the user sees the data
+    }
+  #endif
   NotifyUser_onReceive(_data);                // Notify user program "onReceive" if necessary
   (*rxTail) = (*rxHead);                      // User should have handled all data, if not, set available rxBytes to 0
 }
@@ -721,7 +1790,7 @@ void SlaveIRQ_DataReadNack(struct twiData *_data) {
   (*txTail) = (*txHead);                            // Abort further data writes
 }
 
-void SlaveIRQ_DataReadAck(struct twiData *_data) {
+HOT_PATH void SlaveIRQ_DataReadAck(struct twiData *_data) {
   #if defined(TWI_MANDS)                            // Master and Slave split
     uint8_t* txHead   = &(_data->_trHeadS);
     uint8_t* txTail   = &(_data->_trTailS);
@@ -742,16 +1811,23 @@ void SlaveIRQ_DataReadAck(struct twiData *_data) {
   _data->_bools._ackMatters = true;         // start checking for NACK
   if ((*txHead) != (*txTail)) {             // Data is available
     _data->_slaveBytesRead++;
+    TWI_PEC_ADD(_data, txBuffer[(*txTail)]);
     _data->_module->SDATA = txBuffer[(*txTail)];      // Writing to the register to send data
     (*txTail) = TWI_advancePosition(*txTail);         // Advance tail
     _data->_module->SCTRLB = TWI_SCMD_RESPONSE_gc;    // "Execute a byte read operation followed by Acknowledge Action"
 
+  #if defined(TWI_PEC_ENABLED)
+  } else if (TWI_PEC_USED(_data) && !(_data->_pecFlags & TWI_PEC_CLIENT_SENT)) {  // the data is out, the PEC follows
+    _data->_pecFlags |= TWI_PEC_CLIENT_SENT;
+    _data->_module->SDATA = _data->_pec;
+    _data->_module->SCTRLB = TWI_SCMD_RESPONSE_gc;
+  #endif
   } else {                                            // No more data available
     _data->_module->SCTRLB = TWI_SCMD_COMPTRANS_gc;   // "Wait for any Start (S/Sr) condition"
   }
 }
 
-void SlaveIRQ_DataWrite(struct twiData *_data) {
+HOT_PATH void SlaveIRQ_DataWrite(struct twiData *_data) {
   #if defined(TWI_MANDS)                            // Master and Slave split
       uint8_t* rxHead   = &(_data->_trHeadS);
       uint8_t* rxTail   = &(_data->_trTailS);
@@ -778,6 +1854,7 @@ void SlaveIRQ_DataWrite(struct twiData *_data) {
 
   } else {                                      // if buffer is not full
     rxBuffer[(*rxHead)] = payload;                  // Load data into the buffer
+    TWI_PEC_ADD(_data, payload);
     (*rxHead) = nextHead;                           // Advance Head
     _data->_module->SCTRLB = TWI_SCMD_RESPONSE_gc;  // "Execute Acknowledge Action succeeded by reception of next byte"
   }
@@ -112,6 +112,8 @@ SOFTWARE.
 #define  TWI_TIMEOUT_ENABLE      // Enabled by default, might be disabled for debugging or other reasons
 #define  TWI_ERROR_ENABLED       // Enabled by default, TWI Master Write error functionality
 //#define TWI_READ_ERROR_ENABLED // Enabled on Master Read too
+//#define TWI_STATS_ENABLED      // Count transactions and errors, and time the transactions, see Wire.getStats()
+//#define TWI_PEC_ENABLED        // SMBus packet error checking (a CRC-8 after the data), see Wire.setPEC()
 //#define DISABLE_NEW_ERRORS     // Disables the new error codes and returns TWI_ERR_UNDEFINED instead.
 
 // Errors from Arduino documentation:
@@ -129,6 +131,8 @@ SOFTWARE.
   #define  TWI_ERR_BUS_ARB       0x12  // Bus error and/or Arbitration lost
   #define  TWI_ERR_BUF_OVERFLOW  0x13  // Buffer overflow on master read
   #define  TWI_ERR_CLKHLD        0x14  // Something's holding the clock
+  #define  TWI_ERR_BUSY          0x15  // An async host transaction is still running
+  #define  TWI_ERR_PEC           0x16  // The PEC of the data read was wrong
 #else
   // DISABLE_NEW_ERRORS can be used to more completely emulate the old error reporting behavior; this should rarely be needed.
   #define  TWI_ERR_UNINIT        TWI_ERR_UNDEFINED  // TWI was in bad state when method was called.
@@ -136,8 +140,19 @@ SOFTWARE.
   #define  TWI_ERR_BUS_ARB       TWI_ERR_UNDEFINED  // Bus error and/or Arbitration lost
   #define  TWI_ERR_BUF_OVERFLOW  TWI_ERR_UNDEFINED  // Buffer overflow on master read
   #define  TWI_ERR_CLKHLD        TWI_ERR_UNDEFINED  // Something's holding the clock
+  #define  TWI_ERR_BUSY          TWI_ERR_UNDEFINED  // An async host transaction is still running
+  #define  TWI_ERR_PEC           TWI_ERR_UNDEFINED  // The PEC of the data read was wrong
 #endif
 
+#define  TWI_ASYNC_PENDING       0xFF  // Status of an async host transaction that hasn't finished yet
+
+/* The host timeout is counted in passes through the polling loops while nothing happens, each taking about
+ * this many cycles; the count restarts at each byte, so it's the longest the bus may stall, not the whole
+ * transaction. The default is F_CPU/1000 passes, about 16 ms, as it always was. */
+#define  TWI_RISE_TIME_DEFAULT   300   // ns, assumed by TWI_MasterGetFrequency() if the rise time was never given
+#define  TWI_TIMEOUT_LOOP_CYCLES 16
+#define  TWI_TIMEOUT_DEFAULT     (F_CPU/1000)
+
 #if defined(TWI_ERROR_ENABLED)
   #define TWI_ERROR_VAR    twi_error
   #define TWI_INIT_ERROR   uint8_t TWI_ERROR_VAR = TWI_ERR_SUCCESS
@@ -170,15 +185,90 @@ SOFTWARE.
   //#define TWI_SET_EXT_ERROR(x)  {}
 #endif
 
+#if defined(TWI_STATS_ENABLED)
+  #define TWI_STATS_INC(d, x)       (d)->_stats.x++
+  #define TWI_STATS_BUS(d, status)  TWI_StatsBus(d, status)
+  #if defined(MILLIS_USE_TIMERNONE)
+    #define TWI_STATS_START         uint32_t twiStatsStart = 0
+  #else
+    #define TWI_STATS_START         uint32_t twiStatsStart = micros()
+  #endif
+  #define TWI_STATS_END(d)          TWI_StatsEnd(d, twiStatsStart)
+#else
+  #define TWI_STATS_INC(d, x)       {}
+  #define TWI_STATS_BUS(d, status)  {}
+  #define TWI_STATS_START           {}
+  #define TWI_STATS_END(d)          {}
+#endif
+
+#if defined(TWI_PEC_ENABLED)
+  #define TWI_PEC_ON                0x01  // send and check the PEC
+  #define TWI_PEC_FAILED            0x02  // a PEC was wrong since TWI_PecFailed() was last called
+  #define TWI_PEC_CLIENT_WRITE      0x04  // the client is being written to
+  #define TWI_PEC_CLIENT_SENT       0x08  // the client has sent the PEC after its data
+  #define TWI_PEC_USED(d)           ((d)->_pecFlags & TWI_PEC_ON)
+  #define TWI_PEC_ADD(d, x)         { if (TWI_PEC_USED(d)) (d)->_pec = TWI_PecUpdate((d)->_pec, x); }
+  #define TWI_PEC_START(d, x, rep)  { if (TWI_PEC_USED(d)) (d)->_pec = TWI_PecUpdate((rep) ? (d)->_pec : 0, x); }
+#else
+  #define TWI_PEC_USED(d)           (0)
+  #define TWI_PEC_ADD(d, x)         {}
+  #define TWI_PEC_START(d, x, rep)  {}
+#endif
+
+struct twiStats {           // kept when TWI_STATS_ENABLED is defined. The counters wrap around.
+  uint16_t transactions;    // host transactions, ended by a STOP or not
+  uint16_t nackAddress;     // address NACKed
+  uint16_t nackData;        // data NACKed on a host write
+  uint16_t arbitrationLost; // another host won the bus
+  uint16_t busErrors;       // illegal START/STOP seen on the bus
+  uint16_t timeouts;        // gave up waiting, or aborted
+  uint16_t clientTransactions;  // our client address matched
+  uint16_t clientErrors;    // bus errors and collisions seen by the client
+  uint32_t lastMicros;      // how long the last host transaction took, from the call until done
+  uint32_t maxMicros;       // the longest one
+  uint32_t totalMicros;     // all of them, for an average
+};
+
 
 struct twiDataBools {       // using a struct so the compiler can use skip if bit is set/cleared
-  uint8_t _reserved:      4;
+  uint8_t _reserved:      1;
+  bool _timedOut:         1;  // a host transaction timed out since the flag was last cleared
+  bool _resetOnTimeout:   1;  // and if so, run TWI_RecoverBus()
+  bool _hostAsync:        1;  // an async host transaction is running - the host ISR owns the host buffers
   bool _toggleStreamFn:   1;  // used to toggle between Slave and Master elements when TWI_MANDS defined
   bool _hostEnabled:      1;
   bool _clientEnabled:    1;
   bool _ackMatters:       1;
 };
 
+struct twiRegisterFile {    // a register map served by the client ISR, see TWI_SetRegisterFile()
+  volatile uint8_t *registers;
+  const uint8_t *writable;  // one mask per register, the bits the host may write. NULL: all of them
+  const uint8_t *notify;    // bitmap, bit (n & 7) of notify[n >> 3]: writing register n calls onWrite. NULL: none
+  void (*onWrite)(uint8_t first, uint8_t count);  // called from the ISR at the end of such a write
+  uint8_t size;             // number of registers, 1-255
+  volatile uint8_t pointer; // the register pointer, set by the first byte of each host write
+  uint8_t _first;           // the rest is used by the ISR
+  uint8_t _count;
+  uint8_t _state;
+};
+
+struct twiAddressMap {      // one emulated device for TWI_SetAddressMap(): a register file and the address it answers
+  uint8_t address;          // 7-bit, as for begin()
+  struct twiRegisterFile *file;
+};
+
+struct twiClientBuffers {   // caller-supplied client buffers served by the client ISR, see TWI_SetClientBuffers()
+  uint8_t *rxBuffer;        // host writes go here; bytes past rxLength are NACKed
+  const uint8_t *txBuffer;  // host reads get these; 0xFF past txLength
+  uint8_t rxLength;
+  uint8_t txLength;
+  void (*onDone)(bool hostRead, uint8_t count);  // called from the ISR when a host write or read has ended
+  volatile uint8_t rxCount; // bytes the host wrote in the last write
+  volatile uint8_t txCount; // bytes the host read in the last read
+  uint8_t _state;           // used by the ISR
+};
+
 /* My original idea was to pass the whole TwoWire class as a  */
 /* Pointer to this functions but this didn't work of course.  */
 /* But I had the idea: since the class is basically just a    */
@@ -192,7 +282,16 @@ struct twiData {
   #if defined(TWI_READ_ERROR_ENABLED)
     uint8_t _errors;
   #endif
+  #if defined(TWI_STATS_ENABLED)
+    struct twiStats _stats;
+  #endif
   uint8_t _clientAddress;
+  uint16_t _timeout;        // in polling loop passes, 0 for TWI_TIMEOUT_DEFAULT
+  uint16_t _riseTime;       // bus rise time in ns given to TWI_MasterSetBaudRise(), 0 if never called
+  #if defined(TWI_PEC_ENABLED)
+    uint8_t _pec;           // the CRC-8 of the transaction so far, address bytes included
+    uint8_t _pecFlags;      // TWI_PEC_* bits
+  #endif
   #if defined(TWI_MERGE_BUFFERS)
     uint8_t _trHead;
     uint8_t _trTail;
@@ -209,6 +308,10 @@ struct twiData {
   #endif
   void (*user_onRequest)(void);
   void (*user_onReceive)(int);
+  struct twiRegisterFile *_regFile;
+  const struct twiAddressMap *_addrMap;  // if set, _regFile is the entry addressed last
+  uint8_t _addrMapCount;
+  struct twiClientBuffers *_clientBufs;
   #if defined(TWI_MERGE_BUFFERS)
     uint8_t _trBuffer[BUFFER_LENGTH];
   #else
@@ -230,10 +333,50 @@ void     TWI_DisableMaster(struct   twiData *_data);
 void     TWI_DisableSlave(struct    twiData *_data);
 uint8_t  TWI_Available(struct       twiData *_data);
 void     TWI_HandleSlaveIRQ(struct  twiData *_data);
+void     TWI_SetRegisterFile(struct twiData *_data, struct twiRegisterFile *file);
+void     TWI_SetAddressMap(struct   twiData *_data, const struct twiAddressMap *map, uint8_t count);
+void     TWI_SetClientBuffers(struct twiData *_data, struct twiClientBuffers *bufs);
+#if defined(TWI_STATS_ENABLED)
+  void   TWI_StatsBus(struct        twiData *_data, uint8_t status);
+  void   TWI_StatsEnd(struct        twiData *_data, uint32_t start);
+  void   TWI_GetStats(struct        twiData *_data, struct twiStats *copy, bool reset);
+#endif
+#if defined(TWI_PEC_ENABLED)
+  uint8_t TWI_PecUpdate(uint8_t crc, uint8_t data);
+  void   TWI_SetPEC(struct          twiData *_data, bool enable);
+  bool   TWI_PecFailed(struct       twiData *_data);
+#endif
 uint8_t  TWI_MasterWrite(struct     twiData *_data, bool send_stop);
 void     TWI_MasterSetBaud(struct   twiData *_data, uint32_t frequency);
 uint8_t  TWI_MasterRead(struct      twiData *_data, uint8_t bytesToRead, bool send_stop);
 void     TWI_SlaveInit(struct       twiData *_data, uint8_t address, uint8_t receive_broadcast, uint8_t second_address);
 uint8_t  TWI_MasterCalcBaud(uint32_t frequency);
+uint32_t TWI_MasterSetBaudRise(struct twiData *_data, uint32_t frequency, uint16_t rise_ns);
+uint32_t TWI_MasterGetFrequency(struct twiData *_data);
+void     TWI_SetTimeout(struct      twiData *_data, uint32_t timeout_us, bool reset_with_timeout);
+uint8_t  TWI_RecoverBus(struct      twiData *_data);
+uint8_t  TWI_MasterWriteFrom(struct   twiData *_data, const uint8_t *src, size_t length, bool send_stop);
+size_t   TWI_MasterReadInto(struct    twiData *_data, uint8_t *dst, size_t length, bool send_stop);
+uint8_t  TWI_MasterWriteRegisters(struct twiData *_data, uint16_t reg, uint8_t regLength, const uint8_t *src, size_t length);
+size_t   TWI_MasterReadRegisters(struct  twiData *_data, uint16_t reg, uint8_t regLength, uint8_t *dst, size_t length);
+
+typedef void (*twiAsyncCallback_t)(uint8_t status);   // called from the host ISR with a TWI_ERR_* code
+
+struct twiTransaction {     // one entry of a list for TWI_QueueRun(): write writeLength bytes, then read readLength
+  const uint8_t *writeBuffer;
+  uint8_t *readBuffer;
+  uint8_t address;          // 7-bit client address, as for beginTransmission()
+  uint8_t writeLength;
+  uint8_t readLength;
+  volatile uint8_t status;  // TWI_ASYNC_PENDING until it has run, then a TWI_ERR_* code
+};
+
+uint8_t  TWI_MasterWriteAsync(struct twiData *_data, bool send_stop, twiAsyncCallback_t callback);
+uint8_t  TWI_MasterReadAsync(struct  twiData *_data, uint8_t bytesToRead, bool send_stop, twiAsyncCallback_t callback);
+uint8_t  TWI_AsyncStatus(struct      twiData *_data);
+uint8_t  TWI_AsyncCount(struct       twiData *_data);
+void     TWI_AsyncDefer(struct       twiData *_data, uint8_t deferred);
+void     TWI_AsyncAbort(struct       twiData *_data);
+uint8_t  TWI_QueueRun(struct         twiData *_data, struct twiTransaction *list, uint8_t count, twiAsyncCallback_t callback);
 
 #endif
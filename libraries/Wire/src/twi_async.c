@@ -0,0 +1,476 @@
+// *INDENT-OFF*   astyle wants this file to be completely unreadable with no indentation for the many preprocessor conditionals!
+
+/* Interrupt driven host transactions. TWI_MasterWrite() and TWI_MasterRead() poll the host status flags until the
+ * transaction is over; the functions here start the transaction, and the host interrupt (TWIM) does the rest of it,
+ * one byte per interrupt, using the same buffers, and calls back when it's done. The library is linked as an archive,
+ * so this file, and the interrupt, are only included when the sketch uses one of the async methods.
+ */
+
+#include "Arduino.h"
+#include "twi.h"
+
+#define TWI_ASYNC_READ    0x01  // what the running transaction is doing
+#define TWI_ASYNC_STOP    0x02  // and whether it ends with a STOP
+#define TWI_ASYNC_QUEUE   0x04  // running a list of struct twiTransaction, not the Wire buffers
+
+#if defined(TWI1)
+  #define TWI_ASYNC_MODULES 2
+#else
+  #define TWI_ASYNC_MODULES 1
+#endif
+
+struct twiAsync {
+  struct twiData *data;         // the Wire object's variables, for the ISR
+  twiAsyncCallback_t callback;
+  volatile uint8_t status;      // TWI_ASYNC_PENDING while running, then a TWI_ERR_* code
+  uint8_t mode;
+  uint8_t count;                // bytes written or read so far
+  uint8_t toRead;
+  struct twiTransaction *queue; // the one running, for TWI_ASYNC_QUEUE
+  uint8_t queueLeft;            // including that one
+  uint8_t queueError;           // the first error any of them ended with
+  uint8_t deferred;             // DEFERRED, DEFERRED_LOW or 0, see TWI_AsyncDefer()
+  #if defined(TWI_STATS_ENABLED)
+    uint32_t start;             // micros() when it was started
+  #endif
+};
+
+static struct twiAsync twiAsyncState[TWI_ASYNC_MODULES];
+
+
+/**
+ *@brief      TWI_AsyncSlot returns the async state that goes with the TWI module of a Wire object
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _module
+ *
+ *@return     struct twiAsync *
+ */
+static struct twiAsync *TWI_AsyncSlot(struct twiData *_data) {
+  #if defined(TWI1)
+    if (&TWI1 == _data->_module) {
+      return &twiAsyncState[1];
+    }
+  #endif
+  return &twiAsyncState[0];
+}
+
+
+/**
+ *@brief      TWI_AsyncFinish ends the running transaction: turns off the host interrupts, records the status
+ *              and calls the callback, if there is one.
+ *
+ *@param      struct twiAsync *async is the state of the transaction
+ *            uint8_t status is the TWI_ERR_* code it ended with
+ *
+ *@return     void
+ */
+static void TWI_AsyncFinish(struct twiAsync *async, uint8_t status) {
+  struct twiData *_data = async->data;
+  #if defined(TWI_STATS_ENABLED)
+    if (!(async->mode & TWI_ASYNC_QUEUE)) {                  // the entries of a queue were counted as they ended
+      if (status == TWI_ERR_ACK_ADR) {
+        _data->_stats.nackAddress++;
+      } else if (status == TWI_ERR_ACK_DAT) {
+        _data->_stats.nackData++;
+      }
+    }
+    TWI_StatsEnd(_data, async->start);
+  #endif
+  _data->_module->MCTRLA &= ~(TWI_RIEN_bm | TWI_WIEN_bm);
+  _data->_bools._hostAsync = 0;
+  async->status = status;
+  if (async->callback != NULL) {
+    _deferOrCall(async->callback, status, async->deferred);
+  }
+}
+
+
+/**
+ *@brief      TWI_AsyncStart checks that a transaction can be started, sets up the state and sends the address
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object. Following struct elements are used in this function:
+ *                _bools._hostEnabled
+ *                _bools._hostAsync
+ *                _clientAddress
+ *                _module
+ *            uint8_t mode is TWI_ASYNC_READ and/or TWI_ASYNC_STOP
+ *            uint8_t bytesToRead is the number of bytes to read, for a read
+ *            twiAsyncCallback_t callback is called from the ISR when it's done, or NULL
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS if it was started, or TWI_ERR_UNINIT or TWI_ERR_BUSY if not
+ */
+static uint8_t TWI_AsyncStart(struct twiData *_data, uint8_t mode, uint8_t bytesToRead, twiAsyncCallback_t callback) {
+  TWI_t *module = _data->_module;
+  if (_data->_bools._hostEnabled == 0 || (module->MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_UNKNOWN_gc) {
+    return TWI_ERR_UNINIT;
+  }
+  if (_data->_bools._hostAsync) {
+    return TWI_ERR_BUSY;
+  }
+  struct twiAsync *async = TWI_AsyncSlot(_data);
+  async->data     = _data;
+  async->callback = callback;
+  async->status   = TWI_ASYNC_PENDING;
+  async->mode     = mode;
+  async->count    = 0;
+  async->toRead   = bytesToRead;
+  #if defined(TWI_STATS_ENABLED) && !defined(MILLIS_USE_TIMERNONE)
+    async->start  = micros();
+  #endif
+  _data->_bools._hostAsync = 1;
+  module->MSTATUS = (TWI_ARBLOST_bm | TWI_BUSERR_bm);        // stale errors would end it at once
+  module->MCTRLA |= (TWI_RIEN_bm | TWI_WIEN_bm);
+  return TWI_ERR_SUCCESS;
+}
+
+
+/**
+ *@brief      TWI_AsyncAddress sends START (or REPSTART if we still own the bus) and the address.
+ *              If another host has the bus, the TWI waits for it to be released.
+ *
+ *@param      TWI_t *module is the TWI module
+ *            uint8_t address is the client address, already shifted left
+ *            uint8_t mode says if this is a read (TWI_ASYNC_READ) or a write
+ *
+ *@return     void
+ */
+static void TWI_AsyncAddress(TWI_t *module, uint8_t address, uint8_t mode) {
+  if (mode & TWI_ASYNC_READ) {
+    module->MADDR = ADD_READ_BIT(address);
+  } else {
+    module->MADDR = ADD_WRITE_BIT(address);
+  }
+}
+
+
+/**
+ *@brief      TWI_MasterWriteAsync starts a host write of the transmit buffer, which the host ISR carries out
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            bool send_stop enables the STOP condition at the end of the write
+ *            twiAsyncCallback_t callback is called from the ISR with the result, or NULL to poll TWI_AsyncStatus()
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS if the write was started, otherwise why it wasn't
+ */
+uint8_t TWI_MasterWriteAsync(struct twiData *_data, bool send_stop, twiAsyncCallback_t callback) {
+  uint8_t mode = send_stop ? TWI_ASYNC_STOP : 0;
+  uint8_t ret  = TWI_AsyncStart(_data, mode, 0, callback);
+  if (ret == TWI_ERR_SUCCESS) {
+    TWI_AsyncAddress(_data->_module, _data->_clientAddress, mode);
+  }
+  return ret;
+}
+
+
+/**
+ *@brief      TWI_MasterReadAsync starts a host read into the receive buffer, which the host ISR carries out
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            uint8_t bytesToRead is the number of bytes to read, at most BUFFER_LENGTH
+ *            bool send_stop enables the STOP condition at the end of the read
+ *            twiAsyncCallback_t callback is called from the ISR with the result, or NULL to poll TWI_AsyncStatus()
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS if the read was started, otherwise why it wasn't
+ */
+uint8_t TWI_MasterReadAsync(struct twiData *_data, uint8_t bytesToRead, bool send_stop, twiAsyncCallback_t callback) {
+  if (bytesToRead == 0) {
+    return TWI_ERR_UNDEFINED;
+  }
+  uint8_t mode = TWI_ASYNC_READ | (send_stop ? TWI_ASYNC_STOP : 0);
+  uint8_t ret  = TWI_AsyncStart(_data, mode, bytesToRead, callback);
+  if (ret == TWI_ERR_SUCCESS) {
+    TWI_AsyncAddress(_data->_module, _data->_clientAddress, mode);
+  }
+  return ret;
+}
+
+
+/**
+ *@brief      TWI_QueueBegin starts the transaction async->queue points to: the write phase, or
+ *              straight to the read phase if there's nothing to write but something to read.
+ *
+ *@param      struct twiAsync *async is the state of the queue on this module
+ *
+ *@return     void
+ */
+static void TWI_QueueBegin(struct twiAsync *async) {
+  struct twiTransaction *t = async->queue;
+  async->count = 0;
+  if (t->writeLength == 0 && t->readLength != 0) {
+    async->mode |= TWI_ASYNC_READ;
+  } else {
+    async->mode &= ~TWI_ASYNC_READ;                           // with neither, it's just the address: a probe
+  }
+  TWI_AsyncAddress(async->data->_module, t->address << 1, async->mode);
+}
+
+
+/**
+ *@brief      TWI_QueueNext records how the running transaction of the queue ended, and goes on to the next
+ *              one with a repeated start - or sends the STOP and finishes, if that was the last.
+ *
+ *            An error only ends the transaction it happened in, as the bus is still ours after a NACK.
+ *
+ *@param      struct twiAsync *async is the state of the queue on this module
+ *            uint8_t status is the TWI_ERR_* code the transaction ended with
+ *
+ *@return     void
+ */
+static void TWI_QueueNext(struct twiAsync *async, uint8_t status) {
+  TWI_t *module = async->data->_module;
+  async->queue->status = status;
+  if (status == TWI_ERR_ACK_ADR) {
+    TWI_STATS_INC(async->data, nackAddress);
+  } else if (status == TWI_ERR_ACK_DAT) {
+    TWI_STATS_INC(async->data, nackData);
+  }
+  if (async->queueError == TWI_ERR_SUCCESS) {
+    async->queueError = status;
+  }
+  if (--async->queueLeft == 0) {
+    module->MCTRLB = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;        // NACK, if the last byte was read, and STOP
+    TWI_AsyncFinish(async, async->queueError);
+  } else {
+    module->MCTRLB = TWI_ACKACT_bm;                           // the NACK is sent when MADDR is written
+    async->queue++;
+    TWI_QueueBegin(async);
+  }
+}
+
+
+/**
+ *@brief      TWI_QueueRun starts running a list of transactions, each one an optional write followed
+ *              by an optional read from/into its own buffer, back to back with repeated starts between
+ *              them and a STOP only at the end. The host ISR carries out all of it.
+ *
+ *            The list, and the buffers, must stay valid until it's done; the status of each transaction
+ *            is written to it as it ends, and TWI_AsyncStatus() returns the first error, if there was one.
+ *
+ *@param      struct twiData *_data is a pointer to the structure that holds the variables
+ *              of a Wire object.
+ *            struct twiTransaction *list is the first of the transactions
+ *            uint8_t count is how many there are
+ *            twiAsyncCallback_t callback is called from the ISR when they're all done, or NULL
+ *
+ *@return     uint8_t
+ *@retval     TWI_ERR_SUCCESS if it was started, otherwise why it wasn't
+ */
+uint8_t TWI_QueueRun(struct twiData *_data, struct twiTransaction *list, uint8_t count, twiAsyncCallback_t callback) {
+  if (count == 0) {
+    return TWI_ERR_UNDEFINED;
+  }
+  uint8_t ret = TWI_AsyncStart(_data, TWI_ASYNC_QUEUE | TWI_ASYNC_STOP, 0, callback);
+  if (ret == TWI_ERR_SUCCESS) {
+    for (uint8_t i = 0; i < count; i++) {
+      list[i].status = TWI_ASYNC_PENDING;
+    }
+    struct twiAsync *async = TWI_AsyncSlot(_data);
+    async->queue      = list;
+    async->queueLeft  = count;
+    async->queueError = TWI_ERR_SUCCESS;
+    TWI_QueueBegin(async);
+  }
+  return ret;
+}
+
+
+/**
+ *@brief      TWI_AsyncStatus returns the state of the last async transaction of a Wire object
+ *
+ *@return     uint8_t
+ *@retval     TWI_ASYNC_PENDING while it's running, then TWI_ERR_SUCCESS or the error it ended with
+ */
+uint8_t TWI_AsyncStatus(struct twiData *_data) {
+  struct twiAsync *async = TWI_AsyncSlot(_data);
+  if (async->data != _data) {
+    return TWI_ERR_SUCCESS;                                    // nothing was ever started
+  }
+  return async->status;
+}
+
+
+/**
+ *@brief      TWI_AsyncCount returns how many bytes the last async transaction wrote or read
+ *              (for a queue, in the phase of the transaction that was running last)
+ */
+uint8_t TWI_AsyncCount(struct twiData *_data) {
+  return TWI_AsyncSlot(_data)->count;
+}
+
+
+/**
+ *@brief      TWI_AsyncDefer sets whether the callbacks of the following async transactions are called from the ISR
+ *              (0), or posted to run from deferDispatch() (DEFERRED or DEFERRED_LOW)
+ */
+void TWI_AsyncDefer(struct twiData *_data, uint8_t deferred) {
+  TWI_AsyncSlot(_data)->deferred = deferred;
+}
+
+
+/**
+ *@brief      TWI_HandleMasterIRQ does one step of an async transaction, on a host read or write interrupt
+ *
+ *            The same steps as TWI_MasterWrite() and TWI_MasterRead(), but one per interrupt instead of
+ *            one per pass through the polling loop. There is no timeout here - a client holding SCL
+ *            low forever leaves the status at TWI_ASYNC_PENDING; TWI_AsyncAbort() can be used to give up.
+ *
+ *@param      struct twiAsync *async is the state of the transaction on this module
+ *
+ *@return     void
+ */
+static void TWI_HandleMasterIRQ(struct twiAsync *async) {
+  struct twiData *_data = async->data;
+  #if defined(TWI_MERGE_BUFFERS)                              // Same Buffers for tx/rx
+    uint8_t* txHead   = &(_data->_trHead);
+    uint8_t* txTail   = &(_data->_trTail);
+    uint8_t* txBuffer =   _data->_trBuffer;
+    uint8_t* rxHead   = &(_data->_trHead);
+    uint8_t* rxBuffer =   _data->_trBuffer;
+  #else                                                       // Separate tx/rx Buffers
+    uint8_t* txHead   = &(_data->_txHead);
+    uint8_t* txTail   = &(_data->_txTail);
+    uint8_t* txBuffer =   _data->_txBuffer;
+    uint8_t* rxHead   = &(_data->_rxHead);
+    uint8_t* rxBuffer =   _data->_rxBuffer;
+  #endif
+  TWI_t *module = _data->_module;
+  uint8_t currentStatus = module->MSTATUS;
+
+  if (!_data->_bools._hostAsync) {                            // not ours - shouldn't happen, but don't hang in here.
+    module->MCTRLA &= ~(TWI_RIEN_bm | TWI_WIEN_bm);
+    return;
+  }
+  if (currentStatus & (TWI_ARBLOST_bm | TWI_BUSERR_bm)) {     // Check for Bus error
+    TWI_STATS_BUS(_data, currentStatus);
+    module->MSTATUS = (TWI_ARBLOST_bm | TWI_BUSERR_bm);       // reset error flags
+    module->MCTRLB  = TWI_MCMD_STOP_gc;
+    if (async->mode & TWI_ASYNC_QUEUE) {                      // the bus is lost, so the rest can't be run.
+      async->queue->status = TWI_ERR_BUS_ARB;
+    }
+    TWI_AsyncFinish(async, TWI_ERR_BUS_ARB);
+    return;
+  }
+
+  if (async->mode & TWI_ASYNC_QUEUE) {
+    struct twiTransaction *t = async->queue;
+    if (async->mode & TWI_ASYNC_READ) {
+      if (currentStatus & TWI_RIF_bm) {
+        t->readBuffer[async->count++] = module->MDATA;
+        if (async->count < t->readLength) {
+          module->MCTRLB = TWI_MCMD_RECVTRANS_gc;
+        } else {
+          TWI_QueueNext(async, TWI_ERR_SUCCESS);
+        }
+      } else if (currentStatus & TWI_WIF_bm) {                // Address NACKed
+        TWI_QueueNext(async, TWI_ERR_ACK_ADR);
+      }
+    } else if (currentStatus & TWI_WIF_bm) {
+      if (currentStatus & TWI_RXACK_bm) {
+        TWI_QueueNext(async, async->count == 0 ? TWI_ERR_ACK_ADR : TWI_ERR_ACK_DAT);
+      } else if (async->count < t->writeLength) {
+        module->MDATA = t->writeBuffer[async->count++];
+      } else if (t->readLength != 0) {                        // written; REPSTART and read
+        async->count  = 0;
+        async->mode  |= TWI_ASYNC_READ;
+        TWI_AsyncAddress(module, t->address << 1, TWI_ASYNC_READ);
+      } else {
+        TWI_QueueNext(async, TWI_ERR_SUCCESS);
+      }
+    }
+    return;
+  }
+
+  if (async->mode & TWI_ASYNC_READ) {
+    if (currentStatus & TWI_RIF_bm) {                         // data received
+      if (async->count > (BUFFER_LENGTH - 1)) {               // Buffer overflow with this incoming Byte
+        module->MCTRLB = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;    // send STOP + NACK
+        TWI_AsyncFinish(async, TWI_ERR_BUF_OVERFLOW);
+        return;
+      }
+      rxBuffer[(*rxHead)] = module->MDATA;                    // save it in the buffer
+      (*rxHead) = TWI_advancePosition(*rxHead);               // advance head
+      async->count++;
+      if (async->count < async->toRead) {                     // expecting more bytes, so
+        module->MCTRLB = TWI_MCMD_RECVTRANS_gc;               // ACK so the client sends the next one
+      } else {
+        if (async->mode & TWI_ASYNC_STOP) {
+          module->MCTRLB = TWI_ACKACT_bm | TWI_MCMD_STOP_gc;  // send STOP + NACK
+        }
+        TWI_AsyncFinish(async, TWI_ERR_SUCCESS);
+      }
+    } else if (currentStatus & TWI_WIF_bm) {                  // Address NACKed
+      module->MCTRLB = TWI_MCMD_STOP_gc;
+      TWI_AsyncFinish(async, TWI_ERR_ACK_ADR);
+    }
+  } else if (currentStatus & TWI_WIF_bm) {                    // address or data sent
+    if (currentStatus & TWI_RXACK_bm) {                       // and NACKed
+      module->MCTRLB = TWI_MCMD_STOP_gc;
+      TWI_AsyncFinish(async, async->count == 0 ? TWI_ERR_ACK_ADR : TWI_ERR_ACK_DAT);
+    } else if ((*txHead) != (*txTail)) {                      // there is data to be written
+      module->MDATA = txBuffer[(*txTail)];
+      (*txTail) = TWI_advancePosition(*txTail);
+      async->count++;
+    } else {                                                  // all sent
+      if (async->mode & TWI_ASYNC_STOP) {
+        module->MCTRLB = TWI_MCMD_STOP_gc;
+      }
+      TWI_AsyncFinish(async, TWI_ERR_SUCCESS);
+    }
+  }
+}
+
+
+/**
+ *@brief      TWI_AsyncAbort gives up on a running async transaction, sending a STOP if we own the bus
+ *
+ *@return     void
+ */
+void TWI_AsyncAbort(struct twiData *_data) {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (_data->_bools._hostAsync) {
+    if ((_data->_module->MSTATUS & TWI_BUSSTATE_gm) == TWI_BUSSTATE_OWNER_gc) {
+      _data->_module->MCTRLB = TWI_MCMD_STOP_gc;
+    }
+    struct twiAsync *async = TWI_AsyncSlot(_data);
+    async->callback = NULL;                                   // it was given up on, so no call back
+    TWI_STATS_INC(_data, timeouts);
+    if (async->mode & TWI_ASYNC_QUEUE) {
+      async->queue->status = TWI_ERR_TIMEOUT;
+    }
+    TWI_AsyncFinish(async, TWI_ERR_TIMEOUT);
+  }
+  SREG = oldSREG;
+}
+
+
+/**
+ *@brief      TWI0 Master Interrupt vector
+ */
+ISR(TWI0_TWIM_vect) {
+  ISR_TRACE_ENTER(TWI);
+  TRACE_ISR(TWI, TWI0.MSTATUS);
+  TWI_HandleMasterIRQ(&twiAsyncState[0]);
+  ISR_TRACE_EXIT(TWI);
+}
+
+
+/**
+ *@brief      TWI1 Master Interrupt vector
+ */
+#if defined(TWI1)
+  ISR(TWI1_TWIM_vect) {
+    ISR_TRACE_ENTER(TWI);
+    TRACE_ISR(TWI, TWI1.MSTATUS);
+    TWI_HandleMasterIRQ(&twiAsyncState[1]);
+    ISR_TRACE_EXIT(TWI);
+  }
+#endif
@@ -340,6 +340,41 @@ void TWI0_usePullups() {
     #endif
   #endif
 }
+/* The port and bits of the host SDA and SCL pins with the current PORTMUX setting - for bus recovery */
+PORT_t *TWI0_HostPins(uint8_t *sda_bm, uint8_t *scl_bm) {
+  #ifdef DXCORE
+    uint8_t muxval = PORTMUX.TWIROUTEA & PORTMUX_TWI0_gm;
+    #if defined(__AVR_DD__)
+      if (muxval == 3) {
+        *sda_bm = 0x01;   // PA0, PA1
+        *scl_bm = 0x02;
+        return &PORTA;
+      }
+    #endif
+    *sda_bm = 0x04;       // PA2/PC2, PA3/PC3
+    *scl_bm = 0x08;
+    return (muxval == PORTMUX_TWI0_ALT2_gc) ? &PORTC : &PORTA;
+  #else  // megaTinyCore
+    #if defined(PORTMUX_TWI0_bm)
+      if (PORTMUX.CTRLB & PORTMUX_TWI0_bm) {
+        *sda_bm = 0x02;   // PA1
+        *scl_bm = 0x04;   // PA2
+        return &PORTA;
+      }
+    #elif defined(__AVR_ATtinyxy2__)
+      *sda_bm = 0x02;     // PA1
+      *scl_bm = 0x04;     // PA2
+      return &PORTA;
+    #endif
+    #if !defined(__AVR_ATtinyxy2__)
+      *sda_bm = 0x02;     // PB1
+      *scl_bm = 0x01;     // PB0
+      return &PORTB;
+    #endif
+  #endif
+}
+
+
 #if defined(TWI1)
 void TWI1_ClearPins() {
   #if defined(PORTMUX_TWIROUTEA)
@@ -486,6 +521,18 @@ void TWI1_usePullups() {
     #endif
   #endif
 }
+
+
+PORT_t *TWI1_HostPins(uint8_t *sda_bm, uint8_t *scl_bm) {
+  *sda_bm = 0x04;         // PF2/PB2, PF3/PB3
+  *scl_bm = 0x08;
+  #if defined(PIN_WIRE1_SDA_PINSWAP_2)
+    if ((PORTMUX.TWIROUTEA & PORTMUX_TWI1_gm) == PORTMUX_TWI1_ALT2_gc) {
+      return &PORTB;
+    }
+  #endif
+  return &PORTF;
+}
 #endif
 
 #endif /* TWI_DRIVER_H */
@@ -36,6 +36,7 @@ void   TWI0_ClearPins();
 bool   TWI0_Pins(uint8_t sda_pin, uint8_t scl_pin);
 bool   TWI0_swap(uint8_t state);
 void   TWI0_usePullups();
+PORT_t *TWI0_HostPins(uint8_t *sda_bm, uint8_t *scl_bm);
 
 
 #if defined (TWI1)
@@ -43,6 +44,7 @@ void   TWI0_usePullups();
   bool   TWI1_Pins(uint8_t sda_pin, uint8_t scl_pin);
   bool   TWI1_swap(uint8_t state);
   void   TWI1_usePullups();
+  PORT_t *TWI1_HostPins(uint8_t *sda_bm, uint8_t *scl_bm);
 #endif
 
 #endif /* TWI_DRIVER_H */
@@ -0,0 +1,197 @@
+/* Benchmarks - clock cycles taken by the core's hot paths, printed one result per line so that runs on different
+ * parts, clock speeds and versions of the core can be compared with diff, or loaded into a spreadsheet.
+ *
+ * Every line is CSV:   part,F_CPU,test,min,max,runs
+ * where min and max are in CPU clock cycles, less the cost of reading the timer. The Profiler library's type B timer
+ * does the counting; anything that runs for more than 65535 clocks is timed with micros() instead (so to a few
+ * microseconds), and the same column is still in clocks.
+ *
+ * The Serial tests time putting 8 or 16 bytes (SERIAL_BLOCK) into an empty TX buffer, one at a time or with one
+ * write(), not sending them. Nothing needs to be connected except the serial adapter. The Wire test reads 16 bytes
+ * from WIRE_ADDRESS - with nothing there, it's the time to find that out - and the SPI one clocks out 16 bytes to
+ * whatever is on the bus.
+ * ANALOG_PIN is read, and the pin interrupt test drives STIMULUS_PIN itself, so leave both free.
+ */
+#define PROFILER_ENABLE
+#include <Profiler.h>
+#include <Wire.h>
+#include <SPI.h>
+
+#define STIMULUS_PIN  PIN_PA1
+#define ANALOG_PIN    PIN_PA2
+#define WIRE_ADDRESS  0x50      // a 24-series EEPROM, say
+#define RUNS          32
+#define BLOCK         16        // bytes per Wire and SPI block
+#if SERIAL_TX_BUFFER_SIZE < 32
+  #define SERIAL_BLOCK  8         // so that they all fit in the TX buffer, and nothing waits for the wire
+#else
+  #define SERIAL_BLOCK  16
+#endif
+
+class NullPrint : public Print { // so the Print tests time the formatting, not the serial port
+  public:
+    size_t write(uint8_t) {
+      return 1;
+    }
+};
+
+NullPrint         sink;
+uint8_t           block[BLOCK];
+volatile uint16_t entered;
+volatile long     longValue  = -1234567L;
+volatile float    floatValue = 3.14159;
+
+typedef void (*bench_t)();
+
+void onEdge() {
+  entered = _prof_now();
+}
+
+void report(const __FlashStringHelper *test, uint32_t min, uint32_t max) {
+  Serial.print(F(__AVR_DEVICE_NAME__ ","));
+  Serial.print(F_CPU);
+  Serial.print(',');
+  Serial.print(test);
+  Serial.print(',');
+  Serial.print(min);
+  Serial.print(',');
+  Serial.print(max);
+  Serial.print(',');
+  Serial.println(RUNS);
+  Serial.flush();             // so the next test doesn't share the CPU with sending this
+}
+
+/* Run fn RUNS times, timing each with the TCB, and with micros() for when that overflows. Interrupts stay on, as
+ * they would be in a sketch (and some of these need them), so max includes whatever ISR got in. */
+void bench(const __FlashStringHelper *test, bench_t fn) {
+  uint32_t min = 0xFFFFFFFF, max = 0;
+  for (uint8_t i = 0; i < RUNS; i++) {
+    Serial.flush();                        // an empty TX buffer for the Serial tests
+    PROFILER_TIMER.INTFLAGS = TCB_CAPT_bm;
+    uint32_t us    = micros();
+    uint16_t start = _prof_now();
+    fn();
+    uint16_t end   = _prof_now();
+    uint32_t elapsed;
+    if (PROFILER_TIMER.INTFLAGS & TCB_CAPT_bm) {                  // it wrapped: more than 65535 clocks
+      elapsed = (micros() - us) * (F_CPU / 1000000L);
+    } else {
+      elapsed = (uint16_t)(end - start - Profiler._overhead);
+    }
+    if (elapsed < min) {
+      min = elapsed;
+    }
+    if (elapsed > max) {
+      max = elapsed;
+    }
+  }
+  report(test, min, max);
+}
+
+void benchAnalog(const __FlashStringHelper *test, uint8_t res) {
+  uint32_t min = 0xFFFFFFFF, max = 0;
+  for (uint8_t i = 0; i < RUNS; i++) {
+    uint32_t us    = micros();
+    analogReadEnh(ANALOG_PIN, res);
+    uint32_t elapsed = (micros() - us) * (F_CPU / 1000000L);  // most of them are far beyond 65535 clocks
+    if (elapsed < min) {
+      min = elapsed;
+    }
+    if (elapsed > max) {
+      max = elapsed;
+    }
+  }
+  report(test, min, max);
+}
+
+void benchInterrupt() {
+  uint32_t min = 0xFFFFFFFF, max = 0;
+  for (uint8_t i = 0; i < RUNS; i++) {
+    digitalWriteFast(STIMULUS_PIN, LOW);
+    delayMicroseconds(10);
+    uint8_t oldSREG = SREG;
+    cli();                                 // so that the millis ISR can't get in between
+    uint16_t start = _prof_now();
+    digitalWriteFast(STIMULUS_PIN, HIGH);
+    SREG = oldSREG;                        // the pin interrupt runs right after this
+    _NOP();
+    uint16_t latency = entered - start - Profiler._overhead;
+    if (latency < min) {
+      min = latency;
+    }
+    if (latency > max) {
+      max = latency;
+    }
+  }
+  report(F("attachInterrupt_latency"), min, max);
+}
+
+void setup() {
+  Serial.begin(115200);
+  PROF_INIT();
+  Wire.begin();
+  SPI.begin();
+  pinModeFast(STIMULUS_PIN, OUTPUT);
+  attachInterrupt(digitalPinToInterrupt(STIMULUS_PIN), onEdge, RISING);
+  delay(100);
+  Serial.println(F("part,F_CPU,test,min,max,runs"));
+}
+
+void loop() {
+  bench(F("digitalWrite"),          []() {
+    digitalWrite(STIMULUS_PIN, LOW);
+  });
+  bench(F("digitalWriteFast"),      []() {
+    digitalWriteFast(STIMULUS_PIN, LOW);
+  });
+  bench(F("digitalRead"),           []() {
+    (void)digitalRead(STIMULUS_PIN);
+  });
+  bench(F("millis"),                []() {
+    (void)millis();
+  });
+  bench(F("micros"),                []() {
+    (void)micros();
+  });
+  bench(F("analogRead"),            []() {
+    (void)analogRead(ANALOG_PIN);
+  });
+  benchAnalog(F("analogReadEnh_12bit"), 12);
+  benchAnalog(F("analogReadEnh_ACC2"),  ADC_ACC2);
+  benchAnalog(F("analogReadEnh_ACC4"),  ADC_ACC4);
+  benchAnalog(F("analogReadEnh_ACC8"),  ADC_ACC8);
+  benchAnalog(F("analogReadEnh_ACC16"), ADC_ACC16);
+  benchAnalog(F("analogReadEnh_ACC32"), ADC_ACC32);
+  benchAnalog(F("analogReadEnh_ACC64"), ADC_ACC64);
+  #if MEGATINYCORE_SERIES == 2
+  benchAnalog(F("analogReadEnh_ACC128"),  ADC_ACC128);
+  benchAnalog(F("analogReadEnh_ACC256"),  ADC_ACC256);
+  benchAnalog(F("analogReadEnh_ACC512"),  ADC_ACC512);
+  benchAnalog(F("analogReadEnh_ACC1024"), ADC_ACC1024);
+  #endif
+  bench(F("Serial_write_bytes"),    []() {
+    for (uint8_t i = 0; i < SERIAL_BLOCK; i++) {
+      Serial.write(block[i]);
+    }
+  });
+  bench(F("Serial_write_block"),    []() {
+    Serial.write(block, SERIAL_BLOCK);
+  });
+  bench(F("print_long"),            []() {
+    sink.print(longValue);
+  });
+  bench(F("print_float"),           []() {
+    sink.print(floatValue, 4);
+  });
+  benchInterrupt();
+  bench(F("Wire_read_16"),          []() {
+    if (Wire.requestFrom(WIRE_ADDRESS, BLOCK) == BLOCK) {
+      Wire.readBytes(block, BLOCK);
+    }
+  });
+  bench(F("SPI_transfer_16"),       []() {
+    SPI.transfer(block, BLOCK);
+  });
+  Serial.println();
+  delay(5000);
+}
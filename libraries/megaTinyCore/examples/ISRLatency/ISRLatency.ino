@@ -0,0 +1,75 @@
+/* ISRLatency - measure, in clock cycles, how long it takes from a pin edge until an attachInterrupt() handler starts
+ * running, and how long the millis ISR steals from the code it interrupts. Uses the Profiler library's timer, so
+ * no logic analyzer is needed (see ISRTrace for that).
+ *
+ * A pin interrupt is triggered by the pin's own output, so nothing needs to be connected. The millis ISR time is
+ * found by timing the same short piece of code many times: most runs aren't interrupted, the slowest one was, by
+ * the whole ISR, including the time to get into and out of it.
+ */
+#define PROFILER_ENABLE
+#include <Profiler.h>
+
+#define STIMULUS_PIN  PIN_PA1
+#define TRIALS        200
+
+volatile uint16_t entered;
+
+void onEdge() {
+  entered = _prof_now();
+}
+
+void printStat(const __FlashStringHelper *name, uint16_t min, uint16_t max) {
+  Serial.print(name);
+  Serial.print(F(" min "));
+  Serial.print(min);
+  Serial.print(F(" max "));
+  Serial.print(max);
+  Serial.println(F(" clocks"));
+}
+
+void setup() {
+  Serial.begin(115200);
+  PROF_INIT();
+  pinModeFast(STIMULUS_PIN, OUTPUT);
+  attachInterrupt(digitalPinToInterrupt(STIMULUS_PIN), onEdge, RISING);
+}
+
+void loop() {
+  uint16_t min = 0xFFFF, max = 0;
+  for (uint16_t i = 0; i < TRIALS; i++) {
+    digitalWriteFast(STIMULUS_PIN, LOW);
+    delayMicroseconds(10);
+    uint8_t oldSREG = SREG;
+    cli();                           // so that the millis ISR can't get in between.
+    uint16_t start = _prof_now();
+    digitalWriteFast(STIMULUS_PIN, HIGH);
+    SREG = oldSREG;                  // the pin interrupt runs right after this.
+    _NOP();
+    uint16_t latency = entered - start - Profiler._overhead;
+    if (latency < min) {
+      min = latency;
+    }
+    if (latency > max) {
+      max = latency;
+    }
+  }
+  printStat(F("attachInterrupt() latency:"), min, max);
+
+  min = 0xFFFF;
+  max = 0;
+  uint32_t until = millis() + 50;    // long enough to be sure of being interrupted many times
+  while ((int32_t)(millis() - until) < 0) {
+    uint16_t start = _prof_now();
+    _NOP8();
+    uint16_t elapsed = _prof_now() - start - Profiler._overhead;
+    if (elapsed < min) {
+      min = elapsed;
+    }
+    if (elapsed > max) {
+      max = elapsed;
+    }
+  }
+  printStat(F("8 clocks of code, with millis ISR:"), min, max);
+  Serial.flush();
+  delay(1000);
+}
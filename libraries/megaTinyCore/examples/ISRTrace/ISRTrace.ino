@@ -0,0 +1,50 @@
+/* ISRTrace - keep the core ISRs busy, so their trace pins can be watched on a logic analyzer.
+ *
+ * The trace markers are compiled into the core, so the defines have to be given to the compiler for every file,
+ * not just the sketch. Create platform.local.txt next to platform.txt, containing (for example):
+ *   compiler.c.extra_flags=-DISR_TRACE_MILLIS=1 -DISR_TRACE_RXC=2 -DISR_TRACE_DRE=3 -DISR_TRACE_PINS=4
+ *   compiler.cpp.extra_flags=-DISR_TRACE_MILLIS=1 -DISR_TRACE_RXC=2 -DISR_TRACE_DRE=3 -DISR_TRACE_PINS=4
+ * which puts them on PA1-PA4 (ISR_TRACE_VPORT picks another port). Each pin is high while that ISR runs; the
+ * width of the pulse is how long it takes (less the prologue and epilogue for ISRs written in C), and the time
+ * from the STIMULUS_PIN edge to the rise of the ISR_TRACE_PINS pin is the latency of attachInterrupt().
+ * Delete platform.local.txt when you're done, or every sketch will have them.
+ *
+ * Connect the serial port's TX to RX to get RXC interrupts too.
+ */
+
+#if !ISR_TRACE_MASK
+  #warning "No ISR trace pins are defined - see the comments at the top of this sketch."
+#endif
+
+#define STIMULUS_PIN  PIN_PA5  // generates the pin interrupts - an output's own pin interrupt still works.
+#define TWIN_PIN      PIN_PA6  // high while the stimulus handler runs
+
+volatile uint16_t edges;
+
+void onEdge() {
+  digitalWriteFast(TWIN_PIN, HIGH);
+  edges++;
+  digitalWriteFast(TWIN_PIN, LOW);
+}
+
+void setup() {
+  Serial.begin(115200);
+  pinModeFast(STIMULUS_PIN, OUTPUT);
+  pinModeFast(TWIN_PIN, OUTPUT);
+  attachInterrupt(digitalPinToInterrupt(STIMULUS_PIN), onEdge, RISING);
+}
+
+void loop() {
+  digitalWriteFast(STIMULUS_PIN, HIGH);
+  delayMicroseconds(20);
+  digitalWriteFast(STIMULUS_PIN, LOW);
+  static uint32_t last;
+  if (millis() - last >= 100) {
+    last = millis();
+    Serial.print(F("Edges: "));   // DRE (and, looped back, RXC) interrupts
+    Serial.println(edges);
+    while (Serial.available()) {
+      Serial.read();
+    }
+  }
+}
@@ -50,7 +50,7 @@
 
 // Constructor when length, pin and type are known at compile-time:
 tinyNeoPixel::tinyNeoPixel(uint16_t n, uint8_t p, neoPixelType t) :
-  begun(false), brightness(0), pixels(NULL), endTime(0) {
+  begun(false), brightness(0), pixels(NULL), endTime(0), interruptible(false), deferBrightness(false), fbMode(0), numSegments(0), fbTable(NULL), showHW(NULL) {
   updateType(t);
   updateLength(n);
   setPin(p);
@@ -63,7 +63,7 @@ tinyNeoPixel::tinyNeoPixel(uint16_t n, uint8_t p, neoPixelType t) :
 // updateLength(), etc. to establish the strand type, length and pin number!
 tinyNeoPixel::tinyNeoPixel() :
   begun(false), numLEDs(0), numBytes(0), pin(NOT_A_PIN), brightness(0), pixels(NULL),
-  rOffset(1), gOffset(0), bOffset(2), wOffset(1), endTime(0) {
+  rOffset(1), gOffset(0), bOffset(2), wOffset(1), endTime(0), interruptible(false), deferBrightness(false), fbMode(0), numSegments(0), fbTable(NULL), showHW(NULL) {
 }
 
 tinyNeoPixel::~tinyNeoPixel() {
@@ -85,15 +85,136 @@ void tinyNeoPixel::updateLength(uint16_t n) {
   }
 
   // Allocate new data -- note: ALL PIXELS ARE CLEARED
-  numBytes = n * ((wOffset == rOffset) ? 3 : 4);
-  if ((pixels = (uint8_t *)malloc(numBytes))) {
-    memset(pixels, 0, numBytes);
-    numLEDs = n;
+  // (an index per pixel with a palette, and no buffer at all for segments)
+  if (fbMode == NEO_PALETTE8) {
+    numBytes = n;
+  } else if (fbMode == NEO_PALETTE4) {
+    numBytes = (n + 1) >> 1;
+  } else if (fbMode == NEO_SEGMENTS) {
+    numBytes = 0;
   } else {
-    numLEDs = numBytes = 0;
+    numBytes = n * ((wOffset == rOffset) ? 3 : 4);
+  }
+  numLEDs = n;
+  pixels  = NULL;
+  if (numBytes) {
+    if ((pixels = (uint8_t *)malloc(numBytes))) {
+      memset(pixels, 0, numBytes);
+    } else {
+      numLEDs = numBytes = 0;
+    }
+  }
+}
+
+/*!
+  @brief   Switch the framebuffer to palette indexes: 8 or 4 bits per pixel
+           (for 4, pixel 0 is the high nibble of the first byte), which
+           show() expands to color bytes on the fly. Reallocates (and
+           clears) the buffer.
+  @param   palette   3 or 4 bytes per entry, in the strip's byte order (see
+                     setPaletteColor()), as many entries as indexes used.
+                     Not copied - it can be changed between frames.
+  @param   bits      8 or 4, or 0 to go back to 3 or 4 bytes per pixel.
+*/
+void tinyNeoPixel::setPalette(const uint8_t *palette, uint8_t bits) {
+  fbMode  = (bits == 8 || bits == 4) ? bits : 0;
+  fbTable = fbMode ? palette : NULL;
+  updateLength(numLEDs);
+}
+
+// Store a packed color in palette entry n, in the strip's byte order.
+// Only for a palette in RAM.
+void tinyNeoPixel::setPaletteColor(uint8_t n, uint32_t c) {
+  if (fbMode == NEO_PALETTE8 || fbMode == NEO_PALETTE4) {
+    colorToBytes(c, (uint8_t *)fbTable + n * ((wOffset == rOffset) ? 3 : 4));
+  }
+}
+
+/*!
+  @brief   Replace the framebuffer with a list of runs of a single color;
+           pixels past the end of the last one are off. Frees the buffer.
+  @param   segments  The runs, from the first pixel. Not copied - it can be
+                     changed between frames.
+  @param   count     Number of runs, or 0 (with NULL) to go back to 3 or 4
+                     bytes per pixel.
+*/
+void tinyNeoPixel::setSegments(const neoPixelSegment *segments, uint8_t count) {
+  fbMode      = segments ? NEO_SEGMENTS : 0;
+  fbTable     = segments;
+  numSegments = count;
+  updateLength(numLEDs);
+}
+
+void tinyNeoPixel::setPixelIndex(uint16_t n, uint8_t index) {
+  if (n < numLEDs) {
+    if (fbMode == NEO_PALETTE8) {
+      pixels[n] = index;
+    } else if (fbMode == NEO_PALETTE4) {
+      uint8_t *p = &pixels[n >> 1];
+      *p = (n & 1) ? ((*p & 0xF0) | (index & 0x0F)) : ((*p & 0x0F) | (index << 4));
+    }
   }
 }
 
+uint8_t tinyNeoPixel::getPixelIndex(uint16_t n) const {
+  if (n < numLEDs) {
+    if (fbMode == NEO_PALETTE8) {
+      return pixels[n];
+    } else if (fbMode == NEO_PALETTE4) {
+      return (n & 1) ? (pixels[n >> 1] & 0x0F) : (pixels[n >> 1] >> 4);
+    }
+  }
+  return 0;
+}
+
+// A packed color as the 3 or 4 bytes that go to the strip.
+void tinyNeoPixel::colorToBytes(uint32_t c, uint8_t *p) const {
+  p[rOffset] = (uint8_t)(c >> 16);
+  p[gOffset] = (uint8_t)(c >>  8);
+  p[bOffset] = (uint8_t)c;
+  if (wOffset != rOffset) {
+    p[wOffset] = (uint8_t)(c >> 24);
+  }
+}
+
+// The bytes for the next pixel of the frame, from wherever they come from
+// in this framebuffer mode, and with the brightness applied if show() has
+// to do that. Used when show() sends a pixel at a time.
+const uint8_t *tinyNeoPixel::nextPixel(neoFrameCursor &c) const {
+  uint8_t chunk = (wOffset == rOffset) ? 3 : 4;
+  uint8_t scale = (deferBrightness || fbMode) ? brightness : 0;
+  const uint8_t *src;
+  if (fbMode == NEO_PALETTE8) {
+    src = (const uint8_t *)fbTable + pixels[c.px] * chunk;
+  } else if (fbMode == NEO_PALETTE4) {
+    uint8_t index = pixels[c.px >> 1];
+    src = (const uint8_t *)fbTable + ((c.px & 1) ? (index & 0x0F) : (index >> 4)) * chunk;
+  } else if (fbMode == NEO_SEGMENTS) {
+    while (!c.segLeft) {
+      if (c.seg >= numSegments) {
+        memset(c.color, 0, 4);   // past the last run - off to the end.
+        c.segLeft = 0xFFFF;
+      } else {
+        const neoPixelSegment *seg = (const neoPixelSegment *)fbTable + c.seg++;
+        colorToBytes(seg->color, c.color);
+        c.segLeft = seg->length;
+      }
+    }
+    c.segLeft--;
+    src = c.color;
+  } else {
+    src = pixels + c.px * chunk;
+  }
+  c.px++;
+  if (scale) {
+    for (uint8_t k = 0; k < chunk; k++) {
+      c.out[k] = (src[k] * scale) >> 8;
+    }
+    src = c.out;
+  }
+  return src;
+}
+
 void tinyNeoPixel::updateType(neoPixelType t) {
   boolean oldThreeBytesPerPixel = (wOffset == rOffset); // false if RGBW
 
@@ -104,7 +225,7 @@ void tinyNeoPixel::updateType(neoPixelType t) {
 
   // If bytes-per-pixel has changed (and pixel data was previously
   // allocated), re-allocate to new size.  Will clear any data.
-  if (pixels) {
+  if (pixels && !fbMode) {
     boolean newThreeBytesPerPixel = (wOffset == rOffset);
     if (newThreeBytesPerPixel != oldThreeBytesPerPixel) {
       updateLength(numLEDs);
@@ -115,7 +236,7 @@ void tinyNeoPixel::updateType(neoPixelType t) {
 // *INDENT-OFF*   astyle don't like assembly
 void tinyNeoPixel::show(void) {
 
-  if ((!pixels) || pin >= NUM_DIGITAL_PINS)  {
+  if ((!pixels && fbMode != NEO_SEGMENTS) || !numLEDs || pin >= NUM_DIGITAL_PINS)  {
     return;
   }
 
@@ -130,6 +251,11 @@ void tinyNeoPixel::show(void) {
   // instances on different pins can be quickly issued in succession (each
   // instance doesn't delay the next).
 
+  if (showHW) {   // beginCCL() - the waveform comes from the hardware.
+    showHW(this);
+    return;
+  }
+
   // In order to make this code runtime-configurable to work with any pin,
   // SBI/CBI instructions are eschewed in favor of full PORT writes via the
   // OUT or ST instructions.  It relies on two facts: that peripheral
@@ -140,7 +266,24 @@ void tinyNeoPixel::show(void) {
   // state, computes 'pin high' and 'pin low' values, and writes these back
   // to the PORT register as needed.
 
+  // With setInterruptible(true), that's done a pixel at a time, and the
+  // pending interrupts get to run between pixels - the line is low then,
+  // and as long as they finish before the LEDs take it for a latch (which
+  // is 50 us or more on WS2812B and SK6812; some older parts latch after
+  // as little as 6-10 us), only that pixel's bit is stretched. The loop
+  // below isn't indented, to spare the hand-tuned code that follows.
+  // With setDeferredBrightness(true), or a palette or segments, it's a
+  // pixel at a time regardless, and nextPixel() works out each pixel's
+  // bytes just before they go out.
+  uint8_t  chunk    = (wOffset == rOffset) ? 3 : 4;
+  uint16_t left     = numLEDs * chunk;
+  bool     perPixel = interruptible || fbMode || (deferBrightness && brightness);
+  neoFrameCursor cursor = {0, 0, 0, {0}, {0}};
+
   noInterrupts(); // Need 100% focus on instruction timing
+  do {
+    uint16_t       n   = perPixel ? chunk : left;
+    const uint8_t *src = perPixel ? nextPixel(cursor) : pixels;
 
 
   // AVRxt MCUs --  tinyAVR 0/1/2, megaAVR 0, AVR Dx ----------------------
@@ -150,9 +293,9 @@ void tinyNeoPixel::show(void) {
   // with them.
 
   volatile uint16_t
-    i   = numBytes; // Loop counter
+    i   = n;        // Loop counter
   volatile uint8_t
-   *ptr = pixels,   // Pointer to next byte
+   *ptr = (volatile uint8_t *)src, // Pointer to next byte
     b   = *ptr++,   // Current byte value
     hi,             // PORT w/output bit set high
     lo;             // PORT w/output bit set low
@@ -854,6 +997,13 @@ void tinyNeoPixel::show(void) {
     #error "CPU SPEED NOT SUPPORTED"
   #endif
 
+    left -= n;
+    if (left && interruptible) {
+      interrupts();
+      __asm__ __volatile__ ("nop"); // the instruction after SEI always runs before an interrupt can.
+      noInterrupts();
+    }
+  } while (left);
 
   interrupts();
   #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERRTC_XTAL) && !defined(MILLIS_USE_TIMERRTC_XOSC))
@@ -880,8 +1030,8 @@ void tinyNeoPixel::setPin(uint8_t p) {
 
 // Set pixel color from separate R,G,B components:
 void tinyNeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
-  if (n < numLEDs) {
-    if (brightness) { // See notes in setBrightness()
+  if (n < numLEDs && !fbMode) {
+    if (brightness && !deferBrightness) { // See notes in setBrightness()
       r = (r * brightness) >> 8;
       g = (g * brightness) >> 8;
       b = (b * brightness) >> 8;
@@ -900,8 +1050,8 @@ void tinyNeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
 }
 
 void tinyNeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
-  if (n < numLEDs) {
-    if (brightness) { // See notes in setBrightness()
+  if (n < numLEDs && !fbMode) {
+    if (brightness && !deferBrightness) { // See notes in setBrightness()
       r = (r * brightness) >> 8;
       g = (g * brightness) >> 8;
       b = (b * brightness) >> 8;
@@ -922,12 +1072,12 @@ void tinyNeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, ui
 
 // Set pixel color from 'packed' 32-bit RGB color:
 void tinyNeoPixel::setPixelColor(uint16_t n, uint32_t c) {
-  if (n < numLEDs) {
+  if (n < numLEDs && !fbMode) {
     uint8_t *p,
       r = (uint8_t)(c >> 16),
       g = (uint8_t)(c >>  8),
       b = (uint8_t)c;
-    if (brightness) { // See notes in setBrightness()
+    if (brightness && !deferBrightness) { // See notes in setBrightness()
       r = (r * brightness) >> 8;
       g = (g * brightness) >> 8;
       b = (b * brightness) >> 8;
@@ -937,7 +1087,7 @@ void tinyNeoPixel::setPixelColor(uint16_t n, uint32_t c) {
     } else {
       p = &pixels[n * 4];
       uint8_t w = (uint8_t)(c >> 24);
-      p[wOffset] = brightness ? ((w * brightness) >> 8) : w;
+      p[wOffset] = (brightness && !deferBrightness) ? ((w * brightness) >> 8) : w;
     }
     p[rOffset] = r;
     p[gOffset] = g;
@@ -978,6 +1128,100 @@ void tinyNeoPixel::fill(uint32_t c, uint16_t first, uint16_t count) {
   }
 }
 
+/*!
+  @brief   Fill all or part of the strip with a straight line from one color
+           to another, in 8.8 fixed point, without a divide per pixel.
+  @param   c1     Packed color of the first pixel.
+  @param   c2     Packed color of the last pixel.
+  @param   first  Index of first pixel, 0 if unspecified.
+  @param   count  Number of pixels; 0 or unspecified fills to the end.
+*/
+void tinyNeoPixel::fillGradient(uint32_t c1, uint32_t c2, uint16_t first, uint16_t count) {
+  if (fbMode || first >= numLEDs) {
+    return;
+  }
+  if (count == 0 || count > numLEDs - first) {
+    count = numLEDs - first;
+  }
+  uint8_t  bytes   = (wOffset == rOffset) ? 3 : 4;
+  uint8_t  offs[4] = {wOffset, rOffset, gOffset, bOffset};
+  uint8_t  scale   = deferBrightness ? 0 : brightness;
+  uint16_t v[4], step[4];
+  for (uint8_t k = 0; k < 4; k++) {
+    uint8_t a = (uint8_t)(c1 >> (24 - 8 * k)),
+            b = (uint8_t)(c2 >> (24 - 8 * k));
+    v[k]    = ((uint16_t)a << 8) | 0x80;
+    // Modulo 65536 is fine for a negative or 0xFF00 step - the sum never leaves 0-0xFFFF.
+    step[k] = (count > 1) ? (uint16_t)(((int32_t)b - a) * 256 / (count - 1)) : 0;
+  }
+  uint8_t *p = &pixels[first * bytes];
+  while (count--) {
+    for (uint8_t k = (bytes == 3); k < 4; k++) { // No W byte on RGB; wOffset is rOffset
+      uint8_t c   = v[k] >> 8;
+      p[offs[k]]  = scale ? ((c * scale) >> 8) : c;
+      v[k]       += step[k];
+    }
+    p += bytes;
+  }
+}
+
+// Dim every pixel by amount/256 of its value (255 is all the way off).
+void tinyNeoPixel::fadeToBlackBy(uint8_t amount) {
+  if (fbMode) {
+    return;
+  }
+  uint16_t keep = 256 - amount;
+  uint8_t *p    = pixels;
+  for (uint16_t i = numBytes; i; i--) {
+    *p = (*p * keep) >> 8;
+    p++;
+  }
+}
+
+/*!
+  @brief   Set the strip to a mix of two buffers laid out like getPixels()
+           (numPixels() * 3 or 4 bytes, in the strip's byte order) - either
+           may be getPixels() itself.
+  @param   a       The "from" frame.
+  @param   b       The "to" frame.
+  @param   amount  0 for all a, 255 for (just short of) all b.
+*/
+void tinyNeoPixel::blend(const uint8_t *a, const uint8_t *b, uint8_t amount) {
+  if (fbMode) {
+    return;
+  }
+  uint16_t keep = 256 - amount; // a * keep + b * amount never exceeds 255 * 256
+  uint8_t *p    = pixels;
+  for (uint16_t i = numBytes; i; i--) {
+    *p++ = ((uint16_t)*a++ * keep + (uint16_t)*b++ * amount) >> 8;
+  }
+}
+
+/*!
+  @brief   Fill the strip with one or more cycles of hues, as Adafruit's
+           rainbow(). The hue is stepped in 16.8 fixed point from one pixel
+           to the next, rather than worked out from scratch for each.
+  @param   first_hue   Hue of the first pixel, 0-65535.
+  @param   reps        Number of cycles along the strip; negative goes the
+                       other way round the color wheel.
+  @param   saturation  From 0 (grey) to 255 (full color).
+  @param   value       From 0 to 255 (the HSV value - separate from
+                       setBrightness()).
+  @param   gammify     Apply gamma32() to each color.
+*/
+void tinyNeoPixel::rainbow(uint16_t first_hue, int8_t reps, uint8_t saturation, uint8_t value, bool gammify) {
+  if (!numLEDs) {
+    return;
+  }
+  uint32_t hue  = (uint32_t)first_hue << 8;
+  uint32_t step = (uint32_t)((reps * 16777216L) / numLEDs);
+  for (uint16_t i = 0; i < numLEDs; i++) {
+    uint32_t color = ColorHSV(hue >> 8, saturation, value);
+    setPixelColor(i, gammify ? gamma32(color) : color);
+    hue += step;
+  }
+}
+
 
 /*!
   @brief   Convert hue, saturation and value into a packed 32-bit RGB color
@@ -1081,15 +1325,24 @@ uint32_t tinyNeoPixel::ColorHSV(uint16_t hue, uint8_t sat, uint8_t val) {
 
 // Query color from previously-set pixel (returns packed 32-bit RGB value)
 uint32_t tinyNeoPixel::getPixelColor(uint16_t n) const {
-  if (n >= numLEDs) {
+  if (n >= numLEDs || fbMode == NEO_SEGMENTS) {
     return 0;  // Out of bounds, return no color.
   }
 
-  uint8_t *p;
+  const uint8_t *p;
+
+  if (fbMode) { // The palette entry it uses - brightness hasn't been applied to that
+    uint8_t bytes = (wOffset == rOffset) ? 3 : 4;
+    p = (const uint8_t *)fbTable + getPixelIndex(n) * bytes;
+    return ((bytes == 4) ? ((uint32_t)p[wOffset] << 24) : 0) |
+           ((uint32_t)p[rOffset] << 16) |
+           ((uint32_t)p[gOffset] <<  8) |
+            (uint32_t)p[bOffset];
+  }
 
   if (wOffset == rOffset) { // Is RGB-type device
     p = &pixels[n * 3];
-    if (brightness) {
+    if (brightness && !deferBrightness) {
       // Stored color was decimated by setBrightness().  Returned value
       // attempts to scale back to an approximation of the original 24-bit
       // value used when setting the pixel color, but there will always be
@@ -1106,7 +1359,7 @@ uint32_t tinyNeoPixel::getPixelColor(uint16_t n) const {
     }
   } else {                 // Is RGBW-type device
     p = &pixels[n * 4];
-    if (brightness) { // Return scaled color
+    if (brightness && !deferBrightness) { // Return scaled color
       return (((uint32_t)(p[wOffset] << 8) / brightness) << 24) |
              (((uint32_t)(p[rOffset] << 8) / brightness) << 16) |
              (((uint32_t)(p[gOffset] << 8) / brightness) <<  8) |
@@ -1151,7 +1404,9 @@ void tinyNeoPixel::setBrightness(uint8_t b) {
   // (color values are interpreted literally; no scaling), 1 = min
   // brightness (off), 255 = just below max brightness.
   uint8_t newBrightness = b + 1;
-  if (newBrightness != brightness) { // Compare against prior value
+  if (deferBrightness || fbMode) {
+    brightness = newBrightness;      // show() applies it, the buffer is left alone.
+  } else if (newBrightness != brightness) { // Compare against prior value
     // Brightness has changed -- re-scale existing data in RAM
     uint8_t  c,
             *ptr           = pixels,
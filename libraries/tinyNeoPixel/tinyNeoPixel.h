@@ -184,6 +184,17 @@ for x in range(256):
 
 typedef uint8_t  neoPixelType;
 
+// Framebuffer modes other than 3 or 4 bytes per pixel - see setPalette()
+// and setSegments(). show() expands them to color bytes as it goes.
+#define NEO_PALETTE8 8 ///< one byte per pixel, an index into the palette
+#define NEO_PALETTE4 4 ///< two pixels per byte, 16 palette entries
+#define NEO_SEGMENTS 1 ///< runs of one color, no per-pixel buffer at all
+
+typedef struct {
+  uint16_t length;     // pixels in this run
+  uint32_t color;      // packed color, as from Color()
+} neoPixelSegment;
+
 class tinyNeoPixel {
 
   public:
@@ -204,10 +215,19 @@ class tinyNeoPixel {
     setBrightness(uint8_t b),
     clear(),
     updateLength(uint16_t n),
-    updateType(neoPixelType t);
+    updateType(neoPixelType t),
+    setPalette(const uint8_t *palette, uint8_t bits),
+    setPaletteColor(uint8_t n, uint32_t c),
+    setSegments(const neoPixelSegment *segments, uint8_t count),
+    setPixelIndex(uint16_t n, uint8_t index),
+    fillGradient(uint32_t c1, uint32_t c2, uint16_t first = 0, uint16_t count = 0),
+    fadeToBlackBy(uint8_t amount),
+    blend(const uint8_t *a, const uint8_t *b, uint8_t amount),
+    rainbow(uint16_t first_hue = 0, int8_t reps = 1, uint8_t saturation = 255, uint8_t value = 255, bool gammify = true);
   uint8_t
    *getPixels(void) const,
-    getBrightness(void) const;
+    getBrightness(void) const,
+    getPixelIndex(uint16_t n) const;
   int8_t
     getPin(void) { return pin; };
   uint16_t
@@ -296,6 +316,50 @@ class tinyNeoPixel {
   */
   static uint32_t   gamma32(uint32_t x);
 
+  /*!
+    @brief   Make show() use the hardware backend (tinyNeoPixel_CCL.cpp):
+             the CCL, SPI0 and a TCB build the waveform on the LUT0 output
+             pin, and the CPU only feeds bytes to the SPI buffer, with
+             interrupts left on. Call after begin().
+    @return  false (and show() is unchanged) if the pin isn't PA6 (or PB4,
+             LUT0's alternate pin), or there is no TCB free for it.
+  */
+  /*!
+    @brief   Have show() let interrupts run between pixels, so they're
+             only held off for one pixel (30 us, or 40 for RGBW) at a
+             time, rather than the whole strip. For when beginCCL() can't
+             be used; an interrupt that takes longer than the LEDs wait
+             before latching will cut the frame short.
+  */
+  void              setInterruptible(bool on) { interruptible = on; }
+  /*!
+    @brief   Apply setBrightness() in show(), as each pixel goes out,
+             instead of to the buffer: setPixelColor() stores the color as
+             given, getPixelColor() returns it exactly, and changing the
+             brightness costs nothing until the next show(). Set it before
+             filling the buffer - the pixels already in it aren't changed.
+             With the bit-banged show(), the pixels are sent one at a time,
+             as with setInterruptible(), but only with interrupts on in
+             between if that's set too.
+  */
+  void              setDeferredBrightness(bool on) { deferBrightness = on; }
+  /*!
+    @brief   Send up to 8 strips on pins of the same port at the same time,
+             in the time one takes (tinyNeoPixel_Parallel.cpp).
+    @param   strips   The strips, begin() already called. They can be of
+                      different lengths.
+    @param   count    How many, 1 to 8.
+    @param   scratch  NULL to work out each byte's port values in the gap
+                      before it's sent (a few us per byte with interrupts
+                      off), or 8 bytes for every byte of the longest strip,
+                      to do that for the frame first, with interrupts on.
+    @return  false, and nothing sent, if they aren't all on one port, or
+             one uses a palette or segments.
+  */
+  static bool       showParallel(tinyNeoPixel *strips[], uint8_t count, uint8_t *scratch = NULL);
+  bool              beginCCL(void);
+  void              endCCL(void) { showHW = NULL; }
+
   #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERRTC_XTAL) && !defined(MILLIS_USE_TIMERRTC_XOSC))
     inline bool canShow(void) { return (micros() - endTime) >= 50L; }
   #else
@@ -305,6 +369,14 @@ class tinyNeoPixel {
 
  private:
 
+  typedef struct {     // where show() is up to, a pixel at a time
+    uint16_t px;
+    uint16_t segLeft;
+    uint8_t  seg;
+    uint8_t  color[4];
+    uint8_t  out[4];
+  } neoFrameCursor;
+
   boolean
     begun;         // true if begin() previously called
   uint16_t
@@ -320,10 +392,26 @@ class tinyNeoPixel {
     wOffset;       // Index of white byte (same as rOffset if no white)
   uint32_t
     endTime;       // Latch timing reference
+  bool
+    interruptible, // show() re-enables interrupts between pixels
+    deferBrightness; // show() applies brightness, the buffer isn't scaled
+  uint8_t
+    fbMode,        // 0, or NEO_PALETTE8/4 or NEO_SEGMENTS
+    numSegments;
+  const void
+    *fbTable;      // the palette, or the segments
   volatile uint8_t
     *port;         // Output PORT register
   uint8_t
     pinMask;       // Output PORT bitmask
+  void
+    (*showHW)(tinyNeoPixel *); // set by beginCCL(), so it's only linked in when used
+  static void
+    showCCL(tinyNeoPixel *strip);
+  void
+    colorToBytes(uint32_t c, uint8_t *p) const;
+  const uint8_t
+    *nextPixel(neoFrameCursor &c) const;
 
 };
 
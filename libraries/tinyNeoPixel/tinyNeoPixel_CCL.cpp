@@ -0,0 +1,198 @@
+/*--------------------------------------------------------------------------
+  tinyNeoPixel_CCL.cpp - a hardware WS2812 backend for tinyNeoPixel: the
+  waveform is built by the CCL from SPI0 and a TCB, and the CPU only has to
+  keep the SPI buffer fed, with interrupts left on.
+  This file is part of the tinyNeoPixel library, derived from
+  Adafruit_NeoPixel, and is free software under the GNU Lesser General
+  Public License, version 3 or later; see tinyNeoPixel.cpp.
+
+  Each LED bit is one SPI bit, MSB first, in mode 0. The SPI clock is the
+  fastest that's no faster than 900 kHz, so SCK is high for at least
+  0.55 us, and that's the high time of a 1. Every rising edge of SCK also
+  starts a TCB in single-shot mode, which is high for about 0.35 us - the
+  high time of a 0. So LUT0 outputs SCK & (MOSI | TCB):
+
+    0/1-series:  IN0 = SPI SCK,  IN1 = SPI MOSI, IN2 = TCB0 WO  truth 0xA8
+    2-series:    IN0 = TCB0 WO,  IN1 = SPI MOSI, IN2 = SPI SCK  truth 0xE0
+                 (for TCB1, IN0 = MOSI and IN1 = TCB1 WO - same truth)
+
+  LUT1 passes SCK alone to the event system, which triggers the TCB. The
+  link input isn't used, for the 0/1-series link erratum.
+
+  Everything is only borrowed while show() runs - SPI0, LUT0 and LUT1, the
+  TCB and one event channel are set up at the start and put back the way
+  they were at the end (the CCL is turned off for a moment either side, as
+  the LUTs can't be configured while it's on), so SPI0 can be used for
+  other things between frames. The SPI pins aren't used - the CCL gets SCK
+  and MOSI from inside the SPI - but if they're outputs, the data appears
+  on them too.
+  -------------------------------------------------------------------------*/
+
+#include "tinyNeoPixel.h"
+
+#if !defined(TINYNEOPIXEL_CCL_TCB) // a TCB that millis isn't using; only TCB0 can reach IN2 on the 0/1-series.
+  #if !defined(MILLIS_USE_TIMERB0)
+    #define TINYNEOPIXEL_CCL_TCB 0
+  #elif MEGATINYCORE_SERIES == 2 && defined(TCB1) && !defined(MILLIS_USE_TIMERB1)
+    #define TINYNEOPIXEL_CCL_TCB 1
+  #endif
+#endif
+
+#if defined(TINYNEOPIXEL_CCL_TCB) && defined(CCL) && (F_CPU >= 4000000UL)
+
+  #if TINYNEOPIXEL_CCL_TCB == 1
+    #define _CCL_TCB            TCB1
+    #define _CCL_EVENT_USER     EVSYS_USERTCB1CAPT
+  #else
+    #define _CCL_TCB            TCB0
+    #define _CCL_EVENT_USER     EVSYS_USERTCB0CAPT
+  #endif
+
+  #if MEGATINYCORE_SERIES == 2
+    #define _CCL_EVENT_CHANNEL  EVSYS_CHANNEL4         // wiring_analog_trigger.c has channel 5
+    #define _CCL_EVENT_GEN      EVSYS_CHANNEL4_CCL_LUT1_gc
+    #define _CCL_EVENT_USER_CH  EVSYS_USER_CHANNEL4_gc
+    #define _CCL_PORTMUX        PORTMUX.CCLROUTEA
+    #define _CCL_PORTMUX_LUT0   (1 << 0)
+    #if TINYNEOPIXEL_CCL_TCB == 1
+      #define _CCL_LUT0_INSEL01 ((0x0C << CCL_INSEL1_gp) | 0x09)  // IN0 = SPI MOSI, IN1 = TCB1 WO
+    #else
+      #define _CCL_LUT0_INSEL01 ((0x09 << CCL_INSEL1_gp) | 0x0C)  // IN0 = TCB0 WO, IN1 = SPI MOSI
+    #endif
+    #define _CCL_LUT0_INSEL2    0x09                   // IN2 = SPI SCK
+    #define _CCL_LUT0_TRUTH     0xE0                   // IN2 & (IN1 | IN0)
+    #define _CCL_LUT1_INSEL01   0x00
+    #define _CCL_LUT1_INSEL2    0x09                   // SCK
+    #define _CCL_LUT1_TRUTH     0x10                   // IN2
+  #else
+    #define _CCL_EVENT_CHANNEL  EVSYS_ASYNCCH1
+    #define _CCL_EVENT_GEN      EVSYS_ASYNCCH1_CCL_LUT1_gc
+    #define _CCL_EVENT_USER_CH  EVSYS_ASYNCUSER0_ASYNCCH1_gc  // the same value for every async user
+    #define _CCL_PORTMUX        PORTMUX.CTRLA
+    #define _CCL_PORTMUX_LUT0   (1 << 4)
+    #define _CCL_LUT0_INSEL01   ((0x0B << CCL_INSEL1_gp) | 0x0B)  // IN0 = SPI SCK, IN1 = SPI MOSI
+    #define _CCL_LUT0_INSEL2    0x07                   // IN2 = TCB0 WO
+    #define _CCL_LUT0_TRUTH     0xA8                   // IN0 & (IN1 | IN2)
+    #define _CCL_LUT1_INSEL01   0x0B                   // SCK
+    #define _CCL_LUT1_INSEL2    0x00
+    #define _CCL_LUT1_TRUTH     0x02                   // IN0
+  #endif
+
+  // The SPI prescaler for the fastest SCK that's no faster than 900 kHz.
+  #if   F_CPU <= 1800000UL
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV4_gc | SPI_CLK2X_bm)
+  #elif F_CPU <= 3600000UL
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV4_gc)
+  #elif F_CPU <= 7200000UL
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV16_gc | SPI_CLK2X_bm)
+  #elif F_CPU <= 14400000UL
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV16_gc)
+  #elif F_CPU <= 28800000UL
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV64_gc | SPI_CLK2X_bm)
+  #elif F_CPU <= 57600000UL
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV64_gc)
+  #else
+    #define _CCL_SPI_PRESC      (SPI_PRESC_DIV128_gc)
+  #endif
+
+  // T0H - 0.35 us of CLK_PER, rounded; at 4 MHz that's 1 tick, and with the event latency, still short enough.
+  #define _CCL_T0H_TICKS        ((F_CPU / 1000000UL * 35 + 50) / 100)
+
+  bool tinyNeoPixel::beginCCL(void) {
+    if (pin != PIN_PA6
+      #if defined(PIN_PB4)
+        && pin != PIN_PB4
+      #endif
+    ) {
+      return false;             // not a LUT0 output pin.
+    }
+    showHW = &tinyNeoPixel::showCCL;
+    return true;
+  }
+
+  void tinyNeoPixel::showCCL(tinyNeoPixel *strip) {
+    uint8_t oldCCL     = CCL.CTRLA;
+    uint8_t oldMux     = _CCL_PORTMUX;
+    uint8_t oldChannel = _CCL_EVENT_CHANNEL;
+    uint8_t oldUser    = _CCL_EVENT_USER;
+    uint8_t oldSPIA    = SPI0.CTRLA;
+    uint8_t oldSPIB    = SPI0.CTRLB;
+    uint8_t oldSPIINT  = SPI0.INTCTRL;
+
+    CCL.CTRLA          = 0;
+    CCL.LUT0CTRLA      = 0;
+    CCL.LUT1CTRLA      = 0;
+    CCL.LUT0CTRLB      = _CCL_LUT0_INSEL01;
+    CCL.LUT0CTRLC      = _CCL_LUT0_INSEL2;
+    CCL.TRUTH0         = _CCL_LUT0_TRUTH;
+    CCL.LUT1CTRLB      = _CCL_LUT1_INSEL01;
+    CCL.LUT1CTRLC      = _CCL_LUT1_INSEL2;
+    CCL.TRUTH1         = _CCL_LUT1_TRUTH;
+    #if defined(PIN_PB4)
+    if (strip->pin == PIN_PB4) {
+      _CCL_PORTMUX     = oldMux | _CCL_PORTMUX_LUT0;
+    } else
+    #endif
+    {
+      _CCL_PORTMUX     = oldMux & ~_CCL_PORTMUX_LUT0;
+    }
+    _CCL_EVENT_CHANNEL = _CCL_EVENT_GEN;
+    _CCL_EVENT_USER    = _CCL_EVENT_USER_CH;
+
+    _CCL_TCB.CTRLA     = 0;
+    _CCL_TCB.CTRLB     = TCB_CNTMODE_SINGLE_gc | TCB_CCMPEN_bm;
+    _CCL_TCB.EVCTRL    = TCB_CAPTEI_bm;         // start on the rising edge
+    _CCL_TCB.INTCTRL   = 0;
+    _CCL_TCB.CCMP      = _CCL_T0H_TICKS;
+    _CCL_TCB.CNT       = _CCL_T0H_TICKS;        // at TOP - stopped, and low, until the first edge.
+    _CCL_TCB.CTRLA     = TCB_CLKSEL_DIV1_gc | TCB_ENABLE_bm;
+
+    CCL.LUT1CTRLA      = CCL_ENABLE_bm;
+    CCL.LUT0CTRLA      = CCL_OUTEN_bm | CCL_ENABLE_bm;
+    CCL.CTRLA          = CCL_ENABLE_bm;
+
+    SPI0.CTRLA         = 0;
+    SPI0.INTCTRL       = 0;
+    SPI0.CTRLB         = SPI_BUFEN_bm | SPI_BUFWR_bm | SPI_SSD_bm | SPI_MODE_0_gc;
+    SPI0.CTRLA         = SPI_MASTER_bm | _CCL_SPI_PRESC | SPI_ENABLE_bm;
+    SPI0.INTFLAGS      = SPI_TXCIF_bm;
+
+    // With two bytes of buffer, an interrupt can take as long as about 2 bytes (20-30 us) without leaving a gap long
+    // enough to latch; anything shorter just stretches the low time of a bit, which the LEDs don't mind.
+    neoFrameCursor cursor = {0, 0, 0, {0}, {0}};
+    uint8_t chunk      = (strip->wOffset == strip->rOffset) ? 3 : 4;
+    for (uint16_t i = strip->numLEDs; i; i--) {
+      const uint8_t *ptr = strip->nextPixel(cursor);
+      for (uint8_t k = chunk; k; k--) {
+        while (!(SPI0.INTFLAGS & SPI_DREIF_bm));
+        SPI0.DATA      = *ptr++;
+      }
+    }
+    while (!(SPI0.INTFLAGS & SPI_TXCIF_bm));   // the last bit is out, and SCK is low again.
+
+    CCL.CTRLA          = 0;
+    CCL.LUT0CTRLA      = 0;                     // the pin goes back to the PORT, which has it low.
+    CCL.LUT1CTRLA      = 0;
+    _CCL_TCB.CTRLA     = 0;
+    _CCL_EVENT_USER    = oldUser;
+    _CCL_EVENT_CHANNEL = oldChannel;
+    _CCL_PORTMUX       = oldMux;
+    (void) SPI0.DATA;                           // empty the receive buffer, so nothing after us reads our bytes.
+    (void) SPI0.DATA;
+    SPI0.CTRLA         = 0;
+    SPI0.CTRLB         = oldSPIB;
+    SPI0.INTCTRL       = oldSPIINT;
+    SPI0.CTRLA         = oldSPIA;
+    CCL.CTRLA          = oldCCL;
+    #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERRTC_XTAL) && !defined(MILLIS_USE_TIMERRTC_XOSC))
+      strip->endTime   = micros();
+    #endif
+  }
+#else
+  bool tinyNeoPixel::beginCCL(void) {
+    return false;               // millis has the TCB this needs, or the clock is too slow to time a 0.
+  }
+  void tinyNeoPixel::showCCL(__attribute__((unused)) tinyNeoPixel *strip) {
+    ;
+  }
+#endif
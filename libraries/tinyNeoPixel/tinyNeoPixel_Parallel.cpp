@@ -0,0 +1,124 @@
+/*--------------------------------------------------------------------------
+  tinyNeoPixel_Parallel.cpp - up to 8 strips on the same port, sent at once.
+  This file is part of the tinyNeoPixel library, derived from
+  Adafruit_NeoPixel, and is free software under the GNU Lesser General
+  Public License, version 3 or later; see tinyNeoPixel.cpp.
+
+  Each bit is three whole-port stores, as in show(): every strip's pin high,
+  then high only for the strips whose bit is a 1, then all low. The middle
+  value comes from a byte per bit with the pin masks of those strips - the
+  strips' bytes transposed. That's done either a byte at a time, while the
+  line is low between bytes, or for the whole frame beforehand into a
+  scratch buffer, with interrupts on, if one is passed.
+
+  Rather than a hand-tuned block for every clock speed, the gaps between
+  the stores are .rept runs of nops, worked out from F_CPU.
+  -------------------------------------------------------------------------*/
+
+#include "tinyNeoPixel.h"
+
+#define _PAR_CYCLES(ns)  ((F_CPU / 1000000UL * (ns) + 500) / 1000)
+#define _PAR_MAX(a, b)   ((a) > (b) ? (a) : (b))
+// st, ld, or come before the second store, and st, sbiw, brne after the third.
+#define _PAR_T0H         _PAR_MAX(_PAR_CYCLES(350), 4)
+#define _PAR_T1H         _PAR_MAX(_PAR_CYCLES(800), _PAR_T0H + 1)
+#define _PAR_BIT         _PAR_MAX(_PAR_CYCLES(1250), _PAR_T1H + 5)
+
+typedef struct {
+  const uint8_t *pixels;
+  uint16_t       bytes;
+  uint8_t        pinMask;
+} neoParallelStrip;
+
+// Send count bits, one mask byte each, with interrupts already off.
+static void parallelSend(volatile uint8_t *port, const uint8_t *masks, uint16_t count, uint8_t hi, uint8_t lo) {
+  uint8_t v;
+  __asm__ __volatile__(
+    "1:"                          "\n\t" // Clk
+    "st   %a[port], %[hi]"        "\n\t" // 1    all the pins high   (T = 0)
+    "ld   %[v], %a[ptr]+"         "\n\t" // 2    v = mask for this bit
+    "or   %[v], %[lo]"            "\n\t" // 1    v |= the other pins
+    ".rept %[d1]\n\tnop\n\t.endr" "\n\t" //      (T = T0H)
+    "st   %a[port], %[v]"         "\n\t" // 1    low for the 0s
+    ".rept %[d2]\n\tnop\n\t.endr" "\n\t" //      (T = T1H)
+    "st   %a[port], %[lo]"        "\n\t" // 1    all low
+    ".rept %[d3]\n\tnop\n\t.endr" "\n\t"
+    "sbiw %[count], 1"            "\n\t" // 2
+    "brne 1b"                     "\n"   // 2    (T = one bit)
+    : [ptr]   "+e" (masks),
+      [count] "+w" (count),
+      [v]     "=&r" (v)
+    : [port]  "e" (port),
+      [hi]    "r" (hi),
+      [lo]    "r" (lo),
+      [d1]    "I" (_PAR_T0H - 4),
+      [d2]    "I" (_PAR_T1H - _PAR_T0H - 1),
+      [d3]    "I" (_PAR_BIT - _PAR_T1H - 5)
+    : "memory");
+}
+
+// The 8 port masks for byte n of each strip - a strip that's shorter gets 0s, which go nowhere.
+static void parallelTranspose(uint8_t *masks, const neoParallelStrip *strips, uint8_t count, uint16_t n) {
+  memset(masks, 0, 8);
+  for (uint8_t s = 0; s < count; s++) {
+    if (n < strips[s].bytes) {
+      uint8_t b  = strips[s].pixels[n];
+      uint8_t pm = strips[s].pinMask;
+      for (uint8_t k = 0; k < 8; k++) {
+        if (b & 0x80) {
+          masks[k] |= pm;
+        }
+        b <<= 1;
+      }
+    }
+  }
+}
+
+bool tinyNeoPixel::showParallel(tinyNeoPixel *strips[], uint8_t count, uint8_t *scratch) {
+  if (!count || count > 8) {
+    return false;
+  }
+  neoParallelStrip list[8];
+  volatile uint8_t *port = strips[0]->port;
+  uint8_t  pins  = 0;
+  uint16_t bytes = 0;
+  for (uint8_t s = 0; s < count; s++) {
+    tinyNeoPixel *strip = strips[s];
+    if (strip->port != port || !strip->pixels || strip->fbMode || strip->pin >= NUM_DIGITAL_PINS) {
+      return false;         // not all on one port, or not a plain 3/4 byte per pixel buffer.
+    }
+    list[s].pixels  = strip->pixels;
+    list[s].bytes   = strip->numBytes;
+    list[s].pinMask = strip->pinMask;
+    pins           |= strip->pinMask;
+    if (strip->numBytes > bytes) {
+      bytes = strip->numBytes;
+    }
+    while (!strip->canShow());
+  }
+  if (scratch) {            // all of it now, while interrupts are still on.
+    for (uint16_t n = 0; n < bytes; n++) {
+      parallelTranspose(scratch + n * 8, list, count, n);
+    }
+  }
+  noInterrupts();
+  uint8_t lo = *port & ~pins;
+  uint8_t hi = *port |  pins;
+  if (scratch) {
+    parallelSend(port, scratch, bytes * 8, hi, lo);
+  } else {
+    uint8_t masks[8];
+    for (uint16_t n = 0; n < bytes; n++) {
+      parallelTranspose(masks, list, count, n);
+      parallelSend(port, masks, 8, hi, lo);
+    }
+  }
+  interrupts();
+  #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC) && !defined(MILLIS_USE_TIMERRTC_XTAL) && !defined(MILLIS_USE_TIMERRTC_XOSC))
+    uint32_t now = micros();
+    for (uint8_t s = 0; s < count; s++) {
+      strips[s]->endTime = now;
+    }
+  #endif
+  return true;
+}
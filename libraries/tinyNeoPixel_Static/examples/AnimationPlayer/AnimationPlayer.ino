@@ -0,0 +1,41 @@
+/* AnimationPlayer - plays a light animation stored in flash, with tinyNeoPixelAnimation
+ * A red dot with a dim tail bounces along 8 LEDs, 20 frames a second. The frames were made with
+ *   python3 tools/neopixel_anim.py bounce.json -n 8 --name bounce
+ * from a JSON list of 16 frames of 8 "RRGGBB" colors each: 175 bytes, where the frames themselves would be 384.
+ * The millis ISR counts the frames and update() decodes them, so loop() is otherwise free.
+ */
+
+#include <tinyNeoPixel_Static.h>
+#include <tinyNeoPixelAnimation.h>
+
+#define PIN            PIN_PA6
+#define NUMPIXELS      8
+
+byte pixels[NUMPIXELS * 3];
+tinyNeoPixel leds = tinyNeoPixel(NUMPIXELS, PIN, NEO_GRB, pixels);
+tinyNeoPixelAnimation player(leds);
+
+// 16 frames of 8 pixels (GRB): 175 bytes, from 384 uncompressed
+const uint8_t bounce[175] = {
+  0x40, 0x20, 0xFF, 0x00, 0x00, 0x41, 0x10, 0x20, 0x00, 0x20, 0xFF, 0x00, 0x00, 0x42, 0x00, 0x00,
+  0x00, 0x10, 0x20, 0x00, 0x20, 0xFF, 0x00, 0x00, 0x01, 0x42, 0x00, 0x00, 0x00, 0x10, 0x20, 0x00,
+  0x20, 0xFF, 0x00, 0x00, 0x02, 0x42, 0x00, 0x00, 0x00, 0x10, 0x20, 0x00, 0x20, 0xFF, 0x00, 0x00,
+  0x03, 0x42, 0x00, 0x00, 0x00, 0x10, 0x20, 0x00, 0x20, 0xFF, 0x00, 0x00, 0x04, 0x42, 0x00, 0x00,
+  0x00, 0x10, 0x20, 0x00, 0x20, 0xFF, 0x00, 0x00, 0x05, 0x42, 0x00, 0x00, 0x00, 0x10, 0x20, 0x00,
+  0x20, 0xFF, 0x00, 0x00, 0x06, 0x40, 0x00, 0x00, 0x00, 0x00, 0x06, 0x41, 0x20, 0xFF, 0x00, 0x10,
+  0x20, 0x00, 0x00, 0x05, 0x42, 0x20, 0xFF, 0x00, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04,
+  0x41, 0x20, 0xFF, 0x00, 0x10, 0x20, 0x00, 0x81, 0x00, 0x00, 0x00, 0x00, 0x03, 0x41, 0x20, 0xFF,
+  0x00, 0x10, 0x20, 0x00, 0x82, 0x00, 0x00, 0x00, 0x00, 0x02, 0x41, 0x20, 0xFF, 0x00, 0x10, 0x20,
+  0x00, 0x83, 0x00, 0x00, 0x00, 0x00, 0x01, 0x41, 0x20, 0xFF, 0x00, 0x10, 0x20, 0x00, 0x84, 0x00,
+  0x00, 0x00, 0x00, 0x41, 0x20, 0xFF, 0x00, 0x10, 0x20, 0x00, 0x85, 0x00, 0x00, 0x00, 0x00,
+};
+
+void setup() {
+  pinMode(PIN, OUTPUT);
+  player.begin(bounce, sizeof(bounce), 50);   // a frame every 50 ms, looping
+}
+
+void loop() {
+  player.update();
+  // ... anything else - as long as it comes back here at least once a frame, no frames are dropped.
+}
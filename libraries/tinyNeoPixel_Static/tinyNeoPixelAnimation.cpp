@@ -0,0 +1,132 @@
+/* tinyNeoPixelAnimation.cpp - plays delta-compressed animations from flash into a tinyNeoPixel_Static buffer
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 3 like the rest of tinyNeoPixel, please see LICENSE.md for details
+ */
+
+#include "tinyNeoPixelAnimation.h"
+
+#if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+  volatile uint8_t tinyNeoPixelAnimation::_due;
+
+  void tinyNeoPixelAnimation::_tick() {   // from the millis ISR
+    if (_due != 255) {
+      _due++;
+    }
+  }
+#endif
+
+bool tinyNeoPixelAnimation::begin(const uint8_t *animation, uint16_t length, uint16_t frameMs, bool loop) {
+  stop();
+  _start   = animation;
+  _next    = animation;
+  _end     = animation + length;
+  _ms      = frameMs;
+  _loop    = loop;
+  _bpp     = _strip.bytesPerPixel();
+  _frame   = 0;
+  #if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+    _due   = 1;                          // the first frame goes out at the first update().
+    _timer = timerAdd(_tick, frameMs, TIMER_PERIODIC);
+    if (_timer < 0) {
+      return false;
+    }
+  #elif defined(MILLIS_USE_TIMERRTC)
+    _last  = millis() - frameMs;
+  #endif
+  _playing = true;
+  return true;
+}
+
+void tinyNeoPixelAnimation::stop() {
+  #if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+    if (_timer >= 0) {
+      timerCancel(_timer);
+      _timer = -1;
+    }
+  #endif
+  _playing = false;
+}
+
+/* Applies the next frame to the buffer. False at the end of an animation that doesn't loop, or if the frame runs off
+ * the end of the strip (the animation was made for a longer one), which stops it there. */
+bool tinyNeoPixelAnimation::_decode() {
+  uint8_t       *pixels = _strip.getPixels();
+  uint8_t       *p      = pixels;
+  uint8_t       *end    = pixels + _strip.numPixels() * _bpp;
+  if (_next >= _end) {
+    if (!_loop) {
+      stop();
+      return false;
+    }
+    _next  = _start;
+    _frame = 0;
+  }
+  if (_next == _start) {
+    memset(pixels, 0, end - pixels);     // the first frame is the changes from all off.
+  }
+  const uint8_t *s = _next;
+  uint8_t        c;
+  while ((c = *s++)) {
+    if (c < 0x40) {                      // skip
+      p += c * _bpp;
+      continue;
+    }
+    uint16_t n = (c < 0x80) ? ((c & 0x3F) + 1) : ((c & 0x7F) + 1);
+    if (p + n * _bpp > end) {
+      stop();
+      return false;
+    }
+    if (c < 0x80) {                      // literal pixels
+      n *= _bpp;
+      memcpy(p, s, n);
+      p += n;
+      s += n;
+    } else {                             // one color, n times
+      do {
+        for (uint8_t i = 0; i < _bpp; i++) {
+          *p++ = s[i];
+        }
+      } while (--n);
+      s += _bpp;
+    }
+  }
+  _next = s;
+  _frame++;
+  return true;
+}
+
+bool tinyNeoPixelAnimation::update() {
+  if (!_playing) {
+    return false;
+  }
+  uint8_t due;
+  #if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+    uint8_t oldSREG = SREG;
+    cli();
+    due  = _due;
+    _due = 0;
+    SREG = oldSREG;
+  #elif defined(MILLIS_USE_TIMERRTC)
+    due  = 0;
+    while ((uint32_t)(millis() - _last) >= _ms && due != 255) {
+      _last += _ms;
+      due++;
+    }
+  #else
+    due  = 1;
+  #endif
+  if (!due) {
+    return false;
+  }
+  bool decoded = false;
+  while (due--) {
+    if (!_decode()) {
+      break;
+    }
+    decoded = true;
+  }
+  if (decoded) {
+    _strip.show();
+  }
+  return decoded;
+}
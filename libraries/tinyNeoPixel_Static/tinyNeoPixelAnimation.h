@@ -0,0 +1,66 @@
+/* tinyNeoPixelAnimation.h - plays delta-compressed animations from flash into a tinyNeoPixel_Static buffer
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 3 like the rest of tinyNeoPixel, please see LICENSE.md for details
+ *
+ * Each frame is stored as the changes from the one before it: runs of pixels to leave alone, to copy from the
+ * animation, or to fill with one color - so the decoder only writes the bytes that change, straight into the pixel
+ * buffer, and a frame where little moves costs a handful of bytes of flash. The bytes are in the strip's own order
+ * (GRB, say), as they go in the buffer; tools/neopixel_anim.py makes them from RGB frames. All the flash is mapped
+ * on these parts, so the animation is just a const array - no PROGMEM, and no pgm_read_byte() in the decoder.
+ *
+ * Frames are timed by the timer service (timerAdd() - see Ref_Timers.md); its ISR only counts them, and update(),
+ * from loop(), decodes any that are due and calls show(). With the RTC as millis timer, update() watches millis()
+ * instead, and with millis disabled, it plays a frame every time it's called.
+ *
+ * The format: a frame is a series of ops, ended by a 0:
+ *   0x01-0x3F  skip that many pixels
+ *   0x40-0x7F  (n & 0x3F) + 1 pixels follow, bytes per pixel each
+ *   0x80-0xFF  (n & 0x7F) + 1 pixels are all set to the one pixel that follows
+ * The first frame is decoded onto a cleared buffer; the rest of the frame after the last op is left as it was.
+ */
+
+#ifndef TINYNEOPIXELANIMATION_H
+#define TINYNEOPIXELANIMATION_H
+
+#include <Arduino.h>
+#include "tinyNeoPixel_Static.h"
+
+class tinyNeoPixelAnimation {
+  public:
+    tinyNeoPixelAnimation(tinyNeoPixel &strip) : _strip(strip) {}
+    /* Start playing length bytes of animation, a frame every frameMs ms. Only one animation plays at a time - the
+     * timer service's callbacks take no argument. False if no timer was free. */
+    bool     begin(const uint8_t *animation, uint16_t length, uint16_t frameMs, bool loop = true);
+    void     stop();
+    /* Call from loop(). If a frame is due, decodes it (and any others missed since - only the latest is shown)
+     * and calls show(); returns whether it did. */
+    bool     update();
+    bool     playing() {
+      return _playing;
+    }
+    uint16_t frame() {             // the number of the frame in the buffer, from 0
+      return _frame - 1;
+    }
+
+  private:
+    bool     _decode();
+
+    tinyNeoPixel   &_strip;
+    const uint8_t  *_start;
+    const uint8_t  *_next;         // the next frame
+    const uint8_t  *_end;
+    uint16_t        _frame     = 0;
+    uint16_t        _ms;
+    uint8_t         _bpp;
+    bool            _loop;
+    bool            _playing   = false;
+    #if !defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC)
+      int8_t        _timer     = -1;
+      static void     _tick();
+      static volatile uint8_t _due;
+    #elif defined(MILLIS_USE_TIMERRTC)
+      uint32_t      _last;
+    #endif
+};
+
+#endif
@@ -0,0 +1,270 @@
+/* tinyNeoPixelT.h - tinyNeoPixel with the pixel type, pin and length fixed at compile time
+ * Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+ * Free Software - LGPL 3 like the rest of tinyNeoPixel, please see LICENSE.md for details
+ *
+ *   tinyNeoPixelT<NEO_GRB + NEO_KHZ800, PIN_PA3, 30> leds;
+ *
+ * The byte order and pixel size are template parameters, so setPixelColor() is three or four stores to fixed
+ * offsets, with no offsets to load. The buffer is a member, so it's counted with the rest of RAM when the sketch is
+ * compiled, like tinyNeoPixel_Static's. The pin is one too, so show() drives it with SBI/CBI on its VPORT, and that
+ * leaves the other pins on the port alone. The bit timing is worked out from F_CPU at compile time: 350 ns high for
+ * a 0 and 750 ns for a 1, in 1250 ns bits. That suits the WS2812B and SK6812 alike, so one loop covers every clock
+ * speed from 8 MHz up, in place of the separate hand-timed code for each of them.
+ * The latch wait and the rest of the API are as in tinyNeoPixel_Static.
+ */
+
+#ifndef TINYNEOPIXELT_H
+#define TINYNEOPIXELT_H
+
+#include <Arduino.h>
+#include "tinyNeoPixel_Static.h"
+
+/* port * 8 + bit for a pin number, or 0xFF - the variant's tables aren't visible to the sketch, so can't be used in
+ * a constant expression. */
+constexpr uint8_t _neoPinCode(uint8_t pin) {
+  #if defined(PIN_PA0)
+    if (pin == PIN_PA0) return 0x00;
+  #endif
+  #if defined(PIN_PA1)
+    if (pin == PIN_PA1) return 0x01;
+  #endif
+  #if defined(PIN_PA2)
+    if (pin == PIN_PA2) return 0x02;
+  #endif
+  #if defined(PIN_PA3)
+    if (pin == PIN_PA3) return 0x03;
+  #endif
+  #if defined(PIN_PA4)
+    if (pin == PIN_PA4) return 0x04;
+  #endif
+  #if defined(PIN_PA5)
+    if (pin == PIN_PA5) return 0x05;
+  #endif
+  #if defined(PIN_PA6)
+    if (pin == PIN_PA6) return 0x06;
+  #endif
+  #if defined(PIN_PA7)
+    if (pin == PIN_PA7) return 0x07;
+  #endif
+  #if defined(PIN_PB0)
+    if (pin == PIN_PB0) return 0x08;
+  #endif
+  #if defined(PIN_PB1)
+    if (pin == PIN_PB1) return 0x09;
+  #endif
+  #if defined(PIN_PB2)
+    if (pin == PIN_PB2) return 0x0A;
+  #endif
+  #if defined(PIN_PB3)
+    if (pin == PIN_PB3) return 0x0B;
+  #endif
+  #if defined(PIN_PB4)
+    if (pin == PIN_PB4) return 0x0C;
+  #endif
+  #if defined(PIN_PB5)
+    if (pin == PIN_PB5) return 0x0D;
+  #endif
+  #if defined(PIN_PB6)
+    if (pin == PIN_PB6) return 0x0E;
+  #endif
+  #if defined(PIN_PB7)
+    if (pin == PIN_PB7) return 0x0F;
+  #endif
+  #if defined(PIN_PC0)
+    if (pin == PIN_PC0) return 0x10;
+  #endif
+  #if defined(PIN_PC1)
+    if (pin == PIN_PC1) return 0x11;
+  #endif
+  #if defined(PIN_PC2)
+    if (pin == PIN_PC2) return 0x12;
+  #endif
+  #if defined(PIN_PC3)
+    if (pin == PIN_PC3) return 0x13;
+  #endif
+  #if defined(PIN_PC4)
+    if (pin == PIN_PC4) return 0x14;
+  #endif
+  #if defined(PIN_PC5)
+    if (pin == PIN_PC5) return 0x15;
+  #endif
+  return 0xFF;
+}
+
+constexpr uint8_t _neoCycles(uint16_t ns) {
+  return (uint8_t)(((F_CPU / 100000UL) * ns + 5000) / 10000);
+}
+
+template <neoPixelType type, uint8_t pin, uint16_t count>
+class tinyNeoPixelT {
+    static constexpr uint8_t  _w    = (type >> 6) & 0b11;
+    static constexpr uint8_t  _r    = (type >> 4) & 0b11;
+    static constexpr uint8_t  _g    = (type >> 2) & 0b11;
+    static constexpr uint8_t  _b    =  type       & 0b11;
+    static constexpr bool     _rgbw = (_w != _r);
+    static constexpr uint8_t  _bpp  = _rgbw ? 4 : 3;
+    static constexpr uint8_t  _code = _neoPinCode(pin);
+    static constexpr uint8_t  _vport = _code >> 3;     // VPORTn is at n * 4: DIR, then OUT
+    static constexpr uint8_t  _bit  = _code & 7;
+    /* Cycles from the SBI to the first CBI, to the second, and to the next SBI are D0 + 2, D0 + D1 + 3, and
+     * D0 + D1 + D2 + 8, so those are what's left over for NOPs. Between bytes, the line stays low a few clocks more. */
+    static constexpr uint8_t  _t0   = (_neoCycles(350) < 2) ? 2 : _neoCycles(350);
+    static constexpr uint8_t  _d0   = _t0 - 2;
+    static constexpr uint8_t  _t1   = (_neoCycles(750) < _d0 + 3) ? _d0 + 3 : _neoCycles(750);
+    static constexpr uint8_t  _d1   = _t1 - 3 - _d0;
+    static constexpr uint8_t  _tp   = (_neoCycles(1250) < _d0 + _d1 + 8) ? _d0 + _d1 + 8 : _neoCycles(1250);
+    static constexpr uint8_t  _d2   = _tp - 8 - _d0 - _d1;
+    static_assert(_code != 0xFF, "tinyNeoPixelT requires a pin that exists on this part");
+    static_assert(count > 0, "tinyNeoPixelT requires at least one pixel");
+    static_assert(F_CPU >= 7400000UL, "tinyNeoPixelT requires a clock speed of 8 MHz or more");
+
+  public:
+    uint8_t pixels[count * _bpp] = {0};
+
+    void begin() {                 // the pin to output, with a single SBI - no pinMode() needed.
+      *(volatile uint8_t *)(_vport * 4) |= 1 << _bit;
+    }
+
+    void show() {
+      while (!canShow());
+      uint8_t       *ptr  = pixels;
+      uint16_t       left = sizeof(pixels);
+      uint8_t        byte, bit;
+      uint8_t        oldSREG = SREG;
+      cli();
+      __asm__ __volatile__ (
+       "1:"                                         "\n\t"
+        "ld   %[byte], %a[ptr]+"                    "\n\t"
+        "ldi  %[bit],  8"                           "\n\t"
+       "2:"                                         "\n\t"
+        "sbi  %[out],  %[pin]"                      "\n\t" // high
+        ".rept %[d0]"  "\n\t" "nop" "\n\t" ".endr"  "\n\t"
+        "sbrs %[byte], 7"                           "\n\t"
+        "cbi  %[out],  %[pin]"                      "\n\t" // low here for a 0...
+        ".rept %[d1]"  "\n\t" "nop" "\n\t" ".endr"  "\n\t"
+        "cbi  %[out],  %[pin]"                      "\n\t" // ...and here for a 1
+        "lsl  %[byte]"                              "\n\t"
+        ".rept %[d2]"  "\n\t" "nop" "\n\t" ".endr"  "\n\t"
+        "dec  %[bit]"                               "\n\t"
+        "brne 2b"                                   "\n\t"
+        "sbiw %[left], 1"                           "\n\t"
+        "brne 1b"                                   "\n"
+        : [ptr]  "+e" (ptr),
+          [left] "+w" (left),
+          [byte] "=&r" (byte),
+          [bit]  "=&d" (bit)
+        : [out]  "I" (_vport * 4 + 1),
+          [pin]  "I" (_bit),
+          [d0]   "n" (_d0),
+          [d1]   "n" (_d1),
+          [d2]   "n" (_d2));
+      SREG = oldSREG;
+      #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC))
+        _endTime = micros();
+      #endif
+    }
+    #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC))
+      bool canShow() {
+        return (micros() - _endTime) >= 50L;
+      }
+    #else
+      bool canShow() {
+        return 1;                  // we don't have micros here;
+      }
+    #endif
+
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+      if (n < count) {
+        uint8_t *p = &pixels[n * _bpp];
+        p[_r] = _scale(r);
+        p[_g] = _scale(g);
+        p[_b] = _scale(b);
+        if (_rgbw) {
+          p[_w] = 0;
+        }
+      }
+    }
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+      if (n < count) {
+        uint8_t *p = &pixels[n * _bpp];
+        p[_r] = _scale(r);
+        p[_g] = _scale(g);
+        p[_b] = _scale(b);
+        if (_rgbw) {
+          p[_w] = _scale(w);
+        }
+      }
+    }
+    void setPixelColor(uint16_t n, uint32_t c) {
+      setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c, (uint8_t)(c >> 24));
+    }
+    uint32_t getPixelColor(uint16_t n) const {
+      if (n >= count) {
+        return 0;
+      }
+      const uint8_t *p = &pixels[n * _bpp];
+      uint32_t c = ((uint32_t)_unscale(p[_r]) << 16) | ((uint16_t)_unscale(p[_g]) << 8) | _unscale(p[_b]);
+      if (_rgbw) {
+        c |= (uint32_t)_unscale(p[_w]) << 24;
+      }
+      return c;
+    }
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t n = 0) {
+      uint16_t end = (n == 0 || first + n > count) ? count : first + n;
+      for (uint16_t i = first; i < end; i++) {
+        setPixelColor(i, c);
+      }
+    }
+    void clear() {
+      memset(pixels, 0, sizeof(pixels));
+    }
+    /* As in tinyNeoPixel_Static: applied as colors are set, and the buffer is rescaled when it changes. */
+    void setBrightness(uint8_t b) {
+      uint8_t newBrightness = b + 1;
+      if (newBrightness != _brightness) {
+        uint8_t  oldBrightness = _brightness - 1;
+        uint16_t scale;
+        if (oldBrightness == 0) {
+          scale = 0;
+        } else if (b == 255) {
+          scale = 65535 / oldBrightness;
+        } else {
+          scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
+        }
+        for (uint16_t i = 0; i < sizeof(pixels); i++) {
+          pixels[i] = (pixels[i] * scale) >> 8;
+        }
+        _brightness = newBrightness;
+      }
+    }
+    uint8_t getBrightness() const {
+      return _brightness - 1;
+    }
+    uint8_t *getPixels() {
+      return pixels;
+    }
+    static constexpr uint16_t numPixels() {
+      return count;
+    }
+    static constexpr uint8_t bytesPerPixel() {
+      return _bpp;
+    }
+    static constexpr uint8_t getPin() {
+      return pin;
+    }
+
+  private:
+    uint8_t  _scale(uint8_t c) const {
+      return _brightness ? (c * _brightness) >> 8 : c;
+    }
+    uint8_t  _unscale(uint8_t c) const {
+      return _brightness ? ((uint16_t)c << 8) / _brightness : c;
+    }
+
+    uint8_t  _brightness = 0;      // stored + 1, so 0 is full and no scaling
+    #if (!defined(MILLIS_USE_TIMERNONE) && !defined(MILLIS_USE_TIMERRTC))
+      uint32_t _endTime  = 0;
+    #endif
+};
+
+#endif
@@ -210,6 +210,7 @@ class tinyNeoPixel {
   uint32_t
     getPixelColor(uint16_t n) const;
   uint8_t getPin(void) { return pin; }
+  uint8_t bytesPerPixel(void) const { return (wOffset == rOffset) ? 3 : 4; }
   void begin(void) {return;}
   /*!
     @brief   An 8-bit integer sine wave function, not directly compatible
@@ -0,0 +1,152 @@
+#!/usr/bin/python3
+
+# -*- coding: utf-8 -*-
+"""
+Report how much of the flash and RAM of a sketch goes to each part of the
+core - UART, millis, ADC, Wire, Print, String, interrupts and so on - so
+that the cost of a tools menu option like printf or attachInterrupt mode
+can be seen, not just the total that avr-size gives.
+
+Every symbol with a size is put down to the file it was defined in, which
+avr-nm gets from the debug information, and the file (or, for library
+code with no line numbers, the name) decides which part it counts
+against. With LTO, anything that gets inlined counts against what it was
+inlined into - which for code called only once is often setup() or loop()
+- so treat the sketch line as "this and whatever it pulled in". What's
+left, like the vector table, is the difference from the avr-size total.
+
+Run from platform.txt after every build, with the path to the toolchain
+and the ELF; the report is printed, and saved next to the ELF with the
+extension .size.txt.
+"""
+import os
+import argparse
+import re
+import subprocess
+
+# (name, files, symbols) - the first that matches either, wins
+SUBSYSTEMS = [
+    ("UART",         r"UART\w*\.(c|cpp)|HardwareSerial\.\w+",        r"Serial|UartClass|__vector_USART"),
+    ("millis",       r"wiring\.c|TimerService\.c|Tasks\.c",          r"millis|micros|^delay|__vector_(TCA0_HUNF|TCA0_OVF|TCB\d_INT|TCD0_OVF|RTC_CNT)"),
+    ("ADC",          r"wiring_analog\w*\.c",                         r"analog|__vector_ADC"),
+    ("Wire",         r"Wire\w*\.cpp|twi\w*\.c",                      r"TwoWire|__vector_TWI"),
+    ("SPI",          r"SPI\w*\.cpp|USARTSPI\.cpp",                   r"SPIClass|__vector_SPI"),
+    ("Print",        r"Print\.cpp|Stream\.cpp|itoa\.\w+",            r"printf|dtostr|ultoa|ltoa|utoa|itoa|__ftoa"),
+    ("String",       r"WString\.cpp|String\.cpp",                    r"^String::"),
+    ("interrupts",   r"WInterrupts\w*\.c",                           r"attachInterrupt|detachInterrupt|__vector_PORT"),
+    ("digital I/O",  r"wiring_digital\.c|wiring_pulse\.\w+|wiring_shift\.c", r"pinMode|digitalWrite|digitalRead|pulseIn|shiftIn|shiftOut"),
+    ("other core",   r"cores[/\\]",                                  r"^$"),
+    ("sketch",       r"\.ino(\.cpp)?$",                              r"^(setup|loop)$"),
+    ("math",         r"^$",                                          r"^__\w*(sf|df|si|di)\d|^(sqrt|pow|exp|log|sin|cos|tan|atan|fmod|floor|ceil|round)f?$"),
+]
+OTHER = "other libraries"
+
+FLASH_TYPES = "tTwWrR"
+DATA_TYPES  = "dD"            # in RAM, and their initial values in flash
+BSS_TYPES   = "bBvV"
+
+
+class FootprintException(Exception):
+    pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+
+    parser.add_argument("-t", "--tools",
+                        type=str,
+                        default="",
+                        help="Directory with avr-nm and avr-size, with the trailing separator (default: on the PATH).")
+
+    parser.add_argument("--nosave",
+                        action="store_true",
+                        help="Only print the report.")
+
+    parser.add_argument("elf",
+                        type=str,
+                        help="ELF file of the sketch.")
+
+    args = parser.parse_args()
+
+    try:
+        report = format_report(*footprint(args.tools, args.elf))
+        print(report)
+        if not args.nosave:
+            with open(os.path.splitext(args.elf)[0] + ".size.txt", "w") as f:
+                f.write(report + "\n")
+    except (FootprintException, OSError) as e:
+        # only a report, so it never fails the build
+        print("No size report: {}".format(e))
+
+
+def run(tool, *args):
+    result = subprocess.run([tool] + list(args), stdout=subprocess.PIPE, universal_newlines=True)
+    if result.returncode:
+        raise FootprintException("{} failed".format(os.path.basename(tool)))
+    return result.stdout
+
+
+def sections(tools, elf):
+    """ flash and RAM totals, worked out the same way as the IDE's """
+    sizes = {}
+    for line in run(tools + "avr-size", "-A", elf).splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    flash = sum(sizes.get(s, 0) for s in (".text", ".data", ".rodata", ".bootloader"))
+    ram = sum(sizes.get(s, 0) for s in (".data", ".bss", ".noinit"))
+    return flash, ram
+
+
+def symbols(tools, elf):
+    """ (name, size, type, source file or "") for every symbol with a size, largest first """
+    found = []
+    for line in run(tools + "avr-nm", "--size-sort", "--reverse-sort", "--print-size",
+                    "--line-numbers", "--demangle", elf).splitlines():
+        # address size type name[<tab>file:line]
+        fields = line.split(None, 3)
+        if len(fields) < 4:
+            continue
+        name, _, source = fields[3].partition("\t")
+        source = source.rsplit(":", 1)[0]
+        found.append((name, int(fields[1], 16), fields[2], source))
+    return found
+
+
+def subsystem(name, source):
+    for sub, files, names in SUBSYSTEMS:
+        if source and re.search(files, source):
+            return sub
+    for sub, files, names in SUBSYSTEMS:
+        if re.search(names, name):
+            return sub
+    return OTHER
+
+
+def footprint(tools, elf):
+    total_flash, total_ram = sections(tools, elf)
+    flash = {}
+    ram = {}
+    for name, size, kind, source in symbols(tools, elf):
+        sub = subsystem(name, source)
+        if kind in FLASH_TYPES or kind in DATA_TYPES:
+            flash[sub] = flash.get(sub, 0) + size
+        if kind in DATA_TYPES or kind in BSS_TYPES:
+            ram[sub] = ram.get(sub, 0) + size
+    return flash, ram, total_flash, total_ram
+
+
+def format_report(flash, ram, total_flash, total_ram):
+    names = [s[0] for s in SUBSYSTEMS] + [OTHER]
+    lines = ["{:<16}{:>8}{:>8}".format("Size by part", "flash", "RAM")]
+    for name in names:
+        if name in flash or name in ram:
+            lines.append("{:<16}{:>8}{:>8}".format(name, flash.get(name, 0), ram.get(name, 0)))
+    lines.append("{:<16}{:>8}{:>8}".format("unattributed", total_flash - sum(flash.values()),
+                                           total_ram - sum(ram.values())))
+    lines.append("{:<16}{:>8}{:>8}".format("total", total_flash, total_ram))
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    main()
@@ -503,7 +503,7 @@ class Backend(object):
 
         return self.programmer.read_memory(memory_name=memory_name, offset=offset_byte, numbytes=numbytes, max_chunk_size=max_chunk_size)
 
-    def write_memory(self, data, memory_name=MemoryNames.FLASH, offset_byte=0, blocksize=0, pagewrite_delay=0):
+    def write_memory(self, data, memory_name=MemoryNames.FLASH, offset_byte=0, blocksize=0, pagewrite_delay=0, delta=False, pipeline=0):
         """
         Write target device memory
 
@@ -512,6 +512,10 @@ class Backend(object):
         :param data: bytearray of raw data bytes to write
         :param blocksize: max number of bytes to send at a time. Ignored if 0 or omitted, and not passed
             to write_memory; only serialupdi supports this.
+        :param delta: only write the flash pages that differ from what's already there, for use without a chip
+            erase; only serialupdi supports this.
+        :param pipeline: write flash pages without a round trip each, checking the NVM status every this many pages
+            (0: off); only serialupdi, on tinyAVR and megaAVR 0-series, supports this.
 
         :raises: PymcuprogToolConnectionError if not connected to any tool (connect_to_tool not run)
         :raises: PymcuprogSessionError if a session has not been started (session_start not run)
@@ -520,7 +524,9 @@ class Backend(object):
         """
         self._is_tool_not_connected_raise()
         self._is_session_not_active_raise()
-        if blocksize == 0:
+        if delta or pipeline:
+            self.programmer.write_memory(data=data, memory_name=memory_name, offset=offset_byte, blocksize=blocksize, pagewrite_delay=pagewrite_delay, delta=delta, pipeline=pipeline)
+        elif blocksize == 0:
             self.programmer.write_memory(data=data, memory_name=memory_name, offset=offset_byte, pagewrite_delay=pagewrite_delay)
         else:
             self.programmer.write_memory(data=data, memory_name=memory_name, offset=offset_byte, blocksize=blocksize, pagewrite_delay=pagewrite_delay)
@@ -2,7 +2,13 @@
 Module providing read and write functionality towards hex files with data intended for target device memories
 """
 import copy
+import hashlib
+import io
 import os
+import struct
+import tempfile
+import threading
+import zlib
 from array import array
 from collections import namedtuple
 from intelhex import IntelHex
@@ -13,6 +19,105 @@ except ImportError:
 
 from .deviceinfo.deviceinfokeys import DeviceMemoryInfoKeys, DeviceInfoKeys
 
+# Parsed hex files, by path, with the size and modification time they had - so programming several targets at once
+# (see prog.py) parses the image once rather than once per target and action. Only ever read once parsed.
+_hexfile_cache = {}
+_hexfile_cache_lock = threading.Lock()
+
+# Across runs, the contents of each hex file seen are kept as binary in the temp directory, named for the hash and size
+# of the hex text - flashing the same image over and over then skips parsing it. Set to None to turn that off.
+hexcache_dir = os.path.join(tempfile.gettempdir(), "pymcuprog-hexcache")
+
+# Cache file: magic, number of segments, then for each one its start address, length and data, followed by the
+# CRC-32 of every HEXCACHE_PAGE bytes of it (the smallest flash page there is, which larger pages are a multiple of)
+# so a damaged cache file is never used.
+HEXCACHE_MAGIC = b'PMHC\x01'
+HEXCACHE_PAGE = 64
+
+def load_hexfile(filename):
+    """
+    Parse a hex file, or return the IntelHex already parsed from it if the file hasn't changed since
+
+    :param filename: Name/path of hex file to read from
+    :returns: IntelHex instance, which must not be modified
+    """
+    path = os.path.abspath(filename)
+    stat = os.stat(path)
+    key = (stat.st_size, stat.st_mtime_ns)
+    with _hexfile_cache_lock:
+        cached = _hexfile_cache.get(path)
+        if cached is None or cached[0] != key:
+            with open(path, 'rb') as hexfile_raw:
+                text = hexfile_raw.read()
+            cache_path = None
+            if hexcache_dir is not None:
+                cache_path = os.path.join(hexcache_dir, "{}-{}.bin".format(hashlib.sha256(text).hexdigest(), len(text)))
+            hexfile = _read_hexcache(cache_path) if cache_path else None
+            if hexfile is None:
+                hexfile = IntelHex()
+                hexfile.loadhex(io.StringIO(text.decode('ascii')))
+                if cache_path:
+                    _write_hexcache(cache_path, hexfile)
+            cached = (key, hexfile)
+            _hexfile_cache[path] = cached
+    return cached[1]
+
+def page_crcs(data):
+    """
+    CRC-32 of each HEXCACHE_PAGE bytes of data, the last one possibly short
+
+    :param data: bytes
+    :returns: list of CRCs
+    """
+    return [zlib.crc32(data[num:num + HEXCACHE_PAGE]) for num in range(0, len(data), HEXCACHE_PAGE)]
+
+def _read_hexcache(cache_path):
+    # An IntelHex built from the cache file, or None if there's no usable one
+    try:
+        with open(cache_path, 'rb') as cache:
+            raw = cache.read()
+    except OSError:
+        return None
+    if not raw.startswith(HEXCACHE_MAGIC):
+        return None
+    hexfile = IntelHex()
+    try:
+        position = len(HEXCACHE_MAGIC)
+        count, = struct.unpack_from('<I', raw, position)
+        position += 4
+        for _ in range(count):
+            start, length = struct.unpack_from('<II', raw, position)
+            position += 8
+            data = raw[position:position + length]
+            position += length
+            n_pages = (length + HEXCACHE_PAGE - 1) // HEXCACHE_PAGE
+            crcs = list(struct.unpack_from('<{}I'.format(n_pages), raw, position))
+            position += 4 * n_pages
+            if len(data) != length or crcs != page_crcs(data):
+                return None
+            hexfile.frombytes(data, offset=start)
+    except struct.error:
+        return None
+    return hexfile
+
+def _write_hexcache(cache_path, hexfile):
+    # Best effort - if the cache can't be written, the hex file just gets parsed again next time
+    raw = bytearray(HEXCACHE_MAGIC)
+    segments = hexfile.segments()
+    raw += struct.pack('<I', len(segments))
+    for start, stop in segments:
+        data = hexfile.tobinstr(start=start, end=stop - 1)
+        crcs = page_crcs(data)
+        raw += struct.pack('<II', start, len(data)) + data + struct.pack('<{}I'.format(len(crcs)), *crcs)
+    try:
+        os.makedirs(os.path.dirname(cache_path), exist_ok=True)
+        temp_path = "{}.{}".format(cache_path, os.getpid())
+        with open(temp_path, 'wb') as cache:
+            cache.write(raw)
+        os.replace(temp_path, cache_path)
+    except OSError:
+        pass
+
 def write_memories_to_hex(filename, memory_segments):
     """
     Write a collection of memory segments to a hex file
@@ -56,8 +161,7 @@ def read_memories_from_hex(filename, device_memory_info):
         of raw data bytes, offset is the start address within the memory the data starts at and memory_info
         is a dictionary with the memory info as defined in pymcuprog.deviceinfo.deviceinfo
     """
-    hexfile = IntelHex()
-    hexfile.fromfile(filename, format='hex')
+    hexfile = load_hexfile(filename)
 
     memory_segments = []
     for segment in hexfile.segments():
@@ -109,13 +213,11 @@ def verify_flash_from_hex(hex_filename, backend, max_read_chunk=None):
     :param backend: Reference to the Backend class of pymcuprog
     :returns: Boolean value indicating success or failure of the operation
     """
-    hexfile = IntelHex(hex_filename)
+    hexfile = load_hexfile(hex_filename)
     segments = hexfile.segments()
 
     for i in range(len(segments)):
-        segment_data = []
-        for j in range(segments[i][1]-segments[i][0]):
-            segment_data.append(hexfile[segments[i][0]+j])
+        segment_data = list(hexfile.tobinarray(start=segments[i][0], end=segments[i][1] - 1))
 
         verify_status = backend.verify_memory(segment_data, 'flash', segments[i][0], max_read_chunk=max_read_chunk)
         if verify_status is False:
@@ -11,6 +11,9 @@ from .deviceinfo import deviceinfo
 from .deviceinfo.deviceinfokeys import DeviceInfoKeysAvr, DeviceMemoryInfoKeys
 from .deviceinfo.memorynames import MemoryNames
 from .serialupdi.application import UpdiApplication
+from .serialupdi.nvm import NvmUpdiTinyMega
+from .serialupdi import constants
+from .serialupdi.timeout import Timeout
 
 import math
 
@@ -97,13 +100,17 @@ class NvmAccessProviderSerial(NvmAccessProvider):
             self.logger.error("Device is locked. Performing unlock with chip erase.\nError: ('%s')", inst)
             self.avr.unlock()
 
-    def write(self, memory_info, offset, data, blocksize=0, pagewrite_delay=0):
+    def write(self, memory_info, offset, data, blocksize=0, pagewrite_delay=0, delta=False, pipeline=0):
         """
         Write the memory with data
 
         :param memory_info: dictionary for the memory as provided by the DeviceMemoryInfo class
         :param offset: relative offset within the memory type
         :param data: the data to program
+        :param delta: (flash only) read back what's there, and erase/write only the pages that differ -
+            for use without a chip erase.
+        :param pipeline: (flash, tinyAVR/megaAVR 0-series) write the pages back to back with no round trip each, and
+            check the NVM status every this many pages - for use after a chip erase.
         :return: None
         """
         # Make sure the data is aligned to a memory page
@@ -113,9 +120,22 @@ class NvmAccessProviderSerial(NvmAccessProvider):
                                                        memory_info[DeviceMemoryInfoKeys.WRITE_SIZE])
         memtype_string = memory_info[DeviceMemoryInfoKeys.NAME]
 
+        if delta and memtype_string == MemoryNames.FLASH:
+            self.write_delta(memory_info, offset_aligned, data_aligned, blocksize, pagewrite_delay)
+            return
+
         offset_aligned += memory_info[DeviceMemoryInfoKeys.ADDRESS]
 
-        if memtype_string in (MemoryNames.FLASH, MemoryNames.EEPROM, MemoryNames.FUSES):
+        if pipeline and memtype_string == MemoryNames.FLASH and hasattr(self.avr.nvm, 'write_flash_pipelined'):
+            page_size = memory_info[DeviceMemoryInfoKeys.PAGE_SIZE]
+            pages = [(offset_aligned + num, data_aligned[num:num + page_size])
+                     for num in range(0, len(data_aligned), page_size)]
+            self.logger.debug("Writing %d pages from address 0x%06X, pipelined", len(pages), offset_aligned)
+            self.avr.nvm.write_flash_pipelined(pages, pagewrite_delay=pagewrite_delay, check_every=pipeline,
+                                               blocksize=blocksize if blocksize and blocksize > 0 else None)
+            return
+
+        if memtype_string in (MemoryNames.FLASH, MemoryNames.EEPROM, MemoryNames.FUSES, MemoryNames.USER_ROW):
             write_chunk_size = memory_info[DeviceMemoryInfoKeys.PAGE_SIZE]
         else:
             write_chunk_size = len(data_aligned)
@@ -131,6 +151,8 @@ class NvmAccessProviderSerial(NvmAccessProvider):
                 self.avr.nvm.write_fuse(offset_aligned, chunk)
             elif memtype_string == MemoryNames.EEPROM:
                 self.avr.nvm.write_eeprom(offset_aligned, chunk)
+            elif memtype_string == MemoryNames.USER_ROW:
+                self.avr.nvm.write_user_row(offset_aligned, chunk)
             else:
                 # Spence Konde, 5/8/2021:
                 # As far as I can tell, this is the only point where, we're writing a hex file, we know both the page size
@@ -177,6 +199,36 @@ class NvmAccessProviderSerial(NvmAccessProvider):
             data_aligned = data_aligned[write_chunk_size:]
             bar.step()
 
+    def write_delta(self, memory_info, offset_aligned, data_aligned, blocksize=0, pagewrite_delay=0):
+        """
+        Write only the flash pages whose contents differ from data
+
+        The flash is read back first (which, as reads are done in big blocks, is far quicker than writing it), then
+        each page that is different is erased and written on its own; the rest are left alone. The target does have
+        CRCSCAN, but that only reports pass/fail for a whole section against a checksum stored at its end, so it can't
+        say which pages changed.
+
+        :param memory_info: dictionary for the memory as provided by the DeviceMemoryInfo class
+        :param offset_aligned: page aligned offset within the flash
+        :param data_aligned: whole pages of data
+        """
+        page_size = memory_info[DeviceMemoryInfoKeys.PAGE_SIZE]
+        current = self.read(memory_info, offset_aligned, len(data_aligned))
+        address = offset_aligned + memory_info[DeviceMemoryInfoKeys.ADDRESS]
+        changed = 0
+        for page in range(0, len(data_aligned), page_size):
+            chunk = data_aligned[page:page + page_size]
+            if bytearray(current[page:page + page_size]) == bytearray(chunk):
+                continue
+            self.logger.debug("Page at 0x%06X differs, writing it", address + page)
+            if blocksize == 0:
+                self.avr.nvm.write_flash(address + page, chunk, pagewrite_delay=pagewrite_delay, erase=True)
+            else:
+                self.avr.nvm.write_flash(address + page, chunk, blocksize=blocksize, pagewrite_delay=pagewrite_delay,
+                                         erase=True)
+            changed += 1
+        print("{} of {} pages differed and were written".format(changed, len(data_aligned) // page_size))
+
     def read(self, memory_info, offset, numbytes, max_read_chunk=None):
         """
         Read the memory in chunks
@@ -206,6 +258,13 @@ class NvmAccessProviderSerial(NvmAccessProvider):
                 read_chunk_size = 0x200
 
         # SACRIFICES SPEED FOR COMPATIBILITY - above line should happen whenever --limitreadsize=1  command line parameter is not passed, so we can only turn it on for specific tools -> programmer options that have this weird limitation. I couldn't propagate it through this mess!
+
+        # Big reads without a chunk size limit go through the bulk path: the same blocks, each one a single command
+        # with no ACK to wait for. It's still read in chunks here, just so the progress bar moves.
+        use_bulk = max_read_chunk is None and numbytes > 0x100
+        if use_bulk:
+            read_chunk_size = 0x1000
+
         n_chunk = math.ceil(numbytes/read_chunk_size)
         bar = progress_bar.ProgressBar(n_chunk, hide=n_chunk == 1)
 
@@ -213,7 +272,9 @@ class NvmAccessProviderSerial(NvmAccessProvider):
             if numbytes < read_chunk_size:
                 read_chunk_size = numbytes
             self.logger.debug("Reading %d bytes from address 0x%06X", read_chunk_size, offset)
-            if use_word_access:
+            if use_bulk:
+                data += self.avr.read_data_bulk(offset, read_chunk_size, use_word_access and not read_chunk_size & 1)
+            elif use_word_access:
                 data += self.avr.read_data_words(offset, read_chunk_size>> 1)
             else:
                 data += self.avr.read_data(offset, read_chunk_size)
@@ -223,6 +284,43 @@ class NvmAccessProviderSerial(NvmAccessProvider):
 
         return data
 
+    def crc_check_flash(self, timeout_ms=500):
+        """
+        Have the target's CRCSCAN check the whole flash (tinyAVR and megaAVR 0-series). It passes if the flash ends
+        in the CRC-16/CCITT (polynomial 0x1021, from 0xFFFF) of everything before it, high byte first.
+
+        :param timeout_ms: how long to wait for it to finish
+        :return: True if it passed, False if it failed, None if it couldn't be run (another family, or it never
+            started - then a readback is the only way to verify)
+        """
+        if not isinstance(self.avr.nvm, NvmUpdiTinyMega):
+            return None
+        readwrite = self.avr.readwrite
+        readwrite.write_byte(constants.UPDI_CRCSCAN_ADDRESS + constants.UPDI_CRCSCAN_CTRLA,
+                             constants.UPDI_CRCSCAN_CTRLA_RESET)
+        readwrite.write_byte(constants.UPDI_CRCSCAN_ADDRESS + constants.UPDI_CRCSCAN_CTRLB,
+                             constants.UPDI_CRCSCAN_CTRLB_SRC_FLASH)
+        readwrite.write_byte(constants.UPDI_CRCSCAN_ADDRESS + constants.UPDI_CRCSCAN_CTRLA,
+                             constants.UPDI_CRCSCAN_CTRLA_ENABLE)
+        timeout = Timeout(timeout_ms)
+        while not timeout.expired():
+            status = readwrite.read_byte(constants.UPDI_CRCSCAN_ADDRESS + constants.UPDI_CRCSCAN_STATUS)
+            if not status & constants.UPDI_CRCSCAN_STATUS_BUSY:
+                break
+        else:
+            self.logger.info("CRCSCAN still busy after %d ms", timeout_ms)
+            return None
+        enabled = readwrite.read_byte(constants.UPDI_CRCSCAN_ADDRESS + constants.UPDI_CRCSCAN_CTRLA)
+        readwrite.write_byte(constants.UPDI_CRCSCAN_ADDRESS + constants.UPDI_CRCSCAN_CTRLA,
+                             constants.UPDI_CRCSCAN_CTRLA_RESET)
+        if status & constants.UPDI_CRCSCAN_STATUS_OK:
+            return True
+        if not enabled & constants.UPDI_CRCSCAN_CTRLA_ENABLE:
+            # The enable didn't take - the peripheral can't be reached from here on this part
+            self.logger.info("CRCSCAN could not be started")
+            return None
+        return False
+
     def hold_in_reset(self):
         """
         Hold device in reset
@@ -149,13 +149,15 @@ class Programmer:
             memory_info = self.device_memory_info.memory_info_by_name(memory_name)
         self.device_model.erase(memory_info=memory_info, address=address)
 
-    def write_memory(self, data, memory_name, offset=0, blocksize=0, pagewrite_delay=0):
+    def write_memory(self, data, memory_name, offset=0, blocksize=0, pagewrite_delay=0, delta=False, pipeline=0):
         """
         Write memory on the device
 
         :param data: data to write
         :param memory_name: memory type to write
         :param offset: offset/address within that region to write
+        :param delta: write only the pages that differ from what's there (serialupdi only)
+        :param pipeline: write flash pages without a round trip each, checking every this many (serialupdi only)
         :return: boolean status
 
         :raises: ValueError if trying to write outside the specified memory
@@ -184,7 +186,9 @@ class Programmer:
 
         # Write the data to NVM
         self.logger.info("Writing %d bytes of data to %s...", len(data), memory[DeviceMemoryInfoKeys.NAME])
-        if blocksize == 0:
+        if delta or pipeline:
+            self.device_model.write(memory, offset, data, blocksize=blocksize, pagewrite_delay=pagewrite_delay, delta=delta, pipeline=pipeline)
+        elif blocksize == 0:
             self.device_model.write(memory, offset, data, pagewrite_delay=pagewrite_delay)
         else:
             self.device_model.write(memory, offset, data, blocksize=blocksize, pagewrite_delay=pagewrite_delay)
@@ -18,6 +18,7 @@ from .deviceinfo.deviceinfokeys import DeviceMemoryInfoKeys
 
 from .utils import print_tool_info, showdata, verify_flash_from_bin, compare
 from .hexfileutils import write_memories_to_hex, write_memory_to_hex, read_memories_from_hex, verify_flash_from_hex
+from .serialupdi.constants import UPDI_BAUD_AUTO
 from .pymcuprog_errors import PymcuprogNotSupportedError, PymcuprogSessionConfigError, \
     PymcuprogToolConnectionError, PymcuprogDeviceLockedError
 
@@ -337,7 +338,8 @@ def _action_write(backend, args):
 
             print("Writing from hex file...")
 
-            _write_memory_segments(backend, result, args.verify, blocksize=args.blocksize, pagewrite_delay=args.pagewrite_delay)
+            _write_memory_segments(backend, result, args.verify, blocksize=args.blocksize, pagewrite_delay=args.pagewrite_delay,
+                                   delta=getattr(args, 'delta', False), pipeline=getattr(args, 'pipeline', 0))
         else:
             with open(filepath, "rb") as binfile:
                 data_from_file = bytearray(binfile.read())
@@ -366,7 +368,7 @@ def _action_write(backend, args):
     return STATUS_SUCCESS
 
 
-def _write_memory_segments(backend, memory_segments, verify, blocksize = 0, pagewrite_delay=0):
+def _write_memory_segments(backend, memory_segments, verify, blocksize = 0, pagewrite_delay=0, delta=False, pipeline=0):
     """
     Write content of list of memory segments
 
@@ -380,11 +382,17 @@ def _write_memory_segments(backend, memory_segments, verify, blocksize = 0, page
         the page size of the target chip, which can imcrease write speed more than 10:1. Any other number will
         be used as supplied. Even numbers up to the page size are recommended.
         Any other negative number is invalid, and is zero'ed out.
+    :param delta: If True, only flash pages that differ from what is there are written (serialupdi, no chip erase)
+    :param pipeline: If not 0, flash pages are written without a round trip each, and the NVM status checked every
+        this many pages (serialupdi, after a chip erase)
     """
     for segment in memory_segments:
         memory_name = segment.memory_info[DeviceMemoryInfoKeys.NAME]
         print("Writing {}...".format(memory_name))
-        backend.write_memory(segment.data, memory_name, segment.offset, blocksize=blocksize, pagewrite_delay=pagewrite_delay)
+        if delta or pipeline:
+            backend.write_memory(segment.data, memory_name, segment.offset, blocksize=blocksize, pagewrite_delay=pagewrite_delay, delta=delta, pipeline=pipeline)
+        else:
+            backend.write_memory(segment.data, memory_name, segment.offset, blocksize=blocksize, pagewrite_delay=pagewrite_delay)
         if verify:
             print("Verifying {}...".format(memory_name))
             verify_ok = backend.verify_memory(segment.data, memory_name, segment.offset)
@@ -510,7 +518,10 @@ def _start_session(backend, device, args):
     # -c clock argument
     # allow Hz, or kHz ending in 'k' (eg: 100k) or MHz ending in 'M' eg (1M)
     if args.clk:
-        if args.clk[-1] == 'k':
+        if args.clk == 'auto':
+            # serialupdi: find the fastest rate that works
+            clk = UPDI_BAUD_AUTO
+        elif args.clk[-1] == 'k':
             clk = int(args.clk.strip('k')) * 1000
         elif args.clk[-1] == 'M':
             clk = int(args.clk.strip('M')) * 1000000
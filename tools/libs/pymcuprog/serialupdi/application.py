@@ -1,7 +1,10 @@
 """
 Application layer for UPDI stack
 """
+import json
+import os
 from logging import getLogger
+from serial.tools import list_ports
 from pymcuprog.pymcuprog_errors import PymcuprogError
 from . import constants
 from .link import UpdiDatalink16bit, UpdiDatalink24bit
@@ -55,6 +58,92 @@ def decode_sib(sib):
     return sib_info
 
 
+# Per adapter, the fastest rate tune_baud() found last time - tried first, so it doesn't have to search every time
+BAUD_MEMORY_FILE = os.path.join(os.path.expanduser("~"), ".pymcuprog", "serialupdi_baud.json")
+
+
+def _adapter_id(port):
+    # The USB serial number if the adapter has one, otherwise what kind it is and where it's plugged in
+    for info in list_ports.comports():
+        if info.device == port:
+            if info.serial_number:
+                return info.serial_number
+            if info.vid is not None:
+                return "{:04X}:{:04X}@{}".format(info.vid, info.pid, info.location or port)
+    return port
+
+
+def _load_baud_memory():
+    try:
+        with open(BAUD_MEMORY_FILE) as memory:
+            return json.load(memory)
+    except (OSError, ValueError):
+        return {}
+
+
+def _save_baud_memory(memory):
+    # Best effort - if it can't be saved, it's found again next time
+    try:
+        os.makedirs(os.path.dirname(BAUD_MEMORY_FILE), exist_ok=True)
+        with open(BAUD_MEMORY_FILE, 'w') as memory_file:
+            json.dump(memory, memory_file, indent=1, sort_keys=True)
+    except OSError:
+        pass
+
+
+def _baud_works(datalink, physical, baud, reference):
+    """
+    Switch to a rate, and check that a few status reads and the SIB come back the same as they did at a safe one
+    """
+    try:
+        datalink.change_baud(baud)
+        for _ in range(3):
+            if datalink.ldcs(constants.UPDI_CS_STATUSA) != reference[0]:
+                return False
+        physical.send([constants.UPDI_PHY_SYNC, constants.UPDI_KEY | constants.UPDI_KEY_SIB | constants.UPDI_SIB_16BYTES])
+        return physical.receive(16) == reference[1]
+    except PymcuprogError:
+        return False
+
+
+def tune_baud(datalink, physical):
+    """
+    Find the fastest rate in UPDI_AUTO_BAUD_RATES that the adapter and target manage, starting from 115200: step up
+    until one fails, then go back to the last good one. change_baud() sets the UPDI clock for each rate so that the
+    target can keep up. The guard time is left at 2 cycles, the least there is. The result is remembered for (the
+    serial number of) this adapter; next time, that rate is checked first and used if it still works.
+    :return: the rate settled on
+    """
+    logger = getLogger(__name__)
+    reference_sib = [constants.UPDI_PHY_SYNC, constants.UPDI_KEY | constants.UPDI_KEY_SIB | constants.UPDI_SIB_16BYTES]
+    physical.send(reference_sib)
+    reference = (datalink.ldcs(constants.UPDI_CS_STATUSA), physical.receive(16))
+    if len(reference[1]) != 16:
+        raise PymcuprogError("Can't read the SIB at 115200 baud")
+
+    adapter = _adapter_id(physical.port)
+    memory = _load_baud_memory()
+    remembered = memory.get(adapter)
+    if remembered and _baud_works(datalink, physical, remembered, reference):
+        logger.info("Using %d baud, as last time for adapter %s", remembered, adapter)
+        return remembered
+
+    best = 115200
+    for baud in constants.UPDI_AUTO_BAUD_RATES:
+        if not _baud_works(datalink, physical, baud, reference):
+            logger.info("%d baud failed", baud)
+            break
+        best = baud
+    # Whatever state the failed attempt left it in, start over and go to the rate that worked.
+    physical.send_double_break()
+    datalink.init_datalink()
+    datalink.change_baud(best)
+    logger.info("Best rate for adapter %s: %d baud", adapter, best)
+    memory[adapter] = best
+    _save_baud_memory(memory)
+    return best
+
+
 class UpdiApplication:
     """
     Generic application layer for UPDI
@@ -66,7 +155,7 @@ class UpdiApplication:
         # Build the UPDI stack:
         # Create a physical
 
-        baud_temp = min(baud, 115200)
+        baud_temp = 115200 if baud == constants.UPDI_BAUD_AUTO else min(baud, 115200)
         self.phy = UpdiPhysical(serialport, baud_temp)
 
         # Create a DL - use 16-bit until otherwise known
@@ -79,7 +168,10 @@ class UpdiApplication:
         datalink.init_datalink()
 
         # set the actual baud
-        datalink.change_baud(baud)
+        if baud == constants.UPDI_BAUD_AUTO:
+            baud = tune_baud(datalink, self.phy)
+        else:
+            datalink.change_baud(baud)
 
         # Create a read write access layer using this data link
         self.readwrite = UpdiReadWrite(datalink)
@@ -146,6 +238,15 @@ class UpdiApplication:
         """
         return self.readwrite.read_data_words(address, words)
 
+    def read_data_bulk(self, address, size, use_word_access=False):
+        """
+        Reads any number of bytes of data from UPDI, with as few round trips as it can
+        :param address: address to read from
+        :param size: number of bytes to read
+        :param use_word_access: read 16-bit words (flash)
+        """
+        return self.readwrite.read_data_bulk(address, size, use_word_access)
+
     def write_data_words(self, address, data):
         """
         Writes a number of words to memory
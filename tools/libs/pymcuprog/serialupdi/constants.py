@@ -44,6 +44,22 @@ UPDI_PHY_ACK = 0x40
 
 UPDI_MAX_REPEAT_SIZE = (0xFF+1) # Repeat counter of 1-byte, with off-by-one counting
 
+# CRCSCAN (tinyAVR 0/1/2-series, megaAVR 0-series)
+UPDI_CRCSCAN_ADDRESS = 0x0120
+UPDI_CRCSCAN_CTRLA = 0x00
+UPDI_CRCSCAN_CTRLB = 0x01
+UPDI_CRCSCAN_STATUS = 0x02
+UPDI_CRCSCAN_CTRLA_ENABLE = 0x01
+UPDI_CRCSCAN_CTRLA_RESET = 0x80
+UPDI_CRCSCAN_CTRLB_SRC_FLASH = 0x00
+UPDI_CRCSCAN_STATUS_BUSY = 0x01
+UPDI_CRCSCAN_STATUS_OK = 0x02
+
+# Baud rate that asks for the fastest one that works to be found (see UpdiApplication.tune_baud())
+UPDI_BAUD_AUTO = -1
+# Rates tried, in order
+UPDI_AUTO_BAUD_RATES = [230400, 345600, 460800, 921600, 1000000, 1500000]
+
 # CS and ASI Register Address map
 UPDI_CS_STATUSA = 0x00
 UPDI_CS_STATUSB = 0x01
@@ -99,9 +115,14 @@ UPDI_V0_NVMCTRL_CTRLA_CHIP_ERASE = 0x05
 UPDI_V0_NVMCTRL_CTRLA_ERASE_EEPROM = 0x06
 UPDI_V0_NVMCTRL_CTRLA_WRITE_FUSE = 0x07
 
+# Time allowed for a flash page write (no erase - after a chip erase) when pipelining, in ms. Deliberately on the long
+# side: it's paid once per page, and a write that was cut short would only be found by the verify.
+UPDI_V0_PAGE_WRITE_TIME_MS = 3
+
 # NVMCTRL v1 CTRLA
 UPDI_V1_NVMCTRL_CTRLA_NOCMD = 0x00
 UPDI_V1_NVMCTRL_CTRLA_FLASH_WRITE = 0x02
+UPDI_V1_NVMCTRL_CTRLA_FLASH_PAGE_ERASE = 0x08
 UPDI_V1_NVMCTRL_CTRLA_EEPROM_ERASE_WRITE = 0x13
 UPDI_V1_NVMCTRL_CTRLA_CHIP_ERASE = 0x20
 
@@ -2,6 +2,7 @@
 Link layer in UPDI protocol stack
 """
 from logging import getLogger
+import math
 
 from pymcuprog.pymcuprog_errors import PymcuprogError
 from . import constants
@@ -117,6 +118,23 @@ class UpdiDatalink:
                             constants.UPDI_DATA_16])
         return self.updi_phy.receive(words << 1)
 
+    def ld_ptr_block_RSD(self, address, beats, data_16=False):
+        """
+        Set the pointer, and load a block from there with post-increment, as a single command - RSD must be on already
+        (see rsd()), so there's no ACK to wait for after the pointer is set. The host then only has to wait once,
+        for the data.
+        :param address: address to start from
+        :param beats: number of bytes (or words, with data_16) to load, no more than UPDI_MAX_REPEAT_SIZE
+        :param data_16: load words rather than bytes
+        :return: values read
+        """
+        self.logger.debug("LD%d block of %d from 0x%06X with RSD", 16 if data_16 else 8, beats, address)
+        self.updi_phy.send([*self._st_ptr_frame(address),
+                            constants.UPDI_PHY_SYNC, constants.UPDI_REPEAT | constants.UPDI_REPEAT_BYTE, (beats - 1) & 0xFF,
+                            constants.UPDI_PHY_SYNC, constants.UPDI_LD | constants.UPDI_PTR_INC |
+                            (constants.UPDI_DATA_16 if data_16 else constants.UPDI_DATA_8)])
+        return self.updi_phy.receive(beats << 1 if data_16 else beats)
+
     def st_ptr_inc(self, data):
         """
         Store data to the pointer location with pointer post-increment
@@ -235,6 +253,46 @@ class UpdiDatalink:
             self.updi_phy.send(data_slice)
             num += len(data_slice)
 
+    def rsd(self, enable):
+        """
+        Turn Response Signature Disable on or off - while it's on, stores are not acknowledged
+        :param enable: True to turn it on
+        """
+        self.stcs(constants.UPDI_CS_CTRLA, 0x0E if enable else 0x06)
+
+    def st_pages_RSD(self, pages, command_address, command, dwell_ms, blocksize=None):
+        """
+        Load and commit a run of flash pages in one transfer, RSD must be on already (see rsd()).
+        For each page, the pointer is set, the data stored word by word, and the command written to NVMCTRL.CTRLA -
+        then it is padded with STCS commands that change nothing (they set RSD, which is set), so that the page write
+        has dwell_ms on the wire to finish before the next page starts loading. There is no round trip between pages:
+        the only wait is for the echo of the whole lot.
+        :param pages: list of (address, data), data an even number of bytes, no more than 512
+        :param command_address: address of NVMCTRL.CTRLA
+        :param command: command to commit each page with
+        :param dwell_ms: page write time to allow
+        :blocksize: max number of bytes being sent in one go, None for as many as the echo can be waited for.
+        """
+        char_time = 12.0 / self.updi_phy.ser.baudrate        # start, 8 data, parity, 2 stop bits
+        pad = [constants.UPDI_PHY_SYNC, constants.UPDI_STCS | constants.UPDI_CS_CTRLA, 0x0E]
+        frame = []
+        for address, data in pages:
+            header = [*self._st_ptr_frame(address),
+                      constants.UPDI_PHY_SYNC, constants.UPDI_REPEAT | constants.UPDI_REPEAT_BYTE, ((len(data) >> 1) - 1) & 0xFF,
+                      constants.UPDI_PHY_SYNC, constants.UPDI_ST | constants.UPDI_PTR_INC | constants.UPDI_DATA_16]
+            if frame:
+                # Whatever is sent between one commit and the next page's data counts towards the dwell; that includes
+                # this page's header.
+                needed = dwell_ms / 1000.0 - len(header) * char_time
+                frame += pad * max(0, math.ceil(needed / (len(pad) * char_time)))
+            frame += [*header, *data, *self._sts_frame(command_address, command)]
+        self.logger.debug("Writing %d pages in one transfer of %d bytes", len(pages), len(frame))
+        if blocksize is None:
+            # As much as goes in half a second, well inside the 1s timeout for reading back the echo
+            blocksize = int(0.5 / char_time)
+        for num in range(0, len(frame), blocksize):
+            self.updi_phy.send(frame[num:num + blocksize])
+
     def repeat(self, repeats):
         """
         Store a value to the repeat counter
@@ -349,13 +407,22 @@ class UpdiDatalink16bit(UpdiDatalink):
         :param address: address to write
         """
         self.logger.info("ST to ptr")
-        self.updi_phy.send(
-            [constants.UPDI_PHY_SYNC, constants.UPDI_ST | constants.UPDI_PTR_ADDRESS | constants.UPDI_DATA_16,
-             address & 0xFF, (address >> 8) & 0xFF])
+        self.updi_phy.send(self._st_ptr_frame(address))
         response = self.updi_phy.receive(1)
         if len(response) != 1 or response[0] != constants.UPDI_PHY_ACK:
             raise PymcuprogError("Error with st_ptr")
 
+    @staticmethod
+    def _st_ptr_frame(address):
+        return [constants.UPDI_PHY_SYNC, constants.UPDI_ST | constants.UPDI_PTR_ADDRESS | constants.UPDI_DATA_16,
+                address & 0xFF, (address >> 8) & 0xFF]
+
+    @staticmethod
+    def _sts_frame(address, value):
+        # STS of one byte, as it is sent with RSD on: address and data with no ACK in between
+        return [constants.UPDI_PHY_SYNC, constants.UPDI_STS | constants.UPDI_ADDRESS_16 | constants.UPDI_DATA_8,
+                address & 0xFF, (address >> 8) & 0xFF, value & 0xFF]
+
 
 class UpdiDatalink24bit(UpdiDatalink):
     """
@@ -423,9 +490,18 @@ class UpdiDatalink24bit(UpdiDatalink):
         :param address: address to write
         """
         self.logger.info("ST to ptr")
-        self.updi_phy.send(
-            [constants.UPDI_PHY_SYNC, constants.UPDI_ST | constants.UPDI_PTR_ADDRESS | constants.UPDI_DATA_24,
-             address & 0xFF, (address >> 8) & 0xFF, (address >> 16) & 0xFF])
+        self.updi_phy.send(self._st_ptr_frame(address))
         response = self.updi_phy.receive(1)
         if len(response) != 1 or response[0] != constants.UPDI_PHY_ACK:
             raise PymcuprogError("Error with st_ptr")
+
+    @staticmethod
+    def _st_ptr_frame(address):
+        return [constants.UPDI_PHY_SYNC, constants.UPDI_ST | constants.UPDI_PTR_ADDRESS | constants.UPDI_DATA_24,
+                address & 0xFF, (address >> 8) & 0xFF, (address >> 16) & 0xFF]
+
+    @staticmethod
+    def _sts_frame(address, value):
+        # STS of one byte, as it is sent with RSD on: address and data with no ACK in between
+        return [constants.UPDI_PHY_SYNC, constants.UPDI_STS | constants.UPDI_ADDRESS_24 | constants.UPDI_DATA_8,
+                address & 0xFF, (address >> 8) & 0xFF, (address >> 16) & 0xFF, value & 0xFF]
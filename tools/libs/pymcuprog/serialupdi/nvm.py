@@ -48,6 +48,14 @@ class NvmUpdi(object):
         """
         raise NotImplementedError("NVM stack not ready")
 
+    def write_user_row(self, address, data):
+        """
+        Writes data to the user row, erasing it first - a chip erase leaves it alone
+        :param address: address to write to
+        :param data: data to write
+        """
+        raise NotImplementedError("NVM stack not ready")
+
     def wait_flash_ready(self):
         """
         Waits for the NVM controller to be ready
@@ -109,12 +117,16 @@ class NvmUpdiTinyMega(NvmUpdi):
 
         return True
 
-    def write_flash(self, address, data, blocksize=2, bulkwrite=0, pagewrite_delay=0):
+    def write_flash(self, address, data, blocksize=2, bulkwrite=0, pagewrite_delay=0, erase=False):
         """
         Writes data to flash (v0)
         :param address: address to write to
         :param data: data to write
+        :param erase: erase the page first (not needed after a chip erase). Only for single pages - bulkwrite must be 0.
         """
+        if erase:
+            return self.write_nvm(address, data, use_word_access=True, blocksize=blocksize, pagewrite_delay=pagewrite_delay,
+                                  nvmcommand=constants.UPDI_V0_NVMCTRL_CTRLA_ERASE_WRITE_PAGE)
         return self.write_nvm(address, data, use_word_access=True, blocksize=blocksize,  bulkwrite=bulkwrite, pagewrite_delay=pagewrite_delay)
 
     def write_eeprom(self, address, data):
@@ -126,6 +138,14 @@ class NvmUpdiTinyMega(NvmUpdi):
         return self.write_nvm(address, data, use_word_access=False,
                               nvmcommand=constants.UPDI_V0_NVMCTRL_CTRLA_ERASE_WRITE_PAGE)
 
+    def write_user_row(self, address, data):
+        """
+        Write data to the user row (v0) - it's written just like EEPROM
+        :param address: address to write to
+        :param data: data to write
+        """
+        return self.write_eeprom(address, data)
+
     def write_fuse(self, address, data, write_delay=1):
         """
         Writes one fuse value (v0)
@@ -212,6 +232,35 @@ class NvmUpdiTinyMega(NvmUpdi):
                 raise PymcuprogError("Timeout waiting for flash ready after page write ")
 
 
+    def write_flash_pipelined(self, pages, pagewrite_delay=0, check_every=0, blocksize=None):
+        """
+        Writes whole flash pages (v0) after a chip erase, without a round trip per page.
+
+        Each page is loaded and committed without waiting for acknowledgements or polling the NVM controller; the time
+        for the page write is allowed for on the wire instead (see UpdiDatalink.st_pages_RSD()), so the next page
+        goes straight on after it. The NVM status is only read after every check_every pages, and at the end.
+        :param pages: list of (address, data), each a whole page
+        :param pagewrite_delay: (ms) time to allow for each page write, if not the default
+        :param check_every: check the status after this many pages (0: only at the end)
+        :param blocksize: max number of bytes to send at a time, None for no limit
+        """
+        if not self.wait_flash_ready():
+            raise PymcuprogError("Timeout waiting for flash ready before page buffer clear ")
+        self.execute_nvm_command(constants.UPDI_V0_NVMCTRL_CTRLA_PAGE_BUFFER_CLR)
+        if not self.wait_flash_ready():
+            raise PymcuprogError("Timeout waiting for flash ready after page buffer clear")
+
+        dwell_ms = pagewrite_delay if pagewrite_delay > 0 else constants.UPDI_V0_PAGE_WRITE_TIME_MS
+        group = check_every if check_every > 0 else len(pages)
+        for num in range(0, len(pages), group):
+            self.readwrite.write_pages_rsd(pages[num:num + group],
+                                           self.device.nvmctrl_address + constants.UPDI_NVMCTRL_CTRLA,
+                                           constants.UPDI_V0_NVMCTRL_CTRLA_WRITE_PAGE, dwell_ms, blocksize)
+            if not self.wait_flash_ready():
+                raise PymcuprogError("NVM error or timeout in pages 0x{:06X} to 0x{:06X}".format(
+                    pages[num][0], pages[min(num + group, len(pages)) - 1][0]))
+
+
 class NvmUpdiAvrDx(NvmUpdi):
     """
     AKA Version 1 UPDI NVM
@@ -243,15 +292,33 @@ class NvmUpdiAvrDx(NvmUpdi):
 
         return True
 
-    def write_flash(self, address, data, blocksize=2, bulkwrite=0, pagewrite_delay=0):
+    def write_flash(self, address, data, blocksize=2, bulkwrite=0, pagewrite_delay=0, erase=False):
         """
         Writes data to flash (v1)
         :param address: address to write to
         :param data: data to write
+        :param erase: erase the page first (not needed after a chip erase). Only for single pages - bulkwrite must be 0.
         :return:
         """
+        if erase:
+            # Page erase is started by writing anywhere in the page once the command is set
+            if not self.wait_flash_ready():
+                raise Exception("Timeout waiting for flash ready before page erase")
+            self.execute_nvm_command(constants.UPDI_V1_NVMCTRL_CTRLA_FLASH_PAGE_ERASE)
+            self.readwrite.write_data(address, [0xFF])
+            if not self.wait_flash_ready():
+                raise Exception("Timeout waiting for flash ready after page erase")
+            bulkwrite = 0
         return self.write_nvm(address, data, use_word_access=True, blocksize=blocksize, bulkwrite=bulkwrite, pagewrite_delay=pagewrite_delay)
 
+    def write_user_row(self, address, data):
+        """
+        Write data to the user row (v1) - it's erased and written like a flash page
+        :param address: address to write to
+        :param data: data to write
+        """
+        return self.write_flash(address, data, erase=True)
+
     def write_eeprom(self, address, data):
         """
         Writes data to NVM (EEPROM)
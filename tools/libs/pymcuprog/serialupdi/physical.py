@@ -1,6 +1,8 @@
 """
 Serial driver for UPDI stack
 """
+import os
+import sys
 import time
 from logging import getLogger
 import serial
@@ -14,6 +16,14 @@ class UpdiPhysical:
     PDI physical driver using a given serial port at a given baud
     """
 
+    # Low latency mode (prog.py --lowlatency): on Linux, ask the serial driver for low latency and turn an FTDI
+    # adapter's latency timer down to 1ms; and everywhere, don't wait for each echo on its own - it's read along with
+    # the response to the next command that has one, so a store and its ACK cost one read instead of two.
+    low_latency = False
+
+    # Most echo that's left waiting in low latency mode before it's read anyway, well inside the tty input buffer
+    MAX_ECHO_PENDING = 1024
+
     def __init__(self, port, baud=115200):
         """
         Initialise the serial port
@@ -25,13 +35,17 @@ class UpdiPhysical:
         self.port = port
         self.baud = baud
         self.ser = None
+        self.echo_pending = 0
 
         self.initialise_serial(self.port, self.baud)
 
         # send an initial break as handshake
         self.send([constants.UPDI_BREAK])
+        self._read_echo()
 
     def change_baud(self, newbaud):
+        # Everything sent so far has to be out on the wire before the rate changes
+        self._read_echo()
         self.ser.baudrate = newbaud
 
     def initialise_serial(self, port, baud):
@@ -50,6 +64,42 @@ class UpdiPhysical:
         except SerialException:
             self.logger.error("Unable to open serial port '%s'", port)
             raise
+        self.echo_pending = 0
+        if self.low_latency:
+            self._set_low_latency()
+
+    def _set_low_latency(self):
+        """
+        Linux only, and best effort - either may need permissions that aren't there
+        """
+        if not sys.platform.startswith("linux"):
+            return
+        try:
+            import array
+            import fcntl
+            import termios
+            # struct serial_struct: flags is the fifth int; ASYNC_LOW_LATENCY is 1 << 13
+            serial_struct = array.array('i', [0] * 32)
+            fcntl.ioctl(self.ser.fileno(), termios.TIOCGSERIAL, serial_struct)
+            serial_struct[4] |= 1 << 13
+            fcntl.ioctl(self.ser.fileno(), termios.TIOCSSERIAL, serial_struct)
+            self.logger.info("Low latency mode set")
+        except (ImportError, AttributeError, OSError, ValueError) as error:
+            self.logger.info("Can't set low latency mode: %s", error)
+        latency_timer = "/sys/class/tty/{}/device/latency_timer".format(os.path.basename(os.path.realpath(self.port)))
+        if os.path.exists(latency_timer):
+            try:
+                with open(latency_timer, "w") as timer:
+                    timer.write("1")
+                self.logger.info("FTDI latency timer set to 1ms")
+            except OSError as error:
+                self.logger.warning("Can't set FTDI latency timer (%s): %s", latency_timer, error)
+
+    def _read_echo(self):
+        # Read back whatever echo is still owed, in low latency mode
+        if self.echo_pending:
+            self.ser.read(self.echo_pending)
+            self.echo_pending = 0
 
     def _loginfo(self, msg, data):
         if data and isinstance(data[0], str):
@@ -109,7 +159,12 @@ class UpdiPhysical:
 
         self.ser.write(command)
         # it will echo back.
-        echo = self.ser.read(len(command))
+        if self.low_latency:
+            self.echo_pending += len(command)
+            if self.echo_pending > self.MAX_ECHO_PENDING:
+                self._read_echo()
+        else:
+            echo = self.ser.read(len(command))
 
     def receive(self, size):
         """
@@ -119,19 +174,25 @@ class UpdiPhysical:
         response = bytearray()
         timeout = 1
 
+        # Any echo still owed comes first; it's read in the same go, and dropped
+        echo = self.echo_pending
+        self.echo_pending = 0
+        size += echo
+
         # For each byte
         while size and timeout:
 
-            # Read
-            character = self.ser.read()
+            # Read whatever has come in, up to what's still expected
+            characters = self.ser.read(size)
 
             # Anything in?
-            if character:
-                response.append(ord(character))
-                size -= 1
+            if characters:
+                response += characters
+                size -= len(characters)
             else:
                 timeout -= 1
 
+        response = response[echo:]
         self._loginfo("receive", response)
         return response
 
@@ -142,6 +203,7 @@ class UpdiPhysical:
         self.send([
             constants.UPDI_PHY_SYNC,
             constants.UPDI_KEY | constants.UPDI_KEY_SIB | constants.UPDI_SIB_32BYTES])
+        self._read_echo()
         return self.ser.readline()
 
     def __del__(self):
@@ -107,6 +107,31 @@ class UpdiReadWrite(object):
         # For performance, managing repeat count is done in ld_ptr_inc16()
         return self.datalink.ld_ptr_inc16(words)
 
+    def read_data_bulk(self, address, size, use_word_access=False):
+        """
+        Reads any number of bytes, in the largest blocks a repeat allows (256 bytes, or 512 with word access). RSD is
+        on throughout: it only drops the ACK after each pointer store, which saves a round trip per block - loads still
+        return their data, so nothing is lost that a short read wouldn't show.
+        :param address: address to read from
+        :param size: number of bytes to read (even, for word access)
+        :param use_word_access: read 16-bit words
+        """
+        self.logger.debug("Reading %d bytes from 0x%04X in bulk", size, address)
+        block = constants.UPDI_MAX_REPEAT_SIZE << 1 if use_word_access else constants.UPDI_MAX_REPEAT_SIZE
+        data = bytearray()
+        self.datalink.rsd(True)
+        try:
+            for num in range(0, size, block):
+                length = min(block, size - num)
+                chunk = self.datalink.ld_ptr_block_RSD(address + num, length >> 1 if use_word_access else length,
+                                                       use_word_access)
+                if len(chunk) != length:
+                    raise PymcuprogError("Short read at 0x{:06X}: {} of {} bytes".format(address + num, len(chunk), length))
+                data += chunk
+        finally:
+            self.datalink.rsd(False)
+        return data
+
     def write_data_words(self, address, data, blocksize):
         """
         Writes a number of words to memory
@@ -134,6 +159,15 @@ class UpdiReadWrite(object):
         # the st_pty_inc16_RSD routine does the repeat and rsd enable/disable stu
         return self.datalink.st_ptr_inc16_RSD(data, blocksize)
 
+    def write_pages_rsd(self, pages, command_address, command, dwell_ms, blocksize=None):
+        """
+        Loads and commits several flash pages with no acknowledgements, see UpdiDatalink.st_pages_RSD()
+        :param pages: list of (address, data)
+        """
+        self.datalink.rsd(True)
+        self.datalink.st_pages_RSD(pages, command_address, command, dwell_ms, blocksize)
+        self.datalink.rsd(False)
+
     def write_data(self, address, data):
         """
         Writes a number of bytes to memory
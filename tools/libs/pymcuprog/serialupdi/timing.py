@@ -0,0 +1,134 @@
+"""
+Timing instrumentation for the SerialUPDI stack, for finding out where an upload's time goes (see prog.py --timing)
+
+install() wraps the physical layer's send() and receive(), the NVM ready poll, and the slow one-off steps (entering
+programming mode, unlocking, chip erase, double break) so each call is timed and its bytes counted. Everything is
+added up under the phase that was current at the time, set with set_phase() - prog.py uses one per action.
+"""
+import time
+import threading
+from collections import OrderedDict
+
+from .physical import UpdiPhysical
+from .application import UpdiApplication
+from .nvm import NvmUpdi, NvmUpdiTinyMega, NvmUpdiAvrDx
+
+
+class UpdiTiming(object):
+    """
+    Totals of time, calls and bytes per phase
+    """
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.phase = "connect"
+        self.phases = OrderedDict()
+        self.steps = OrderedDict()
+        self.installed = False
+        self._start_phase(self.phase)
+
+    def _start_phase(self, name):
+        if name not in self.phases:
+            self.phases[name] = {"time": 0.0, "send_time": 0.0, "send_calls": 0, "send_bytes": 0,
+                                 "receive_time": 0.0, "receive_calls": 0, "receive_bytes": 0,
+                                 "ready_time": 0.0, "ready_calls": 0}
+        self.phase_start = time.perf_counter()
+
+    def set_phase(self, name):
+        """
+        Close the current phase and start (or go back to adding to) another one
+        :param name: phase name
+        """
+        with self.lock:
+            self.phases[self.phase]["time"] += time.perf_counter() - self.phase_start
+            self.phase = name
+            self._start_phase(name)
+
+    def add(self, kind, elapsed, nbytes=0):
+        """
+        Count one call in the current phase
+        :param kind: "send", "receive" or "ready"
+        :param elapsed: seconds it took
+        :param nbytes: bytes it moved
+        """
+        with self.lock:
+            phase = self.phases[self.phase]
+            phase[kind + "_time"] += elapsed
+            phase[kind + "_calls"] += 1
+            if kind != "ready":
+                phase[kind + "_bytes"] += nbytes
+
+    def add_step(self, name, elapsed):
+        """
+        Count one of the one-off steps
+        """
+        with self.lock:
+            total = self.steps.setdefault(name, [0.0, 0])
+            total[0] += elapsed
+            total[1] += 1
+
+    def install(self):
+        """
+        Wrap the methods that get timed. Only done once; it stays in place for the rest of the run.
+        """
+        if self.installed:
+            return
+        self.installed = True
+        timing = self
+
+        def wrap_io(cls, name, kind, count):
+            original = getattr(cls, name)
+
+            def timed(*args, **kwargs):
+                start = time.perf_counter()
+                result = original(*args, **kwargs)
+                timing.add(kind, time.perf_counter() - start, count(args, result))
+                return result
+            setattr(cls, name, timed)
+
+        def wrap_step(cls, name, step):
+            original = getattr(cls, name)
+
+            def timed(*args, **kwargs):
+                start = time.perf_counter()
+                try:
+                    return original(*args, **kwargs)
+                finally:
+                    timing.add_step(step, time.perf_counter() - start)
+            setattr(cls, name, timed)
+
+        wrap_io(UpdiPhysical, "send", "send", lambda args, result: len(args[1]))
+        wrap_io(UpdiPhysical, "receive", "receive", lambda args, result: len(result))
+        wrap_io(NvmUpdi, "wait_flash_ready", "ready", lambda args, result: 0)
+        wrap_step(UpdiPhysical, "send_double_break", "double break")
+        wrap_step(UpdiApplication, "enter_progmode", "enter progmode (key, reset)")
+        wrap_step(UpdiApplication, "unlock", "unlock (erase key, reset)")
+        wrap_step(NvmUpdiTinyMega, "chip_erase", "chip erase")
+        wrap_step(NvmUpdiAvrDx, "chip_erase", "chip erase")
+
+    def report(self):
+        """
+        The breakdown, as lines of text
+        """
+        self.set_phase(self.phase)
+        lines = ["{:<10} {:>8} {:>19} {:>19} {:>14} {:>9}".format(
+            "phase", "total s", "send s/calls/bytes", "recv s/calls/bytes", "ready s/polls", "bytes/s")]
+        for name, phase in self.phases.items():
+            if not phase["time"]:
+                continue
+            moved = phase["send_bytes"] + phase["receive_bytes"]
+            lines.append("{:<10} {:>8.3f} {:>6.3f}/{:>5}/{:>6} {:>6.3f}/{:>5}/{:>6} {:>7.3f}/{:>6} {:>9.0f}".format(
+                name, phase["time"],
+                phase["send_time"], phase["send_calls"], phase["send_bytes"],
+                phase["receive_time"], phase["receive_calls"], phase["receive_bytes"],
+                phase["ready_time"], phase["ready_calls"], moved / phase["time"]))
+            calls = phase["send_calls"] + phase["receive_calls"]
+            if calls:
+                lines.append("{:<10} {:.2f} ms per send/receive call - mostly USB latency, if it's much more than the"
+                             " wire time".format("", 1000 * (phase["send_time"] + phase["receive_time"]) / calls))
+        for name, (elapsed, count) in self.steps.items():
+            lines.append("{:<32} {:>8.3f}s in {} call{}".format(name, elapsed, count, "" if count == 1 else "s"))
+        return lines
+
+
+timing = UpdiTiming()
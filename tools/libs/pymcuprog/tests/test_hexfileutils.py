@@ -9,6 +9,7 @@ from intelhex import IntelHex
 
 from pymcuprog.hexfileutils import write_memories_to_hex, write_memory_to_hex, read_memories_from_hex
 from pymcuprog.hexfileutils import _write_hex_to_file
+from pymcuprog import hexfileutils
 from pymcuprog.deviceinfo import deviceinfo
 from pymcuprog.deviceinfo.memorynames import MemoryNames
 from pymcuprog.deviceinfo.deviceinfokeys import DeviceMemoryInfoKeys
@@ -25,6 +26,25 @@ class TestHexfileutils(unittest.TestCase):
             # Folder is already gone
             pass
 
+    def test_load_hexfile_from_cache_matches_parsed(self):
+        filename = "{}cached.hex".format(TESTFILE_FOLDER)
+        hexfile = IntelHex()
+        hexfile.frombytes(self._generate_dummydata(300), offset=0x100)
+        hexfile.frombytes(self._generate_dummydata(5), offset=0x1000)
+        _write_hex_to_file(hexfile, filename)
+
+        saved_dir = hexfileutils.hexcache_dir
+        hexfileutils.hexcache_dir = "{}cache".format(TESTFILE_FOLDER)
+        self.addCleanup(setattr, hexfileutils, 'hexcache_dir', saved_dir)
+
+        parsed = hexfileutils.load_hexfile(filename)
+        hexfileutils._hexfile_cache.clear()
+        cached = hexfileutils.load_hexfile(filename)
+
+        self.assertIsNot(parsed, cached)
+        self.assertEqual(hexfile.segments(), cached.segments())
+        self.assertEqual(hexfile.tobinstr(), cached.tobinstr())
+
     @staticmethod
     def _generate_dummydata(numbytes):
         """
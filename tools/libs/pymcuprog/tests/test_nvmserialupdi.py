@@ -7,7 +7,10 @@ from mock import MagicMock
 from mock import patch
 
 from pymcuprog.nvmserialupdi import NvmAccessProviderSerial
+from pymcuprog.serialupdi.nvm import NvmUpdiTinyMega
 from pymcuprog.deviceinfo import deviceinfo
+from pymcuprog.deviceinfo.deviceinfokeys import DeviceMemoryInfoKeys
+from pymcuprog.deviceinfo.memorynames import MemoryNames
 
 class TestNvmAccessProviderSerial(unittest.TestCase):
     def _mock_updiapplication(self):
@@ -57,3 +60,86 @@ class TestNvmAccessProviderSerial(unittest.TestCase):
         serial.release_from_reset()
 
         mock_updiapplication.leave_progmode.assert_called()
+
+    def test_write_delta_writes_only_changed_pages(self):
+        mock_updiapplication = self._mock_updiapplication()
+
+        dinfo = deviceinfo.getdeviceinfo('atmega4809')
+        serial = NvmAccessProviderSerial(None, dinfo, None)
+        flash_info = deviceinfo.DeviceMemoryInfo(dinfo).memory_info_by_name(MemoryNames.FLASH)
+        page_size = flash_info[DeviceMemoryInfoKeys.PAGE_SIZE]
+
+        current = bytearray([0xAA] * page_size * 4)
+        new = bytearray(current)
+        new[page_size + 3] = 0x55
+        new[page_size * 3] = 0x00
+        mock_updiapplication.read_data_words.return_value = current
+        mock_updiapplication.read_data.return_value = current
+        mock_updiapplication.read_data_bulk.return_value = current
+
+        serial.write(flash_info, 0, new, delta=True)
+
+        written = [call[0][0] for call in mock_updiapplication.nvm.write_flash.call_args_list]
+        self.assertEqual([flash_info[DeviceMemoryInfoKeys.ADDRESS] + page_size, flash_info[DeviceMemoryInfoKeys.ADDRESS] + page_size * 3], written)
+        for call in mock_updiapplication.nvm.write_flash.call_args_list:
+            self.assertTrue(call[1]['erase'])
+        mock_updiapplication.nvm.chip_erase.assert_not_called()
+
+    def test_write_pipelined_passes_whole_pages(self):
+        mock_updiapplication = self._mock_updiapplication()
+
+        dinfo = deviceinfo.getdeviceinfo('atmega4809')
+        serial = NvmAccessProviderSerial(None, dinfo, None)
+        flash_info = deviceinfo.DeviceMemoryInfo(dinfo).memory_info_by_name(MemoryNames.FLASH)
+        page_size = flash_info[DeviceMemoryInfoKeys.PAGE_SIZE]
+
+        data = bytearray(range(256)) * (page_size * 3 // 256 + 1)
+        data = data[:page_size * 2 + 10]
+
+        serial.write(flash_info, 0, data, pagewrite_delay=4, pipeline=8)
+
+        mock_updiapplication.nvm.write_flash.assert_not_called()
+        args, kwargs = mock_updiapplication.nvm.write_flash_pipelined.call_args
+        pages = args[0]
+        self.assertEqual([flash_info[DeviceMemoryInfoKeys.ADDRESS] + page_size * n for n in range(3)],
+                         [address for address, _ in pages])
+        for _, page in pages:
+            self.assertEqual(page_size, len(page))
+        self.assertEqual(data, bytearray().join(page for _, page in pages)[:len(data)])
+        self.assertEqual(4, kwargs['pagewrite_delay'])
+        self.assertEqual(8, kwargs['check_every'])
+
+    def test_read_large_uses_bulk_reads(self):
+        mock_updiapplication = self._mock_updiapplication()
+        mock_updiapplication.read_data_bulk.side_effect = lambda address, size, words: bytearray(size)
+
+        dinfo = deviceinfo.getdeviceinfo('atmega4809')
+        serial = NvmAccessProviderSerial(None, dinfo, None)
+        flash_info = deviceinfo.DeviceMemoryInfo(dinfo).memory_info_by_name(MemoryNames.FLASH)
+
+        data = serial.read(flash_info, 0, 0x1800)
+
+        self.assertEqual(0x1800, len(data))
+        mock_updiapplication.read_data_words.assert_not_called()
+        calls = [call[0] for call in mock_updiapplication.read_data_bulk.call_args_list]
+        base = flash_info[DeviceMemoryInfoKeys.ADDRESS]
+        self.assertEqual([(base, 0x1000, True), (base + 0x1000, 0x800, True)], calls)
+
+    def test_crc_check_flash_reports_crcscan_result(self):
+        mock_updiapplication = self._mock_updiapplication()
+        mock_updiapplication.nvm = MagicMock(spec=NvmUpdiTinyMega)
+
+        dinfo = deviceinfo.getdeviceinfo('atmega4809')
+        serial = NvmAccessProviderSerial(None, dinfo, None)
+
+        # busy, then done and OK; CTRLA still enabled
+        mock_updiapplication.readwrite.read_byte.side_effect = [0x01, 0x02, 0x01]
+        self.assertTrue(serial.crc_check_flash())
+
+        # done, not OK, enabled: a real mismatch
+        mock_updiapplication.readwrite.read_byte.side_effect = [0x00, 0x01]
+        self.assertFalse(serial.crc_check_flash())
+
+        # never enabled: couldn't be run
+        mock_updiapplication.readwrite.read_byte.side_effect = [0x00, 0x00]
+        self.assertIsNone(serial.crc_check_flash())
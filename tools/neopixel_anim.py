@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""neopixel_anim.py - encode RGB(W) frames for tinyNeoPixelAnimation (tinyNeoPixel_Static)
+
+Part of megaTinyCore - github.com/SpenceKonde/megaTinyCore
+Free Software - LGPL 2.1, please see LICENCE.md for details
+
+Each frame is encoded as the changes from the one before (the first from all off), with the ops that
+tinyNeoPixelAnimation.h describes, and written in the strip's byte order, as a C array to paste into the sketch.
+
+Input is either a binary file of frames one after another, each pixels * 3 (or * 4 for RGBW) bytes in R, G, B(, W)
+order, or a JSON list of frames, each a list of "RRGGBB" (or "RRGGBBWW") hex strings.
+"""
+
+import argparse
+import json
+import sys
+
+SKIP_MAX = 0x3F
+LITERAL_MAX = 0x40
+FILL_MAX = 0x80
+
+
+def read_frames(path, pixels, bpp):
+    if path.endswith('.json'):
+        with open(path) as f:
+            frames = json.load(f)
+        out = []
+        for frame in frames:
+            if len(frame) != pixels:
+                sys.exit("frame %d has %d pixels, not %d" % (len(out), len(frame), pixels))
+            out.append([tuple(bytes.fromhex(p.lstrip('#'))[:bpp].ljust(bpp, b'\0')) for p in frame])
+        return out
+    with open(path, 'rb') as f:
+        data = f.read()
+    size = pixels * bpp
+    if not size or len(data) % size:
+        sys.exit("%d bytes isn't a whole number of %d byte frames" % (len(data), size))
+    return [[tuple(data[i + j * bpp:i + (j + 1) * bpp]) for j in range(pixels)] for i in range(0, len(data), size)]
+
+
+def reorder(pixel, order):
+    # pixel is (r, g, b[, w]); order is like "GRB" or "GRBW" - the order the bytes go to the LEDs.
+    channels = dict(zip('RGBW', pixel))
+    return bytes(channels[c] for c in order)
+
+
+def encode_frame(prev, cur):
+    out = bytearray()
+    n = len(cur)
+    i = 0
+    skipped = 0
+    while i < n:
+        if cur[i] == prev[i]:
+            skipped += 1
+            i += 1
+            continue
+        while skipped:
+            step = min(skipped, SKIP_MAX)
+            out.append(step)
+            skipped -= step
+        run = 1
+        while i + run < n and run < FILL_MAX and cur[i + run] == cur[i]:
+            run += 1
+        if run >= 2:
+            out.append(0x80 | (run - 1))
+            out += cur[i]
+            i += run
+            continue
+        # Literal, up to the next unchanged pixel or run of two the same.
+        start = i
+        i += 1
+        while i < n and i - start < LITERAL_MAX and cur[i] != prev[i] and not (i + 1 < n and cur[i + 1] == cur[i]):
+            i += 1
+        out.append(0x40 | (i - start - 1))
+        for p in cur[start:i]:
+            out += p
+    out.append(0)                       # the pixels after the last op are left as they were.
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='frames, as .json or binary')
+    parser.add_argument('--pixels', '-n', type=int, required=True, help='pixels in the strip')
+    parser.add_argument('--order', '-o', default='GRB', help='byte order of the LEDs: GRB (the default), RGB, GRBW...')
+    parser.add_argument('--name', default='animation', help='name of the array')
+    args = parser.parse_args()
+    order = args.order.upper()
+    if sorted(order) not in (sorted('RGB'), sorted('RGBW')):
+        sys.exit("--order must be R, G, B (and W) in some order")
+    bpp = len(order)
+    frames = [[reorder(p, order) for p in frame] for frame in read_frames(args.input, args.pixels, bpp)]
+    data = bytearray()
+    prev = [bytes(bpp)] * args.pixels
+    for frame in frames:
+        data += encode_frame(prev, frame)
+        prev = frame
+    print("// %d frames of %d pixels (%s): %d bytes, from %d uncompressed" %
+          (len(frames), args.pixels, order, len(data), len(frames) * args.pixels * bpp))
+    print("const uint8_t %s[%d] = {" % (args.name, len(data)))
+    for i in range(0, len(data), 16):
+        print("  " + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    print("};")
+
+
+if __name__ == '__main__':
+    main()
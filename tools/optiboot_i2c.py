@@ -0,0 +1,118 @@
+#!/usr/bin/python3
+
+# -*- coding: utf-8 -*-
+"""
+Upload a hex file through Optiboot_x built with TWI=1, from a Linux I2C bus.
+
+Each flash page is one write transaction - 'W', the offset, and the page -
+and the bootloader holds the clock on the last byte until the page is
+written, so there's nothing to wait for between them. The flash is read back
+a page per read transaction. The bus clock is whatever the I2C adapter was
+set up with (for a Raspberry Pi, dtparam=i2c_arm_baudrate=1000000 in
+config.txt for FM+); the bootloader has to be built with CLOCK_DIV=2 or 1
+to keep up with more than 400 kHz.
+"""
+import sys
+import os
+import argparse
+import fcntl
+import time
+
+# dependencies
+toolspath = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(toolspath, "libs"))
+
+from intelhex import IntelHex
+
+I2C_SLAVE = 0x0703        # ioctl from linux/i2c-dev.h
+
+APP_START = 0x200         # the bootloader takes the first 512 bytes
+
+
+class OptibootException(Exception):
+    pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+
+    parser.add_argument("-d", "--device",
+                        type=str,
+                        default="/dev/i2c-1",
+                        help="I2C bus device (default: /dev/i2c-1).")
+
+    parser.add_argument("-a", "--address",
+                        type=lambda x: int(x, 0),
+                        default=0x2A,
+                        help="The bootloader's TWI_ADDRESS (default: 0x2A).")
+
+    parser.add_argument("-f", "--filename",
+                        type=str,
+                        required=True,
+                        help="Hex file to write.")
+
+    parser.add_argument("--noverify",
+                        action="store_true",
+                        help="Don't read the flash back afterwards.")
+
+    args = parser.parse_args()
+
+    try:
+        elapsed = upload(args)
+        print("Upload took {:.2f}s".format(elapsed))
+    except (OptibootException, OSError) as e:
+        print("Error: {}".format(e))
+        sys.exit(1)
+
+
+def upload(args):
+    ih = IntelHex(args.filename)
+    start = ih.minaddr()
+    image = ih.tobinstr(start=start)
+    if start < APP_START:
+        raise OptibootException("hex file starts at 0x{:04X}, below the application section - was it built for Optiboot?".format(start))
+
+    bus = os.open(args.device, os.O_RDWR)
+    fcntl.ioctl(bus, I2C_SLAVE, args.address)
+    time_start = time.time()
+
+    try:
+        os.write(bus, b'S')
+        signature = os.read(bus, 3)
+    except OSError:
+        raise OptibootException("no answer at address 0x{:02X}".format(args.address))
+    # 0x1E, then flash size (0x91 = 2k ... 0x95 = 32k), then the part
+    if signature[0] != 0x1E or not 0x91 <= signature[1] <= 0x95:
+        raise OptibootException("unexpected signature {}".format(signature.hex()))
+    page_size = 128 if signature[1] == 0x95 else 64
+    flash_size = 1024 << (signature[1] - 0x90)
+    print("Signature {}, {} byte flash, {} byte pages".format(signature.hex(), flash_size, page_size))
+    if start + len(image) > flash_size:
+        raise OptibootException("image does not fit")
+
+    # Page aligned, padded with 0xFF to whole pages
+    pad = start & (page_size - 1)
+    start -= pad
+    image = b'\xFF' * pad + image
+    image += b'\xFF' * (-len(image) % page_size)
+
+    for offset in range(0, len(image), page_size):
+        address = start + offset
+        os.write(bus, bytes([ord('W'), address & 0xFF, address >> 8]) + image[offset:offset + page_size])
+    print("Wrote {} bytes".format(len(image)))
+
+    if not args.noverify:
+        os.write(bus, bytes([ord('R'), start & 0xFF, start >> 8]))
+        for offset in range(0, len(image), page_size):
+            # reads carry on from where the last one stopped
+            if os.read(bus, page_size) != image[offset:offset + page_size]:
+                raise OptibootException("verify failed in the page at 0x{:04X}".format(start + offset))
+        print("Verified")
+
+    os.write(bus, b'Q')
+    os.close(bus)
+    return time.time() - time_start
+
+
+if __name__ == "__main__":
+    main()
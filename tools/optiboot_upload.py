@@ -0,0 +1,321 @@
+#!/usr/bin/python3
+
+# -*- coding: utf-8 -*-
+"""
+Upload a hex file through Optiboot_x, several flash pages per write command.
+
+This speaks the same STK500 subset as avrdude's "arduino" programmer, but can
+send up to --batch pages in each STK_PROG_PAGE, for bootloaders built with
+BATCH_PAGES=n (with --batch 1 it works with any Optiboot_x). There's one
+reply per batch instead of one (or two) per page, which is where most of the
+time goes with a USB serial adapter. Against a bootloader built with
+AUTOBAUD=1, any bit rate the adapter and the bootloader clock can do may be
+used; otherwise it has to match the bootloader's BAUD_RATE.
+
+With --nodes, it talks to bootloaders built with MULTIDROP=1 instead: all
+the nodes on an RS-485 bus, which must already be in the bootloader, get
+each page at the same time, and are then polled one by one for the pages
+they missed, which are sent again - to everyone, but only the nodes that
+still want them write them. The time taken depends on the size of the
+image, not the number of nodes, except for the polls.
+"""
+import sys
+import os
+import argparse
+import time
+
+# dependencies
+toolspath = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(toolspath, "libs"))
+
+import serial
+from intelhex import IntelHex
+
+STK_OK = 0x10
+STK_INSYNC = 0x14
+CRC_EOP = 0x20
+STK_GET_SYNC = 0x30
+STK_ENTER_PROGMODE = 0x50
+STK_LEAVE_PROGMODE = 0x51
+STK_LOAD_ADDRESS = 0x55
+STK_PROG_PAGE = 0x64
+STK_READ_PAGE = 0x74
+STK_READ_SIGN = 0x75
+
+APP_START = 0x200         # the bootloader takes the first 512 bytes
+
+
+class OptibootException(Exception):
+    pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+
+    parser.add_argument("-u", "--uart",
+                        type=str,
+                        required=True,
+                        help="Serial port the bootloader is on.")
+
+    parser.add_argument("-b", "--baudrate",
+                        type=int,
+                        default=115200,
+                        help="Serial baud rate (default: 115200). Must match the bootloader unless it was built with AUTOBAUD=1.")
+
+    parser.add_argument("-f", "--filename",
+                        type=str,
+                        required=True,
+                        help="Hex file to write.")
+
+    parser.add_argument("-n", "--batch",
+                        type=int,
+                        default=1,
+                        help="Pages per write command; must not be more than the bootloader's BATCH_PAGES (default: 1, which any Optiboot_x accepts).")
+
+    parser.add_argument("--noverify",
+                        action="store_true",
+                        help="Don't read the flash back afterwards.")
+
+    parser.add_argument("--noreset",
+                        action="store_true",
+                        help="Don't pulse DTR/RTS to reset the board into the bootloader.")
+
+    parser.add_argument("--nodes",
+                        type=str,
+                        help="MULTIDROP: IDs of the nodes to update, like 1,2,5-30 (the byte before the last of the USERROW).")
+
+    parser.add_argument("--gap",
+                        type=float,
+                        default=10,
+                        help="MULTIDROP: ms to wait after each frame, longer than the bootloader's MULTIDROP_GAP_MS plus a page write (default: 10).")
+
+    parser.add_argument("--rounds",
+                        type=int,
+                        default=10,
+                        help="MULTIDROP: how many times to poll the nodes and send missed pages again (default: 10).")
+
+    parser.add_argument("--echo",
+                        action="store_true",
+                        help="MULTIDROP: the adapter receives what it sends; skip over it.")
+
+    args = parser.parse_args()
+
+    try:
+        elapsed = multidrop_upload(args) if args.nodes else upload(args)
+        print("Upload took {:.2f}s".format(elapsed))
+    except (OptibootException, serial.SerialException) as e:
+        print("Error: {}".format(e))
+        sys.exit(1)
+
+
+def upload(args):
+    ih = IntelHex(args.filename)
+    start = ih.minaddr()
+    image = ih.tobinstr(start=start)
+    if start < APP_START:
+        raise OptibootException("hex file starts at 0x{:04X}, below the application section - was it built for Optiboot?".format(start))
+
+    port = serial.Serial(args.uart, args.baudrate, timeout=1)
+    time_start = time.time()
+    if not args.noreset:
+        port.dtr = False
+        port.rts = False
+        time.sleep(0.05)
+        port.dtr = True
+        port.rts = True
+        time.sleep(0.05)
+    sync(port)
+
+    signature = command(port, [STK_READ_SIGN], 3)
+    # 0x1E, then flash size (0x91 = 2k ... 0x95 = 32k), then the part
+    if signature[0] != 0x1E or not 0x91 <= signature[1] <= 0x95:
+        raise OptibootException("unexpected signature {}".format(signature.hex()))
+    page_size = 128 if signature[1] == 0x95 else 64
+    flash_size = 1024 << (signature[1] - 0x90)
+    print("Signature {}, {} byte flash, {} byte pages".format(signature.hex(), flash_size, page_size))
+    if start + len(image) > flash_size:
+        raise OptibootException("image does not fit")
+
+    # Page aligned, padded with 0xFF to whole pages
+    pad = start & (page_size - 1)
+    start -= pad
+    image = b'\xFF' * pad + image
+    image += b'\xFF' * (-len(image) % page_size)
+
+    command(port, [STK_ENTER_PROGMODE])
+    chunk = page_size * args.batch
+    for offset in range(0, len(image), chunk):
+        data = image[offset:offset + chunk]
+        load_address(port, start + offset)
+        command(port, [STK_PROG_PAGE, len(data) >> 8, len(data) & 0xFF, ord('F')] + list(data))
+    print("Wrote {} bytes".format(len(image)))
+
+    if not args.noverify:
+        for offset in range(0, len(image), page_size):
+            load_address(port, start + offset)
+            read = command(port, [STK_READ_PAGE, page_size >> 8, page_size & 0xFF, ord('F')], page_size)
+            if read != image[offset:offset + page_size]:
+                raise OptibootException("verify failed in the page at 0x{:04X}".format(start + offset))
+        print("Verified")
+
+    command(port, [STK_LEAVE_PROGMODE])
+    port.close()
+    return time.time() - time_start
+
+
+def sync(port):
+    # Several tries: the bootloader may still be starting, and with AUTOBAUD, it only answers the second one.
+    for _ in range(10):
+        port.reset_input_buffer()
+        port.write(bytes([STK_GET_SYNC, CRC_EOP]))
+        if port.read(2) == bytes([STK_INSYNC, STK_OK]):
+            return
+        time.sleep(0.05)
+    raise OptibootException("no answer from the bootloader")
+
+
+def load_address(port, address):
+    command(port, [STK_LOAD_ADDRESS, address & 0xFF, address >> 8])
+
+
+def command(port, cmd, reply_length=0):
+    port.write(bytes(cmd + [CRC_EOP]))
+    reply = port.read(reply_length + 2)
+    if len(reply) != reply_length + 2 or reply[0] != STK_INSYNC or reply[-1] != STK_OK:
+        raise OptibootException("command 0x{:02X}: bad reply {}".format(cmd[0], reply.hex()))
+    return reply[1:-1]
+
+
+# MULTIDROP framing: [destination][command][page, LE][data][CRC-16/MODBUS, LE], frames separated by gaps
+MULTIDROP_ALL = 0xFF
+
+
+def modbus_crc(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def parse_nodes(text):
+    nodes = []
+    for part in text.split(","):
+        first, _, last = part.partition("-")
+        nodes += range(int(first), int(last or first) + 1)
+    if not nodes or min(nodes) < 0 or max(nodes) >= MULTIDROP_ALL:
+        raise OptibootException("node IDs are 0 to 254")
+    return nodes
+
+
+def send_frame(port, args, dest, cmd, page=0, data=b''):
+    frame = bytes([dest, ord(cmd), page & 0xFF, page >> 8]) + data
+    crc = modbus_crc(frame)
+    frame += bytes([crc & 0xFF, crc >> 8])
+    port.reset_input_buffer()
+    port.write(frame)
+    port.flush()
+    # flush() only waits for the OS; allow for the adapter still sending it, then the gap
+    time.sleep(len(frame) * 10 / port.baudrate + args.gap / 1000)
+    if args.echo:
+        port.read(len(frame))
+
+
+def poll(port, args, node, map_length=None):
+    """Returns (SIGROW_DEVICEID1, set of wanted pages), or None if there was no good answer."""
+    for _ in range(3):
+        send_frame(port, args, node, 'M')
+        if map_length is None:
+            head = port.read(3)
+            if len(head) != 3:
+                continue
+            length = (1024 << (head[2] - 0x90)) // (128 if head[2] == 0x95 else 64) // 8
+            reply = head + port.read(length + 2)
+        else:
+            reply = port.read(3 + map_length + 2)
+        if len(reply) < 6 or reply[0] != node or reply[1] != ord('m') or modbus_crc(reply):
+            continue
+        bitmap = reply[3:-2]
+        return reply[2], {i for i in range(len(bitmap) * 8) if bitmap[i >> 3] & (1 << (i & 7))}
+    return None
+
+
+def multidrop_upload(args):
+    nodes = parse_nodes(args.nodes)
+    ih = IntelHex(args.filename)
+    start = ih.minaddr()
+    image = ih.tobinstr(start=start)
+    if start < APP_START:
+        raise OptibootException("hex file starts at 0x{:04X}, below the application section - was it built for Optiboot?".format(start))
+
+    port = serial.Serial(args.uart, args.baudrate, timeout=0.1)
+    time_start = time.time()
+    signature = None
+    for node in list(nodes):
+        answer = poll(port, args, node)
+        if answer is None:
+            print("Node {}: no answer".format(node))
+            nodes.remove(node)
+        elif signature is None:
+            signature = answer[0]
+        elif answer[0] != signature:
+            raise OptibootException("node {} is a different part".format(node))
+    if not nodes:
+        raise OptibootException("no answer from any node")
+    page_size = 128 if signature == 0x95 else 64
+    flash_size = 1024 << (signature - 0x90)
+    map_length = flash_size // page_size // 8
+    print("{} nodes, {} byte flash, {} byte pages".format(len(nodes), flash_size, page_size))
+    if start + len(image) > flash_size:
+        raise OptibootException("image does not fit")
+
+    pad = start & (page_size - 1)
+    start -= pad
+    image = b'\xFF' * pad + image
+    image += b'\xFF' * (-len(image) % page_size)
+    first = start // page_size
+    count = len(image) // page_size
+    pages = set(range(first, first + count))
+
+    def send_pages(wanted):
+        for page in sorted(wanted):
+            offset = (page - first) * page_size
+            send_frame(port, args, MULTIDROP_ALL, 'P', page, image[offset:offset + page_size])
+
+    # The first page is erased by 'B' and sent last, once every node has all the others,
+    # so a node is never left with a runnable mix of old and new code.
+    send_frame(port, args, MULTIDROP_ALL, 'B', first, bytes([count & 0xFF, count >> 8]))
+    send_pages(pages - {first})
+    done = []
+    for _ in range(args.rounds):
+        wanted = set()
+        done = []
+        for node in list(nodes):
+            answer = poll(port, args, node, map_length)
+            if answer is not None and answer[1] - pages:
+                # it missed the 'B', or has been reset since
+                send_frame(port, args, node, 'B', first, bytes([count & 0xFF, count >> 8]))
+                answer = poll(port, args, node, map_length)
+            if answer is None:
+                print("Node {}: stopped answering".format(node))
+                nodes.remove(node)
+                continue
+            wanted |= answer[1]
+            if not answer[1]:
+                done.append(node)
+        if not wanted:
+            break
+        send_pages((wanted - {first}) or wanted)
+    send_frame(port, args, MULTIDROP_ALL, 'Q')
+    port.close()
+
+    failed = sorted(set(parse_nodes(args.nodes)) - set(done))
+    print("Wrote {} bytes to {} nodes".format(len(image), len(done)))
+    if failed:
+        raise OptibootException("not updated: nodes {}".format(", ".join(str(n) for n in failed)))
+    return time.time() - time_start
+
+
+if __name__ == "__main__":
+    main()
@@ -3,7 +3,13 @@
 # -*- coding: utf-8 -*-
 import sys
 import os
+import io
+import json
+import binascii
 import argparse
+import threading
+import time
+from copy import copy
 
 # dependencies
 toolspath = os.path.dirname(os.path.realpath(__file__))
@@ -11,6 +17,11 @@ sys.path.insert(0, os.path.join(toolspath, "libs"))
 
 import pymcuprog.pymcuprog_main as pymcu
 from pymcuprog.pymcuprog import setup_logging
+from serial.tools import list_ports
+from intelhex import IntelHex
+from pymcuprog.serialupdi.timing import timing
+from pymcuprog.serialupdi.physical import UpdiPhysical
+from pymcuprog.hexfileutils import read_memories_from_hex
 
 import logging
 
@@ -32,7 +43,7 @@ def main():
     parser.add_argument("-b", "--baudrate",
                         type=str,
                         default="115200",
-                        help="Serial baud rate, if applicable, (default: 115200).")
+                        help="Serial baud rate, if applicable, (default: 115200). 'auto' finds the fastest one that works, and remembers it for the adapter.")
 
     parser.add_argument("-wc", "--write_chunk",
                         type=int,
@@ -44,6 +55,15 @@ def main():
                         default=-1,
                         help="Max number of bytes to request from the device at a time when reading or verifying. (Default: -1 (maximum - usually 512b)) Intended as a workaround for specific serial adapters.")
 
+    parser.add_argument("--delta",
+                        action="store_true",
+                        help="Write: no chip erase; read the flash back and only erase/write the pages that differ. EEPROM, and flash past the end of the new sketch, are left as they were.")
+
+    parser.add_argument("--pipeline",
+                        type=int,
+                        default=0,
+                        help="Write: send flash pages back to back, allowing the page write time (-wd, or 3ms) on the wire instead of waiting for each one, and check for NVM errors every this many pages and at the end. tinyAVR and megaAVR 0-series only; not with --delta. (Default: 0 (off))")
+
     parser.add_argument("-d", "--device",
                         type=str,
                         help="Part number, lowercase (e.g. attiny412, ...).")
@@ -63,6 +83,11 @@ def main():
                         default="",
                         help="Hex file to read/write.")
 
+    parser.add_argument("-m", "--manifest",
+                        type=str,
+                        default="",
+                        help="JSON file listing fuses, flash, EEPROM and user row contents; all are written and verified in one session. See tools/README.md.")
+
     parser.add_argument("-wd", "--writedelay",
                         type=float,
                         default=0,
@@ -76,13 +101,25 @@ def main():
     parser.add_argument("-u", "--uart",
                         type=str,
                         default="",
-                        help="Serial port to use if tool is uart.")
+                        help="Serial port to use if tool is uart. Several, separated by commas, or 'auto' for every USB serial port, program that many targets at once.")
 
     parser.add_argument("-s", "--serialnumber",
                         type=str,
                         default="",
                         help="Tool USB serial (optional, for non-Serial UPDI programmers only. This feature is neither tested nor maintained.).")
 
+    parser.add_argument("--crcverify",
+                        action="store_true",
+                        help="Write: verify the flash with the target's CRCSCAN instead of reading it all back. Stores a CRC in the last 2 bytes of flash, which must be unused. Falls back to a readback if the check doesn't pass. tinyAVR and megaAVR 0-series only; not with --delta.")
+
+    parser.add_argument("--lowlatency",
+                        action="store_true",
+                        help="Read each echo together with the response after it, and on Linux, set the port to low latency mode and an FTDI adapter's latency timer to 1ms (needs write access to its latency_timer in sysfs).")
+
+    parser.add_argument("--timing",
+                        action="store_true",
+                        help="Print where the time went when done: serial send/receive, NVM ready polls and the slow steps, per action.")
+
     parser.add_argument("-v", "--verbose",
                         action="count",
                         default=0,
@@ -91,10 +128,14 @@ def main():
     # Parse args
     args = parser.parse_args()
 
-    if args.action == "" and args.fuses == "" and not args.fuses_print:
+    if args.action == "" and args.fuses == "" and not args.fuses_print and args.manifest == "":
         parser.print_help()
         sys.exit(0)
 
+    if args.manifest != "" and (args.action not in ("", "write") or args.filename != ""):
+        print("Error: a manifest is the whole upload - no other action or file can be given with it")
+        sys.exit(1)
+
     if args.action != "" and args.action not in ("read", "write", "erase"):
         print("Error: unknown action '{}'".format(args.action))
         sys.exit(1)
@@ -107,7 +148,18 @@ def main():
         print("Error: no filename provided")
         sys.exit(1)
 
+    manifest = None
+    if args.manifest != "":
+        try:
+            manifest = load_manifest(args.manifest)
+        except (OSError, ValueError) as e:
+            print("Error: cannot read manifest, '{}'".format(e))
+            sys.exit(1)
+        args.action = "manifest"
+
     fuses_dict = {}
+    if manifest is not None:
+        fuses_dict.update(manifest["fuses"])
     for fuse_str in args.fuses:
         fuse_offset, fuse_val = fuse_str.split(":")
         try:
@@ -126,19 +178,161 @@ def main():
     elif args.verbose > 1:
         logging_level = logging.DEBUG
 
+    ports = [port for port in args.uart.split(",") if port]
+    if args.uart == "auto":
+        ports = sorted(port.device for port in list_ports.comports() if port.vid is not None)
+        if not ports:
+            print("Error: no USB serial ports found")
+            sys.exit(1)
+    if args.timing:
+        timing.install()
+    UpdiPhysical.low_latency = args.lowlatency
+
+    if len(ports) > 1 and args.tool == "uart":
+        setup_logging(user_requested_level=logging_level)
+        return_code = program_targets(args, fuses_dict, ports, manifest)
+        print_timing(args)
+        sys.exit(return_code)
+    if ports:
+        args.uart = ports[0]
+
     try:
         setup_logging(user_requested_level=logging_level)
-        return_code = pymcuprog_basic(args, fuses_dict)
+        return_code = pymcuprog_basic(args, fuses_dict, manifest)
+        print_timing(args)
         sys.exit(return_code)
     except PyMcuException as e:
+        print_timing(args)
         print("Error: ".format(e))
         sys.exit(1)
 
 
+def print_timing(args):
+    if args.timing:
+        print("")
+        for line in timing.report():
+            print(line)
+
+
+class TargetOutput:
+    """
+    Stands in for sys.stdout while several targets are programmed at once: what each target's thread prints is kept
+    apart, so it can be shown as one block once that target is done, instead of interleaved with all the rest.
+    """
+    def __init__(self, stream):
+        self.stream = stream
+        self.local = threading.local()
+
+    def write(self, text):
+        buffer = getattr(self.local, "buffer", None)
+        (self.stream if buffer is None else buffer).write(text)
+
+    def flush(self):
+        if getattr(self.local, "buffer", None) is None:
+            self.stream.flush()
+
+
+def load_manifest(filename):
+    """
+    Read a manifest: a JSON object with any of
+        "fuses": {"offset": value, ...}    offsets and values as numbers, or strings in any base int() takes with 0
+        "flash": "file.hex"
+        "eeprom", "userrow": "file.hex", "file.bin", or a list of byte values - hex files are placed by their own
+            addresses, counted from the start of that memory; the others start at 0
+        "erase": false                       to skip the chip erase before the flash is written
+    File names are relative to the manifest.
+
+    :return: dict with "fuses" as {offset: value}, "flash" as a path or None, "eeprom" and "userrow" as
+        (offset, bytearray) or None, and "erase"
+    """
+    with open(filename) as manifest_file:
+        raw = json.load(manifest_file)
+    if not isinstance(raw, dict):
+        raise ValueError("not a JSON object")
+    unknown = set(raw) - {"fuses", "flash", "eeprom", "userrow", "erase"}
+    if unknown:
+        raise ValueError("unknown entries: {}".format(", ".join(sorted(unknown))))
+    base = os.path.dirname(os.path.abspath(filename))
+
+    def number(value):
+        return value if isinstance(value, int) else int(value, 0)
+
+    def contents(entry):
+        if entry is None:
+            return None
+        if isinstance(entry, list):
+            return 0, bytearray(number(value) for value in entry)
+        path = os.path.join(base, entry)
+        if path.lower().endswith((".hex", ".eep")):
+            hexfile = IntelHex(path)
+            return hexfile.minaddr(), bytearray(hexfile.tobinstr(start=hexfile.minaddr()))
+        with open(path, "rb") as binfile:
+            return 0, bytearray(binfile.read())
+
+    return {"fuses": {number(offset): number(value) for offset, value in raw.get("fuses", {}).items()},
+            "flash": os.path.join(base, raw["flash"]) if raw.get("flash") else None,
+            "eeprom": contents(raw.get("eeprom")),
+            "userrow": contents(raw.get("userrow")),
+            "erase": raw.get("erase", True)}
+
+
+def program_targets(args, fuses_dict, ports, manifest=None):
+    """
+    Run the same job on every port at once, a thread each, and summarize. The threads spend nearly all their time
+    waiting on their serial port, so they don't hold each other up; the hex file is only parsed once, by whichever
+    gets to it first (see hexfileutils.load_hexfile()).
+
+    :return: 0 if every target passed, otherwise 1
+    """
+    output = TargetOutput(sys.stdout)
+    results = {}
+    lock = threading.Lock()
+
+    def program_target(port):
+        output.local.buffer = io.StringIO()
+        target_args = copy(args)
+        target_args.uart = port
+        time_start = time.time()
+        try:
+            error = None if pymcuprog_basic(target_args, fuses_dict, manifest) == 0 else "failed"
+        except Exception as e:  # anything at all: it only fails this target
+            error = "{}: {}".format(type(e).__name__, e)
+        elapsed = time.time() - time_start
+        with lock:
+            results[port] = (error, elapsed)
+            output.stream.write("{} {} ({:.1f}s)\n".format("FAIL" if error else "PASS", port, elapsed))
+            log = output.local.buffer.getvalue()
+            if log and (error or args.verbose):
+                output.stream.write(log.replace("\r", "\n") + "\n")
+            output.stream.flush()
+
+    print("Programming {} targets: {}".format(len(ports), ", ".join(ports)))
+    sys.stdout = output
+    time_start = time.time()
+    try:
+        threads = [threading.Thread(target=program_target, args=(port,)) for port in ports]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+    finally:
+        sys.stdout = output.stream
+
+    failed = [port for port in ports if results[port][0]]
+    print("")
+    for port in ports:
+        error, elapsed = results[port]
+        print("{:<16} {}  {:6.1f}s  {}".format(port, "FAIL" if error else "PASS", elapsed, error or ""))
+    print("{} of {} passed in {:.1f}s".format(len(ports) - len(failed), len(ports), time.time() - time_start))
+    return 1 if failed else 0
+
+
 def run_pymcu_action(func, backend, *args, **kwargs):
     args_pymcu = argparse.Namespace(**kwargs)
     time_start = datetime.datetime.now()
+    timing.set_phase(func.__name__.replace("_action_", ""))
     status = func(backend, *args, args_pymcu)
+    timing.set_phase("other")
     time_stop = datetime.datetime.now()
     print("Action took {:.2f}s".format((time_stop - time_start).total_seconds()))
     if status != pymcu.STATUS_SUCCESS:
@@ -157,12 +351,112 @@ def print_report(args):
     print("Target: {}".format(args.device))
     if args.fuses != "":
         print("Set fuses: {}".format(args.fuses))
-    print("Action: {}".format(args.action))
+    print("Action: {}".format(args.action) + (" (delta)" if args.delta and args.action == "write" else ""))
     if args.filename != "":
         print("File: {}".format(args.filename))
 
 
-def pymcuprog_basic(args, fuses_dict):
+def write_flash(backend, args, filename, erase=True):
+    """
+    Chip erase (unless asked not to, or doing a delta upload), write a hex file, and verify it
+    """
+    if erase and not args.delta:
+        run_pymcu_action(pymcu._action_erase, backend,
+                         memory=pymcu.MemoryNameAliases.ALL,
+                         offset=0)
+
+    run_pymcu_action(pymcu._action_write, backend,
+                     memory=pymcu.MemoryNameAliases.ALL,
+                     offset=0,
+                     literal=None,
+                     verify=False,
+                     filename=filename,
+                     blocksize=None if args.write_chunk <= 0 else args.write_chunk,
+                     pagewrite_delay=args.writedelay,
+                     delta=args.delta,
+                     pipeline=0 if args.delta or not erase else args.pipeline)
+
+    if args.crcverify and erase and not args.delta and crc_verify(backend, filename):
+        return
+
+    run_pymcu_action(pymcu._action_verify, backend,
+                     memory=pymcu.MemoryNameAliases.ALL,
+                     offset=0,
+                     literal=None,
+                     filename=filename,
+                     max_read_chunk=None if args.read_chunk <= 0 else args.read_chunk)
+
+
+def crc_verify(backend, filename):
+    """
+    Verify freshly written (after a chip erase) flash with CRCSCAN: work out what the whole flash now holds - the hex
+    file, and 0xFF everywhere else - store its CRC in the last two bytes, and have the target check it. Anything in
+    the hex file that isn't flash is verified by reading it back as usual.
+
+    :return: True if it all checked out; False if it didn't, or couldn't be done - the caller then does a full readback
+    """
+    timing.set_phase("verify")
+    time_start = datetime.datetime.now()
+    flash_info = backend.device_memory_info.memory_info_by_name(pymcu.MemoryNames.FLASH)
+    size = flash_info[pymcu.DeviceMemoryInfoKeys.SIZE]
+    image = bytearray([0xFF] * size)
+    others = []
+    for segment in read_memories_from_hex(filename, backend.device_memory_info):
+        if segment.memory_info[pymcu.DeviceMemoryInfoKeys.NAME] == pymcu.MemoryNames.FLASH:
+            image[segment.offset:segment.offset + len(segment.data)] = segment.data
+        else:
+            others.append(segment)
+    if image[-2:] != b'\xFF\xFF':
+        print("CRC verify: the last 2 bytes of flash are used, reading back instead")
+        return False
+
+    crc = binascii.crc_hqx(bytes(image[:-2]), 0xFFFF)
+    backend.write_memory(bytearray([crc >> 8, crc & 0xFF]), pymcu.MemoryNames.FLASH, size - 2)
+    device_model = backend.programmer.device_model
+    result = device_model.crc_check_flash() if hasattr(device_model, "crc_check_flash") else None
+    if result is None:
+        print("CRC verify: CRCSCAN can't be used on this target, reading back instead")
+        return False
+    if not result:
+        print("CRC verify: CRCSCAN reports a mismatch, reading back to find it")
+        return False
+    for segment in others:
+        memory_name = segment.memory_info[pymcu.DeviceMemoryInfoKeys.NAME]
+        if not backend.verify_memory(segment.data, memory_name, segment.offset):
+            print("Verify of {} failed".format(memory_name))
+            return False
+    print("Flash CRC 0x{:04X} OK ({:.2f}s)".format(crc, (datetime.datetime.now() - time_start).total_seconds()))
+    timing.set_phase("other")
+    return True
+
+
+def write_manifest(backend, args, manifest):
+    """
+    Everything in a manifest past the fuses (which are written first, like any others), without leaving the session:
+    the flash, then the EEPROM - after the chip erase, which may have cleared it - and the user row, each verified.
+    """
+    if manifest["flash"] is not None:
+        write_flash(backend, args, manifest["flash"], manifest["erase"])
+    elif manifest["erase"]:
+        run_pymcu_action(pymcu._action_erase, backend,
+                         memory=pymcu.MemoryNameAliases.ALL,
+                         offset=0)
+    for key, memory_name in (("eeprom", pymcu.MemoryNames.EEPROM), ("userrow", pymcu.MemoryNames.USER_ROW)):
+        if manifest[key] is None:
+            continue
+        offset, data = manifest[key]
+        timing.set_phase(key)
+        print("Writing {} bytes of {} at offset {}".format(len(data), memory_name, offset))
+        backend.write_memory(bytearray(data), memory_name, offset)
+        if not backend.verify_memory(data, memory_name, offset):
+            backend.end_session()
+            backend.disconnect_from_tool()
+            raise PyMcuException("{} verify failed".format(memory_name))
+        print("{} OK".format(memory_name))
+    timing.set_phase("other")
+
+
+def pymcuprog_basic(args, fuses_dict, manifest=None):
     """
     Main program
     """
@@ -198,7 +492,7 @@ def pymcuprog_basic(args, fuses_dict):
                                   args_start)
 
     if status != pymcu.STATUS_SUCCESS:
-        if status == pymcu.STATUS_FAILURE_LOCKED and args.action in ("write", "erase"):
+        if status == pymcu.STATUS_FAILURE_LOCKED and args.action in ("write", "erase", "manifest"):
             print("Locked state detected, performing chip erase")
             args_start.chip_erase_locked_device = True
             status = pymcu._start_session(backend,
@@ -239,26 +533,11 @@ def pymcuprog_basic(args, fuses_dict):
                          filename=None)
 
     # actions
-    if args.action == "write":
-        run_pymcu_action(pymcu._action_erase, backend,
-                         memory=pymcu.MemoryNameAliases.ALL,
-                         offset=0)
+    if args.action == "manifest":
+        write_manifest(backend, args, manifest)
 
-        run_pymcu_action(pymcu._action_write, backend,
-                         memory=pymcu.MemoryNameAliases.ALL,
-                         offset=0,
-                         literal=None,
-                         verify=False,
-                         filename=args.filename,
-                         blocksize=None if args.write_chunk <= 0 else args.write_chunk,
-                         pagewrite_delay=args.writedelay)
-
-        run_pymcu_action(pymcu._action_verify, backend,
-                         memory=pymcu.MemoryNameAliases.ALL,
-                         offset=0,
-                         literal=None,
-                         filename=args.filename,
-                         max_read_chunk=None if args.read_chunk <= 0 else args.read_chunk)
+    elif args.action == "write":
+        write_flash(backend, args, args.filename)
 
     elif args.action == "read":
         run_pymcu_action(pymcu._action_read, backend,
@@ -0,0 +1,248 @@
+#!/usr/bin/python3
+
+# -*- coding: utf-8 -*-
+"""
+Build a fixed set of scenario sketches for a part from each family, and
+report the code size of each - in total, and for the core's hot path files
+(UART.cpp, twi.c, wiring_analog.c) on their own - as CSV. Run it again
+with --baseline pointing at an earlier report, and it gives the change
+instead, so what a change to one of those files costs shows up on every
+part family at once.
+
+The chips and menu options are checked against boards.txt, and the builds
+are done with arduino-cli, which must have this core installed. Every
+symbol in the ELF is put down to the file it came from the same way as
+footprint.py does it, from the debug information the core always builds
+with.
+
+simavr has no model of the tinyAVR 0/1/2-series (or their peripherals), so
+clock cycle counts come from the Benchmarks example on real hardware
+instead: with --serial, the CSV that it prints is read from a board that's
+running it, and added to the report.
+"""
+import sys
+import os
+import argparse
+import csv
+import glob
+import re
+import shutil
+import subprocess
+import tempfile
+
+# dependencies
+toolspath = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(toolspath, "libs"))
+
+import footprint
+
+CORE = os.path.dirname(toolspath)
+
+# One of each family: 0, 1 and 2-series, and 8, 14, 20 and 24 pins
+CONFIGS = ["atxy2:chip=402", "atxy2:chip=412",
+           "atxy4:chip=1604", "atxy4:chip=1614", "atxy4:chip=1624",
+           "atxy6:chip=1616", "atxy7:chip=3217", "atxy7:chip=3227"]
+
+SCENARIOS = {
+    "digital_io": "extras/CompileTestSketches/test_digital_io",
+    "millis":     "extras/CompileTestSketches/timing/test_millis_micros",
+    "analog":     "extras/CompileTestSketches/test_analog_read",
+    "wire_master": "libraries/Wire/examples/master_read",
+    "wire_slave": "libraries/Wire/examples/slave_write",
+    "spi":        "libraries/SPI/examples/DigitalPotControl",
+    "benchmarks": "libraries/megaTinyCore/examples/Benchmarks",
+}
+
+HOT_FILES = ["UART.cpp", "twi.c", "wiring_analog.c"]
+
+COLUMNS = ["config", "scenario", "flash", "ram"] + HOT_FILES
+
+
+class SizeBenchException(Exception):
+    pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+
+    parser.add_argument("-c", "--config",
+                        action="append",
+                        help="board:menu=option,... to build for, from boards.txt; may be given more than once (default: one part of each family).")
+
+    parser.add_argument("-o", "--options",
+                        type=str,
+                        default="",
+                        help="menu=option,... added to every configuration, eg clock=10internal,millis=tcb0")
+
+    parser.add_argument("-s", "--scenario",
+                        action="append",
+                        choices=sorted(SCENARIOS),
+                        help="Scenario to build; may be given more than once (default: all of them).")
+
+    parser.add_argument("-b", "--baseline",
+                        type=str,
+                        help="An earlier report, to give the change from it instead of the sizes.")
+
+    parser.add_argument("--serial",
+                        type=str,
+                        help="Serial port of a board running the Benchmarks example, whose results are added to the report.")
+
+    parser.add_argument("--baud",
+                        type=int,
+                        default=115200,
+                        help="Baud rate for --serial (default: 115200).")
+
+    parser.add_argument("--cli",
+                        type=str,
+                        default="arduino-cli",
+                        help="arduino-cli executable (default: arduino-cli on the PATH).")
+
+    parser.add_argument("--package",
+                        type=str,
+                        default="megaTinyCore:megaavr",
+                        help="Platform part of the FQBN (default: megaTinyCore:megaavr).")
+
+    args = parser.parse_args()
+
+    try:
+        menus = read_boards(os.path.join(CORE, "boards.txt"))
+        configs = [add_options(c, args.options) for c in (args.config or CONFIGS)]
+        for config in configs:
+            check_config(menus, config)
+        scenarios = args.scenario or list(SCENARIOS)
+        rows = []
+        for config in configs:
+            for scenario in scenarios:
+                rows.append(build(args, config, scenario))
+        if args.baseline:
+            rows = compare(rows, args.baseline)
+        out = csv.writer(sys.stdout, lineterminator="\n")
+        out.writerow(COLUMNS)
+        for row in rows:
+            out.writerow([row.get(c, "") for c in COLUMNS])
+        if args.serial:
+            print()
+            for line in read_benchmarks(args.serial, args.baud):
+                print(line)
+    except (SizeBenchException, footprint.FootprintException, OSError) as e:
+        print("Error: {}".format(e), file=sys.stderr)
+        sys.exit(1)
+
+
+def read_boards(path):
+    """ board -> {menu -> set of its options} """
+    menus = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r"^(\w+)\.menu\.(\w+)\.(\w+)=", line)
+            if m:
+                menus.setdefault(m.group(1), {}).setdefault(m.group(2), set()).add(m.group(3))
+            m = re.match(r"^(\w+)\.name=", line)
+            if m:
+                menus.setdefault(m.group(1), {})
+    return menus
+
+
+def add_options(config, options):
+    if not options:
+        return config
+    return config + ("," if ":" in config else ":") + options
+
+
+def check_config(menus, config):
+    board, _, options = config.partition(":")
+    if board not in menus:
+        raise SizeBenchException("no board {} in boards.txt".format(board))
+    for option in filter(None, options.split(",")):
+        menu, _, value = option.partition("=")
+        if value not in menus[board].get(menu, ()):
+            raise SizeBenchException("{} has no {}={} in boards.txt".format(board, menu, value))
+
+
+def build(args, config, scenario):
+    sketch = os.path.join(CORE, SCENARIOS[scenario])
+    row = {"config": config, "scenario": scenario}
+    outdir = tempfile.mkdtemp(prefix="sizebench")
+    try:
+        result = subprocess.run([args.cli, "compile", "--fqbn", args.package + ":" + config,
+                                 "--output-dir", outdir, sketch],
+                                stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+        if result.returncode:
+            # too big for the part, say, which is a result too
+            row["flash"] = "failed"
+            return row
+        elf = os.path.join(outdir, os.path.basename(sketch) + ".ino.elf")
+        row.update(measure(args, elf))
+    finally:
+        shutil.rmtree(outdir, ignore_errors=True)
+    return row
+
+
+def toolchain(args, tool):
+    """ avr-nm and avr-size from the toolchain arduino-cli builds with, if they aren't on the PATH """
+    if shutil.which("avr-" + tool):
+        return "avr-" + tool
+    result = subprocess.run([args.cli, "config", "dump", "--format", "json"],
+                            stdout=subprocess.PIPE, universal_newlines=True)
+    m = re.search(r'"data":\s*"([^"]+)"', result.stdout)
+    if m:
+        found = sorted(glob_tools(m.group(1), tool))
+        if found:
+            return found[-1]
+    raise SizeBenchException("can't find avr-{}".format(tool))
+
+
+def glob_tools(data, tool):
+    name = "avr-" + tool + (".exe" if os.name == "nt" else "")
+    return glob.glob(os.path.join(data, "packages", "*", "tools", "avr-gcc", "*", "bin", name))
+
+
+def measure(args, elf):
+    nm = toolchain(args, "nm")
+    tools = os.path.join(os.path.dirname(nm), "")
+    flash, ram = footprint.sections(tools, elf)
+    row = {"flash": flash, "ram": ram}
+    for f in HOT_FILES:
+        row[f] = 0
+    for name, size, kind, source in footprint.symbols(tools, elf):
+        source = os.path.basename(source)
+        if source in row and kind in footprint.FLASH_TYPES:
+            row[source] += size
+    return row
+
+
+def compare(rows, path):
+    with open(path) as f:
+        old = {(r["config"], r["scenario"]): r for r in csv.DictReader(f)}
+    changes = []
+    for row in rows:
+        before = old.get((row["config"], row["scenario"]))
+        change = dict(row)
+        if before and row["flash"] != "failed" and before["flash"] != "failed":
+            for c in COLUMNS[2:]:
+                change[c] = "{:+d}".format(row[c] - int(before[c]))
+        changes.append(change)
+    return changes
+
+
+def read_benchmarks(port, baud):
+    """ One pass of the Benchmarks example's output, from its header to the blank line at the end """
+    import serial
+    lines = []
+    with serial.Serial(port, baud, timeout=30) as ser:
+        started = False
+        while True:
+            raw = ser.readline()
+            if not raw:
+                raise SizeBenchException("nothing from the Benchmarks sketch on {}".format(port))
+            line = raw.decode("ascii", "replace").strip()
+            if line.startswith("part,F_CPU"):
+                started = True
+            elif started and not line:
+                return lines
+            if started:
+                lines.append(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,162 @@
+#!/usr/bin/python3
+
+# -*- coding: utf-8 -*-
+"""
+Turn what traceDump() wrote - the ring of TRACE() events recorded with
+CORE_TRACE - back into text, one event per line, oldest first, with the
+time since the one before.
+
+It reads a file (off an SD card, or saved from a terminal program), or
+waits on a serial port for the dump. Times are 16-bit, so anything more
+than 65535 ticks apart (6.5 ms at 20 MHz, when the time is from the TCB)
+looks as if it were closer together than it was - take it as "at least".
+The events the core records itself have names; give the sketch's own with
+--names, a file of id=name lines (like 3=button or 0x10=sensor read).
+"""
+import sys
+import os
+import argparse
+
+# dependencies
+toolspath = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, os.path.join(toolspath, "libs"))
+
+FORMAT = 1
+
+NAMES = {
+    0xF0: "reset",
+    0xF1: "millis ISR",
+    0xF2: "USART RXC",
+    0xF3: "USART DRE",
+    0xF4: "TWI ISR",
+    0xF8: "PORTA ISR",
+    0xF9: "PORTB ISR",
+    0xFA: "PORTC ISR",
+}
+TRACE_ID_HIGH = 0xFF
+
+
+class TraceException(Exception):
+    pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+
+    parser.add_argument("-p", "--port",
+                        type=str,
+                        help="Serial port to read the dump from, instead of a file.")
+
+    parser.add_argument("-b", "--baud",
+                        type=int,
+                        default=115200,
+                        help="Baud rate for --port (default: 115200).")
+
+    parser.add_argument("-n", "--names",
+                        type=str,
+                        help="File of id=name lines for the sketch's own TRACE() ids.")
+
+    parser.add_argument("file",
+                        type=str,
+                        nargs="?",
+                        help="File holding the dump; anything before it is skipped.")
+
+    args = parser.parse_args()
+
+    try:
+        names = dict(NAMES)
+        if args.names:
+            names.update(read_names(args.names))
+        if args.port:
+            clock, raw = read_serial(args.port, args.baud)
+        elif args.file:
+            with open(args.file, "rb") as f:
+                clock, raw = parse(f.read())
+        else:
+            raise TraceException("give a file or --port")
+        for line in decode(clock, raw, names):
+            print(line)
+    except (TraceException, OSError) as e:
+        print("Error: {}".format(e), file=sys.stderr)
+        sys.exit(1)
+
+
+def read_names(path):
+    names = {}
+    with open(path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if line:
+                ident, _, name = line.partition("=")
+                names[int(ident.strip(), 0)] = name.strip()
+    return names
+
+
+def header(data, start):
+    """ (clock, entries) from the header at start """
+    if data[start + 2] != FORMAT:
+        raise TraceException("trace format {}, not {}".format(data[start + 2], FORMAT))
+    return int.from_bytes(data[start + 4:start + 8], "little"), data[start + 3]
+
+
+def parse(data):
+    """ clock, and the list of (time, id, arg), from a whole dump """
+    start = data.find(b"TR")
+    if start < 0 or len(data) < start + 8:
+        raise TraceException("no trace in the file")
+    clock, count = header(data, start)
+    body = data[start + 8:start + 8 + 4 * count]
+    if len(body) < 4 * count:
+        raise TraceException("the trace has {} entries, but only {} are there".format(count, len(body) // 4))
+    return clock, [(int.from_bytes(body[i:i + 2], "little"), body[i + 2], body[i + 3]) for i in range(0, len(body), 4)]
+
+
+def read_serial(port, baud):
+    import serial
+    with serial.Serial(port, baud, timeout=30) as ser:
+        last = b""
+        while True:
+            c = ser.read(1)
+            if not c:
+                raise TraceException("no trace from {}".format(port))
+            if last + c == b"TR":
+                break
+            last = c
+        rest = ser.read(6)
+        if len(rest) < 6:
+            raise TraceException("the trace from {} stopped in the header".format(port))
+        clock, count = header(b"TR" + rest, 0)
+        body = ser.read(4 * count)
+        return parse(b"TR" + rest + body)
+
+
+def decode(clock, raw, names):
+    """ lines of text: time since the event before, in us (or ms), the event, and its arg """
+    # the high byte of a TRACE16() arg is an entry of its own; join it back on
+    events = []
+    for time, ident, arg in raw:
+        if ident == TRACE_ID_HIGH and events:
+            events[-1][2] |= arg << 8
+        else:
+            events.append([time, ident, arg])
+    lines = []
+    unit = "us" if clock > 1000 else "ms"
+    scale = (1000000.0 if clock > 1000 else 1000.0) / clock
+    last = None
+    for time, ident, arg in events:
+        if last is None:
+            step = "{:>12}".format("")
+        else:
+            ticks = (time - last) & 0xFFFF
+            step = "+{:>9.1f}{}".format(ticks * scale, unit)
+        last = time
+        name = names.get(ident, "event {}".format(ident))
+        if ident == 0xF0:
+            lines.append("{} {:<16} flags 0x{:02X}".format(step, name, arg))
+        else:
+            lines.append("{} {:<16} {} (0x{:X})".format(step, name, arg, arg))
+    return lines
+
+
+if __name__ == "__main__":
+    main()
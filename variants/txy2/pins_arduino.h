@@ -34,6 +34,8 @@
 #define NUM_TOTAL_PINS                    (6)
 #define EXTERNAL_NUM_INTERRUPTS           (8)
 #define PINS_COUNT                        (6)
+/* The pins on each port, bit n for Pxn - for pinsSaveAndPark() */
+#define PORTA_PINS                        (0xCF)
 
 #define PIN_PA6   (0)
 #define PIN_PA7   (1)
@@ -54,6 +54,9 @@
 #define NUM_TOTAL_FREE_PINS           (NUM_DIGITAL_PINS)
 #define NUM_TOTAL_PINS                (NUM_DIGITAL_PINS)
 #define PINS_COUNT                    (NUM_DIGITAL_PINS)
+/* The pins on each port, bit n for Pxn - for pinsSaveAndPark() */
+#define PORTA_PINS                    (0xFF)
+#define PORTB_PINS                    (0x0F)
 #define EXTERNAL_NUM_INTERRUPTS       (12)
 
 #define digitalPinHasPWM(p)           ((p) == PIN_PA4 || (p) == PIN_PA5 || (p) == PIN_PB2 || (p) == PIN_PB1 || (p) == PIN_PB0 || (p) == PIN_PA3)
@@ -43,6 +43,10 @@
 #define NUM_TOTAL_PINS                (18)
 #define NUM_DIGITAL_PINS              (18)
 #define PINS_COUNT                    (18)
+/* The pins on each port, bit n for Pxn - for pinsSaveAndPark() */
+#define PORTA_PINS                    (0xFF)
+#define PORTB_PINS                    (0x3F)
+#define PORTC_PINS                    (0x0F)
 
 #define EXTERNAL_NUM_INTERRUPTS       (20)
 
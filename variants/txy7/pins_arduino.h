@@ -44,6 +44,10 @@
 #define NUM_SPI_PINS                  (3) // (MISO / MOSI / SCK)
 #define NUM_TOTAL_PINS                (22)
 #define PINS_COUNT                    (22)
+/* The pins on each port, bit n for Pxn - for pinsSaveAndPark() */
+#define PORTA_PINS                    (0xFF)
+#define PORTB_PINS                    (0xFF)
+#define PORTC_PINS                    (0x3F)
 
 #define EXTERNAL_NUM_INTERRUPTS       (22)
 